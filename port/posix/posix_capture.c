@@ -0,0 +1,333 @@
+/*
+ * Copyright (C) 2024 wolfSSL Inc.
+ *
+ * This file is part of wolfHSM.
+ *
+ * wolfHSM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfHSM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wolfHSM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * port/posix/posix_capture.c
+ *
+ * Record server traffic to a file and replay it through a client
+ */
+
+#include <stdint.h>
+#include <stddef.h>     /* For NULL, offsetof */
+#include <stdio.h>      /* For FILE, fopen, fread, fwrite */
+#include <string.h>     /* For memset, memcpy */
+#include <time.h>       /* For clock_gettime */
+
+#include "wolfhsm/wh_error.h"
+#include "wolfhsm/wh_comm.h"
+#include "wolfhsm/wh_message.h"
+#include "wolfhsm/wh_message_nvm.h"
+#include "wolfhsm/wh_message_image.h"
+#include "wolfhsm/wh_message_cert.h"
+#include "wolfhsm/wh_message_chacha.h"
+#include "wolfhsm/wh_message_customcb.h"
+#include "wolfhsm/wh_client.h"
+
+#include "posix_capture.h"
+
+/** Local declarations */
+static uint64_t pcNowUs(void);
+static int pcIsSensitive(uint16_t kind);
+static int pcRefersToClientMemory(uint16_t magic, uint16_t kind,
+        uint16_t size, const uint8_t* data);
+static int pcReadRecord(FILE* file, posixCaptureRecord* rec, uint8_t* data);
+
+/** Local implementations */
+static uint64_t pcNowUs(void)
+{
+    struct timespec ts;
+
+    (void)clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ull + (uint64_t)ts.tv_nsec / 1000;
+}
+
+/* Message groups whose data may contain key material or plaintext */
+static int pcIsSensitive(uint16_t kind)
+{
+    switch (WH_MESSAGE_GROUP(kind)) {
+    case WH_MESSAGE_GROUP_NVM:
+    case WH_MESSAGE_GROUP_KEY:
+    case WH_MESSAGE_GROUP_CRYPTO:
+    case WH_MESSAGE_GROUP_PKCS11:
+    case WH_MESSAGE_GROUP_SHE:
+    case WH_MESSAGE_GROUP_KEYWRAP:
+    case WH_MESSAGE_GROUP_CHACHA:
+    case WH_MESSAGE_GROUP_PREPARED:
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+/* Requests carrying client addresses or shared bulk region offsets.  Sent
+ * again they would have the server read or write whatever the replaying
+ * client has at those locations */
+static int pcRefersToClientMemory(uint16_t magic, uint16_t kind,
+        uint16_t size, const uint8_t* data)
+{
+    uint32_t type = 0;
+
+    switch (kind) {
+    case WH_MESSAGE_KIND(WH_MESSAGE_GROUP_NVM,
+            WH_MESSAGE_NVM_ACTION_ADDOBJECTDMA32):
+    case WH_MESSAGE_KIND(WH_MESSAGE_GROUP_NVM,
+            WH_MESSAGE_NVM_ACTION_READDMA32):
+    case WH_MESSAGE_KIND(WH_MESSAGE_GROUP_NVM,
+            WH_MESSAGE_NVM_ACTION_ADDOBJECTDMA64):
+    case WH_MESSAGE_KIND(WH_MESSAGE_GROUP_NVM,
+            WH_MESSAGE_NVM_ACTION_READDMA64):
+    case WH_MESSAGE_KIND(WH_MESSAGE_GROUP_NVM,
+            WH_MESSAGE_NVM_ACTION_ADDOBJECTBULK):
+    case WH_MESSAGE_KIND(WH_MESSAGE_GROUP_NVM,
+            WH_MESSAGE_NVM_ACTION_READBULK):
+    case WH_MESSAGE_KIND(WH_MESSAGE_GROUP_IMAGE,
+            WH_MESSAGE_IMAGE_ACTION_VERIFYDMA32):
+    case WH_MESSAGE_KIND(WH_MESSAGE_GROUP_IMAGE,
+            WH_MESSAGE_IMAGE_ACTION_VERIFYDMA64):
+    case WH_MESSAGE_KIND(WH_MESSAGE_GROUP_CERT,
+            WH_MESSAGE_CERT_ACTION_VERIFYDMA32):
+    case WH_MESSAGE_KIND(WH_MESSAGE_GROUP_CERT,
+            WH_MESSAGE_CERT_ACTION_VERIFYDMA64):
+    case WH_MESSAGE_KIND(WH_MESSAGE_GROUP_CHACHA,
+            WH_MESSAGE_CHACHA_ACTION_CRYPTDMA):
+        return 1;
+    default:
+        break;
+    }
+
+    /* Custom callbacks say in the request whether they use DMA */
+    if (    (WH_MESSAGE_GROUP(kind) == WH_MESSAGE_GROUP_CUSTOM) &&
+            (size >= offsetof(whMessageCustomCb_Request, type) +
+                sizeof(type))) {
+        memcpy(&type, data + offsetof(whMessageCustomCb_Request, type),
+                sizeof(type));
+        type = wh_Translate32(magic, type);
+        return (type == WH_MESSAGE_CUSTOM_CB_TYPE_DMA32) ||
+                (type == WH_MESSAGE_CUSTOM_CB_TYPE_DMA64);
+    }
+    return 0;
+}
+
+/* Returns 0 on success, WH_ERROR_NOTFOUND at the end of the file, or
+ * WH_ERROR_ABORTED for a truncated or corrupt record */
+static int pcReadRecord(FILE* file, posixCaptureRecord* rec, uint8_t* data)
+{
+    if (fread(rec, sizeof(*rec), 1, file) != 1) {
+        return (feof(file) != 0) ? WH_ERROR_NOTFOUND : WH_ERROR_ABORTED;
+    }
+    if (rec->size > WH_COMM_DATA_LEN) {
+        return WH_ERROR_ABORTED;
+    }
+    if (    (rec->size != 0) &&
+            (fread(data, rec->size, 1, file) != 1)) {
+        return WH_ERROR_ABORTED;
+    }
+    return 0;
+}
+
+/** Capture */
+
+int posixCapture_Init(posixCaptureContext* context,
+        const posixCaptureConfig* config)
+{
+    posixCaptureFileHeader hdr;
+
+    if (    (context == NULL) ||
+            (config == NULL) ||
+            (config->filename == NULL) ||
+            (config->redact > POSIX_CAPTURE_REDACT_ALL)) {
+        return WH_ERROR_BADARGS;
+    }
+
+    memset(context, 0, sizeof(*context));
+    context->file = fopen(config->filename, "wb");
+    if (context->file == NULL) {
+        return WH_ERROR_ABORTED;
+    }
+
+    hdr.magic = POSIX_CAPTURE_FILE_MAGIC;
+    hdr.version = POSIX_CAPTURE_FILE_VERSION;
+    if (fwrite(&hdr, sizeof(hdr), 1, context->file) != 1) {
+        (void)fclose(context->file);
+        context->file = NULL;
+        return WH_ERROR_ABORTED;
+    }
+
+    context->redact = config->redact;
+    context->start_us = pcNowUs();
+    return 0;
+}
+
+int posixCapture_Cleanup(posixCaptureContext* context)
+{
+    int rc = 0;
+
+    if (context == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+    if (context->file != NULL) {
+        if (fclose(context->file) != 0) {
+            rc = WH_ERROR_ABORTED;
+        }
+        context->file = NULL;
+    }
+    return rc;
+}
+
+int posixCapture_Record(void* context, whCommCaptureDir dir, uint16_t magic,
+        uint16_t kind, uint16_t seq, uint16_t size, const void* data)
+{
+    posixCaptureContext* c = context;
+    posixCaptureRecord rec;
+    uint8_t zeros[WH_COMM_DATA_LEN];
+
+    if ((c == NULL) || (c->file == NULL) || (size > WH_COMM_DATA_LEN)) {
+        return WH_ERROR_BADARGS;
+    }
+
+    memset(&rec, 0, sizeof(rec));
+    rec.time_us = pcNowUs() - c->start_us;
+    rec.magic = magic;
+    rec.kind = kind;
+    rec.seq = seq;
+    rec.size = size;
+    rec.dir = (uint8_t)dir;
+    rec.redacted = (c->redact == POSIX_CAPTURE_REDACT_ALL) ||
+            ((c->redact == POSIX_CAPTURE_REDACT_KEYS) && pcIsSensitive(kind));
+    if (rec.redacted != 0) {
+        memset(zeros, 0, size);
+        data = zeros;
+    }
+
+    if (    (fwrite(&rec, sizeof(rec), 1, c->file) != 1) ||
+            ((size != 0) && (fwrite(data, size, 1, c->file) != 1))) {
+        c->errors++;
+        return WH_ERROR_ABORTED;
+    }
+    c->records++;
+    return 0;
+}
+
+/** Replay */
+
+int posixCapture_Replay(whClientContext* client,
+        const posixCaptureReplayConfig* config,
+        posixCaptureReplayStats* out_stats)
+{
+    posixCaptureFileHeader hdr;
+    posixCaptureRecord rec;
+    posixCaptureReplayStats stats;
+    uint8_t data[WH_COMM_DATA_LEN];
+    FILE* file = NULL;
+    uint64_t first_us = 0;
+    uint64_t start = 0;
+    uint64_t sent = 0;
+    uint64_t due = 0;
+    uint32_t latency = 0;
+    int have_first = 0;
+    int rc = 0;
+
+    if (    (client == NULL) ||
+            (config == NULL) ||
+            (config->filename == NULL) ||
+            (out_stats == NULL)) {
+        return WH_ERROR_BADARGS;
+    }
+
+    file = fopen(config->filename, "rb");
+    if (file == NULL) {
+        return WH_ERROR_NOTFOUND;
+    }
+    if (    (fread(&hdr, sizeof(hdr), 1, file) != 1) ||
+            (hdr.magic != POSIX_CAPTURE_FILE_MAGIC) ||
+            (hdr.version != POSIX_CAPTURE_FILE_VERSION)) {
+        (void)fclose(file);
+        return WH_ERROR_ABORTED;
+    }
+
+    memset(&stats, 0, sizeof(stats));
+    start = pcNowUs();
+
+    while ((rc = pcReadRecord(file, &rec, data)) == 0) {
+        if (rec.dir != WH_COMM_CAPTURE_REQUEST) {
+            continue;
+        }
+        if (pcRefersToClientMemory(rec.magic, rec.kind, rec.size, data)) {
+            stats.skipped++;
+            continue;
+        }
+
+        /* Keep the captured spacing between requests, scaled by speedup */
+        if (have_first == 0) {
+            first_us = rec.time_us;
+            have_first = 1;
+        }
+        if (config->speedup != 0) {
+            due = start + (rec.time_us - first_us) / config->speedup;
+            while (pcNowUs() < due) {
+                if (    (config->idleCb != NULL) &&
+                        (config->idleCb(config->idleContext) != 0)) {
+                    rc = WH_ERROR_ABORTED;
+                    break;
+                }
+            }
+            if (rc != 0) {
+                break;
+            }
+        }
+
+        do {
+            rc = wh_Client_SendRequest(client, WH_MESSAGE_GROUP(rec.kind),
+                    WH_MESSAGE_ACTION(rec.kind), rec.size, data);
+        } while (rc == WH_ERROR_NOTREADY);
+        if (rc != 0) {
+            break;
+        }
+        sent = pcNowUs();
+        stats.requests++;
+        if (rec.redacted != 0) {
+            stats.redacted++;
+        }
+
+        do {
+            rc = wh_Client_RecvResponse(client, NULL, NULL, NULL, data);
+            if (    (rc == WH_ERROR_NOTREADY) &&
+                    (config->idleCb != NULL) &&
+                    (config->idleCb(config->idleContext) != 0)) {
+                rc = WH_ERROR_ABORTED;
+            }
+        } while (rc == WH_ERROR_NOTREADY);
+        if (rc != 0) {
+            stats.failures++;
+            break;
+        }
+
+        latency = (uint32_t)(pcNowUs() - sent);
+        stats.latency_total_us += latency;
+        if (latency > stats.latency_max_us) {
+            stats.latency_max_us = latency;
+        }
+    }
+
+    stats.elapsed_us = pcNowUs() - start;
+    (void)fclose(file);
+
+    *out_stats = stats;
+    /* Reaching the end of the file is success */
+    return (rc == WH_ERROR_NOTFOUND) ? 0 : rc;
+}
@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) 2024 wolfSSL Inc.
+ *
+ * This file is part of wolfHSM.
+ *
+ * wolfHSM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfHSM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wolfHSM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * port/posix/posix_capture.h
+ */
+
+#ifndef PORT_POSIX_POSIX_CAPTURE_H_
+#define PORT_POSIX_POSIX_CAPTURE_H_
+
+/*
+ * Traffic capture and replay.  posixCapture_Record is a whCommCaptureCb that
+ * appends every request and response seen by a server to a file, with
+ * microsecond timestamps.  posixCapture_Replay reads such a file and sends
+ * the captured requests through a client, at the original pace or faster,
+ * measuring throughput and round trip latency.
+ *
+ * File format, in native byte order: a posixCaptureFileHeader followed by
+ * records, each a posixCaptureRecord and then size bytes of message data.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "wolfhsm/wh_comm.h"
+#include "wolfhsm/wh_client.h"
+
+#define POSIX_CAPTURE_FILE_MAGIC 0x50434857ul   /* "WHCP" */
+#define POSIX_CAPTURE_FILE_VERSION 1
+
+typedef enum {
+    POSIX_CAPTURE_REDACT_NONE = 0,  /* Record message data as is */
+    POSIX_CAPTURE_REDACT_KEYS = 1,  /* Zero data of NVM, key, crypto, PKCS11,
+                                     * SHE, key wrap, ChaCha and prepared
+                                     * operation messages */
+    POSIX_CAPTURE_REDACT_ALL = 2,   /* Zero all data.  Sizes and timing only */
+} posixCaptureRedact;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+} posixCaptureFileHeader;
+
+typedef struct {
+    uint64_t time_us;       /* Since the capture started */
+    uint16_t magic;
+    uint16_t kind;
+    uint16_t seq;
+    uint16_t size;          /* Message data bytes following this record */
+    uint8_t  dir;           /* whCommCaptureDir */
+    uint8_t  redacted;      /* Data was replaced with zeros */
+    uint8_t  padding[6];
+} posixCaptureRecord;
+
+/** Capture */
+
+typedef struct {
+    const char* filename;
+    uint8_t redact;         /* posixCaptureRedact */
+    uint8_t padding[7];
+} posixCaptureConfig;
+
+/* In memory context structure associated with a capture file */
+typedef struct {
+    FILE* file;
+    uint64_t start_us;
+    uint32_t records;       /* Records written */
+    uint32_t errors;        /* Records that could not be written */
+    uint8_t redact;
+    uint8_t padding[7];
+} posixCaptureContext;
+
+int posixCapture_Init(posixCaptureContext* context,
+        const posixCaptureConfig* config);
+int posixCapture_Cleanup(posixCaptureContext* context);
+
+/* whCommCaptureCb.  Pass the posixCaptureContext as capture_context */
+int posixCapture_Record(void* context, whCommCaptureDir dir, uint16_t magic,
+        uint16_t kind, uint16_t seq, uint16_t size, const void* data);
+
+/** Replay */
+
+/* Called while waiting to send or for a response, e.g. to run a server on
+ * the same thread.  A non-zero return stops the replay */
+typedef int (*posixCaptureIdleCb)(void* context);
+
+typedef struct {
+    const char* filename;
+    posixCaptureIdleCb idleCb;  /* Optional */
+    void* idleContext;
+    uint32_t speedup;           /* 0 for no pacing, 1 for the original pace,
+                                 * N for N times faster */
+    uint8_t padding[4];
+} posixCaptureReplayConfig;
+
+typedef struct {
+    uint64_t elapsed_us;        /* First send until last response */
+    uint64_t latency_total_us;  /* Sum of round trips */
+    uint32_t latency_max_us;
+    uint32_t requests;          /* Requests sent */
+    uint32_t redacted;          /* Of which sent with zeroed data */
+    uint32_t failures;          /* Requests without a valid response */
+    uint32_t skipped;           /* DMA and bulk requests not sent */
+    uint8_t padding[4];
+} posixCaptureReplayStats;
+
+/* Replay every captured request through client, which must be connected to
+ * a server.  Redacted requests are sent with zeroed data, preserving the
+ * pace and mix even though the server will likely reject them.  Requests
+ * that pass client memory by DMA address or bulk region offset are skipped,
+ * since the addresses mean nothing to the replaying client */
+int posixCapture_Replay(whClientContext* client,
+        const posixCaptureReplayConfig* config,
+        posixCaptureReplayStats* out_stats);
+
+#endif /* PORT_POSIX_POSIX_CAPTURE_H_ */
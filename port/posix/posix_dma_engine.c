@@ -0,0 +1,155 @@
+/*
+ * Copyright (C) 2024 wolfSSL Inc.
+ *
+ * This file is part of wolfHSM.
+ *
+ * wolfHSM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfHSM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wolfHSM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * port/posix/posix_dma_engine.c
+ *
+ * Server DMA copy engine backed by a POSIX helper thread
+ */
+
+#include <stddef.h>     /* For NULL */
+#include <string.h>     /* For memset, memcpy */
+#include <pthread.h>
+
+#include "wolfhsm/wh_error.h"
+#include "wolfhsm/wh_server.h"
+
+#include "posix_dma_engine.h"
+
+/** Local declarations */
+static void* pdeThread(void* arg);
+
+/** Local implementations */
+static void* pdeThread(void* arg)
+{
+    posixDmaEngineContext* context = arg;
+
+    (void)pthread_mutex_lock(&context->mutex);
+    while (context->stop == 0) {
+        if (context->len == 0) {
+            (void)pthread_cond_wait(&context->cond, &context->mutex);
+            continue;
+        }
+
+        /* The submitter does not touch the descriptor while busy */
+        (void)pthread_mutex_unlock(&context->mutex);
+        memcpy(context->dst, context->src, context->len);
+        (void)pthread_mutex_lock(&context->mutex);
+
+        context->len = 0;
+        context->busy = 0;
+    }
+    (void)pthread_mutex_unlock(&context->mutex);
+    return NULL;
+}
+
+
+int posixDmaEngine_Init(void* c, const void* cf)
+{
+    posixDmaEngineContext* context = c;
+
+    (void)cf;
+    if (context == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+
+    memset(context, 0, sizeof(*context));
+    if (pthread_mutex_init(&context->mutex, NULL) != 0) {
+        return WH_ERROR_ABORTED;
+    }
+    if (pthread_cond_init(&context->cond, NULL) != 0) {
+        (void)pthread_mutex_destroy(&context->mutex);
+        return WH_ERROR_ABORTED;
+    }
+    if (pthread_create(&context->thread, NULL, pdeThread, context) != 0) {
+        (void)pthread_cond_destroy(&context->cond);
+        (void)pthread_mutex_destroy(&context->mutex);
+        return WH_ERROR_ABORTED;
+    }
+    context->initialized = 1;
+    return 0;
+}
+
+int posixDmaEngine_Cleanup(void* c)
+{
+    posixDmaEngineContext* context = c;
+
+    if (context == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+    if (context->initialized != 0) {
+        (void)pthread_mutex_lock(&context->mutex);
+        context->stop = 1;
+        (void)pthread_cond_signal(&context->cond);
+        (void)pthread_mutex_unlock(&context->mutex);
+        (void)pthread_join(context->thread, NULL);
+
+        (void)pthread_cond_destroy(&context->cond);
+        (void)pthread_mutex_destroy(&context->mutex);
+        context->initialized = 0;
+    }
+    return 0;
+}
+
+int posixDmaEngine_Submit(void* c, void* dst, const void* src, size_t len)
+{
+    posixDmaEngineContext* context = c;
+    int ret = 0;
+
+    if (    (context == NULL) ||
+            (context->initialized == 0) ||
+            (dst == NULL) ||
+            (src == NULL)) {
+        return WH_ERROR_BADARGS;
+    }
+
+    if (len == 0) {
+        /* Nothing to copy */
+        return 0;
+    }
+
+    (void)pthread_mutex_lock(&context->mutex);
+    if (context->busy != 0) {
+        ret = WH_ERROR_NOTREADY;
+    } else {
+        context->dst = dst;
+        context->src = src;
+        context->len = len;
+        context->busy = 1;
+        (void)pthread_cond_signal(&context->cond);
+    }
+    (void)pthread_mutex_unlock(&context->mutex);
+    return ret;
+}
+
+int posixDmaEngine_Poll(void* c)
+{
+    posixDmaEngineContext* context = c;
+    int ret = 0;
+
+    if ((context == NULL) || (context->initialized == 0)) {
+        return WH_ERROR_BADARGS;
+    }
+
+    (void)pthread_mutex_lock(&context->mutex);
+    if (context->busy != 0) {
+        ret = WH_ERROR_NOTREADY;
+    }
+    (void)pthread_mutex_unlock(&context->mutex);
+    return ret;
+}
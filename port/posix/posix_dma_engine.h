@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) 2024 wolfSSL Inc.
+ *
+ * This file is part of wolfHSM.
+ *
+ * wolfHSM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfHSM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wolfHSM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * port/posix/posix_dma_engine.h
+ */
+
+#ifndef PORT_POSIX_POSIX_DMA_ENGINE_H_
+#define PORT_POSIX_POSIX_DMA_ENGINE_H_
+
+/*
+ * Server DMA copy engine simulated with a POSIX helper thread.  Submitted
+ * copies are performed by the thread while the server continues, so the
+ * overlap of copies with server processing can be exercised on a host.
+ */
+
+#include <stddef.h>
+#include <pthread.h>
+
+#include "wolfhsm/wh_server.h"
+
+/* In memory context structure associated with an engine instance */
+typedef struct posixDmaEngineContext_t {
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    void* dst;
+    const void* src;
+    size_t len;
+    int busy;               /* A submitted copy has not yet completed */
+    int stop;
+    int initialized;
+    uint8_t padding[4];
+} posixDmaEngineContext;
+
+int posixDmaEngine_Init(void* c, const void* cf);
+int posixDmaEngine_Cleanup(void* c);
+int posixDmaEngine_Submit(void* c, void* dst, const void* src, size_t len);
+int posixDmaEngine_Poll(void* c);
+
+#define POSIX_DMA_ENGINE_CB                         \
+{                                                   \
+    .Init = posixDmaEngine_Init,                    \
+    .Cleanup = posixDmaEngine_Cleanup,              \
+    .Submit = posixDmaEngine_Submit,                \
+    .Poll = posixDmaEngine_Poll,                    \
+}
+
+#endif /* PORT_POSIX_POSIX_DMA_ENGINE_H_ */
@@ -38,29 +38,120 @@
 enum {
     PFF_VERIFY_BUFFER_LEN = 64,
     PFF_BLANKCHECK_BUFFER_LEN = 64,
+    PFF_FILL_BUFFER_LEN = 256,
 };
 
 /** Local declarations */
 #define MAX_OFFSET(_context) (_context->partition_size * 2)
+#define MAP_BYTES(_context) ((_context->sector_count + 7) / 8)
 
 /* Helper for pwrite like memset.  Write the byte in c to filedes for size
  * bytes starting at offset */
 static ssize_t pfill(int filedes, int c, size_t size, off_t offset);
 
+/* Erased bitmap helpers */
+static int pffIsErased(posixFlashFileContext* context, uint32_t sector);
+static void pffSetErased(posixFlashFileContext* context, uint32_t sector,
+        int erased);
+static int pffSaveMap(posixFlashFileContext* context);
+
+/* Physically erase a sector marked in the bitmap so it can be programmed */
+static int pffMaterialize(posixFlashFileContext* context, uint32_t sector);
+
+/* Erase a whole sector, deferring the write when a sidecar records it */
+static int pffEraseSector(posixFlashFileContext* context, uint32_t sector);
+
 /** Local implementations */
 static ssize_t pfill(int filedes, int c, size_t size, off_t offset)
 {
-    int rc = 0;
-    uint8_t data = (uint8_t)c;
+    ssize_t rc = 0;
+    uint8_t data[PFF_FILL_BUFFER_LEN];
     size_t count = 0;
+    size_t this_size = 0;
+
+    memset(data, c, sizeof(data));
     while (count < size) {
-        rc = pwrite(filedes, &data, sizeof(data), offset + count);
-        if (rc != sizeof(data)) return rc;
-        count += sizeof(data);
+        this_size = size - count;
+        if (this_size > sizeof(data)) {
+            this_size = sizeof(data);
+        }
+        rc = pwrite(filedes, data, this_size, offset + count);
+        if (rc != (ssize_t)this_size) {
+            return (rc < 0) ? rc : (ssize_t)(count + rc);
+        }
+        count += this_size;
     }
     return size;
 }
 
+static int pffIsErased(posixFlashFileContext* context, uint32_t sector)
+{
+    return (context->erased_map[sector / 8] >> (sector % 8)) & 1;
+}
+
+static void pffSetErased(posixFlashFileContext* context, uint32_t sector,
+        int erased)
+{
+    if (erased) {
+        context->erased_map[sector / 8] |= (uint8_t)(1 << (sector % 8));
+    } else {
+        context->erased_map[sector / 8] &= (uint8_t)~(1 << (sector % 8));
+    }
+}
+
+static int pffSaveMap(posixFlashFileContext* context)
+{
+    ssize_t rc = 0;
+
+    if (context->map_fd_p1 == 0) {
+        /* Not persisted */
+        return 0;
+    }
+    rc = pwrite(context->map_fd_p1 - 1, context->erased_map,
+            MAP_BYTES(context), 0);
+    if (rc != (ssize_t)MAP_BYTES(context)) {
+        return WH_ERROR_ABORTED;
+    }
+    return 0;
+}
+
+static int pffMaterialize(posixFlashFileContext* context, uint32_t sector)
+{
+    ssize_t rc = 0;
+
+    if (context->map_fd_p1 != 0) {
+        /* Erase was deferred, so the file does not hold it yet */
+        rc = pfill( context->fd_p1 - 1,
+                    context->erased_byte,
+                    (size_t) context->sector_size,
+                    (off_t) sector * context->sector_size);
+        if (rc != (ssize_t)context->sector_size) {
+            return WH_ERROR_ABORTED;
+        }
+    }
+    /* Only clear the bit once the file contents match */
+    pffSetErased(context, sector, 0);
+    return pffSaveMap(context);
+}
+
+static int pffEraseSector(posixFlashFileContext* context, uint32_t sector)
+{
+    ssize_t rc = 0;
+
+    if (context->map_fd_p1 == 0) {
+        /* Nothing else records the erase, so write it through */
+        rc = pfill( context->fd_p1 - 1,
+                    context->erased_byte,
+                    (size_t) context->sector_size,
+                    (off_t) sector * context->sector_size);
+        if (rc != (ssize_t)context->sector_size) {
+            return WH_ERROR_ABORTED;
+        }
+    }
+    pffSetErased(context, sector, 1);
+    return 0;
+}
+
 
 int posixFlashFile_Init(   void* c,
                         const void* cf)
@@ -69,6 +160,9 @@ int posixFlashFile_Init(   void* c,
     const posixFlashFileConfig* config = cf;
     struct stat st = {0};
     off_t file_size = 0;
+    uint32_t sector_size = 0;
+    uint32_t sector = 0;
+    uint32_t fill_end = 0;
 
     int ret = 0;
     int rc = 0;
@@ -77,6 +171,18 @@ int posixFlashFile_Init(   void* c,
         return WH_ERROR_BADARGS;
     }
 
+    /* Default to erasing a whole partition at a time */
+    sector_size = config->sector_size;
+    if (sector_size == 0) {
+        sector_size = config->partition_size;
+    }
+    if (    (sector_size == 0) ||
+            ((config->partition_size * 2) % sector_size != 0) ||
+            ((config->partition_size * 2) / sector_size >
+                    POSIX_FLASH_FILE_MAX_SECTORS)) {
+        return WH_ERROR_BADARGS;
+    }
+
     /* Open the storage backend */
     rc = open(config->filename, O_RDWR|O_CREAT|O_SYNC, S_IRUSR | S_IWUSR);
     if (rc >= 0) {
@@ -84,21 +190,63 @@ int posixFlashFile_Init(   void* c,
         memset(context, 0, sizeof(*context));
         context->fd_p1 = rc + 1;
         context->partition_size = config->partition_size;
+        context->sector_size = sector_size;
+        context->sector_count = MAX_OFFSET(context) / sector_size;
         context->erased_byte = config->erased_byte;
 
-        rc = fstat(context->fd_p1 - 1, &st);
-        if (rc == 0) {
+        if (config->map_filename != NULL) {
+            /* Restore erased state.  A new sidecar starts all programmed */
+            rc = open(config->map_filename, O_RDWR|O_CREAT|O_SYNC,
+                    S_IRUSR | S_IWUSR);
+            if (rc >= 0) {
+                context->map_fd_p1 = rc + 1;
+                if (pread(context->map_fd_p1 - 1, context->erased_map,
+                        MAP_BYTES(context), 0) !=
+                        (ssize_t)MAP_BYTES(context)) {
+                    memset(context->erased_map, 0,
+                            sizeof(context->erased_map));
+                }
+            } else {
+                /* Do not leave the flash file open */
+                (void)close(context->fd_p1 - 1);
+                context->fd_p1 = 0;
+                ret = WH_ERROR_ABORTED;
+            }
+        }
+
+        if (ret == 0) {
+            rc = fstat(context->fd_p1 - 1, &st);
+        }
+        if ((ret == 0) && (rc == 0)) {
             file_size = st.st_size;
 
             if (file_size < MAX_OFFSET(context)) {
-                /* Write ERASE_BYTE to fill up to the storage size */
-                rc = pfill( context->fd_p1 - 1,
-                            context->erased_byte,
-                            MAX_OFFSET(context) - file_size,
-                            file_size);
+                /* Fill the partial sector at the end of the file, then the
+                 * new whole sectors.  With a sidecar those are only marked
+                 * erased and the file is extended without writing them */
+                sector = (file_size + sector_size - 1) / sector_size;
+                fill_end = sector * sector_size;
+                if (context->map_fd_p1 == 0) {
+                    fill_end = MAX_OFFSET(context);
+                }
+                if (fill_end > file_size) {
+                    rc = pfill( context->fd_p1 - 1,
+                                context->erased_byte,
+                                fill_end - file_size,
+                                file_size);
+                }
+                if (rc >= 0) {
+                    rc = ftruncate( context->fd_p1 - 1,
+                                    MAX_OFFSET(context));
+                }
                 if (rc < 0) {
                     /* Error while writing */
                     ret = WH_ERROR_ABORTED;
+                } else {
+                    for (; sector < context->sector_count; sector++) {
+                        pffSetErased(context, sector, 1);
+                    }
+                    ret = pffSaveMap(context);
                 }
             } else if (file_size > MAX_OFFSET(context)) {
                 rc = ftruncate( context->fd_p1 - 1,
@@ -134,6 +282,10 @@ int posixFlashFile_Cleanup(void* c)
         (void)close(context->fd_p1 - 1);
         context->fd_p1 = 0;
     }
+    if (context->map_fd_p1 > 0) {
+        (void)close(context->map_fd_p1 - 1);
+        context->map_fd_p1 = 0;
+    }
     return 0;
 }
 
@@ -177,6 +329,10 @@ int posixFlashFile_Read(   void* c,
                         uint8_t* data)
 {
     posixFlashFileContext* context = c;
+    uint32_t sector = 0;
+    uint32_t this_size = 0;
+    ssize_t rc = 0;
+
     if (    (context == NULL) ||
             (offset + size > MAX_OFFSET(context))){
         return WH_ERROR_BADARGS;
@@ -188,13 +344,29 @@ int posixFlashFile_Read(   void* c,
         return 0;
     }
 
-    ssize_t rc = pread( context->fd_p1 - 1,
+    while (size > 0) {
+        sector = offset / context->sector_size;
+        this_size = (sector + 1) * context->sector_size - offset;
+        if (this_size > size) {
+            this_size = size;
+        }
+
+        if (pffIsErased(context, sector)) {
+            /* Serve erased sectors without touching the file */
+            memset(data, context->erased_byte, this_size);
+        } else {
+            rc = pread( context->fd_p1 - 1,
                         (void*) data,
-                        (size_t) size,
+                        (size_t) this_size,
                         (off_t) offset);
-    if (rc != size) {
-        /* Error while reading */
-        return WH_ERROR_ABORTED;
+            if (rc != this_size) {
+                /* Error while reading */
+                return WH_ERROR_ABORTED;
+            }
+        }
+        offset += this_size;
+        data += this_size;
+        size -= this_size;
     }
     return 0;
 }
@@ -203,6 +375,9 @@ int posixFlashFile_Program(void* c,
         uint32_t offset, uint32_t size, const uint8_t* data)
 {
     posixFlashFileContext* context = c;
+    uint32_t sector = 0;
+    int ret = 0;
+
     if (    (context == NULL) ||
             (offset + size > MAX_OFFSET(context))){
         return WH_ERROR_BADARGS;
@@ -219,6 +394,18 @@ int posixFlashFile_Program(void* c,
         return WH_ERROR_LOCKED;
     }
 
+    /* Perform any deferred erases before writing over them */
+    for (sector = offset / context->sector_size;
+            sector <= (offset + size - 1) / context->sector_size;
+            sector++) {
+        if (pffIsErased(context, sector)) {
+            ret = pffMaterialize(context, sector);
+            if (ret != 0) {
+                return ret;
+            }
+        }
+    }
+
     ssize_t rc = pwrite(    context->fd_p1 - 1,
                             (void*) data,
                             (size_t) size,
@@ -276,6 +463,11 @@ int posixFlashFile_Erase(void* c,
         uint32_t offset, uint32_t size)
 {
     posixFlashFileContext* context = c;
+    uint32_t end_offset = offset + size;
+    uint32_t sector = 0;
+    uint32_t this_size = 0;
+    int changed = 0;
+
     if (    (context == NULL) ||
             (offset + size > MAX_OFFSET(context))){
         return WH_ERROR_BADARGS;
@@ -291,13 +483,37 @@ int posixFlashFile_Erase(void* c,
         return WH_ERROR_LOCKED;
     }
 
-    ssize_t rc = pfill( context->fd_p1 - 1,
-                        context->erased_byte,
-                        (size_t) size,
-                        (off_t) offset);
-    if (rc != size) {
-        /* Error while writing */
-        return WH_ERROR_ABORTED;
+    while (offset < end_offset) {
+        sector = offset / context->sector_size;
+        this_size = (sector + 1) * context->sector_size - offset;
+        if (this_size > end_offset - offset) {
+            this_size = end_offset - offset;
+        }
+
+        if (this_size == context->sector_size) {
+            /* Whole sector.  Already erased ones need no write */
+            if (!pffIsErased(context, sector)) {
+                int ret = pffEraseSector(context, sector);
+                if (ret != 0) {
+                    return ret;
+                }
+                changed = 1;
+            }
+        } else if (!pffIsErased(context, sector)) {
+            ssize_t rc = pfill( context->fd_p1 - 1,
+                                context->erased_byte,
+                                (size_t) this_size,
+                                (off_t) offset);
+            if (rc != this_size) {
+                /* Error while writing */
+                return WH_ERROR_ABORTED;
+            }
+        }
+        offset += this_size;
+    }
+
+    if (changed) {
+        return pffSaveMap(context);
     }
     return 0;
 }
@@ -310,6 +526,7 @@ int posixFlashFile_BlankCheck(void* c,
     uint8_t buffer[PFF_BLANKCHECK_BUFFER_LEN];
     uint8_t erased[PFF_BLANKCHECK_BUFFER_LEN];
     uint32_t end_offset = offset + size;
+    uint32_t sector_end = 0;
     uint32_t this_size = 0;
 
     if (    (context == NULL) ||
@@ -325,10 +542,21 @@ int posixFlashFile_BlankCheck(void* c,
     memset(erased, context->erased_byte, sizeof(erased));
 
     while (offset < end_offset) {
-        this_size = sizeof(buffer);
+        sector_end = (offset / context->sector_size + 1) *
+                context->sector_size;
+        if (sector_end > end_offset) {
+            sector_end = end_offset;
+        }
 
-        if (this_size > end_offset - offset) {
-            this_size = end_offset - offset;
+        if (pffIsErased(context, offset / context->sector_size)) {
+            /* Known blank.  Skip the rest of the sector */
+            offset = sector_end;
+            continue;
+        }
+
+        this_size = sizeof(buffer);
+        if (this_size > sector_end - offset) {
+            this_size = sector_end - offset;
         }
 
         ret = posixFlashFile_Read(context, offset, this_size, buffer);
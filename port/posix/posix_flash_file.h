@@ -32,23 +32,47 @@
  * updating the initial flags to update the state.
  */
 
+/*
+ * Erased state is tracked per sector in a bitmap, so reads and blank checks
+ * of an erased sector are answered without touching the file.  Without a
+ * sidecar the bitmap is only a cache: erases are written through to the
+ * file, which always holds the flash contents.  With the bitmap persisted in
+ * a sidecar file, whole-sector erases are recorded there instead and the
+ * sector is only filled with the erased byte when it is first programmed.
+ */
+
 #include "wolfhsm/wh_flash.h"
 
+/* Maximum number of erase sectors across both partitions */
+#ifndef POSIX_FLASH_FILE_MAX_SECTORS
+#define POSIX_FLASH_FILE_MAX_SECTORS 256
+#endif
+
+/* Bitmap size in bytes, rounded up to keep the context 32-bit aligned */
+#define POSIX_FLASH_FILE_MAP_LEN \
+    (((POSIX_FLASH_FILE_MAX_SECTORS + 31) / 32) * 4)
+
 /* In memory context structure associated with a flash instance */
 typedef struct posixFlashFileContext_t {
     int fd_p1;              /* fd + 1, so fd == 0 is invalid */
+    int map_fd_p1;          /* Sidecar fd + 1, 0 if not persisted */
     int unlocked;
     uint32_t partition_size;
+    uint32_t sector_size;
+    uint32_t sector_count;
     uint8_t erased_byte;
     uint8_t padding[3];
+    uint8_t erased_map[POSIX_FLASH_FILE_MAP_LEN]; /* 1 bit per sector */
 } posixFlashFileContext;
 
 /* In memory configuration structure associated with an NVM instance */
 typedef struct posixFlashFileConfig_t {
     const char* filename;       /* Null terminated */
+    const char* map_filename;   /* Optional erased bitmap sidecar, or NULL */
     uint32_t partition_size;
+    uint32_t sector_size;       /* Erase granularity. 0 for partition_size */
     uint8_t erased_byte;
-    uint8_t padding[3];
+    uint8_t padding[7];
 } posixFlashFileConfig;
 
 int posixFlashFile_Init(void* c, const void* cf);
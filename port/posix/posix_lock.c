@@ -0,0 +1,108 @@
+/*
+ * Copyright (C) 2024 wolfSSL Inc.
+ *
+ * This file is part of wolfHSM.
+ *
+ * wolfHSM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfHSM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wolfHSM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * port/posix/posix_lock.c
+ *
+ * whLock implementation on top of POSIX reader-writer locks
+ */
+
+#include <stddef.h>     /* For NULL */
+#include <string.h>     /* For memset */
+#include <pthread.h>    /* For pthread_rwlock_* */
+
+#include "wolfhsm/wh_error.h"
+#include "wolfhsm/wh_lock.h"
+
+#include "posix_lock.h"
+
+int posixLock_Init(void* c, const void* cf)
+{
+    posixLockContext* context = c;
+    const posixLockConfig* config = cf;
+
+    if (context == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+
+    memset(context, 0, sizeof(*context));
+    if (pthread_rwlock_init(&context->rwlock,
+            (config != NULL) ? config->attr : NULL) != 0) {
+        return WH_ERROR_ABORTED;
+    }
+    context->initialized = 1;
+    return 0;
+}
+
+int posixLock_Cleanup(void* c)
+{
+    posixLockContext* context = c;
+
+    if (context == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+    if (context->initialized != 0) {
+        (void)pthread_rwlock_destroy(&context->rwlock);
+        context->initialized = 0;
+    }
+    return 0;
+}
+
+int posixLock_ReadLock(void* c)
+{
+    posixLockContext* context = c;
+
+    if ((context == NULL) || (context->initialized == 0)) {
+        return WH_ERROR_BADARGS;
+    }
+    return (pthread_rwlock_rdlock(&context->rwlock) == 0) ?
+            0 : WH_ERROR_ABORTED;
+}
+
+int posixLock_ReadUnlock(void* c)
+{
+    posixLockContext* context = c;
+
+    if ((context == NULL) || (context->initialized == 0)) {
+        return WH_ERROR_BADARGS;
+    }
+    return (pthread_rwlock_unlock(&context->rwlock) == 0) ?
+            0 : WH_ERROR_ABORTED;
+}
+
+int posixLock_WriteLock(void* c)
+{
+    posixLockContext* context = c;
+
+    if ((context == NULL) || (context->initialized == 0)) {
+        return WH_ERROR_BADARGS;
+    }
+    return (pthread_rwlock_wrlock(&context->rwlock) == 0) ?
+            0 : WH_ERROR_ABORTED;
+}
+
+int posixLock_WriteUnlock(void* c)
+{
+    posixLockContext* context = c;
+
+    if ((context == NULL) || (context->initialized == 0)) {
+        return WH_ERROR_BADARGS;
+    }
+    return (pthread_rwlock_unlock(&context->rwlock) == 0) ?
+            0 : WH_ERROR_ABORTED;
+}
@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) 2024 wolfSSL Inc.
+ *
+ * This file is part of wolfHSM.
+ *
+ * wolfHSM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfHSM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wolfHSM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * port/posix/posix_lock.h
+ */
+
+#ifndef PORT_POSIX_POSIX_LOCK_H_
+#define PORT_POSIX_POSIX_LOCK_H_
+
+/*
+ * whLock implementation using a POSIX pthread_rwlock_t.  Readers share the
+ * lock and writers hold it exclusively.
+ */
+
+#include <pthread.h>
+
+#include "wolfhsm/wh_lock.h"
+
+/* In memory context structure associated with a lock instance */
+typedef struct posixLockContext_t {
+    pthread_rwlock_t rwlock;
+    int initialized;
+    uint8_t padding[4];
+} posixLockContext;
+
+/* Optional configuration.  A NULL config uses default attributes */
+typedef struct posixLockConfig_t {
+    const pthread_rwlockattr_t* attr;
+} posixLockConfig;
+
+int posixLock_Init(void* c, const void* cf);
+int posixLock_Cleanup(void* c);
+int posixLock_ReadLock(void* c);
+int posixLock_ReadUnlock(void* c);
+int posixLock_WriteLock(void* c);
+int posixLock_WriteUnlock(void* c);
+
+#define POSIX_LOCK_CB                               \
+{                                                   \
+    .Init = posixLock_Init,                         \
+    .Cleanup = posixLock_Cleanup,                   \
+    .ReadLock = posixLock_ReadLock,                 \
+    .ReadUnlock = posixLock_ReadUnlock,             \
+    .WriteLock = posixLock_WriteLock,               \
+    .WriteUnlock = posixLock_WriteUnlock,           \
+}
+
+#endif /* PORT_POSIX_POSIX_LOCK_H_ */
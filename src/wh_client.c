@@ -59,8 +59,15 @@ int wh_Client_Init(whClientContext* c, const whClientConfig* config)
     }
 
     memset(c, 0, sizeof(*c));
+    if ((config->latency != NULL) && (config->timeCb != NULL)) {
+        c->latency = config->latency;
+        c->timeCb = config->timeCb;
+        c->timeContext = config->timeContext;
+    }
 
     if (    ((rc = wh_CommClient_Init(c->comm, config->comm)) == 0) &&
+            ((c->latency == NULL) ||
+                ((rc = wh_CommClient_SetTiming(c->comm, 1)) == 0)) &&
 #ifndef WOLFHSM_NO_CRYPTO
             ((rc = wolfCrypt_Init()) == 0) &&
             ((rc = wc_CryptoCb_RegisterDevice(WOLFHSM_DEV_ID, wolfHSM_CryptoCb, c)) == 0) &&
@@ -100,15 +107,48 @@ int wh_Client_SendRequest(whClientContext* c,
     if (c == NULL) {
         return WH_ERROR_BADARGS;
     }
+    if (c->latency != NULL) {
+        c->sendStart = c->timeCb(c->timeContext);
+    }
     rc = wh_CommClient_SendRequest(c->comm, WH_COMM_MAGIC_NATIVE, kind, &req_id,
         data_size, data);
     if (rc == 0) {
         c->last_req_kind = kind;
         c->last_req_id = req_id;
+        if (c->latency != NULL) {
+            c->sendDone = c->timeCb(c->timeContext);
+        }
     }
     return rc;
 }
 
+/* Split the round trip of the request just completed into its phases */
+static void _RecordLatency(whClientContext* c, uint64_t recvStart)
+{
+    whClientLatencySample* sample = &c->lastLatency;
+    whCommTiming timing;
+    uint64_t recvDone = c->timeCb(c->timeContext);
+    uint64_t wait = recvStart - c->sendDone;
+    uint64_t server = 0;
+
+    if (wh_CommClient_GetServerTiming(c->comm, &timing) == 0) {
+        server = (uint64_t)timing.recv_to_dispatch + timing.dispatch_to_send;
+        if (server > wait) {
+            /* Clocks disagree.  Trust the client's view of the total */
+            server = wait;
+        }
+    }
+
+    sample->us[WH_CLIENT_LATENCY_SEND] =
+            (uint32_t)(c->sendDone - c->sendStart);
+    sample->us[WH_CLIENT_LATENCY_TRANSPORT] = (uint32_t)(wait - server);
+    sample->us[WH_CLIENT_LATENCY_SERVER] = (uint32_t)server;
+    sample->us[WH_CLIENT_LATENCY_RECV] =
+            (uint32_t)(recvDone - recvStart);
+    (void)wh_ClientLatency_Record(c->latency,
+            WH_MESSAGE_GROUP(c->last_req_kind), sample);
+}
+
 int wh_Client_RecvResponse(whClientContext *c,
         uint16_t *out_group, uint16_t *out_action,
         uint16_t *out_size, void* data)
@@ -118,11 +158,15 @@ int wh_Client_RecvResponse(whClientContext *c,
     uint16_t resp_kind = 0;
     uint16_t resp_id = 0;
     uint16_t resp_size = 0;
+    uint64_t recvStart = 0;
 
     if (c == NULL) {
         return WH_ERROR_BADARGS;
     }
 
+    if (c->latency != NULL) {
+        recvStart = c->timeCb(c->timeContext);
+    }
     rc = wh_CommClient_RecvResponse(c->comm,
                 &resp_magic, &resp_kind, &resp_id,
                 &resp_size, data);
@@ -144,11 +188,27 @@ int wh_Client_RecvResponse(whClientContext *c,
             if (out_size != NULL) {
                 *out_size = resp_size;
             }
+            if (c->latency != NULL) {
+                _RecordLatency(c, recvStart);
+            }
         }
     }
     return rc;
 }
 
+int wh_Client_GetLatency(whClientContext* c,
+        whClientLatencySample* out_sample)
+{
+    if ((c == NULL) || (out_sample == NULL)) {
+        return WH_ERROR_BADARGS;
+    }
+    if (c->latency == NULL) {
+        return WH_ERROR_NOTFOUND;
+    }
+    *out_sample = c->lastLatency;
+    return 0;
+}
+
 int wh_Client_CommInitRequest(whClientContext* c)
 {
     whMessageCommInitRequest msg = {0};
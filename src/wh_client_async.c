@@ -0,0 +1,129 @@
+/*
+ * Copyright (C) 2024 wolfSSL Inc.
+ *
+ * This file is part of wolfHSM.
+ *
+ * wolfHSM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfHSM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wolfHSM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * src/wh_client_async.c
+ *
+ * Single-threaded driver for many concurrent client operations
+ */
+
+#include <stdint.h>
+#include <stddef.h>     /* For NULL */
+#include <string.h>     /* For memset */
+
+#include "wolfhsm/wh_error.h"
+#include "wolfhsm/wh_client.h"
+#include "wolfhsm/wh_client_async.h"
+
+int wh_ClientAsync_Init(whClientAsync* loop, whClientAsyncWaitCb waitCb,
+        void* waitContext)
+{
+    if (loop == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+
+    memset(loop, 0, sizeof(*loop));
+    loop->waitCb = waitCb;
+    loop->waitContext = waitContext;
+    return WH_ERROR_OK;
+}
+
+int wh_ClientAsync_Start(whClientAsync* loop, whClientAsyncTask* task,
+        whClientAsyncTaskFn fn, whClientContext* client, void* context)
+{
+    if ((loop == NULL) || (task == NULL) || (fn == NULL)) {
+        return WH_ERROR_BADARGS;
+    }
+
+    task->fn = fn;
+    task->client = client;
+    task->context = context;
+    task->rc = WH_ERROR_NOTREADY;
+    task->resume = 0;
+
+    /* Push to the front.  Tasks run in no particular order */
+    task->next = loop->head;
+    loop->head = task;
+    loop->active++;
+    return WH_ERROR_OK;
+}
+
+int wh_ClientAsync_Poll(whClientAsync* loop, uint32_t* out_progress)
+{
+    whClientAsyncTask** link = NULL;
+    whClientAsyncTask* task = NULL;
+    uint32_t progress = 0;
+    uint32_t resume = 0;
+    int rc = 0;
+
+    if (loop == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+
+    link = &loop->head;
+    while (*link != NULL) {
+        task = *link;
+        resume = task->resume;
+
+        rc = task->fn(task);
+        if (rc == WH_ERROR_NOTREADY) {
+            /* Moving to a new await counts as progress */
+            if (task->resume != resume) {
+                progress++;
+            }
+            link = &task->next;
+            continue;
+        }
+
+        /* Finished.  Unlink before recording the result */
+        *link = task->next;
+        task->next = NULL;
+        task->rc = rc;
+        task->resume = WH_CLIENT_ASYNC_DONE;
+        loop->active--;
+        progress++;
+    }
+
+    if (out_progress != NULL) {
+        *out_progress = progress;
+    }
+    return (loop->head != NULL) ? WH_ERROR_NOTREADY : WH_ERROR_OK;
+}
+
+int wh_ClientAsync_Run(whClientAsync* loop)
+{
+    uint32_t progress = 0;
+    int rc = 0;
+
+    if (loop == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+
+    do {
+        rc = wh_ClientAsync_Poll(loop, &progress);
+        if (    (rc == WH_ERROR_NOTREADY) &&
+                (progress == 0) &&
+                (loop->waitCb != NULL)) {
+            if (loop->waitCb(loop->waitContext) != 0) {
+                return WH_ERROR_ABORTED;
+            }
+        }
+    } while (rc == WH_ERROR_NOTREADY);
+
+    return rc;
+}
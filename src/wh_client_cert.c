@@ -0,0 +1,225 @@
+/*
+ * Copyright (C) 2024 wolfSSL Inc.
+ *
+ * This file is part of wolfHSM.
+ *
+ * wolfHSM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfHSM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wolfHSM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * src/wh_client_cert.c
+ */
+
+/* System libraries */
+#include <stdint.h>
+#include <stdlib.h>  /* For NULL */
+#include <string.h>  /* For memset, memcpy */
+
+/* Common WolfHSM types and defines shared with the server */
+#include "wolfhsm/wh_error.h"
+#include "wolfhsm/wh_comm.h"
+
+#include "wolfhsm/wh_message.h"
+#include "wolfhsm/wh_message_cert.h"
+
+#include "wolfhsm/wh_client.h"
+#include "wolfhsm/wh_client_cert.h"
+
+/* Receive and validate a VerifyResponse for the given action */
+static int _CertVerifyResponse(whClientContext* c, uint16_t action,
+        int32_t* out_rc, uint16_t* out_depth)
+{
+    whMessageCert_VerifyResponse msg = {0};
+    int rc = 0;
+    uint16_t resp_group = 0;
+    uint16_t resp_action = 0;
+    uint16_t resp_size = 0;
+
+    if (c == NULL){
+        return WH_ERROR_BADARGS;
+    }
+
+    rc = wh_Client_RecvResponse(c,
+            &resp_group, &resp_action,
+            &resp_size, &msg);
+    if (rc == 0) {
+        /* Validate response */
+        if (    (resp_group != WH_MESSAGE_GROUP_CERT) ||
+                (resp_action != action) ||
+                (resp_size != sizeof(msg)) ){
+            /* Invalid message */
+            rc = WH_ERROR_ABORTED;
+        } else {
+            /* Valid message */
+            if (out_rc != NULL) {
+                *out_rc = msg.rc;
+            }
+            if (out_depth != NULL) {
+                *out_depth = msg.depth;
+            }
+        }
+    }
+    return rc;
+}
+
+/** Cert Verify */
+int wh_Client_CertVerifyRequest(whClientContext* c, const uint8_t* chain,
+        uint16_t chain_len, whNvmId trusted_id)
+{
+    uint8_t buffer[WH_COMM_DATA_LEN] = {0};
+    whMessageCert_VerifyRequest* msg = (whMessageCert_VerifyRequest*)buffer;
+    uint16_t hdr_len = sizeof(*msg);
+    uint8_t* payload = buffer + hdr_len;
+
+    if (    (c == NULL) ||
+            (chain == NULL) ||
+            (chain_len == 0) ||
+            (chain_len > WH_MESSAGE_CERT_MAX_CHAIN_LEN) ) {
+        return WH_ERROR_BADARGS;
+    }
+
+    msg->trusted_id = trusted_id;
+    msg->chain_len = chain_len;
+    memcpy(payload, chain, chain_len);
+
+    return wh_Client_SendRequest(c,
+            WH_MESSAGE_GROUP_CERT, WH_MESSAGE_CERT_ACTION_VERIFY,
+            hdr_len + chain_len, buffer);
+}
+
+int wh_Client_CertVerifyResponse(whClientContext* c, int32_t* out_rc,
+        uint16_t* out_depth)
+{
+    return _CertVerifyResponse(c, WH_MESSAGE_CERT_ACTION_VERIFY, out_rc,
+            out_depth);
+}
+
+int wh_Client_CertVerify(whClientContext* c, const uint8_t* chain,
+        uint16_t chain_len, whNvmId trusted_id, int32_t* out_rc,
+        uint16_t* out_depth)
+{
+    int rc = 0;
+
+    if (c == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+
+    do {
+        rc = wh_Client_CertVerifyRequest(c, chain, chain_len, trusted_id);
+    } while (rc == WH_ERROR_NOTREADY);
+
+    if (rc == 0) {
+        do {
+            rc = wh_Client_CertVerifyResponse(c, out_rc, out_depth);
+        } while (rc == WH_ERROR_NOTREADY);
+    }
+    return rc;
+}
+
+/** Cert VerifyDma32 */
+int wh_Client_CertVerifyDma32Request(whClientContext* c,
+        uint32_t chain_hostaddr, uint32_t chain_len, whNvmId trusted_id)
+{
+    whMessageCert_VerifyDma32Request msg = {0};
+
+    if (c == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+
+    msg.chain_hostaddr = chain_hostaddr;
+    msg.chain_len = chain_len;
+    msg.trusted_id = trusted_id;
+
+    return wh_Client_SendRequest(c,
+            WH_MESSAGE_GROUP_CERT, WH_MESSAGE_CERT_ACTION_VERIFYDMA32,
+            sizeof(msg), &msg);
+}
+
+int wh_Client_CertVerifyDma32Response(whClientContext* c, int32_t* out_rc,
+        uint16_t* out_depth)
+{
+    return _CertVerifyResponse(c, WH_MESSAGE_CERT_ACTION_VERIFYDMA32, out_rc,
+            out_depth);
+}
+
+int wh_Client_CertVerifyDma32(whClientContext* c, uint32_t chain_hostaddr,
+        uint32_t chain_len, whNvmId trusted_id, int32_t* out_rc,
+        uint16_t* out_depth)
+{
+    int rc = 0;
+
+    if (c == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+
+    do {
+        rc = wh_Client_CertVerifyDma32Request(c, chain_hostaddr, chain_len,
+                trusted_id);
+    } while (rc == WH_ERROR_NOTREADY);
+
+    if (rc == 0) {
+        do {
+            rc = wh_Client_CertVerifyDma32Response(c, out_rc, out_depth);
+        } while (rc == WH_ERROR_NOTREADY);
+    }
+    return rc;
+}
+
+/** Cert VerifyDma64 */
+int wh_Client_CertVerifyDma64Request(whClientContext* c,
+        uint64_t chain_hostaddr, uint32_t chain_len, whNvmId trusted_id)
+{
+    whMessageCert_VerifyDma64Request msg = {0};
+
+    if (c == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+
+    msg.chain_hostaddr = chain_hostaddr;
+    msg.chain_len = chain_len;
+    msg.trusted_id = trusted_id;
+
+    return wh_Client_SendRequest(c,
+            WH_MESSAGE_GROUP_CERT, WH_MESSAGE_CERT_ACTION_VERIFYDMA64,
+            sizeof(msg), &msg);
+}
+
+int wh_Client_CertVerifyDma64Response(whClientContext* c, int32_t* out_rc,
+        uint16_t* out_depth)
+{
+    return _CertVerifyResponse(c, WH_MESSAGE_CERT_ACTION_VERIFYDMA64, out_rc,
+            out_depth);
+}
+
+int wh_Client_CertVerifyDma64(whClientContext* c, uint64_t chain_hostaddr,
+        uint32_t chain_len, whNvmId trusted_id, int32_t* out_rc,
+        uint16_t* out_depth)
+{
+    int rc = 0;
+
+    if (c == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+
+    do {
+        rc = wh_Client_CertVerifyDma64Request(c, chain_hostaddr, chain_len,
+                trusted_id);
+    } while (rc == WH_ERROR_NOTREADY);
+
+    if (rc == 0) {
+        do {
+            rc = wh_Client_CertVerifyDma64Response(c, out_rc, out_depth);
+        } while (rc == WH_ERROR_NOTREADY);
+    }
+    return rc;
+}
@@ -0,0 +1,485 @@
+/*
+ * Copyright (C) 2024 wolfSSL Inc.
+ *
+ * This file is part of wolfHSM.
+ *
+ * wolfHSM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfHSM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wolfHSM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * src/wh_client_chacha.c
+ */
+
+/* System libraries */
+#include <stdint.h>
+#include <stdlib.h>  /* For NULL */
+#include <string.h>  /* For memset, memcpy */
+
+/* Common WolfHSM types and defines shared with the server */
+#include "wolfhsm/wh_error.h"
+#include "wolfhsm/wh_comm.h"
+
+#include "wolfhsm/wh_message.h"
+#include "wolfhsm/wh_message_chacha.h"
+
+#include "wolfhsm/wh_client.h"
+#include "wolfhsm/wh_client_chacha.h"
+
+/* Final and CryptDma both answer with a TagResponse */
+static int _ChaChaTagResponse(whClientContext* c, uint16_t action,
+        int32_t* out_rc, uint8_t* tag)
+{
+    whMessageChaCha_TagResponse msg = {0};
+    int rc = 0;
+    uint16_t resp_group = 0;
+    uint16_t resp_action = 0;
+    uint16_t resp_size = 0;
+
+    if (c == NULL){
+        return WH_ERROR_BADARGS;
+    }
+
+    rc = wh_Client_RecvResponse(c,
+            &resp_group, &resp_action,
+            &resp_size, &msg);
+    if (rc == 0) {
+        /* Validate response */
+        if (    (resp_group != WH_MESSAGE_GROUP_CHACHA) ||
+                (resp_action != action) ||
+                (resp_size != sizeof(msg)) ){
+            /* Invalid message */
+            rc = WH_ERROR_ABORTED;
+        } else {
+            /* Valid message */
+            if (out_rc != NULL) {
+                *out_rc = msg.rc;
+            }
+            if (tag != NULL) {
+                memcpy(tag, msg.tag, sizeof(msg.tag));
+            }
+        }
+    }
+    return rc;
+}
+
+/** ChaCha Crypt */
+int wh_Client_ChaChaCryptRequest(whClientContext* c, whKeyId key_id,
+        uint8_t enc, const uint8_t* iv, const uint8_t* aad, uint16_t aad_len,
+        const uint8_t* in, uint16_t in_len, const uint8_t* tag)
+{
+    uint8_t buffer[WH_COMM_DATA_LEN] = {0};
+    whMessageChaCha_CryptRequest* msg =
+            (whMessageChaCha_CryptRequest*)buffer;
+    uint16_t hdr_len = sizeof(*msg);
+    uint8_t* payload = buffer + hdr_len;
+
+    if (    (c == NULL) ||
+            (iv == NULL) ||
+            ((aad == NULL) && (aad_len != 0)) ||
+            ((in == NULL) && (in_len != 0)) ||
+            ((enc == 0) && (tag == NULL)) ||
+            ((uint32_t)aad_len + in_len > WH_MESSAGE_CHACHA_MAX_INLINE_LEN) ) {
+        return WH_ERROR_BADARGS;
+    }
+
+    msg->key_id = key_id;
+    msg->aad_len = aad_len;
+    msg->data_len = in_len;
+    msg->enc = (enc != 0);
+    memcpy(msg->iv, iv, sizeof(msg->iv));
+    if (tag != NULL) {
+        memcpy(msg->tag, tag, sizeof(msg->tag));
+    }
+    if (aad_len > 0) {
+        memcpy(payload, aad, aad_len);
+    }
+    if (in_len > 0) {
+        memcpy(payload + aad_len, in, in_len);
+    }
+
+    return wh_Client_SendRequest(c,
+            WH_MESSAGE_GROUP_CHACHA, WH_MESSAGE_CHACHA_ACTION_CRYPT,
+            hdr_len + aad_len + in_len, buffer);
+}
+
+int wh_Client_ChaChaCryptResponse(whClientContext* c, int32_t* out_rc,
+        uint8_t* out, uint16_t* inout_out_len, uint8_t* tag)
+{
+    uint8_t buffer[WH_COMM_DATA_LEN] = {0};
+    whMessageChaCha_CryptResponse* msg =
+            (whMessageChaCha_CryptResponse*)buffer;
+    uint16_t hdr_len = sizeof(*msg);
+    uint8_t* payload = buffer + hdr_len;
+    int rc = 0;
+    uint16_t resp_group = 0;
+    uint16_t resp_action = 0;
+    uint16_t resp_size = 0;
+
+    if (    (c == NULL) ||
+            (inout_out_len == NULL) ||
+            ((out == NULL) && (*inout_out_len != 0)) ) {
+        return WH_ERROR_BADARGS;
+    }
+
+    rc = wh_Client_RecvResponse(c,
+            &resp_group, &resp_action,
+            &resp_size, buffer);
+    if (rc == 0) {
+        /* Validate response */
+        if (    (resp_group != WH_MESSAGE_GROUP_CHACHA) ||
+                (resp_action != WH_MESSAGE_CHACHA_ACTION_CRYPT) ||
+                (resp_size < hdr_len) ||
+                (resp_size != hdr_len + msg->data_len) ){
+            /* Invalid message */
+            rc = WH_ERROR_ABORTED;
+        } else if (msg->data_len > *inout_out_len) {
+            /* Output does not fit */
+            rc = WH_ERROR_ABORTED;
+        } else {
+            /* Valid message */
+            if (out_rc != NULL) {
+                *out_rc = msg->rc;
+            }
+            if (msg->data_len > 0) {
+                memcpy(out, payload, msg->data_len);
+            }
+            *inout_out_len = msg->data_len;
+            if (tag != NULL) {
+                memcpy(tag, msg->tag, sizeof(msg->tag));
+            }
+        }
+    }
+    return rc;
+}
+
+int wh_Client_ChaChaCrypt(whClientContext* c, whKeyId key_id, uint8_t enc,
+        const uint8_t* iv, const uint8_t* aad, uint16_t aad_len,
+        const uint8_t* in, uint16_t in_len, uint8_t* out, uint8_t* tag,
+        int32_t* out_rc)
+{
+    int rc = 0;
+    uint16_t out_len = in_len;
+
+    if (    (c == NULL) ||
+            (tag == NULL) ) {
+        return WH_ERROR_BADARGS;
+    }
+
+    do {
+        rc = wh_Client_ChaChaCryptRequest(c, key_id, enc, iv, aad, aad_len,
+                in, in_len, tag);
+    } while (rc == WH_ERROR_NOTREADY);
+
+    if (rc == 0) {
+        do {
+            rc = wh_Client_ChaChaCryptResponse(c, out_rc, out, &out_len,
+                    (enc != 0) ? tag : NULL);
+        } while (rc == WH_ERROR_NOTREADY);
+    }
+    return rc;
+}
+
+/** ChaCha Init */
+int wh_Client_ChaChaInitRequest(whClientContext* c, whKeyId key_id,
+        uint8_t enc, const uint8_t* iv)
+{
+    whMessageChaCha_InitRequest msg = {0};
+
+    if (    (c == NULL) ||
+            (iv == NULL) ) {
+        return WH_ERROR_BADARGS;
+    }
+
+    msg.key_id = key_id;
+    msg.enc = (enc != 0);
+    memcpy(msg.iv, iv, sizeof(msg.iv));
+
+    return wh_Client_SendRequest(c,
+            WH_MESSAGE_GROUP_CHACHA, WH_MESSAGE_CHACHA_ACTION_INIT,
+            sizeof(msg), &msg);
+}
+
+int wh_Client_ChaChaInitResponse(whClientContext* c, int32_t* out_rc,
+        uint16_t* out_session)
+{
+    whMessageChaCha_InitResponse msg = {0};
+    int rc = 0;
+    uint16_t resp_group = 0;
+    uint16_t resp_action = 0;
+    uint16_t resp_size = 0;
+
+    if (c == NULL){
+        return WH_ERROR_BADARGS;
+    }
+
+    rc = wh_Client_RecvResponse(c,
+            &resp_group, &resp_action,
+            &resp_size, &msg);
+    if (rc == 0) {
+        /* Validate response */
+        if (    (resp_group != WH_MESSAGE_GROUP_CHACHA) ||
+                (resp_action != WH_MESSAGE_CHACHA_ACTION_INIT) ||
+                (resp_size != sizeof(msg)) ){
+            /* Invalid message */
+            rc = WH_ERROR_ABORTED;
+        } else {
+            /* Valid message */
+            if (out_rc != NULL) {
+                *out_rc = msg.rc;
+            }
+            if (out_session != NULL) {
+                *out_session = msg.session;
+            }
+        }
+    }
+    return rc;
+}
+
+int wh_Client_ChaChaInit(whClientContext* c, whKeyId key_id, uint8_t enc,
+        const uint8_t* iv, int32_t* out_rc, uint16_t* out_session)
+{
+    int rc = 0;
+
+    if (c == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+
+    do {
+        rc = wh_Client_ChaChaInitRequest(c, key_id, enc, iv);
+    } while (rc == WH_ERROR_NOTREADY);
+
+    if (rc == 0) {
+        do {
+            rc = wh_Client_ChaChaInitResponse(c, out_rc, out_session);
+        } while (rc == WH_ERROR_NOTREADY);
+    }
+    return rc;
+}
+
+/** ChaCha Update */
+int wh_Client_ChaChaUpdateRequest(whClientContext* c, uint16_t session,
+        const uint8_t* aad, uint16_t aad_len, const uint8_t* in,
+        uint16_t in_len)
+{
+    uint8_t buffer[WH_COMM_DATA_LEN] = {0};
+    whMessageChaCha_UpdateRequest* msg =
+            (whMessageChaCha_UpdateRequest*)buffer;
+    uint16_t hdr_len = sizeof(*msg);
+    uint8_t* payload = buffer + hdr_len;
+
+    if (    (c == NULL) ||
+            ((aad == NULL) && (aad_len != 0)) ||
+            ((in == NULL) && (in_len != 0)) ||
+            ((uint32_t)aad_len + in_len > WH_MESSAGE_CHACHA_MAX_INLINE_LEN) ) {
+        return WH_ERROR_BADARGS;
+    }
+
+    msg->session = session;
+    msg->aad_len = aad_len;
+    msg->data_len = in_len;
+    if (aad_len > 0) {
+        memcpy(payload, aad, aad_len);
+    }
+    if (in_len > 0) {
+        memcpy(payload + aad_len, in, in_len);
+    }
+
+    return wh_Client_SendRequest(c,
+            WH_MESSAGE_GROUP_CHACHA, WH_MESSAGE_CHACHA_ACTION_UPDATE,
+            hdr_len + aad_len + in_len, buffer);
+}
+
+int wh_Client_ChaChaUpdateResponse(whClientContext* c, int32_t* out_rc,
+        uint8_t* out, uint16_t* inout_out_len)
+{
+    uint8_t buffer[WH_COMM_DATA_LEN] = {0};
+    whMessageChaCha_UpdateResponse* msg =
+            (whMessageChaCha_UpdateResponse*)buffer;
+    uint16_t hdr_len = sizeof(*msg);
+    uint8_t* payload = buffer + hdr_len;
+    int rc = 0;
+    uint16_t resp_group = 0;
+    uint16_t resp_action = 0;
+    uint16_t resp_size = 0;
+
+    if (    (c == NULL) ||
+            (inout_out_len == NULL) ||
+            ((out == NULL) && (*inout_out_len != 0)) ) {
+        return WH_ERROR_BADARGS;
+    }
+
+    rc = wh_Client_RecvResponse(c,
+            &resp_group, &resp_action,
+            &resp_size, buffer);
+    if (rc == 0) {
+        /* Validate response */
+        if (    (resp_group != WH_MESSAGE_GROUP_CHACHA) ||
+                (resp_action != WH_MESSAGE_CHACHA_ACTION_UPDATE) ||
+                (resp_size < hdr_len) ||
+                (resp_size != hdr_len + msg->data_len) ){
+            /* Invalid message */
+            rc = WH_ERROR_ABORTED;
+        } else if (msg->data_len > *inout_out_len) {
+            /* Output does not fit */
+            rc = WH_ERROR_ABORTED;
+        } else {
+            /* Valid message */
+            if (out_rc != NULL) {
+                *out_rc = msg->rc;
+            }
+            if (msg->data_len > 0) {
+                memcpy(out, payload, msg->data_len);
+            }
+            *inout_out_len = msg->data_len;
+        }
+    }
+    return rc;
+}
+
+int wh_Client_ChaChaUpdate(whClientContext* c, uint16_t session,
+        const uint8_t* aad, uint16_t aad_len, const uint8_t* in,
+        uint16_t in_len, uint8_t* out, int32_t* out_rc)
+{
+    int rc = 0;
+    uint16_t out_len = in_len;
+
+    if (c == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+
+    do {
+        rc = wh_Client_ChaChaUpdateRequest(c, session, aad, aad_len, in,
+                in_len);
+    } while (rc == WH_ERROR_NOTREADY);
+
+    if (rc == 0) {
+        do {
+            rc = wh_Client_ChaChaUpdateResponse(c, out_rc, out, &out_len);
+        } while (rc == WH_ERROR_NOTREADY);
+    }
+    return rc;
+}
+
+/** ChaCha Final */
+int wh_Client_ChaChaFinalRequest(whClientContext* c, uint16_t session,
+        const uint8_t* tag)
+{
+    whMessageChaCha_FinalRequest msg = {0};
+
+    if (c == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+
+    msg.session = session;
+    if (tag != NULL) {
+        memcpy(msg.tag, tag, sizeof(msg.tag));
+    }
+
+    return wh_Client_SendRequest(c,
+            WH_MESSAGE_GROUP_CHACHA, WH_MESSAGE_CHACHA_ACTION_FINAL,
+            sizeof(msg), &msg);
+}
+
+int wh_Client_ChaChaFinalResponse(whClientContext* c, int32_t* out_rc,
+        uint8_t* tag)
+{
+    return _ChaChaTagResponse(c, WH_MESSAGE_CHACHA_ACTION_FINAL, out_rc, tag);
+}
+
+int wh_Client_ChaChaFinal(whClientContext* c, uint16_t session, uint8_t enc,
+        uint8_t* tag, int32_t* out_rc)
+{
+    int rc = 0;
+
+    if (    (c == NULL) ||
+            (tag == NULL) ) {
+        return WH_ERROR_BADARGS;
+    }
+
+    do {
+        rc = wh_Client_ChaChaFinalRequest(c, session,
+                (enc != 0) ? NULL : tag);
+    } while (rc == WH_ERROR_NOTREADY);
+
+    if (rc == 0) {
+        do {
+            rc = wh_Client_ChaChaFinalResponse(c, out_rc,
+                    (enc != 0) ? tag : NULL);
+        } while (rc == WH_ERROR_NOTREADY);
+    }
+    return rc;
+}
+
+/** ChaCha CryptDma */
+int wh_Client_ChaChaCryptDmaRequest(whClientContext* c, whKeyId key_id,
+        uint8_t enc, const uint8_t* iv, uint64_t aad_hostaddr,
+        uint32_t aad_len, uint64_t in_hostaddr, uint64_t out_hostaddr,
+        uint32_t len, const uint8_t* tag)
+{
+    whMessageChaCha_CryptDmaRequest msg = {0};
+
+    if (    (c == NULL) ||
+            (iv == NULL) ||
+            ((enc == 0) && (tag == NULL)) ) {
+        return WH_ERROR_BADARGS;
+    }
+
+    msg.aad_hostaddr = aad_hostaddr;
+    msg.in_hostaddr = in_hostaddr;
+    msg.out_hostaddr = out_hostaddr;
+    msg.aad_len = aad_len;
+    msg.data_len = len;
+    msg.key_id = key_id;
+    msg.enc = (enc != 0);
+    memcpy(msg.iv, iv, sizeof(msg.iv));
+    if (tag != NULL) {
+        memcpy(msg.tag, tag, sizeof(msg.tag));
+    }
+
+    return wh_Client_SendRequest(c,
+            WH_MESSAGE_GROUP_CHACHA, WH_MESSAGE_CHACHA_ACTION_CRYPTDMA,
+            sizeof(msg), &msg);
+}
+
+int wh_Client_ChaChaCryptDmaResponse(whClientContext* c, int32_t* out_rc,
+        uint8_t* tag)
+{
+    return _ChaChaTagResponse(c, WH_MESSAGE_CHACHA_ACTION_CRYPTDMA, out_rc,
+            tag);
+}
+
+int wh_Client_ChaChaCryptDma(whClientContext* c, whKeyId key_id,
+        uint8_t enc, const uint8_t* iv, uint64_t aad_hostaddr,
+        uint32_t aad_len, uint64_t in_hostaddr, uint64_t out_hostaddr,
+        uint32_t len, uint8_t* tag, int32_t* out_rc)
+{
+    int rc = 0;
+
+    if (    (c == NULL) ||
+            (tag == NULL) ) {
+        return WH_ERROR_BADARGS;
+    }
+
+    do {
+        rc = wh_Client_ChaChaCryptDmaRequest(c, key_id, enc, iv,
+                aad_hostaddr, aad_len, in_hostaddr, out_hostaddr, len, tag);
+    } while (rc == WH_ERROR_NOTREADY);
+
+    if (rc == 0) {
+        do {
+            rc = wh_Client_ChaChaCryptDmaResponse(c, out_rc,
+                    (enc != 0) ? tag : NULL);
+        } while (rc == WH_ERROR_NOTREADY);
+    }
+    return rc;
+}
@@ -0,0 +1,287 @@
+/*
+ * Copyright (C) 2024 wolfSSL Inc.
+ *
+ * This file is part of wolfHSM.
+ *
+ * wolfHSM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfHSM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wolfHSM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * src/wh_client_image.c
+ */
+
+/* System libraries */
+#include <stdint.h>
+#include <stdlib.h>  /* For NULL */
+#include <string.h>  /* For memset, memcpy */
+
+/* Common WolfHSM types and defines shared with the server */
+#include "wolfhsm/wh_error.h"
+#include "wolfhsm/wh_comm.h"
+
+#include "wolfhsm/wh_message.h"
+#include "wolfhsm/wh_message_image.h"
+
+#include "wolfhsm/wh_client.h"
+#include "wolfhsm/wh_client_image.h"
+
+/* Receive and validate a VerifyResponse for the given action */
+static int _ImageVerifyResponse(whClientContext* c, uint16_t action,
+        int32_t* out_rc, uint32_t* out_offset, uint8_t* out_done,
+        uint8_t* out_verified, uint8_t* digest, uint16_t* inout_digest_len)
+{
+    whMessageImage_VerifyResponse msg = {0};
+    int rc = 0;
+    uint16_t resp_group = 0;
+    uint16_t resp_action = 0;
+    uint16_t resp_size = 0;
+
+    if (c == NULL){
+        return WH_ERROR_BADARGS;
+    }
+
+    rc = wh_Client_RecvResponse(c,
+            &resp_group, &resp_action,
+            &resp_size, &msg);
+    if (rc == 0) {
+        /* Validate response */
+        if (    (resp_group != WH_MESSAGE_GROUP_IMAGE) ||
+                (resp_action != action) ||
+                (resp_size != sizeof(msg)) ||
+                (msg.digest_len > sizeof(msg.digest)) ){
+            /* Invalid message */
+            rc = WH_ERROR_ABORTED;
+        } else {
+            /* Valid message */
+            if (out_rc != NULL) {
+                *out_rc = msg.rc;
+            }
+            if (out_offset != NULL) {
+                *out_offset = msg.offset;
+            }
+            if (out_done != NULL) {
+                *out_done = msg.done;
+            }
+            if (out_verified != NULL) {
+                *out_verified = msg.verified;
+            }
+            if ((inout_digest_len != NULL) && (msg.done != 0)) {
+                if ((digest != NULL) && (msg.digest_len > *inout_digest_len)) {
+                    rc = WH_ERROR_NOSPACE;
+                } else {
+                    if (digest != NULL) {
+                        memcpy(digest, msg.digest, msg.digest_len);
+                    }
+                    *inout_digest_len = msg.digest_len;
+                }
+            }
+        }
+    }
+    return rc;
+}
+
+/* Send a VerifyDma32/64 request header followed by the signature */
+static int _ImageVerifyRequest(whClientContext* c, uint16_t action,
+        void* hdr, uint16_t hdr_len, const uint8_t* sig, uint16_t sig_len)
+{
+    uint8_t buffer[WH_COMM_DATA_LEN] = {0};
+
+    if (    (c == NULL) ||
+            (sig == NULL) ||
+            (sig_len == 0) ||
+            (sig_len > WH_MESSAGE_IMAGE_MAX_SIG_LEN) ) {
+        return WH_ERROR_BADARGS;
+    }
+
+    memcpy(buffer, hdr, hdr_len);
+    memcpy(buffer + hdr_len, sig, sig_len);
+
+    return wh_Client_SendRequest(c,
+            WH_MESSAGE_GROUP_IMAGE, action,
+            hdr_len + sig_len, buffer);
+}
+
+/* Issue Continue requests until the image is fully hashed */
+static int _ImageVerifyRemaining(whClientContext* c, uint32_t slice_len,
+        int32_t* out_rc, uint8_t done, uint8_t* out_verified, uint8_t* digest,
+        uint16_t* inout_digest_len)
+{
+    int rc = 0;
+
+    while ((rc == 0) && (*out_rc == 0) && (done == 0)) {
+        do {
+            rc = wh_Client_ImageContinueRequest(c, slice_len);
+        } while (rc == WH_ERROR_NOTREADY);
+
+        if (rc == 0) {
+            do {
+                rc = wh_Client_ImageContinueResponse(c, out_rc, NULL, &done,
+                        out_verified, digest, inout_digest_len);
+            } while (rc == WH_ERROR_NOTREADY);
+        }
+    }
+    return rc;
+}
+
+/** Image VerifyDma32 */
+int wh_Client_ImageVerifyDma32Request(whClientContext* c,
+        uint32_t image_hostaddr, uint32_t image_len, uint32_t slice_len,
+        whKeyId key_id, uint16_t curve_id, uint8_t hash_type,
+        const uint8_t* sig, uint16_t sig_len)
+{
+    whMessageImage_VerifyDma32Request msg = {0};
+
+    msg.image_hostaddr = image_hostaddr;
+    msg.image_len = image_len;
+    msg.slice_len = slice_len;
+    msg.key_id = key_id;
+    msg.curve_id = curve_id;
+    msg.sig_len = sig_len;
+    msg.hash_type = hash_type;
+
+    return _ImageVerifyRequest(c, WH_MESSAGE_IMAGE_ACTION_VERIFYDMA32,
+            &msg, sizeof(msg), sig, sig_len);
+}
+
+int wh_Client_ImageVerifyDma32Response(whClientContext* c, int32_t* out_rc,
+        uint32_t* out_offset, uint8_t* out_done, uint8_t* out_verified,
+        uint8_t* digest, uint16_t* inout_digest_len)
+{
+    return _ImageVerifyResponse(c, WH_MESSAGE_IMAGE_ACTION_VERIFYDMA32,
+            out_rc, out_offset, out_done, out_verified, digest,
+            inout_digest_len);
+}
+
+int wh_Client_ImageVerifyDma32(whClientContext* c, uint32_t image_hostaddr,
+        uint32_t image_len, uint32_t slice_len, whKeyId key_id,
+        uint16_t curve_id, uint8_t hash_type, const uint8_t* sig,
+        uint16_t sig_len, int32_t* out_rc, uint8_t* out_verified,
+        uint8_t* digest, uint16_t* inout_digest_len)
+{
+    int rc = 0;
+    int32_t server_rc = 0;
+    uint8_t done = 0;
+
+    if (c == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+
+    do {
+        rc = wh_Client_ImageVerifyDma32Request(c, image_hostaddr, image_len,
+                slice_len, key_id, curve_id, hash_type, sig, sig_len);
+    } while (rc == WH_ERROR_NOTREADY);
+
+    if (rc == 0) {
+        do {
+            rc = wh_Client_ImageVerifyDma32Response(c, &server_rc, NULL,
+                    &done, out_verified, digest, inout_digest_len);
+        } while (rc == WH_ERROR_NOTREADY);
+    }
+    if (rc == 0) {
+        rc = _ImageVerifyRemaining(c, slice_len, &server_rc, done,
+                out_verified, digest, inout_digest_len);
+    }
+    if (out_rc != NULL) {
+        *out_rc = server_rc;
+    }
+    return rc;
+}
+
+/** Image VerifyDma64 */
+int wh_Client_ImageVerifyDma64Request(whClientContext* c,
+        uint64_t image_hostaddr, uint32_t image_len, uint32_t slice_len,
+        whKeyId key_id, uint16_t curve_id, uint8_t hash_type,
+        const uint8_t* sig, uint16_t sig_len)
+{
+    whMessageImage_VerifyDma64Request msg = {0};
+
+    msg.image_hostaddr = image_hostaddr;
+    msg.image_len = image_len;
+    msg.slice_len = slice_len;
+    msg.key_id = key_id;
+    msg.curve_id = curve_id;
+    msg.sig_len = sig_len;
+    msg.hash_type = hash_type;
+
+    return _ImageVerifyRequest(c, WH_MESSAGE_IMAGE_ACTION_VERIFYDMA64,
+            &msg, sizeof(msg), sig, sig_len);
+}
+
+int wh_Client_ImageVerifyDma64Response(whClientContext* c, int32_t* out_rc,
+        uint32_t* out_offset, uint8_t* out_done, uint8_t* out_verified,
+        uint8_t* digest, uint16_t* inout_digest_len)
+{
+    return _ImageVerifyResponse(c, WH_MESSAGE_IMAGE_ACTION_VERIFYDMA64,
+            out_rc, out_offset, out_done, out_verified, digest,
+            inout_digest_len);
+}
+
+int wh_Client_ImageVerifyDma64(whClientContext* c, uint64_t image_hostaddr,
+        uint32_t image_len, uint32_t slice_len, whKeyId key_id,
+        uint16_t curve_id, uint8_t hash_type, const uint8_t* sig,
+        uint16_t sig_len, int32_t* out_rc, uint8_t* out_verified,
+        uint8_t* digest, uint16_t* inout_digest_len)
+{
+    int rc = 0;
+    int32_t server_rc = 0;
+    uint8_t done = 0;
+
+    if (c == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+
+    do {
+        rc = wh_Client_ImageVerifyDma64Request(c, image_hostaddr, image_len,
+                slice_len, key_id, curve_id, hash_type, sig, sig_len);
+    } while (rc == WH_ERROR_NOTREADY);
+
+    if (rc == 0) {
+        do {
+            rc = wh_Client_ImageVerifyDma64Response(c, &server_rc, NULL,
+                    &done, out_verified, digest, inout_digest_len);
+        } while (rc == WH_ERROR_NOTREADY);
+    }
+    if (rc == 0) {
+        rc = _ImageVerifyRemaining(c, slice_len, &server_rc, done,
+                out_verified, digest, inout_digest_len);
+    }
+    if (out_rc != NULL) {
+        *out_rc = server_rc;
+    }
+    return rc;
+}
+
+/** Image Continue */
+int wh_Client_ImageContinueRequest(whClientContext* c, uint32_t slice_len)
+{
+    whMessageImage_ContinueRequest msg = {0};
+
+    if (c == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+
+    msg.slice_len = slice_len;
+
+    return wh_Client_SendRequest(c,
+            WH_MESSAGE_GROUP_IMAGE, WH_MESSAGE_IMAGE_ACTION_CONTINUE,
+            sizeof(msg), &msg);
+}
+
+int wh_Client_ImageContinueResponse(whClientContext* c, int32_t* out_rc,
+        uint32_t* out_offset, uint8_t* out_done, uint8_t* out_verified,
+        uint8_t* digest, uint16_t* inout_digest_len)
+{
+    return _ImageVerifyResponse(c, WH_MESSAGE_IMAGE_ACTION_CONTINUE,
+            out_rc, out_offset, out_done, out_verified, digest,
+            inout_digest_len);
+}
@@ -0,0 +1,220 @@
+/*
+ * Copyright (C) 2024 wolfSSL Inc.
+ *
+ * This file is part of wolfHSM.
+ *
+ * wolfHSM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfHSM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wolfHSM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * src/wh_client_keywrap.c
+ */
+
+/* System libraries */
+#include <stdint.h>
+#include <stdlib.h>  /* For NULL */
+#include <string.h>  /* For memset, memcpy */
+
+/* Common WolfHSM types and defines shared with the server */
+#include "wolfhsm/wh_error.h"
+#include "wolfhsm/wh_comm.h"
+
+#include "wolfhsm/wh_message.h"
+#include "wolfhsm/wh_message_keywrap.h"
+
+#include "wolfhsm/wh_client.h"
+#include "wolfhsm/wh_client_keywrap.h"
+
+/** KeyWrap Export */
+int wh_Client_KeyWrapExportRequest(whClientContext* c, whKeyId kek_id,
+        whNvmId cursor, uint16_t max_len)
+{
+    whMessageKeyWrap_ExportRequest msg = {0};
+
+    if (c == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+
+    msg.kek_id = kek_id;
+    msg.cursor = cursor;
+    msg.max_len = max_len;
+
+    return wh_Client_SendRequest(c,
+            WH_MESSAGE_GROUP_KEYWRAP, WH_MESSAGE_KEYWRAP_ACTION_EXPORT,
+            sizeof(msg), &msg);
+}
+
+int wh_Client_KeyWrapExportResponse(whClientContext* c, int32_t* out_rc,
+        uint8_t* blob, uint16_t* inout_blob_len, uint16_t* out_count,
+        whNvmId* out_next_cursor, uint8_t* out_done)
+{
+    uint8_t buffer[WH_COMM_DATA_LEN] = {0};
+    whMessageKeyWrap_ExportResponse* msg =
+            (whMessageKeyWrap_ExportResponse*)buffer;
+    uint16_t hdr_len = sizeof(*msg);
+    uint8_t* payload = buffer + hdr_len;
+    int rc = 0;
+    uint16_t resp_group = 0;
+    uint16_t resp_action = 0;
+    uint16_t resp_size = 0;
+
+    if (    (c == NULL) ||
+            (blob == NULL) ||
+            (inout_blob_len == NULL) ) {
+        return WH_ERROR_BADARGS;
+    }
+
+    rc = wh_Client_RecvResponse(c,
+            &resp_group, &resp_action,
+            &resp_size, buffer);
+    if (rc == 0) {
+        /* Validate response */
+        if (    (resp_group != WH_MESSAGE_GROUP_KEYWRAP) ||
+                (resp_action != WH_MESSAGE_KEYWRAP_ACTION_EXPORT) ||
+                (resp_size < hdr_len) ||
+                (resp_size != hdr_len + msg->blob_len) ){
+            /* Invalid message */
+            rc = WH_ERROR_ABORTED;
+        } else if (msg->blob_len > *inout_blob_len) {
+            /* Server ignored max_len */
+            rc = WH_ERROR_ABORTED;
+        } else {
+            /* Valid message */
+            if (out_rc != NULL) {
+                *out_rc = msg->rc;
+            }
+            memcpy(blob, payload, msg->blob_len);
+            *inout_blob_len = msg->blob_len;
+            if (out_count != NULL) {
+                *out_count = msg->count;
+            }
+            if (out_next_cursor != NULL) {
+                *out_next_cursor = msg->next_cursor;
+            }
+            if (out_done != NULL) {
+                *out_done = msg->done;
+            }
+        }
+    }
+    return rc;
+}
+
+int wh_Client_KeyWrapExport(whClientContext* c, whKeyId kek_id,
+        whNvmId cursor, int32_t* out_rc, uint8_t* blob,
+        uint16_t* inout_blob_len, uint16_t* out_count,
+        whNvmId* out_next_cursor, uint8_t* out_done)
+{
+    int rc = 0;
+
+    if (    (c == NULL) ||
+            (inout_blob_len == NULL) ) {
+        return WH_ERROR_BADARGS;
+    }
+
+    do {
+        rc = wh_Client_KeyWrapExportRequest(c, kek_id, cursor,
+                *inout_blob_len);
+    } while (rc == WH_ERROR_NOTREADY);
+
+    if (rc == 0) {
+        do {
+            rc = wh_Client_KeyWrapExportResponse(c, out_rc, blob,
+                    inout_blob_len, out_count, out_next_cursor, out_done);
+        } while (rc == WH_ERROR_NOTREADY);
+    }
+    return rc;
+}
+
+/** KeyWrap Import */
+int wh_Client_KeyWrapImportRequest(whClientContext* c, whKeyId kek_id,
+        const uint8_t* blob, uint16_t blob_len)
+{
+    uint8_t buffer[WH_COMM_DATA_LEN] = {0};
+    whMessageKeyWrap_ImportRequest* msg =
+            (whMessageKeyWrap_ImportRequest*)buffer;
+    uint16_t hdr_len = sizeof(*msg);
+    uint8_t* payload = buffer + hdr_len;
+
+    if (    (c == NULL) ||
+            (blob == NULL) ||
+            (blob_len == 0) ||
+            (blob_len > WH_MESSAGE_KEYWRAP_MAX_BLOB_LEN) ) {
+        return WH_ERROR_BADARGS;
+    }
+
+    msg->kek_id = kek_id;
+    msg->blob_len = blob_len;
+    memcpy(payload, blob, blob_len);
+
+    return wh_Client_SendRequest(c,
+            WH_MESSAGE_GROUP_KEYWRAP, WH_MESSAGE_KEYWRAP_ACTION_IMPORT,
+            hdr_len + blob_len, buffer);
+}
+
+int wh_Client_KeyWrapImportResponse(whClientContext* c, int32_t* out_rc,
+        uint16_t* out_count)
+{
+    whMessageKeyWrap_ImportResponse msg = {0};
+    int rc = 0;
+    uint16_t resp_group = 0;
+    uint16_t resp_action = 0;
+    uint16_t resp_size = 0;
+
+    if (c == NULL){
+        return WH_ERROR_BADARGS;
+    }
+
+    rc = wh_Client_RecvResponse(c,
+            &resp_group, &resp_action,
+            &resp_size, &msg);
+    if (rc == 0) {
+        /* Validate response */
+        if (    (resp_group != WH_MESSAGE_GROUP_KEYWRAP) ||
+                (resp_action != WH_MESSAGE_KEYWRAP_ACTION_IMPORT) ||
+                (resp_size != sizeof(msg)) ){
+            /* Invalid message */
+            rc = WH_ERROR_ABORTED;
+        } else {
+            /* Valid message */
+            if (out_rc != NULL) {
+                *out_rc = msg.rc;
+            }
+            if (out_count != NULL) {
+                *out_count = msg.count;
+            }
+        }
+    }
+    return rc;
+}
+
+int wh_Client_KeyWrapImport(whClientContext* c, whKeyId kek_id,
+        const uint8_t* blob, uint16_t blob_len, int32_t* out_rc,
+        uint16_t* out_count)
+{
+    int rc = 0;
+
+    if (c == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+
+    do {
+        rc = wh_Client_KeyWrapImportRequest(c, kek_id, blob, blob_len);
+    } while (rc == WH_ERROR_NOTREADY);
+
+    if (rc == 0) {
+        do {
+            rc = wh_Client_KeyWrapImportResponse(c, out_rc, out_count);
+        } while (rc == WH_ERROR_NOTREADY);
+    }
+    return rc;
+}
@@ -0,0 +1,140 @@
+/*
+ * Copyright (C) 2024 wolfSSL Inc.
+ *
+ * This file is part of wolfHSM.
+ *
+ * wolfHSM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfHSM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wolfHSM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * src/wh_client_latency.c
+ *
+ * Client-side latency histograms
+ */
+
+#include <stdint.h>
+#include <stddef.h>     /* For NULL */
+#include <string.h>     /* For memset */
+
+#include "wolfhsm/wh_error.h"
+#include "wolfhsm/wh_message.h"
+#include "wolfhsm/wh_client_latency.h"
+
+static int _GroupIndex(uint16_t group)
+{
+    int index = WH_MESSAGE_GROUP(group) >> 8;
+    return (index < WH_CLIENT_LATENCY_GROUPS) ? index : -1;
+}
+
+/* Number of significant bits, clamped to the last bucket */
+static int _Bucket(uint32_t us)
+{
+    int bucket = 0;
+
+    while ((us != 0) && (bucket < WH_CLIENT_LATENCY_BUCKETS - 1)) {
+        us >>= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+int wh_ClientLatency_Reset(whClientLatency* latency)
+{
+    if (latency == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+    memset(latency, 0, sizeof(*latency));
+    return 0;
+}
+
+int wh_ClientLatency_Record(whClientLatency* latency, uint16_t group,
+        const whClientLatencySample* sample)
+{
+    int index = _GroupIndex(group);
+    int phase = 0;
+
+    if ((latency == NULL) || (sample == NULL) || (index < 0)) {
+        return WH_ERROR_BADARGS;
+    }
+
+    for (phase = 0; phase < WH_CLIENT_LATENCY_PHASES; phase++) {
+        latency->count[index][phase][_Bucket(sample->us[phase])]++;
+        latency->total[index][phase] += sample->us[phase];
+    }
+    return 0;
+}
+
+int wh_ClientLatency_GetTotal(const whClientLatency* latency, uint16_t group,
+        whClientLatencyPhase phase, uint32_t* out_count, uint64_t* out_us)
+{
+    int index = _GroupIndex(group);
+    uint32_t count = 0;
+    int bucket = 0;
+
+    if (    (latency == NULL) ||
+            (index < 0) ||
+            (phase >= WH_CLIENT_LATENCY_PHASES)) {
+        return WH_ERROR_BADARGS;
+    }
+
+    for (bucket = 0; bucket < WH_CLIENT_LATENCY_BUCKETS; bucket++) {
+        count += latency->count[index][phase][bucket];
+    }
+    if (out_count != NULL) {
+        *out_count = count;
+    }
+    if (out_us != NULL) {
+        *out_us = latency->total[index][phase];
+    }
+    return 0;
+}
+
+int wh_ClientLatency_GetPercentile(const whClientLatency* latency,
+        uint16_t group, whClientLatencyPhase phase, uint32_t percent,
+        uint32_t* out_us)
+{
+    const uint32_t* counts = NULL;
+    uint64_t target = 0;
+    uint64_t seen = 0;
+    uint32_t count = 0;
+    int bucket = 0;
+    int rc = 0;
+
+    if ((out_us == NULL) || (percent > 100)) {
+        return WH_ERROR_BADARGS;
+    }
+    rc = wh_ClientLatency_GetTotal(latency, group, phase, &count, NULL);
+    if (rc != 0) {
+        return rc;
+    }
+    if (count == 0) {
+        return WH_ERROR_NOTFOUND;
+    }
+
+    /* Smallest bucket covering at least percent of the samples */
+    counts = latency->count[_GroupIndex(group)][phase];
+    target = ((uint64_t)count * percent + 99) / 100;
+    if (target == 0) {
+        target = 1;
+    }
+    for (bucket = 0; bucket < WH_CLIENT_LATENCY_BUCKETS - 1; bucket++) {
+        seen += counts[bucket];
+        if (seen >= target) {
+            break;
+        }
+    }
+
+    *out_us = (bucket < WH_CLIENT_LATENCY_BUCKETS - 1) ?
+            (uint32_t)((1ul << bucket) - 1) : UINT32_MAX;
+    return 0;
+}
@@ -599,6 +599,87 @@ int wh_Client_NvmDestroyObjects(whClientContext* c,
     return rc;
 }
 
+/** NVM DestroyMatching */
+int wh_Client_NvmDestroyMatchingRequest(whClientContext* c,
+        const whNvmFilter* filter)
+{
+    whMessageNvm_DestroyMatchingRequest msg = {0};
+
+    if (    (c == NULL) ||
+            (filter == NULL) ){
+        return WH_ERROR_BADARGS;
+    }
+
+    msg.id_first = filter->id_first;
+    msg.id_last = filter->id_last;
+    msg.id_mask = filter->id_mask;
+    msg.id_match = filter->id_match;
+    msg.access_mask = filter->access_mask;
+    msg.access_match = filter->access_match;
+    msg.flags_mask = filter->flags_mask;
+    msg.flags_match = filter->flags_match;
+
+    return wh_Client_SendRequest(c,
+            WH_MESSAGE_GROUP_NVM, WH_MESSAGE_NVM_ACTION_DESTROYMATCHING,
+            sizeof(msg), &msg);
+}
+
+int wh_Client_NvmDestroyMatchingResponse(whClientContext* c, int32_t *out_rc,
+        whNvmId *out_count)
+{
+    whMessageNvm_DestroyMatchingResponse msg = {0};
+    int rc = 0;
+    uint16_t resp_group = 0;
+    uint16_t resp_action = 0;
+    uint16_t resp_size = 0;
+
+    if (c == NULL){
+        return WH_ERROR_BADARGS;
+    }
+
+    rc = wh_Client_RecvResponse(c,
+            &resp_group, &resp_action,
+            &resp_size, &msg);
+    if (rc == 0) {
+        /* Validate response */
+        if (    (resp_group != WH_MESSAGE_GROUP_NVM) ||
+                (resp_action != WH_MESSAGE_NVM_ACTION_DESTROYMATCHING) ||
+                (resp_size != sizeof(msg)) ){
+            /* Invalid message */
+            rc = WH_ERROR_ABORTED;
+        } else {
+            /* Valid message */
+            if (out_rc != NULL) {
+                *out_rc = msg.rc;
+            }
+            if (out_count != NULL) {
+                *out_count = msg.count;
+            }
+        }
+    }
+    return rc;
+}
+
+int wh_Client_NvmDestroyMatching(whClientContext* c,
+        const whNvmFilter* filter, int32_t *out_rc, whNvmId *out_count)
+{
+    int rc = 0;
+
+    if (c == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+
+    do {
+        rc = wh_Client_NvmDestroyMatchingRequest(c, filter);
+    } while (rc == WH_ERROR_NOTREADY);
+    if (rc == 0) {
+        do {
+            rc = wh_Client_NvmDestroyMatchingResponse(c, out_rc, out_count);
+        } while (rc == WH_ERROR_NOTREADY);
+    }
+    return rc;
+}
+
 /** NVM Read */
 int wh_Client_NvmReadRequest(whClientContext* c,
         whNvmId id, whNvmSize offset, whNvmSize data_len)
@@ -1064,3 +1145,146 @@ int wh_Client_NvmReadDma(whClientContext* c,
     return WH_ERROR_BADARGS;
 }
 
+/** NVM AddObjectBulk */
+int wh_Client_NvmAddObjectBulkRequest(whClientContext* c,
+        uint32_t metadata_offset, whNvmSize data_len, uint32_t data_offset)
+{
+    whMessageNvm_AddObjectBulkRequest msg = {0};
+
+    if (c == NULL){
+        return WH_ERROR_BADARGS;
+    }
+
+    msg.metadata_offset = metadata_offset;
+    msg.data_len = data_len;
+    msg.data_offset = data_offset;
+    return wh_Client_SendRequest(c,
+            WH_MESSAGE_GROUP_NVM, WH_MESSAGE_NVM_ACTION_ADDOBJECTBULK,
+            sizeof(msg), &msg);
+}
+
+int wh_Client_NvmAddObjectBulkResponse(whClientContext* c, int32_t *out_rc)
+{
+    whMessageNvm_SimpleResponse msg = {0};
+    int rc = 0;
+    uint16_t resp_group = 0;
+    uint16_t resp_action = 0;
+    uint16_t resp_size = 0;
+
+    if (c == NULL){
+        return WH_ERROR_BADARGS;
+    }
+
+    rc = wh_Client_RecvResponse(c,
+            &resp_group, &resp_action,
+            &resp_size, &msg);
+    if (rc == 0) {
+        /* Validate response */
+        if (    (resp_group != WH_MESSAGE_GROUP_NVM) ||
+                (resp_action != WH_MESSAGE_NVM_ACTION_ADDOBJECTBULK) ||
+                (resp_size != sizeof(msg)) ){
+            /* Invalid message */
+            rc = WH_ERROR_ABORTED;
+        } else {
+            /* Valid message */
+            if (out_rc != NULL) {
+                *out_rc = msg.rc;
+            }
+        }
+    }
+    return rc;
+}
+
+int wh_Client_NvmAddObjectBulk(whClientContext* c,
+        uint32_t metadata_offset, whNvmSize data_len, uint32_t data_offset,
+        int32_t *out_rc)
+{
+    int rc = 0;
+
+    if (c == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+    do {
+        rc = wh_Client_NvmAddObjectBulkRequest(c,
+                metadata_offset, data_len, data_offset);
+    } while (rc == WH_ERROR_NOTREADY);
+    if (rc == 0) {
+        do {
+            rc = wh_Client_NvmAddObjectBulkResponse(c, out_rc);
+        } while (rc == WH_ERROR_NOTREADY);
+    }
+    return rc;
+}
+
+/** NVM ReadBulk */
+int wh_Client_NvmReadBulkRequest(whClientContext* c,
+        whNvmId id, whNvmSize offset, whNvmSize data_len,
+        uint32_t data_offset)
+{
+    whMessageNvm_ReadBulkRequest msg = {0};
+
+    if (c == NULL){
+        return WH_ERROR_BADARGS;
+    }
+
+    msg.id = id;
+    msg.offset = offset;
+    msg.data_len = data_len;
+    msg.data_offset = data_offset;
+    return wh_Client_SendRequest(c,
+            WH_MESSAGE_GROUP_NVM, WH_MESSAGE_NVM_ACTION_READBULK,
+            sizeof(msg), &msg);
+}
+
+int wh_Client_NvmReadBulkResponse(whClientContext* c, int32_t *out_rc)
+{
+    whMessageNvm_SimpleResponse msg = {0};
+    int rc = 0;
+    uint16_t resp_group = 0;
+    uint16_t resp_action = 0;
+    uint16_t resp_size = 0;
+
+    if (c == NULL){
+        return WH_ERROR_BADARGS;
+    }
+
+    rc = wh_Client_RecvResponse(c,
+            &resp_group, &resp_action,
+            &resp_size, &msg);
+    if (rc == 0) {
+        /* Validate response */
+        if (    (resp_group != WH_MESSAGE_GROUP_NVM) ||
+                (resp_action != WH_MESSAGE_NVM_ACTION_READBULK) ||
+                (resp_size != sizeof(msg)) ){
+            /* Invalid message */
+            rc = WH_ERROR_ABORTED;
+        } else {
+            /* Valid message */
+            if (out_rc != NULL) {
+                *out_rc = msg.rc;
+            }
+        }
+    }
+    return rc;
+}
+
+int wh_Client_NvmReadBulk(whClientContext* c,
+        whNvmId id, whNvmSize offset, whNvmSize data_len,
+        uint32_t data_offset, int32_t *out_rc)
+{
+    int rc = 0;
+
+    if (c == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+    do {
+        rc = wh_Client_NvmReadBulkRequest(c,
+                id, offset, data_len, data_offset);
+    } while (rc == WH_ERROR_NOTREADY);
+    if (rc == 0) {
+        do {
+            rc = wh_Client_NvmReadBulkResponse(c, out_rc);
+        } while (rc == WH_ERROR_NOTREADY);
+    }
+    return rc;
+}
@@ -0,0 +1,739 @@
+/*
+ * Copyright (C) 2024 wolfSSL Inc.
+ *
+ * This file is part of wolfHSM.
+ *
+ * wolfHSM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfHSM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wolfHSM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * src/wh_client_pkcs11.c
+ */
+
+/* System libraries */
+#include <stdint.h>
+#include <stdlib.h>  /* For NULL */
+#include <string.h>  /* For memset, memcpy */
+
+/* Common WolfHSM types and defines shared with the server */
+#include "wolfhsm/wh_error.h"
+#include "wolfhsm/wh_comm.h"
+
+#include "wolfhsm/wh_message.h"
+#include "wolfhsm/wh_message_pkcs11.h"
+
+#include "wolfhsm/wh_client.h"
+#include "wolfhsm/wh_client_pkcs11.h"
+
+/* Receive and validate a SimpleResponse for the given action */
+static int _Pkcs11SimpleResponse(whClientContext* c, uint16_t action,
+        int32_t *out_rc)
+{
+    whMessagePkcs11_SimpleResponse msg = {0};
+    int rc = 0;
+    uint16_t resp_group = 0;
+    uint16_t resp_action = 0;
+    uint16_t resp_size = 0;
+
+    if (c == NULL){
+        return WH_ERROR_BADARGS;
+    }
+
+    rc = wh_Client_RecvResponse(c,
+            &resp_group, &resp_action,
+            &resp_size, &msg);
+    if (rc == 0) {
+        /* Validate response */
+        if (    (resp_group != WH_MESSAGE_GROUP_PKCS11) ||
+                (resp_action != action) ||
+                (resp_size != sizeof(msg)) ){
+            /* Invalid message */
+            rc = WH_ERROR_ABORTED;
+        } else {
+            /* Valid message */
+            if (out_rc != NULL) {
+                *out_rc = msg.rc;
+            }
+        }
+    }
+    return rc;
+}
+
+static int _Pkcs11SessionRequest(whClientContext* c, uint16_t action,
+        uint32_t session)
+{
+    whMessagePkcs11_SessionRequest msg = {0};
+
+    if (c == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+
+    msg.session = session;
+
+    return wh_Client_SendRequest(c,
+            WH_MESSAGE_GROUP_PKCS11, action,
+            sizeof(msg), &msg);
+}
+
+/** PKCS11 OpenSession */
+int wh_Client_Pkcs11OpenSessionRequest(whClientContext* c, uint32_t flags)
+{
+    whMessagePkcs11_OpenSessionRequest msg = {0};
+
+    if (c == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+
+    msg.flags = flags;
+
+    return wh_Client_SendRequest(c,
+            WH_MESSAGE_GROUP_PKCS11, WH_MESSAGE_PKCS11_ACTION_OPENSESSION,
+            sizeof(msg), &msg);
+}
+
+int wh_Client_Pkcs11OpenSessionResponse(whClientContext* c, int32_t* out_rc,
+        uint32_t* out_session)
+{
+    whMessagePkcs11_OpenSessionResponse msg = {0};
+    int rc = 0;
+    uint16_t resp_group = 0;
+    uint16_t resp_action = 0;
+    uint16_t resp_size = 0;
+
+    if (c == NULL){
+        return WH_ERROR_BADARGS;
+    }
+
+    rc = wh_Client_RecvResponse(c,
+            &resp_group, &resp_action,
+            &resp_size, &msg);
+    if (rc == 0) {
+        /* Validate response */
+        if (    (resp_group != WH_MESSAGE_GROUP_PKCS11) ||
+                (resp_action != WH_MESSAGE_PKCS11_ACTION_OPENSESSION) ||
+                (resp_size != sizeof(msg)) ){
+            /* Invalid message */
+            rc = WH_ERROR_ABORTED;
+        } else {
+            /* Valid message */
+            if (out_rc != NULL) {
+                *out_rc = msg.rc;
+            }
+            if (out_session != NULL) {
+                *out_session = msg.session;
+            }
+        }
+    }
+    return rc;
+}
+
+int wh_Client_Pkcs11OpenSession(whClientContext* c, uint32_t flags,
+        int32_t* out_rc, uint32_t* out_session)
+{
+    int rc = 0;
+
+    if (c == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+
+    do {
+        rc = wh_Client_Pkcs11OpenSessionRequest(c, flags);
+    } while (rc == WH_ERROR_NOTREADY);
+
+    if (rc == 0) {
+        do {
+            rc = wh_Client_Pkcs11OpenSessionResponse(c, out_rc, out_session);
+        } while (rc == WH_ERROR_NOTREADY);
+    }
+    return rc;
+}
+
+/** PKCS11 CloseSession */
+int wh_Client_Pkcs11CloseSessionRequest(whClientContext* c, uint32_t session)
+{
+    return _Pkcs11SessionRequest(c, WH_MESSAGE_PKCS11_ACTION_CLOSESESSION,
+            session);
+}
+
+int wh_Client_Pkcs11CloseSessionResponse(whClientContext* c, int32_t* out_rc)
+{
+    return _Pkcs11SimpleResponse(c, WH_MESSAGE_PKCS11_ACTION_CLOSESESSION,
+            out_rc);
+}
+
+int wh_Client_Pkcs11CloseSession(whClientContext* c, uint32_t session,
+        int32_t* out_rc)
+{
+    int rc = 0;
+
+    if (c == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+
+    do {
+        rc = wh_Client_Pkcs11CloseSessionRequest(c, session);
+    } while (rc == WH_ERROR_NOTREADY);
+
+    if (rc == 0) {
+        do {
+            rc = wh_Client_Pkcs11CloseSessionResponse(c, out_rc);
+        } while (rc == WH_ERROR_NOTREADY);
+    }
+    return rc;
+}
+
+/** PKCS11 FindObjectsInit */
+int wh_Client_Pkcs11FindObjectsInitRequest(whClientContext* c,
+        uint32_t session, whNvmAccess access, whNvmFlags flags,
+        whNvmId id_min, whNvmId id_max, uint16_t label_len,
+        const uint8_t* label)
+{
+    whMessagePkcs11_FindObjectsInitRequest msg = {0};
+
+    if (    (c == NULL) ||
+            (label_len > sizeof(msg.label)) ||
+            ((label_len > 0) && (label == NULL)) ) {
+        return WH_ERROR_BADARGS;
+    }
+
+    msg.session = session;
+    msg.access = access;
+    msg.flags = flags;
+    msg.id_min = id_min;
+    msg.id_max = id_max;
+    msg.label_len = label_len;
+    if (label_len > 0) {
+        memcpy(msg.label, label, label_len);
+    }
+
+    return wh_Client_SendRequest(c,
+            WH_MESSAGE_GROUP_PKCS11, WH_MESSAGE_PKCS11_ACTION_FINDOBJECTSINIT,
+            sizeof(msg), &msg);
+}
+
+int wh_Client_Pkcs11FindObjectsInitResponse(whClientContext* c,
+        int32_t* out_rc)
+{
+    return _Pkcs11SimpleResponse(c, WH_MESSAGE_PKCS11_ACTION_FINDOBJECTSINIT,
+            out_rc);
+}
+
+int wh_Client_Pkcs11FindObjectsInit(whClientContext* c, uint32_t session,
+        whNvmAccess access, whNvmFlags flags, whNvmId id_min, whNvmId id_max,
+        uint16_t label_len, const uint8_t* label, int32_t* out_rc)
+{
+    int rc = 0;
+
+    if (c == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+
+    do {
+        rc = wh_Client_Pkcs11FindObjectsInitRequest(c, session, access, flags,
+                id_min, id_max, label_len, label);
+    } while (rc == WH_ERROR_NOTREADY);
+
+    if (rc == 0) {
+        do {
+            rc = wh_Client_Pkcs11FindObjectsInitResponse(c, out_rc);
+        } while (rc == WH_ERROR_NOTREADY);
+    }
+    return rc;
+}
+
+/** PKCS11 FindObjects */
+int wh_Client_Pkcs11FindObjectsRequest(whClientContext* c, uint32_t session,
+        uint16_t max_count)
+{
+    whMessagePkcs11_FindObjectsRequest msg = {0};
+
+    if (c == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+
+    msg.session = session;
+    msg.max_count = max_count;
+
+    return wh_Client_SendRequest(c,
+            WH_MESSAGE_GROUP_PKCS11, WH_MESSAGE_PKCS11_ACTION_FINDOBJECTS,
+            sizeof(msg), &msg);
+}
+
+int wh_Client_Pkcs11FindObjectsResponse(whClientContext* c, int32_t* out_rc,
+        uint16_t* out_count, uint32_t* out_handles)
+{
+    whMessagePkcs11_FindObjectsResponse msg = {0};
+    int rc = 0;
+    uint16_t resp_group = 0;
+    uint16_t resp_action = 0;
+    uint16_t resp_size = 0;
+
+    if (c == NULL){
+        return WH_ERROR_BADARGS;
+    }
+
+    rc = wh_Client_RecvResponse(c,
+            &resp_group, &resp_action,
+            &resp_size, &msg);
+    if (rc == 0) {
+        /* Validate response */
+        if (    (resp_group != WH_MESSAGE_GROUP_PKCS11) ||
+                (resp_action != WH_MESSAGE_PKCS11_ACTION_FINDOBJECTS) ||
+                (resp_size != sizeof(msg)) ||
+                (msg.count > WH_MESSAGE_PKCS11_MAX_FIND_HANDLES) ){
+            /* Invalid message */
+            rc = WH_ERROR_ABORTED;
+        } else {
+            /* Valid message */
+            if (out_rc != NULL) {
+                *out_rc = msg.rc;
+            }
+            if (out_count != NULL) {
+                *out_count = msg.count;
+            }
+            if (out_handles != NULL) {
+                memcpy(out_handles, msg.handles,
+                        msg.count * sizeof(msg.handles[0]));
+            }
+        }
+    }
+    return rc;
+}
+
+int wh_Client_Pkcs11FindObjects(whClientContext* c, uint32_t session,
+        uint16_t max_count, int32_t* out_rc, uint16_t* out_count,
+        uint32_t* out_handles)
+{
+    int rc = 0;
+
+    if (c == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+
+    do {
+        rc = wh_Client_Pkcs11FindObjectsRequest(c, session, max_count);
+    } while (rc == WH_ERROR_NOTREADY);
+
+    if (rc == 0) {
+        do {
+            rc = wh_Client_Pkcs11FindObjectsResponse(c, out_rc, out_count,
+                    out_handles);
+        } while (rc == WH_ERROR_NOTREADY);
+    }
+    return rc;
+}
+
+/** PKCS11 FindObjectsFinal */
+int wh_Client_Pkcs11FindObjectsFinalRequest(whClientContext* c,
+        uint32_t session)
+{
+    return _Pkcs11SessionRequest(c, WH_MESSAGE_PKCS11_ACTION_FINDOBJECTSFINAL,
+            session);
+}
+
+int wh_Client_Pkcs11FindObjectsFinalResponse(whClientContext* c,
+        int32_t* out_rc)
+{
+    return _Pkcs11SimpleResponse(c, WH_MESSAGE_PKCS11_ACTION_FINDOBJECTSFINAL,
+            out_rc);
+}
+
+int wh_Client_Pkcs11FindObjectsFinal(whClientContext* c, uint32_t session,
+        int32_t* out_rc)
+{
+    int rc = 0;
+
+    if (c == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+
+    do {
+        rc = wh_Client_Pkcs11FindObjectsFinalRequest(c, session);
+    } while (rc == WH_ERROR_NOTREADY);
+
+    if (rc == 0) {
+        do {
+            rc = wh_Client_Pkcs11FindObjectsFinalResponse(c, out_rc);
+        } while (rc == WH_ERROR_NOTREADY);
+    }
+    return rc;
+}
+
+/** PKCS11 GetObjectInfo */
+int wh_Client_Pkcs11GetObjectInfoRequest(whClientContext* c, uint32_t session,
+        uint32_t object)
+{
+    whMessagePkcs11_ObjectRequest msg = {0};
+
+    if (c == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+
+    msg.session = session;
+    msg.object = object;
+
+    return wh_Client_SendRequest(c,
+            WH_MESSAGE_GROUP_PKCS11, WH_MESSAGE_PKCS11_ACTION_GETOBJECTINFO,
+            sizeof(msg), &msg);
+}
+
+int wh_Client_Pkcs11GetObjectInfoResponse(whClientContext* c, int32_t* out_rc,
+        whNvmId* out_id, whNvmAccess* out_access, whNvmFlags* out_flags,
+        whNvmSize* out_len, whNvmSize label_len, uint8_t* label)
+{
+    whMessagePkcs11_GetObjectInfoResponse msg = {0};
+    int rc = 0;
+    uint16_t resp_group = 0;
+    uint16_t resp_action = 0;
+    uint16_t resp_size = 0;
+
+    if (c == NULL){
+        return WH_ERROR_BADARGS;
+    }
+
+    rc = wh_Client_RecvResponse(c,
+            &resp_group, &resp_action,
+            &resp_size, &msg);
+    if (rc == 0) {
+        /* Validate response */
+        if (    (resp_group != WH_MESSAGE_GROUP_PKCS11) ||
+                (resp_action != WH_MESSAGE_PKCS11_ACTION_GETOBJECTINFO) ||
+                (resp_size != sizeof(msg)) ){
+            /* Invalid message */
+            rc = WH_ERROR_ABORTED;
+        } else {
+            /* Valid message */
+            if (out_rc != NULL) {
+                *out_rc = msg.rc;
+            }
+            if (out_id != NULL) {
+                *out_id = msg.id;
+            }
+            if (out_access != NULL) {
+                *out_access = msg.access;
+            }
+            if (out_flags != NULL) {
+                *out_flags = msg.flags;
+            }
+            if (out_len != NULL) {
+                *out_len = msg.len;
+            }
+            if (label != NULL) {
+                if (label_len > sizeof(msg.label)) {
+                    label_len = sizeof(msg.label);
+                }
+                memcpy(label, msg.label, label_len);
+            }
+        }
+    }
+    return rc;
+}
+
+int wh_Client_Pkcs11GetObjectInfo(whClientContext* c, uint32_t session,
+        uint32_t object, int32_t* out_rc, whNvmId* out_id,
+        whNvmAccess* out_access, whNvmFlags* out_flags, whNvmSize* out_len,
+        whNvmSize label_len, uint8_t* label)
+{
+    int rc = 0;
+
+    if (c == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+
+    do {
+        rc = wh_Client_Pkcs11GetObjectInfoRequest(c, session, object);
+    } while (rc == WH_ERROR_NOTREADY);
+
+    if (rc == 0) {
+        do {
+            rc = wh_Client_Pkcs11GetObjectInfoResponse(c, out_rc, out_id,
+                    out_access, out_flags, out_len, label_len, label);
+        } while (rc == WH_ERROR_NOTREADY);
+    }
+    return rc;
+}
+
+/** PKCS11 DestroyObject */
+int wh_Client_Pkcs11DestroyObjectRequest(whClientContext* c, uint32_t session,
+        uint32_t object)
+{
+    whMessagePkcs11_ObjectRequest msg = {0};
+
+    if (c == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+
+    msg.session = session;
+    msg.object = object;
+
+    return wh_Client_SendRequest(c,
+            WH_MESSAGE_GROUP_PKCS11, WH_MESSAGE_PKCS11_ACTION_DESTROYOBJECT,
+            sizeof(msg), &msg);
+}
+
+int wh_Client_Pkcs11DestroyObjectResponse(whClientContext* c, int32_t* out_rc)
+{
+    return _Pkcs11SimpleResponse(c, WH_MESSAGE_PKCS11_ACTION_DESTROYOBJECT,
+            out_rc);
+}
+
+int wh_Client_Pkcs11DestroyObject(whClientContext* c, uint32_t session,
+        uint32_t object, int32_t* out_rc)
+{
+    int rc = 0;
+
+    if (c == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+
+    do {
+        rc = wh_Client_Pkcs11DestroyObjectRequest(c, session, object);
+    } while (rc == WH_ERROR_NOTREADY);
+
+    if (rc == 0) {
+        do {
+            rc = wh_Client_Pkcs11DestroyObjectResponse(c, out_rc);
+        } while (rc == WH_ERROR_NOTREADY);
+    }
+    return rc;
+}
+
+/** PKCS11 SignInit */
+int wh_Client_Pkcs11SignInitRequest(whClientContext* c, uint32_t session,
+        uint32_t object, uint32_t mechanism)
+{
+    whMessagePkcs11_SignInitRequest msg = {0};
+
+    if (c == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+
+    msg.session = session;
+    msg.object = object;
+    msg.mechanism = mechanism;
+
+    return wh_Client_SendRequest(c,
+            WH_MESSAGE_GROUP_PKCS11, WH_MESSAGE_PKCS11_ACTION_SIGNINIT,
+            sizeof(msg), &msg);
+}
+
+int wh_Client_Pkcs11SignInitResponse(whClientContext* c, int32_t* out_rc)
+{
+    return _Pkcs11SimpleResponse(c, WH_MESSAGE_PKCS11_ACTION_SIGNINIT,
+            out_rc);
+}
+
+int wh_Client_Pkcs11SignInit(whClientContext* c, uint32_t session,
+        uint32_t object, uint32_t mechanism, int32_t* out_rc)
+{
+    int rc = 0;
+
+    if (c == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+
+    do {
+        rc = wh_Client_Pkcs11SignInitRequest(c, session, object, mechanism);
+    } while (rc == WH_ERROR_NOTREADY);
+
+    if (rc == 0) {
+        do {
+            rc = wh_Client_Pkcs11SignInitResponse(c, out_rc);
+        } while (rc == WH_ERROR_NOTREADY);
+    }
+    return rc;
+}
+
+/* Send a SignDataRequest header followed by data */
+static int _Pkcs11SignDataRequest(whClientContext* c, uint16_t action,
+        uint32_t session, const uint8_t* data, uint16_t len)
+{
+    uint8_t buffer[WH_COMM_DATA_LEN] = {0};
+    whMessagePkcs11_SignDataRequest* msg =
+            (whMessagePkcs11_SignDataRequest*)buffer;
+    uint16_t hdr_len = sizeof(*msg);
+    uint8_t* payload = buffer + hdr_len;
+
+    if (    (c == NULL) ||
+            ((len > 0) && (data == NULL)) ||
+            (len > WH_MESSAGE_PKCS11_MAX_SIGN_DATA_LEN) ) {
+        return WH_ERROR_BADARGS;
+    }
+
+    msg->session = session;
+    msg->len = len;
+    if (len > 0) {
+        memcpy(payload, data, len);
+    }
+
+    return wh_Client_SendRequest(c,
+            WH_MESSAGE_GROUP_PKCS11, action,
+            hdr_len + len, buffer);
+}
+
+/* Receive a SignatureResponse and copy out the signature */
+static int _Pkcs11SignatureResponse(whClientContext* c, uint16_t action,
+        int32_t* out_rc, uint8_t* sig, uint16_t* inout_sig_len)
+{
+    uint8_t buffer[WH_COMM_DATA_LEN] = {0};
+    whMessagePkcs11_SignatureResponse* msg =
+            (whMessagePkcs11_SignatureResponse*)buffer;
+    uint16_t hdr_len = sizeof(*msg);
+    uint8_t* payload = buffer + hdr_len;
+    int rc = 0;
+    uint16_t resp_group = 0;
+    uint16_t resp_action = 0;
+    uint16_t resp_size = 0;
+
+    if (c == NULL){
+        return WH_ERROR_BADARGS;
+    }
+
+    rc = wh_Client_RecvResponse(c,
+            &resp_group, &resp_action,
+            &resp_size, buffer);
+    if (rc == 0) {
+        /* Validate response */
+        if (    (resp_group != WH_MESSAGE_GROUP_PKCS11) ||
+                (resp_action != action) ||
+                (resp_size < hdr_len) ||
+                (resp_size != hdr_len + msg->len) ){
+            /* Invalid message */
+            rc = WH_ERROR_ABORTED;
+        } else {
+            /* Valid message */
+            if (out_rc != NULL) {
+                *out_rc = msg->rc;
+            }
+            if (inout_sig_len != NULL) {
+                if ((sig != NULL) && (msg->len > *inout_sig_len)) {
+                    rc = WH_ERROR_NOSPACE;
+                } else {
+                    if (sig != NULL) {
+                        memcpy(sig, payload, msg->len);
+                    }
+                    *inout_sig_len = msg->len;
+                }
+            }
+        }
+    }
+    return rc;
+}
+
+/** PKCS11 SignUpdate */
+int wh_Client_Pkcs11SignUpdateRequest(whClientContext* c, uint32_t session,
+        const uint8_t* data, uint16_t len)
+{
+    return _Pkcs11SignDataRequest(c, WH_MESSAGE_PKCS11_ACTION_SIGNUPDATE,
+            session, data, len);
+}
+
+int wh_Client_Pkcs11SignUpdateResponse(whClientContext* c, int32_t* out_rc)
+{
+    return _Pkcs11SimpleResponse(c, WH_MESSAGE_PKCS11_ACTION_SIGNUPDATE,
+            out_rc);
+}
+
+int wh_Client_Pkcs11SignUpdate(whClientContext* c, uint32_t session,
+        const uint8_t* data, uint16_t len, int32_t* out_rc)
+{
+    int rc = 0;
+
+    if (c == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+
+    do {
+        rc = wh_Client_Pkcs11SignUpdateRequest(c, session, data, len);
+    } while (rc == WH_ERROR_NOTREADY);
+
+    if (rc == 0) {
+        do {
+            rc = wh_Client_Pkcs11SignUpdateResponse(c, out_rc);
+        } while (rc == WH_ERROR_NOTREADY);
+    }
+    return rc;
+}
+
+/** PKCS11 Sign */
+int wh_Client_Pkcs11SignRequest(whClientContext* c, uint32_t session,
+        const uint8_t* data, uint16_t len)
+{
+    return _Pkcs11SignDataRequest(c, WH_MESSAGE_PKCS11_ACTION_SIGN,
+            session, data, len);
+}
+
+int wh_Client_Pkcs11SignResponse(whClientContext* c, int32_t* out_rc,
+        uint8_t* sig, uint16_t* inout_sig_len)
+{
+    return _Pkcs11SignatureResponse(c, WH_MESSAGE_PKCS11_ACTION_SIGN,
+            out_rc, sig, inout_sig_len);
+}
+
+int wh_Client_Pkcs11Sign(whClientContext* c, uint32_t session,
+        const uint8_t* data, uint16_t len, int32_t* out_rc, uint8_t* sig,
+        uint16_t* inout_sig_len)
+{
+    int rc = 0;
+
+    if (c == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+
+    do {
+        rc = wh_Client_Pkcs11SignRequest(c, session, data, len);
+    } while (rc == WH_ERROR_NOTREADY);
+
+    if (rc == 0) {
+        do {
+            rc = wh_Client_Pkcs11SignResponse(c, out_rc, sig, inout_sig_len);
+        } while (rc == WH_ERROR_NOTREADY);
+    }
+    return rc;
+}
+
+/** PKCS11 SignFinal */
+int wh_Client_Pkcs11SignFinalRequest(whClientContext* c, uint32_t session)
+{
+    return _Pkcs11SessionRequest(c, WH_MESSAGE_PKCS11_ACTION_SIGNFINAL,
+            session);
+}
+
+int wh_Client_Pkcs11SignFinalResponse(whClientContext* c, int32_t* out_rc,
+        uint8_t* sig, uint16_t* inout_sig_len)
+{
+    return _Pkcs11SignatureResponse(c, WH_MESSAGE_PKCS11_ACTION_SIGNFINAL,
+            out_rc, sig, inout_sig_len);
+}
+
+int wh_Client_Pkcs11SignFinal(whClientContext* c, uint32_t session,
+        int32_t* out_rc, uint8_t* sig, uint16_t* inout_sig_len)
+{
+    int rc = 0;
+
+    if (c == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+
+    do {
+        rc = wh_Client_Pkcs11SignFinalRequest(c, session);
+    } while (rc == WH_ERROR_NOTREADY);
+
+    if (rc == 0) {
+        do {
+            rc = wh_Client_Pkcs11SignFinalResponse(c, out_rc, sig,
+                    inout_sig_len);
+        } while (rc == WH_ERROR_NOTREADY);
+    }
+    return rc;
+}
@@ -0,0 +1,334 @@
+/*
+ * Copyright (C) 2024 wolfSSL Inc.
+ *
+ * This file is part of wolfHSM.
+ *
+ * wolfHSM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfHSM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wolfHSM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * src/wh_client_pool.c
+ *
+ * Spread stateless client requests across several replicated servers
+ */
+
+#include <stdint.h>
+#include <stddef.h>     /* For NULL */
+#include <string.h>     /* For memset */
+
+#include "wolfhsm/wh_error.h"
+#include "wolfhsm/wh_lock.h"
+#include "wolfhsm/wh_client.h"
+#include "wolfhsm/wh_client_pool.h"
+
+#ifndef WOLFHSM_NO_CRYPTO
+#include "wolfssl/wolfcrypt/settings.h"
+#include "wolfssl/wolfcrypt/cryptocb.h"
+#include "wolfhsm/wh_cryptocb.h"
+#endif
+
+/* Weight of a new sample in the smoothed round trip, as 1/2^N */
+#define WH_CLIENT_POOL_LATENCY_SHIFT 3
+
+/* Mark and return a member.  With primary set, only the first member in
+ * rotation is considered, for operations that must stay on one server */
+static int _SelectMember(whClientPool* pool, int primary,
+        whClientContext** out_client, uint32_t* out_token)
+{
+    whClientPoolMember* member = NULL;
+    int best = -1;
+    int anyUp = 0;
+    int idx = 0;
+    int i = 0;
+
+    for (i = 0; i < pool->count; i++) {
+        idx = primary ? i : (pool->next + i) % pool->count;
+        member = &pool->members[idx];
+        if (member->down) {
+            continue;
+        }
+        anyUp = 1;
+        if (member->outstanding) {
+            if (primary) {
+                break;
+            }
+            continue;
+        }
+        if (best < 0) {
+            best = idx;
+        }
+        if (    primary ||
+                (pool->policy != WH_CLIENT_POOL_LATENCY)) {
+            /* First idle member after the last one used */
+            break;
+        }
+        /* Unmeasured members report 0, so they are tried first */
+        if (member->latency < pool->members[best].latency) {
+            best = idx;
+        }
+    }
+
+    if (best < 0) {
+        return anyUp ? WH_ERROR_NOTREADY : WH_ERROR_ABORTED;
+    }
+
+    pool->members[best].outstanding = 1;
+    if (!primary) {
+        pool->next = (uint16_t)((best + 1) % pool->count);
+    }
+    *out_client = pool->members[best].client;
+    *out_token = (pool->timeCb != NULL) ?
+            pool->timeCb(pool->timeContext) : 0;
+    return WH_ERROR_OK;
+}
+
+static int _Acquire(whClientPool* pool, int primary,
+        whClientContext** out_client, uint32_t* out_token)
+{
+    int rc = 0;
+
+    if (    (pool == NULL) ||
+            (out_client == NULL) ||
+            (out_token == NULL)) {
+        return WH_ERROR_BADARGS;
+    }
+
+    rc = wh_Lock_AcquireWrite(pool->lock);
+    if (rc == 0) {
+        rc = _SelectMember(pool, primary, out_client, out_token);
+        (void)wh_Lock_ReleaseWrite(pool->lock);
+    }
+    return rc;
+}
+
+int wh_ClientPool_Init(whClientPool* pool, const whClientPoolConfig* config)
+{
+    int rc = 0;
+    int i = 0;
+
+    if (    (pool == NULL) ||
+            (config == NULL) ||
+            (config->clients == NULL) ||
+            (config->count == 0) ||
+            (config->count > WH_CLIENT_POOL_MAX_MEMBERS) ||
+            ((config->policy == WH_CLIENT_POOL_LATENCY) &&
+                (config->timeCb == NULL))) {
+        return WH_ERROR_BADARGS;
+    }
+
+    memset(pool, 0, sizeof(*pool));
+    for (i = 0; i < config->count; i++) {
+        if (config->clients[i] == NULL) {
+            return WH_ERROR_BADARGS;
+        }
+        pool->members[i].client = config->clients[i];
+    }
+    pool->count = config->count;
+    pool->maxFailures = (config->maxFailures != 0) ? config->maxFailures : 1;
+    pool->policy = config->policy;
+    pool->timeCb = config->timeCb;
+    pool->timeContext = config->timeContext;
+    pool->waitCb = config->waitCb;
+    pool->waitContext = config->waitContext;
+    pool->replicatedKeys = (config->replicatedKeys != 0);
+
+    rc = wh_Lock_Init(pool->lock, config->lock_config);
+    if (rc != 0) {
+        memset(pool, 0, sizeof(*pool));
+    }
+    return rc;
+}
+
+int wh_ClientPool_Cleanup(whClientPool* pool)
+{
+    if (pool == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+
+    (void)wh_Lock_Cleanup(pool->lock);
+    memset(pool, 0, sizeof(*pool));
+    return 0;
+}
+
+int wh_ClientPool_Acquire(whClientPool* pool, whClientContext** out_client,
+        uint32_t* out_token)
+{
+    return _Acquire(pool, 0, out_client, out_token);
+}
+
+int wh_ClientPool_Release(whClientPool* pool, whClientContext* client,
+        uint32_t token, int rc)
+{
+    whClientPoolMember* member = NULL;
+    uint32_t sample = 0;
+    int ret = 0;
+    int i = 0;
+
+    if ((pool == NULL) || (client == NULL)) {
+        return WH_ERROR_BADARGS;
+    }
+
+    ret = wh_Lock_AcquireWrite(pool->lock);
+    if (ret != 0) {
+        return ret;
+    }
+
+    ret = WH_ERROR_BADARGS;
+    for (i = 0; i < pool->count; i++) {
+        member = &pool->members[i];
+        if (member->client != client) {
+            continue;
+        }
+
+        member->outstanding = 0;
+        if (rc == WH_ERROR_ABORTED) {
+            /* Transport failure.  Fail over after repeated failures */
+            member->failures++;
+            if (member->failures >= pool->maxFailures) {
+                member->down = 1;
+            }
+        } else {
+            member->failures = 0;
+            if (pool->timeCb != NULL) {
+                sample = pool->timeCb(pool->timeContext) - token;
+                if (member->latency == 0) {
+                    member->latency = sample;
+                } else {
+                    member->latency = member->latency -
+                        (member->latency >> WH_CLIENT_POOL_LATENCY_SHIFT) +
+                        (sample >> WH_CLIENT_POOL_LATENCY_SHIFT);
+                }
+                if (member->latency == 0) {
+                    /* Keep 0 meaning unmeasured */
+                    member->latency = 1;
+                }
+            }
+        }
+        ret = WH_ERROR_OK;
+        break;
+    }
+
+    (void)wh_Lock_ReleaseWrite(pool->lock);
+    return ret;
+}
+
+int wh_ClientPool_SetAvailable(whClientPool* pool, whClientContext* client,
+        int available)
+{
+    int ret = 0;
+    int i = 0;
+
+    if ((pool == NULL) || (client == NULL)) {
+        return WH_ERROR_BADARGS;
+    }
+
+    ret = wh_Lock_AcquireWrite(pool->lock);
+    if (ret != 0) {
+        return ret;
+    }
+
+    ret = WH_ERROR_BADARGS;
+    for (i = 0; i < pool->count; i++) {
+        if (pool->members[i].client == client) {
+            pool->members[i].down = (available == 0);
+            pool->members[i].failures = 0;
+            ret = WH_ERROR_OK;
+            break;
+        }
+    }
+
+    (void)wh_Lock_ReleaseWrite(pool->lock);
+    return ret;
+}
+
+#ifndef WOLFHSM_NO_CRYPTO
+/* Whether an operation may run on any member.  Keys are referenced by the id
+ * a server gave them, so generating one and using one stay on the primary
+ * unless the application keeps its keys replicated on every server */
+static int _IsStateless(const whClientPool* pool, const wc_CryptoInfo* info)
+{
+    switch (info->algo_type) {
+    case WC_ALGO_TYPE_RNG:
+    case WC_ALGO_TYPE_SEED:
+        return 1;
+    case WC_ALGO_TYPE_CIPHER:
+#ifdef WOLFHSM_SYMMETRIC_INTERNAL
+        return pool->replicatedKeys;
+#else
+        /* The key is sent with every request */
+        return 1;
+#endif
+    case WC_ALGO_TYPE_PK:
+        switch (info->pk.type) {
+        case WC_PK_TYPE_RSA_KEYGEN:
+        case WC_PK_TYPE_EC_KEYGEN:
+        case WC_PK_TYPE_CURVE25519_KEYGEN:
+            /* The new key only exists on the server that made it */
+            return 0;
+        default:
+            return pool->replicatedKeys;
+        }
+    default:
+        return 0;
+    }
+}
+
+int wh_ClientPool_CryptoCb(int devId, wc_CryptoInfo* info, void* ctx)
+{
+    whClientPool* pool = ctx;
+    whClientContext* client = NULL;
+    uint32_t token = 0;
+    int primary = 0;
+    int attempt = 0;
+    int ret = 0;
+
+    if ((pool == NULL) || (info == NULL)) {
+        return BAD_FUNC_ARG;
+    }
+
+    /* Operations that depend on server state stay on one server */
+    primary = !_IsStateless(pool, info);
+
+    for (attempt = 0; attempt < pool->count; attempt++) {
+        /* Members are released by other threads, so only retry once the
+         * application has waited for that */
+        ret = _Acquire(pool, primary, &client, &token);
+        while ((ret == WH_ERROR_NOTREADY) && (pool->waitCb != NULL)) {
+            ret = pool->waitCb(pool->waitContext);
+            if (ret == 0) {
+                ret = _Acquire(pool, primary, &client, &token);
+            }
+        }
+        if (ret != 0) {
+            break;
+        }
+
+        ret = wolfHSM_CryptoCb(devId, info, client);
+        (void)wh_ClientPool_Release(pool, client, token, ret);
+
+        if ((ret != WH_ERROR_ABORTED) || primary) {
+            /* Done, or state would be lost by moving to another server */
+            break;
+        }
+    }
+    return ret;
+}
+
+int wh_ClientPool_RegisterCryptoCb(whClientPool* pool, int devId)
+{
+    if ((pool == NULL) || (devId == WOLFHSM_DEV_ID)) {
+        return WH_ERROR_BADARGS;
+    }
+    return wc_CryptoCb_RegisterDevice(devId, wh_ClientPool_CryptoCb, pool);
+}
+#endif /* !WOLFHSM_NO_CRYPTO */
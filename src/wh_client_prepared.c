@@ -0,0 +1,340 @@
+/*
+ * Copyright (C) 2024 wolfSSL Inc.
+ *
+ * This file is part of wolfHSM.
+ *
+ * wolfHSM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfHSM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wolfHSM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * src/wh_client_prepared.c
+ */
+
+/* System libraries */
+#include <stdint.h>
+#include <stdlib.h>  /* For NULL */
+#include <string.h>  /* For memset, memcpy */
+
+/* Common WolfHSM types and defines shared with the server */
+#include "wolfhsm/wh_error.h"
+#include "wolfhsm/wh_comm.h"
+
+#include "wolfhsm/wh_message.h"
+#include "wolfhsm/wh_message_prepared.h"
+
+#include "wolfhsm/wh_client.h"
+#include "wolfhsm/wh_client_prepared.h"
+
+/** Prepared Prepare */
+int wh_Client_PrepareAesGcmRequest(whClientContext* c, whKeyId key_id,
+        uint8_t enc, uint8_t iv_len, uint8_t tag_len)
+{
+    whMessagePrepared_PrepareRequest msg = {0};
+
+    if (c == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+
+    msg.key_id = key_id;
+    msg.alg = WH_PREPARED_ALG_AESGCM;
+    msg.enc = (enc != 0);
+    msg.iv_len = iv_len;
+    msg.tag_len = tag_len;
+
+    return wh_Client_SendRequest(c,
+            WH_MESSAGE_GROUP_PREPARED, WH_MESSAGE_PREPARED_ACTION_PREPARE,
+            sizeof(msg), &msg);
+}
+
+int wh_Client_PrepareEccSignRequest(whClientContext* c, whKeyId key_id,
+        int32_t curve_id)
+{
+    whMessagePrepared_PrepareRequest msg = {0};
+
+    if (c == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+
+    msg.key_id = key_id;
+    msg.alg = WH_PREPARED_ALG_ECDSA_SIGN;
+    msg.curve_id = curve_id;
+
+    return wh_Client_SendRequest(c,
+            WH_MESSAGE_GROUP_PREPARED, WH_MESSAGE_PREPARED_ACTION_PREPARE,
+            sizeof(msg), &msg);
+}
+
+int wh_Client_PrepareResponse(whClientContext* c, int32_t* out_rc,
+        uint16_t* out_handle)
+{
+    whMessagePrepared_PrepareResponse msg = {0};
+    int rc = 0;
+    uint16_t resp_group = 0;
+    uint16_t resp_action = 0;
+    uint16_t resp_size = 0;
+
+    if (c == NULL){
+        return WH_ERROR_BADARGS;
+    }
+
+    rc = wh_Client_RecvResponse(c,
+            &resp_group, &resp_action,
+            &resp_size, &msg);
+    if (rc == 0) {
+        /* Validate response */
+        if (    (resp_group != WH_MESSAGE_GROUP_PREPARED) ||
+                (resp_action != WH_MESSAGE_PREPARED_ACTION_PREPARE) ||
+                (resp_size != sizeof(msg)) ){
+            /* Invalid message */
+            rc = WH_ERROR_ABORTED;
+        } else {
+            /* Valid message */
+            if (out_rc != NULL) {
+                *out_rc = msg.rc;
+            }
+            if (out_handle != NULL) {
+                *out_handle = msg.handle;
+            }
+        }
+    }
+    return rc;
+}
+
+int wh_Client_PrepareAesGcm(whClientContext* c, whKeyId key_id,
+        uint8_t enc, uint8_t iv_len, uint8_t tag_len, int32_t* out_rc,
+        uint16_t* out_handle)
+{
+    int rc = 0;
+
+    if (c == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+
+    do {
+        rc = wh_Client_PrepareAesGcmRequest(c, key_id, enc, iv_len,
+                tag_len);
+    } while (rc == WH_ERROR_NOTREADY);
+
+    if (rc == 0) {
+        do {
+            rc = wh_Client_PrepareResponse(c, out_rc, out_handle);
+        } while (rc == WH_ERROR_NOTREADY);
+    }
+    return rc;
+}
+
+int wh_Client_PrepareEccSign(whClientContext* c, whKeyId key_id,
+        int32_t curve_id, int32_t* out_rc, uint16_t* out_handle)
+{
+    int rc = 0;
+
+    if (c == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+
+    do {
+        rc = wh_Client_PrepareEccSignRequest(c, key_id, curve_id);
+    } while (rc == WH_ERROR_NOTREADY);
+
+    if (rc == 0) {
+        do {
+            rc = wh_Client_PrepareResponse(c, out_rc, out_handle);
+        } while (rc == WH_ERROR_NOTREADY);
+    }
+    return rc;
+}
+
+/** Prepared Exec */
+int wh_Client_PreparedExecRequest(whClientContext* c, uint16_t handle,
+        const uint8_t* iv, uint16_t iv_len, const uint8_t* aad,
+        uint16_t aad_len, const uint8_t* in, uint16_t in_len,
+        const uint8_t* tag, uint16_t tag_len)
+{
+    uint8_t buffer[WH_COMM_DATA_LEN] = {0};
+    whMessagePrepared_ExecRequest* msg =
+            (whMessagePrepared_ExecRequest*)buffer;
+    uint16_t hdr_len = sizeof(*msg);
+    uint8_t* payload = buffer + hdr_len;
+    uint32_t payload_len = (uint32_t)iv_len + aad_len + in_len + tag_len;
+
+    if (    (c == NULL) ||
+            ((iv == NULL) && (iv_len != 0)) ||
+            ((aad == NULL) && (aad_len != 0)) ||
+            ((in == NULL) && (in_len != 0)) ||
+            ((tag == NULL) && (tag_len != 0)) ||
+            (payload_len > WH_MESSAGE_PREPARED_MAX_INLINE_LEN) ) {
+        return WH_ERROR_BADARGS;
+    }
+
+    msg->handle = handle;
+    msg->aad_len = aad_len;
+    msg->data_len = in_len;
+    if (iv_len > 0) {
+        memcpy(payload, iv, iv_len);
+    }
+    if (aad_len > 0) {
+        memcpy(payload + iv_len, aad, aad_len);
+    }
+    if (in_len > 0) {
+        memcpy(payload + iv_len + aad_len, in, in_len);
+    }
+    if (tag_len > 0) {
+        memcpy(payload + iv_len + aad_len + in_len, tag, tag_len);
+    }
+
+    return wh_Client_SendRequest(c,
+            WH_MESSAGE_GROUP_PREPARED, WH_MESSAGE_PREPARED_ACTION_EXEC,
+            hdr_len + payload_len, buffer);
+}
+
+int wh_Client_PreparedExecResponse(whClientContext* c, int32_t* out_rc,
+        uint8_t* out, uint16_t* inout_out_len)
+{
+    uint8_t buffer[WH_COMM_DATA_LEN] = {0};
+    whMessagePrepared_ExecResponse* msg =
+            (whMessagePrepared_ExecResponse*)buffer;
+    uint16_t hdr_len = sizeof(*msg);
+    uint8_t* payload = buffer + hdr_len;
+    int rc = 0;
+    uint16_t resp_group = 0;
+    uint16_t resp_action = 0;
+    uint16_t resp_size = 0;
+
+    if (    (c == NULL) ||
+            (inout_out_len == NULL) ||
+            ((out == NULL) && (*inout_out_len != 0)) ) {
+        return WH_ERROR_BADARGS;
+    }
+
+    rc = wh_Client_RecvResponse(c,
+            &resp_group, &resp_action,
+            &resp_size, buffer);
+    if (rc == 0) {
+        /* Validate response */
+        if (    (resp_group != WH_MESSAGE_GROUP_PREPARED) ||
+                (resp_action != WH_MESSAGE_PREPARED_ACTION_EXEC) ||
+                (resp_size < hdr_len) ||
+                (resp_size != hdr_len + msg->data_len) ){
+            /* Invalid message */
+            rc = WH_ERROR_ABORTED;
+        } else if (msg->data_len > *inout_out_len) {
+            /* Output does not fit */
+            rc = WH_ERROR_ABORTED;
+        } else {
+            /* Valid message */
+            if (out_rc != NULL) {
+                *out_rc = msg->rc;
+            }
+            if (msg->data_len > 0) {
+                memcpy(out, payload, msg->data_len);
+            }
+            *inout_out_len = msg->data_len;
+        }
+    }
+    return rc;
+}
+
+int wh_Client_PreparedExec(whClientContext* c, uint16_t handle,
+        const uint8_t* iv, uint16_t iv_len, const uint8_t* aad,
+        uint16_t aad_len, const uint8_t* in, uint16_t in_len,
+        const uint8_t* tag, uint16_t tag_len, uint8_t* out,
+        uint16_t* inout_out_len, int32_t* out_rc)
+{
+    int rc = 0;
+
+    if (c == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+
+    do {
+        rc = wh_Client_PreparedExecRequest(c, handle, iv, iv_len, aad,
+                aad_len, in, in_len, tag, tag_len);
+    } while (rc == WH_ERROR_NOTREADY);
+
+    if (rc == 0) {
+        do {
+            rc = wh_Client_PreparedExecResponse(c, out_rc, out,
+                    inout_out_len);
+        } while (rc == WH_ERROR_NOTREADY);
+    }
+    return rc;
+}
+
+/** Prepared Close */
+int wh_Client_PreparedCloseRequest(whClientContext* c, uint16_t handle)
+{
+    whMessagePrepared_CloseRequest msg = {0};
+
+    if (c == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+
+    msg.handle = handle;
+
+    return wh_Client_SendRequest(c,
+            WH_MESSAGE_GROUP_PREPARED, WH_MESSAGE_PREPARED_ACTION_CLOSE,
+            sizeof(msg), &msg);
+}
+
+int wh_Client_PreparedCloseResponse(whClientContext* c, int32_t* out_rc)
+{
+    whMessagePrepared_CloseResponse msg = {0};
+    int rc = 0;
+    uint16_t resp_group = 0;
+    uint16_t resp_action = 0;
+    uint16_t resp_size = 0;
+
+    if (c == NULL){
+        return WH_ERROR_BADARGS;
+    }
+
+    rc = wh_Client_RecvResponse(c,
+            &resp_group, &resp_action,
+            &resp_size, &msg);
+    if (rc == 0) {
+        /* Validate response */
+        if (    (resp_group != WH_MESSAGE_GROUP_PREPARED) ||
+                (resp_action != WH_MESSAGE_PREPARED_ACTION_CLOSE) ||
+                (resp_size != sizeof(msg)) ){
+            /* Invalid message */
+            rc = WH_ERROR_ABORTED;
+        } else {
+            /* Valid message */
+            if (out_rc != NULL) {
+                *out_rc = msg.rc;
+            }
+        }
+    }
+    return rc;
+}
+
+int wh_Client_PreparedClose(whClientContext* c, uint16_t handle,
+        int32_t* out_rc)
+{
+    int rc = 0;
+
+    if (c == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+
+    do {
+        rc = wh_Client_PreparedCloseRequest(c, handle);
+    } while (rc == WH_ERROR_NOTREADY);
+
+    if (rc == 0) {
+        do {
+            rc = wh_Client_PreparedCloseResponse(c, out_rc);
+        } while (rc == WH_ERROR_NOTREADY);
+    }
+    return rc;
+}
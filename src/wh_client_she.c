@@ -277,6 +277,89 @@ int wh_Client_SheLoadKey(whClientContext* c, uint8_t* messageOne,
     return ret;
 }
 
+int wh_Client_SheLoadKeyBatchRequest(whClientContext* c, uint32_t count,
+    uint8_t* messageOne, uint8_t* messageTwo, uint8_t* messageThree)
+{
+    int ret;
+    uint32_t i;
+    whPacket* packet;
+    wh_Packet_she_load_key_req* entries;
+    if (c == NULL || messageOne == NULL || messageTwo == NULL ||
+        messageThree == NULL || count == 0 ||
+        count > WOLFHSM_SHE_LOAD_KEY_BATCH_MAX) {
+        return WH_ERROR_BADARGS;
+    }
+    packet = (whPacket*)wh_CommClient_GetDataPtr(c->comm);
+    /* the update sets are after the fixed fields */
+    entries = (wh_Packet_she_load_key_req*)(&packet->sheLoadKeyBatchReq + 1);
+    packet->sheLoadKeyBatchReq.count = count;
+    /* copy in messages 1-3 of each set */
+    for (i = 0; i < count; i++) {
+        memcpy(entries[i].messageOne, messageOne + i * WOLFHSM_SHE_M1_SZ,
+            sizeof(entries[i].messageOne));
+        memcpy(entries[i].messageTwo, messageTwo + i * WOLFHSM_SHE_M2_SZ,
+            sizeof(entries[i].messageTwo));
+        memcpy(entries[i].messageThree, messageThree + i * WOLFHSM_SHE_M3_SZ,
+            sizeof(entries[i].messageThree));
+    }
+    /* send load key batch req */
+    ret = wh_Client_SendRequest(c, WH_MESSAGE_GROUP_SHE,
+        WH_SHE_LOAD_KEY_BATCH, WOLFHSM_PACKET_STUB_SIZE +
+        sizeof(packet->sheLoadKeyBatchReq) + count * sizeof(*entries),
+        (uint8_t*)packet);
+    return ret;
+}
+
+int wh_Client_SheLoadKeyBatchResponse(whClientContext* c, uint32_t count,
+    uint8_t* messageFour, uint8_t* messageFive)
+{
+    int ret;
+    uint32_t i;
+    uint16_t group;
+    uint16_t action;
+    uint16_t dataSz;
+    whPacket* packet;
+    wh_Packet_she_load_key_res* entries;
+    if (c == NULL || messageFour == NULL || messageFive == NULL)
+        return WH_ERROR_BADARGS;
+    packet = (whPacket*)wh_CommClient_GetDataPtr(c->comm);
+    ret = wh_Client_RecvResponse(c, &group, &action, &dataSz, (uint8_t*)packet);
+    if (ret == 0) {
+        if (packet->rc != WOLFHSM_SHE_ERC_NO_ERROR)
+            ret = packet->rc;
+        else if (packet->sheLoadKeyBatchRes.count != count)
+            ret = WH_ERROR_ABORTED;
+        else {
+            /* copy out message 4 and 5 of each set */
+            entries = (wh_Packet_she_load_key_res*)
+                (&packet->sheLoadKeyBatchRes + 1);
+            for (i = 0; i < count; i++) {
+                memcpy(messageFour + i * WOLFHSM_SHE_M4_SZ,
+                    entries[i].messageFour, sizeof(entries[i].messageFour));
+                memcpy(messageFive + i * WOLFHSM_SHE_M5_SZ,
+                    entries[i].messageFive, sizeof(entries[i].messageFive));
+            }
+        }
+    }
+    return ret;
+}
+
+int wh_Client_SheLoadKeyBatch(whClientContext* c, uint32_t count,
+    uint8_t* messageOne, uint8_t* messageTwo, uint8_t* messageThree,
+    uint8_t* messageFour, uint8_t* messageFive)
+{
+    int ret;
+    ret = wh_Client_SheLoadKeyBatchRequest(c, count, messageOne, messageTwo,
+        messageThree);
+    if (ret == 0) {
+        do {
+            ret = wh_Client_SheLoadKeyBatchResponse(c, count, messageFour,
+                messageFive);
+        } while (ret == WH_ERROR_NOTREADY);
+    }
+    return ret;
+}
+
 int wh_Client_SheLoadPlainKeyRequest(whClientContext* c, uint8_t* key,
     uint32_t keySz)
 {
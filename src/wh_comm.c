@@ -80,6 +80,7 @@ int wh_CommClient_Init(whCommClient* context, const whCommClientConfig* config)
     context->transport_context = config->transport_context;
     context->client_id = config->client_id;
     context->connect_cb = config->connect_cb;
+    context->request_timing = (config->request_timing != 0);
     if (context->transport_cb->Init != NULL) {
         rc = context->transport_cb->Init(context->transport_context,
                 config->transport_config, NULL, NULL);
@@ -117,6 +118,9 @@ int wh_CommClient_SendRequest(whCommClient* context, uint16_t magic,
         context->hdr->magic = magic;
         context->hdr->kind = wh_Translate16(magic, kind);
         context->hdr->seq = wh_Translate16(magic, context->seq + 1);
+        context->hdr->aux = wh_Translate16(magic,
+                (context->request_timing != 0) ?
+                        WH_COMM_AUX_REQ_TIMING : WH_COMM_AUX_REQ_NORMAL);
         if (    (data != NULL) &&
                 (data_size != 0) &&
                 (data != context->data)) {
@@ -144,8 +148,10 @@ int wh_CommClient_RecvResponse(whCommClient* context,
     uint16_t magic = 0;
     uint16_t kind = 0;
     uint16_t seq = 0;
+    uint16_t aux = 0;
     uint16_t size = sizeof(context->packet);
     uint16_t data_size = 0;
+    whCommTiming timing;
 
     if (context == NULL) {
         return WH_ERROR_BADARGS;
@@ -164,6 +170,21 @@ int wh_CommClient_RecvResponse(whCommClient* context,
                 magic = context->hdr->magic;
                 kind = wh_Translate16(magic, context->hdr->kind);
                 seq = wh_Translate16(magic, context->hdr->seq);
+                aux = wh_Translate16(magic, context->hdr->aux);
+
+                /* Strip the server timing trailer, if present */
+                context->server_timing_valid = 0;
+                if (    (aux == WH_COMM_AUX_RESP_TIMING) &&
+                        (data_size >= sizeof(timing))) {
+                    data_size -= sizeof(timing);
+                    memcpy(&timing, context->data + data_size,
+                            sizeof(timing));
+                    context->server_timing.recv_to_dispatch =
+                            wh_Translate32(magic, timing.recv_to_dispatch);
+                    context->server_timing.dispatch_to_send =
+                            wh_Translate32(magic, timing.dispatch_to_send);
+                    context->server_timing_valid = 1;
+                }
                 if (    (data != NULL) &&
                         (data_size != 0) &&
                         (data != context->data)) {
@@ -190,6 +211,29 @@ uint8_t* wh_CommClient_GetDataPtr(whCommClient* context)
     return context->data;
 }
 
+int wh_CommClient_SetTiming(whCommClient* context, int enable)
+{
+    if (context == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+    context->request_timing = (enable != 0);
+    return 0;
+}
+
+int wh_CommClient_GetServerTiming(whCommClient* context,
+        whCommTiming* out_timing)
+{
+    if (    (context == NULL) ||
+            (out_timing == NULL) ) {
+        return WH_ERROR_BADARGS;
+    }
+    if (context->server_timing_valid == 0) {
+        return WH_ERROR_NOTFOUND;
+    }
+    *out_timing = context->server_timing;
+    return 0;
+}
+
 /* Inform the server that no further communications are necessary and any
  * unfinished requests can be ignored.
  */
@@ -236,6 +280,10 @@ int wh_CommServer_Init(whCommServer* context, const whCommServerConfig* config,
     context->transport_context = config->transport_context;
     context->transport_cb = config->transport_cb;
     context->server_id = config->server_id;
+    context->time_cb = config->time_cb;
+    context->time_context = config->time_context;
+    context->capture_cb = config->capture_cb;
+    context->capture_context = config->capture_context;
     if (context->transport_cb->Init != NULL) {
         rc = context->transport_cb->Init(context->transport_context,
                 config->transport_config, connectcb, connectcb_arg);
@@ -259,6 +307,7 @@ int wh_CommServer_RecvRequest(whCommServer* context,
     uint16_t seq = 0;
     uint16_t size = sizeof(context->packet);
     uint16_t data_size = 0;
+    int repeat = 0;
 
     if (    (context == NULL) ||
             (data == NULL)) {
@@ -280,6 +329,28 @@ int wh_CommServer_RecvRequest(whCommServer* context,
                 kind = wh_Translate16(magic, context->hdr->kind);
                 seq = wh_Translate16(magic, context->hdr->seq);
 
+                /* Mailbox transports deliver an unanswered request again on
+                 * every poll, such as while its handler is deferred */
+                repeat = (context->req_open != 0) &&
+                        (context->req_kind == kind) &&
+                        (context->req_seq == seq);
+                context->req_open = 1;
+                context->req_kind = kind;
+                context->req_seq = seq;
+
+                /* Start the clock if the client asked for timing.  A
+                 * request delivered again keeps its first receive time */
+                if (repeat == 0) {
+                    context->timing = (context->time_cb != NULL) &&
+                            (wh_Translate16(magic, context->hdr->aux) ==
+                                    WH_COMM_AUX_REQ_TIMING);
+                    if (context->timing != 0) {
+                        context->recv_time =
+                                context->time_cb(context->time_context);
+                        context->dispatch_time = context->recv_time;
+                    }
+                }
+
                 /* Copy the data from the internal buffer if necessary */
                 if (    (data != NULL) &&
                         (data_size != 0) &&
@@ -290,6 +361,13 @@ int wh_CommServer_RecvRequest(whCommServer* context,
                 if (out_kind != NULL) *out_kind = kind;
                 if (out_seq != NULL) *out_seq = seq;
                 if (out_size != NULL) *out_size = data_size;
+
+                if (    (context->capture_cb != NULL) &&
+                        (repeat == 0) ) {
+                    (void)context->capture_cb(context->capture_context,
+                            WH_COMM_CAPTURE_REQUEST, magic, kind, seq,
+                            data_size, context->data);
+                }
             } else {
                 /* Size is too small */
                 rc = WH_ERROR_ABORTED;
@@ -304,6 +382,10 @@ int wh_CommServer_SendResponse(whCommServer* context,
         uint16_t data_size, const void* data)
 {
     int rc = WH_ERROR_NOTREADY;
+    uint16_t aux = WH_COMM_AUX_RESP_OK;
+    uint16_t payload_size = 0;
+    uint64_t now = 0;
+    whCommTiming timing;
 
     if (context == NULL) {
         return WH_ERROR_BADARGS;
@@ -323,9 +405,34 @@ int wh_CommServer_SendResponse(whCommServer* context,
                 (data != context->data) ) {
             memcpy(context->data, data, data_size);
         }
+
+        /* Append server timing if requested and there is room */
+        payload_size = data_size;
+        if (    (context->timing != 0) &&
+                (data_size <= WH_COMM_DATA_LEN - sizeof(timing))) {
+            now = context->time_cb(context->time_context);
+            timing.recv_to_dispatch = wh_Translate32(magic,
+                    (uint32_t)(context->dispatch_time - context->recv_time));
+            timing.dispatch_to_send = wh_Translate32(magic,
+                    (uint32_t)(now - context->dispatch_time));
+            memcpy(context->data + data_size, &timing, sizeof(timing));
+            data_size += sizeof(timing);
+            aux = WH_COMM_AUX_RESP_TIMING;
+        }
+        context->hdr->aux = wh_Translate16(magic, aux);
+
         rc = context->transport_cb->Send(context->transport_context,
                 sizeof(*(context->hdr)) + data_size,
                 context->packet);
+        if (rc == 0) {
+            context->timing = 0;
+            context->req_open = 0;
+            if (context->capture_cb != NULL) {
+                (void)context->capture_cb(context->capture_context,
+                        WH_COMM_CAPTURE_RESPONSE, magic, kind, seq,
+                        payload_size, context->data);
+            }
+        }
     }
     return rc;
 }
@@ -338,6 +445,33 @@ uint8_t* wh_CommServer_GetDataPtr(whCommServer* context)
     return context->data;
 }
 
+int wh_CommServer_MarkDispatch(whCommServer* context)
+{
+    if (context == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+    if (context->timing != 0) {
+        context->dispatch_time = context->time_cb(context->time_context);
+    }
+    return 0;
+}
+
+
+int wh_CommServer_GetBulk(whCommServer* context, uint32_t offset,
+        uint32_t size, void** out_ptr)
+{
+    if (    (context == NULL) ||
+            (out_ptr == NULL) ) {
+        return WH_ERROR_BADARGS;
+    }
+
+    if (    (context->transport_cb == NULL) ||
+            (context->transport_cb->GetBulk == NULL) ) {
+        return WH_ERROR_NOHANDLER;
+    }
+    return context->transport_cb->GetBulk(context->transport_context,
+            offset, size, out_ptr);
+}
 
 int wh_CommServer_Cleanup(whCommServer* context)
 {
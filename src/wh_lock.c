@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2024 wolfSSL Inc.
+ *
+ * This file is part of wolfHSM.
+ *
+ * wolfHSM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfHSM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wolfHSM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * src/wh_lock.c
+ *
+ * Reader-writer lock helpers that fall back to no-ops when unconfigured
+ *
+ */
+
+#include <stddef.h>     /* For NULL */
+#include <string.h>     /* For memset */
+
+#include "wolfhsm/wh_error.h"
+#include "wolfhsm/wh_lock.h"
+
+
+int wh_Lock_Init(whLock* lock, const whLockConfig* config)
+{
+    int rc = 0;
+
+    if (lock == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+
+    memset(lock, 0, sizeof(*lock));
+    if ((config == NULL) || (config->cb == NULL)) {
+        /* No locking */
+        return 0;
+    }
+
+    if (config->cb->Init != NULL) {
+        rc = config->cb->Init(config->context, config->config);
+    }
+    if (rc == 0) {
+        lock->cb = config->cb;
+        lock->context = config->context;
+    }
+    return rc;
+}
+
+int wh_Lock_Cleanup(whLock* lock)
+{
+    int rc = 0;
+
+    if (lock == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+
+    if ((lock->cb != NULL) && (lock->cb->Cleanup != NULL)) {
+        rc = lock->cb->Cleanup(lock->context);
+    }
+    memset(lock, 0, sizeof(*lock));
+    return rc;
+}
+
+int wh_Lock_AcquireRead(whLock* lock)
+{
+    if (    (lock == NULL) ||
+            (lock->cb == NULL) ||
+            (lock->cb->ReadLock == NULL) ) {
+        return 0;
+    }
+    return lock->cb->ReadLock(lock->context);
+}
+
+int wh_Lock_ReleaseRead(whLock* lock)
+{
+    if (    (lock == NULL) ||
+            (lock->cb == NULL) ||
+            (lock->cb->ReadUnlock == NULL) ) {
+        return 0;
+    }
+    return lock->cb->ReadUnlock(lock->context);
+}
+
+int wh_Lock_AcquireWrite(whLock* lock)
+{
+    if (    (lock == NULL) ||
+            (lock->cb == NULL) ||
+            (lock->cb->WriteLock == NULL) ) {
+        return 0;
+    }
+    return lock->cb->WriteLock(lock->context);
+}
+
+int wh_Lock_ReleaseWrite(whLock* lock)
+{
+    if (    (lock == NULL) ||
+            (lock->cb == NULL) ||
+            (lock->cb->WriteUnlock == NULL) ) {
+        return 0;
+    }
+    return lock->cb->WriteUnlock(lock->context);
+}
@@ -0,0 +1,82 @@
+/*
+ * Copyright (C) 2024 wolfSSL Inc.
+ *
+ * This file is part of wolfHSM.
+ *
+ * wolfHSM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfHSM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wolfHSM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * src/wh_message_cert.c
+ *
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "wolfhsm/wh_comm.h"
+
+#include "wolfhsm/wh_message.h"
+#include "wolfhsm/wh_message_cert.h"
+
+#include "wolfhsm/wh_error.h"
+
+int wh_MessageCert_TranslateVerifyRequest(uint16_t magic,
+        const whMessageCert_VerifyRequest* src,
+        whMessageCert_VerifyRequest* dest)
+{
+    if ((src == NULL) || (dest == NULL)) {
+        return WH_ERROR_BADARGS;
+    }
+    WH_T16(magic, dest, src, trusted_id);
+    WH_T16(magic, dest, src, chain_len);
+    return 0;
+}
+
+int wh_MessageCert_TranslateVerifyResponse(uint16_t magic,
+        const whMessageCert_VerifyResponse* src,
+        whMessageCert_VerifyResponse* dest)
+{
+    if ((src == NULL) || (dest == NULL)) {
+        return WH_ERROR_BADARGS;
+    }
+    WH_T32(magic, dest, src, rc);
+    WH_T16(magic, dest, src, depth);
+    return 0;
+}
+
+int wh_MessageCert_TranslateVerifyDma32Request(uint16_t magic,
+        const whMessageCert_VerifyDma32Request* src,
+        whMessageCert_VerifyDma32Request* dest)
+{
+    if ((src == NULL) || (dest == NULL)) {
+        return WH_ERROR_BADARGS;
+    }
+    WH_T32(magic, dest, src, chain_hostaddr);
+    WH_T32(magic, dest, src, chain_len);
+    WH_T16(magic, dest, src, trusted_id);
+    return 0;
+}
+
+int wh_MessageCert_TranslateVerifyDma64Request(uint16_t magic,
+        const whMessageCert_VerifyDma64Request* src,
+        whMessageCert_VerifyDma64Request* dest)
+{
+    if ((src == NULL) || (dest == NULL)) {
+        return WH_ERROR_BADARGS;
+    }
+    WH_T64(magic, dest, src, chain_hostaddr);
+    WH_T32(magic, dest, src, chain_len);
+    WH_T16(magic, dest, src, trusted_id);
+    return 0;
+}
@@ -0,0 +1,155 @@
+/*
+ * Copyright (C) 2024 wolfSSL Inc.
+ *
+ * This file is part of wolfHSM.
+ *
+ * wolfHSM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfHSM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wolfHSM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * src/wh_message_chacha.c
+ *
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>  /* For memcpy */
+
+#include "wolfhsm/wh_comm.h"
+
+#include "wolfhsm/wh_message.h"
+#include "wolfhsm/wh_message_chacha.h"
+
+#include "wolfhsm/wh_error.h"
+
+int wh_MessageChaCha_TranslateCryptRequest(uint16_t magic,
+        const whMessageChaCha_CryptRequest* src,
+        whMessageChaCha_CryptRequest* dest)
+{
+    if ((src == NULL) || (dest == NULL)) {
+        return WH_ERROR_BADARGS;
+    }
+    WH_T16(magic, dest, src, key_id);
+    WH_T16(magic, dest, src, aad_len);
+    WH_T16(magic, dest, src, data_len);
+    dest->enc = src->enc;
+    memcpy(dest->iv, src->iv, sizeof(dest->iv));
+    memcpy(dest->tag, src->tag, sizeof(dest->tag));
+    return 0;
+}
+
+int wh_MessageChaCha_TranslateCryptResponse(uint16_t magic,
+        const whMessageChaCha_CryptResponse* src,
+        whMessageChaCha_CryptResponse* dest)
+{
+    if ((src == NULL) || (dest == NULL)) {
+        return WH_ERROR_BADARGS;
+    }
+    WH_T32(magic, dest, src, rc);
+    WH_T16(magic, dest, src, data_len);
+    memcpy(dest->tag, src->tag, sizeof(dest->tag));
+    return 0;
+}
+
+int wh_MessageChaCha_TranslateInitRequest(uint16_t magic,
+        const whMessageChaCha_InitRequest* src,
+        whMessageChaCha_InitRequest* dest)
+{
+    if ((src == NULL) || (dest == NULL)) {
+        return WH_ERROR_BADARGS;
+    }
+    WH_T16(magic, dest, src, key_id);
+    dest->enc = src->enc;
+    memcpy(dest->iv, src->iv, sizeof(dest->iv));
+    return 0;
+}
+
+int wh_MessageChaCha_TranslateInitResponse(uint16_t magic,
+        const whMessageChaCha_InitResponse* src,
+        whMessageChaCha_InitResponse* dest)
+{
+    if ((src == NULL) || (dest == NULL)) {
+        return WH_ERROR_BADARGS;
+    }
+    WH_T32(magic, dest, src, rc);
+    WH_T16(magic, dest, src, session);
+    return 0;
+}
+
+int wh_MessageChaCha_TranslateUpdateRequest(uint16_t magic,
+        const whMessageChaCha_UpdateRequest* src,
+        whMessageChaCha_UpdateRequest* dest)
+{
+    if ((src == NULL) || (dest == NULL)) {
+        return WH_ERROR_BADARGS;
+    }
+    WH_T16(magic, dest, src, session);
+    WH_T16(magic, dest, src, aad_len);
+    WH_T16(magic, dest, src, data_len);
+    return 0;
+}
+
+int wh_MessageChaCha_TranslateUpdateResponse(uint16_t magic,
+        const whMessageChaCha_UpdateResponse* src,
+        whMessageChaCha_UpdateResponse* dest)
+{
+    if ((src == NULL) || (dest == NULL)) {
+        return WH_ERROR_BADARGS;
+    }
+    WH_T32(magic, dest, src, rc);
+    WH_T16(magic, dest, src, data_len);
+    return 0;
+}
+
+int wh_MessageChaCha_TranslateFinalRequest(uint16_t magic,
+        const whMessageChaCha_FinalRequest* src,
+        whMessageChaCha_FinalRequest* dest)
+{
+    if ((src == NULL) || (dest == NULL)) {
+        return WH_ERROR_BADARGS;
+    }
+    WH_T16(magic, dest, src, session);
+    memcpy(dest->tag, src->tag, sizeof(dest->tag));
+    return 0;
+}
+
+int wh_MessageChaCha_TranslateTagResponse(uint16_t magic,
+        const whMessageChaCha_TagResponse* src,
+        whMessageChaCha_TagResponse* dest)
+{
+    if ((src == NULL) || (dest == NULL)) {
+        return WH_ERROR_BADARGS;
+    }
+    WH_T32(magic, dest, src, rc);
+    memcpy(dest->tag, src->tag, sizeof(dest->tag));
+    return 0;
+}
+
+int wh_MessageChaCha_TranslateCryptDmaRequest(uint16_t magic,
+        const whMessageChaCha_CryptDmaRequest* src,
+        whMessageChaCha_CryptDmaRequest* dest)
+{
+    if ((src == NULL) || (dest == NULL)) {
+        return WH_ERROR_BADARGS;
+    }
+    WH_T64(magic, dest, src, aad_hostaddr);
+    WH_T64(magic, dest, src, in_hostaddr);
+    WH_T64(magic, dest, src, out_hostaddr);
+    WH_T32(magic, dest, src, aad_len);
+    WH_T32(magic, dest, src, data_len);
+    WH_T16(magic, dest, src, key_id);
+    dest->enc = src->enc;
+    memcpy(dest->iv, src->iv, sizeof(dest->iv));
+    memcpy(dest->tag, src->tag, sizeof(dest->tag));
+    return 0;
+}
@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2024 wolfSSL Inc.
+ *
+ * This file is part of wolfHSM.
+ *
+ * wolfHSM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfHSM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wolfHSM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * src/wh_message_image.c
+ *
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "wolfhsm/wh_comm.h"
+
+#include "wolfhsm/wh_message.h"
+#include "wolfhsm/wh_message_image.h"
+
+#include "wolfhsm/wh_error.h"
+
+int wh_MessageImage_TranslateVerifyDma32Request(uint16_t magic,
+        const whMessageImage_VerifyDma32Request* src,
+        whMessageImage_VerifyDma32Request* dest)
+{
+    if ((src == NULL) || (dest == NULL)) {
+        return WH_ERROR_BADARGS;
+    }
+    WH_T32(magic, dest, src, image_hostaddr);
+    WH_T32(magic, dest, src, image_len);
+    WH_T32(magic, dest, src, slice_len);
+    WH_T16(magic, dest, src, key_id);
+    WH_T16(magic, dest, src, curve_id);
+    WH_T16(magic, dest, src, sig_len);
+    dest->hash_type = src->hash_type;
+    return 0;
+}
+
+int wh_MessageImage_TranslateVerifyDma64Request(uint16_t magic,
+        const whMessageImage_VerifyDma64Request* src,
+        whMessageImage_VerifyDma64Request* dest)
+{
+    if ((src == NULL) || (dest == NULL)) {
+        return WH_ERROR_BADARGS;
+    }
+    WH_T64(magic, dest, src, image_hostaddr);
+    WH_T32(magic, dest, src, image_len);
+    WH_T32(magic, dest, src, slice_len);
+    WH_T16(magic, dest, src, key_id);
+    WH_T16(magic, dest, src, curve_id);
+    WH_T16(magic, dest, src, sig_len);
+    dest->hash_type = src->hash_type;
+    return 0;
+}
+
+int wh_MessageImage_TranslateContinueRequest(uint16_t magic,
+        const whMessageImage_ContinueRequest* src,
+        whMessageImage_ContinueRequest* dest)
+{
+    if ((src == NULL) || (dest == NULL)) {
+        return WH_ERROR_BADARGS;
+    }
+    WH_T32(magic, dest, src, slice_len);
+    return 0;
+}
+
+int wh_MessageImage_TranslateVerifyResponse(uint16_t magic,
+        const whMessageImage_VerifyResponse* src,
+        whMessageImage_VerifyResponse* dest)
+{
+    if ((src == NULL) || (dest == NULL)) {
+        return WH_ERROR_BADARGS;
+    }
+    WH_T32(magic, dest, src, rc);
+    WH_T32(magic, dest, src, offset);
+    dest->done = src->done;
+    dest->verified = src->verified;
+    WH_T16(magic, dest, src, digest_len);
+    memcpy(dest->digest, src->digest, sizeof(dest->digest));
+    return 0;
+}
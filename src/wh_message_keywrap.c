@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2024 wolfSSL Inc.
+ *
+ * This file is part of wolfHSM.
+ *
+ * wolfHSM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfHSM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wolfHSM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * src/wh_message_keywrap.c
+ *
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "wolfhsm/wh_comm.h"
+
+#include "wolfhsm/wh_message.h"
+#include "wolfhsm/wh_message_keywrap.h"
+
+#include "wolfhsm/wh_error.h"
+
+int wh_MessageKeyWrap_TranslateExportRequest(uint16_t magic,
+        const whMessageKeyWrap_ExportRequest* src,
+        whMessageKeyWrap_ExportRequest* dest)
+{
+    if ((src == NULL) || (dest == NULL)) {
+        return WH_ERROR_BADARGS;
+    }
+    WH_T16(magic, dest, src, kek_id);
+    WH_T16(magic, dest, src, cursor);
+    WH_T16(magic, dest, src, max_len);
+    return 0;
+}
+
+int wh_MessageKeyWrap_TranslateExportResponse(uint16_t magic,
+        const whMessageKeyWrap_ExportResponse* src,
+        whMessageKeyWrap_ExportResponse* dest)
+{
+    if ((src == NULL) || (dest == NULL)) {
+        return WH_ERROR_BADARGS;
+    }
+    WH_T32(magic, dest, src, rc);
+    WH_T16(magic, dest, src, next_cursor);
+    WH_T16(magic, dest, src, count);
+    WH_T16(magic, dest, src, blob_len);
+    dest->done = src->done;
+    return 0;
+}
+
+int wh_MessageKeyWrap_TranslateImportRequest(uint16_t magic,
+        const whMessageKeyWrap_ImportRequest* src,
+        whMessageKeyWrap_ImportRequest* dest)
+{
+    if ((src == NULL) || (dest == NULL)) {
+        return WH_ERROR_BADARGS;
+    }
+    WH_T16(magic, dest, src, kek_id);
+    WH_T16(magic, dest, src, blob_len);
+    return 0;
+}
+
+int wh_MessageKeyWrap_TranslateImportResponse(uint16_t magic,
+        const whMessageKeyWrap_ImportResponse* src,
+        whMessageKeyWrap_ImportResponse* dest)
+{
+    if ((src == NULL) || (dest == NULL)) {
+        return WH_ERROR_BADARGS;
+    }
+    WH_T32(magic, dest, src, rc);
+    WH_T16(magic, dest, src, count);
+    return 0;
+}
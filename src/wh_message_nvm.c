@@ -166,6 +166,36 @@ int wh_MessageNvm_TranslateDestroyObjectsRequest(uint16_t magic,
     return 0;
 }
 
+int wh_MessageNvm_TranslateDestroyMatchingRequest(uint16_t magic,
+        const whMessageNvm_DestroyMatchingRequest* src,
+        whMessageNvm_DestroyMatchingRequest* dest)
+{
+    if ((src == NULL) || (dest == NULL)) {
+        return WH_ERROR_BADARGS;
+    }
+    WH_T16(magic, dest, src, id_first);
+    WH_T16(magic, dest, src, id_last);
+    WH_T16(magic, dest, src, id_mask);
+    WH_T16(magic, dest, src, id_match);
+    WH_T16(magic, dest, src, access_mask);
+    WH_T16(magic, dest, src, access_match);
+    WH_T16(magic, dest, src, flags_mask);
+    WH_T16(magic, dest, src, flags_match);
+    return 0;
+}
+
+int wh_MessageNvm_TranslateDestroyMatchingResponse(uint16_t magic,
+        const whMessageNvm_DestroyMatchingResponse* src,
+        whMessageNvm_DestroyMatchingResponse* dest)
+{
+    if ((src == NULL) || (dest == NULL)) {
+        return WH_ERROR_BADARGS;
+    }
+    WH_T32(magic, dest, src, rc);
+    WH_T16(magic, dest, src, count);
+    return 0;
+}
+
 int wh_MessageNvm_TranslateReadRequest(uint16_t magic,
         const whMessageNvm_ReadRequest* src,
         whMessageNvm_ReadRequest* dest)
@@ -243,3 +273,30 @@ int wh_MessageNvm_TranslateReadDma64Request(uint16_t magic,
     WH_T16(magic, dest, src, data_len);
     return 0;
 }
+
+int wh_MessageNvm_TranslateAddObjectBulkRequest(uint16_t magic,
+        const whMessageNvm_AddObjectBulkRequest* src,
+        whMessageNvm_AddObjectBulkRequest* dest)
+{
+    if ((src == NULL) || (dest == NULL)) {
+        return WH_ERROR_BADARGS;
+    }
+    WH_T32(magic, dest, src, metadata_offset);
+    WH_T32(magic, dest, src, data_offset);
+    WH_T16(magic, dest, src, data_len);
+    return 0;
+}
+
+int wh_MessageNvm_TranslateReadBulkRequest(uint16_t magic,
+        const whMessageNvm_ReadBulkRequest* src,
+        whMessageNvm_ReadBulkRequest* dest)
+{
+    if ((src == NULL) || (dest == NULL)) {
+        return WH_ERROR_BADARGS;
+    }
+    WH_T32(magic, dest, src, data_offset);
+    WH_T16(magic, dest, src, id);
+    WH_T16(magic, dest, src, offset);
+    WH_T16(magic, dest, src, data_len);
+    return 0;
+}
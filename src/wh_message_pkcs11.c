@@ -0,0 +1,188 @@
+/*
+ * Copyright (C) 2024 wolfSSL Inc.
+ *
+ * This file is part of wolfHSM.
+ *
+ * wolfHSM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfHSM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wolfHSM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * src/wh_message_pkcs11.c
+ *
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "wolfhsm/wh_comm.h"
+
+#include "wolfhsm/wh_message.h"
+#include "wolfhsm/wh_message_pkcs11.h"
+
+#include "wolfhsm/wh_error.h"
+
+int wh_MessagePkcs11_TranslateSimpleResponse(uint16_t magic,
+        const whMessagePkcs11_SimpleResponse* src,
+        whMessagePkcs11_SimpleResponse* dest)
+{
+    if ((src == NULL) || (dest == NULL)) {
+        return WH_ERROR_BADARGS;
+    }
+    WH_T32(magic, dest, src, rc);
+    return 0;
+}
+
+int wh_MessagePkcs11_TranslateSessionRequest(uint16_t magic,
+        const whMessagePkcs11_SessionRequest* src,
+        whMessagePkcs11_SessionRequest* dest)
+{
+    if ((src == NULL) || (dest == NULL)) {
+        return WH_ERROR_BADARGS;
+    }
+    WH_T32(magic, dest, src, session);
+    return 0;
+}
+
+int wh_MessagePkcs11_TranslateOpenSessionRequest(uint16_t magic,
+        const whMessagePkcs11_OpenSessionRequest* src,
+        whMessagePkcs11_OpenSessionRequest* dest)
+{
+    if ((src == NULL) || (dest == NULL)) {
+        return WH_ERROR_BADARGS;
+    }
+    WH_T32(magic, dest, src, flags);
+    return 0;
+}
+
+int wh_MessagePkcs11_TranslateOpenSessionResponse(uint16_t magic,
+        const whMessagePkcs11_OpenSessionResponse* src,
+        whMessagePkcs11_OpenSessionResponse* dest)
+{
+    if ((src == NULL) || (dest == NULL)) {
+        return WH_ERROR_BADARGS;
+    }
+    WH_T32(magic, dest, src, rc);
+    WH_T32(magic, dest, src, session);
+    return 0;
+}
+
+int wh_MessagePkcs11_TranslateFindObjectsInitRequest(uint16_t magic,
+        const whMessagePkcs11_FindObjectsInitRequest* src,
+        whMessagePkcs11_FindObjectsInitRequest* dest)
+{
+    if ((src == NULL) || (dest == NULL)) {
+        return WH_ERROR_BADARGS;
+    }
+    WH_T32(magic, dest, src, session);
+    WH_T16(magic, dest, src, access);
+    WH_T16(magic, dest, src, flags);
+    WH_T16(magic, dest, src, id_min);
+    WH_T16(magic, dest, src, id_max);
+    WH_T16(magic, dest, src, label_len);
+    memcpy(dest->label, src->label, sizeof(dest->label));
+    return 0;
+}
+
+int wh_MessagePkcs11_TranslateFindObjectsRequest(uint16_t magic,
+        const whMessagePkcs11_FindObjectsRequest* src,
+        whMessagePkcs11_FindObjectsRequest* dest)
+{
+    if ((src == NULL) || (dest == NULL)) {
+        return WH_ERROR_BADARGS;
+    }
+    WH_T32(magic, dest, src, session);
+    WH_T16(magic, dest, src, max_count);
+    return 0;
+}
+
+int wh_MessagePkcs11_TranslateFindObjectsResponse(uint16_t magic,
+        const whMessagePkcs11_FindObjectsResponse* src,
+        whMessagePkcs11_FindObjectsResponse* dest)
+{
+    int counter = 0;
+    if ((src == NULL) || (dest == NULL)) {
+        return WH_ERROR_BADARGS;
+    }
+    WH_T32(magic, dest, src, rc);
+    WH_T16(magic, dest, src, count);
+    for (counter = 0; counter < WH_MESSAGE_PKCS11_MAX_FIND_HANDLES; counter++) {
+        WH_T32(magic, dest, src, handles[counter]);
+    }
+    return 0;
+}
+
+int wh_MessagePkcs11_TranslateObjectRequest(uint16_t magic,
+        const whMessagePkcs11_ObjectRequest* src,
+        whMessagePkcs11_ObjectRequest* dest)
+{
+    if ((src == NULL) || (dest == NULL)) {
+        return WH_ERROR_BADARGS;
+    }
+    WH_T32(magic, dest, src, session);
+    WH_T32(magic, dest, src, object);
+    return 0;
+}
+
+int wh_MessagePkcs11_TranslateGetObjectInfoResponse(uint16_t magic,
+        const whMessagePkcs11_GetObjectInfoResponse* src,
+        whMessagePkcs11_GetObjectInfoResponse* dest)
+{
+    if ((src == NULL) || (dest == NULL)) {
+        return WH_ERROR_BADARGS;
+    }
+    WH_T32(magic, dest, src, rc);
+    WH_T16(magic, dest, src, id);
+    WH_T16(magic, dest, src, access);
+    WH_T16(magic, dest, src, flags);
+    WH_T16(magic, dest, src, len);
+    memcpy(dest->label, src->label, sizeof(dest->label));
+    return 0;
+}
+
+int wh_MessagePkcs11_TranslateSignInitRequest(uint16_t magic,
+        const whMessagePkcs11_SignInitRequest* src,
+        whMessagePkcs11_SignInitRequest* dest)
+{
+    if ((src == NULL) || (dest == NULL)) {
+        return WH_ERROR_BADARGS;
+    }
+    WH_T32(magic, dest, src, session);
+    WH_T32(magic, dest, src, object);
+    WH_T32(magic, dest, src, mechanism);
+    return 0;
+}
+
+int wh_MessagePkcs11_TranslateSignDataRequest(uint16_t magic,
+        const whMessagePkcs11_SignDataRequest* src,
+        whMessagePkcs11_SignDataRequest* dest)
+{
+    if ((src == NULL) || (dest == NULL)) {
+        return WH_ERROR_BADARGS;
+    }
+    WH_T32(magic, dest, src, session);
+    WH_T16(magic, dest, src, len);
+    return 0;
+}
+
+int wh_MessagePkcs11_TranslateSignatureResponse(uint16_t magic,
+        const whMessagePkcs11_SignatureResponse* src,
+        whMessagePkcs11_SignatureResponse* dest)
+{
+    if ((src == NULL) || (dest == NULL)) {
+        return WH_ERROR_BADARGS;
+    }
+    WH_T32(magic, dest, src, rc);
+    WH_T16(magic, dest, src, len);
+    return 0;
+}
@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) 2024 wolfSSL Inc.
+ *
+ * This file is part of wolfHSM.
+ *
+ * wolfHSM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfHSM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wolfHSM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * src/wh_message_prepared.c
+ *
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "wolfhsm/wh_comm.h"
+
+#include "wolfhsm/wh_message.h"
+#include "wolfhsm/wh_message_prepared.h"
+
+#include "wolfhsm/wh_error.h"
+
+int wh_MessagePrepared_TranslatePrepareRequest(uint16_t magic,
+        const whMessagePrepared_PrepareRequest* src,
+        whMessagePrepared_PrepareRequest* dest)
+{
+    if ((src == NULL) || (dest == NULL)) {
+        return WH_ERROR_BADARGS;
+    }
+    WH_T32(magic, dest, src, curve_id);
+    WH_T16(magic, dest, src, key_id);
+    dest->alg = src->alg;
+    dest->enc = src->enc;
+    dest->iv_len = src->iv_len;
+    dest->tag_len = src->tag_len;
+    return 0;
+}
+
+int wh_MessagePrepared_TranslatePrepareResponse(uint16_t magic,
+        const whMessagePrepared_PrepareResponse* src,
+        whMessagePrepared_PrepareResponse* dest)
+{
+    if ((src == NULL) || (dest == NULL)) {
+        return WH_ERROR_BADARGS;
+    }
+    WH_T32(magic, dest, src, rc);
+    WH_T16(magic, dest, src, handle);
+    return 0;
+}
+
+int wh_MessagePrepared_TranslateExecRequest(uint16_t magic,
+        const whMessagePrepared_ExecRequest* src,
+        whMessagePrepared_ExecRequest* dest)
+{
+    if ((src == NULL) || (dest == NULL)) {
+        return WH_ERROR_BADARGS;
+    }
+    WH_T16(magic, dest, src, handle);
+    WH_T16(magic, dest, src, aad_len);
+    WH_T16(magic, dest, src, data_len);
+    return 0;
+}
+
+int wh_MessagePrepared_TranslateExecResponse(uint16_t magic,
+        const whMessagePrepared_ExecResponse* src,
+        whMessagePrepared_ExecResponse* dest)
+{
+    if ((src == NULL) || (dest == NULL)) {
+        return WH_ERROR_BADARGS;
+    }
+    WH_T32(magic, dest, src, rc);
+    WH_T16(magic, dest, src, data_len);
+    return 0;
+}
+
+int wh_MessagePrepared_TranslateCloseRequest(uint16_t magic,
+        const whMessagePrepared_CloseRequest* src,
+        whMessagePrepared_CloseRequest* dest)
+{
+    if ((src == NULL) || (dest == NULL)) {
+        return WH_ERROR_BADARGS;
+    }
+    WH_T16(magic, dest, src, handle);
+    return 0;
+}
+
+int wh_MessagePrepared_TranslateCloseResponse(uint16_t magic,
+        const whMessagePrepared_CloseResponse* src,
+        whMessagePrepared_CloseResponse* dest)
+{
+    if ((src == NULL) || (dest == NULL)) {
+        return WH_ERROR_BADARGS;
+    }
+    WH_T32(magic, dest, src, rc);
+    return 0;
+}
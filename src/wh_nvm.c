@@ -29,8 +29,55 @@
 #include "wolfhsm/wh_common.h"
 #include "wolfhsm/wh_error.h"
 
+#include "wolfhsm/wh_lock.h"
 #include "wolfhsm/wh_nvm.h"
 
+/* Number of matching ids destroyed per DestroyObjects call when the backend
+ * has no DestroyMatching callback */
+#define WH_NVM_DESTROY_BATCH (WOLFHSM_NUM_NVMOBJECTS)
+
+/* Initialize the backend of a lazily mounted context on first use.  The
+ * flag is checked again under the lock as another thread may have won */
+static int _wh_Nvm_Mount(whNvmContext* context)
+{
+    int rc = 0;
+
+    if (context->mounted != 0) {
+        return 0;
+    }
+
+    rc = wh_Lock_AcquireWrite(context->lock);
+    if (rc == 0) {
+        if (context->mounted == 0) {
+            if (context->cb->Init != NULL) {
+                rc = context->cb->Init(context->context, context->config);
+            }
+            if (rc == 0) {
+                context->mounted = 1;
+            }
+        }
+        (void)wh_Lock_ReleaseWrite(context->lock);
+    }
+    return rc;
+}
+
+static int _wh_Nvm_AcquireRead(whNvmContext* context)
+{
+    int rc = _wh_Nvm_Mount(context);
+    if (rc == 0) {
+        rc = wh_Lock_AcquireRead(context->lock);
+    }
+    return rc;
+}
+
+static int _wh_Nvm_AcquireWrite(whNvmContext* context)
+{
+    int rc = _wh_Nvm_Mount(context);
+    if (rc == 0) {
+        rc = wh_Lock_AcquireWrite(context->lock);
+    }
+    return rc;
+}
 
 int wh_Nvm_Init(whNvmContext* context, const whNvmConfig *config)
 {
@@ -43,13 +90,28 @@ int wh_Nvm_Init(whNvmContext* context, const whNvmConfig *config)
 
     context->cb = config->cb;
     context->context = config->context;
+    context->config = config->config;
+    context->mounted = 0;
+    /* Contents may differ from any previous instance */
+    context->generation++;
 
-    if (context->cb->Init != NULL) {
-        rc = context->cb->Init(context->context, config->config);
-        if (rc != 0) {
-            context->cb = NULL;
-            context->context = NULL;
+    rc = wh_Lock_Init(context->lock, config->lock_config);
+    if ((rc == 0) && (config->lazy_mount == 0)) {
+        /* Nothing else can see the context yet, so no lock is needed */
+        if (context->cb->Init != NULL) {
+            rc = context->cb->Init(context->context, context->config);
+        }
+        if (rc == 0) {
+            context->mounted = 1;
         }
+        else {
+            (void)wh_Lock_Cleanup(context->lock);
+        }
+    }
+    if (rc != 0) {
+        context->cb = NULL;
+        context->context = NULL;
+        context->config = NULL;
     }
 
     return rc;
@@ -57,6 +119,8 @@ int wh_Nvm_Init(whNvmContext* context, const whNvmConfig *config)
 
 int wh_Nvm_Cleanup(whNvmContext* context)
 {
+    int rc = 0;
+
     if (    (context == NULL) ||
             (context->cb == NULL) ) {
         return WH_ERROR_BADARGS;
@@ -66,13 +130,64 @@ int wh_Nvm_Cleanup(whNvmContext* context)
     if (context->cb->Cleanup == NULL) {
         return WH_ERROR_ABORTED;
     }
-    return context->cb->Cleanup(context->context);
+    if (context->mounted != 0) {
+        rc = context->cb->Cleanup(context->context);
+        context->mounted = 0;
+    }
+    (void)wh_Lock_Cleanup(context->lock);
+    return rc;
+}
+
+int wh_Nvm_Mount(whNvmContext* context)
+{
+    if (    (context == NULL) ||
+            (context->cb == NULL) ) {
+        return WH_ERROR_BADARGS;
+    }
+    return _wh_Nvm_Mount(context);
+}
+
+int wh_Nvm_IsMounted(whNvmContext* context)
+{
+    return (context != NULL) && (context->mounted != 0);
+}
+
+int wh_Nvm_Maintain(whNvmContext* context)
+{
+    int rc = 0;
+
+    if (    (context == NULL) ||
+            (context->cb == NULL) ) {
+        return WH_ERROR_BADARGS;
+    }
+
+    /* Housekeeping never forces a mount */
+    if (    (context->cb->Maintain == NULL) ||
+            (context->mounted == 0) ) {
+        return 0;
+    }
+    rc = wh_Lock_AcquireWrite(context->lock);
+    if (rc == 0) {
+        rc = context->cb->Maintain(context->context);
+        (void)wh_Lock_ReleaseWrite(context->lock);
+    }
+    return rc;
+}
+
+uint32_t wh_Nvm_GetGeneration(whNvmContext* context)
+{
+    if (context == NULL) {
+        return 0;
+    }
+    return context->generation;
 }
 
 int wh_Nvm_GetAvailable(whNvmContext* context,
         uint32_t *out_avail_size, whNvmId *out_avail_objects,
         uint32_t *out_reclaim_size, whNvmId *out_reclaim_objects)
 {
+    int rc = 0;
+
     if (    (context == NULL) ||
             (context->cb == NULL) ) {
         return WH_ERROR_BADARGS;
@@ -82,15 +197,22 @@ int wh_Nvm_GetAvailable(whNvmContext* context,
     if (context->cb->GetAvailable == NULL) {
         return WH_ERROR_ABORTED;
     }
-    return context->cb->GetAvailable(context->context,
-            out_avail_size, out_avail_objects,
-            out_reclaim_size, out_reclaim_objects);
+    rc = _wh_Nvm_AcquireRead(context);
+    if (rc == 0) {
+        rc = context->cb->GetAvailable(context->context,
+                out_avail_size, out_avail_objects,
+                out_reclaim_size, out_reclaim_objects);
+        (void)wh_Lock_ReleaseRead(context->lock);
+    }
+    return rc;
 }
 
 
 int wh_Nvm_AddObject(whNvmContext* context, whNvmMetadata *meta,
         whNvmSize data_len, const uint8_t* data)
 {
+    int rc = 0;
+
     if (    (context == NULL) ||
             (context->cb == NULL) ) {
         return WH_ERROR_BADARGS;
@@ -100,13 +222,91 @@ int wh_Nvm_AddObject(whNvmContext* context, whNvmMetadata *meta,
     if (context->cb->AddObject == NULL) {
         return WH_ERROR_ABORTED;
     }
-    return context->cb->AddObject(context->context, meta, data_len, data);
+    rc = _wh_Nvm_AcquireWrite(context);
+    if (rc == 0) {
+        rc = context->cb->AddObject(context->context, meta, data_len, data);
+        context->generation++;
+        (void)wh_Lock_ReleaseWrite(context->lock);
+    }
+    return rc;
+}
+
+int wh_Nvm_AddObjects(whNvmContext* context, whNvmId list_count,
+        whNvmMetadata* meta_list, const uint8_t* const* data_list)
+{
+    int rc = 0;
+    whNvmId i = 0;
+    uint32_t need_size = 0;
+    uint32_t avail_size = 0;
+    uint32_t reclaim_size = 0;
+    whNvmId avail_objects = 0;
+    whNvmId reclaim_objects = 0;
+
+    if (    (context == NULL) ||
+            (context->cb == NULL) ||
+            ((list_count > 0) &&
+                ((meta_list == NULL) || (data_list == NULL))) ) {
+        return WH_ERROR_BADARGS;
+    }
+
+    if (context->cb->AddObjects != NULL) {
+        /* Backend commits the whole list at once */
+        rc = _wh_Nvm_AcquireWrite(context);
+        if (rc == 0) {
+            rc = context->cb->AddObjects(context->context, list_count,
+                    meta_list, data_list);
+            context->generation++;
+            (void)wh_Lock_ReleaseWrite(context->lock);
+        }
+        return rc;
+    }
+
+    /* No callback? Return ABORTED */
+    if (    (context->cb->AddObject == NULL) ||
+            (context->cb->GetAvailable == NULL) ) {
+        return WH_ERROR_ABORTED;
+    }
+
+    for (i = 0; i < list_count; i++) {
+        need_size += meta_list[i].len;
+    }
+
+    /* Hold the lock across the space check and every add */
+    rc = _wh_Nvm_AcquireWrite(context);
+    if (rc != 0) {
+        return rc;
+    }
+
+    rc = context->cb->GetAvailable(context->context,
+            &avail_size, &avail_objects, &reclaim_size, &reclaim_objects);
+    if (    (rc == 0) &&
+            ((avail_size < need_size) || (avail_objects < list_count)) ) {
+        if (    (avail_size + reclaim_size < need_size) ||
+                (avail_objects + reclaim_objects < list_count) ||
+                (context->cb->DestroyObjects == NULL) ) {
+            rc = WH_ERROR_NOSPACE;
+        }
+        else {
+            /* Regenerate the partition once rather than per object */
+            rc = context->cb->DestroyObjects(context->context, 0, NULL);
+        }
+    }
+
+    for (i = 0; (rc == 0) && (i < list_count); i++) {
+        rc = context->cb->AddObject(context->context, &meta_list[i],
+                meta_list[i].len, data_list[i]);
+    }
+    context->generation++;
+    (void)wh_Lock_ReleaseWrite(context->lock);
+    return rc;
 }
 
 int wh_Nvm_List(whNvmContext* context,
         whNvmAccess access, whNvmFlags flags, whNvmId start_id,
         whNvmId *out_count, whNvmId *out_id)
 {
+    int rc = 0;
+
     if (    (context == NULL) ||
             (context->cb == NULL) ) {
         return WH_ERROR_BADARGS;
@@ -116,13 +316,20 @@ int wh_Nvm_List(whNvmContext* context,
     if (context->cb->List == NULL) {
         return WH_ERROR_ABORTED;
     }
-    return context->cb->List(context->context, access, flags, start_id,
-            out_count, out_id);
+    rc = _wh_Nvm_AcquireRead(context);
+    if (rc == 0) {
+        rc = context->cb->List(context->context, access, flags, start_id,
+                out_count, out_id);
+        (void)wh_Lock_ReleaseRead(context->lock);
+    }
+    return rc;
 }
 
 int wh_Nvm_GetMetadata(whNvmContext* context, whNvmId id,
         whNvmMetadata* meta)
 {
+    int rc = 0;
+
     if (    (context == NULL) ||
             (context->cb == NULL) ) {
         return WH_ERROR_BADARGS;
@@ -132,13 +339,20 @@ int wh_Nvm_GetMetadata(whNvmContext* context, whNvmId id,
     if (context->cb->GetMetadata == NULL) {
         return WH_ERROR_ABORTED;
     }
-    return context->cb->GetMetadata(context->context, id, meta);
+    rc = _wh_Nvm_AcquireRead(context);
+    if (rc == 0) {
+        rc = context->cb->GetMetadata(context->context, id, meta);
+        (void)wh_Lock_ReleaseRead(context->lock);
+    }
+    return rc;
 }
 
 
 int wh_Nvm_DestroyObjects(whNvmContext* context, whNvmId list_count,
         const whNvmId* id_list)
 {
+    int rc = 0;
+
     if (    (context == NULL) ||
             (context->cb == NULL) ) {
         return WH_ERROR_BADARGS;
@@ -148,13 +362,116 @@ int wh_Nvm_DestroyObjects(whNvmContext* context, whNvmId list_count,
     if (context->cb->DestroyObjects == NULL) {
         return WH_ERROR_ABORTED;
     }
-    return context->cb->DestroyObjects(context->context, list_count, id_list);
+    rc = _wh_Nvm_AcquireWrite(context);
+    if (rc == 0) {
+        rc = context->cb->DestroyObjects(context->context, list_count,
+                id_list);
+        context->generation++;
+        (void)wh_Lock_ReleaseWrite(context->lock);
+    }
+    return rc;
 }
 
+int wh_Nvm_FilterMatches(const whNvmFilter* filter,
+        const whNvmMetadata* meta)
+{
+    if ((filter == NULL) || (meta == NULL)) {
+        return 0;
+    }
+    return  (meta->id >= filter->id_first) &&
+            (meta->id <= filter->id_last) &&
+            ((meta->id & filter->id_mask) == filter->id_match) &&
+            ((meta->access & filter->access_mask) == filter->access_match) &&
+            ((meta->flags & filter->flags_mask) == filter->flags_match);
+}
+
+/* Collect matching ids by walking the list and destroy them a batch at a
+ * time.  Called with the write lock held */
+static int _wh_Nvm_DestroyMatchingBatched(whNvmContext* context,
+        const whNvmFilter* filter, whNvmId* out_count)
+{
+    whNvmId batch[WH_NVM_DESTROY_BATCH];
+    whNvmId batch_count = 0;
+    whNvmId total = 0;
+    whNvmId count = 0;
+    whNvmId id = 0;
+    whNvmMetadata meta;
+    int more = 0;
+    int rc = 0;
+
+    if (    (context->cb->List == NULL) ||
+            (context->cb->GetMetadata == NULL) ||
+            (context->cb->DestroyObjects == NULL) ) {
+        return WH_ERROR_ABORTED;
+    }
+
+    do {
+        batch_count = 0;
+        more = 0;
+        rc = context->cb->List(context->context, WOLFHSM_NVM_ACCESS_ANY,
+                WOLFHSM_NVM_FLAGS_ANY, 0, &count, &id);
+        while ((rc == 0) && (count > 0) && (id != WH_NVM_INVALID_ID)) {
+            rc = context->cb->GetMetadata(context->context, id, &meta);
+            if ((rc == 0) && (wh_Nvm_FilterMatches(filter, &meta) != 0)) {
+                if (batch_count == WH_NVM_DESTROY_BATCH) {
+                    /* Destroy this batch and rescan for the rest */
+                    more = 1;
+                    break;
+                }
+                batch[batch_count++] = id;
+            }
+            if (rc == 0) {
+                rc = context->cb->List(context->context,
+                        WOLFHSM_NVM_ACCESS_ANY, WOLFHSM_NVM_FLAGS_ANY, id,
+                        &count, &id);
+            }
+        }
+        if ((rc == 0) && (batch_count > 0)) {
+            rc = context->cb->DestroyObjects(context->context, batch_count,
+                    batch);
+            if (rc == 0) {
+                total += batch_count;
+            }
+        }
+    } while ((rc == 0) && (more != 0));
+
+    if ((rc == 0) && (out_count != NULL)) {
+        *out_count = total;
+    }
+    return rc;
+}
+
+int wh_Nvm_DestroyMatching(whNvmContext* context, const whNvmFilter* filter,
+        whNvmId* out_count)
+{
+    int rc = 0;
+
+    if (    (context == NULL) ||
+            (context->cb == NULL) ||
+            (filter == NULL) ) {
+        return WH_ERROR_BADARGS;
+    }
+
+    rc = _wh_Nvm_AcquireWrite(context);
+    if (rc == 0) {
+        if (context->cb->DestroyMatching != NULL) {
+            rc = context->cb->DestroyMatching(context->context, filter,
+                    out_count);
+        }
+        else {
+            rc = _wh_Nvm_DestroyMatchingBatched(context, filter, out_count);
+        }
+        context->generation++;
+        (void)wh_Lock_ReleaseWrite(context->lock);
+    }
+    return rc;
+}
 
 int wh_Nvm_Read(whNvmContext* context, whNvmId id, whNvmSize offset,
         whNvmSize data_len, uint8_t* data)
 {
+    int rc = 0;
+
     if (    (context == NULL) ||
             (context->cb == NULL) ) {
         return WH_ERROR_BADARGS;
@@ -164,6 +481,58 @@ int wh_Nvm_Read(whNvmContext* context, whNvmId id, whNvmSize offset,
     if (context->cb->Read == NULL) {
         return WH_ERROR_ABORTED;
     }
-    return context->cb->Read(context->context, id, offset, data_len, data);
+    rc = _wh_Nvm_AcquireRead(context);
+    if (rc == 0) {
+        rc = context->cb->Read(context->context, id, offset, data_len,
+                data);
+        (void)wh_Lock_ReleaseRead(context->lock);
+    }
+    return rc;
 }
 
+
+int wh_Nvm_CreateLog(whNvmContext* context, whNvmMetadata* meta,
+        whNvmSize data_len, const uint8_t* data)
+{
+    int rc = 0;
+
+    if (    (context == NULL) ||
+            (context->cb == NULL) ) {
+        return WH_ERROR_BADARGS;
+    }
+
+    /* No callback? Return ABORTED */
+    if (context->cb->CreateLog == NULL) {
+        return WH_ERROR_ABORTED;
+    }
+    rc = _wh_Nvm_AcquireWrite(context);
+    if (rc == 0) {
+        rc = context->cb->CreateLog(context->context, meta, data_len, data);
+        context->generation++;
+        (void)wh_Lock_ReleaseWrite(context->lock);
+    }
+    return rc;
+}
+
+int wh_Nvm_Append(whNvmContext* context, whNvmId id, whNvmSize data_len,
+        const uint8_t* data)
+{
+    int rc = 0;
+
+    if (    (context == NULL) ||
+            (context->cb == NULL) ) {
+        return WH_ERROR_BADARGS;
+    }
+
+    /* No callback? Return ABORTED */
+    if (context->cb->Append == NULL) {
+        return WH_ERROR_ABORTED;
+    }
+    rc = _wh_Nvm_AcquireWrite(context);
+    if (rc == 0) {
+        rc = context->cb->Append(context->context, id, data_len, data);
+        context->generation++;
+        (void)wh_Lock_ReleaseWrite(context->lock);
+    }
+    return rc;
+}
@@ -35,6 +35,8 @@
 
 enum {
     NF_COPY_OBJECT_BUFFER_LEN = 8 * WHFU_BYTES_PER_UNIT,
+    /* Append-log record header and commit units around the record data */
+    NF_LOG_RECORD_OVERHEAD_UNITS = 2,
 };
 
 /* MSW of state variables (nfState) must be set to this pattern when written
@@ -42,6 +44,11 @@ enum {
  * with erased flash */
 static const whFlashUnit BASE_STATE = 0x1234567800000000ull;
 
+/* Pattern used instead of BASE_STATE in the epoch of an append-log extent.
+ * The object kind is kept out of the caller's metadata so that no flags value
+ * can turn a plain object into a log */
+static const whFlashUnit LOG_STATE = 0x1234567900000000ull;
+
 /* On-flash layout of the state of an Object or Directory*/
 typedef struct {
     whFlashUnit epoch;   /* Not Erased: counter */
@@ -85,6 +92,18 @@ typedef struct {
 #define NF_PARTITION_DIRECTORY_OFFSET WHFU_BYTES2UNITS(offsetof(nfPartition, directory))
 #define NF_PARTITION_DATA_OFFSET WHFU_BYTES2UNITS(sizeof(nfPartition))
 
+/* On-flash layout of an append-log extent, which is the data area of a
+ * directory object whose epoch is programmed with LOG_STATE.  All extents of a
+ * log
+ * share the id and epoch of its first extent and are chained in directory
+ * order.  Each record is:
+ *   whFlashUnit header;        Not Erased: BASE_STATE | data byte count
+ *   whFlashUnit data[];        Record data, padded to whole units
+ *   whFlashUnit commit;        Not Erased: BASE_STATE | data byte count
+ * The first erased header marks the tail of the extent.  A record with a
+ * header but no commit was interrupted and is skipped. */
+#define NF_STATE_BASE_MASK 0xFFFFFFFF00000000ull
+
 /** Local declarations */
 static int nfMemState_Read(whNvmFlashContext* context, uint32_t offset,
         nfMemState* state);
@@ -111,6 +130,9 @@ static int nfPartition_ProgramStart(whNvmFlashContext* context, int partition,
 static int nfPartition_ProgramCount(whNvmFlashContext* context, int partition,
         uint32_t count);
 static int nfPartition_ProgramInit(whNvmFlashContext* context, int partition);
+static int nfPartition_Compact(whNvmFlashContext* context,
+        whNvmId add_count, whNvmMetadata* add_metas,
+        const uint8_t* const* add_datas);
 static int nfPartition_CheckDataRange(whNvmFlashContext* context,
                                        int partition,
                                        uint32_t byte_offset,
@@ -119,7 +141,8 @@ static int nfPartition_CheckDataRange(whNvmFlashContext* context,
 static uint32_t nfObject_Offset(whNvmFlashContext* context, int partition,
         int object_index);
 static int nfObject_ProgramBegin(whNvmFlashContext* context, int partition,
-        int object_index, uint32_t epoch, uint32_t start, whNvmMetadata* meta);
+        int object_index, uint32_t epoch, uint32_t start, whNvmMetadata* meta,
+        uint32_t log);
 static int nfObject_ProgramDataBytes(whNvmFlashContext* context, int partition,
         uint32_t offset, uint32_t byte_count, const uint8_t* data);
 static int nfObject_ProgramFinish(whNvmFlashContext* context, int partition,
@@ -136,6 +159,29 @@ static int nfObject_Copy(whNvmFlashContext* context, int object_index,
 static int nfMemDirectory_Parse(nfMemDirectory* d);
 static int nfMemDirectory_FindObjectIndexById(nfMemDirectory* d, whNvmId id,
         int *out_object_index);
+static void nfMemDirectory_ReclaimId(nfMemDirectory* d, whNvmId id,
+        int end_index);
+static int nfMemDirectory_IsHead(nfMemDirectory* d, int index);
+
+static int nfLog_IsExtent(nfMemDirectory* d, int index, whNvmId id,
+        uint32_t epoch);
+static int nfLog_ScanExtent(whNvmFlashContext* context, int index,
+        uint32_t log_offset, uint32_t offset, uint32_t len, uint8_t* out,
+        uint32_t* out_tail, uint32_t* out_len);
+static int nfLog_Walk(whNvmFlashContext* context, int head, nfMemLog* log,
+        uint32_t offset, uint32_t len, uint8_t* out);
+static void nfLog_Forget(whNvmFlashContext* context, whNvmId id);
+static int nfLog_Find(whNvmFlashContext* context, int head,
+        nfMemLog* scratch, nfMemLog** out_log);
+static int nfLog_AddExtent(whNvmFlashContext* context, int head,
+        uint32_t min_units, whNvmMetadata* meta, uint32_t epoch,
+        int* out_index);
+static int nfLog_ProgramRecord(whNvmFlashContext* context, int index,
+        uint32_t unit, whNvmSize data_len, const uint8_t* data);
+static int nfLog_Append(whNvmFlashContext* context, int head,
+        whNvmSize data_len, const uint8_t* data);
+static int nfLog_Create(whNvmFlashContext* context, whNvmMetadata* meta,
+        whNvmSize data_len, const uint8_t* data);
 
 
 static int nfMemState_Read(whNvmFlashContext* context, uint32_t offset,
@@ -200,6 +246,7 @@ static int nfMemState_Read(whNvmFlashContext* context, uint32_t offset,
     state->epoch = buffer.epoch;
     state->start = buffer.start;
     state->count = buffer.count;
+    state->log = ((buffer.epoch & NF_STATE_BASE_MASK) == LOG_STATE);
 
     /* Compute status based on which state members are blank */
     if (    (blank_epoch == WH_ERROR_NOTBLANK) &&
@@ -520,11 +567,11 @@ static uint32_t nfObject_Offset(whNvmFlashContext* context, int partition,
 
 static int nfObject_ProgramBegin(whNvmFlashContext* context, int partition,
         int object_index, uint32_t epoch, uint32_t start,
-                whNvmMetadata* meta)
+                whNvmMetadata* meta, uint32_t log)
 {
     int rc = 0;
     uint32_t object_offset = 0;
-    whFlashUnit state_epoch = BASE_STATE | epoch;
+    whFlashUnit state_epoch = ((log != 0) ? LOG_STATE : BASE_STATE) | epoch;
     whFlashUnit state_start = BASE_STATE | start;
 
     if (    (context == NULL) ||
@@ -625,7 +672,7 @@ static int nfObject_Program(whNvmFlashContext* context, int partition,
     }
 
     rc = nfObject_ProgramBegin(context, partition, object_index,
-            epoch, start, meta);
+            epoch, start, meta, 0);
     if (rc == 0) {
         rc = nfObject_ProgramDataBytes(context, partition,
                 start, meta->len, data);
@@ -674,6 +721,7 @@ static int nfObject_Copy(whNvmFlashContext* context, int object_index,
     uint32_t dest_data = 0;
     nfMemDirectory* d = NULL;
     uint32_t data_len = 0;
+    uint32_t copy_len = 0;
     uint32_t data_offset = 0;
 
     if (    (context == NULL) ||
@@ -687,20 +735,31 @@ static int nfObject_Copy(whNvmFlashContext* context, int object_index,
     d = &context->directory;
 
     data_len = d->objects[object_index].metadata.len;
+    copy_len = data_len;
+
+    /* Only the written records of a log extent are copied so the erased tail
+     * stays programmable in the new partition */
+    if (d->objects[object_index].state.log != 0) {
+        ret = nfLog_ScanExtent(context, object_index, 0, 0, 0, NULL,
+                &copy_len, NULL);
+        if (ret != 0) return ret;
+        copy_len *= WHFU_BYTES_PER_UNIT;
+    }
 
     /* Copy the object to the new partition */
     ret = nfObject_ProgramBegin(context, partition, dest_object,
             d->objects[object_index].state.epoch,
-            dest_data, &d->objects[object_index].metadata);
+            dest_data, &d->objects[object_index].metadata,
+            d->objects[object_index].state.log);
     if (ret != 0) return ret;
 
     /* Loop through reading the old data into buffer */
-    while (data_offset < data_len) {
+    while (data_offset < copy_len) {
         uint8_t buffer[NF_COPY_OBJECT_BUFFER_LEN];
         uint32_t this_len = sizeof(buffer);
 
-        if((data_len - data_offset) < this_len) {
-            this_len = data_len - data_offset;
+        if((copy_len - data_offset) < this_len) {
+            this_len = copy_len - data_offset;
         }
 
         /* Read the data from the old object. */
@@ -728,6 +787,7 @@ static int nfObject_Copy(whNvmFlashContext* context, int object_index,
     ret = nfObject_ProgramFinish(context, partition, dest_object, data_len);
     if (ret != 0) return ret;
     dest_object++;
+    dest_data = *inout_next_data + WHFU_BYTES2UNITS(data_len);
 
     if (ret == 0) {
         *inout_next_object = dest_object;
@@ -791,6 +851,13 @@ static int nfMemDirectory_Parse(nfMemDirectory* d)
         if (d->objects[this_entry].state.status == NF_STATUS_USED) {
             whNvmId this_id = d->objects[this_entry].metadata.id;
             for (that_entry = this_entry - 1; that_entry >= 0; that_entry --) {
+                if (nfLog_IsExtent(d, that_entry, this_id,
+                        d->objects[this_entry].state.epoch) &&
+                        nfLog_IsExtent(d, this_entry, this_id,
+                        d->objects[this_entry].state.epoch)) {
+                    /* Extents of the same log are not duplicates */
+                    continue;
+                }
                 if (    (d->objects[that_entry].state.status == NF_STATUS_USED) &&
                         (d->objects[that_entry].metadata.id == this_id)) {
                     /* Found duplicate.  Mark it as reclaimable and break out of this loop */
@@ -828,6 +895,375 @@ static int nfMemDirectory_FindObjectIndexById(nfMemDirectory* d, whNvmId id,
 
 
 
+/* Mark every live entry for id before end_index as reclaimable */
+static void nfMemDirectory_ReclaimId(nfMemDirectory* d, whNvmId id,
+        int end_index)
+{
+    int index = 0;
+
+    for (index = 0; index < end_index; index++) {
+        if (    (d->objects[index].state.status == NF_STATUS_USED) &&
+                (d->objects[index].metadata.id == id)) {
+            d->objects[index].state.status = NF_STATUS_DATA_BAD;
+            d->reclaimable_entries++;
+            d->reclaimable_data += d->objects[index].state.count;
+        }
+    }
+}
+
+/* Only the first live entry of an id is listed.  Later entries are the
+ * chained extents of an append-log */
+static int nfMemDirectory_IsHead(nfMemDirectory* d, int index)
+{
+    int head = -1;
+
+    if (d->objects[index].state.status != NF_STATUS_USED) {
+        return 0;
+    }
+    (void)nfMemDirectory_FindObjectIndexById(d,
+            d->objects[index].metadata.id, &head);
+    return (head == index);
+}
+
+static int nfLog_IsExtent(nfMemDirectory* d, int index, whNvmId id,
+        uint32_t epoch)
+{
+    return  (d->objects[index].state.status == NF_STATUS_USED) &&
+            (d->objects[index].metadata.id == id) &&
+            (d->objects[index].state.log != 0) &&
+            (d->objects[index].state.epoch == epoch);
+}
+
+/* Walk the records of one extent whose first record starts at log_offset in
+ * the log.  Committed data in the log range [offset, offset + len) is copied
+ * to out when out is not NULL.  Returns the unit offset of the first free
+ * record and the committed bytes in the extent. */
+static int nfLog_ScanExtent(whNvmFlashContext* context, int index,
+        uint32_t log_offset, uint32_t offset, uint32_t len, uint8_t* out,
+        uint32_t* out_tail, uint32_t* out_len)
+{
+    nfMemObject* obj = &context->directory.objects[index];
+    uint32_t base = nfPartition_DataOffset(context, context->active) +
+            obj->state.start;
+    uint32_t unit = 0;
+    uint32_t committed = 0;
+    uint32_t rec_len = 0;
+    uint32_t rec_units = 0;
+    uint32_t rec_start = 0;
+    uint32_t lo = 0;
+    uint32_t hi = 0;
+    whFlashUnit header = 0;
+    whFlashUnit commit = 0;
+    int ret = 0;
+
+    while (unit + NF_LOG_RECORD_OVERHEAD_UNITS <= obj->state.count) {
+        ret = wh_FlashUnit_BlankCheck(context->cb, context->flash,
+                base + unit, 1);
+        if (ret == 0) {
+            /* Erased header is the tail */
+            break;
+        }
+        if (ret != WH_ERROR_NOTBLANK) {
+            return ret;
+        }
+        ret = wh_FlashUnit_Read(context->cb, context->flash,
+                base + unit, 1, &header);
+        if (ret != 0) {
+            return ret;
+        }
+        rec_len = (uint32_t)(header & ~NF_STATE_BASE_MASK);
+        rec_units = WHFU_BYTES2UNITS(rec_len);
+        if (    ((header & NF_STATE_BASE_MASK) != BASE_STATE) ||
+                (rec_units + NF_LOG_RECORD_OVERHEAD_UNITS >
+                    obj->state.count - unit)) {
+            /* Damaged header.  Nothing after it can be trusted */
+            unit = obj->state.count;
+            break;
+        }
+        ret = wh_FlashUnit_Read(context->cb, context->flash,
+                base + unit + 1 + rec_units, 1, &commit);
+        if (ret != 0) {
+            return ret;
+        }
+        if (commit == header) {
+            rec_start = log_offset + committed;
+            if (out != NULL) {
+                lo = (rec_start > offset) ? rec_start : offset;
+                hi = rec_start + rec_len;
+                if (hi > offset + len) {
+                    hi = offset + len;
+                }
+                if (lo < hi) {
+                    ret = nfObject_ReadDataBytes(context, context->active,
+                            index,
+                            (unit + 1) * WHFU_BYTES_PER_UNIT + lo - rec_start,
+                            hi - lo, out + (lo - offset));
+                    if (ret != 0) {
+                        return ret;
+                    }
+                }
+            }
+            committed += rec_len;
+        }
+        /* Interrupted records are skipped but keep their space */
+        unit += rec_units + NF_LOG_RECORD_OVERHEAD_UNITS;
+    }
+
+    if (out_tail != NULL) *out_tail = unit;
+    if (out_len != NULL) *out_len = committed;
+    return 0;
+}
+
+/* Walk every extent of the log starting at directory index head, rebuilding
+ * log and optionally copying the log range [offset, offset + len) to out */
+static int nfLog_Walk(whNvmFlashContext* context, int head, nfMemLog* log,
+        uint32_t offset, uint32_t len, uint8_t* out)
+{
+    nfMemDirectory* d = &context->directory;
+    whNvmId id = d->objects[head].metadata.id;
+    uint32_t epoch = d->objects[head].state.epoch;
+    uint32_t tail = 0;
+    uint32_t extent_len = 0;
+    int index = 0;
+    int ret = 0;
+
+    memset(log, 0, sizeof(*log));
+    log->id = id;
+    log->extent = (uint16_t)head;
+    for (index = head; (ret == 0) && (index < d->next_free_object); index++) {
+        if (nfLog_IsExtent(d, index, id, epoch) == 0) {
+            continue;
+        }
+        ret = nfLog_ScanExtent(context, index, log->len, offset, len, out,
+                &tail, &extent_len);
+        if (ret == 0) {
+            log->extent = (uint16_t)index;
+            log->tail = tail;
+            log->len += extent_len;
+        }
+    }
+    return ret;
+}
+
+/* Drop the cached tail of id, or of every log if id is 0 */
+static void nfLog_Forget(whNvmFlashContext* context, whNvmId id)
+{
+    int i = 0;
+
+    for (i = 0; i < NF_LOG_CACHE_COUNT; i++) {
+        if ((id == 0) || (context->logs[i].id == id)) {
+            memset(&context->logs[i], 0, sizeof(context->logs[i]));
+        }
+    }
+}
+
+/* Get the cached tail of the log at directory index head, scanning the log
+ * from flash on a miss.  Read-only callers pass scratch so that a miss does
+ * not modify the cache, keeping them safe under a shared NVM lock. */
+static int nfLog_Find(whNvmFlashContext* context, int head,
+        nfMemLog* scratch, nfMemLog** out_log)
+{
+    whNvmId id = context->directory.objects[head].metadata.id;
+    nfMemLog* log = NULL;
+    int i = 0;
+    int ret = 0;
+
+    for (i = 0; i < NF_LOG_CACHE_COUNT; i++) {
+        if (context->logs[i].id == id) {
+            *out_log = &context->logs[i];
+            return 0;
+        }
+    }
+
+    if (scratch != NULL) {
+        log = scratch;
+    }
+    else {
+        log = &context->logs[context->next_log];
+        context->next_log = (context->next_log + 1) % NF_LOG_CACHE_COUNT;
+    }
+    ret = nfLog_Walk(context, head, log, 0, 0, NULL);
+    if (ret != 0) {
+        memset(log, 0, sizeof(*log));
+        return ret;
+    }
+    *out_log = log;
+    return 0;
+}
+
+/* Reserve a new extent of at least min_units at the end of the active
+ * partition.  The object is finished immediately so the reservation survives
+ * a reset, leaving the data area erased for records.  A chained extent is as
+ * large as the extents before it, when that fits, so a log takes directory
+ * entries in proportion to the log of its size rather than its size. */
+static int nfLog_AddExtent(whNvmFlashContext* context, int head,
+        uint32_t min_units, whNvmMetadata* meta, uint32_t epoch,
+        int* out_index)
+{
+    nfMemDirectory* d = &context->directory;
+    whNvmMetadata extent_meta;
+    uint32_t units = WHFU_BYTES2UNITS(NF_LOG_EXTENT_LEN);
+    uint32_t reserved = 0;
+    uint32_t avail = context->partition_units - NF_PARTITION_DATA_OFFSET -
+            d->next_free_data;
+    int index = d->next_free_object;
+    int i = 0;
+    int ret = 0;
+
+    if (units < min_units) {
+        units = min_units;
+    }
+    if (head >= 0) {
+        meta = &d->objects[head].metadata;
+        epoch = d->objects[head].state.epoch;
+        for (i = head; i < d->next_free_object; i++) {
+            if (nfLog_IsExtent(d, i, meta->id, epoch) != 0) {
+                reserved += d->objects[i].state.count;
+            }
+        }
+        if (reserved > WOLFHSM_NVM_MAX_OBJECT_SIZE / WHFU_BYTES_PER_UNIT) {
+            reserved = WOLFHSM_NVM_MAX_OBJECT_SIZE / WHFU_BYTES_PER_UNIT;
+        }
+        /* Fall back to the minimum when doubling does not fit */
+        if ((reserved > units) && (reserved <= avail)) {
+            units = reserved;
+        }
+    }
+    if ((index == NF_OBJECT_COUNT) || (units > avail)) {
+        return WH_ERROR_NOSPACE;
+    }
+
+    memcpy(&extent_meta, meta, sizeof(extent_meta));
+    extent_meta.len = (whNvmSize)(units * WHFU_BYTES_PER_UNIT);
+
+    ret = nfObject_ProgramBegin(context, context->active, index, epoch,
+            d->next_free_data, &extent_meta, 1);
+    if (ret == 0) {
+        ret = nfObject_ProgramFinish(context, context->active, index,
+                extent_meta.len);
+    }
+    if (ret == 0) {
+        d->objects[index].state.status = NF_STATUS_USED;
+        d->objects[index].state.epoch = epoch;
+        d->objects[index].state.log = 1;
+        d->objects[index].state.start = d->next_free_data;
+        d->objects[index].state.count = units;
+        memcpy(&d->objects[index].metadata, &extent_meta,
+                sizeof(extent_meta));
+        d->next_free_data += units;
+        d->next_free_object++;
+        *out_index = index;
+    }
+    return ret;
+}
+
+/* Program one record at unit offset unit of the extent at index.  The commit
+ * unit is written last so an interrupted record is never visible. */
+static int nfLog_ProgramRecord(whNvmFlashContext* context, int index,
+        uint32_t unit, whNvmSize data_len, const uint8_t* data)
+{
+    uint32_t start = context->directory.objects[index].state.start + unit;
+    uint32_t offset = nfPartition_DataOffset(context, context->active) + start;
+    whFlashUnit marker = BASE_STATE | data_len;
+    int ret = 0;
+
+    ret = wh_FlashUnit_Program(context->cb, context->flash, offset, 1,
+            &marker);
+    if (ret == 0) {
+        ret = nfObject_ProgramDataBytes(context, context->active, start + 1,
+                data_len, data);
+    }
+    if (ret == 0) {
+        ret = wh_FlashUnit_Program(context->cb, context->flash,
+                offset + 1 + WHFU_BYTES2UNITS(data_len), 1, &marker);
+    }
+    return ret;
+}
+
+static int nfLog_Append(whNvmFlashContext* context, int head,
+        whNvmSize data_len, const uint8_t* data)
+{
+    nfMemDirectory* d = &context->directory;
+    nfMemLog* log = NULL;
+    uint32_t need = NF_LOG_RECORD_OVERHEAD_UNITS + WHFU_BYTES2UNITS(data_len);
+    uint32_t unit = 0;
+    int index = 0;
+    int ret = 0;
+
+    if (need * WHFU_BYTES_PER_UNIT > WOLFHSM_NVM_MAX_OBJECT_SIZE) {
+        return WH_ERROR_BADARGS;
+    }
+
+    ret = nfLog_Find(context, head, NULL, &log);
+    if (ret != 0) {
+        return ret;
+    }
+    if (log->len + data_len > WOLFHSM_NVM_MAX_OBJECT_SIZE) {
+        return WH_ERROR_NOSPACE;
+    }
+
+    index = log->extent;
+    unit = log->tail;
+    if (need > d->objects[index].state.count - unit) {
+        /* Chain a new extent rather than rewriting the log */
+        ret = nfLog_AddExtent(context, head, need, NULL, 0, &index);
+        unit = 0;
+    }
+    if (ret == 0) {
+        ret = nfLog_ProgramRecord(context, index, unit, data_len, data);
+    }
+    if (ret == 0) {
+        log->extent = (uint16_t)index;
+        log->tail = unit + need;
+        log->len += data_len;
+    }
+    else {
+        /* Rebuild the tail from flash on next use */
+        nfLog_Forget(context, d->objects[head].metadata.id);
+    }
+    return ret;
+}
+
+/* Start a new log with its first extent, replacing any object with the same
+ * id, and append data as the first record if provided */
+static int nfLog_Create(whNvmFlashContext* context, whNvmMetadata* meta,
+        whNvmSize data_len, const uint8_t* data)
+{
+    nfMemDirectory* d = &context->directory;
+    uint32_t need = 0;
+    uint32_t epoch = 0;
+    int oldentry = -1;
+    int index = -1;
+    int ret = 0;
+
+    if (data_len > 0) {
+        need = NF_LOG_RECORD_OVERHEAD_UNITS + WHFU_BYTES2UNITS(data_len);
+        if (need * WHFU_BYTES_PER_UNIT > WOLFHSM_NVM_MAX_OBJECT_SIZE) {
+            return WH_ERROR_BADARGS;
+        }
+    }
+
+    /* Find existing object so we can increment the epoch */
+    (void)nfMemDirectory_FindObjectIndexById(d, meta->id, &oldentry);
+    if (oldentry >= 0) {
+        epoch = d->objects[oldentry].state.epoch + 1;
+    }
+
+    ret = nfLog_AddExtent(context, -1, need, meta, epoch, &index);
+    if (ret == 0) {
+        nfMemDirectory_ReclaimId(d, meta->id, index);
+        nfLog_Forget(context, meta->id);
+        if (data_len > 0) {
+            ret = nfLog_Append(context, index, data_len, data);
+        }
+    }
+    if (ret == 0) {
+        meta->len = data_len;
+    }
+    return ret;
+}
+
+
 /*************  WolfHSM NVM Interfaces  ***********/
 
 int wh_NvmFlash_Init(void* c, const void* cf)
@@ -947,7 +1383,7 @@ int wh_NvmFlash_List(void* c,
 
     /* Find the starting id */
     for (this_entry = 0; this_entry < d->next_free_object; this_entry++) {
-        if (d->objects[this_entry].state.status == NF_STATUS_USED) {
+        if (nfMemDirectory_IsHead(d, this_entry)) {
             this_id = d->objects[this_entry].metadata.id;
             if ((start_id == 0) || (start_id == this_id)) {
                 break;
@@ -967,7 +1403,7 @@ int wh_NvmFlash_List(void* c,
             /* Find the next one */
             this_entry++;
             for (; this_entry < d->next_free_object; this_entry++) {
-                if (d->objects[this_entry].state.status == NF_STATUS_USED) {
+                if (nfMemDirectory_IsHead(d, this_entry)) {
                     this_id = d->objects[this_entry].metadata.id;
                     break;
                 }
@@ -981,7 +1417,7 @@ int wh_NvmFlash_List(void* c,
 
         /* Now count how many more there are */
         for (this_entry++; this_entry < d->next_free_object; this_entry++) {
-            if (d->objects[this_entry].state.status == NF_STATUS_USED) {
+            if (nfMemDirectory_IsHead(d, this_entry)) {
                 this_count++;
             }
         }
@@ -1020,6 +1456,8 @@ int wh_NvmFlash_GetAvailable(void* c,
 int wh_NvmFlash_GetMetadata(void* c, whNvmId id, whNvmMetadata* meta)
 {
     whNvmFlashContext* context = c;
+    nfMemLog* log = NULL;
+    nfMemLog scratch;
     int entry = 0;
     int ret = 0;
 
@@ -1033,6 +1471,13 @@ int wh_NvmFlash_GetMetadata(void* c, whNvmId id, whNvmMetadata* meta)
            memcpy(  meta,
                     &context->directory.objects[entry].metadata,
                     sizeof(*meta));
+           if (context->directory.objects[entry].state.log != 0) {
+               /* Report the committed log length, not the extent size */
+               ret = nfLog_Find(context, entry, &scratch, &log);
+               if (ret == 0) {
+                   meta->len = (whNvmSize)log->len;
+               }
+           }
         }
     }
     return ret;
@@ -1086,17 +1531,18 @@ int wh_NvmFlash_AddObject(void* c, whNvmMetadata *meta,
         /* Update directory with new object */
         d->objects[d->next_free_object].state.status = NF_STATUS_USED;
         d->objects[d->next_free_object].state.epoch = epoch;
+        d->objects[d->next_free_object].state.log = 0;
         d->objects[d->next_free_object].state.start = d->next_free_data;
         d->objects[d->next_free_object].state.count = count;
         memcpy(&d->objects[d->next_free_object].metadata, meta, sizeof(*meta));
         d->next_free_data += count;
         d->next_free_object++;
 
-        /* Update directory to reclaim old entry */
+        /* Update directory to reclaim old entries, including all extents
+         * of a replaced log */
         if (oldentry >= 0) {
-            d->objects[oldentry].state.status = NF_STATUS_DATA_BAD;
-            d->reclaimable_entries++;
-            d->reclaimable_data += d->objects[oldentry].state.count;
+            nfMemDirectory_ReclaimId(d, meta->id, d->next_free_object - 1);
+            nfLog_Forget(context, meta->id);
         }
     }
     return ret;
@@ -1106,29 +1552,23 @@ int wh_NvmFlash_AddObject(void* c, whNvmMetadata *meta,
  * in the provided list.  Id's in the list that are not present do not cause an
  * error.
  */
-int wh_NvmFlash_DestroyObjects(void* c, whNvmId list_count,
-        const whNvmId* id_list)
+/* Replicate the used objects of the active partition into the inactive one,
+ * followed by any objects being added, switch to it and erase the old
+ * partition.  Entries already marked bad in the directory are left behind. */
+static int nfPartition_Compact(whNvmFlashContext* context,
+        whNvmId add_count, whNvmMetadata* add_metas,
+        const uint8_t* const* add_datas)
 {
     int ret = 0;
-    whNvmFlashContext* context = c;
-    nfMemDirectory* d = NULL;
+    whNvmId i = 0;
     nfMemState new_state =  {0};
-    int list_entry = 0;
+    nfMemDirectory* d = &context->directory;
     int entry = 0;
-    int src_part = 0;
-    int dest_part = 0;
+    int src_part = context->active;
+    int dest_part = !context->active;
     uint32_t dest_object = 0;
     uint32_t dest_data = 0;
 
-    if (    (context == NULL) ||
-            ((list_count > 0) && (id_list == NULL)) ) {
-        return WH_ERROR_BADARGS;
-    }
-
-    /* Context is valid.  Generate helper values */
-    d = &context->directory;
-    src_part = context->active;
-    dest_part = !context->active;
     new_state =  (nfMemState)   {
                                     .status = NF_STATUS_FREE,
                                     .epoch = context->state.epoch + 1,
@@ -1136,27 +1576,18 @@ int wh_NvmFlash_DestroyObjects(void* c, whNvmId list_count,
                                     .count = context->state.count,
                                 };
 
-    /* Go through the current directory and mark the listed id's as bad */
-    for (list_entry = 0; list_entry < list_count; list_entry++) {
-        /* Mark all matching entries as bad.  Should only be 1. */
-        do {
-            entry = -1;
-            ret = nfMemDirectory_FindObjectIndexById(d, id_list[list_entry],
-                    &entry);
-            if ((ret == 0) && (entry >= 0)) {
-                d->objects[entry].state.status = NF_STATUS_DATA_BAD;
-            }
-        } while (entry >= 0);
-    }
-
-    /* Blank check the inactive partition and erase if not blank */
-    ret = nfPartition_BlankCheck(context, dest_part);
-    if (ret == WH_ERROR_NOTBLANK) {
-        ret = nfPartition_Erase(context, dest_part);
-    }
-    if (ret != 0) {
-        return ret;
+    /* Blank check the inactive partition and erase if not blank, unless it
+     * is already known to be erased */
+    if (context->inactive_blank == 0) {
+        ret = nfPartition_BlankCheck(context, dest_part);
+        if (ret == WH_ERROR_NOTBLANK) {
+            ret = nfPartition_Erase(context, dest_part);
+        }
+        if (ret != 0) {
+            return ret;
+        }
     }
+    context->inactive_blank = 0;
 
     ret = nfPartition_ProgramEpoch(context, dest_part, new_state.epoch);
     if (ret != 0) {
@@ -1178,6 +1609,17 @@ int wh_NvmFlash_DestroyObjects(void* c, whNvmId list_count,
         }
     }
 
+    /* Write the added objects.  None is visible until the count is written */
+    for (i = 0; i < add_count; i++) {
+        ret = nfObject_Program(context, dest_part, dest_object, 0,
+                &add_metas[i], dest_data, add_datas[i]);
+        if (ret != 0) {
+            return ret;
+        }
+        dest_object++;
+        dest_data += WHFU_BYTES2UNITS(add_metas[i].len);
+    }
+
     /* Write partition count */
     ret = nfPartition_ProgramCount(context, dest_part, new_state.count);
     if (ret != 0) {
@@ -1201,7 +1643,136 @@ int wh_NvmFlash_DestroyObjects(void* c, whNvmId list_count,
 
     /* Erase the old directory */
     ret = nfPartition_Erase(context, src_part);
+    if (ret == 0) {
+        context->inactive_blank = 1;
+    }
+
+    return ret;
+}
+
+int wh_NvmFlash_DestroyObjects(void* c, whNvmId list_count,
+        const whNvmId* id_list)
+{
+    int ret = 0;
+    whNvmFlashContext* context = c;
+    nfMemDirectory* d = NULL;
+    int list_entry = 0;
+    int entry = 0;
+
+    if (    (context == NULL) ||
+            ((list_count > 0) && (id_list == NULL)) ) {
+        return WH_ERROR_BADARGS;
+    }
+
+    d = &context->directory;
+
+    /* Directory indices change, so cached log tails are rebuilt on use */
+    nfLog_Forget(context, 0);
+
+    /* Go through the current directory and mark the listed id's as bad */
+    for (list_entry = 0; list_entry < list_count; list_entry++) {
+        /* Mark all matching entries as bad.  Should only be 1. */
+        do {
+            entry = -1;
+            ret = nfMemDirectory_FindObjectIndexById(d, id_list[list_entry],
+                    &entry);
+            if ((ret == 0) && (entry >= 0)) {
+                d->objects[entry].state.status = NF_STATUS_DATA_BAD;
+            }
+        } while (entry >= 0);
+    }
+
+    return nfPartition_Compact(context, 0, NULL, NULL);
+}
+
+/* Add a list of objects with a single replication of the partition.  The
+ * replaced versions are left behind and the new objects are written after
+ * the surviving ones, so either all of them are present after a reset or,
+ * if the new partition was not completed, none are. */
+int wh_NvmFlash_AddObjects(void* c, whNvmId list_count,
+        whNvmMetadata* meta_list, const uint8_t* const* data_list)
+{
+    whNvmFlashContext* context = c;
+    nfMemDirectory* d = NULL;
+    uint32_t need_data = 0;
+    whNvmId i = 0;
+    int ret = 0;
+
+    if (    (context == NULL) ||
+            ((list_count > 0) &&
+                ((meta_list == NULL) || (data_list == NULL))) ) {
+        return WH_ERROR_BADARGS;
+    }
+
+    for (i = 0; i < list_count; i++) {
+        if ((meta_list[i].len > 0) && (data_list[i] == NULL)) {
+            return WH_ERROR_BADARGS;
+        }
+        need_data += WHFU_BYTES2UNITS(meta_list[i].len);
+    }
+    if (list_count == 0) {
+        return 0;
+    }
+
+    d = &context->directory;
+    for (i = 0; i < list_count; i++) {
+        nfMemDirectory_ReclaimId(d, meta_list[i].id, d->next_free_object);
+    }
+
+    if (    (d->next_free_object - d->reclaimable_entries + list_count >
+                NF_OBJECT_COUNT) ||
+            (d->next_free_data - d->reclaimable_data + need_data >
+                context->partition_units - NF_PARTITION_DATA_OFFSET) ) {
+        ret = WH_ERROR_NOSPACE;
+    } else {
+        /* Directory indices change, so cached log tails are rebuilt on use */
+        nfLog_Forget(context, 0);
+        ret = nfPartition_Compact(context, list_count, meta_list, data_list);
+    }
+    if (ret != 0) {
+        /* Rebuild the directory from whichever partition is now active */
+        (void)nfPartition_ReadParseMemDirectory(context, context->active, d);
+    }
+    return ret;
+}
+
+/* Destroy every object whose head entry matches the filter.  Append-log
+ * extents go with their head. */
+int wh_NvmFlash_DestroyMatching(void* c, const whNvmFilter* filter,
+        whNvmId* out_count)
+{
+    whNvmFlashContext* context = c;
+    nfMemDirectory* d = NULL;
+    whNvmId count = 0;
+    int entry = 0;
+    int ret = 0;
+
+    if ((context == NULL) || (filter == NULL)) {
+        return WH_ERROR_BADARGS;
+    }
 
+    d = &context->directory;
+
+    /* Heads precede their extents, so reclaiming a matching head's id also
+     * takes the extents out before the loop reaches them */
+    for (entry = 0; entry < d->next_free_object; entry++) {
+        if (    nfMemDirectory_IsHead(d, entry) &&
+                wh_Nvm_FilterMatches(filter,
+                    &d->objects[entry].metadata) ) {
+            nfMemDirectory_ReclaimId(d, d->objects[entry].metadata.id,
+                    d->next_free_object);
+            count++;
+        }
+    }
+
+    if (count > 0) {
+        /* Directory indices change, so cached log tails are rebuilt on use */
+        nfLog_Forget(context, 0);
+        ret = nfPartition_Compact(context, 0, NULL, NULL);
+    }
+    if ((ret == 0) && (out_count != NULL)) {
+        *out_count = count;
+    }
     return ret;
 }
 
@@ -1210,6 +1781,8 @@ int wh_NvmFlash_Read(void* c, whNvmId id, whNvmSize offset,
         whNvmSize data_len, uint8_t* data)
 {
     whNvmFlashContext* context = c;
+    nfMemLog* log = NULL;
+    nfMemLog scratch;
     int ret = 0;
     int object_index = -1;
 
@@ -1222,7 +1795,20 @@ int wh_NvmFlash_Read(void* c, whNvmId id, whNvmSize offset,
             &context->directory,
             id,
             &object_index);
-    if (ret == 0) {
+    if (    (ret == 0) &&
+            (context->directory.objects[object_index].state.log != 0) ) {
+        /* Offsets into a log skip record framing */
+        ret = nfLog_Find(context, object_index, &scratch, &log);
+        if (    (ret == 0) &&
+                ((uint32_t)offset + data_len > log->len) ) {
+            ret = WH_ERROR_BADARGS;
+        }
+        if (ret == 0) {
+            ret = nfLog_Walk(context, object_index, &scratch, offset,
+                    data_len, data);
+        }
+    }
+    else if (ret == 0) {
         ret = nfObject_ReadDataBytes(
                 context,
                 context->active,
@@ -1233,3 +1819,73 @@ int wh_NvmFlash_Read(void* c, whNvmId id, whNvmSize offset,
     }
     return ret;
 }
+
+/* Start a new log with its first extent, replacing any object with the same
+ * id.  data is appended as the first record when data_len is not 0 */
+int wh_NvmFlash_CreateLog(void* c, whNvmMetadata* meta,
+        whNvmSize data_len, const uint8_t* data)
+{
+    whNvmFlashContext* context = c;
+
+    if (    (context == NULL) ||
+            (meta == NULL) ||
+            ((data_len > 0) && (data == NULL)) ) {
+        return WH_ERROR_BADARGS;
+    }
+    return nfLog_Create(context, meta, data_len, data);
+}
+
+/* Append a record to a log object.  Only the record and its framing are
+ * programmed, chaining a new extent when the last one is full. */
+int wh_NvmFlash_Append(void* c, whNvmId id, whNvmSize data_len,
+        const uint8_t* data)
+{
+    whNvmFlashContext* context = c;
+    int ret = 0;
+    int object_index = -1;
+
+    if (    (context == NULL) ||
+            (data_len == 0) ||
+            (data == NULL) ) {
+        return WH_ERROR_BADARGS;
+    }
+
+    ret = nfMemDirectory_FindObjectIndexById(
+            &context->directory,
+            id,
+            &object_index);
+    if (    (ret == 0) &&
+            (context->directory.objects[object_index].state.log == 0) ) {
+        ret = WH_ERROR_BADARGS;
+    }
+    if (ret == 0) {
+        ret = nfLog_Append(context, object_index, data_len, data);
+    }
+    return ret;
+}
+
+/* Erase the inactive partition if an interrupted DestroyObjects left it
+ * dirty, so the next compaction can skip the blank check and erase */
+int wh_NvmFlash_Maintain(void* c)
+{
+    whNvmFlashContext* context = c;
+    int ret = 0;
+
+    if (    (context == NULL) ||
+            (context->initialized == 0) ) {
+        return WH_ERROR_BADARGS;
+    }
+
+    if (context->inactive_blank != 0) {
+        return 0;
+    }
+
+    ret = nfPartition_BlankCheck(context, !context->active);
+    if (ret == WH_ERROR_NOTBLANK) {
+        ret = nfPartition_Erase(context, !context->active);
+    }
+    if (ret == 0) {
+        context->inactive_blank = 1;
+    }
+    return ret;
+}
@@ -0,0 +1,283 @@
+/*
+ * Copyright (C) 2024 wolfSSL Inc.
+ *
+ * This file is part of wolfHSM.
+ *
+ * wolfHSM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfHSM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wolfHSM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * src/wh_nvm_ram.c
+ *
+ * Volatile NVM object management in a RAM buffer
+ *
+ */
+
+#include <stddef.h>     /* For NULL */
+#include <string.h>     /* For memset, memcpy, memmove */
+
+#include "wolfhsm/wh_common.h"
+#include "wolfhsm/wh_error.h"
+#include "wolfhsm/wh_nvm.h"
+#include "wolfhsm/wh_nvm_ram.h"
+
+static int nrFindObjectIndexById(whNvmRamContext* context, whNvmId id);
+static void nrRemoveObject(whNvmRamContext* context, int index);
+
+
+/* Returns the index of the object with id, or -1 if not present */
+static int nrFindObjectIndexById(whNvmRamContext* context, whNvmId id)
+{
+    int index;
+
+    if (id == WH_NVM_INVALID_ID) {
+        return -1;
+    }
+    for (index = 0; index < context->count; index++) {
+        if (context->objects[index].metadata.id == id) {
+            return index;
+        }
+    }
+    return -1;
+}
+
+/* Remove the object at index, sliding later data and entries down so the
+ * buffer stays packed.  The vacated tail is zeroed so destroyed objects do not
+ * linger in RAM. */
+static void nrRemoveObject(whNvmRamContext* context, int index)
+{
+    uint32_t offset = context->objects[index].offset;
+    uint32_t len = context->objects[index].metadata.len;
+    int i;
+
+    memmove(context->buffer + offset,
+            context->buffer + offset + len,
+            context->used - offset - len);
+    memset(context->buffer + context->used - len, 0, len);
+    context->used -= len;
+
+    for (i = index; i < context->count - 1; i++) {
+        context->objects[i] = context->objects[i + 1];
+        context->objects[i].offset -= len;
+    }
+    context->count--;
+    memset(&context->objects[context->count], 0,
+            sizeof(context->objects[context->count]));
+}
+
+
+int wh_NvmRam_Init(void* c, const void* cf)
+{
+    whNvmRamContext* context = c;
+    const whNvmRamConfig* config = cf;
+
+    if (    (context == NULL) ||
+            (config == NULL) ||
+            (config->buffer == NULL) ) {
+        return WH_ERROR_BADARGS;
+    }
+
+    memset(context, 0, sizeof(*context));
+    context->buffer = config->buffer;
+    context->size = config->size;
+    memset(context->buffer, 0, context->size);
+    context->initialized = 1;
+    return 0;
+}
+
+int wh_NvmRam_Cleanup(void* c)
+{
+    whNvmRamContext* context = c;
+
+    if (context == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+    if (context->initialized != 0) {
+        memset(context->buffer, 0, context->used);
+    }
+    memset(context, 0, sizeof(*context));
+    return 0;
+}
+
+int wh_NvmRam_List(void* c,
+        whNvmAccess access, whNvmFlags flags, whNvmId start_id,
+        whNvmId *out_count, whNvmId *out_id)
+{
+    /* TODO: Implement access and flag matching */
+    (void)access; (void)flags;
+
+    whNvmRamContext* context = c;
+    int index = 0;
+    whNvmId this_count = 0;
+    whNvmId this_id = 0;
+
+    if (context == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+
+    if (start_id != 0) {
+        /* Continue after the starting id, if it exists */
+        index = nrFindObjectIndexById(context, start_id);
+        index = (index < 0) ? context->count : index + 1;
+    }
+    if (index < context->count) {
+        this_id = context->objects[index].metadata.id;
+        this_count = (whNvmId)(context->count - index);
+    }
+
+    if (out_count != NULL) *out_count = this_count;
+    if (out_id != NULL) *out_id = this_id;
+    return 0;
+}
+
+int wh_NvmRam_GetAvailable(void* c,
+        uint32_t *out_avail_size, whNvmId *out_avail_objects,
+        uint32_t *out_reclaim_size, whNvmId *out_reclaim_objects)
+{
+    whNvmRamContext* context = c;
+
+    if (context == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+
+    /* Data is always packed, so there is never anything to reclaim */
+    if (out_avail_size != NULL) {
+        *out_avail_size = context->size - context->used;
+    }
+    if (out_avail_objects != NULL) {
+        *out_avail_objects = (whNvmId)(NR_OBJECT_COUNT - context->count);
+    }
+    if (out_reclaim_size != NULL) {
+        *out_reclaim_size = 0;
+    }
+    if (out_reclaim_objects != NULL) {
+        *out_reclaim_objects = 0;
+    }
+    return 0;
+}
+
+int wh_NvmRam_GetMetadata(void* c, whNvmId id, whNvmMetadata* meta)
+{
+    whNvmRamContext* context = c;
+    int index;
+
+    if (context == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+
+    index = nrFindObjectIndexById(context, id);
+    if (index < 0) {
+        return WH_ERROR_NOTFOUND;
+    }
+    if (meta != NULL) {
+        memcpy(meta, &context->objects[index].metadata, sizeof(*meta));
+    }
+    return 0;
+}
+
+int wh_NvmRam_AddObject(void* c, whNvmMetadata* meta,
+        whNvmSize data_len, const uint8_t* data)
+{
+    whNvmRamContext* context = c;
+    int index;
+    uint32_t used;
+    int count;
+    nrMemObject* obj;
+
+    if (    (context == NULL) ||
+            (meta == NULL) ||
+            (meta->id == WH_NVM_INVALID_ID) ||
+            ((data_len > 0) && (data == NULL)) ) {
+        return WH_ERROR_BADARGS;
+    }
+
+    /* Account for the space an existing copy gives back when replaced */
+    used = context->used;
+    count = context->count;
+    index = nrFindObjectIndexById(context, meta->id);
+    if (index >= 0) {
+        used -= context->objects[index].metadata.len;
+        count--;
+    }
+    if (    (count >= NR_OBJECT_COUNT) ||
+            (data_len > context->size - used) ) {
+        return WH_ERROR_NOSPACE;
+    }
+
+    if (index >= 0) {
+        nrRemoveObject(context, index);
+    }
+
+    obj = &context->objects[context->count];
+    memcpy(&obj->metadata, meta, sizeof(obj->metadata));
+    obj->metadata.len = data_len;
+    obj->offset = context->used;
+    if (data_len > 0) {
+        memcpy(context->buffer + obj->offset, data, data_len);
+    }
+    context->used += data_len;
+    context->count++;
+
+    /* Update the caller's metadata as whNvmFlash does */
+    meta->len = data_len;
+    return 0;
+}
+
+int wh_NvmRam_DestroyObjects(void* c, whNvmId list_count,
+        const whNvmId* id_list)
+{
+    whNvmRamContext* context = c;
+    int i;
+    int index;
+
+    if (    (context == NULL) ||
+            ((list_count > 0) && (id_list == NULL)) ) {
+        return WH_ERROR_BADARGS;
+    }
+
+    /* list_count of 0 is a reclaim request, which is a no-op here */
+    for (i = 0; i < list_count; i++) {
+        index = nrFindObjectIndexById(context, id_list[i]);
+        if (index >= 0) {
+            nrRemoveObject(context, index);
+        }
+    }
+    return 0;
+}
+
+int wh_NvmRam_Read(void* c, whNvmId id, whNvmSize offset,
+        whNvmSize data_len, uint8_t* data)
+{
+    whNvmRamContext* context = c;
+    int index;
+    nrMemObject* obj;
+
+    if (    (context == NULL) ||
+            ((data_len > 0) && (data == NULL)) ) {
+        return WH_ERROR_BADARGS;
+    }
+
+    index = nrFindObjectIndexById(context, id);
+    if (index < 0) {
+        return WH_ERROR_NOTFOUND;
+    }
+    obj = &context->objects[index];
+    if (    (offset > obj->metadata.len) ||
+            (data_len > obj->metadata.len - offset) ) {
+        return WH_ERROR_BADARGS;
+    }
+    if (data_len > 0) {
+        memcpy(data, context->buffer + obj->offset + offset, data_len);
+    }
+    return 0;
+}
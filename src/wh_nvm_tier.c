@@ -0,0 +1,371 @@
+/*
+ * Copyright (C) 2024 wolfSSL Inc.
+ *
+ * This file is part of wolfHSM.
+ *
+ * wolfHSM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfHSM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wolfHSM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * src/wh_nvm_tier.c
+ *
+ * NVM front end routing objects between a volatile and a persistent tier
+ *
+ */
+
+#include <stddef.h>     /* For NULL */
+#include <string.h>     /* For memset */
+
+#include "wolfhsm/wh_common.h"
+#include "wolfhsm/wh_error.h"
+#include "wolfhsm/wh_nvm.h"
+#include "wolfhsm/wh_nvm_tier.h"
+
+/* Number of persistent ids forwarded per DestroyObjects call */
+#define NT_DESTROY_BATCH (WOLFHSM_NUM_NVMOBJECTS)
+
+static int ntNext(whNvmTierContext* context, whNvmAccess access,
+        whNvmFlags flags, int* inout_tier, whNvmId* inout_id);
+
+
+/* Advance to the next visible id after *inout_id in tier *inout_tier, where
+ * tier 0 is volatile and tier 1 is persistent and an id of 0 starts at the
+ * beginning of the tier.  Persistent ids shadowed by a volatile object are
+ * skipped.  Returns WH_ERROR_NOTFOUND at the end of the list. */
+static int ntNext(whNvmTierContext* context, whNvmAccess access,
+        whNvmFlags flags, int* inout_tier, whNvmId* inout_id)
+{
+    int rc;
+    whNvmId count = 0;
+    whNvmId next = 0;
+
+    if (*inout_tier == 0) {
+        rc = wh_Nvm_List(context->volatile_nvm, access, flags, *inout_id,
+                &count, &next);
+        if (rc != 0) {
+            return rc;
+        }
+        if ((count > 0) && (next != 0)) {
+            *inout_id = next;
+            return 0;
+        }
+        *inout_tier = 1;
+        *inout_id = 0;
+    }
+
+    while (1) {
+        rc = wh_Nvm_List(context->persistent_nvm, access, flags, *inout_id,
+                &count, &next);
+        if (rc != 0) {
+            return rc;
+        }
+        if ((count == 0) || (next == 0)) {
+            return WH_ERROR_NOTFOUND;
+        }
+        *inout_id = next;
+        if (wh_Nvm_GetMetadata(context->volatile_nvm, next, NULL) != 0) {
+            return 0;
+        }
+    }
+}
+
+
+int wh_NvmTier_Init(void* c, const void* cf)
+{
+    whNvmTierContext* context = c;
+    const whNvmTierConfig* config = cf;
+    int rc;
+
+    if (    (context == NULL) ||
+            (config == NULL) ||
+            (config->volatile_config == NULL) ||
+            (config->persistent_config == NULL) ) {
+        return WH_ERROR_BADARGS;
+    }
+
+    memset(context, 0, sizeof(*context));
+    rc = wh_Nvm_Init(context->volatile_nvm, config->volatile_config);
+    if (rc == 0) {
+        rc = wh_Nvm_Init(context->persistent_nvm, config->persistent_config);
+        if (rc != 0) {
+            (void)wh_Nvm_Cleanup(context->volatile_nvm);
+        }
+    }
+    if (rc == 0) {
+        context->initialized = 1;
+    }
+    return rc;
+}
+
+int wh_NvmTier_Cleanup(void* c)
+{
+    whNvmTierContext* context = c;
+    int rc;
+    int rc2;
+
+    if (context == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+    if (context->initialized == 0) {
+        return 0;
+    }
+
+    rc = wh_Nvm_Cleanup(context->volatile_nvm);
+    rc2 = wh_Nvm_Cleanup(context->persistent_nvm);
+    memset(context, 0, sizeof(*context));
+    return (rc != 0) ? rc : rc2;
+}
+
+int wh_NvmTier_List(void* c,
+        whNvmAccess access, whNvmFlags flags, whNvmId start_id,
+        whNvmId *out_count, whNvmId *out_id)
+{
+    whNvmTierContext* context = c;
+    int rc = 0;
+    int tier = 0;
+    whNvmId id = 0;
+    whNvmId this_count = 0;
+    whNvmId this_id = 0;
+
+    if (context == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+
+    /* Position the walk at start_id in whichever tier serves it */
+    if (start_id != 0) {
+        id = start_id;
+        if (wh_Nvm_GetMetadata(context->volatile_nvm, start_id, NULL) != 0) {
+            tier = 1;
+            if (wh_Nvm_GetMetadata(context->persistent_nvm, start_id,
+                    NULL) != 0) {
+                /* None found */
+                tier = 2;
+            }
+        }
+    }
+
+    if (tier < 2) {
+        rc = ntNext(context, access, flags, &tier, &id);
+        if (rc == 0) {
+            this_id = id;
+            /* Now count how many more there are */
+            do {
+                this_count++;
+                rc = ntNext(context, access, flags, &tier, &id);
+            } while (rc == 0);
+        }
+        if (rc == WH_ERROR_NOTFOUND) {
+            rc = 0;
+        }
+    }
+
+    if (rc == 0) {
+        if (out_count != NULL) *out_count = this_count;
+        if (out_id != NULL) *out_id = this_id;
+    }
+    return rc;
+}
+
+int wh_NvmTier_GetAvailable(void* c,
+        uint32_t *out_avail_size, whNvmId *out_avail_objects,
+        uint32_t *out_reclaim_size, whNvmId *out_reclaim_objects)
+{
+    whNvmTierContext* context = c;
+    int rc;
+    uint32_t v_size = 0;
+    whNvmId v_objects = 0;
+    uint32_t p_size = 0;
+    whNvmId p_objects = 0;
+
+    if (context == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+
+    /* Reclaimable space only exists in the persistent tier */
+    rc = wh_Nvm_GetAvailable(context->volatile_nvm, &v_size, &v_objects,
+            NULL, NULL);
+    if (rc == 0) {
+        rc = wh_Nvm_GetAvailable(context->persistent_nvm, &p_size, &p_objects,
+                out_reclaim_size, out_reclaim_objects);
+    }
+    if (rc == 0) {
+        if (out_avail_size != NULL) *out_avail_size = v_size + p_size;
+        if (out_avail_objects != NULL) {
+            *out_avail_objects = (whNvmId)(v_objects + p_objects);
+        }
+    }
+    return rc;
+}
+
+int wh_NvmTier_GetMetadata(void* c, whNvmId id, whNvmMetadata* meta)
+{
+    whNvmTierContext* context = c;
+    int rc;
+
+    if (context == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+
+    rc = wh_Nvm_GetMetadata(context->volatile_nvm, id, meta);
+    if (rc == WH_ERROR_NOTFOUND) {
+        rc = wh_Nvm_GetMetadata(context->persistent_nvm, id, meta);
+    }
+    return rc;
+}
+
+int wh_NvmTier_AddObject(void* c, whNvmMetadata* meta,
+        whNvmSize data_len, const uint8_t* data)
+{
+    whNvmTierContext* context = c;
+    int rc;
+
+    if (    (context == NULL) ||
+            (meta == NULL) ) {
+        return WH_ERROR_BADARGS;
+    }
+
+    rc = wh_Nvm_AddObject(context->persistent_nvm, meta, data_len, data);
+    if (rc == 0) {
+        /* Drop any volatile copy so the new persistent object is visible */
+        rc = wh_Nvm_DestroyObjects(context->volatile_nvm, 1, &meta->id);
+    }
+    return rc;
+}
+
+int wh_NvmTier_AddVolatileObject(whNvmTierContext* context,
+        whNvmMetadata* meta, whNvmSize data_len, const uint8_t* data)
+{
+    if (    (context == NULL) ||
+            (context->initialized == 0) ||
+            (meta == NULL) ) {
+        return WH_ERROR_BADARGS;
+    }
+
+    return wh_Nvm_AddObject(context->volatile_nvm, meta, data_len, data);
+}
+
+int wh_NvmTier_DestroyObjects(void* c, whNvmId list_count,
+        const whNvmId* id_list)
+{
+    whNvmTierContext* context = c;
+    whNvmId batch[NT_DESTROY_BATCH];
+    whNvmId batch_count = 0;
+    int rc;
+    int i;
+
+    if (    (context == NULL) ||
+            ((list_count > 0) && (id_list == NULL)) ) {
+        return WH_ERROR_BADARGS;
+    }
+
+    /* A reclaim request only applies to the persistent tier */
+    if (list_count == 0) {
+        return wh_Nvm_DestroyObjects(context->persistent_nvm, 0, NULL);
+    }
+
+    rc = wh_Nvm_DestroyObjects(context->volatile_nvm, list_count, id_list);
+
+    /* Only forward ids the persistent tier holds, so destroying volatile
+     * objects never costs a persistent partition rewrite */
+    for (i = 0; (rc == 0) && (i < list_count); i++) {
+        if (wh_Nvm_GetMetadata(context->persistent_nvm, id_list[i],
+                NULL) == 0) {
+            batch[batch_count++] = id_list[i];
+        }
+        if (    (batch_count == NT_DESTROY_BATCH) ||
+                ((batch_count > 0) && (i == list_count - 1)) ) {
+            rc = wh_Nvm_DestroyObjects(context->persistent_nvm, batch_count,
+                    batch);
+            batch_count = 0;
+        }
+    }
+    return rc;
+}
+
+int wh_NvmTier_Read(void* c, whNvmId id, whNvmSize offset,
+        whNvmSize data_len, uint8_t* data)
+{
+    whNvmTierContext* context = c;
+    int rc;
+
+    if (context == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+
+    rc = wh_Nvm_Read(context->volatile_nvm, id, offset, data_len, data);
+    if (rc == WH_ERROR_NOTFOUND) {
+        rc = wh_Nvm_Read(context->persistent_nvm, id, offset, data_len, data);
+    }
+    return rc;
+}
+
+int wh_NvmTier_CreateLog(void* c, whNvmMetadata* meta,
+        whNvmSize data_len, const uint8_t* data)
+{
+    whNvmTierContext* context = c;
+    int rc;
+
+    if (    (context == NULL) ||
+            (meta == NULL) ) {
+        return WH_ERROR_BADARGS;
+    }
+
+    /* Logs exist to survive a reset, so they always go to persistent */
+    rc = wh_Nvm_CreateLog(context->persistent_nvm, meta, data_len, data);
+    if (rc == 0) {
+        rc = wh_Nvm_DestroyObjects(context->volatile_nvm, 1, &meta->id);
+    }
+    return rc;
+}
+
+int wh_NvmTier_Append(void* c, whNvmId id, whNvmSize data_len,
+        const uint8_t* data)
+{
+    whNvmTierContext* context = c;
+
+    if (context == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+
+    /* Append to whichever tier serves the id */
+    if (wh_Nvm_GetMetadata(context->volatile_nvm, id, NULL) == 0) {
+        return wh_Nvm_Append(context->volatile_nvm, id, data_len, data);
+    }
+    return wh_Nvm_Append(context->persistent_nvm, id, data_len, data);
+}
+
+/* Each tier applies the filter on its own, so the persistent tier is
+ * rewritten at most once.  out_count is the total removed from both tiers */
+int wh_NvmTier_DestroyMatching(void* c, const whNvmFilter* filter,
+        whNvmId* out_count)
+{
+    whNvmTierContext* context = c;
+    whNvmId volatile_count = 0;
+    whNvmId persistent_count = 0;
+    int rc;
+
+    if ((context == NULL) || (filter == NULL)) {
+        return WH_ERROR_BADARGS;
+    }
+
+    rc = wh_Nvm_DestroyMatching(context->volatile_nvm, filter,
+            &volatile_count);
+    if (rc == 0) {
+        rc = wh_Nvm_DestroyMatching(context->persistent_nvm, filter,
+                &persistent_count);
+    }
+    if ((rc == 0) && (out_count != NULL)) {
+        *out_count = volatile_count + persistent_count;
+    }
+    return rc;
+}
@@ -39,17 +39,16 @@
 #include "wolfhsm/wh_server_nvm.h"
 #include "wolfhsm/wh_server_crypto.h"
 #include "wolfhsm/wh_server_keystore.h"
+#include "wolfhsm/wh_server_pkcs11.h"
+#include "wolfhsm/wh_server_cert.h"
+#include "wolfhsm/wh_server_image.h"
+#include "wolfhsm/wh_server_keywrap.h"
+#include "wolfhsm/wh_server_chacha.h"
+#include "wolfhsm/wh_server_prepared.h"
 #if defined(WOLFHSM_SHE_EXTENSION)
 #include "wolfhsm/wh_server_she.h"
 #endif
 
-/** Forward declarations. */
-/* TODO: Move these out to separate C files */
-static int _wh_Server_HandlePkcs11Request(whServerContext* server,
-        uint16_t magic, uint16_t action, uint16_t seq,
-        uint16_t req_size, const void* req_packet,
-        uint16_t *out_resp_size, void* resp_packet);
-
 int wh_Server_Init(whServerContext* server, whServerConfig* config)
 {
     int rc = 0;
@@ -73,6 +72,12 @@ int wh_Server_Init(whServerContext* server, whServerConfig* config)
 #ifdef WOLFHSM_SHE_EXTENSION
     server->she = config->she;
 #endif
+    /* Servers on separate threads may share one keystore */
+    server->keystore = config->keystore;
+    if (server->keystore == NULL) {
+        server->keystore = server->localKeystore;
+    }
+    server->keystoreGeneration = server->keystore->generation;
 #endif
 
     rc = wh_CommServer_Init(server->comm, config->comm_config,
@@ -87,8 +92,24 @@ int wh_Server_Init(whServerContext* server, whServerConfig* config)
         server->dma.dmaAddrAllowList = config->dmaConfig->dmaAddrAllowList;
         server->dma.cb32             = config->dmaConfig->cb32;
         server->dma.cb64             = config->dmaConfig->cb64;
+
+        if (NULL != config->dmaConfig->engine) {
+            server->dma.engineCb      = config->dmaConfig->engine->cb;
+            server->dma.engineContext = config->dmaConfig->engine->context;
+            if (NULL != server->dma.engineCb) {
+                rc = server->dma.engineCb->Init(server->dma.engineContext,
+                        config->dmaConfig->engine->config);
+                if (rc != 0) {
+                    server->dma.engineCb = NULL;
+                    (void)wh_Server_Cleanup(server);
+                    return rc;
+                }
+            }
+        }
     }
 
+    server->nvmGc->config = config->nvmGcConfig;
+
     return rc;
 }
 
@@ -98,7 +119,20 @@ int wh_Server_Cleanup(whServerContext* server)
         return WH_ERROR_BADARGS;
     }
 
+    /* Release any multi-part operation state */
+    wh_Server_Pkcs11Reset(server);
+    wh_Server_ImageReset(server);
+    wh_Server_ChaChaReset(server);
+    wh_Server_PreparedReset(server);
+    server->customPending->resume = NULL;
+
     (void)wh_CommServer_Cleanup(server->comm);
+    if (NULL != server->dma.engineCb) {
+        (void)server->dma.engineCb->Cleanup(server->dma.engineContext);
+    }
+#ifndef WOLFHSM_NO_CRYPTO
+    wh_Server_EccVerifyCacheReset(server);
+#endif
 
     memset(server, 0, sizeof(*server));
 
@@ -112,6 +146,14 @@ int wh_Server_SetConnected(whServerContext *server, whCommConnected connected)
     }
 
     server->connected = connected;
+    if (connected == WH_COMM_DISCONNECTED) {
+        /* Nobody is left to receive a held or deferred response */
+        server->pending->active = 0;
+        server->customPending->resume = NULL;
+        /* Operations in progress belong to the departing client */
+        wh_Server_ChaChaReset(server);
+        wh_Server_PreparedReset(server);
+    }
     return WH_ERROR_OK;
 }
 
@@ -196,21 +238,44 @@ static int _wh_Server_HandleCommRequest(whServerContext* server,
     return rc;
 }
 
-static int _wh_Server_HandlePkcs11Request(whServerContext* server,
-        uint16_t magic, uint16_t action, uint16_t seq,
-        uint16_t req_size, const void* req_packet,
-        uint16_t *out_resp_size, void* resp_packet)
+static int _wh_Server_SendResponse(whServerContext* server, uint16_t magic,
+        uint16_t kind, uint16_t seq, uint16_t size, uint8_t* data)
 {
-    int rc = 0;
-    switch (action) {
-    /* TODO: Add PKCS11 message handling here */
-    default:
-        /* Unknown request. Respond with empty packet */
-        *out_resp_size = 0;
+    int rc = wh_CommServer_SendResponse(server->comm, magic, kind, seq,
+            size, data);
+    if (rc == WH_ERROR_NOTREADY) {
+        /* Transport is busy. The response stays in the comm buffer
+         * and is retried on a later call rather than stalling here */
+        server->pending->magic = magic;
+        server->pending->kind = kind;
+        server->pending->seq = seq;
+        server->pending->size = size;
+        server->pending->active = 1;
+        rc = 0;
     }
     return rc;
 }
 
+#ifndef WOLFHSM_NO_CRYPTO
+/* Message groups whose handlers use keys or state derived from them */
+static int _wh_Server_GroupUsesKeyCache(uint16_t group)
+{
+    switch (group) {
+    case WH_MESSAGE_GROUP_CRYPTO:
+    case WH_MESSAGE_GROUP_PKCS11:
+    case WH_MESSAGE_GROUP_KEYWRAP:
+    case WH_MESSAGE_GROUP_CHACHA:
+    case WH_MESSAGE_GROUP_PREPARED:
+#ifdef WOLFHSM_SHE_EXTENSION
+    case WH_MESSAGE_GROUP_SHE:
+#endif
+        return 1;
+    default:
+        return 0;
+    }
+}
+#endif
+
 int wh_Server_HandleRequestMessage(whServerContext* server)
 {
     uint16_t magic = 0;
@@ -220,6 +285,7 @@ int wh_Server_HandleRequestMessage(whServerContext* server)
     uint16_t seq = 0;
     uint16_t size = 0;
     uint8_t* data = NULL;
+    int rc = 0;
 
     if (server == NULL) {
         return WH_ERROR_BADARGS;
@@ -234,12 +300,56 @@ int wh_Server_HandleRequestMessage(whServerContext* server)
         return WH_ERROR_NOTREADY;
     }
 
-    int rc = wh_CommServer_RecvRequest(server->comm, &magic, &kind, &seq,
+    /* Flush a held response before accepting another request */
+    if (server->pending->active != 0) {
+        rc = wh_CommServer_SendResponse(server->comm, server->pending->magic,
+                server->pending->kind, server->pending->seq,
+                server->pending->size, data);
+        if (rc != WH_ERROR_NOTREADY) {
+            server->pending->active = 0;
+        }
+        return rc;
+    }
+
+    rc = wh_CommServer_RecvRequest(server->comm, &magic, &kind, &seq,
             &size, data);
+
+    if (server->customPending->resume != NULL) {
+        if (    (rc == 0) &&
+                (seq == server->customPending->seq) &&
+                (kind == server->customPending->kind) ) {
+            /* Mailbox transports still hold the deferred request */
+            rc = WH_ERROR_NOTREADY;
+        }
+        if (rc == WH_ERROR_NOTREADY) {
+            /* Advance the deferred custom callback */
+            rc = wh_Server_HandleCustomCbPending(server, &size, data);
+            if (rc == 0) {
+                rc = _wh_Server_SendResponse(server,
+                        server->customPending->magic,
+                        server->customPending->kind,
+                        server->customPending->seq, size, data);
+            }
+            return rc;
+        }
+        if (rc == 0) {
+            /* A new request means the client gave up waiting, such as to
+             * close the connection.  Its response would be stale */
+            server->customPending->resume = NULL;
+        }
+    }
     /* Got a packet? */
     if (rc == 0) {
         group = WH_MESSAGE_GROUP(kind);
         action = WH_MESSAGE_ACTION(kind);
+#ifndef WOLFHSM_NO_CRYPTO
+        /* Keystore functions lock the keystore themselves.  Catch up with key
+         * changes made by other servers sharing it */
+        if (_wh_Server_GroupUsesKeyCache(group)) {
+            hsmKeystoreSync(server);
+        }
+#endif
+        (void)wh_CommServer_MarkDispatch(server->comm);
         switch (group) {
 
         case WH_MESSAGE_GROUP_COMM:
@@ -264,8 +374,33 @@ int wh_Server_HandleRequestMessage(whServerContext* server)
         break;
 #endif  /* WOLFHSM_NO_CRYPTO */
 
+        case WH_MESSAGE_GROUP_IMAGE:
+            rc = wh_Server_HandleImageRequest(server, magic, action, seq,
+                    size, data, &size, data);
+        break;
+
         case WH_MESSAGE_GROUP_PKCS11:
-            rc = _wh_Server_HandlePkcs11Request(server, magic, action, seq,
+            rc = wh_Server_HandlePkcs11Request(server, magic, action, seq,
+                    size, data, &size, data);
+        break;
+
+        case WH_MESSAGE_GROUP_CERT:
+            rc = wh_Server_HandleCertRequest(server, magic, action, seq,
+                    size, data, &size, data);
+        break;
+
+        case WH_MESSAGE_GROUP_KEYWRAP:
+            rc = wh_Server_HandleKeyWrapRequest(server, magic, action, seq,
+                    size, data, &size, data);
+        break;
+
+        case WH_MESSAGE_GROUP_CHACHA:
+            rc = wh_Server_HandleChaChaRequest(server, magic, action, seq,
+                    size, data, &size, data);
+        break;
+
+        case WH_MESSAGE_GROUP_PREPARED:
+            rc = wh_Server_HandlePreparedRequest(server, magic, action, seq,
                     size, data, &size, data);
         break;
 
@@ -290,11 +425,13 @@ int wh_Server_HandleRequestMessage(whServerContext* server)
         /* Send a response */
         /* TODO: Respond with ErrorResponse if handler returns an error */
         if (rc == 0) {
-            do {
-                rc = wh_CommServer_SendResponse(server->comm, magic, kind, seq,
-                    size, data);
-            } while (rc == WH_ERROR_NOTREADY);
+            rc = _wh_Server_SendResponse(server, magic, kind, seq, size, data);
         }
     }
+    else if (rc == WH_ERROR_NOTREADY) {
+        /* No request waiting.  Use the idle time to mount NVM, finish
+         * deferred partition erases and compact */
+        (void)wh_Server_NvmIdle(server);
+    }
     return rc;
 }
@@ -0,0 +1,445 @@
+/*
+ * Copyright (C) 2024 wolfSSL Inc.
+ *
+ * This file is part of wolfHSM.
+ *
+ * wolfHSM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfHSM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wolfHSM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * src/wh_server_cert.c
+ *
+ * Certificate chain verification against trust anchors held in NVM.
+ */
+
+/* System libraries */
+#include <stdint.h>
+#include <stdlib.h>  /* For NULL */
+#include <string.h>  /* For memset, memcpy */
+
+/* Common WolfHSM types and defines shared with the server */
+#include "wolfhsm/wh_error.h"
+#include "wolfhsm/wh_comm.h"
+
+#include "wolfhsm/wh_nvm.h"
+
+#include "wolfhsm/wh_message.h"
+#include "wolfhsm/wh_message_cert.h"
+
+#include "wolfhsm/wh_server.h"
+#include "wolfhsm/wh_server_cert.h"
+
+#ifndef WOLFHSM_NO_CRYPTO
+#include "wolfssl/wolfcrypt/settings.h"
+#include "wolfssl/wolfcrypt/types.h"
+#include "wolfssl/wolfcrypt/error-crypt.h"
+#include "wolfssl/wolfcrypt/asn.h"
+#include "wolfssl/wolfcrypt/asn_public.h"
+
+/* Total length of the DER SEQUENCE starting at der, including its header */
+static int _Cert_DerLength(const uint8_t* der, uint32_t max,
+        uint32_t* out_len)
+{
+    uint32_t hdr = 2;
+    uint32_t len = 0;
+    uint32_t i;
+
+    if ((max < hdr) || (der[0] != (ASN_SEQUENCE | ASN_CONSTRUCTED))) {
+        return WH_ERROR_BADARGS;
+    }
+    if (der[1] < 0x80) {
+        len = der[1];
+    } else {
+        /* Long form, at most 3 length bytes. Indefinite form is not DER */
+        hdr += der[1] & 0x7F;
+        if ((hdr == 2) || (hdr > 5) || (hdr > max)) {
+            return WH_ERROR_BADARGS;
+        }
+        for (i = 2; i < hdr; i++) {
+            len = (len << 8) | der[i];
+        }
+    }
+    if (len > max - hdr) {
+        return WH_ERROR_BADARGS;
+    }
+    *out_len = hdr + len;
+    return 0;
+}
+
+/* Find the parsed anchor for id, reading and parsing it from NVM on a miss.
+ * An entry parsed at an older NVM generation is a miss that reuses its own
+ * entry.  Otherwise a miss replaces a free entry or the least recently used
+ * one. Only a CA certificate is accepted as an anchor */
+static int _Cert_GetAnchor(whServerContext* server, whNvmId id,
+        whServerCertCacheEntry** out_entry)
+{
+    whServerCertContext* ctx = server->cert;
+    whServerCertCacheEntry* entry = NULL;
+    whNvmMetadata meta = {0};
+    uint8_t* der = ctx->der;
+    DecodedCert* cert = ctx->decoded;
+    uint32_t generation = wh_Nvm_GetGeneration(server->nvm);
+    int ret = 0;
+    int i;
+
+    for (i = 0; i < WOLFHSM_NUM_CERT_CACHE; i++) {
+        if (ctx->entries[i].id == id) {
+            entry = &ctx->entries[i];
+            break;
+        }
+    }
+    if (entry != NULL) {
+        if (entry->nvmGeneration == generation) {
+            entry->lastUse = ++ctx->useCounter;
+            *out_entry = entry;
+            return 0;
+        }
+        /* The object may have changed or gone.  Parse it again */
+        memset(entry, 0, sizeof(*entry));
+    }
+
+    ret = wh_Nvm_GetMetadata(server->nvm, id, &meta);
+    if ((ret == 0) && (meta.len > sizeof(ctx->der))) {
+        ret = WH_ERROR_NOSPACE;
+    }
+    if (ret == 0) {
+        ret = wh_Nvm_Read(server->nvm, id, 0, meta.len, der);
+    }
+    if (ret != 0) {
+        return ret;
+    }
+
+    wc_InitDecodedCert(cert, der, meta.len, NULL);
+    ret = wc_ParseCert(cert, CERT_TYPE, NO_VERIFY, NULL);
+    if ((ret != 0) || (cert->isCA == 0)) {
+        ret = WH_ERROR_CERTVERIFY;
+    } else if (cert->pubKeySize > WOLFHSM_CERT_PUBKEY_MAX) {
+        ret = WH_ERROR_NOSPACE;
+    }
+    if ((ret == 0) && (entry == NULL)) {
+        entry = &ctx->entries[0];
+        for (i = 0; i < WOLFHSM_NUM_CERT_CACHE; i++) {
+            if (ctx->entries[i].id == 0) {
+                entry = &ctx->entries[i];
+                break;
+            }
+            if (ctx->entries[i].lastUse < entry->lastUse) {
+                entry = &ctx->entries[i];
+            }
+        }
+    }
+    if (ret == 0) {
+        entry->id = id;
+        entry->pubKeySz = cert->pubKeySize;
+        entry->keyOID = cert->keyOID;
+        entry->nvmGeneration = generation;
+        memcpy(entry->subjectHash, cert->subjectHash,
+                sizeof(entry->subjectHash));
+        memcpy(entry->pubKey, cert->publicKey, cert->pubKeySize);
+        entry->lastUse = ++ctx->useCounter;
+        *out_entry = entry;
+    }
+    wc_FreeDecodedCert(cert);
+    return ret;
+}
+#endif /* !WOLFHSM_NO_CRYPTO */
+
+int wh_Server_CertVerifyChain(whServerContext* server, const uint8_t* chain,
+        uint32_t chain_len, whNvmId trusted_id, uint16_t* out_depth)
+{
+#ifndef WOLFHSM_NO_CRYPTO
+    uint32_t offsets[WOLFHSM_CERT_MAX_CHAIN];
+    uint32_t lens[WOLFHSM_CERT_MAX_CHAIN];
+    int count = 0;
+    uint32_t pos = 0;
+    whServerCertCacheEntry* anchor = NULL;
+    DecodedCert* cert = NULL;
+    /* Issuer of the certificate currently being checked */
+    uint8_t key[WOLFHSM_CERT_PUBKEY_MAX];
+    uint32_t keySz = 0;
+    uint32_t keyOID = 0;
+    uint8_t hash[KEYID_SIZE];
+    uint16_t depth = 0;
+    int ret = 0;
+    int i;
+#endif
+
+    if (    (server == NULL) ||
+            (chain == NULL) ||
+            (chain_len == 0) ||
+            (trusted_id == 0) ) {
+        return WH_ERROR_BADARGS;
+    }
+
+#ifndef WOLFHSM_NO_CRYPTO
+    /* Split the chain without copying */
+    while ((ret == 0) && (pos < chain_len)) {
+        if (count == WOLFHSM_CERT_MAX_CHAIN) {
+            ret = WH_ERROR_NOSPACE;
+            break;
+        }
+        ret = _Cert_DerLength(chain + pos, chain_len - pos, &lens[count]);
+        if (ret == 0) {
+            offsets[count] = pos;
+            pos += lens[count];
+            count++;
+        }
+    }
+
+    if (ret == 0) {
+        ret = _Cert_GetAnchor(server, trusted_id, &anchor);
+    }
+    if (ret == 0) {
+        keySz = anchor->pubKeySz;
+        keyOID = anchor->keyOID;
+        memcpy(key, anchor->pubKey, keySz);
+        memcpy(hash, anchor->subjectHash, sizeof(hash));
+    }
+
+    /* Walk from the certificate nearest the anchor down to the leaf */
+    cert = server->cert->decoded;
+    for (i = count - 1; (ret == 0) && (i >= 0); i--) {
+        const uint8_t* der = chain + offsets[i];
+
+        wc_InitDecodedCert(cert, der, lens[i], NULL);
+        if (wc_ParseCert(cert, CERT_TYPE, NO_VERIFY, NULL) != 0) {
+            ret = WH_ERROR_CERTVERIFY;
+        } else if ( (i == count - 1) &&
+                    (memcmp(cert->subjectHash, hash, sizeof(hash)) == 0) &&
+                    (cert->pubKeySize == keySz) &&
+                    (memcmp(cert->publicKey, key, keySz) == 0) ) {
+            /* The client included the anchor at the top of the chain */
+            depth++;
+        } else if ( (memcmp(cert->issuerHash, hash, sizeof(hash)) != 0) ||
+                    (wc_CheckCertSigPubKey(der, lens[i], NULL, key, keySz,
+                            keyOID) != 0) ) {
+            ret = WH_ERROR_CERTVERIFY;
+        } else if ( (i > 0) &&
+                    ((cert->isCA == 0) ||
+                     (cert->pubKeySize > sizeof(key))) ) {
+            /* Only a CA may issue the next certificate down */
+            ret = WH_ERROR_CERTVERIFY;
+        } else {
+            depth++;
+            if (i > 0) {
+                keySz = cert->pubKeySize;
+                keyOID = cert->keyOID;
+                memcpy(key, cert->publicKey, keySz);
+                memcpy(hash, cert->subjectHash, sizeof(hash));
+            }
+        }
+        wc_FreeDecodedCert(cert);
+    }
+
+    if (out_depth != NULL) {
+        *out_depth = depth;
+    }
+    return ret;
+#else
+    (void)out_depth;
+    return WH_ERROR_NOHANDLER;
+#endif
+}
+
+void wh_Server_CertCacheInvalidate(whServerContext* server, whNvmId id)
+{
+#ifndef WOLFHSM_NO_CRYPTO
+    int i;
+
+    if (server == NULL) {
+        return;
+    }
+    for (i = 0; i < WOLFHSM_NUM_CERT_CACHE; i++) {
+        if (server->cert->entries[i].id == id) {
+            memset(&server->cert->entries[i], 0,
+                    sizeof(server->cert->entries[i]));
+        }
+    }
+#else
+    (void)server;
+    (void)id;
+#endif
+}
+
+void wh_Server_CertCacheInvalidateMatching(whServerContext* server,
+        const whNvmFilter* filter)
+{
+#ifndef WOLFHSM_NO_CRYPTO
+    whNvmMetadata meta;
+    int i;
+
+    if ((server == NULL) || (filter == NULL)) {
+        return;
+    }
+    for (i = 0; i < WOLFHSM_NUM_CERT_CACHE; i++) {
+        if (server->cert->entries[i].id == WH_NVM_INVALID_ID) {
+            continue;
+        }
+        /* Drop entries whose object cannot be checked as well */
+        if (    (wh_Nvm_GetMetadata(server->nvm,
+                    server->cert->entries[i].id, &meta) != 0) ||
+                (wh_Nvm_FilterMatches(filter, &meta) != 0) ) {
+            memset(&server->cert->entries[i], 0,
+                    sizeof(server->cert->entries[i]));
+        }
+    }
+#else
+    (void)server;
+    (void)filter;
+#endif
+}
+
+int wh_Server_HandleCertRequest(whServerContext* server,
+        uint16_t magic, uint16_t action, uint16_t seq,
+        uint16_t req_size, const void* req_packet,
+        uint16_t *out_resp_size, void* resp_packet)
+{
+    int rc = 0;
+
+    (void)seq;
+
+    if (    (server == NULL) ||
+            (req_packet == NULL) ||
+            (resp_packet == NULL) ||
+            (out_resp_size == NULL) ) {
+        return WH_ERROR_BADARGS;
+    }
+
+    /* III: Translate function returns do not need to be checked since args
+     * are not NULL */
+
+    switch (action) {
+
+    case WH_MESSAGE_CERT_ACTION_VERIFY:
+    {
+        whMessageCert_VerifyRequest req = {0};
+        uint16_t hdr_len = sizeof(req);
+        const uint8_t* chain = (const uint8_t*)req_packet + hdr_len;
+        whMessageCert_VerifyResponse resp = {0};
+
+        if (req_size >= sizeof(req)) {
+            /* Convert request struct */
+            wh_MessageCert_TranslateVerifyRequest(magic,
+                    (whMessageCert_VerifyRequest*)req_packet, &req);
+            if (req_size == (hdr_len + req.chain_len)) {
+                /* Process the Verify action */
+                resp.rc = wh_Server_CertVerifyChain(server, chain,
+                        req.chain_len, req.trusted_id, &resp.depth);
+            } else {
+                /* Problem in the request or transport. */
+                resp.rc = WH_ERROR_ABORTED;
+            }
+        } else {
+            /* Request is malformed */
+            resp.rc = WH_ERROR_ABORTED;
+        }
+        /* Convert the response struct */
+        wh_MessageCert_TranslateVerifyResponse(magic,
+                &resp, (whMessageCert_VerifyResponse*)resp_packet);
+        *out_resp_size = sizeof(resp);
+    }; break;
+
+    case WH_MESSAGE_CERT_ACTION_VERIFYDMA32:
+    {
+        whMessageCert_VerifyDma32Request req = {0};
+        whMessageCert_VerifyResponse resp = {0};
+        void* chain = NULL;
+
+        if (req_size == sizeof(req)) {
+            /* Convert request struct */
+            wh_MessageCert_TranslateVerifyDma32Request(magic,
+                    (whMessageCert_VerifyDma32Request*)req_packet, &req);
+
+            /* perform platform-specific host address processing */
+            resp.rc = wh_Server_DmaProcessClientAddress32(
+                server, req.chain_hostaddr, &chain, req.chain_len,
+                WH_DMA_OPER_CLIENT_READ_PRE, (whServerDmaFlags){0});
+            if (resp.rc != WH_ERROR_OK) {
+                goto transRespVerifyDma32;
+            }
+
+            /* Process the Verify action */
+            resp.rc = wh_Server_CertVerifyChain(server, (const uint8_t*)chain,
+                    req.chain_len, req.trusted_id, &resp.depth);
+
+            /* perform platform-specific host address processing */
+            if (resp.rc == WH_ERROR_OK) {
+                resp.rc = wh_Server_DmaProcessClientAddress32(
+                    server, req.chain_hostaddr, &chain, req.chain_len,
+                    WH_DMA_OPER_CLIENT_READ_POST, (whServerDmaFlags){0});
+            } else {
+                (void)wh_Server_DmaProcessClientAddress32(
+                    server, req.chain_hostaddr, &chain, req.chain_len,
+                    WH_DMA_OPER_CLIENT_READ_POST, (whServerDmaFlags){0});
+            }
+        } else {
+            /* Request is malformed */
+            resp.rc = WH_ERROR_ABORTED;
+        }
+    transRespVerifyDma32:
+        /* Convert the response struct */
+        wh_MessageCert_TranslateVerifyResponse(magic,
+                &resp, (whMessageCert_VerifyResponse*)resp_packet);
+        *out_resp_size = sizeof(resp);
+    }; break;
+
+    case WH_MESSAGE_CERT_ACTION_VERIFYDMA64:
+    {
+        whMessageCert_VerifyDma64Request req = {0};
+        whMessageCert_VerifyResponse resp = {0};
+        void* chain = NULL;
+
+        if (req_size == sizeof(req)) {
+            /* Convert request struct */
+            wh_MessageCert_TranslateVerifyDma64Request(magic,
+                    (whMessageCert_VerifyDma64Request*)req_packet, &req);
+
+            /* perform platform-specific host address processing */
+            resp.rc = wh_Server_DmaProcessClientAddress64(
+                server, req.chain_hostaddr, &chain, req.chain_len,
+                WH_DMA_OPER_CLIENT_READ_PRE, (whServerDmaFlags){0});
+            if (resp.rc != WH_ERROR_OK) {
+                goto transRespVerifyDma64;
+            }
+
+            /* Process the Verify action */
+            resp.rc = wh_Server_CertVerifyChain(server, (const uint8_t*)chain,
+                    req.chain_len, req.trusted_id, &resp.depth);
+
+            /* perform platform-specific host address processing */
+            if (resp.rc == WH_ERROR_OK) {
+                resp.rc = wh_Server_DmaProcessClientAddress64(
+                    server, req.chain_hostaddr, &chain, req.chain_len,
+                    WH_DMA_OPER_CLIENT_READ_POST, (whServerDmaFlags){0});
+            } else {
+                (void)wh_Server_DmaProcessClientAddress64(
+                    server, req.chain_hostaddr, &chain, req.chain_len,
+                    WH_DMA_OPER_CLIENT_READ_POST, (whServerDmaFlags){0});
+            }
+        } else {
+            /* Request is malformed */
+            resp.rc = WH_ERROR_ABORTED;
+        }
+    transRespVerifyDma64:
+        /* Convert the response struct */
+        wh_MessageCert_TranslateVerifyResponse(magic,
+                &resp, (whMessageCert_VerifyResponse*)resp_packet);
+        *out_resp_size = sizeof(resp);
+    }; break;
+
+    default:
+        /* Unknown request. Respond with empty packet */
+        *out_resp_size = 0;
+    }
+    return rc;
+}
@@ -0,0 +1,645 @@
+/*
+ * Copyright (C) 2024 wolfSSL Inc.
+ *
+ * This file is part of wolfHSM.
+ *
+ * wolfHSM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfHSM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wolfHSM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * src/wh_server_chacha.c
+ *
+ * ChaCha20-Poly1305 with keys held in the keystore.  Streaming sessions keep
+ * the cipher and MAC state in the server context between requests, and DMA
+ * requests process client memory in windows of WOLFHSM_CHACHA_DMA_WINDOW
+ * bytes.
+ */
+
+/* System libraries */
+#include <stdint.h>
+#include <stdlib.h>  /* For NULL */
+#include <string.h>  /* For memset, memcpy */
+
+/* Common WolfHSM types and defines shared with the server */
+#include "wolfhsm/wh_error.h"
+#include "wolfhsm/wh_comm.h"
+
+#include "wolfhsm/wh_message.h"
+#include "wolfhsm/wh_message_chacha.h"
+
+#include "wolfhsm/wh_server.h"
+#include "wolfhsm/wh_server_chacha.h"
+
+#ifndef WOLFHSM_NO_CRYPTO
+#include "wolfssl/wolfcrypt/settings.h"
+#include "wolfssl/wolfcrypt/types.h"
+#include "wolfssl/wolfcrypt/error-crypt.h"
+
+#include "wolfhsm/wh_server_keystore.h"
+#endif
+
+#if !defined(WOLFHSM_NO_CRYPTO) && defined(HAVE_CHACHA) && \
+    defined(HAVE_POLY1305)
+
+/* Key the AEAD with a 256-bit key from the keystore.  The size is checked
+ * before the key is read since NVM reads are not bounded by the buffer */
+static int _ChaCha_Start(whServerContext* server, ChaChaPoly_Aead* aead,
+        whKeyId key_id, const uint8_t* iv, uint8_t enc)
+{
+    uint8_t key[WH_CHACHA_KEY_LEN];
+    uint32_t keySz = sizeof(key);
+    whKeyId keyId = MAKE_WOLFHSM_KEYID(WOLFHSM_KEYTYPE_CRYPTO,
+            server->comm->client_id, key_id);
+    int ret = 0;
+
+    ret = hsmReadKey(server, keyId, NULL, NULL, &keySz);
+    if ((ret == 0) && (keySz != sizeof(key))) {
+        ret = WH_ERROR_BADARGS;
+    }
+    if (ret == 0) {
+        ret = hsmReadKey(server, keyId, NULL, key, &keySz);
+    }
+    if (ret == 0) {
+        ret = wc_ChaCha20Poly1305_Init(aead, key, iv,
+                (enc != 0) ? CHACHA20_POLY1305_AEAD_ENCRYPT :
+                             CHACHA20_POLY1305_AEAD_DECRYPT);
+    }
+    wc_ForceZero(key, sizeof(key));
+    return ret;
+}
+
+/* Process inline AAD followed by inline data */
+static int _ChaCha_Update(ChaChaPoly_Aead* aead, const uint8_t* aad,
+        uint16_t aad_len, const uint8_t* in, uint8_t* out, uint16_t data_len)
+{
+    int ret = 0;
+
+    if (aad_len > 0) {
+        ret = wc_ChaCha20Poly1305_UpdateAad(aead, aad, aad_len);
+    }
+    if ((ret == 0) && (data_len > 0)) {
+        ret = wc_ChaCha20Poly1305_UpdateData(aead, in, out, data_len);
+    }
+    return ret;
+}
+
+/* Finish the message.  Encryption returns the tag, decryption checks it */
+static int _ChaCha_Finish(ChaChaPoly_Aead* aead, uint8_t enc,
+        const uint8_t* expected, uint8_t* out_tag)
+{
+    uint8_t tag[WH_CHACHA_TAG_LEN];
+    int ret = 0;
+
+    ret = wc_ChaCha20Poly1305_Final(aead, tag);
+    if (ret == 0) {
+        if (enc != 0) {
+            memcpy(out_tag, tag, sizeof(tag));
+        } else {
+            ret = wc_ChaCha20Poly1305_CheckTag(expected, tag);
+        }
+    }
+    return ret;
+}
+
+/* One-shot operation on inline data.  The request is copied out first as
+ * the output overlaps it in the shared comm buffer */
+static int _ChaCha_Crypt(whServerContext* server,
+        const whMessageChaCha_CryptRequest* req, const uint8_t* payload,
+        uint8_t* out, uint8_t* out_tag)
+{
+    ChaChaPoly_Aead aead[1];
+    uint8_t in[WH_MESSAGE_CHACHA_MAX_INLINE_LEN];
+    int ret = 0;
+
+    if (req->aad_len + req->data_len > sizeof(in)) {
+        return WH_ERROR_BADARGS;
+    }
+    memcpy(in, payload, req->aad_len + req->data_len);
+    ret = _ChaCha_Start(server, aead, req->key_id, req->iv, req->enc);
+    if (ret == 0) {
+        ret = _ChaCha_Update(aead, in, req->aad_len, in + req->aad_len,
+                out, req->data_len);
+    }
+    if (ret == 0) {
+        ret = _ChaCha_Finish(aead, req->enc, req->tag, out_tag);
+    }
+    if (ret != 0) {
+        /* Do not leave unauthenticated plaintext in the comm buffer */
+        wc_ForceZero(out, req->data_len);
+    }
+    wc_ForceZero(aead, sizeof(aead));
+    wc_ForceZero(in, sizeof(in));
+    return ret;
+}
+
+static whServerChaChaSession* _ChaCha_GetSession(whServerContext* server,
+        uint16_t session)
+{
+    whServerChaChaSession* s = NULL;
+
+    if ((session == 0) || (session > WOLFHSM_NUM_CHACHA_SESSIONS)) {
+        return NULL;
+    }
+    s = &server->chacha->sessions[session - 1];
+    /* Sessions only resolve for the client that started them */
+    return ((s->active != 0) && (s->clientId == server->comm->client_id)) ?
+            s : NULL;
+}
+
+static void _ChaCha_EndSession(whServerChaChaSession* s)
+{
+    wc_ForceZero(s, sizeof(*s));
+}
+
+static int _ChaCha_Init(whServerContext* server,
+        const whMessageChaCha_InitRequest* req, uint16_t* out_session)
+{
+    whServerChaChaSession* s = NULL;
+    int ret = 0;
+    int i = 0;
+
+    for (i = 0; i < WOLFHSM_NUM_CHACHA_SESSIONS; i++) {
+        if (server->chacha->sessions[i].active == 0) {
+            s = &server->chacha->sessions[i];
+            break;
+        }
+    }
+    if (s == NULL) {
+        return WH_ERROR_NOSPACE;
+    }
+
+    ret = _ChaCha_Start(server, s->aead, req->key_id, req->iv, req->enc);
+    if (ret == 0) {
+        s->enc = (req->enc != 0);
+        s->clientId = server->comm->client_id;
+        s->active = 1;
+        *out_session = (uint16_t)(i + 1);
+    } else {
+        _ChaCha_EndSession(s);
+    }
+    return ret;
+}
+
+/* Any failure ends the session so a partial message cannot be finished */
+static int _ChaCha_SessionUpdate(whServerContext* server,
+        const whMessageChaCha_UpdateRequest* req, const uint8_t* payload,
+        uint8_t* out)
+{
+    whServerChaChaSession* s = _ChaCha_GetSession(server, req->session);
+    uint8_t in[WH_MESSAGE_CHACHA_MAX_INLINE_LEN];
+    int ret = 0;
+
+    if (s == NULL) {
+        return WH_ERROR_BADHANDLE;
+    }
+    if (req->aad_len + req->data_len > sizeof(in)) {
+        return WH_ERROR_BADARGS;
+    }
+    memcpy(in, payload, req->aad_len + req->data_len);
+    ret = _ChaCha_Update(s->aead, in, req->aad_len, in + req->aad_len,
+            out, req->data_len);
+    if (ret != 0) {
+        _ChaCha_EndSession(s);
+    }
+    wc_ForceZero(in, sizeof(in));
+    return ret;
+}
+
+static int _ChaCha_SessionFinal(whServerContext* server,
+        const whMessageChaCha_FinalRequest* req, uint8_t* out_tag)
+{
+    whServerChaChaSession* s = _ChaCha_GetSession(server, req->session);
+    int ret = 0;
+
+    if (s == NULL) {
+        return WH_ERROR_BADHANDLE;
+    }
+    ret = _ChaCha_Finish(s->aead, s->enc, req->tag, out_tag);
+    _ChaCha_EndSession(s);
+    return ret;
+}
+
+/* Feed a mapped window of client memory into the AAD.  With a DMA copy
+ * engine, the next piece is copied into a staging buffer while the current
+ * one is authenticated, instead of the core reading client memory */
+static int _ChaCha_AadWindow(whServerContext* server, ChaChaPoly_Aead* aead,
+        const uint8_t* ptr, uint32_t len)
+{
+    uint8_t (*stage)[WOLFHSM_DMA_STAGE_LEN] = server->dma.stage;
+    uint32_t next = 0;
+    uint32_t cur = 0;
+    uint32_t curLen = 0;
+    int which = 0;
+    int ret = 0;
+    int waitRet = 0;
+
+    if (server->dma.engineCb == NULL) {
+        return wc_ChaCha20Poly1305_UpdateAad(aead, (const byte*)ptr, len);
+    }
+
+    /* Prime the first staging buffer */
+    curLen = (len < sizeof(stage[0])) ? len : sizeof(stage[0]);
+    ret = wh_Server_DmaCopySubmit(server, stage[which], ptr, curLen);
+    next = curLen;
+
+    while ((ret == 0) && (cur < len)) {
+        ret = wh_Server_DmaCopyWait(server);
+        if ((ret == 0) && (next < len)) {
+            uint32_t nextLen = len - next;
+            if (nextLen > sizeof(stage[0])) {
+                nextLen = sizeof(stage[0]);
+            }
+            ret = wh_Server_DmaCopySubmit(server, stage[which ^ 1],
+                    ptr + next, nextLen);
+            next += nextLen;
+        }
+        if (ret == 0) {
+            /* Overlaps with the copy of the next piece */
+            ret = wc_ChaCha20Poly1305_UpdateAad(aead,
+                    (const byte*)stage[which], curLen);
+        }
+        cur += curLen;
+        curLen = ((next - cur) < sizeof(stage[0])) ?
+                (next - cur) : sizeof(stage[0]);
+        which ^= 1;
+    }
+
+    /* Drain any copy still in flight before the window is unmapped */
+    waitRet = wh_Server_DmaCopyWait(server);
+    if (ret == 0) {
+        ret = waitRet;
+    }
+    wc_ForceZero(stage, 2 * sizeof(stage[0]));
+    return ret;
+}
+
+/* Process a mapped window of client memory.  With a DMA copy engine, each
+ * piece is copied into a staging buffer and processed in place there.  Its
+ * copy back out to the client runs while the next piece is processed */
+static int _ChaCha_DataWindow(whServerContext* server, ChaChaPoly_Aead* aead,
+        const uint8_t* in, uint8_t* out, uint32_t len)
+{
+    uint8_t (*stage)[WOLFHSM_DMA_STAGE_LEN] = server->dma.stage;
+    uint32_t offset = 0;
+    uint32_t chunk = 0;
+    int which = 0;
+    int ret = 0;
+    int waitRet = 0;
+
+    if (server->dma.engineCb == NULL) {
+        return wc_ChaCha20Poly1305_UpdateData(aead, (const byte*)in,
+                (byte*)out, len);
+    }
+
+    while ((ret == 0) && (offset < len)) {
+        chunk = len - offset;
+        if (chunk > sizeof(stage[0])) {
+            chunk = sizeof(stage[0]);
+        }
+        /* The engine is idle here, the previous copy out having finished */
+        ret = wh_Server_DmaCopySubmit(server, stage[which], in + offset,
+                chunk);
+        if (ret == 0) {
+            ret = wh_Server_DmaCopyWait(server);
+        }
+        if ((ret == 0) && (offset > 0)) {
+            /* Copy out the previous piece, held in the other buffer */
+            ret = wh_Server_DmaCopySubmit(server,
+                    out + offset - sizeof(stage[0]), stage[which ^ 1],
+                    sizeof(stage[0]));
+        }
+        if (ret == 0) {
+            ret = wc_ChaCha20Poly1305_UpdateData(aead,
+                    (const byte*)stage[which], (byte*)stage[which], chunk);
+        }
+        if (ret == 0) {
+            ret = wh_Server_DmaCopyWait(server);
+        }
+        offset += chunk;
+        which ^= 1;
+    }
+    if ((ret == 0) && (len > 0)) {
+        ret = wh_Server_DmaCopySubmit(server, out + offset - chunk,
+                stage[which ^ 1], chunk);
+    }
+
+    /* Drain any copy still in flight before the window is unmapped */
+    waitRet = wh_Server_DmaCopyWait(server);
+    if (ret == 0) {
+        ret = waitRet;
+    }
+    wc_ForceZero(stage, 2 * sizeof(stage[0]));
+    return ret;
+}
+
+/* Feed len bytes of client memory at hostaddr into the AAD */
+static int _ChaCha_DmaAad(whServerContext* server, ChaChaPoly_Aead* aead,
+        uint64_t hostaddr, uint32_t len)
+{
+    whServerDmaFlags flags = {0};
+    uint32_t offset = 0;
+    uint32_t chunk = 0;
+    void* ptr = NULL;
+    int ret = 0;
+    int postRet = 0;
+
+    while ((ret == 0) && (offset < len)) {
+        chunk = len - offset;
+        if (chunk > WOLFHSM_CHACHA_DMA_WINDOW) {
+            chunk = WOLFHSM_CHACHA_DMA_WINDOW;
+        }
+        ret = wh_Server_DmaProcessClientAddress64(server, hostaddr + offset,
+                &ptr, chunk, WH_DMA_OPER_CLIENT_READ_PRE, flags);
+        if (ret != 0) {
+            break;
+        }
+        ret = _ChaCha_AadWindow(server, aead, (const uint8_t*)ptr, chunk);
+        postRet = wh_Server_DmaProcessClientAddress64(server,
+                hostaddr + offset, &ptr, chunk, WH_DMA_OPER_CLIENT_READ_POST,
+                flags);
+        if (ret == 0) {
+            ret = postRet;
+        }
+        offset += chunk;
+    }
+    return ret;
+}
+
+/* Process len bytes of client memory at in_addr into out_addr */
+static int _ChaCha_DmaData(whServerContext* server, ChaChaPoly_Aead* aead,
+        uint64_t in_addr, uint64_t out_addr, uint32_t len)
+{
+    whServerDmaFlags flags = {0};
+    uint32_t offset = 0;
+    uint32_t chunk = 0;
+    void* inPtr = NULL;
+    void* outPtr = NULL;
+    int ret = 0;
+    int postRet = 0;
+
+    while ((ret == 0) && (offset < len)) {
+        chunk = len - offset;
+        if (chunk > WOLFHSM_CHACHA_DMA_WINDOW) {
+            chunk = WOLFHSM_CHACHA_DMA_WINDOW;
+        }
+        ret = wh_Server_DmaProcessClientAddress64(server, in_addr + offset,
+                &inPtr, chunk, WH_DMA_OPER_CLIENT_READ_PRE, flags);
+        if (ret != 0) {
+            break;
+        }
+        ret = wh_Server_DmaProcessClientAddress64(server, out_addr + offset,
+                &outPtr, chunk, WH_DMA_OPER_CLIENT_WRITE_PRE, flags);
+        if (ret == 0) {
+            ret = _ChaCha_DataWindow(server, aead, (const uint8_t*)inPtr,
+                    (uint8_t*)outPtr, chunk);
+            postRet = wh_Server_DmaProcessClientAddress64(server,
+                    out_addr + offset, &outPtr, chunk,
+                    WH_DMA_OPER_CLIENT_WRITE_POST, flags);
+            if (ret == 0) {
+                ret = postRet;
+            }
+        }
+        postRet = wh_Server_DmaProcessClientAddress64(server,
+                in_addr + offset, &inPtr, chunk, WH_DMA_OPER_CLIENT_READ_POST,
+                flags);
+        if (ret == 0) {
+            ret = postRet;
+        }
+        offset += chunk;
+    }
+    return ret;
+}
+
+static int _ChaCha_CryptDma(whServerContext* server,
+        const whMessageChaCha_CryptDmaRequest* req, uint8_t* out_tag)
+{
+    ChaChaPoly_Aead aead[1];
+    int ret = 0;
+
+    ret = _ChaCha_Start(server, aead, req->key_id, req->iv, req->enc);
+    if ((ret == 0) && (req->aad_len > 0)) {
+        ret = _ChaCha_DmaAad(server, aead, req->aad_hostaddr, req->aad_len);
+    }
+    if ((ret == 0) && (req->data_len > 0)) {
+        ret = _ChaCha_DmaData(server, aead, req->in_hostaddr,
+                req->out_hostaddr, req->data_len);
+    }
+    if (ret == 0) {
+        ret = _ChaCha_Finish(aead, req->enc, req->tag, out_tag);
+    }
+    wc_ForceZero(aead, sizeof(aead));
+    return ret;
+}
+#endif /* !WOLFHSM_NO_CRYPTO && HAVE_CHACHA && HAVE_POLY1305 */
+
+void wh_Server_ChaChaReset(whServerContext* server)
+{
+#if !defined(WOLFHSM_NO_CRYPTO) && defined(HAVE_CHACHA) && \
+    defined(HAVE_POLY1305)
+    int i;
+
+    if (server == NULL) {
+        return;
+    }
+    for (i = 0; i < WOLFHSM_NUM_CHACHA_SESSIONS; i++) {
+        _ChaCha_EndSession(&server->chacha->sessions[i]);
+    }
+#else
+    (void)server;
+#endif
+}
+
+int wh_Server_HandleChaChaRequest(whServerContext* server,
+        uint16_t magic, uint16_t action, uint16_t seq,
+        uint16_t req_size, const void* req_packet,
+        uint16_t *out_resp_size, void* resp_packet)
+{
+    int rc = 0;
+
+    (void)seq;
+
+    if (    (server == NULL) ||
+            (req_packet == NULL) ||
+            (resp_packet == NULL) ||
+            (out_resp_size == NULL) ) {
+        return WH_ERROR_BADARGS;
+    }
+
+    /* III: Translate function returns do not need to be checked since args
+     * are not NULL */
+
+    switch (action) {
+
+    case WH_MESSAGE_CHACHA_ACTION_CRYPT:
+    {
+        whMessageChaCha_CryptRequest req = {0};
+        uint16_t hdr_len = sizeof(req);
+        const uint8_t* payload = (const uint8_t*)req_packet + hdr_len;
+        whMessageChaCha_CryptResponse resp = {0};
+        uint8_t* out = (uint8_t*)resp_packet + sizeof(resp);
+
+        if (req_size >= sizeof(req)) {
+            /* Convert request struct */
+            wh_MessageChaCha_TranslateCryptRequest(magic,
+                    (whMessageChaCha_CryptRequest*)req_packet, &req);
+            if (req_size == (hdr_len + req.aad_len + req.data_len)) {
+#if !defined(WOLFHSM_NO_CRYPTO) && defined(HAVE_CHACHA) && \
+    defined(HAVE_POLY1305)
+                /* Process the Crypt action */
+                resp.rc = _ChaCha_Crypt(server, &req, payload, out,
+                        resp.tag);
+                if (resp.rc == 0) {
+                    resp.data_len = req.data_len;
+                }
+#else
+                (void)payload;
+                (void)out;
+                resp.rc = WH_ERROR_NOHANDLER;
+#endif
+            } else {
+                /* Problem in the request or transport. */
+                resp.rc = WH_ERROR_ABORTED;
+            }
+        } else {
+            /* Request is malformed */
+            resp.rc = WH_ERROR_ABORTED;
+        }
+        /* Convert the response struct */
+        wh_MessageChaCha_TranslateCryptResponse(magic,
+                &resp, (whMessageChaCha_CryptResponse*)resp_packet);
+        *out_resp_size = sizeof(resp) + resp.data_len;
+    }; break;
+
+    case WH_MESSAGE_CHACHA_ACTION_INIT:
+    {
+        whMessageChaCha_InitRequest req = {0};
+        whMessageChaCha_InitResponse resp = {0};
+
+        if (req_size == sizeof(req)) {
+            /* Convert request struct */
+            wh_MessageChaCha_TranslateInitRequest(magic,
+                    (whMessageChaCha_InitRequest*)req_packet, &req);
+#if !defined(WOLFHSM_NO_CRYPTO) && defined(HAVE_CHACHA) && \
+    defined(HAVE_POLY1305)
+            /* Process the Init action */
+            resp.rc = _ChaCha_Init(server, &req, &resp.session);
+#else
+            resp.rc = WH_ERROR_NOHANDLER;
+#endif
+        } else {
+            /* Request is malformed */
+            resp.rc = WH_ERROR_ABORTED;
+        }
+        /* Convert the response struct */
+        wh_MessageChaCha_TranslateInitResponse(magic,
+                &resp, (whMessageChaCha_InitResponse*)resp_packet);
+        *out_resp_size = sizeof(resp);
+    }; break;
+
+    case WH_MESSAGE_CHACHA_ACTION_UPDATE:
+    {
+        whMessageChaCha_UpdateRequest req = {0};
+        uint16_t hdr_len = sizeof(req);
+        const uint8_t* payload = (const uint8_t*)req_packet + hdr_len;
+        whMessageChaCha_UpdateResponse resp = {0};
+        uint8_t* out = (uint8_t*)resp_packet + sizeof(resp);
+
+        if (req_size >= sizeof(req)) {
+            /* Convert request struct */
+            wh_MessageChaCha_TranslateUpdateRequest(magic,
+                    (whMessageChaCha_UpdateRequest*)req_packet, &req);
+            if (req_size == (hdr_len + req.aad_len + req.data_len)) {
+#if !defined(WOLFHSM_NO_CRYPTO) && defined(HAVE_CHACHA) && \
+    defined(HAVE_POLY1305)
+                /* Process the Update action */
+                resp.rc = _ChaCha_SessionUpdate(server, &req, payload, out);
+                if (resp.rc == 0) {
+                    resp.data_len = req.data_len;
+                }
+#else
+                (void)payload;
+                (void)out;
+                resp.rc = WH_ERROR_NOHANDLER;
+#endif
+            } else {
+                /* Problem in the request or transport. */
+                resp.rc = WH_ERROR_ABORTED;
+            }
+        } else {
+            /* Request is malformed */
+            resp.rc = WH_ERROR_ABORTED;
+        }
+        /* Convert the response struct */
+        wh_MessageChaCha_TranslateUpdateResponse(magic,
+                &resp, (whMessageChaCha_UpdateResponse*)resp_packet);
+        *out_resp_size = sizeof(resp) + resp.data_len;
+    }; break;
+
+    case WH_MESSAGE_CHACHA_ACTION_FINAL:
+    {
+        whMessageChaCha_FinalRequest req = {0};
+        whMessageChaCha_TagResponse resp = {0};
+
+        if (req_size == sizeof(req)) {
+            /* Convert request struct */
+            wh_MessageChaCha_TranslateFinalRequest(magic,
+                    (whMessageChaCha_FinalRequest*)req_packet, &req);
+#if !defined(WOLFHSM_NO_CRYPTO) && defined(HAVE_CHACHA) && \
+    defined(HAVE_POLY1305)
+            /* Process the Final action */
+            resp.rc = _ChaCha_SessionFinal(server, &req, resp.tag);
+#else
+            resp.rc = WH_ERROR_NOHANDLER;
+#endif
+        } else {
+            /* Request is malformed */
+            resp.rc = WH_ERROR_ABORTED;
+        }
+        /* Convert the response struct */
+        wh_MessageChaCha_TranslateTagResponse(magic,
+                &resp, (whMessageChaCha_TagResponse*)resp_packet);
+        *out_resp_size = sizeof(resp);
+    }; break;
+
+    case WH_MESSAGE_CHACHA_ACTION_CRYPTDMA:
+    {
+        whMessageChaCha_CryptDmaRequest req = {0};
+        whMessageChaCha_TagResponse resp = {0};
+
+        if (req_size == sizeof(req)) {
+            /* Convert request struct */
+            wh_MessageChaCha_TranslateCryptDmaRequest(magic,
+                    (whMessageChaCha_CryptDmaRequest*)req_packet, &req);
+#if !defined(WOLFHSM_NO_CRYPTO) && defined(HAVE_CHACHA) && \
+    defined(HAVE_POLY1305)
+            /* Process the CryptDma action */
+            resp.rc = _ChaCha_CryptDma(server, &req, resp.tag);
+#else
+            resp.rc = WH_ERROR_NOHANDLER;
+#endif
+        } else {
+            /* Request is malformed */
+            resp.rc = WH_ERROR_ABORTED;
+        }
+        /* Convert the response struct */
+        wh_MessageChaCha_TranslateTagResponse(magic,
+                &resp, (whMessageChaCha_TagResponse*)resp_packet);
+        *out_resp_size = sizeof(resp);
+    }; break;
+
+    default:
+        /* Unknown request. Respond with empty packet */
+        *out_resp_size = 0;
+    }
+    return rc;
+}
@@ -37,28 +37,34 @@ static int hsmCacheKeyRsa(whServerContext* server, RsaKey* key, whKeyId* outId)
 {
     int ret = 0;
     int slotIdx = 0;
+    CacheSlot* slot;
     whKeyId keyId = WOLFHSM_KEYTYPE_CRYPTO;
+    /* the new key is written straight into the slot */
+    ret = hsmKeystoreLock(server, 1);
+    if (ret != 0)
+        return ret;
     /* get a free slot */
     ret = slotIdx = hsmCacheFindSlot(server);
     if (ret >= 0) {
         ret = hsmGetUniqueId(server, &keyId);
     }
     if (ret == 0) {
+        slot = &server->keystore->cache[slotIdx];
         /* export key */
         /* TODO: Fix wolfCrypto to allow KeyToDer when KEY_GEN is NOT set */
-        ret = wc_RsaKeyToDer(key, server->cache[slotIdx].buffer,
-            WOLFHSM_KEYCACHE_BUFSIZE);
+        ret = wc_RsaKeyToDer(key, slot->buffer, WOLFHSM_KEYCACHE_BUFSIZE);
     }
     if (ret > 0) {
         /* set meta */
-        XMEMSET((uint8_t*)server->cache[slotIdx].meta, 0,
-            sizeof(server->cache[slotIdx].meta));
-        server->cache[slotIdx].meta->id = keyId;
-        server->cache[slotIdx].meta->len = ret;
+        XMEMSET((uint8_t*)slot->meta, 0, sizeof(slot->meta));
+        slot->meta->id = keyId;
+        slot->meta->len = ret;
+        slot->commited = 0;
         /* export keyId */
         *outId = keyId;
         ret = 0;
     }
+    hsmKeystoreUnlock(server, 1);
     return ret;
 }
 
@@ -66,16 +72,18 @@ static int hsmLoadKeyRsa(whServerContext* server, RsaKey* key, whKeyId keyId)
 {
     int ret = 0;
     int slotIdx = 0;
+    int exclusive = 0;
     uint32_t idx = 0;
     uint32_t size;
     keyId |= (WOLFHSM_KEYTYPE_CRYPTO | (server->comm->client_id << 8));
     /* freshen the key */
-    ret = slotIdx = hsmFreshenKey(server, keyId);
+    ret = slotIdx = hsmAcquireKeySlot(server, keyId, &exclusive);
     /* decode the key */
     if (ret >= 0) {
         size = WOLFHSM_KEYCACHE_BUFSIZE;
-        ret = wc_RsaPrivateKeyDecode(server->cache[slotIdx].buffer, (word32*)&idx, key,
-            size);
+        ret = wc_RsaPrivateKeyDecode(server->keystore->cache[slotIdx].buffer,
+            (word32*)&idx, key, size);
+        hsmReleaseKeySlot(server, exclusive);
     }
     return ret;
 }
@@ -87,29 +95,35 @@ static int hsmCacheKeyCurve25519(whServerContext* server, curve25519_key* key,
 {
     int ret;
     int slotIdx = 0;
+    CacheSlot* slot;
     word32 privSz = CURVE25519_KEYSIZE;
     word32 pubSz = CURVE25519_KEYSIZE;
     whKeyId keyId = WOLFHSM_KEYTYPE_CRYPTO;
+    /* the new key is written straight into the slot */
+    ret = hsmKeystoreLock(server, 1);
+    if (ret != 0)
+        return ret;
     /* get a free slot */
     ret = slotIdx = hsmCacheFindSlot(server);
     if (ret >= 0) {
         ret = hsmGetUniqueId(server, &keyId);
     }
     if (ret == 0) {
+        slot = &server->keystore->cache[slotIdx];
         /* export key */
         ret = wc_curve25519_export_key_raw(key,
-            server->cache[slotIdx].buffer + CURVE25519_KEYSIZE, &privSz,
-            server->cache[slotIdx].buffer, &pubSz);
+            slot->buffer + CURVE25519_KEYSIZE, &privSz, slot->buffer, &pubSz);
     }
     if (ret == 0) {
         /* set meta */
-        XMEMSET((uint8_t*)server->cache[slotIdx].meta, 0,
-            sizeof(server->cache[slotIdx].meta));
-        server->cache[slotIdx].meta->id = keyId;
-        server->cache[slotIdx].meta->len = CURVE25519_KEYSIZE * 2;
+        XMEMSET((uint8_t*)slot->meta, 0, sizeof(slot->meta));
+        slot->meta->id = keyId;
+        slot->meta->len = CURVE25519_KEYSIZE * 2;
+        slot->commited = 0;
         /* export keyId */
         *outId = keyId;
     }
+    hsmKeystoreUnlock(server, 1);
     return ret;
 }
 
@@ -118,21 +132,23 @@ static int hsmLoadKeyCurve25519(whServerContext* server, curve25519_key* key,
 {
     int ret = 0;
     int slotIdx = 0;
+    int exclusive = 0;
+    CacheSlot* slot;
     uint32_t privSz = CURVE25519_KEYSIZE;
     uint32_t pubSz = CURVE25519_KEYSIZE;
     keyId |= WOLFHSM_KEYTYPE_CRYPTO;
     /* freshen the key */
-    ret = slotIdx = hsmFreshenKey(server, keyId);
+    ret = slotIdx = hsmAcquireKeySlot(server, keyId, &exclusive);
+    if (ret < 0)
+        return ret;
+    slot = &server->keystore->cache[slotIdx];
     /* decode the key */
-    if (ret >= 0) {
-        ret = wc_curve25519_import_public(server->cache[slotIdx].buffer, pubSz,
-            key);
-    }
+    ret = wc_curve25519_import_public(slot->buffer, pubSz, key);
     /* only import private if what we got back holds 2 keys */
-    if (ret == 0 && server->cache[slotIdx].meta->len == CURVE25519_KEYSIZE * 2) {
-        ret = wc_curve25519_import_private(
-            server->cache[slotIdx].buffer + pubSz, privSz, key);
+    if (ret == 0 && slot->meta->len == CURVE25519_KEYSIZE * 2) {
+        ret = wc_curve25519_import_private(slot->buffer + pubSz, privSz, key);
     }
+    hsmReleaseKeySlot(server, exclusive);
     return ret;
 }
 #endif /* HAVE_CURVE25519 */
@@ -142,10 +158,15 @@ static int hsmCacheKeyEcc(whServerContext* server, ecc_key* key, whKeyId* outId)
 {
     int ret;
     int slotIdx = 0;
+    CacheSlot* slot;
     uint32_t qxLen;
     uint32_t qyLen;
     uint32_t qdLen;
     whKeyId keyId = WOLFHSM_KEYTYPE_CRYPTO;
+    /* the new key is written straight into the slot */
+    ret = hsmKeystoreLock(server, 1);
+    if (ret != 0)
+        return ret;
     /* get a free slot */
     ret = slotIdx = hsmCacheFindSlot(server);
     if (ret >= 0) {
@@ -153,43 +174,149 @@ static int hsmCacheKeyEcc(whServerContext* server, ecc_key* key, whKeyId* outId)
     }
     /* export key */
     if (ret == 0) {
+        slot = &server->keystore->cache[slotIdx];
         qxLen = qyLen = qdLen = key->dp->size;
-        ret = wc_ecc_export_private_raw(key, server->cache[slotIdx].buffer,
-            &qxLen, server->cache[slotIdx].buffer + qxLen,
-            &qyLen, server->cache[slotIdx].buffer + qxLen + qyLen, &qdLen);
+        ret = wc_ecc_export_private_raw(key, slot->buffer, &qxLen,
+            slot->buffer + qxLen, &qyLen, slot->buffer + qxLen + qyLen,
+            &qdLen);
     }
     if (ret == 0) {
         /* set meta */
-        XMEMSET((uint8_t*)server->cache[slotIdx].meta, 0,
-            sizeof(server->cache[slotIdx].meta));
-        server->cache[slotIdx].meta->id = keyId;
-        server->cache[slotIdx].meta->len = qxLen + qyLen + qdLen;
+        XMEMSET((uint8_t*)slot->meta, 0, sizeof(slot->meta));
+        slot->meta->id = keyId;
+        slot->meta->len = qxLen + qyLen + qdLen;
+        slot->commited = 0;
         /* export keyId */
         *outId = keyId;
     }
+    hsmKeystoreUnlock(server, 1);
     return ret;
 }
 
-static int hsmLoadKeyEcc(whServerContext* server, ecc_key* key, uint16_t keyId,
+int hsmLoadKeyEcc(whServerContext* server, ecc_key* key, uint16_t keyId,
     int curveId)
 {
     int ret;
     int slotIdx = 0;
+    int exclusive = 0;
+    CacheSlot* slot;
     uint32_t keySz;
     keyId |= WOLFHSM_KEYTYPE_CRYPTO;
     /* freshen the key */
-    ret = slotIdx = hsmFreshenKey(server, keyId);
+    ret = slotIdx = hsmAcquireKeySlot(server, keyId, &exclusive);
     /* decode the key */
     if (ret >= 0) {
-        keySz = server->cache[slotIdx].meta->len / 3;
-        ret = wc_ecc_import_unsigned(key, server->cache[slotIdx].buffer,
-            server->cache[slotIdx].buffer + keySz,
-            server->cache[slotIdx].buffer + keySz * 2, curveId);
+        slot = &server->keystore->cache[slotIdx];
+        keySz = slot->meta->len / 3;
+        ret = wc_ecc_import_unsigned(key, slot->buffer, slot->buffer + keySz,
+            slot->buffer + keySz * 2, curveId);
+        hsmReleaseKeySlot(server, exclusive);
+    }
+    return ret;
+}
+
+/* Find the imported public key for keyId, importing it on a miss.  The key
+ * material is still freshened from the keystore on every call so that an
+ * erased key fails and a replaced key is imported again.  A miss replaces a
+ * free entry or the least recently used one */
+static int hsmGetVerifyKeyEcc(whServerContext* server, uint16_t keyId,
+    int curveId, ecc_key** outKey)
+{
+    whServerEccVerifyContext* ctx = server->eccVerify;
+    whServerEccVerifyEntry* entry = NULL;
+    uint8_t pub[2 * MAX_ECC_BYTES];
+    uint32_t keySz;
+    int ret;
+    int slotIdx;
+    int exclusive = 0;
+    int i;
+    keyId |= WOLFHSM_KEYTYPE_CRYPTO;
+    ret = slotIdx = hsmAcquireKeySlot(server, keyId, &exclusive);
+    if (ret < 0) {
+        return ret;
+    }
+    /* copy the public point so the keystore is only held briefly */
+    keySz = server->keystore->cache[slotIdx].meta->len / 3;
+    if (keySz * 2 > sizeof(pub)) {
+        ret = BUFFER_E;
+    }
+    else {
+        XMEMCPY(pub, server->keystore->cache[slotIdx].buffer, keySz * 2);
+    }
+    hsmReleaseKeySlot(server, exclusive);
+    if (ret < 0) {
+        return ret;
+    }
+    for (i = 0; i < WOLFHSM_NUM_ECC_VERIFY_CACHE; i++) {
+        entry = &ctx->entries[i];
+        if (    (entry->keyId == keyId) &&
+                (entry->curveId == curveId) &&
+                (entry->pubSz == keySz * 2) &&
+                (XMEMCMP(entry->pub, pub, keySz * 2) == 0)) {
+            entry->lastUse = ++ctx->useCounter;
+            *outKey = entry->key;
+            return 0;
+        }
+    }
+    /* pick a free entry, an outdated copy of this key or the oldest one */
+    entry = &ctx->entries[0];
+    for (i = 0; i < WOLFHSM_NUM_ECC_VERIFY_CACHE; i++) {
+        if (    (ctx->entries[i].keyId == 0) ||
+                (ctx->entries[i].keyId == keyId)) {
+            entry = &ctx->entries[i];
+            break;
+        }
+        if (ctx->entries[i].lastUse < entry->lastUse) {
+            entry = &ctx->entries[i];
+        }
+    }
+    if (entry->keyId != 0) {
+        wc_ecc_free(entry->key);
+    }
+    XMEMSET(entry, 0, sizeof(*entry));
+    /* only the public point is kept, the private scalar is not imported */
+    ret = wc_ecc_init_ex(entry->key, NULL, server->crypto->devId);
+    if (ret == 0) {
+        ret = wc_ecc_import_unsigned(entry->key, pub, pub + keySz, NULL,
+            curveId);
+        if (ret != 0) {
+            wc_ecc_free(entry->key);
+        }
+    }
+    if (ret == 0) {
+        entry->keyId = keyId;
+        entry->curveId = curveId;
+        entry->pubSz = keySz * 2;
+        XMEMCPY(entry->pub, pub, keySz * 2);
+        entry->lastUse = ++ctx->useCounter;
+        *outKey = entry->key;
+    }
+    else {
+        XMEMSET(entry, 0, sizeof(*entry));
     }
     return ret;
 }
 #endif /* HAVE_ECC */
 
+void wh_Server_EccVerifyCacheReset(whServerContext* server)
+{
+#ifdef HAVE_ECC
+    int i;
+
+    if (server == NULL) {
+        return;
+    }
+    for (i = 0; i < WOLFHSM_NUM_ECC_VERIFY_CACHE; i++) {
+        if (server->eccVerify->entries[i].keyId != 0) {
+            wc_ecc_free(server->eccVerify->entries[i].key);
+        }
+    }
+    XMEMSET(server->eccVerify, 0, sizeof(server->eccVerify));
+#else
+    (void)server;
+#endif
+}
+
 int wh_Server_HandleCryptoRequest(whServerContext* server,
     uint16_t action, uint8_t* data, uint16_t* size)
 {
@@ -206,6 +333,9 @@ int wh_Server_HandleCryptoRequest(whServerContext* server,
     uint8_t* sig;
     uint8_t* hash;
     whPacket* packet = (whPacket*)data;
+#ifdef HAVE_ECC
+    ecc_key* verifyKey = NULL;
+#endif
 #ifdef WOLFHSM_SYMMETRIC_INTERNAL
     uint8_t tmpKey[AES_MAX_KEY_SIZE + AES_IV_SIZE];
 #endif
@@ -518,22 +648,14 @@ int wh_Server_HandleCryptoRequest(whServerContext* server,
             sig = (uint8_t*)(&packet->pkEccVerifyReq + 1);
             hash = (uint8_t*)(&packet->pkEccVerifyReq + 1) +
                 packet->pkEccVerifyReq.sigSz;
-            /* init public key */
-            ret = wc_ecc_init_ex(server->crypto->eccPublic, NULL,
-                server->crypto->devId);
-            /* load the public key */
-            if (ret == 0) {
-                ret = hsmLoadKeyEcc(server, server->crypto->eccPublic,
-                    packet->pkEccVerifyReq.keyId,
-                    packet->pkEccVerifyReq.curveId);
-            }
+            /* find or import the public key, it stays cached */
+            ret = hsmGetVerifyKeyEcc(server, packet->pkEccVerifyReq.keyId,
+                packet->pkEccVerifyReq.curveId, &verifyKey);
             /* verify the signature */
             if (ret == 0) {
                 ret = wc_ecc_verify_hash(sig, packet->pkEccVerifyReq.sigSz,
-                    hash, packet->pkEccVerifyReq.hashSz, &res,
-                    server->crypto->eccPublic);
+                    hash, packet->pkEccVerifyReq.hashSz, &res, verifyKey);
             }
-            wc_ecc_free(server->crypto->eccPublic);
             if (ret == 0) {
                 packet->pkEccVerifyRes.res = res;
                 *size = WOLFHSM_PACKET_STUB_SIZE +
@@ -72,7 +72,20 @@ int wh_Server_HandleCustomCbRequest(whServerContext* server, uint16_t magic,
         /* If this isn't a query to check if the callback exists, invoke the
          * registered callback, storing the return value in the reponse  */
         if (req.type != WH_MESSAGE_CUSTOM_CB_TYPE_QUERY) {
+            server->customPending->resume = NULL;
             resp.rc = server->customHandlerTable[action](server, &req, &resp);
+
+            if (server->customPending->resume != NULL) {
+                /* Callback deferred. Respond when the continuation is done */
+                server->customPending->req   = req;
+                server->customPending->resp  = resp;
+                server->customPending->magic = magic;
+                server->customPending->kind  =
+                    WH_MESSAGE_KIND(WH_MESSAGE_GROUP_CUSTOM, action);
+                server->customPending->seq   = seq;
+                *out_resp_size = 0;
+                return WH_ERROR_NOTREADY;
+            }
         }
         /* TODO: propagate other wolfHSM error codes (requires modifiying caller
          * function) once generic server code supports it */
@@ -97,3 +110,98 @@ int wh_Server_HandleCustomCbRequest(whServerContext* server, uint16_t magic,
 
     return WH_ERROR_OK;
 }
+
+
+int wh_Server_CustomCbDefer(whServerContext* server, whServerCustomCb resume,
+                            int waitEvent)
+{
+    if (NULL == server || NULL == resume) {
+        return WH_ERROR_BADARGS;
+    }
+
+    server->customPending->resume    = resume;
+    server->customPending->waitEvent = (waitEvent != 0);
+    server->customPending->signaled  = 0;
+    server->customPending->canceled  = 0;
+
+    return WH_ERROR_OK;
+}
+
+
+int wh_Server_CustomCbSignal(whServerContext* server)
+{
+    if (NULL == server) {
+        return WH_ERROR_BADARGS;
+    }
+
+    server->customPending->signaled = 1;
+
+    return WH_ERROR_OK;
+}
+
+
+int wh_Server_CustomCbCancel(whServerContext* server)
+{
+    if (NULL == server) {
+        return WH_ERROR_BADARGS;
+    }
+
+    if (server->customPending->resume != NULL) {
+        server->customPending->canceled = 1;
+    }
+
+    return WH_ERROR_OK;
+}
+
+
+int wh_Server_HandleCustomCbPending(whServerContext* server,
+                                    uint16_t* out_resp_size,
+                                    void* resp_packet)
+{
+    whServerCustomPending* pending = NULL;
+    whServerCustomCb       resume  = NULL;
+    int                    rc      = 0;
+
+    if (NULL == server || NULL == out_resp_size || NULL == resp_packet) {
+        return WH_ERROR_BADARGS;
+    }
+
+    pending = server->customPending;
+    if (pending->resume == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+
+    if (pending->canceled) {
+        pending->resume   = NULL;
+        pending->canceled = 0;
+        pending->resp.rc  = WH_ERROR_ABORTED;
+        pending->resp.err = WH_ERROR_ABORTED;
+    }
+    else {
+        if (pending->waitEvent && !pending->signaled) {
+            /* Still waiting for the external event */
+            return WH_ERROR_NOTREADY;
+        }
+
+        resume          = pending->resume;
+        pending->resume = NULL;
+        pending->resp.rc = resume(server, &pending->req, &pending->resp);
+        if (pending->resume != NULL) {
+            /* Deferred again */
+            return WH_ERROR_NOTREADY;
+        }
+        pending->resp.err = WH_ERROR_OK;
+    }
+
+    pending->resp.id  = pending->req.id;
+
+    /* Translate the response */
+    if ((rc = wh_MessageCustomCb_TranslateResponse(
+             pending->magic, &pending->resp, resp_packet)) != WH_ERROR_OK) {
+        return rc;
+    }
+
+    *out_resp_size = sizeof(pending->resp);
+
+    return WH_ERROR_OK;
+}
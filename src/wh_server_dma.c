@@ -150,6 +150,47 @@ int wh_Server_DmaRegisterAllowList(whServerContext*                server,
     return WH_ERROR_OK;
 }
 
+int wh_Server_DmaCopySubmit(whServerContext* server, void* dst,
+                            const void* src, size_t len)
+{
+    if (NULL == server || NULL == dst || NULL == src) {
+        return WH_ERROR_BADARGS;
+    }
+
+    if (NULL == server->dma.engineCb) {
+        memcpy(dst, src, len);
+        return WH_ERROR_OK;
+    }
+
+    return server->dma.engineCb->Submit(server->dma.engineContext, dst, src,
+                                        len);
+}
+
+int wh_Server_DmaCopyPoll(whServerContext* server)
+{
+    if (NULL == server) {
+        return WH_ERROR_BADARGS;
+    }
+
+    /* memcpy copies are complete on submit */
+    if (NULL == server->dma.engineCb) {
+        return WH_ERROR_OK;
+    }
+
+    return server->dma.engineCb->Poll(server->dma.engineContext);
+}
+
+int wh_Server_DmaCopyWait(whServerContext* server)
+{
+    int rc = WH_ERROR_OK;
+
+    do {
+        rc = wh_Server_DmaCopyPoll(server);
+    } while (rc == WH_ERROR_NOTREADY);
+
+    return rc;
+}
+
 
 int wh_Server_DmaProcessClientAddress32(whServerContext* server,
                                         uint32_t         clientAddr,
@@ -238,7 +279,13 @@ int whServerDma_CopyFromClient32(struct whServerContext_t* server,
 
     /* Perform the actual copy */
     /* TODO: should we add a flag to force client word-sized reads? */
-    memcpy(serverPtr, transformedAddr, len);
+    rc = wh_Server_DmaCopySubmit(server, serverPtr, transformedAddr, len);
+    if (rc == WH_ERROR_OK) {
+        rc = wh_Server_DmaCopyWait(server);
+    }
+    if (rc != WH_ERROR_OK) {
+        return rc;
+    }
 
     /* Process the client address post-read */
     rc = wh_Server_DmaProcessClientAddress32(
@@ -279,7 +326,13 @@ int whServerDma_CopyFromClient64(struct whServerContext_t* server,
 
     /* Perform the actual copy */
     /* TODO: should we add a flag to force client word-sized reads? */
-    memcpy(serverPtr, transformedAddr, len);
+    rc = wh_Server_DmaCopySubmit(server, serverPtr, transformedAddr, len);
+    if (rc == WH_ERROR_OK) {
+        rc = wh_Server_DmaCopyWait(server);
+    }
+    if (rc != WH_ERROR_OK) {
+        return rc;
+    }
 
     /* process the client address post-read */
     rc = wh_Server_DmaProcessClientAddress64(
@@ -319,7 +372,13 @@ int whServerDma_CopyToClient32(struct whServerContext_t* server,
 
     /* Perform the actual copy */
     /* TODO: should we add a flag to force client word-sized reads? */
-    memcpy(transformedAddr, serverPtr, len);
+    rc = wh_Server_DmaCopySubmit(server, transformedAddr, serverPtr, len);
+    if (rc == WH_ERROR_OK) {
+        rc = wh_Server_DmaCopyWait(server);
+    }
+    if (rc != WH_ERROR_OK) {
+        return rc;
+    }
 
     /* Process the client address post-write */
     rc = wh_Server_DmaProcessClientAddress32(
@@ -360,7 +419,13 @@ int whServerDma_CopyToClient64(struct whServerContext_t* server,
 
     /* Perform the actual copy */
     /* TODO: should we add a flag to force client word-sized reads? */
-    memcpy(transformedAddr, serverPtr, len);
+    rc = wh_Server_DmaCopySubmit(server, transformedAddr, serverPtr, len);
+    if (rc == WH_ERROR_OK) {
+        rc = wh_Server_DmaCopyWait(server);
+    }
+    if (rc != WH_ERROR_OK) {
+        return rc;
+    }
 
     /* Process the client address post-write */
     rc = wh_Server_DmaProcessClientAddress64(
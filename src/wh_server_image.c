@@ -0,0 +1,440 @@
+/*
+ * Copyright (C) 2024 wolfSSL Inc.
+ *
+ * This file is part of wolfHSM.
+ *
+ * wolfHSM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfHSM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wolfHSM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * src/wh_server_image.c
+ *
+ * Firmware image verification.  The image is hashed straight out of client
+ * memory in DMA windows of WOLFHSM_IMAGE_DMA_WINDOW bytes, and the hash
+ * state is kept in the server context so a verification may be split across
+ * several requests.
+ */
+
+/* System libraries */
+#include <stdint.h>
+#include <stdlib.h>  /* For NULL */
+#include <string.h>  /* For memset, memcpy */
+
+/* Common WolfHSM types and defines shared with the server */
+#include "wolfhsm/wh_error.h"
+#include "wolfhsm/wh_comm.h"
+
+#include "wolfhsm/wh_message.h"
+#include "wolfhsm/wh_message_image.h"
+
+#include "wolfhsm/wh_server.h"
+#include "wolfhsm/wh_server_image.h"
+
+#ifndef WOLFHSM_NO_CRYPTO
+#include "wolfssl/wolfcrypt/settings.h"
+#include "wolfssl/wolfcrypt/types.h"
+#include "wolfssl/wolfcrypt/error-crypt.h"
+#include "wolfssl/wolfcrypt/sha256.h"
+#include "wolfssl/wolfcrypt/sha512.h"
+#include "wolfssl/wolfcrypt/ecc.h"
+
+#include "wolfhsm/wh_server_crypto.h"
+
+static int _Image_Start(whServerContext* server, uint64_t hostaddr,
+        uint8_t is64, uint32_t len, whKeyId keyId, uint16_t curveId,
+        uint8_t hashType, const uint8_t* sig, uint16_t sigLen)
+{
+    whServerImageContext* ctx = server->image;
+    int ret = 0;
+
+    /* A new request replaces any verification in progress */
+    wh_Server_ImageReset(server);
+
+    if (    (len == 0) ||
+            (sigLen == 0) ||
+            (sigLen > sizeof(ctx->sig)) ) {
+        return WH_ERROR_BADARGS;
+    }
+
+    switch (hashType) {
+    case WH_IMAGE_HASH_SHA256:
+        ret = wc_InitSha256_ex(ctx->hash.sha256, NULL,
+                server->crypto->devId);
+        break;
+#ifdef WOLFSSL_SHA384
+    case WH_IMAGE_HASH_SHA384:
+        ret = wc_InitSha384_ex(ctx->hash.sha384, NULL,
+                server->crypto->devId);
+        break;
+#endif
+    default:
+        ret = WH_ERROR_BADARGS;
+    }
+
+    if (ret == 0) {
+        ctx->hostaddr = hostaddr;
+        ctx->is64 = is64;
+        ctx->len = len;
+        ctx->offset = 0;
+        ctx->keyId = keyId;
+        ctx->curveId = curveId;
+        ctx->hashType = hashType;
+        ctx->sigLen = sigLen;
+        memcpy(ctx->sig, sig, sigLen);
+        ctx->active = 1;
+    }
+    return ret;
+}
+
+static int _Image_Update(whServerImageContext* ctx, const uint8_t* data,
+        uint32_t len)
+{
+    if (ctx->hashType == WH_IMAGE_HASH_SHA256) {
+        return wc_Sha256Update(ctx->hash.sha256, (const byte*)data, len);
+    }
+#ifdef WOLFSSL_SHA384
+    return wc_Sha384Update(ctx->hash.sha384, (const byte*)data, len);
+#else
+    return WH_ERROR_BADARGS;
+#endif
+}
+
+/* Hash a mapped window of client memory.  With a DMA copy engine, the next
+ * piece of the window is copied into a staging buffer while the current one
+ * is hashed, instead of the core reading client memory directly */
+static int _Image_HashWindow(whServerContext* server, const uint8_t* ptr,
+        uint32_t len)
+{
+    uint8_t (*stage)[WOLFHSM_DMA_STAGE_LEN] = server->dma.stage;
+    uint32_t next = 0;
+    uint32_t cur = 0;
+    uint32_t curLen = 0;
+    int which = 0;
+    int ret = 0;
+    int waitRet = 0;
+
+    if (server->dma.engineCb == NULL) {
+        return _Image_Update(server->image, ptr, len);
+    }
+
+    /* Prime the first staging buffer */
+    curLen = (len < sizeof(stage[0])) ? len : sizeof(stage[0]);
+    ret = wh_Server_DmaCopySubmit(server, stage[which], ptr, curLen);
+    next = curLen;
+
+    while ((ret == 0) && (cur < len)) {
+        ret = wh_Server_DmaCopyWait(server);
+        if ((ret == 0) && (next < len)) {
+            uint32_t nextLen = len - next;
+            if (nextLen > sizeof(stage[0])) {
+                nextLen = sizeof(stage[0]);
+            }
+            ret = wh_Server_DmaCopySubmit(server, stage[which ^ 1],
+                    ptr + next, nextLen);
+            next += nextLen;
+        }
+        if (ret == 0) {
+            /* Overlaps with the copy of the next piece */
+            ret = _Image_Update(server->image, stage[which], curLen);
+        }
+        cur += curLen;
+        curLen = ((next - cur) < sizeof(stage[0])) ?
+                (next - cur) : sizeof(stage[0]);
+        which ^= 1;
+    }
+
+    /* Drain any copy still in flight before the window is unmapped */
+    waitRet = wh_Server_DmaCopyWait(server);
+    if (ret == 0) {
+        ret = waitRet;
+    }
+    return ret;
+}
+
+/* Hash up to slice_len more bytes of the image, 0 meaning the remainder */
+static int _Image_HashSlice(whServerContext* server, uint32_t slice_len)
+{
+    whServerImageContext* ctx = server->image;
+    uint32_t end = ctx->len;
+    uint32_t chunk = 0;
+    void* ptr = NULL;
+    int ret = 0;
+    int postRet = 0;
+
+    if ((slice_len != 0) && (slice_len < ctx->len - ctx->offset)) {
+        end = ctx->offset + slice_len;
+    }
+
+    while ((ret == 0) && (ctx->offset < end)) {
+        chunk = end - ctx->offset;
+        if (chunk > WOLFHSM_IMAGE_DMA_WINDOW) {
+            chunk = WOLFHSM_IMAGE_DMA_WINDOW;
+        }
+
+        /* perform platform-specific host address processing */
+        if (ctx->is64) {
+            ret = wh_Server_DmaProcessClientAddress64(server,
+                    ctx->hostaddr + ctx->offset, &ptr, chunk,
+                    WH_DMA_OPER_CLIENT_READ_PRE, (whServerDmaFlags){0});
+        } else {
+            ret = wh_Server_DmaProcessClientAddress32(server,
+                    (uint32_t)(ctx->hostaddr + ctx->offset), &ptr, chunk,
+                    WH_DMA_OPER_CLIENT_READ_PRE, (whServerDmaFlags){0});
+        }
+        if (ret != 0) {
+            break;
+        }
+
+        ret = _Image_HashWindow(server, (const uint8_t*)ptr, chunk);
+
+        /* perform platform-specific host address processing */
+        if (ctx->is64) {
+            postRet = wh_Server_DmaProcessClientAddress64(server,
+                    ctx->hostaddr + ctx->offset, &ptr, chunk,
+                    WH_DMA_OPER_CLIENT_READ_POST, (whServerDmaFlags){0});
+        } else {
+            postRet = wh_Server_DmaProcessClientAddress32(server,
+                    (uint32_t)(ctx->hostaddr + ctx->offset), &ptr, chunk,
+                    WH_DMA_OPER_CLIENT_READ_POST, (whServerDmaFlags){0});
+        }
+        if (ret == 0) {
+            ret = postRet;
+        }
+        if (ret == 0) {
+            ctx->offset += chunk;
+        }
+    }
+    return ret;
+}
+
+/* Finalize the digest and check the signature over it */
+static int _Image_Finish(whServerContext* server,
+        whMessageImage_VerifyResponse* resp)
+{
+    whServerImageContext* ctx = server->image;
+    ecc_key* key = server->crypto->eccPublic;
+    int res = 0;
+    int ret = 0;
+
+    if (ctx->hashType == WH_IMAGE_HASH_SHA256) {
+        ret = wc_Sha256Final(ctx->hash.sha256, resp->digest);
+        resp->digest_len = WC_SHA256_DIGEST_SIZE;
+    }
+#ifdef WOLFSSL_SHA384
+    else {
+        ret = wc_Sha384Final(ctx->hash.sha384, resp->digest);
+        resp->digest_len = WC_SHA384_DIGEST_SIZE;
+    }
+#endif
+
+#ifdef HAVE_ECC
+    if (ret == 0) {
+        ret = wc_ecc_init_ex(key, NULL, server->crypto->devId);
+        if (ret == 0) {
+            ret = hsmLoadKeyEcc(server, key, ctx->keyId, ctx->curveId);
+            if (ret == 0) {
+                ret = wc_ecc_verify_hash(ctx->sig, ctx->sigLen, resp->digest,
+                        resp->digest_len, &res, key);
+            }
+            wc_ecc_free(key);
+        }
+    }
+#else
+    (void)key;
+    if (ret == 0) {
+        ret = WH_ERROR_NOHANDLER;
+    }
+#endif
+    if (ret == 0) {
+        resp->verified = (res == 1);
+    }
+    return ret;
+}
+
+/* Hash the next slice, finishing and releasing the state once done */
+static int _Image_Process(whServerContext* server, uint32_t slice_len,
+        whMessageImage_VerifyResponse* resp)
+{
+    whServerImageContext* ctx = server->image;
+    int ret = 0;
+
+    if (ctx->active == 0) {
+        return WH_ERROR_NOTINIT;
+    }
+
+    ret = _Image_HashSlice(server, slice_len);
+    resp->offset = ctx->offset;
+    if ((ret == 0) && (ctx->offset == ctx->len)) {
+        ret = _Image_Finish(server, resp);
+        resp->done = 1;
+    }
+    if ((ret != 0) || (resp->done != 0)) {
+        wh_Server_ImageReset(server);
+    }
+    return ret;
+}
+#endif /* !WOLFHSM_NO_CRYPTO */
+
+void wh_Server_ImageReset(whServerContext* server)
+{
+#ifndef WOLFHSM_NO_CRYPTO
+    whServerImageContext* ctx = NULL;
+
+    if (server == NULL) {
+        return;
+    }
+    ctx = server->image;
+    if (ctx->active != 0) {
+        if (ctx->hashType == WH_IMAGE_HASH_SHA256) {
+            wc_Sha256Free(ctx->hash.sha256);
+        }
+#ifdef WOLFSSL_SHA384
+        else {
+            wc_Sha384Free(ctx->hash.sha384);
+        }
+#endif
+    }
+    memset(ctx, 0, sizeof(*ctx));
+#else
+    (void)server;
+#endif
+}
+
+int wh_Server_HandleImageRequest(whServerContext* server,
+        uint16_t magic, uint16_t action, uint16_t seq,
+        uint16_t req_size, const void* req_packet,
+        uint16_t *out_resp_size, void* resp_packet)
+{
+    int rc = 0;
+
+    (void)seq;
+
+    if (    (server == NULL) ||
+            (req_packet == NULL) ||
+            (resp_packet == NULL) ||
+            (out_resp_size == NULL) ) {
+        return WH_ERROR_BADARGS;
+    }
+
+    /* III: Translate function returns do not need to be checked since args
+     * are not NULL */
+
+    switch (action) {
+
+    case WH_MESSAGE_IMAGE_ACTION_VERIFYDMA32:
+    {
+        whMessageImage_VerifyDma32Request req = {0};
+        uint16_t hdr_len = sizeof(req);
+        const uint8_t* sig = (const uint8_t*)req_packet + hdr_len;
+        whMessageImage_VerifyResponse resp = {0};
+
+        if (req_size >= sizeof(req)) {
+            /* Convert request struct */
+            wh_MessageImage_TranslateVerifyDma32Request(magic,
+                    (whMessageImage_VerifyDma32Request*)req_packet, &req);
+            if (req_size == (hdr_len + req.sig_len)) {
+#ifndef WOLFHSM_NO_CRYPTO
+                /* Process the Verify action */
+                resp.rc = _Image_Start(server, req.image_hostaddr, 0,
+                        req.image_len, req.key_id, req.curve_id,
+                        req.hash_type, sig, req.sig_len);
+                if (resp.rc == 0) {
+                    resp.rc = _Image_Process(server, req.slice_len, &resp);
+                }
+#else
+                (void)sig;
+                resp.rc = WH_ERROR_NOHANDLER;
+#endif
+            } else {
+                /* Problem in the request or transport. */
+                resp.rc = WH_ERROR_ABORTED;
+            }
+        } else {
+            /* Request is malformed */
+            resp.rc = WH_ERROR_ABORTED;
+        }
+        /* Convert the response struct */
+        wh_MessageImage_TranslateVerifyResponse(magic,
+                &resp, (whMessageImage_VerifyResponse*)resp_packet);
+        *out_resp_size = sizeof(resp);
+    }; break;
+
+    case WH_MESSAGE_IMAGE_ACTION_VERIFYDMA64:
+    {
+        whMessageImage_VerifyDma64Request req = {0};
+        uint16_t hdr_len = sizeof(req);
+        const uint8_t* sig = (const uint8_t*)req_packet + hdr_len;
+        whMessageImage_VerifyResponse resp = {0};
+
+        if (req_size >= sizeof(req)) {
+            /* Convert request struct */
+            wh_MessageImage_TranslateVerifyDma64Request(magic,
+                    (whMessageImage_VerifyDma64Request*)req_packet, &req);
+            if (req_size == (hdr_len + req.sig_len)) {
+#ifndef WOLFHSM_NO_CRYPTO
+                /* Process the Verify action */
+                resp.rc = _Image_Start(server, req.image_hostaddr, 1,
+                        req.image_len, req.key_id, req.curve_id,
+                        req.hash_type, sig, req.sig_len);
+                if (resp.rc == 0) {
+                    resp.rc = _Image_Process(server, req.slice_len, &resp);
+                }
+#else
+                (void)sig;
+                resp.rc = WH_ERROR_NOHANDLER;
+#endif
+            } else {
+                /* Problem in the request or transport. */
+                resp.rc = WH_ERROR_ABORTED;
+            }
+        } else {
+            /* Request is malformed */
+            resp.rc = WH_ERROR_ABORTED;
+        }
+        /* Convert the response struct */
+        wh_MessageImage_TranslateVerifyResponse(magic,
+                &resp, (whMessageImage_VerifyResponse*)resp_packet);
+        *out_resp_size = sizeof(resp);
+    }; break;
+
+    case WH_MESSAGE_IMAGE_ACTION_CONTINUE:
+    {
+        whMessageImage_ContinueRequest req = {0};
+        whMessageImage_VerifyResponse resp = {0};
+
+        if (req_size == sizeof(req)) {
+            /* Convert request struct */
+            wh_MessageImage_TranslateContinueRequest(magic,
+                    (whMessageImage_ContinueRequest*)req_packet, &req);
+#ifndef WOLFHSM_NO_CRYPTO
+            /* Process the Continue action */
+            resp.rc = _Image_Process(server, req.slice_len, &resp);
+#else
+            resp.rc = WH_ERROR_NOHANDLER;
+#endif
+        } else {
+            /* Request is malformed */
+            resp.rc = WH_ERROR_ABORTED;
+        }
+        /* Convert the response struct */
+        wh_MessageImage_TranslateVerifyResponse(magic,
+                &resp, (whMessageImage_VerifyResponse*)resp_packet);
+        *out_resp_size = sizeof(resp);
+    }; break;
+
+    default:
+        /* Unknown request. Respond with empty packet */
+        *out_resp_size = 0;
+    }
+    return rc;
+}
@@ -28,13 +28,105 @@
 
 #include "wolfhsm/wh_server.h"
 #include "wolfhsm/wh_server_keystore.h"
+#include "wolfhsm/wh_server_nvm.h"
 #include "wolfhsm/wh_message.h"
 #include "wolfhsm/wh_packet.h"
 #include "wolfhsm/wh_error.h"
+#include "wolfhsm/wh_lock.h"
+#include "wolfhsm/wh_server_prepared.h"
 #ifdef WOLFHSM_SHE_EXTENSION
 #include "wolfhsm/wh_server_she.h"
 #endif
 
+int wh_Server_KeystoreInit(whServerKeystore* keystore,
+    const whLockConfig* lockConfig)
+{
+    if (keystore == NULL)
+        return WH_ERROR_BADARGS;
+    XMEMSET((uint8_t*)keystore, 0, sizeof(*keystore));
+    return wh_Lock_Init(keystore->lock, lockConfig);
+}
+
+int wh_Server_KeystoreCleanup(whServerKeystore* keystore)
+{
+    int ret;
+    if (keystore == NULL)
+        return WH_ERROR_BADARGS;
+    ret = wh_Lock_Cleanup(keystore->lock);
+    XMEMSET((uint8_t*)keystore, 0, sizeof(*keystore));
+    return ret;
+}
+
+int hsmKeystoreLock(whServerContext* server, int exclusive)
+{
+    if (exclusive)
+        return wh_Lock_AcquireWrite(server->keystore->lock);
+    return wh_Lock_AcquireRead(server->keystore->lock);
+}
+
+void hsmKeystoreUnlock(whServerContext* server, int exclusive)
+{
+    if (exclusive)
+        (void)wh_Lock_ReleaseWrite(server->keystore->lock);
+    else
+        (void)wh_Lock_ReleaseRead(server->keystore->lock);
+}
+
+void hsmKeyChanged(whServerContext* server, whKeyId keyId)
+{
+    if (keyId == WOLFHSM_KEYID_ERASED) {
+        wh_Server_PreparedReset(server);
+#ifdef WOLFHSM_SHE_EXTENSION
+        wh_Server_SheSlotReset(server);
+#endif
+    }
+    else {
+        wh_Server_PreparedInvalidate(server, keyId);
+#ifdef WOLFHSM_SHE_EXTENSION
+        wh_Server_SheSlotInvalidate(server, keyId);
+#endif
+    }
+    /* this server has already dropped what it derived from the key */
+    if (server->keystoreGeneration == server->keystore->generation)
+        server->keystoreGeneration++;
+    server->keystore->generation++;
+}
+
+void hsmKeyInvalidate(whServerContext* server, whKeyId keyId)
+{
+    int i;
+    CacheSlot* slot;
+    if (server == NULL || hsmKeystoreLock(server, 1) != 0)
+        return;
+    /* a committed copy now differs from what NVM holds */
+    for (i = 0; i < WOLFHSM_NUM_RAMKEYS; i++) {
+        slot = &server->keystore->cache[i];
+        if (slot->commited == 1 && slot->meta->id != WOLFHSM_KEYID_ERASED &&
+            (keyId == WOLFHSM_KEYID_ERASED || slot->meta->id == keyId)) {
+            slot->meta->id = WOLFHSM_KEYID_ERASED;
+        }
+    }
+    hsmKeyChanged(server, keyId);
+    hsmKeystoreUnlock(server, 1);
+}
+
+void hsmKeystoreSync(whServerContext* server)
+{
+    uint32_t generation;
+    if (hsmKeystoreLock(server, 0) != 0)
+        return;
+    generation = server->keystore->generation;
+    hsmKeystoreUnlock(server, 0);
+    if (generation == server->keystoreGeneration)
+        return;
+    /* another server changed a key, it is not known which one */
+    wh_Server_PreparedReset(server);
+#ifdef WOLFHSM_SHE_EXTENSION
+    wh_Server_SheSlotReset(server);
+#endif
+    server->keystoreGeneration = generation;
+}
+
 int hsmGetUniqueId(whServerContext* server, whNvmId* outId)
 {
     int i;
@@ -49,7 +141,7 @@ int hsmGetUniqueId(whServerContext* server, whNvmId* outId)
         buildId = ((buildId & ~WOLFHSM_KEYID_MASK) | id);
         /* check against cache keys */
         for (i = 0; i < WOLFHSM_NUM_RAMKEYS; i++) {
-            if (buildId == server->cache[i].meta->id)
+            if (buildId == server->keystore->cache[i].meta->id)
                 break;
         }
         /* try again if match */
@@ -79,7 +171,7 @@ int hsmCacheFindSlot(whServerContext* server)
     int foundIndex = -1;
     for (i = 0; i < WOLFHSM_NUM_RAMKEYS; i++) {
         /* check for empty slot or rewrite slot */
-        if (foundIndex == -1 && server->cache[i].meta->id ==
+        if (foundIndex == -1 && server->keystore->cache[i].meta->id ==
             WOLFHSM_KEYID_ERASED) {
             foundIndex = i;
             break;
@@ -88,7 +180,7 @@ int hsmCacheFindSlot(whServerContext* server)
     /* if no empty slots, check for a commited key we can evict */
     if (foundIndex == -1) {
         for (i = 0; i < WOLFHSM_NUM_RAMKEYS; i++) {
-            if (server->cache[i].commited == 1) {
+            if (server->keystore->cache[i].commited == 1) {
                 foundIndex = i;
                 break;
             }
@@ -100,31 +192,40 @@ int hsmCacheFindSlot(whServerContext* server)
     return foundIndex;
 }
 
-int hsmCacheKey(whServerContext* server, whNvmMetadata* meta, uint8_t* in)
+/* Return 1 if keyId, including the client_id, is cached or stored in NVM.
+ * Called with the keystore held exclusive */
+static int _hsmKeyExists(whServerContext* server, whKeyId keyId)
 {
     int i;
-    int foundIndex = -1;
-    /* make sure id is valid */
-    if (server == NULL || meta == NULL || in == NULL ||
-        (meta->id & WOLFHSM_KEYID_MASK) == WOLFHSM_KEYID_ERASED ||
-        meta->len > WOLFHSM_NVM_MAX_OBJECT_SIZE) {
-        return WH_ERROR_BADARGS;
+    whNvmMetadata meta[1];
+    for (i = 0; i < WOLFHSM_NUM_RAMKEYS; i++) {
+        if (server->keystore->cache[i].meta->id == keyId)
+            return 1;
     }
-    /* apply client_id */
-    meta->id |= (server->comm->client_id << 8);
+    return wh_Nvm_GetMetadata(server->nvm, keyId, meta) == 0;
+}
+
+/* Write a key into the cache. meta->id must already include the client_id.
+ * Called with the keystore held exclusive */
+static int _hsmCacheKey(whServerContext* server, whNvmMetadata* meta,
+    uint8_t* in)
+{
+    int i;
+    int foundIndex = -1;
+    CacheSlot* cache = server->keystore->cache;
     for (i = 0; i < WOLFHSM_NUM_RAMKEYS; i++) {
         /* check for empty slot or rewrite slot */
         if ((foundIndex == -1 &&
-            (server->cache[i].meta->id & WOLFHSM_KEYID_MASK) ==
+            (cache[i].meta->id & WOLFHSM_KEYID_MASK) ==
             WOLFHSM_KEYID_ERASED) ||
-            server->cache[i].meta->id == meta->id) {
+            cache[i].meta->id == meta->id) {
             foundIndex = i;
         }
     }
     /* if no empty slots, check for a commited key we can evict */
     if (foundIndex == -1) {
         for (i = 0; i < WOLFHSM_NUM_RAMKEYS; i++) {
-            if (server->cache[i].commited == 1) {
+            if (cache[i].commited == 1) {
                 foundIndex = i;
                 break;
             }
@@ -134,43 +235,81 @@ int hsmCacheKey(whServerContext* server, whNvmMetadata* meta, uint8_t* in)
     if (foundIndex == -1)
         return WH_ERROR_NOSPACE;
     /* write key if slot found */
-    XMEMCPY((uint8_t*)server->cache[foundIndex].buffer, in, meta->len);
-    XMEMCPY((uint8_t*)server->cache[foundIndex].meta, (uint8_t*)meta,
+    XMEMCPY((uint8_t*)cache[foundIndex].buffer, in, meta->len);
+    XMEMCPY((uint8_t*)cache[foundIndex].meta, (uint8_t*)meta,
         sizeof(whNvmMetadata));
     /* check if the key is already commited */
     if (wh_Nvm_GetMetadata(server->nvm, meta->id, meta) == WH_ERROR_NOTFOUND)
-        server->cache[foundIndex].commited = 0;
+        cache[foundIndex].commited = 0;
     else
-        server->cache[foundIndex].commited = 1;
+        cache[foundIndex].commited = 1;
     return 0;
 }
 
-/* try to put the specified key into cache if it isn't already, return index */
-int hsmFreshenKey(whServerContext* server, whKeyId keyId)
+int hsmCacheKey(whServerContext* server, whNvmMetadata* meta, uint8_t* in)
+{
+    int ret;
+    /* make sure id is valid */
+    if (server == NULL || meta == NULL || in == NULL ||
+        (meta->id & WOLFHSM_KEYID_MASK) == WOLFHSM_KEYID_ERASED ||
+        meta->len > WOLFHSM_NVM_MAX_OBJECT_SIZE) {
+        return WH_ERROR_BADARGS;
+    }
+    /* apply client_id */
+    meta->id |= (server->comm->client_id << 8);
+    ret = hsmKeystoreLock(server, 1);
+    if (ret == 0) {
+        /* state derived from a key being replaced must not outlive it */
+        if (_hsmKeyExists(server, meta->id))
+            hsmKeyChanged(server, meta->id);
+        ret = _hsmCacheKey(server, meta, in);
+        hsmKeystoreUnlock(server, 1);
+    }
+    return ret;
+}
+
+/* Cache a key under a newly allocated id. The keystore is held across both
+ * steps so that no other server takes the same id first */
+static int _hsmCacheKeyUnique(whServerContext* server, whNvmMetadata* meta,
+    uint8_t* in)
+{
+    int ret;
+    if (meta->len > WOLFHSM_NVM_MAX_OBJECT_SIZE)
+        return WH_ERROR_BADARGS;
+    ret = hsmKeystoreLock(server, 1);
+    if (ret == 0) {
+        ret = hsmGetUniqueId(server, &meta->id);
+        if (ret == 0)
+            ret = _hsmCacheKey(server, meta, in);
+        hsmKeystoreUnlock(server, 1);
+    }
+    return ret;
+}
+
+/* try to put the specified key into cache if it isn't already, return index.
+ * Called with the keystore held exclusive */
+static int _hsmFreshenKey(whServerContext* server, whKeyId keyId)
 {
     int ret = 0;
     int i;
     int foundIndex = -1;
     uint32_t outSz = WOLFHSM_KEYCACHE_BUFSIZE;
     whNvmMetadata meta[1] = {0};
-    if (server == NULL || keyId == WOLFHSM_KEYID_ERASED)
-        return WH_ERROR_BADARGS;
-    /* apply client_id */
-    keyId |= (server->comm->client_id << 8);
+    CacheSlot* cache = server->keystore->cache;
     for (i = 0; i < WOLFHSM_NUM_RAMKEYS; i++) {
         /* check for empty slot or rewrite slot */
         if ((foundIndex == -1 &&
-            server->cache[i].meta->id == WOLFHSM_KEYID_ERASED) ||
-            server->cache[i].meta->id == keyId) {
+            cache[i].meta->id == WOLFHSM_KEYID_ERASED) ||
+            cache[i].meta->id == keyId) {
             foundIndex = i;
-            if (server->cache[i].meta->id == keyId)
+            if (cache[i].meta->id == keyId)
                 return i;
         }
     }
     /* if no empty slots, check for a commited key we can evict */
     if (foundIndex == -1) {
         for (i = 0; i < WOLFHSM_NUM_RAMKEYS; i++) {
-            if (server->cache[i].commited == 1) {
+            if (cache[i].commited == 1) {
                 foundIndex = i;
                 break;
             }
@@ -181,51 +320,110 @@ int hsmFreshenKey(whServerContext* server, whKeyId keyId)
         return WH_ERROR_NOSPACE;
     /* try to read the metadata */
     ret = wh_Nvm_GetMetadata(server->nvm, keyId, meta);
+    if (ret == 0 && meta->len > outSz)
+        ret = WH_ERROR_NOSPACE;
     if (ret == 0) {
-        /* set meta */
-        XMEMCPY((uint8_t*)server->cache[foundIndex].meta, (uint8_t*)meta,
-            sizeof(meta));
         /* read the object */
-        ret = wh_Nvm_Read(server->nvm, keyId, 0, outSz,
-            server->cache[foundIndex].buffer);
+        ret = wh_Nvm_Read(server->nvm, keyId, 0, meta->len,
+            cache[foundIndex].buffer);
     }
+    if (ret != 0)
+        return ret;
+    /* set meta once the slot holds the key */
+    XMEMCPY((uint8_t*)cache[foundIndex].meta, (uint8_t*)meta, sizeof(meta));
+    cache[foundIndex].commited = 1;
     /* return index */
     return foundIndex;
 }
 
-int hsmReadKey(whServerContext* server, whKeyId keyId, whNvmMetadata* outMeta,
-    uint8_t* out, uint32_t* outSz)
+int hsmAcquireKeySlot(whServerContext* server, whKeyId keyId,
+    int* outExclusive)
 {
-    int ret = 0;
+    int ret;
     int i;
-    whNvmMetadata meta[1] = {0};
-    /* make sure id is valid */
-    if (server == NULL || ((keyId & WOLFHSM_KEYID_MASK) == WOLFHSM_KEYID_ERASED
-        && (keyId & WOLFHSM_KEYTYPE_MASK) != WOLFHSM_KEYTYPE_SHE) ||
-        outSz == NULL) {
+    if (server == NULL || outExclusive == NULL ||
+        keyId == WOLFHSM_KEYID_ERASED)
         return WH_ERROR_BADARGS;
-    }
     /* apply client_id */
     keyId |= (server->comm->client_id << 8);
-    /* check the cache */
+    /* a cached key only needs shared access */
+    ret = hsmKeystoreLock(server, 0);
+    if (ret != 0)
+        return ret;
+    for (i = 0; i < WOLFHSM_NUM_RAMKEYS; i++) {
+        if (server->keystore->cache[i].meta->id == keyId) {
+            *outExclusive = 0;
+            return i;
+        }
+    }
+    hsmKeystoreUnlock(server, 0);
+    /* filling a slot from NVM needs exclusive access */
+    ret = hsmKeystoreLock(server, 1);
+    if (ret != 0)
+        return ret;
+    ret = _hsmFreshenKey(server, keyId);
+    if (ret < 0) {
+        hsmKeystoreUnlock(server, 1);
+        return ret;
+    }
+    *outExclusive = 1;
+    return ret;
+}
+
+void hsmReleaseKeySlot(whServerContext* server, int exclusive)
+{
+    hsmKeystoreUnlock(server, exclusive);
+}
+
+/* Copy a key out of the cache without modifying any slot. keyId must already
+ * include the client_id. Returns WH_ERROR_NOTFOUND if the key is not cached.
+ * Called with the keystore held shared or exclusive */
+static int _hsmReadCachedKey(whServerContext* server, whKeyId keyId,
+    whNvmMetadata* outMeta, uint8_t* out, uint32_t* outSz)
+{
+    int i;
+    CacheSlot* cache = server->keystore->cache;
     for (i = 0; i < WOLFHSM_NUM_RAMKEYS; i++) {
         /* copy the meta and key before returning */
-        if (server->cache[i].meta->id == keyId) {
+        if (cache[i].meta->id == keyId) {
             /* check outSz */
-            if (server->cache[i].meta->len > *outSz)
+            if (cache[i].meta->len > *outSz)
                 return WH_ERROR_NOSPACE;
             if (outMeta != NULL) {
-                XMEMCPY((uint8_t*)outMeta, (uint8_t*)server->cache[i].meta,
+                XMEMCPY((uint8_t*)outMeta, (uint8_t*)cache[i].meta,
                     sizeof(whNvmMetadata));
             }
-            if (out != NULL) {
-                XMEMCPY(out, server->cache[i].buffer,
-                    server->cache[i].meta->len);
-            }
-            *outSz = server->cache[i].meta->len;
+            if (out != NULL)
+                XMEMCPY(out, cache[i].buffer, cache[i].meta->len);
+            *outSz = cache[i].meta->len;
             return 0;
         }
     }
+    return WH_ERROR_NOTFOUND;
+}
+
+int hsmReadKey(whServerContext* server, whKeyId keyId, whNvmMetadata* outMeta,
+    uint8_t* out, uint32_t* outSz)
+{
+    int ret = 0;
+    uint32_t cachedSz;
+    whNvmMetadata meta[1] = {0};
+    /* make sure id is valid */
+    if (server == NULL || ((keyId & WOLFHSM_KEYID_MASK) == WOLFHSM_KEYID_ERASED
+        && (keyId & WOLFHSM_KEYTYPE_MASK) != WOLFHSM_KEYTYPE_SHE) ||
+        outSz == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+    /* apply client_id */
+    keyId |= (server->comm->client_id << 8);
+    /* check the cache, which only needs shared access */
+    ret = hsmKeystoreLock(server, 0);
+    if (ret != 0)
+        return ret;
+    ret = _hsmReadCachedKey(server, keyId, outMeta, out, outSz);
+    hsmKeystoreUnlock(server, 0);
+    if (ret != WH_ERROR_NOTFOUND)
+        return ret;
     /* try to read the metadata */
     ret = wh_Nvm_GetMetadata(server->nvm, keyId, meta);
     if (ret == 0) {
@@ -238,9 +436,15 @@ int hsmReadKey(whServerContext* server, whKeyId keyId, whNvmMetadata* outMeta,
         if (out != NULL)
             ret = wh_Nvm_Read(server->nvm, keyId, 0, *outSz, out);
     }
-    /* cache key if free slot, will only kick out other commited keys */
-    if (ret == 0 && out != NULL) {
-        hsmCacheKey(server, meta, out);
+    /* cache key if free slot, will only kick out other commited keys. Leave
+     * the slot alone if another server cached the key in the meantime */
+    if (ret == 0 && out != NULL && hsmKeystoreLock(server, 1) == 0) {
+        cachedSz = WOLFHSM_KEYCACHE_BUFSIZE;
+        if (_hsmReadCachedKey(server, keyId, NULL, NULL, &cachedSz) ==
+                WH_ERROR_NOTFOUND) {
+            (void)_hsmCacheKey(server, meta, out);
+        }
+        hsmKeystoreUnlock(server, 1);
     }
 #ifdef WOLFHSM_SHE_EXTENSION
     /* use empty key of zeros if we couldn't find the master ecu key */
@@ -261,26 +465,37 @@ int hsmReadKey(whServerContext* server, whKeyId keyId, whNvmMetadata* outMeta,
     return ret;
 }
 
+/* Drop keyId from the cache. Called with the keystore held exclusive */
+static int _hsmEvictKey(whServerContext* server, whNvmId keyId)
+{
+    int i;
+    CacheSlot* cache = server->keystore->cache;
+    for (i = 0; i < WOLFHSM_NUM_RAMKEYS; i++) {
+        /* mark key as erased */
+        if (cache[i].meta->id == keyId) {
+            cache[i].meta->id = WOLFHSM_KEYID_ERASED;
+            return 0;
+        }
+    }
+    return WH_ERROR_NOTFOUND;
+}
+
 int hsmEvictKey(whServerContext* server, whNvmId keyId)
 {
     int ret = 0;
-    int i;
     /* make sure id is valid */
     if (server == NULL || (keyId & WOLFHSM_KEYID_MASK) == WOLFHSM_KEYID_ERASED)
         return WH_ERROR_BADARGS;
     /* apply client_id */
     keyId |= (server->comm->client_id << 8);
-    /* find key */
-    for (i = 0; i < WOLFHSM_NUM_RAMKEYS; i++) {
-        /* mark key as erased */
-        if (server->cache[i].meta->id == keyId) {
-            server->cache[i].meta->id = WOLFHSM_KEYID_ERASED;
-            break;
-        }
+    ret = hsmKeystoreLock(server, 1);
+    if (ret == 0) {
+        /* if the key wasn't found return an error */
+        ret = _hsmEvictKey(server, keyId);
+        if (ret == 0)
+            hsmKeyChanged(server, keyId);
+        hsmKeystoreUnlock(server, 1);
     }
-    /* if the key wasn't found return an error */
-    if (i >= WOLFHSM_NUM_RAMKEYS)
-        ret = WH_ERROR_NOTFOUND;
     return ret;
 }
 
@@ -288,45 +503,54 @@ int hsmCommitKey(whServerContext* server, whNvmId keyId)
 {
     int i;
     int ret = 0;
-    CacheSlot* cacheSlot;
+    CacheSlot* cacheSlot = NULL;
     /* make sure id is valid */
     if (server == NULL || keyId == WOLFHSM_KEYID_ERASED)
         return WH_ERROR_BADARGS;
     /* apply client_id */
     keyId |= (server->comm->client_id << 8);
+    ret = hsmKeystoreLock(server, 1);
+    if (ret != 0)
+        return ret;
     /* find key in cache */
     for (i = 0; i < WOLFHSM_NUM_RAMKEYS; i++) {
-        if (server->cache[i].meta->id == keyId) {
-            cacheSlot = &server->cache[i];
+        if (server->keystore->cache[i].meta->id == keyId) {
+            cacheSlot = &server->keystore->cache[i];
             break;
         }
     }
-    if (i >= WOLFHSM_NUM_RAMKEYS)
-        return WH_ERROR_NOTFOUND;
+    if (cacheSlot == NULL)
+        ret = WH_ERROR_NOTFOUND;
     /* add object */
-    ret = wh_Nvm_AddObject(server->nvm, cacheSlot->meta,
-        cacheSlot->meta->len, cacheSlot->buffer);
+    if (ret == 0) {
+        ret = wh_Server_NvmAddObject(server, cacheSlot->meta,
+            cacheSlot->meta->len, cacheSlot->buffer);
+    }
     if (ret == 0)
         cacheSlot->commited = 1;
+    hsmKeystoreUnlock(server, 1);
     return ret;
 }
 
 int hsmEraseKey(whServerContext* server, whNvmId keyId)
 {
-    int i;
+    int ret;
     if (server == NULL || keyId == WOLFHSM_KEYID_ERASED)
         return WH_ERROR_BADARGS;
     /* apply client_id */
     keyId |= (server->comm->client_id << 8);
-    /* remove the key from the cache if present */
-    for (i = 0; i < WOLFHSM_NUM_RAMKEYS; i++) {
-        if (server->cache[i].meta->id == keyId) {
-            server->cache[i].meta->id = WOLFHSM_KEYID_ERASED;
-            break;
-        }
+    /* hold the keystore so no server refills the slot from NVM before the
+     * object is destroyed */
+    ret = hsmKeystoreLock(server, 1);
+    if (ret == 0) {
+        hsmKeyChanged(server, keyId);
+        /* remove the key from the cache if present */
+        (void)_hsmEvictKey(server, keyId);
+        /* destroy the object */
+        ret = wh_Nvm_DestroyObjects(server->nvm, 1, &keyId);
+        hsmKeystoreUnlock(server, 1);
     }
-    /* destroy the object */
-    return wh_Nvm_DestroyObjects(server->nvm, 1, &keyId);
+    return ret;
 }
 
 int wh_Server_HandleKeyRequest(whServerContext* server, uint16_t magic,
@@ -334,6 +558,7 @@ int wh_Server_HandleKeyRequest(whServerContext* server, uint16_t magic,
 {
     int ret = 0;
     uint32_t field;
+    whKeyId keyId;
     uint8_t* in;
     uint8_t* out;
     whPacket* packet = (whPacket*)data;
@@ -364,11 +589,10 @@ int wh_Server_HandleKeyRequest(whServerContext* server, uint16_t magic,
             XMEMCPY(meta->label, packet->keyCacheReq.label,
                 packet->keyCacheReq.labelSz);
         }
-        /* get a new id if one wasn't provided */
-        if (packet->keyCacheReq.id == WOLFHSM_KEYID_ERASED)
-            ret = hsmGetUniqueId(server, &meta->id);
-        /* write the key */
-        if (ret == 0)
+        /* get a new id if one wasn't provided, then write the key */
+        if (ret == 0 && packet->keyCacheReq.id == WOLFHSM_KEYID_ERASED)
+            ret = _hsmCacheKeyUnique(server, meta, in);
+        else if (ret == 0)
             ret = hsmCacheKey(server, meta, in);
         if (ret == 0) {
             /* remove the cleint_id, client may set type */
@@ -389,10 +613,10 @@ int wh_Server_HandleKeyRequest(whServerContext* server, uint16_t magic,
         out = (uint8_t*)(&packet->keyExportRes + 1);
         field = WH_COMM_DATA_LEN - (WOLFHSM_PACKET_STUB_SIZE +
             sizeof(packet->keyExportRes));
+        keyId = MAKE_WOLFHSM_KEYID(WOLFHSM_KEYTYPE_CRYPTO,
+            server->comm->client_id, packet->keyExportReq.id);
         /* read the key */
-        ret = hsmReadKey(server, MAKE_WOLFHSM_KEYID(WOLFHSM_KEYTYPE_CRYPTO,
-            server->comm->client_id, packet->keyExportReq.id), meta, out,
-            &field);
+        ret = hsmReadKey(server, keyId, meta, out, &field);
         if (ret == 0) {
             /* set key len */
             packet->keyExportRes.len = field;
@@ -0,0 +1,430 @@
+/*
+ * Copyright (C) 2024 wolfSSL Inc.
+ *
+ * This file is part of wolfHSM.
+ *
+ * wolfHSM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfHSM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wolfHSM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * src/wh_server_keywrap.c
+ *
+ * Wrapped bulk export and import of keys held in NVM.
+ */
+
+/* System libraries */
+#include <stdint.h>
+#include <stdlib.h>  /* For NULL */
+#include <string.h>  /* For memset, memcpy */
+
+/* Common WolfHSM types and defines shared with the server */
+#include "wolfhsm/wh_error.h"
+#include "wolfhsm/wh_comm.h"
+
+#include "wolfhsm/wh_nvm.h"
+
+#include "wolfhsm/wh_message.h"
+#include "wolfhsm/wh_message_keywrap.h"
+
+#include "wolfhsm/wh_server.h"
+#include "wolfhsm/wh_server_keywrap.h"
+
+#ifndef WOLFHSM_NO_CRYPTO
+#include "wolfssl/wolfcrypt/settings.h"
+#include "wolfssl/wolfcrypt/types.h"
+#include "wolfssl/wolfcrypt/error-crypt.h"
+#include "wolfssl/wolfcrypt/aes.h"
+#include "wolfssl/wolfcrypt/random.h"
+
+#include "wolfhsm/wh_server_keystore.h"
+#include "wolfhsm/wh_server_cert.h"
+#endif
+
+#if !defined(WOLFHSM_NO_CRYPTO) && defined(HAVE_AESGCM)
+
+/* Blob fields are little endian regardless of the server */
+static void _KeyWrap_Store16(uint8_t* out, uint16_t val)
+{
+    out[0] = (uint8_t)(val & 0xFF);
+    out[1] = (uint8_t)(val >> 8);
+}
+
+static uint16_t _KeyWrap_Load16(const uint8_t* in)
+{
+    return (uint16_t)(in[0] | (in[1] << 8));
+}
+
+/* Read the KEK from the keystore and load it into the server AES context */
+static int _KeyWrap_LoadKek(whServerContext* server, whKeyId kek_id)
+{
+    int ret = 0;
+    uint8_t kek[AES_256_KEY_SIZE];
+    uint32_t kekSz = sizeof(kek);
+
+    ret = hsmReadKey(server, MAKE_WOLFHSM_KEYID(WOLFHSM_KEYTYPE_CRYPTO,
+            server->comm->client_id, kek_id), NULL, kek, &kekSz);
+    if (    (ret == 0) &&
+            (kekSz != AES_128_KEY_SIZE) &&
+            (kekSz != AES_192_KEY_SIZE) &&
+            (kekSz != AES_256_KEY_SIZE) ) {
+        ret = WH_ERROR_BADARGS;
+    }
+    if (ret == 0) {
+        ret = wc_AesInit(server->crypto->aes, NULL, server->crypto->devId);
+    }
+    if (ret == 0) {
+        ret = wc_AesGcmSetKey(server->crypto->aes, kek, kekSz);
+        if (ret != 0) {
+            wc_AesFree(server->crypto->aes);
+        }
+    }
+    wc_ForceZero(kek, sizeof(kek));
+    return ret;
+}
+
+/* Exportable keys are committed crypto keys owned by this client */
+static int _KeyWrap_IsExportable(whServerContext* server, whNvmId id,
+        whNvmId kek_nvm_id)
+{
+    return ((id & WOLFHSM_KEYTYPE_MASK) == WOLFHSM_KEYTYPE_CRYPTO) &&
+            (((id & WOLFHSM_KEYUSER_MASK) >> 8) == server->comm->client_id) &&
+            ((id & WOLFHSM_KEYID_MASK) != WOLFHSM_KEYID_ERASED) &&
+            (id != kek_nvm_id);
+}
+#endif /* !WOLFHSM_NO_CRYPTO && HAVE_AESGCM */
+
+int wh_Server_KeyWrapExport(whServerContext* server, whKeyId kek_id,
+        whNvmId cursor, uint8_t* blob, uint16_t max_len,
+        uint16_t* out_blob_len, uint16_t* out_count,
+        whNvmId* out_next_cursor, uint8_t* out_done)
+{
+#if !defined(WOLFHSM_NO_CRYPTO) && defined(HAVE_AESGCM)
+    int ret = 0;
+    uint8_t* iv = NULL;
+    uint8_t* tag = NULL;
+    uint8_t* records = NULL;
+    uint32_t cap = 0;
+    uint32_t pos = 0;
+    uint16_t count = 0;
+    uint8_t done = 0;
+    whNvmId kek_nvm_id = 0;
+    whNvmId remaining = 0;
+    whNvmId id = 0;
+    whNvmMetadata meta = {0};
+
+    if (    (server == NULL) ||
+            (blob == NULL) ||
+            (out_blob_len == NULL) ||
+            (out_count == NULL) ||
+            (out_next_cursor == NULL) ||
+            (out_done == NULL) ||
+            (max_len <= WH_KEYWRAP_BLOB_OVERHEAD +
+                WH_KEYWRAP_RECORD_HDR_LEN) ) {
+        return WH_ERROR_BADARGS;
+    }
+
+    iv = blob + WH_KEYWRAP_BLOB_HDR_LEN;
+    tag = iv + WH_KEYWRAP_BLOB_IV_LEN;
+    records = tag + WH_KEYWRAP_BLOB_TAG_LEN;
+    cap = max_len - WH_KEYWRAP_BLOB_OVERHEAD;
+    kek_nvm_id = MAKE_WOLFHSM_KEYID(WOLFHSM_KEYTYPE_CRYPTO,
+            server->comm->client_id, kek_id);
+
+    ret = _KeyWrap_LoadKek(server, kek_id);
+    if (ret != 0) {
+        return ret;
+    }
+
+    /* Walk the NVM directory from the cursor, packing plaintext records in
+     * place to be encrypted once the blob is full */
+    while ((ret == 0) && (count < WOLFHSM_KEYWRAP_MAX_KEYS)) {
+        ret = wh_Nvm_List(server->nvm, WOLFHSM_NVM_ACCESS_ANY,
+                WOLFHSM_NVM_FLAGS_ANY, cursor, &remaining, &id);
+        if (ret != 0) {
+            break;
+        }
+        if ((remaining == 0) || (id == WH_NVM_INVALID_ID)) {
+            done = 1;
+            break;
+        }
+        if (!_KeyWrap_IsExportable(server, id, kek_nvm_id)) {
+            cursor = id;
+            continue;
+        }
+        ret = wh_Nvm_GetMetadata(server->nvm, id, &meta);
+        if (ret != 0) {
+            break;
+        }
+        if (WH_KEYWRAP_RECORD_HDR_LEN + meta.len > cap - pos) {
+            /* Resume here next time, unless this key can never fit */
+            if (count == 0) {
+                ret = WH_ERROR_NOSPACE;
+            }
+            break;
+        }
+        _KeyWrap_Store16(records + pos, id & WOLFHSM_KEYID_MASK);
+        _KeyWrap_Store16(records + pos + 2, meta.access);
+        _KeyWrap_Store16(records + pos + 4, meta.flags);
+        _KeyWrap_Store16(records + pos + 6, meta.len);
+        memcpy(records + pos + 8, meta.label, WOLFHSM_NVM_LABEL_LEN);
+        ret = wh_Nvm_Read(server->nvm, id, 0, meta.len,
+                records + pos + WH_KEYWRAP_RECORD_HDR_LEN);
+        if (ret == 0) {
+            pos += WH_KEYWRAP_RECORD_HDR_LEN + meta.len;
+            count++;
+            cursor = id;
+        }
+    }
+    if ((ret == 0) && (count > 0)) {
+        blob[0] = WH_KEYWRAP_BLOB_VERSION;
+        blob[1] = 0;
+        _KeyWrap_Store16(blob + 2, count);
+        ret = wc_RNG_GenerateBlock(server->crypto->rng, iv,
+                WH_KEYWRAP_BLOB_IV_LEN);
+        if (ret == 0) {
+            ret = wc_AesGcmEncrypt(server->crypto->aes, records, records,
+                    pos, iv, WH_KEYWRAP_BLOB_IV_LEN,
+                    tag, WH_KEYWRAP_BLOB_TAG_LEN,
+                    blob, WH_KEYWRAP_BLOB_HDR_LEN);
+        }
+        if (ret != 0) {
+            /* Never leave plaintext key material behind */
+            wc_ForceZero(records, pos);
+        }
+    }
+    wc_AesFree(server->crypto->aes);
+
+    if (ret == 0) {
+        *out_blob_len = (count > 0) ? WH_KEYWRAP_BLOB_OVERHEAD + pos : 0;
+        *out_count = count;
+        *out_next_cursor = cursor;
+        *out_done = done;
+    }
+    return ret;
+#else
+    (void)server;
+    (void)kek_id;
+    (void)cursor;
+    (void)blob;
+    (void)max_len;
+    (void)out_blob_len;
+    (void)out_count;
+    (void)out_next_cursor;
+    (void)out_done;
+    return WH_ERROR_NOHANDLER;
+#endif
+}
+
+int wh_Server_KeyWrapImport(whServerContext* server, whKeyId kek_id,
+        const uint8_t* blob, uint16_t blob_len, uint16_t* out_count)
+{
+#if !defined(WOLFHSM_NO_CRYPTO) && defined(HAVE_AESGCM)
+    int ret = 0;
+    int i = 0;
+    int j = 0;
+    uint16_t count = 0;
+    uint32_t len = 0;
+    uint32_t pos = 0;
+    whKeyId kekKeyId = 0;
+    uint8_t plain[WH_MESSAGE_KEYWRAP_MAX_BLOB_LEN];
+    whNvmMetadata metas[WOLFHSM_KEYWRAP_MAX_KEYS];
+    const uint8_t* datas[WOLFHSM_KEYWRAP_MAX_KEYS];
+
+    if (    (server == NULL) ||
+            (blob == NULL) ||
+            (out_count == NULL) ||
+            (blob_len <= WH_KEYWRAP_BLOB_OVERHEAD) ||
+            (blob_len > WH_MESSAGE_KEYWRAP_MAX_BLOB_LEN) ) {
+        return WH_ERROR_BADARGS;
+    }
+
+    count = _KeyWrap_Load16(blob + 2);
+    len = blob_len - WH_KEYWRAP_BLOB_OVERHEAD;
+    kekKeyId = MAKE_WOLFHSM_KEYID(WOLFHSM_KEYTYPE_CRYPTO,
+            server->comm->client_id, kek_id);
+    if (    (blob[0] != WH_KEYWRAP_BLOB_VERSION) ||
+            (count == 0) ||
+            (count > WOLFHSM_KEYWRAP_MAX_KEYS) ) {
+        ret = WH_ERROR_BADARGS;
+    }
+
+    if (ret == 0) {
+        ret = _KeyWrap_LoadKek(server, kek_id);
+    }
+    if (ret == 0) {
+        ret = wc_AesGcmDecrypt(server->crypto->aes, plain,
+                blob + WH_KEYWRAP_BLOB_OVERHEAD, len,
+                blob + WH_KEYWRAP_BLOB_HDR_LEN, WH_KEYWRAP_BLOB_IV_LEN,
+                blob + WH_KEYWRAP_BLOB_HDR_LEN + WH_KEYWRAP_BLOB_IV_LEN,
+                WH_KEYWRAP_BLOB_TAG_LEN,
+                blob, WH_KEYWRAP_BLOB_HDR_LEN);
+        wc_AesFree(server->crypto->aes);
+    }
+
+    /* Parse every record before touching NVM */
+    memset(metas, 0, sizeof(metas));
+    for (i = 0; (ret == 0) && (i < count); i++) {
+        if (pos + WH_KEYWRAP_RECORD_HDR_LEN > len) {
+            ret = WH_ERROR_ABORTED;
+            break;
+        }
+        metas[i].id = _KeyWrap_Load16(plain + pos);
+        metas[i].access = _KeyWrap_Load16(plain + pos + 2);
+        metas[i].flags = _KeyWrap_Load16(plain + pos + 4);
+        metas[i].len = _KeyWrap_Load16(plain + pos + 6);
+        memcpy(metas[i].label, plain + pos + 8, WOLFHSM_NVM_LABEL_LEN);
+        pos += WH_KEYWRAP_RECORD_HDR_LEN;
+        if (    ((metas[i].id & WOLFHSM_KEYID_MASK) == WOLFHSM_KEYID_ERASED) ||
+                (metas[i].len > WOLFHSM_NVM_MAX_OBJECT_SIZE) ||
+                (pos + metas[i].len > len) ) {
+            ret = WH_ERROR_ABORTED;
+            break;
+        }
+        /* Keys always land in the importing client's id space */
+        metas[i].id = MAKE_WOLFHSM_KEYID(WOLFHSM_KEYTYPE_CRYPTO,
+                server->comm->client_id, metas[i].id);
+        /* The KEK may not be replaced by a key it wrapped, and each key may
+         * only appear once */
+        if (metas[i].id == kekKeyId) {
+            ret = WH_ERROR_ABORTED;
+            break;
+        }
+        for (j = 0; j < i; j++) {
+            if (metas[j].id == metas[i].id) {
+                ret = WH_ERROR_ABORTED;
+                break;
+            }
+        }
+        datas[i] = plain + pos;
+        pos += metas[i].len;
+    }
+    if ((ret == 0) && (pos != len)) {
+        ret = WH_ERROR_ABORTED;
+    }
+
+    if (ret == 0) {
+        ret = wh_Nvm_AddObjects(server->nvm, count, metas, datas);
+        /* Without an all-or-nothing NVM backend a failed add may still have
+         * replaced some keys, so every listed key is treated as changed.
+         * Cached copies are dropped along with whatever was prepared from
+         * them, which still needs doing when the key was not cached */
+        for (i = 0; i < count; i++) {
+            if (hsmEvictKey(server, metas[i].id) == WH_ERROR_NOTFOUND) {
+                hsmKeyInvalidate(server, metas[i].id);
+            }
+            wh_Server_CertCacheInvalidate(server, metas[i].id);
+        }
+        if (ret == 0) {
+            *out_count = count;
+        }
+    }
+    wc_ForceZero(plain, sizeof(plain));
+    return ret;
+#else
+    (void)server;
+    (void)kek_id;
+    (void)blob;
+    (void)blob_len;
+    (void)out_count;
+    return WH_ERROR_NOHANDLER;
+#endif
+}
+
+int wh_Server_HandleKeyWrapRequest(whServerContext* server,
+        uint16_t magic, uint16_t action, uint16_t seq,
+        uint16_t req_size, const void* req_packet,
+        uint16_t *out_resp_size, void* resp_packet)
+{
+    int rc = 0;
+
+    (void)seq;
+
+    if (    (server == NULL) ||
+            (req_packet == NULL) ||
+            (resp_packet == NULL) ||
+            (out_resp_size == NULL) ) {
+        return WH_ERROR_BADARGS;
+    }
+
+    /* III: Translate function returns do not need to be checked since args
+     * are not NULL */
+
+    switch (action) {
+
+    case WH_MESSAGE_KEYWRAP_ACTION_EXPORT:
+    {
+        whMessageKeyWrap_ExportRequest req = {0};
+        whMessageKeyWrap_ExportResponse resp = {0};
+        uint8_t* blob = (uint8_t*)resp_packet + sizeof(resp);
+        uint16_t max_len = 0;
+
+        if (req_size == sizeof(req)) {
+            /* Convert request struct */
+            wh_MessageKeyWrap_TranslateExportRequest(magic,
+                    (whMessageKeyWrap_ExportRequest*)req_packet, &req);
+            max_len = req.max_len;
+            if (max_len > WH_MESSAGE_KEYWRAP_MAX_BLOB_LEN) {
+                max_len = WH_MESSAGE_KEYWRAP_MAX_BLOB_LEN;
+            }
+            /* Process the Export action */
+            resp.rc = wh_Server_KeyWrapExport(server, req.kek_id, req.cursor,
+                    blob, max_len, &resp.blob_len, &resp.count,
+                    &resp.next_cursor, &resp.done);
+        } else {
+            /* Request is malformed */
+            resp.rc = WH_ERROR_ABORTED;
+        }
+        if (resp.rc != 0) {
+            resp.blob_len = 0;
+        }
+        /* Convert the response struct */
+        wh_MessageKeyWrap_TranslateExportResponse(magic,
+                &resp, (whMessageKeyWrap_ExportResponse*)resp_packet);
+        *out_resp_size = sizeof(resp) + resp.blob_len;
+    }; break;
+
+    case WH_MESSAGE_KEYWRAP_ACTION_IMPORT:
+    {
+        whMessageKeyWrap_ImportRequest req = {0};
+        uint16_t hdr_len = sizeof(req);
+        const uint8_t* blob = (const uint8_t*)req_packet + hdr_len;
+        whMessageKeyWrap_ImportResponse resp = {0};
+
+        if (req_size >= sizeof(req)) {
+            /* Convert request struct */
+            wh_MessageKeyWrap_TranslateImportRequest(magic,
+                    (whMessageKeyWrap_ImportRequest*)req_packet, &req);
+            if (req_size == (hdr_len + req.blob_len)) {
+                /* Process the Import action */
+                resp.rc = wh_Server_KeyWrapImport(server, req.kek_id, blob,
+                        req.blob_len, &resp.count);
+            } else {
+                /* Problem in the request or transport. */
+                resp.rc = WH_ERROR_ABORTED;
+            }
+        } else {
+            /* Request is malformed */
+            resp.rc = WH_ERROR_ABORTED;
+        }
+        /* Convert the response struct */
+        wh_MessageKeyWrap_TranslateImportResponse(magic,
+                &resp, (whMessageKeyWrap_ImportResponse*)resp_packet);
+        *out_resp_size = sizeof(resp);
+    }; break;
+
+    default:
+        /* Unknown request. Respond with empty packet */
+        *out_resp_size = 0;
+    }
+    return rc;
+}
@@ -33,6 +33,192 @@
 #include "wolfhsm/wh_server.h"
 
 #include "wolfhsm/wh_server_nvm.h"
+#include "wolfhsm/wh_server_cert.h"
+
+#ifndef WOLFHSM_NO_CRYPTO
+#include "wolfhsm/wh_server_keystore.h"
+#endif
+
+/* Committed keys are NVM objects, so an object written or destroyed here may
+ * replace a key.  WOLFHSM_KEYID_ERASED stands for any object */
+static void _NvmObjectChanged(whServerContext* server, whNvmId id)
+{
+#ifndef WOLFHSM_NO_CRYPTO
+    /* Only ids carrying a key type can be keys */
+    if (    (id == WOLFHSM_KEYID_ERASED) ||
+            ((id & WOLFHSM_KEYTYPE_MASK) != 0) ) {
+        hsmKeyInvalidate(server, id);
+    }
+#else
+    (void)server;
+    (void)id;
+#endif
+}
+
+int wh_Server_NvmAddObject(whServerContext* server, whNvmMetadata* meta,
+        whNvmSize data_len, const uint8_t* data)
+{
+    int rc = 0;
+    uint32_t avail_size = 0;
+    uint32_t reclaim_size = 0;
+    whNvmId avail_objects = 0;
+    whNvmId reclaim_objects = 0;
+
+    if (server == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+
+    rc = wh_Nvm_AddObject(server->nvm, meta, data_len, data);
+    if (    (rc != WH_ERROR_NOSPACE) ||
+            (server->nvmGc->config == NULL) ) {
+        return rc;
+    }
+
+    /* Last resort: compact inline, but only if that can make room */
+    rc = wh_Nvm_GetAvailable(server->nvm, &avail_size, &avail_objects,
+            &reclaim_size, &reclaim_objects);
+    if (rc == 0) {
+        if (    ((reclaim_size == 0) && (reclaim_objects == 0)) ||
+                (avail_size + reclaim_size < data_len) ||
+                (avail_objects + reclaim_objects < 1) ) {
+            return WH_ERROR_NOSPACE;
+        }
+        rc = wh_Nvm_DestroyObjects(server->nvm, 0, NULL);
+    }
+    if (rc == 0) {
+        server->nvmGc->inlineCount++;
+        rc = wh_Nvm_AddObject(server->nvm, meta, data_len, data);
+    }
+    return rc;
+}
+
+/* Read an object into client memory.  With a DMA copy engine, each chunk is
+ * read from NVM into one of two staging buffers while the engine copies the
+ * previous chunk out to the client */
+static int _NvmReadToClient(whServerContext* server, whNvmId id,
+        whNvmSize offset, whNvmSize data_len, uint8_t* data)
+{
+    uint8_t (*stage)[WOLFHSM_DMA_STAGE_LEN] = server->dma.stage;
+    whNvmSize done = 0;
+    whNvmSize chunk = 0;
+    int which = 0;
+    int rc = 0;
+    int waitRc = 0;
+
+    if (    (server->dma.engineCb == NULL) ||
+            (data_len == 0) ) {
+        /* Read straight into client memory */
+        return wh_Nvm_Read(server->nvm, id, offset, data_len, data);
+    }
+
+    while ((rc == 0) && (done < data_len)) {
+        chunk = data_len - done;
+        if (chunk > sizeof(stage[0])) {
+            chunk = sizeof(stage[0]);
+        }
+        rc = wh_Nvm_Read(server->nvm, id, offset + done, chunk,
+                stage[which]);
+        if (rc == 0) {
+            rc = wh_Server_DmaCopyWait(server);
+        }
+        if (rc == 0) {
+            rc = wh_Server_DmaCopySubmit(server, data + done, stage[which],
+                    chunk);
+        }
+        done += chunk;
+        which ^= 1;
+    }
+
+    /* Drain the last copy before the caller unmaps the client buffer */
+    waitRc = wh_Server_DmaCopyWait(server);
+    if (rc == 0) {
+        rc = waitRc;
+    }
+    return rc;
+}
+
+int wh_Server_NvmIdle(whServerContext* server)
+{
+    int rc = 0;
+
+    if (server == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+    if (server->nvm == NULL) {
+        return 0;
+    }
+
+    /* Mounting is enough work for one idle slot */
+    if (wh_Nvm_IsMounted(server->nvm) == 0) {
+        return wh_Nvm_Mount(server->nvm);
+    }
+
+    rc = wh_Nvm_Maintain(server->nvm);
+    if (rc == 0) {
+        rc = wh_Server_NvmGcIdle(server);
+    }
+    return rc;
+}
+
+int wh_Server_NvmGcIdle(whServerContext* server)
+{
+    const whServerNvmGcConfig* config = NULL;
+    int rc = 0;
+    uint32_t avail_size = 0;
+    uint32_t reclaim_size = 0;
+    whNvmId avail_objects = 0;
+    whNvmId reclaim_objects = 0;
+
+    if (server == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+
+    config = server->nvmGc->config;
+    if (    (config == NULL) ||
+            (server->nvm == NULL) ) {
+        return 0;
+    }
+
+    /* The answer cannot change until the NVM contents do */
+    if (    (server->nvmGc->checked != 0) &&
+            (server->nvmGc->generation ==
+                wh_Nvm_GetGeneration(server->nvm)) ) {
+        return 0;
+    }
+
+    rc = wh_Nvm_GetAvailable(server->nvm, &avail_size, &avail_objects,
+            &reclaim_size, &reclaim_objects);
+    if (rc != 0) {
+        return rc;
+    }
+    server->nvmGc->generation = wh_Nvm_GetGeneration(server->nvm);
+    server->nvmGc->checked = 1;
+    if ((reclaim_size == 0) && (reclaim_objects == 0)) {
+        /* Nothing to gain from compacting */
+        return 0;
+    }
+
+    /* Running low only counts if compacting clears the low condition.
+     * Otherwise every idle call would rewrite the partition for a few
+     * bytes and leave it just as low */
+    if (    ((config->reclaimSize != 0) &&
+                (reclaim_size >= config->reclaimSize)) ||
+            ((config->reclaimObjects != 0) &&
+                (reclaim_objects >= config->reclaimObjects)) ||
+            ((config->availSize != 0) &&
+                (avail_size < config->availSize) &&
+                (avail_size + reclaim_size >= config->availSize)) ||
+            ((config->availObjects != 0) &&
+                (avail_objects < config->availObjects) &&
+                (avail_objects + reclaim_objects >= config->availObjects)) ) {
+        rc = wh_Nvm_DestroyObjects(server->nvm, 0, NULL);
+        if (rc == 0) {
+            server->nvmGc->idleCount++;
+            server->nvmGc->generation = wh_Nvm_GetGeneration(server->nvm);
+        }
+    }
+    return rc;
+}
 
 int wh_Server_HandleNvmRequest(whServerContext* server,
         uint16_t magic, uint16_t action, uint16_t seq,
@@ -192,7 +378,10 @@ int wh_Server_HandleNvmRequest(whServerContext* server,
                 meta.flags = req.flags;
                 meta.len = req.len;
                 memcpy(meta.label, req.label, sizeof(meta.label));
-                resp.rc = wh_Nvm_AddObject(server->nvm, &meta, req.len, data);
+                wh_Server_CertCacheInvalidate(server, meta.id);
+                resp.rc = wh_Server_NvmAddObject(server, &meta, req.len,
+                        data);
+                _NvmObjectChanged(server, meta.id);
             } else {
                 /* Problem in the request or transport. */
                 resp.rc = WH_ERROR_ABORTED;
@@ -211,6 +400,7 @@ int wh_Server_HandleNvmRequest(whServerContext* server,
     {
         whMessageNvm_DestroyObjectsRequest req = {0};
         whMessageNvm_SimpleResponse resp = {0};
+        int i;
 
         if (req_size == sizeof(req)) {
             /* Convert request struct */
@@ -218,9 +408,15 @@ int wh_Server_HandleNvmRequest(whServerContext* server,
                     (whMessageNvm_DestroyObjectsRequest*)req_packet, &req);
 
             if (req.list_count <= WH_MESSAGE_NVM_MAX_DESTROY_OBJECTS_COUNT) {
+                for (i = 0; i < req.list_count; i++) {
+                    wh_Server_CertCacheInvalidate(server, req.list[i]);
+                }
                 /* Process the DestroyObjects action */
                 resp.rc = wh_Nvm_DestroyObjects(server->nvm,
                         req.list_count, req.list);
+                for (i = 0; i < req.list_count; i++) {
+                    _NvmObjectChanged(server, req.list[i]);
+                }
             } else {
                 /* Problem in transport or request */
                 resp.rc = WH_ERROR_ABORTED;
@@ -235,6 +431,44 @@ int wh_Server_HandleNvmRequest(whServerContext* server,
         *out_resp_size = sizeof(resp);
     }; break;
 
+    case WH_MESSAGE_NVM_ACTION_DESTROYMATCHING:
+    {
+        whMessageNvm_DestroyMatchingRequest req = {0};
+        whMessageNvm_DestroyMatchingResponse resp = {0};
+        whNvmFilter filter = {0};
+        whNvmId count = 0;
+
+        if (req_size == sizeof(req)) {
+            /* Convert request struct */
+            wh_MessageNvm_TranslateDestroyMatchingRequest(magic,
+                    (whMessageNvm_DestroyMatchingRequest*)req_packet, &req);
+
+            filter.id_first = req.id_first;
+            filter.id_last = req.id_last;
+            filter.id_mask = req.id_mask;
+            filter.id_match = req.id_match;
+            filter.access_mask = req.access_mask;
+            filter.access_match = req.access_match;
+            filter.flags_mask = req.flags_mask;
+            filter.flags_match = req.flags_match;
+
+            wh_Server_CertCacheInvalidateMatching(server, &filter);
+            /* Process the DestroyMatching action */
+            resp.rc = wh_Nvm_DestroyMatching(server->nvm, &filter, &count);
+            _NvmObjectChanged(server, WOLFHSM_KEYID_ERASED);
+            if (resp.rc == 0) {
+                resp.count = count;
+            }
+        } else {
+            /* Request is malformed */
+            resp.rc = WH_ERROR_ABORTED;
+        }
+        /* Convert the response struct */
+        wh_MessageNvm_TranslateDestroyMatchingResponse(magic,
+                &resp, (whMessageNvm_DestroyMatchingResponse*)resp_packet);
+        *out_resp_size = sizeof(resp);
+    }; break;
+
     case WH_MESSAGE_NVM_ACTION_READ:
     {
         whMessageNvm_ReadRequest req = {0};
@@ -296,10 +530,13 @@ int wh_Server_HandleNvmRequest(whServerContext* server,
             }
 
             /* Process the AddObject action */
-            resp.rc = wh_Nvm_AddObject(server->nvm,
+            wh_Server_CertCacheInvalidate(server,
+                    ((whNvmMetadata*)metadata)->id);
+            resp.rc = wh_Server_NvmAddObject(server,
                     (whNvmMetadata*)metadata,
                     req.data_len,
                     (const uint8_t*)data);
+            _NvmObjectChanged(server, ((whNvmMetadata*)metadata)->id);
             if (resp.rc != WH_ERROR_OK) {
                 goto transRespAddObjDma32;
             }
@@ -346,8 +583,8 @@ int wh_Server_HandleNvmRequest(whServerContext* server,
             }
 
             /* Process the Read action */
-            resp.rc = wh_Nvm_Read(server->nvm, req.id, req.offset, req.data_len,
-                    (uint8_t*)data);
+            resp.rc = _NvmReadToClient(server, req.id, req.offset,
+                    req.data_len, (uint8_t*)data);
             if (resp.rc != WH_ERROR_OK) {
                 goto transRespReadDma32;
             }
@@ -395,10 +632,13 @@ int wh_Server_HandleNvmRequest(whServerContext* server,
             }
 
             /* Process the AddObject action */
-            resp.rc = wh_Nvm_AddObject(server->nvm,
+            wh_Server_CertCacheInvalidate(server,
+                    ((whNvmMetadata*)metadata)->id);
+            resp.rc = wh_Server_NvmAddObject(server,
                     (whNvmMetadata*)metadata,
                     req.data_len,
                     (const uint8_t*)data);
+            _NvmObjectChanged(server, ((whNvmMetadata*)metadata)->id);
             if (resp.rc != WH_ERROR_OK) {
                 goto transRespAddObjectDma64;
             }
@@ -445,8 +685,8 @@ int wh_Server_HandleNvmRequest(whServerContext* server,
             }
 
             /* Process the Read action */
-            resp.rc = wh_Nvm_Read(server->nvm, req.id, req.offset, req.data_len,
-                    (uint8_t*)data);
+            resp.rc = _NvmReadToClient(server, req.id, req.offset,
+                    req.data_len, (uint8_t*)data);
             if (resp.rc != WH_ERROR_OK) {
                 goto transRespReadDma64;
             }
@@ -466,6 +706,75 @@ int wh_Server_HandleNvmRequest(whServerContext* server,
         *out_resp_size = sizeof(resp);
     }; break;
 
+    case WH_MESSAGE_NVM_ACTION_ADDOBJECTBULK:
+    {
+        whMessageNvm_AddObjectBulkRequest req = {0};
+        whMessageNvm_SimpleResponse resp = {0};
+        whNvmMetadata meta = {0};
+        void* metadata = NULL;
+        void* data = NULL;
+
+        if (req_size == sizeof(req)) {
+            /* Convert request struct */
+            wh_MessageNvm_TranslateAddObjectBulkRequest(magic,
+                    (whMessageNvm_AddObjectBulkRequest*)req_packet, &req);
+
+            /* Resolve both buffers within the shared bulk region */
+            resp.rc = wh_CommServer_GetBulk(server->comm, req.metadata_offset,
+                    sizeof(meta), &metadata);
+            if (resp.rc == WH_ERROR_OK) {
+                resp.rc = wh_CommServer_GetBulk(server->comm,
+                        req.data_offset, req.data_len, &data);
+            }
+            if (resp.rc == WH_ERROR_OK) {
+                /* Offsets may not be aligned for the metadata struct */
+                memcpy(&meta, metadata, sizeof(meta));
+
+                /* Process the AddObject action */
+                wh_Server_CertCacheInvalidate(server, meta.id);
+                resp.rc = wh_Server_NvmAddObject(server, &meta,
+                        req.data_len, (const uint8_t*)data);
+                _NvmObjectChanged(server, meta.id);
+            }
+        } else {
+            /* Request is malformed */
+            resp.rc = WH_ERROR_ABORTED;
+        }
+        /* Convert the response struct */
+        wh_MessageNvm_TranslateSimpleResponse(magic,
+                &resp, (whMessageNvm_SimpleResponse*)resp_packet);
+        *out_resp_size = sizeof(resp);
+    }; break;
+
+    case WH_MESSAGE_NVM_ACTION_READBULK:
+    {
+        whMessageNvm_ReadBulkRequest req = {0};
+        whMessageNvm_SimpleResponse resp = {0};
+        void* data = NULL;
+
+        if (req_size == sizeof(req)) {
+            /* Convert request struct */
+            wh_MessageNvm_TranslateReadBulkRequest(magic,
+                    (whMessageNvm_ReadBulkRequest*)req_packet, &req);
+
+            /* Resolve the destination within the shared bulk region */
+            resp.rc = wh_CommServer_GetBulk(server->comm, req.data_offset,
+                    req.data_len, &data);
+            if (resp.rc == WH_ERROR_OK) {
+                /* Process the Read action directly into the bulk buffer */
+                resp.rc = wh_Nvm_Read(server->nvm, req.id, req.offset,
+                        req.data_len, (uint8_t*)data);
+            }
+        } else {
+            /* Request is malformed */
+            resp.rc = WH_ERROR_ABORTED;
+        }
+        /* Convert the response struct */
+        wh_MessageNvm_TranslateSimpleResponse(magic,
+                &resp, (whMessageNvm_SimpleResponse*)resp_packet);
+        *out_resp_size = sizeof(resp);
+    }; break;
+
     default:
         /* Unknown request. Respond with empty packet */
         /* TODO: Use ErrorResponse packet instead */
@@ -0,0 +1,967 @@
+/*
+ * Copyright (C) 2024 wolfSSL Inc.
+ *
+ * This file is part of wolfHSM.
+ *
+ * wolfHSM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfHSM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wolfHSM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * src/wh_server_pkcs11.c
+ *
+ * Server side of the PKCS11 message group.  Sessions and object handles are
+ * kept in fixed tables in the server context.  Handles encode the table index
+ * and a generation count, so resolving a handle is a single indexed load and a
+ * stale handle is rejected without a search.  The object table is open
+ * addressed by NVM id so FindObjects can hand out the existing handle for an
+ * object without a scan.  Objects with a key id belong to the client encoded
+ * in it and are neither found nor resolved for any other client.
+ */
+
+/* System libraries */
+#include <stdint.h>
+#include <stdlib.h>  /* For NULL */
+#include <string.h>  /* For memset, memcpy */
+
+/* Common WolfHSM types and defines */
+#include "wolfhsm/wh_error.h"
+#include "wolfhsm/wh_comm.h"
+
+/* Server Components */
+#include "wolfhsm/wh_nvm.h"
+
+/* Message definitions */
+#include "wolfhsm/wh_message.h"
+#include "wolfhsm/wh_message_pkcs11.h"
+
+/* Server API's */
+#include "wolfhsm/wh_server.h"
+#include "wolfhsm/wh_server_pkcs11.h"
+#include "wolfhsm/wh_server_cert.h"
+#ifndef WOLFHSM_NO_CRYPTO
+#include "wolfhsm/wh_server_keystore.h"
+#endif
+
+/* Handles are (generation << 16) | (index + 1) so that 0 is never valid */
+#define WH_PKCS11_HANDLE(_gen, _idx) \
+    ((((uint32_t)(_gen)) << 16) | (uint32_t)((_idx) + 1))
+#define WH_PKCS11_HANDLE_IDX(_h) ((int)((_h) & 0xFFFF) - 1)
+#define WH_PKCS11_HANDLE_GEN(_h) ((uint16_t)((_h) >> 16))
+
+static int _Pkcs11_HashId(whNvmId id)
+{
+    return (int)(((uint32_t)(id ^ (id >> 8)) * 31u) &
+            (WOLFHSM_NUM_PKCS11_OBJECTS - 1));
+}
+
+/* Key ids carry the owning client, plain NVM objects are shared */
+static int _Pkcs11_IsVisible(whServerContext* server, whNvmId id)
+{
+    return ((id & WOLFHSM_KEYTYPE_MASK) == 0) ||
+            ((id & WOLFHSM_KEYUSER_MASK) ==
+             MAKE_WOLFHSM_KEYID(0, server->comm->client_id, 0));
+}
+
+static whServerPkcs11Session* _Pkcs11_GetSession(whServerContext* server,
+        uint32_t handle)
+{
+    whServerPkcs11Session* session = NULL;
+    int idx = WH_PKCS11_HANDLE_IDX(handle);
+
+    if ((idx < 0) || (idx >= WOLFHSM_NUM_PKCS11_SESSIONS)) {
+        return NULL;
+    }
+    session = &server->pkcs11->sessions[idx];
+    if (    (session->used == 0) ||
+            (session->gen != WH_PKCS11_HANDLE_GEN(handle)) ) {
+        return NULL;
+    }
+    return session;
+}
+
+static whServerPkcs11Object* _Pkcs11_GetObject(whServerContext* server,
+        uint32_t handle)
+{
+    whServerPkcs11Object* obj = NULL;
+    int idx = WH_PKCS11_HANDLE_IDX(handle);
+
+    if ((idx < 0) || (idx >= WOLFHSM_NUM_PKCS11_OBJECTS)) {
+        return NULL;
+    }
+    obj = &server->pkcs11->objects[idx];
+    if (    (obj->state != WH_PKCS11_OBJECT_STATE_USED) ||
+            (obj->gen != WH_PKCS11_HANDLE_GEN(handle)) ||
+            (_Pkcs11_IsVisible(server, obj->id) == 0) ) {
+        return NULL;
+    }
+    return obj;
+}
+
+/* Return the handle already assigned to id, or assign a new one */
+static int _Pkcs11_GetObjectHandle(whServerContext* server, whNvmId id,
+        int cacheIdx, uint32_t* out_handle)
+{
+    whServerPkcs11Object* obj = NULL;
+    int idx = _Pkcs11_HashId(id);
+    int freeIdx = -1;
+    int i;
+
+    for (i = 0; i < WOLFHSM_NUM_PKCS11_OBJECTS; i++) {
+        obj = &server->pkcs11->objects[idx];
+        if (obj->state == WH_PKCS11_OBJECT_STATE_USED) {
+            if (obj->id == id) {
+                if (cacheIdx >= 0) {
+                    obj->cacheIdx = (int16_t)cacheIdx;
+                }
+                *out_handle = WH_PKCS11_HANDLE(obj->gen, idx);
+                return WH_ERROR_OK;
+            }
+        } else if (obj->state == WH_PKCS11_OBJECT_STATE_DELETED) {
+            if (freeIdx == -1) {
+                freeIdx = idx;
+            }
+        } else {
+            /* Empty entry ends the probe chain */
+            if (freeIdx == -1) {
+                freeIdx = idx;
+            }
+            break;
+        }
+        idx = (idx + 1) & (WOLFHSM_NUM_PKCS11_OBJECTS - 1);
+    }
+    if (freeIdx == -1) {
+        return WH_ERROR_NOSPACE;
+    }
+
+    obj = &server->pkcs11->objects[freeIdx];
+    obj->id = id;
+    obj->state = WH_PKCS11_OBJECT_STATE_USED;
+    obj->cacheIdx = (int16_t)cacheIdx;
+    *out_handle = WH_PKCS11_HANDLE(obj->gen, freeIdx);
+    return WH_ERROR_OK;
+}
+
+static void _Pkcs11_ReleaseObject(whServerPkcs11Object* obj)
+{
+    obj->state = WH_PKCS11_OBJECT_STATE_DELETED;
+    obj->cacheIdx = -1;
+    obj->gen++;
+}
+
+static void _Pkcs11_EndOperation(whServerPkcs11Session* session)
+{
+#ifndef WOLFHSM_NO_CRYPTO
+    if (    (session->op == WH_PKCS11_OP_SIGN) &&
+            (session->signMech == WH_PKCS11_MECH_ECDSA_SHA256) ) {
+        wc_Sha256Free(session->sha256);
+    }
+#endif
+    session->op = WH_PKCS11_OP_NONE;
+}
+
+void wh_Server_Pkcs11Reset(whServerContext* server)
+{
+    int i;
+
+    if (server == NULL) {
+        return;
+    }
+    for (i = 0; i < WOLFHSM_NUM_PKCS11_SESSIONS; i++) {
+        if (server->pkcs11->sessions[i].used != 0) {
+            _Pkcs11_EndOperation(&server->pkcs11->sessions[i]);
+            server->pkcs11->sessions[i].used = 0;
+            server->pkcs11->sessions[i].gen++;
+        }
+    }
+    for (i = 0; i < WOLFHSM_NUM_PKCS11_OBJECTS; i++) {
+        if (server->pkcs11->objects[i].state != WH_PKCS11_OBJECT_STATE_EMPTY) {
+            server->pkcs11->objects[i].state = WH_PKCS11_OBJECT_STATE_EMPTY;
+            server->pkcs11->objects[i].gen++;
+        }
+    }
+}
+
+static int _Pkcs11_FindMatch(whServerContext* server,
+        const whServerPkcs11Session* session, const whNvmMetadata* meta)
+{
+    if (_Pkcs11_IsVisible(server, meta->id) == 0) {
+        return 0;
+    }
+    if (    ((session->findIdMin != 0) && (meta->id < session->findIdMin)) ||
+            ((session->findIdMax != 0) && (meta->id > session->findIdMax)) ) {
+        return 0;
+    }
+    if (    (session->findAccess != WOLFHSM_NVM_ACCESS_ANY) &&
+            (meta->access != session->findAccess) ) {
+        return 0;
+    }
+    if (    (session->findFlags != WOLFHSM_NVM_FLAGS_ANY) &&
+            ((meta->flags & session->findFlags) != session->findFlags) ) {
+        return 0;
+    }
+    if (    (session->findLabelLen != 0) &&
+            (memcmp(meta->label, session->findLabel,
+                    session->findLabelLen) != 0) ) {
+        return 0;
+    }
+    return 1;
+}
+
+#ifndef WOLFHSM_NO_CRYPTO
+/* Continue a search over the key cache.  Called with the keystore held */
+static int _Pkcs11_FindCached(whServerContext* server,
+        whServerPkcs11Session* session, uint16_t max_count,
+        uint32_t* handles, uint16_t* inout_count)
+{
+    int rc = 0;
+    uint16_t count = *inout_count;
+
+    while (     (rc == 0) && (count < max_count) &&
+                (session->findCacheIdx < WOLFHSM_NUM_RAMKEYS)) {
+        CacheSlot* slot = &server->keystore->cache[session->findCacheIdx];
+        if (    (slot->meta->id != WOLFHSM_KEYID_ERASED) &&
+                (slot->commited == 0) &&
+                (_Pkcs11_FindMatch(server, session, slot->meta) != 0) ) {
+            rc = _Pkcs11_GetObjectHandle(server, slot->meta->id,
+                    session->findCacheIdx, &handles[count]);
+            if (rc != 0) {
+                break;
+            }
+            count++;
+        }
+        session->findCacheIdx++;
+    }
+    *inout_count = count;
+    return rc;
+}
+#endif
+
+static int _Pkcs11_FindObjects(whServerContext* server,
+        whServerPkcs11Session* session, uint16_t max_count,
+        uint32_t* handles, uint16_t* out_count)
+{
+    int rc = 0;
+    uint16_t count = 0;
+    whNvmId list_count = 0;
+    whNvmId id = 0;
+    whNvmId prev = 0;
+    whNvmMetadata meta = {0};
+
+    while ((rc == 0) && (count < max_count) && (session->findNvmDone == 0)) {
+        rc = wh_Nvm_List(server->nvm, session->findAccess, session->findFlags,
+                session->findNext, &list_count, &id);
+        if ((rc != 0) || (list_count == 0) || (id == WH_NVM_INVALID_ID)) {
+            /* End of the NVM directory */
+            session->findNvmDone = 1;
+            rc = 0;
+            break;
+        }
+        prev = session->findNext;
+        session->findNext = id;
+        if (    (wh_Nvm_GetMetadata(server->nvm, id, &meta) == 0) &&
+                (_Pkcs11_FindMatch(server, session, &meta) != 0) ) {
+            rc = _Pkcs11_GetObjectHandle(server, id, -1, &handles[count]);
+            if (rc == 0) {
+                count++;
+            } else {
+                /* Retry this id on the next call */
+                session->findNext = prev;
+            }
+        }
+    }
+
+#ifndef WOLFHSM_NO_CRYPTO
+    /* Keys that are only cached have not been committed to NVM yet */
+    if (    (rc == 0) && (count < max_count) &&
+            (session->findCacheIdx < WOLFHSM_NUM_RAMKEYS)) {
+        rc = hsmKeystoreLock(server, 0);
+        if (rc == 0) {
+            rc = _Pkcs11_FindCached(server, session, max_count, handles,
+                    &count);
+            hsmKeystoreUnlock(server, 0);
+        }
+    }
+#endif
+
+    *out_count = count;
+    return rc;
+}
+
+#ifndef WOLFHSM_NO_CRYPTO
+/* Resolve the key cache slot of an object, using the stored hint first.  On
+ * success the keystore is left locked for the caller to use the slot, release
+ * it with hsmReleaseKeySlot(server, *out_exclusive) */
+static int _Pkcs11_ObjectCacheIdx(whServerContext* server,
+        whServerPkcs11Object* obj, int* out_exclusive)
+{
+    int ret;
+
+    ret = hsmKeystoreLock(server, 0);
+    if (ret != 0) {
+        return ret;
+    }
+    if (    (obj->cacheIdx >= 0) &&
+            (obj->cacheIdx < WOLFHSM_NUM_RAMKEYS) &&
+            (server->keystore->cache[obj->cacheIdx].meta->id == obj->id) ) {
+        *out_exclusive = 0;
+        return obj->cacheIdx;
+    }
+    hsmKeystoreUnlock(server, 0);
+    ret = hsmAcquireKeySlot(server, obj->id, out_exclusive);
+    if (    (ret >= 0) &&
+            (server->keystore->cache[ret].meta->id != obj->id) ) {
+        hsmReleaseKeySlot(server, *out_exclusive);
+        ret = WH_ERROR_NOTFOUND;
+    }
+    if (ret >= 0) {
+        obj->cacheIdx = (int16_t)ret;
+    }
+    return ret;
+}
+#endif
+
+static int _Pkcs11_ObjectGetMetadata(whServerContext* server,
+        whServerPkcs11Object* obj, whNvmMetadata* meta)
+{
+#ifndef WOLFHSM_NO_CRYPTO
+    CacheSlot* slot;
+    int found = 0;
+
+    if (    (obj->cacheIdx >= 0) &&
+            (obj->cacheIdx < WOLFHSM_NUM_RAMKEYS) &&
+            (hsmKeystoreLock(server, 0) == 0) ) {
+        slot = &server->keystore->cache[obj->cacheIdx];
+        if (slot->meta->id == obj->id) {
+            memcpy(meta, slot->meta, sizeof(*meta));
+            found = 1;
+        }
+        hsmKeystoreUnlock(server, 0);
+    }
+    if (found != 0) {
+        return WH_ERROR_OK;
+    }
+#endif
+    return wh_Nvm_GetMetadata(server->nvm, obj->id, meta);
+}
+
+static int _Pkcs11_DestroyObject(whServerContext* server,
+        whServerPkcs11Object* obj)
+{
+    int rc;
+    whNvmId id = obj->id;
+
+#ifndef WOLFHSM_NO_CRYPTO
+    int i;
+    /* Drop any cached copy, holding the keystore until the object is gone */
+    rc = hsmKeystoreLock(server, 1);
+    if (rc != 0) {
+        return rc;
+    }
+    for (i = 0; i < WOLFHSM_NUM_RAMKEYS; i++) {
+        if (server->keystore->cache[i].meta->id == id) {
+            server->keystore->cache[i].meta->id = WOLFHSM_KEYID_ERASED;
+            break;
+        }
+    }
+    hsmKeyChanged(server, id);
+#endif
+    wh_Server_CertCacheInvalidate(server, id);
+    rc = wh_Nvm_DestroyObjects(server->nvm, 1, &id);
+#ifndef WOLFHSM_NO_CRYPTO
+    hsmKeystoreUnlock(server, 1);
+#endif
+    if (rc == 0) {
+        _Pkcs11_ReleaseObject(obj);
+    }
+    return rc;
+}
+
+#ifndef WOLFHSM_NO_CRYPTO
+static int _Pkcs11_CurveFromSize(uint32_t keySz)
+{
+    switch (keySz) {
+    case 32: return ECC_SECP256R1;
+    case 48: return ECC_SECP384R1;
+    case 66: return ECC_SECP521R1;
+    default: return ECC_CURVE_INVALID;
+    }
+}
+
+/* Sign a digest with the cached ECC key of obj, output is raw r || s */
+static int _Pkcs11_EcdsaSign(whServerContext* server,
+        whServerPkcs11Object* obj, const uint8_t* digest, uint32_t digestLen,
+        uint8_t* out, uint16_t* inout_len)
+{
+    int ret;
+    int slotIdx;
+    int exclusive = 0;
+    CacheSlot* slot;
+    uint32_t keySz;
+    word32 derLen;
+    word32 rLen;
+    word32 sLen;
+    uint8_t der[ECC_MAX_SIG_SIZE];
+    ecc_key* key = server->crypto->eccPrivate;
+
+    if ((obj->id & WOLFHSM_KEYTYPE_MASK) != WOLFHSM_KEYTYPE_CRYPTO) {
+        return WH_ERROR_BADARGS;
+    }
+    ret = slotIdx = _Pkcs11_ObjectCacheIdx(server, obj, &exclusive);
+    if (ret < 0) {
+        return ret;
+    }
+    slot = &server->keystore->cache[slotIdx];
+    keySz = slot->meta->len / 3;
+    if (_Pkcs11_CurveFromSize(keySz) == ECC_CURVE_INVALID) {
+        ret = WH_ERROR_BADARGS;
+    }
+    else if (*inout_len < keySz * 2) {
+        ret = WH_ERROR_NOSPACE;
+    }
+    else {
+        ret = wc_ecc_init_ex(key, NULL, server->crypto->devId);
+    }
+    if (ret == 0) {
+        ret = wc_ecc_import_unsigned(key, slot->buffer, slot->buffer + keySz,
+            slot->buffer + keySz * 2, _Pkcs11_CurveFromSize(keySz));
+        if (ret != 0) {
+            wc_ecc_free(key);
+        }
+    }
+    /* the key is imported, the slot is no longer needed */
+    hsmReleaseKeySlot(server, exclusive);
+    if (ret == 0) {
+        derLen = sizeof(der);
+        ret = wc_ecc_sign_hash(digest, digestLen, der, &derLen,
+                server->crypto->rng, key);
+        wc_ecc_free(key);
+    }
+    if (ret == 0) {
+        rLen = sLen = keySz;
+        ret = wc_ecc_sig_to_rs(der, derLen, out, &rLen, out + keySz, &sLen);
+    }
+    if (ret == 0) {
+        /* Left pad r and s to the field size */
+        memmove(out + keySz - rLen, out, rLen);
+        memset(out, 0, keySz - rLen);
+        memmove(out + keySz * 2 - sLen, out + keySz, sLen);
+        memset(out + keySz, 0, keySz - sLen);
+        *inout_len = (uint16_t)(keySz * 2);
+    }
+    return ret;
+}
+#endif /* !WOLFHSM_NO_CRYPTO */
+
+static int _Pkcs11_SignInit(whServerContext* server,
+        whServerPkcs11Session* session, uint32_t object, uint32_t mechanism)
+{
+#ifndef WOLFHSM_NO_CRYPTO
+    int rc = 0;
+
+    if (_Pkcs11_GetObject(server, object) == NULL) {
+        return WH_ERROR_BADHANDLE;
+    }
+    if (session->op != WH_PKCS11_OP_NONE) {
+        return WH_ERROR_OPACTIVE;
+    }
+    switch (mechanism) {
+    case WH_PKCS11_MECH_ECDSA:
+        break;
+    case WH_PKCS11_MECH_ECDSA_SHA256:
+        rc = wc_InitSha256_ex(session->sha256, NULL, server->crypto->devId);
+        break;
+    default:
+        rc = WH_ERROR_BADARGS;
+    }
+    if (rc == 0) {
+        session->op = WH_PKCS11_OP_SIGN;
+        session->signObject = object;
+        session->signMech = mechanism;
+    }
+    return rc;
+#else
+    (void)server; (void)session; (void)object; (void)mechanism;
+    return WH_ERROR_NOHANDLER;
+#endif
+}
+
+static int _Pkcs11_SignUpdate(whServerContext* server,
+        whServerPkcs11Session* session, const uint8_t* data, uint16_t len)
+{
+#ifndef WOLFHSM_NO_CRYPTO
+    int rc;
+
+    (void)server;
+    if (session->op != WH_PKCS11_OP_SIGN) {
+        return WH_ERROR_NOTINIT;
+    }
+    /* Raw ECDSA signs a caller supplied digest, so it is single-part only */
+    if (session->signMech != WH_PKCS11_MECH_ECDSA_SHA256) {
+        _Pkcs11_EndOperation(session);
+        return WH_ERROR_BADARGS;
+    }
+    rc = wc_Sha256Update(session->sha256, data, len);
+    if (rc != 0) {
+        _Pkcs11_EndOperation(session);
+    }
+    return rc;
+#else
+    (void)server; (void)session; (void)data; (void)len;
+    return WH_ERROR_NOHANDLER;
+#endif
+}
+
+/* Finish the sign operation. data is hashed first when not NULL, which
+ * implements the single-part C_Sign */
+static int _Pkcs11_SignFinal(whServerContext* server,
+        whServerPkcs11Session* session, const uint8_t* data, uint16_t len,
+        uint8_t* sig, uint16_t* inout_sig_len)
+{
+#ifndef WOLFHSM_NO_CRYPTO
+    int rc = 0;
+    const uint8_t* digest = data;
+    uint32_t digestLen = len;
+    uint8_t hash[WC_SHA256_DIGEST_SIZE];
+    whServerPkcs11Object* obj = NULL;
+
+    if (session->op != WH_PKCS11_OP_SIGN) {
+        return WH_ERROR_NOTINIT;
+    }
+    obj = _Pkcs11_GetObject(server, session->signObject);
+    if (obj == NULL) {
+        rc = WH_ERROR_BADHANDLE;
+    }
+    if ((rc == 0) && (session->signMech == WH_PKCS11_MECH_ECDSA_SHA256)) {
+        if (data != NULL) {
+            rc = wc_Sha256Update(session->sha256, data, len);
+        }
+        if (rc == 0) {
+            rc = wc_Sha256Final(session->sha256, hash);
+        }
+        digest = hash;
+        digestLen = sizeof(hash);
+    }
+    else if ((rc == 0) && (data == NULL)) {
+        /* Raw ECDSA requires the digest in C_Sign */
+        rc = WH_ERROR_BADARGS;
+    }
+    if (rc == 0) {
+        rc = _Pkcs11_EcdsaSign(server, obj, digest, digestLen, sig,
+                inout_sig_len);
+    }
+    _Pkcs11_EndOperation(session);
+    return rc;
+#else
+    (void)server; (void)session; (void)data; (void)len;
+    (void)sig; (void)inout_sig_len;
+    return WH_ERROR_NOHANDLER;
+#endif
+}
+
+int wh_Server_HandlePkcs11Request(whServerContext* server,
+        uint16_t magic, uint16_t action, uint16_t seq,
+        uint16_t req_size, const void* req_packet,
+        uint16_t *out_resp_size, void* resp_packet)
+{
+    (void)seq;
+
+    if (    (server == NULL) ||
+            (req_packet == NULL) ||
+            (resp_packet == NULL) ||
+            (out_resp_size == NULL) ) {
+        return WH_ERROR_BADARGS;
+    }
+
+    /* III: Translate function returns do not need to be checked since args
+     * are not NULL */
+
+    switch (action) {
+
+    case WH_MESSAGE_PKCS11_ACTION_OPENSESSION:
+    {
+        whMessagePkcs11_OpenSessionRequest req = {0};
+        whMessagePkcs11_OpenSessionResponse resp = {0};
+        whServerPkcs11Session* session = NULL;
+        int i;
+
+        if (req_size == sizeof(req)) {
+            /* Convert request struct */
+            wh_MessagePkcs11_TranslateOpenSessionRequest(magic,
+                    (whMessagePkcs11_OpenSessionRequest*)req_packet, &req);
+
+            /* Process the open session action */
+            resp.rc = WH_ERROR_NOSPACE;
+            for (i = 0; i < WOLFHSM_NUM_PKCS11_SESSIONS; i++) {
+                session = &server->pkcs11->sessions[i];
+                if (session->used == 0) {
+                    session->used = 1;
+                    session->op = WH_PKCS11_OP_NONE;
+                    session->flags = req.flags;
+                    resp.session = WH_PKCS11_HANDLE(session->gen, i);
+                    resp.rc = 0;
+                    break;
+                }
+            }
+        } else {
+            /* Request is malformed */
+            resp.rc = WH_ERROR_ABORTED;
+        }
+
+        /* Convert the response struct */
+        wh_MessagePkcs11_TranslateOpenSessionResponse(magic,
+                &resp, (whMessagePkcs11_OpenSessionResponse*)resp_packet);
+        *out_resp_size = sizeof(resp);
+    }; break;
+
+    case WH_MESSAGE_PKCS11_ACTION_CLOSESESSION:
+    {
+        whMessagePkcs11_SessionRequest req = {0};
+        whMessagePkcs11_SimpleResponse resp = {0};
+        whServerPkcs11Session* session = NULL;
+        int i;
+
+        if (req_size == sizeof(req)) {
+            /* Convert request struct */
+            wh_MessagePkcs11_TranslateSessionRequest(magic,
+                    (whMessagePkcs11_SessionRequest*)req_packet, &req);
+
+            /* Process the close session action */
+            session = _Pkcs11_GetSession(server, req.session);
+            if (session != NULL) {
+                _Pkcs11_EndOperation(session);
+                session->used = 0;
+                session->gen++;
+                /* Object handles live until the last session is closed */
+                for (i = 0; i < WOLFHSM_NUM_PKCS11_SESSIONS; i++) {
+                    if (server->pkcs11->sessions[i].used != 0) {
+                        break;
+                    }
+                }
+                if (i == WOLFHSM_NUM_PKCS11_SESSIONS) {
+                    wh_Server_Pkcs11Reset(server);
+                }
+                resp.rc = 0;
+            } else {
+                resp.rc = WH_ERROR_BADHANDLE;
+            }
+        } else {
+            /* Request is malformed */
+            resp.rc = WH_ERROR_ABORTED;
+        }
+
+        /* Convert the response struct */
+        wh_MessagePkcs11_TranslateSimpleResponse(magic,
+                &resp, (whMessagePkcs11_SimpleResponse*)resp_packet);
+        *out_resp_size = sizeof(resp);
+    }; break;
+
+    case WH_MESSAGE_PKCS11_ACTION_FINDOBJECTSINIT:
+    {
+        whMessagePkcs11_FindObjectsInitRequest req = {0};
+        whMessagePkcs11_SimpleResponse resp = {0};
+        whServerPkcs11Session* session = NULL;
+
+        if (req_size == sizeof(req)) {
+            /* Convert request struct */
+            wh_MessagePkcs11_TranslateFindObjectsInitRequest(magic,
+                    (whMessagePkcs11_FindObjectsInitRequest*)req_packet, &req);
+
+            /* Process the find init action */
+            session = _Pkcs11_GetSession(server, req.session);
+            if (session == NULL) {
+                resp.rc = WH_ERROR_BADHANDLE;
+            } else if (session->op != WH_PKCS11_OP_NONE) {
+                resp.rc = WH_ERROR_OPACTIVE;
+            } else if (req.label_len > sizeof(req.label)) {
+                resp.rc = WH_ERROR_BADARGS;
+            } else {
+                session->op = WH_PKCS11_OP_FIND;
+                session->findNext = WH_NVM_INVALID_ID;
+                session->findIdMin = req.id_min;
+                session->findIdMax = req.id_max;
+                session->findAccess = req.access;
+                session->findFlags = req.flags;
+                session->findLabelLen = req.label_len;
+                memcpy(session->findLabel, req.label, sizeof(req.label));
+                session->findNvmDone = 0;
+                session->findCacheIdx = 0;
+                resp.rc = 0;
+            }
+        } else {
+            /* Request is malformed */
+            resp.rc = WH_ERROR_ABORTED;
+        }
+
+        /* Convert the response struct */
+        wh_MessagePkcs11_TranslateSimpleResponse(magic,
+                &resp, (whMessagePkcs11_SimpleResponse*)resp_packet);
+        *out_resp_size = sizeof(resp);
+    }; break;
+
+    case WH_MESSAGE_PKCS11_ACTION_FINDOBJECTS:
+    {
+        whMessagePkcs11_FindObjectsRequest req = {0};
+        whMessagePkcs11_FindObjectsResponse resp = {0};
+        whServerPkcs11Session* session = NULL;
+
+        if (req_size == sizeof(req)) {
+            /* Convert request struct */
+            wh_MessagePkcs11_TranslateFindObjectsRequest(magic,
+                    (whMessagePkcs11_FindObjectsRequest*)req_packet, &req);
+
+            if (req.max_count > WH_MESSAGE_PKCS11_MAX_FIND_HANDLES) {
+                req.max_count = WH_MESSAGE_PKCS11_MAX_FIND_HANDLES;
+            }
+
+            /* Process the find action */
+            session = _Pkcs11_GetSession(server, req.session);
+            if (session == NULL) {
+                resp.rc = WH_ERROR_BADHANDLE;
+            } else if (session->op != WH_PKCS11_OP_FIND) {
+                resp.rc = WH_ERROR_NOTINIT;
+            } else {
+                resp.rc = _Pkcs11_FindObjects(server, session, req.max_count,
+                        resp.handles, &resp.count);
+            }
+        } else {
+            /* Request is malformed */
+            resp.rc = WH_ERROR_ABORTED;
+        }
+
+        /* Convert the response struct */
+        wh_MessagePkcs11_TranslateFindObjectsResponse(magic,
+                &resp, (whMessagePkcs11_FindObjectsResponse*)resp_packet);
+        *out_resp_size = sizeof(resp);
+    }; break;
+
+    case WH_MESSAGE_PKCS11_ACTION_FINDOBJECTSFINAL:
+    {
+        whMessagePkcs11_SessionRequest req = {0};
+        whMessagePkcs11_SimpleResponse resp = {0};
+        whServerPkcs11Session* session = NULL;
+
+        if (req_size == sizeof(req)) {
+            /* Convert request struct */
+            wh_MessagePkcs11_TranslateSessionRequest(magic,
+                    (whMessagePkcs11_SessionRequest*)req_packet, &req);
+
+            /* Process the find final action */
+            session = _Pkcs11_GetSession(server, req.session);
+            if (session == NULL) {
+                resp.rc = WH_ERROR_BADHANDLE;
+            } else if (session->op != WH_PKCS11_OP_FIND) {
+                resp.rc = WH_ERROR_NOTINIT;
+            } else {
+                _Pkcs11_EndOperation(session);
+                resp.rc = 0;
+            }
+        } else {
+            /* Request is malformed */
+            resp.rc = WH_ERROR_ABORTED;
+        }
+
+        /* Convert the response struct */
+        wh_MessagePkcs11_TranslateSimpleResponse(magic,
+                &resp, (whMessagePkcs11_SimpleResponse*)resp_packet);
+        *out_resp_size = sizeof(resp);
+    }; break;
+
+    case WH_MESSAGE_PKCS11_ACTION_GETOBJECTINFO:
+    {
+        whMessagePkcs11_ObjectRequest req = {0};
+        whMessagePkcs11_GetObjectInfoResponse resp = {0};
+        whServerPkcs11Object* obj = NULL;
+        whNvmMetadata meta = {0};
+
+        if (req_size == sizeof(req)) {
+            /* Convert request struct */
+            wh_MessagePkcs11_TranslateObjectRequest(magic,
+                    (whMessagePkcs11_ObjectRequest*)req_packet, &req);
+
+            /* Process the object info action */
+            obj = _Pkcs11_GetObject(server, req.object);
+            if (_Pkcs11_GetSession(server, req.session) == NULL) {
+                resp.rc = WH_ERROR_BADHANDLE;
+            } else if (obj == NULL) {
+                resp.rc = WH_ERROR_BADHANDLE;
+            } else {
+                resp.rc = _Pkcs11_ObjectGetMetadata(server, obj, &meta);
+            }
+            if (resp.rc == 0) {
+                resp.id = meta.id;
+                resp.access = meta.access;
+                resp.flags = meta.flags;
+                resp.len = meta.len;
+                memcpy(resp.label, meta.label, sizeof(resp.label));
+            }
+        } else {
+            /* Request is malformed */
+            resp.rc = WH_ERROR_ABORTED;
+        }
+
+        /* Convert the response struct */
+        wh_MessagePkcs11_TranslateGetObjectInfoResponse(magic,
+                &resp, (whMessagePkcs11_GetObjectInfoResponse*)resp_packet);
+        *out_resp_size = sizeof(resp);
+    }; break;
+
+    case WH_MESSAGE_PKCS11_ACTION_DESTROYOBJECT:
+    {
+        whMessagePkcs11_ObjectRequest req = {0};
+        whMessagePkcs11_SimpleResponse resp = {0};
+        whServerPkcs11Object* obj = NULL;
+
+        if (req_size == sizeof(req)) {
+            /* Convert request struct */
+            wh_MessagePkcs11_TranslateObjectRequest(magic,
+                    (whMessagePkcs11_ObjectRequest*)req_packet, &req);
+
+            /* Process the destroy action */
+            obj = _Pkcs11_GetObject(server, req.object);
+            if (    (_Pkcs11_GetSession(server, req.session) == NULL) ||
+                    (obj == NULL) ) {
+                resp.rc = WH_ERROR_BADHANDLE;
+            } else {
+                resp.rc = _Pkcs11_DestroyObject(server, obj);
+            }
+        } else {
+            /* Request is malformed */
+            resp.rc = WH_ERROR_ABORTED;
+        }
+
+        /* Convert the response struct */
+        wh_MessagePkcs11_TranslateSimpleResponse(magic,
+                &resp, (whMessagePkcs11_SimpleResponse*)resp_packet);
+        *out_resp_size = sizeof(resp);
+    }; break;
+
+    case WH_MESSAGE_PKCS11_ACTION_SIGNINIT:
+    {
+        whMessagePkcs11_SignInitRequest req = {0};
+        whMessagePkcs11_SimpleResponse resp = {0};
+        whServerPkcs11Session* session = NULL;
+
+        if (req_size == sizeof(req)) {
+            /* Convert request struct */
+            wh_MessagePkcs11_TranslateSignInitRequest(magic,
+                    (whMessagePkcs11_SignInitRequest*)req_packet, &req);
+
+            /* Process the sign init action */
+            session = _Pkcs11_GetSession(server, req.session);
+            if (session == NULL) {
+                resp.rc = WH_ERROR_BADHANDLE;
+            } else {
+                resp.rc = _Pkcs11_SignInit(server, session, req.object,
+                        req.mechanism);
+            }
+        } else {
+            /* Request is malformed */
+            resp.rc = WH_ERROR_ABORTED;
+        }
+
+        /* Convert the response struct */
+        wh_MessagePkcs11_TranslateSimpleResponse(magic,
+                &resp, (whMessagePkcs11_SimpleResponse*)resp_packet);
+        *out_resp_size = sizeof(resp);
+    }; break;
+
+    case WH_MESSAGE_PKCS11_ACTION_SIGNUPDATE:
+    {
+        whMessagePkcs11_SignDataRequest req = {0};
+        uint16_t hdr_len = sizeof(req);
+        const uint8_t* data = (const uint8_t*)req_packet + hdr_len;
+        whMessagePkcs11_SimpleResponse resp = {0};
+        whServerPkcs11Session* session = NULL;
+
+        if (req_size >= sizeof(req)) {
+            /* Convert request struct */
+            wh_MessagePkcs11_TranslateSignDataRequest(magic,
+                    (whMessagePkcs11_SignDataRequest*)req_packet, &req);
+            if (req_size == (hdr_len + req.len)) {
+                /* Process the sign update action */
+                session = _Pkcs11_GetSession(server, req.session);
+                if (session == NULL) {
+                    resp.rc = WH_ERROR_BADHANDLE;
+                } else {
+                    resp.rc = _Pkcs11_SignUpdate(server, session, data,
+                            req.len);
+                }
+            } else {
+                /* Problem in the request or transport. */
+                resp.rc = WH_ERROR_ABORTED;
+            }
+        } else {
+            /* Request is malformed */
+            resp.rc = WH_ERROR_ABORTED;
+        }
+
+        /* Convert the response struct */
+        wh_MessagePkcs11_TranslateSimpleResponse(magic,
+                &resp, (whMessagePkcs11_SimpleResponse*)resp_packet);
+        *out_resp_size = sizeof(resp);
+    }; break;
+
+    case WH_MESSAGE_PKCS11_ACTION_SIGN:
+    case WH_MESSAGE_PKCS11_ACTION_SIGNFINAL:
+    {
+        whMessagePkcs11_SignDataRequest req = {0};
+        whMessagePkcs11_SessionRequest final_req = {0};
+        uint16_t hdr_len = sizeof(req);
+        const uint8_t* data = NULL;
+        whMessagePkcs11_SignatureResponse resp = {0};
+        uint8_t* sig = (uint8_t*)resp_packet + sizeof(resp);
+        uint16_t sig_len = WH_MESSAGE_PKCS11_MAX_SIG_LEN;
+        whServerPkcs11Session* session = NULL;
+
+        /* Request data is consumed before the signature overwrites it */
+        resp.rc = WH_ERROR_ABORTED;
+        if (action == WH_MESSAGE_PKCS11_ACTION_SIGN) {
+            if (req_size >= sizeof(req)) {
+                /* Convert request struct */
+                wh_MessagePkcs11_TranslateSignDataRequest(magic,
+                        (whMessagePkcs11_SignDataRequest*)req_packet, &req);
+                if (req_size == (hdr_len + req.len)) {
+                    data = (const uint8_t*)req_packet + hdr_len;
+                    session = _Pkcs11_GetSession(server, req.session);
+                    resp.rc = WH_ERROR_BADHANDLE;
+                }
+            }
+        } else if (req_size == sizeof(final_req)) {
+            /* Convert request struct */
+            wh_MessagePkcs11_TranslateSessionRequest(magic,
+                    (whMessagePkcs11_SessionRequest*)req_packet, &final_req);
+            session = _Pkcs11_GetSession(server, final_req.session);
+            resp.rc = WH_ERROR_BADHANDLE;
+        }
+
+        /* Process the sign action */
+        if (session != NULL) {
+            resp.rc = _Pkcs11_SignFinal(server, session, data, req.len,
+                    sig, &sig_len);
+        }
+        if (resp.rc == 0) {
+            resp.len = sig_len;
+        }
+
+        /* Convert the response struct */
+        wh_MessagePkcs11_TranslateSignatureResponse(magic,
+                &resp, (whMessagePkcs11_SignatureResponse*)resp_packet);
+        *out_resp_size = sizeof(resp) + resp.len;
+    }; break;
+
+    default:
+        /* Unknown request. Respond with empty packet */
+        *out_resp_size = 0;
+    }
+    return 0;
+}
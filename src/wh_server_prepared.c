@@ -0,0 +1,530 @@
+/*
+ * Copyright (C) 2024 wolfSSL Inc.
+ *
+ * This file is part of wolfHSM.
+ *
+ * wolfHSM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfHSM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wolfHSM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * src/wh_server_prepared.c
+ *
+ * Prepared crypto operations.  Prepare resolves the key once and leaves a
+ * keyed wolfCrypt context in the server context, so Exec only validates the
+ * per-call data before running the operation.  Once a new operation is keyed,
+ * the least recently used one is closed if too many are open.  Operations are
+ * closed by the keystore when the key they were prepared from changes, and
+ * when the client disconnects.
+ */
+
+/* System libraries */
+#include <stdint.h>
+#include <stdlib.h>  /* For NULL */
+#include <string.h>  /* For memset, memcpy */
+
+/* Common WolfHSM types and defines shared with the server */
+#include "wolfhsm/wh_error.h"
+#include "wolfhsm/wh_comm.h"
+
+#include "wolfhsm/wh_message.h"
+#include "wolfhsm/wh_message_prepared.h"
+
+#include "wolfhsm/wh_server.h"
+#include "wolfhsm/wh_server_prepared.h"
+
+#ifndef WOLFHSM_NO_CRYPTO
+#include "wolfssl/wolfcrypt/settings.h"
+#include "wolfssl/wolfcrypt/types.h"
+#include "wolfssl/wolfcrypt/error-crypt.h"
+
+#include "wolfhsm/wh_server_keystore.h"
+#include "wolfhsm/wh_server_crypto.h"
+#endif
+
+#if !defined(WOLFHSM_NO_CRYPTO) && \
+    (defined(HAVE_AESGCM) || defined(HAVE_ECC))
+
+/* Handles carry the entry index in the low byte and a sequence number in the
+ * high byte, so a handle to a reclaimed entry is not mistaken for its new
+ * occupant.  A handle only resolves for the client whose key it was prepared
+ * from */
+static whServerPreparedOp* _Prepared_Get(whServerContext* server,
+        uint16_t handle)
+{
+    whServerPreparedOp* op = NULL;
+    uint16_t index = handle & 0xFF;
+
+    if ((index == 0) || (index > WH_SERVER_PREPARED_ENTRIES)) {
+        return NULL;
+    }
+    op = &server->prepared->ops[index - 1];
+    if (    (op->handle == 0) ||
+            (op->handle != handle) ||
+            ((op->keyId & WOLFHSM_KEYUSER_MASK) !=
+             MAKE_WOLFHSM_KEYID(0, server->comm->client_id, 0)) ) {
+        return NULL;
+    }
+    return op;
+}
+
+/* Free the wolfCrypt context and wipe the entry, including its key state */
+static void _Prepared_Close(whServerPreparedOp* op)
+{
+    if (op->handle != 0) {
+        switch (op->alg) {
+#ifdef HAVE_AESGCM
+        case WH_PREPARED_ALG_AESGCM:
+            wc_AesFree(op->ctx.aes);
+            break;
+#endif
+#ifdef HAVE_ECC
+        case WH_PREPARED_ALG_ECDSA_SIGN:
+            wc_ecc_free(op->ctx.ecc);
+            break;
+#endif
+        default:
+            break;
+        }
+    }
+    wc_ForceZero(op, sizeof(*op));
+}
+
+/* Reject parameters before an entry is reclaimed for them */
+static int _Prepared_CheckRequest(const whMessagePrepared_PrepareRequest* req)
+{
+    switch (req->alg) {
+#ifdef HAVE_AESGCM
+    case WH_PREPARED_ALG_AESGCM:
+        if (    (req->iv_len == 0) ||
+                (req->iv_len > WH_PREPARED_MAX_IV_LEN) ||
+                (req->tag_len == 0) ||
+                (req->tag_len > WH_PREPARED_MAX_TAG_LEN)) {
+            return WH_ERROR_BADARGS;
+        }
+        return 0;
+#endif
+#ifdef HAVE_ECC
+    case WH_PREPARED_ALG_ECDSA_SIGN:
+        return 0;
+#endif
+    default:
+        return WH_ERROR_BADARGS;
+    }
+}
+
+/* A free entry.  There is always one, as the table has a spare entry */
+static whServerPreparedOp* _Prepared_Alloc(whServerContext* server)
+{
+    whServerPreparedContext* ctx = server->prepared;
+    int i = 0;
+
+    for (i = 0; i < WH_SERVER_PREPARED_ENTRIES; i++) {
+        if (ctx->ops[i].handle == 0) {
+            break;
+        }
+    }
+    return &ctx->ops[i];
+}
+
+/* Once a new operation is keyed, close the least recently used other one if
+ * more than WOLFHSM_NUM_PREPARED_OPS are now open */
+static void _Prepared_Reclaim(whServerContext* server,
+        const whServerPreparedOp* keep)
+{
+    whServerPreparedContext* ctx = server->prepared;
+    whServerPreparedOp* lru = NULL;
+    int count = 0;
+    int i = 0;
+
+    for (i = 0; i < WH_SERVER_PREPARED_ENTRIES; i++) {
+        if ((ctx->ops[i].handle == 0) || (&ctx->ops[i] == keep)) {
+            continue;
+        }
+        count++;
+        if ((lru == NULL) || (ctx->ops[i].lastUse < lru->lastUse)) {
+            lru = &ctx->ops[i];
+        }
+    }
+    if (count >= WOLFHSM_NUM_PREPARED_OPS) {
+        _Prepared_Close(lru);
+    }
+}
+
+#ifdef HAVE_AESGCM
+/* Key the AES context for GCM.  The size is checked before the key is read
+ * since NVM reads are not bounded by the buffer */
+static int _Prepared_StartAesGcm(whServerContext* server,
+        whServerPreparedOp* op)
+{
+    uint8_t key[AES_256_KEY_SIZE];
+    uint32_t keySz = sizeof(key);
+    int ret = 0;
+
+    ret = hsmReadKey(server, op->keyId, NULL, NULL, &keySz);
+    if ((ret == 0) && (keySz > sizeof(key))) {
+        ret = WH_ERROR_BADARGS;
+    }
+    if (ret == 0) {
+        ret = hsmReadKey(server, op->keyId, NULL, key, &keySz);
+    }
+    if (ret == 0) {
+        ret = wc_AesInit(op->ctx.aes, NULL, server->crypto->devId);
+        if (ret == 0) {
+            ret = wc_AesGcmSetKey(op->ctx.aes, key, keySz);
+            if (ret != 0) {
+                wc_AesFree(op->ctx.aes);
+            }
+        }
+    }
+    wc_ForceZero(key, sizeof(key));
+    return ret;
+}
+
+/* Payload is the IV, AAD, input and, when decrypting, the expected tag */
+static int _Prepared_ExecAesGcm(whServerPreparedOp* op,
+        const whMessagePrepared_ExecRequest* req, const uint8_t* in,
+        uint16_t in_len, uint8_t* out, uint16_t* out_len)
+{
+    const uint8_t* iv = in;
+    const uint8_t* aad = iv + op->ivLen;
+    const uint8_t* data = aad + req->aad_len;
+    const uint8_t* tag = data + req->data_len;
+    uint32_t expected = (uint32_t)op->ivLen + req->aad_len + req->data_len;
+    int ret = 0;
+
+    if (op->enc == 0) {
+        expected += op->tagLen;
+    }
+    if (    (in_len != expected) ||
+            ((op->enc != 0) && ((uint32_t)req->data_len + op->tagLen >
+                    WH_MESSAGE_PREPARED_MAX_INLINE_LEN))) {
+        return WH_ERROR_BADARGS;
+    }
+
+    if (op->enc != 0) {
+        ret = wc_AesGcmEncrypt(op->ctx.aes, out, data, req->data_len,
+                iv, op->ivLen, out + req->data_len, op->tagLen,
+                aad, req->aad_len);
+        if (ret == 0) {
+            *out_len = req->data_len + op->tagLen;
+        }
+    } else {
+        ret = wc_AesGcmDecrypt(op->ctx.aes, out, data, req->data_len,
+                iv, op->ivLen, tag, op->tagLen, aad, req->aad_len);
+        if (ret == 0) {
+            *out_len = req->data_len;
+        } else {
+            /* Do not leave unauthenticated plaintext in the comm buffer */
+            wc_ForceZero(out, req->data_len);
+        }
+    }
+    return ret;
+}
+#endif /* HAVE_AESGCM */
+
+#ifdef HAVE_ECC
+/* Import the private key once, it stays in the entry until closed */
+static int _Prepared_StartEccSign(whServerContext* server,
+        whServerPreparedOp* op, int curveId)
+{
+    int ret = 0;
+
+    ret = wc_ecc_init_ex(op->ctx.ecc, NULL, server->crypto->devId);
+    if (ret == 0) {
+        ret = hsmLoadKeyEcc(server, op->ctx.ecc, op->keyId, curveId);
+        if (ret != 0) {
+            wc_ecc_free(op->ctx.ecc);
+        }
+    }
+    return ret;
+}
+
+/* Payload is the hash to sign */
+static int _Prepared_ExecEccSign(whServerContext* server,
+        whServerPreparedOp* op, const whMessagePrepared_ExecRequest* req,
+        const uint8_t* in, uint16_t in_len, uint8_t* out, uint16_t* out_len)
+{
+    word32 sigLen = WH_MESSAGE_PREPARED_MAX_INLINE_LEN;
+    int ret = 0;
+
+    if (    (req->aad_len != 0) ||
+            (in_len != req->data_len)) {
+        return WH_ERROR_BADARGS;
+    }
+    ret = wc_ecc_sign_hash(in, req->data_len, out, &sigLen,
+            server->crypto->rng, op->ctx.ecc);
+    if (ret == 0) {
+        *out_len = (uint16_t)sigLen;
+    }
+    return ret;
+}
+#endif /* HAVE_ECC */
+
+static int _Prepared_Prepare(whServerContext* server,
+        const whMessagePrepared_PrepareRequest* req, uint16_t* out_handle)
+{
+    whServerPreparedContext* ctx = server->prepared;
+    whServerPreparedOp* op = NULL;
+    int ret = 0;
+
+    ret = _Prepared_CheckRequest(req);
+    if (ret != 0) {
+        return ret;
+    }
+
+    op = _Prepared_Alloc(server);
+    op->keyId = MAKE_WOLFHSM_KEYID(WOLFHSM_KEYTYPE_CRYPTO,
+            server->comm->client_id, req->key_id);
+    switch (req->alg) {
+#ifdef HAVE_AESGCM
+    case WH_PREPARED_ALG_AESGCM:
+        ret = _Prepared_StartAesGcm(server, op);
+        op->enc = (req->enc != 0);
+        op->ivLen = req->iv_len;
+        op->tagLen = req->tag_len;
+        break;
+#endif
+#ifdef HAVE_ECC
+    case WH_PREPARED_ALG_ECDSA_SIGN:
+        ret = _Prepared_StartEccSign(server, op, req->curve_id);
+        break;
+#endif
+    default:
+        ret = WH_ERROR_BADARGS;
+        break;
+    }
+
+    if (ret == 0) {
+        if (++ctx->seq == 0) {
+            ctx->seq = 1;
+        }
+        _Prepared_Reclaim(server, op);
+        op->alg = req->alg;
+        op->handle = (uint16_t)(((uint16_t)ctx->seq << 8) |
+                (uint16_t)(op - ctx->ops + 1));
+        op->lastUse = ++ctx->useCounter;
+        *out_handle = op->handle;
+    } else {
+        /* Nothing was left initialized and no open operation was closed */
+        wc_ForceZero(op, sizeof(*op));
+    }
+    return ret;
+}
+
+/* The payload is copied out first as the output overlaps it in the shared
+ * comm buffer.  A failed call leaves the operation prepared */
+static int _Prepared_Exec(whServerContext* server,
+        const whMessagePrepared_ExecRequest* req, const uint8_t* payload,
+        uint16_t payload_len, uint8_t* out, uint16_t* out_len)
+{
+    whServerPreparedOp* op = _Prepared_Get(server, req->handle);
+    uint8_t in[WH_MESSAGE_PREPARED_MAX_INLINE_LEN];
+    int ret = 0;
+
+    if (op == NULL) {
+        return WH_ERROR_BADHANDLE;
+    }
+    if (payload_len > sizeof(in)) {
+        return WH_ERROR_BADARGS;
+    }
+    memcpy(in, payload, payload_len);
+
+    switch (op->alg) {
+#ifdef HAVE_AESGCM
+    case WH_PREPARED_ALG_AESGCM:
+        ret = _Prepared_ExecAesGcm(op, req, in, payload_len, out, out_len);
+        break;
+#endif
+#ifdef HAVE_ECC
+    case WH_PREPARED_ALG_ECDSA_SIGN:
+        ret = _Prepared_ExecEccSign(server, op, req, in, payload_len, out,
+                out_len);
+        break;
+#endif
+    default:
+        ret = WH_ERROR_BADHANDLE;
+        break;
+    }
+    if (ret == 0) {
+        op->lastUse = ++server->prepared->useCounter;
+    }
+    wc_ForceZero(in, payload_len);
+    return ret;
+}
+
+static int _Prepared_CloseHandle(whServerContext* server, uint16_t handle)
+{
+    whServerPreparedOp* op = _Prepared_Get(server, handle);
+
+    if (op == NULL) {
+        return WH_ERROR_BADHANDLE;
+    }
+    _Prepared_Close(op);
+    return 0;
+}
+#endif /* !WOLFHSM_NO_CRYPTO && (HAVE_AESGCM || HAVE_ECC) */
+
+void wh_Server_PreparedReset(whServerContext* server)
+{
+#if !defined(WOLFHSM_NO_CRYPTO) && \
+    (defined(HAVE_AESGCM) || defined(HAVE_ECC))
+    int i;
+
+    if (server == NULL) {
+        return;
+    }
+    for (i = 0; i < WH_SERVER_PREPARED_ENTRIES; i++) {
+        _Prepared_Close(&server->prepared->ops[i]);
+    }
+    server->prepared->useCounter = 0;
+#else
+    (void)server;
+#endif
+}
+
+void wh_Server_PreparedInvalidate(whServerContext* server, whKeyId keyId)
+{
+#if !defined(WOLFHSM_NO_CRYPTO) && \
+    (defined(HAVE_AESGCM) || defined(HAVE_ECC))
+    int i;
+
+    if (server == NULL) {
+        return;
+    }
+    for (i = 0; i < WH_SERVER_PREPARED_ENTRIES; i++) {
+        if (    (server->prepared->ops[i].handle != 0) &&
+                (server->prepared->ops[i].keyId == keyId)) {
+            _Prepared_Close(&server->prepared->ops[i]);
+        }
+    }
+#else
+    (void)server;
+    (void)keyId;
+#endif
+}
+
+int wh_Server_HandlePreparedRequest(whServerContext* server,
+        uint16_t magic, uint16_t action, uint16_t seq,
+        uint16_t req_size, const void* req_packet,
+        uint16_t *out_resp_size, void* resp_packet)
+{
+    int rc = 0;
+
+    (void)seq;
+
+    if (    (server == NULL) ||
+            (req_packet == NULL) ||
+            (resp_packet == NULL) ||
+            (out_resp_size == NULL) ) {
+        return WH_ERROR_BADARGS;
+    }
+
+    /* III: Translate function returns do not need to be checked since args
+     * are not NULL */
+
+    switch (action) {
+
+    case WH_MESSAGE_PREPARED_ACTION_PREPARE:
+    {
+        whMessagePrepared_PrepareRequest req = {0};
+        whMessagePrepared_PrepareResponse resp = {0};
+
+        if (req_size == sizeof(req)) {
+            /* Convert request struct */
+            wh_MessagePrepared_TranslatePrepareRequest(magic,
+                    (whMessagePrepared_PrepareRequest*)req_packet, &req);
+#if !defined(WOLFHSM_NO_CRYPTO) && \
+    (defined(HAVE_AESGCM) || defined(HAVE_ECC))
+            /* Process the Prepare action */
+            resp.rc = _Prepared_Prepare(server, &req, &resp.handle);
+#else
+            resp.rc = WH_ERROR_NOHANDLER;
+#endif
+        } else {
+            /* Request is malformed */
+            resp.rc = WH_ERROR_ABORTED;
+        }
+        /* Convert the response struct */
+        wh_MessagePrepared_TranslatePrepareResponse(magic,
+                &resp, (whMessagePrepared_PrepareResponse*)resp_packet);
+        *out_resp_size = sizeof(resp);
+    }; break;
+
+    case WH_MESSAGE_PREPARED_ACTION_EXEC:
+    {
+        whMessagePrepared_ExecRequest req = {0};
+        uint16_t hdr_len = sizeof(req);
+        const uint8_t* payload = (const uint8_t*)req_packet + hdr_len;
+        whMessagePrepared_ExecResponse resp = {0};
+        uint8_t* out = (uint8_t*)resp_packet + sizeof(resp);
+
+        if (req_size >= sizeof(req)) {
+            /* Convert request struct */
+            wh_MessagePrepared_TranslateExecRequest(magic,
+                    (whMessagePrepared_ExecRequest*)req_packet, &req);
+#if !defined(WOLFHSM_NO_CRYPTO) && \
+    (defined(HAVE_AESGCM) || defined(HAVE_ECC))
+            /* Process the Exec action.  The payload layout depends on the
+             * prepared operation, so its length is checked there */
+            resp.rc = _Prepared_Exec(server, &req, payload,
+                    req_size - hdr_len, out, &resp.data_len);
+            if (resp.rc != 0) {
+                resp.data_len = 0;
+            }
+#else
+            (void)payload;
+            (void)out;
+            resp.rc = WH_ERROR_NOHANDLER;
+#endif
+        } else {
+            /* Request is malformed */
+            resp.rc = WH_ERROR_ABORTED;
+        }
+        /* Convert the response struct */
+        wh_MessagePrepared_TranslateExecResponse(magic,
+                &resp, (whMessagePrepared_ExecResponse*)resp_packet);
+        *out_resp_size = sizeof(resp) + resp.data_len;
+    }; break;
+
+    case WH_MESSAGE_PREPARED_ACTION_CLOSE:
+    {
+        whMessagePrepared_CloseRequest req = {0};
+        whMessagePrepared_CloseResponse resp = {0};
+
+        if (req_size == sizeof(req)) {
+            /* Convert request struct */
+            wh_MessagePrepared_TranslateCloseRequest(magic,
+                    (whMessagePrepared_CloseRequest*)req_packet, &req);
+#if !defined(WOLFHSM_NO_CRYPTO) && \
+    (defined(HAVE_AESGCM) || defined(HAVE_ECC))
+            /* Process the Close action */
+            resp.rc = _Prepared_CloseHandle(server, req.handle);
+#else
+            resp.rc = WH_ERROR_NOHANDLER;
+#endif
+        } else {
+            /* Request is malformed */
+            resp.rc = WH_ERROR_ABORTED;
+        }
+        /* Convert the response struct */
+        wh_MessagePrepared_TranslateCloseResponse(magic,
+                &resp, (whMessagePrepared_CloseResponse*)resp_packet);
+        *out_resp_size = sizeof(resp);
+    }; break;
+
+    default:
+        /* Unknown request. Respond with empty packet */
+        *out_resp_size = 0;
+    }
+    return rc;
+}
@@ -34,6 +34,7 @@
 
 #include "wolfhsm/wh_server.h"
 #include "wolfhsm/wh_server_keystore.h"
+#include "wolfhsm/wh_server_nvm.h"
 #include "wolfhsm/wh_message.h"
 #include "wolfhsm/wh_packet.h"
 #include "wolfhsm/wh_error.h"
@@ -160,6 +161,68 @@ static uint32_t hsmShePopFlags(uint8_t* messageTwo)
     return (((messageTwo[3] & 0x0f) << 4) | ((messageTwo[4] & 0x80) >> 7));
 }
 
+/* Resolve a SHE key id to its resident slot.  The slot is only refilled from
+ * the keystore when NVM has been written or the cached key replaced since it
+ * was loaded, so repeated commands on the same key skip the NVM lookup */
+static int hsmSheGetSlot(whServerContext* server, uint16_t sheId,
+    whServerSheSlot** outSlot)
+{
+    int ret = 0;
+    uint32_t keySz;
+    whKeyId keyId;
+    whServerSheSlot* slot;
+    whNvmMetadata meta[1];
+    if (sheId >= WOLFHSM_SHE_NUM_SLOTS)
+        return WH_ERROR_BADARGS;
+    keyId = MAKE_WOLFHSM_KEYID(WOLFHSM_KEYTYPE_SHE, server->comm->client_id,
+        sheId);
+    slot = &server->she->slots[sheId];
+    if (slot->valid == 0 || slot->id != keyId ||
+        slot->nvmGeneration != wh_Nvm_GetGeneration(server->nvm)) {
+        slot->valid = 0;
+        /* the nvm read path doesn't bound the length, check it first */
+        ret = wh_Nvm_GetMetadata(server->nvm, keyId, meta);
+        if (ret == 0 && meta->len != WOLFHSM_SHE_KEY_SZ)
+            ret = WH_ERROR_BADARGS;
+        else {
+            keySz = WOLFHSM_SHE_KEY_SZ;
+            ret = hsmReadKey(server, keyId, slot->meta, slot->key, &keySz);
+            if (ret == 0 && keySz != WOLFHSM_SHE_KEY_SZ)
+                ret = WH_ERROR_BADARGS;
+        }
+        if (ret == 0) {
+            slot->id = keyId;
+            slot->nvmGeneration = wh_Nvm_GetGeneration(server->nvm);
+            slot->valid = 1;
+        }
+    }
+    if (ret == 0)
+        *outSlot = slot;
+    return ret;
+}
+
+void wh_Server_SheSlotInvalidate(whServerContext* server, whKeyId keyId)
+{
+    whServerSheSlot* slot;
+    if (server == NULL || server->she == NULL ||
+        (keyId & WOLFHSM_KEYTYPE_MASK) != WOLFHSM_KEYTYPE_SHE ||
+        (keyId & WOLFHSM_KEYID_MASK) >= WOLFHSM_SHE_NUM_SLOTS) {
+        return;
+    }
+    slot = &server->she->slots[keyId & WOLFHSM_KEYID_MASK];
+    if (slot->id == keyId)
+        slot->valid = 0;
+}
+
+void wh_Server_SheSlotReset(whServerContext* server)
+{
+    int i;
+    if (server == NULL || server->she == NULL)
+        return;
+    for (i = 0; i < WOLFHSM_SHE_NUM_SLOTS; i++)
+        server->she->slots[i].valid = 0;
+}
+
 static int hsmSheSetUid(whServerContext* server, whPacket* packet)
 {
     int ret = 0;
@@ -177,8 +240,8 @@ static int hsmSheSecureBootInit(whServerContext* server, whPacket* packet,
     uint16_t* size)
 {
     int ret = 0;
-    uint32_t keySz;
-    uint8_t macKey[WOLFHSM_SHE_KEY_SZ];
+    uint8_t zeros[WOLFHSM_SHE_BOOT_MAC_PREFIX_LEN];
+    whServerSheSlot* slot;
     /* if we aren't looking for init return error */
     if (server->she->sbState != WOLFHSM_SHE_SB_INIT)
         ret = WH_SHE_ERC_SEQUENCE_ERROR;
@@ -186,10 +249,7 @@ static int hsmSheSecureBootInit(whServerContext* server, whPacket* packet,
         /* set the expected size */
         server->she->blSize = packet->sheSecureBootInitReq.sz;
         /* check if the boot mac key is empty */
-        keySz = sizeof(macKey);
-        ret = hsmReadKey(server, MAKE_WOLFHSM_KEYID(WOLFHSM_KEYTYPE_SHE,
-            server->comm->client_id, WOLFHSM_SHE_BOOT_MAC_KEY_ID), NULL,
-            macKey, &keySz);
+        ret = hsmSheGetSlot(server, WOLFHSM_SHE_BOOT_MAC_KEY_ID, &slot);
         /* if the key wasn't found */
         if (ret != 0) {
             /* return ERC_NO_SECURE_BOOT */
@@ -201,16 +261,15 @@ static int hsmSheSecureBootInit(whServerContext* server, whPacket* packet,
         else
             server->she->cmacKeyFound = 1;
     }
-    /* init the cmac, use const length since the nvm key holds both key and
-     * expected digest so meta->len will be too long */
+    /* init the cmac with the resident boot mac key */
     if (ret == 0) {
-        ret = wc_InitCmac_ex(sheCmac, macKey, WOLFHSM_SHE_KEY_SZ,
+        ret = wc_InitCmac_ex(sheCmac, slot->key, WOLFHSM_SHE_KEY_SZ,
             WC_CMAC_AES, NULL, NULL, server->crypto->devId);
     }
     /* hash 12 zeros */
     if (ret == 0) {
-        XMEMSET(macKey, 0, WOLFHSM_SHE_BOOT_MAC_PREFIX_LEN);
-        ret = wc_CmacUpdate(sheCmac, macKey, WOLFHSM_SHE_BOOT_MAC_PREFIX_LEN);
+        XMEMSET(zeros, 0, sizeof(zeros));
+        ret = wc_CmacUpdate(sheCmac, zeros, sizeof(zeros));
     }
     /* TODO is size big or little endian? spec says it is 32 bit */
     /* hash size */
@@ -265,10 +324,9 @@ static int hsmSheSecureBootFinish(whServerContext* server, whPacket* packet,
     uint16_t* size)
 {
     int ret = 0;
-    uint32_t keySz;
     uint32_t field;
     uint8_t cmacOutput[AES_BLOCK_SIZE];
-    uint8_t macDigest[WOLFHSM_SHE_KEY_SZ];
+    whServerSheSlot* slot;
     /* if we aren't looking for finish return error */
     if (server->she->sbState != WOLFHSM_SHE_SB_FINISH)
         ret = WH_SHE_ERC_SEQUENCE_ERROR;
@@ -279,16 +337,13 @@ static int hsmSheSecureBootFinish(whServerContext* server, whPacket* packet,
     }
     /* load the cmac to check */
     if (ret == 0) {
-        keySz = sizeof(macDigest);
-        ret = hsmReadKey(server, MAKE_WOLFHSM_KEYID(WOLFHSM_KEYTYPE_SHE,
-            server->comm->client_id, WOLFHSM_SHE_BOOT_MAC), NULL, macDigest,
-            &keySz);
+        ret = hsmSheGetSlot(server, WOLFHSM_SHE_BOOT_MAC, &slot);
         if (ret != 0)
             ret = WH_SHE_ERC_KEY_NOT_AVAILABLE;
     }
     if (ret == 0) {
         /* compare and set either success or failure */
-        ret = XMEMCMP(cmacOutput, macDigest, field);
+        ret = XMEMCMP(cmacOutput, slot->key, field);
         if (ret == 0) {
             server->she->sbState = WOLFHSM_SHE_SB_SUCCESS;
             packet->sheSecureBootFinishRes.status = WOLFHSM_SHE_ERC_NO_ERROR;
@@ -326,78 +381,69 @@ static int hsmSheGetStatus(whServerContext* server, whPacket* packet,
     return 0;
 }
 
-static int hsmSheLoadKey(whServerContext* server, whPacket* packet,
-    uint16_t* size)
+/* Derive the pair of keys used to encrypt and authenticate a key update,
+ * AES-MP(key | KEY_UPDATE_ENC_C) and AES-MP(key | KEY_UPDATE_MAC_C) */
+static int hsmSheDeriveUpdateKeys(whServerContext* server, const uint8_t* key,
+    uint8_t* encKey, uint8_t* macKey)
 {
     int ret;
-    int keyRet = 0;
-    uint32_t keySz;
-    uint32_t field;
     uint8_t kdfInput[WOLFHSM_SHE_KEY_SZ * 2];
-    uint8_t cmacOutput[AES_BLOCK_SIZE];
-    uint8_t tmpKey[WOLFHSM_SHE_KEY_SZ];
-    whNvmMetadata meta[1];
-    /* read the auth key by AuthID */
-    keySz = sizeof(kdfInput);
-    ret = hsmReadKey(server, MAKE_WOLFHSM_KEYID(WOLFHSM_KEYTYPE_SHE,
-        server->comm->client_id,
-        hsmShePopAuthId(packet->sheLoadKeyReq.messageOne)), NULL, kdfInput,
-        &keySz);
-    /* make K2 using AES-MP(authKey | WOLFHSM_SHE_KEY_UPDATE_MAC_C) */
+    XMEMCPY(kdfInput, key, WOLFHSM_SHE_KEY_SZ);
+    /* add WOLFHSM_SHE_KEY_UPDATE_ENC_C to the input */
+    XMEMCPY(kdfInput + WOLFHSM_SHE_KEY_SZ, WOLFHSM_SHE_KEY_UPDATE_ENC_C,
+        sizeof(WOLFHSM_SHE_KEY_UPDATE_ENC_C));
+    ret = wh_AesMp16(server, kdfInput,
+        WOLFHSM_SHE_KEY_SZ + sizeof(WOLFHSM_SHE_KEY_UPDATE_ENC_C), encKey);
     if (ret == 0) {
         /* add WOLFHSM_SHE_KEY_UPDATE_MAC_C to the input */
-        XMEMCPY(kdfInput + keySz, WOLFHSM_SHE_KEY_UPDATE_MAC_C,
+        XMEMCPY(kdfInput + WOLFHSM_SHE_KEY_SZ, WOLFHSM_SHE_KEY_UPDATE_MAC_C,
             sizeof(WOLFHSM_SHE_KEY_UPDATE_MAC_C));
-        /* do kdf */
         ret = wh_AesMp16(server, kdfInput,
-            keySz + sizeof(WOLFHSM_SHE_KEY_UPDATE_MAC_C), tmpKey);
+            WOLFHSM_SHE_KEY_SZ + sizeof(WOLFHSM_SHE_KEY_UPDATE_MAC_C), macKey);
     }
-    else
-        ret = WH_SHE_ERC_KEY_NOT_AVAILABLE;
+    return ret;
+}
+
+/* Check M3 over an update set using K2, decrypt M2 in place using K1 and
+ * check that the target slot accepts the update.  On success meta describes
+ * the new key, which follows the counter block in M2 */
+static int hsmSheLoadKeyVerify(whServerContext* server,
+    wh_Packet_she_load_key_req* req, const uint8_t* k1, const uint8_t* k2,
+    whNvmMetadata* meta)
+{
+    int ret;
+    int keyRet = 0;
+    uint32_t field = AES_BLOCK_SIZE;
+    uint8_t cmacOutput[AES_BLOCK_SIZE];
+    whServerSheSlot* slot;
     /* cmac messageOne and messageTwo using K2 as the cmac key */
-    if (ret == 0) {
-        field = AES_BLOCK_SIZE;
-        ret = wc_AesCmacGenerate_ex(sheCmac, cmacOutput, &field,
-            (uint8_t*)&packet->sheLoadKeyReq,
-            sizeof(packet->sheLoadKeyReq.messageOne) +
-            sizeof(packet->sheLoadKeyReq.messageTwo), tmpKey,
-            WOLFHSM_SHE_KEY_SZ, NULL, server->crypto->devId);
-    }
+    ret = wc_AesCmacGenerate_ex(sheCmac, cmacOutput, &field, (uint8_t*)req,
+        sizeof(req->messageOne) + sizeof(req->messageTwo), k2,
+        WOLFHSM_SHE_KEY_SZ, NULL, server->crypto->devId);
     /* compare digest to M3 */
-    if (ret == 0 && XMEMCMP(packet->sheLoadKeyReq.messageThree,
-        cmacOutput, field) != 0) {
+    if (ret == 0 && XMEMCMP(req->messageThree, cmacOutput, field) != 0)
         ret = WH_SHE_ERC_KEY_UPDATE_ERROR;
-    }
-    /* make K1 using AES-MP(authKey | WOLFHSM_SHE_KEY_UPDATE_ENC_C) */
-    if (ret == 0) {
-        /* add WOLFHSM_SHE_KEY_UPDATE_ENC_C to the input */
-        XMEMCPY(kdfInput + keySz, WOLFHSM_SHE_KEY_UPDATE_ENC_C,
-            sizeof(WOLFHSM_SHE_KEY_UPDATE_ENC_C));
-        /* do kdf */
-        ret = wh_AesMp16(server, kdfInput,
-            keySz + sizeof(WOLFHSM_SHE_KEY_UPDATE_ENC_C), tmpKey);
-    }
     /* decrypt messageTwo */
     if (ret == 0)
         ret = wc_AesInit(sheAes, NULL, server->crypto->devId);
     if (ret == 0) {
-        ret = wc_AesSetKey(sheAes, tmpKey, WOLFHSM_SHE_KEY_SZ,
-            NULL, AES_DECRYPTION);
+        ret = wc_AesSetKey(sheAes, k1, WOLFHSM_SHE_KEY_SZ, NULL,
+            AES_DECRYPTION);
     }
     if (ret == 0) {
-        ret = wc_AesCbcDecrypt(sheAes,
-            packet->sheLoadKeyReq.messageTwo,
-            packet->sheLoadKeyReq.messageTwo,
-            sizeof(packet->sheLoadKeyReq.messageTwo));
+        ret = wc_AesCbcDecrypt(sheAes, req->messageTwo, req->messageTwo,
+            sizeof(req->messageTwo));
     }
     /* free aes for protection */
     wc_AesFree(sheAes);
     /* load the target key */
     if (ret == 0) {
-        ret = hsmReadKey(server, MAKE_WOLFHSM_KEYID(WOLFHSM_KEYTYPE_SHE,
-            server->comm->client_id,
-            hsmShePopId(packet->sheLoadKeyReq.messageOne)), meta, kdfInput,
-            &keySz);
+        ret = hsmSheGetSlot(server, hsmShePopId(req->messageOne), &slot);
+        /* work on a copy of the metadata, the slot may be reloaded */
+        if (ret == 0)
+            XMEMCPY((uint8_t*)meta, (uint8_t*)slot->meta, sizeof(*meta));
+        else
+            XMEMSET((uint8_t*)meta, 0, sizeof(*meta));
         /* if the keyslot is empty or write protection is not on continue */
         if (ret == WH_ERROR_NOTFOUND ||
             (((whSheMetadata*)meta->label)->flags &
@@ -409,8 +455,7 @@ static int hsmSheLoadKey(whServerContext* server, whPacket* packet,
             ret = WH_SHE_ERC_WRITE_PROTECTED;
     }
     /* check UID == 0 */
-    if (ret == 0 && XMEMEQZERO(packet->sheLoadKeyReq.messageOne,
-        WOLFHSM_SHE_UID_SZ) == 1) {
+    if (ret == 0 && XMEMEQZERO(req->messageOne, WOLFHSM_SHE_UID_SZ) == 1) {
         /* check wildcard */
         if ((((whSheMetadata*)meta->label)->flags & WOLFHSM_SHE_FLAG_WILDCARD)
             == 0) {
@@ -418,96 +463,112 @@ static int hsmSheLoadKey(whServerContext* server, whPacket* packet,
         }
     }
     /* compare to UID */
-    else if (ret == 0 && XMEMCMP(packet->sheLoadKeyReq.messageOne,
-        server->she->uid, sizeof(server->she->uid)) != 0) {
+    else if (ret == 0 && XMEMCMP(req->messageOne, server->she->uid,
+        sizeof(server->she->uid)) != 0) {
         ret = WH_SHE_ERC_KEY_UPDATE_ERROR;
     }
     /* verify counter is greater than stored value */
     if (ret == 0 &&
         keyRet != WH_ERROR_NOTFOUND &&
-        ntohl(*((uint32_t*)packet->sheLoadKeyReq.messageTwo) >> 4) <=
+        ntohl(*((uint32_t*)req->messageTwo) >> 4) <=
         ntohl(((whSheMetadata*)meta->label)->count)) {
         ret = WH_SHE_ERC_KEY_UPDATE_ERROR;
     }
-    /* write key with counter */
+    /* describe the key to write with its counter */
     if (ret == 0) {
         meta->id = MAKE_WOLFHSM_KEYID(WOLFHSM_KEYTYPE_SHE,
-            server->comm->client_id,
-            hsmShePopId(packet->sheLoadKeyReq.messageOne));
+            server->comm->client_id, hsmShePopId(req->messageOne));
         ((whSheMetadata*)meta->label)->flags =
-            hsmShePopFlags(packet->sheLoadKeyReq.messageTwo);
+            hsmShePopFlags(req->messageTwo);
         ((whSheMetadata*)meta->label)->count =
-            (*(uint32_t*)packet->sheLoadKeyReq.messageTwo >> 4);
+            (*(uint32_t*)req->messageTwo >> 4);
         meta->len = WOLFHSM_SHE_KEY_SZ;
-        /* cache if ram key, overwrite otherwise */
-        if ((meta->id & WOLFHSM_KEYID_MASK) == WOLFHSM_SHE_RAM_KEY_ID) {
-            ret = hsmCacheKey(server, meta, packet->sheLoadKeyReq.messageTwo
-                + WOLFHSM_SHE_KEY_SZ);
-        }
-        else {
-            ret = wh_Nvm_AddObject(server->nvm, meta, meta->len,
-                packet->sheLoadKeyReq.messageTwo + WOLFHSM_SHE_KEY_SZ);
-            /* read the evicted back from nvm */
-            if (ret == 0) {
-                keySz = WOLFHSM_SHE_KEY_SZ;
-                ret = hsmReadKey(server, meta->id, meta,
-                    packet->sheLoadKeyReq.messageTwo + WOLFHSM_SHE_KEY_SZ,
-                    &keySz);
-            }
-        }
-        if (ret != 0)
-            ret = WH_SHE_ERC_KEY_UPDATE_ERROR;
-    }
-    /* generate K3 using the updated key */
-    if (ret == 0) {
-        /* copy new key to kdfInput */
-        XMEMCPY(kdfInput, packet->sheLoadKeyReq.messageTwo +
-            WOLFHSM_SHE_KEY_SZ, WOLFHSM_SHE_KEY_SZ);
-        /* add WOLFHSM_SHE_KEY_UPDATE_ENC_C to the input */
-        XMEMCPY(kdfInput + meta->len, WOLFHSM_SHE_KEY_UPDATE_ENC_C,
-            sizeof(WOLFHSM_SHE_KEY_UPDATE_ENC_C));
-        /* do kdf */
-        ret = wh_AesMp16(server, kdfInput,
-            meta->len + sizeof(WOLFHSM_SHE_KEY_UPDATE_ENC_C), tmpKey);
     }
+    return ret;
+}
+
+/* Build M4 and M5 confirming an applied update.  res may overlay the request
+ * the other arguments point into, so the new key is consumed before any of
+ * res is written.  counterBlock is the decrypted first block of M2 */
+static int hsmSheLoadKeyRespond(whServerContext* server, uint8_t idByte,
+    uint8_t* counterBlock, const uint8_t* newKey, uint32_t count,
+    wh_Packet_she_load_key_res* res)
+{
+    int ret;
+    uint32_t field;
+    uint8_t k3[WOLFHSM_SHE_KEY_SZ];
+    uint8_t k4[WOLFHSM_SHE_KEY_SZ];
+    /* generate K3 and K4 using the updated key */
+    ret = hsmSheDeriveUpdateKeys(server, newKey, k3, k4);
     if (ret == 0)
         ret = wc_AesInit(sheAes, NULL, server->crypto->devId);
     if (ret == 0) {
-        ret = wc_AesSetKey(sheAes, tmpKey, WOLFHSM_SHE_KEY_SZ,
+        ret = wc_AesSetKey(sheAes, k3, WOLFHSM_SHE_KEY_SZ,
             NULL, AES_ENCRYPTION);
     }
     if (ret == 0) {
-        /* reset messageTwo with the nvm read counter, pad with a 1 bit */
-        *(uint32_t*)packet->sheLoadKeyReq.messageTwo =
-            (((whSheMetadata*)meta->label)->count << 4);
-        packet->sheLoadKeyReq.messageTwo[3] |= 0x08;
+        /* reset the counter block with the nvm counter, pad with a 1 bit */
+        *(uint32_t*)counterBlock = (count << 4);
+        counterBlock[3] |= 0x08;
         /* encrypt the new counter */
         ret = wc_AesEncryptDirect(sheAes,
-            packet->sheLoadKeyRes.messageFour + WOLFHSM_SHE_KEY_SZ,
-            packet->sheLoadKeyReq.messageTwo);
+            res->messageFour + WOLFHSM_SHE_KEY_SZ, counterBlock);
     }
     /* free aes for protection */
     wc_AesFree(sheAes);
-    /* generate K4 using the updated key */
     if (ret == 0) {
-        /* set our UID, ID and AUTHID are already set from messageOne */
-        XMEMCPY(packet->sheLoadKeyRes.messageFour, server->she->uid,
+        /* set our UID followed by the ID and AUTHID from messageOne */
+        XMEMCPY(res->messageFour, server->she->uid,
             sizeof(server->she->uid));
-        /* add WOLFHSM_SHE_KEY_UPDATE_MAC_C to the input */
-        XMEMCPY(kdfInput + meta->len, WOLFHSM_SHE_KEY_UPDATE_MAC_C,
-            sizeof(WOLFHSM_SHE_KEY_UPDATE_MAC_C));
-        /* do kdf */
-        ret = wh_AesMp16(server, kdfInput,
-            meta->len + sizeof(WOLFHSM_SHE_KEY_UPDATE_MAC_C), tmpKey);
-    }
-    /* cmac messageFour using K4 as the cmac key */
-    if (ret == 0) {
+        res->messageFour[WOLFHSM_SHE_M1_SZ - 1] = idByte;
+        /* cmac messageFour using K4 as the cmac key */
         field = AES_BLOCK_SIZE;
-        ret = wc_AesCmacGenerate_ex(sheCmac, packet->sheLoadKeyRes.messageFive,
-            &field, packet->sheLoadKeyRes.messageFour,
-            sizeof(packet->sheLoadKeyRes.messageFour), tmpKey,
+        ret = wc_AesCmacGenerate_ex(sheCmac, res->messageFive, &field,
+            res->messageFour, sizeof(res->messageFour), k4,
             WOLFHSM_SHE_KEY_SZ, NULL, server->crypto->devId);
     }
+    return ret;
+}
+
+static int hsmSheLoadKey(whServerContext* server, whPacket* packet,
+    uint16_t* size)
+{
+    int ret;
+    uint8_t k1[WOLFHSM_SHE_KEY_SZ];
+    uint8_t k2[WOLFHSM_SHE_KEY_SZ];
+    whNvmMetadata meta[1];
+    whServerSheSlot* slot;
+    wh_Packet_she_load_key_req* req = &packet->sheLoadKeyReq;
+    /* read the auth key by AuthID and derive K1 and K2 from it */
+    ret = hsmSheGetSlot(server, hsmShePopAuthId(req->messageOne), &slot);
+    if (ret == 0)
+        ret = hsmSheDeriveUpdateKeys(server, slot->key, k1, k2);
+    else
+        ret = WH_SHE_ERC_KEY_NOT_AVAILABLE;
+    if (ret == 0)
+        ret = hsmSheLoadKeyVerify(server, req, k1, k2, meta);
+    /* write key with counter */
+    if (ret == 0) {
+        /* cache if ram key, overwrite otherwise */
+        if ((meta->id & WOLFHSM_KEYID_MASK) == WOLFHSM_SHE_RAM_KEY_ID) {
+            ret = hsmCacheKey(server, meta,
+                req->messageTwo + WOLFHSM_SHE_KEY_SZ);
+        }
+        else {
+            /* drop any cached copy so reads see the new key */
+            (void)hsmEvictKey(server, meta->id);
+            ret = wh_Server_NvmAddObject(server, meta, meta->len,
+                req->messageTwo + WOLFHSM_SHE_KEY_SZ);
+        }
+        if (ret != 0)
+            ret = WH_SHE_ERC_KEY_UPDATE_ERROR;
+    }
+    if (ret == 0) {
+        ret = hsmSheLoadKeyRespond(server,
+            req->messageOne[WOLFHSM_SHE_M1_SZ - 1], req->messageTwo,
+            req->messageTwo + WOLFHSM_SHE_KEY_SZ,
+            ((whSheMetadata*)meta->label)->count, &packet->sheLoadKeyRes);
+    }
     if (ret == 0) {
         *size = WOLFHSM_PACKET_STUB_SIZE + sizeof(packet->sheLoadKeyRes);
         /* mark if the ram key was loaded */
@@ -517,6 +578,116 @@ static int hsmSheLoadKey(whServerContext* server, whPacket* packet,
     return ret;
 }
 
+/* Apply several update sets at once.  Every set is verified before any key
+ * is written, K1 and K2 are derived once per auth key, and all of the NVM
+ * keys are committed with wh_Nvm_AddObjects.  That is all or nothing on NVM
+ * backends with an AddObjects callback, such as NVM flash.  On others a
+ * failure part way through may leave earlier sets applied even though the
+ * whole batch reports KEY_UPDATE_ERROR.  A slot may only be the target of
+ * one set per batch, and can't authenticate a later set once it has been
+ * updated, since the sets would otherwise depend on each other */
+static int hsmSheLoadKeyBatch(whServerContext* server, whPacket* packet,
+    uint16_t* size)
+{
+    int ret = 0;
+    int ramIndex = -1;
+    uint32_t i;
+    uint32_t count;
+    uint16_t authId;
+    uint16_t id;
+    uint16_t derived = 0;
+    uint16_t updated = 0;
+    whNvmId nvmCount = 0;
+    uint8_t k1[WOLFHSM_SHE_NUM_SLOTS][WOLFHSM_SHE_KEY_SZ];
+    uint8_t k2[WOLFHSM_SHE_NUM_SLOTS][WOLFHSM_SHE_KEY_SZ];
+    uint8_t m2[WOLFHSM_SHE_M2_SZ];
+    uint8_t idByte;
+    whNvmMetadata metas[WOLFHSM_SHE_LOAD_KEY_BATCH_MAX];
+    whNvmMetadata nvmMetas[WOLFHSM_SHE_LOAD_KEY_BATCH_MAX];
+    const uint8_t* nvmDatas[WOLFHSM_SHE_LOAD_KEY_BATCH_MAX];
+    whServerSheSlot* slot;
+    wh_Packet_she_load_key_req* req;
+    wh_Packet_she_load_key_res* res;
+    /* the update sets are after the fixed fields, the responses overlay
+     * them and are smaller, so set i is consumed before res i is written */
+    req = (wh_Packet_she_load_key_req*)(&packet->sheLoadKeyBatchReq + 1);
+    res = (wh_Packet_she_load_key_res*)(&packet->sheLoadKeyBatchRes + 1);
+    count = packet->sheLoadKeyBatchReq.count;
+    if (count == 0 || count > WOLFHSM_SHE_LOAD_KEY_BATCH_MAX ||
+        *size < WOLFHSM_PACKET_STUB_SIZE +
+        sizeof(packet->sheLoadKeyBatchReq) + count * sizeof(*req)) {
+        ret = WH_ERROR_BADARGS;
+    }
+    /* verify every set before touching the keystore */
+    for (i = 0; ret == 0 && i < count; i++) {
+        authId = hsmShePopAuthId(req[i].messageOne);
+        id = hsmShePopId(req[i].messageOne);
+        if ((updated & ((1 << id) | (1 << authId))) != 0) {
+            ret = WH_SHE_ERC_KEY_UPDATE_ERROR;
+            break;
+        }
+        /* derive K1 and K2 once per auth key */
+        if ((derived & (1 << authId)) == 0) {
+            ret = hsmSheGetSlot(server, authId, &slot);
+            if (ret == 0)
+                ret = hsmSheDeriveUpdateKeys(server, slot->key, k1[authId],
+                    k2[authId]);
+            else
+                ret = WH_SHE_ERC_KEY_NOT_AVAILABLE;
+            if (ret == 0)
+                derived |= (1 << authId);
+        }
+        if (ret == 0) {
+            ret = hsmSheLoadKeyVerify(server, &req[i], k1[authId],
+                k2[authId], &metas[i]);
+        }
+        if (ret == 0) {
+            updated |= (1 << id);
+            if (id == WOLFHSM_SHE_RAM_KEY_ID)
+                ramIndex = (int)i;
+            else {
+                nvmMetas[nvmCount] = metas[i];
+                nvmDatas[nvmCount] = req[i].messageTwo + WOLFHSM_SHE_KEY_SZ;
+                nvmCount++;
+            }
+        }
+    }
+    /* commit the nvm keys together, then cache the ram key */
+    if (ret == 0 && nvmCount > 0) {
+        for (i = 0; i < nvmCount; i++)
+            (void)hsmEvictKey(server, nvmMetas[i].id);
+        ret = wh_Nvm_AddObjects(server->nvm, nvmCount, nvmMetas, nvmDatas);
+        if (ret != 0)
+            ret = WH_SHE_ERC_KEY_UPDATE_ERROR;
+    }
+    if (ret == 0 && ramIndex >= 0) {
+        ret = hsmCacheKey(server, &metas[ramIndex],
+            req[ramIndex].messageTwo + WOLFHSM_SHE_KEY_SZ);
+        if (ret != 0)
+            ret = WH_SHE_ERC_KEY_UPDATE_ERROR;
+    }
+    /* build M4 and M5 for each set in order */
+    for (i = 0; ret == 0 && i < count; i++) {
+        idByte = req[i].messageOne[WOLFHSM_SHE_M1_SZ - 1];
+        XMEMCPY(m2, req[i].messageTwo, sizeof(m2));
+        ret = hsmSheLoadKeyRespond(server, idByte, m2,
+            m2 + WOLFHSM_SHE_KEY_SZ,
+            ((whSheMetadata*)metas[i].label)->count, &res[i]);
+    }
+    if (ret == 0) {
+        packet->sheLoadKeyBatchRes.count = count;
+        *size = WOLFHSM_PACKET_STUB_SIZE +
+            sizeof(packet->sheLoadKeyBatchRes) + count * sizeof(*res);
+        /* mark if the ram key was loaded */
+        if (ramIndex >= 0)
+            server->she->ramKeyPlain = 1;
+    }
+    XMEMSET(m2, 0, sizeof(m2));
+    XMEMSET(k1, 0, sizeof(k1));
+    XMEMSET(k2, 0, sizeof(k2));
+    return ret;
+}
+
 static int hsmSheLoadPlainKey(whServerContext* server, whPacket* packet,
     uint16_t* size)
 {
@@ -543,17 +714,17 @@ static int hsmSheExportRamKey(whServerContext* server, whPacket* packet,
     uint8_t kdfInput[WOLFHSM_SHE_KEY_SZ * 2];
     uint8_t cmacOutput[AES_BLOCK_SIZE];
     uint8_t tmpKey[WOLFHSM_SHE_KEY_SZ];
-    whNvmMetadata meta[1];
+    whServerSheSlot* slot;
     /* check if ram key was loaded by CMD_LOAD_PLAIN_KEY */
     if (server->she->ramKeyPlain == 0)
         ret = WH_SHE_ERC_KEY_INVALID;
     /* read the auth key by AuthID */
     if (ret == 0) {
         keySz = WOLFHSM_SHE_KEY_SZ;
-        ret = hsmReadKey(server, MAKE_WOLFHSM_KEYID(WOLFHSM_KEYTYPE_SHE,
-            server->comm->client_id, WOLFHSM_SHE_SECRET_KEY_ID), meta,
-            kdfInput, &keySz);
-        if (ret != 0)
+        ret = hsmSheGetSlot(server, WOLFHSM_SHE_SECRET_KEY_ID, &slot);
+        if (ret == 0)
+            XMEMCPY(kdfInput, slot->key, keySz);
+        else
             ret = WH_SHE_ERC_KEY_NOT_AVAILABLE;
     }
     if (ret == 0) {
@@ -563,11 +734,11 @@ static int hsmSheExportRamKey(whServerContext* server, whPacket* packet,
         packet->sheExportRamKeyRes.messageOne[15] =
             ((WOLFHSM_SHE_RAM_KEY_ID << 4) | (WOLFHSM_SHE_SECRET_KEY_ID));
         /* add WOLFHSM_SHE_KEY_UPDATE_ENC_C to the input */
-        XMEMCPY(kdfInput + meta->len, WOLFHSM_SHE_KEY_UPDATE_ENC_C,
+        XMEMCPY(kdfInput + keySz, WOLFHSM_SHE_KEY_UPDATE_ENC_C,
             sizeof(WOLFHSM_SHE_KEY_UPDATE_ENC_C));
         /* generate K1 */
         ret = wh_AesMp16(server, kdfInput,
-            meta->len + sizeof(WOLFHSM_SHE_KEY_UPDATE_ENC_C), tmpKey);
+            keySz + sizeof(WOLFHSM_SHE_KEY_UPDATE_ENC_C), tmpKey);
     }
     /* build cleartext M2 */
     if (ret == 0) {
@@ -577,12 +748,12 @@ static int hsmSheExportRamKey(whServerContext* server, whPacket* packet,
         /* set count to 1 */
         *((uint32_t*)packet->sheExportRamKeyRes.messageTwo) =
             (htonl(1) << 4);
-        keySz = WOLFHSM_SHE_KEY_SZ;
-        ret = hsmReadKey(server, MAKE_WOLFHSM_KEYID(WOLFHSM_KEYTYPE_SHE,
-            server->comm->client_id, WOLFHSM_SHE_RAM_KEY_ID), meta,
-            packet->sheExportRamKeyRes.messageTwo + WOLFHSM_SHE_KEY_SZ,
-            &keySz);
-        if (ret != 0)
+        ret = hsmSheGetSlot(server, WOLFHSM_SHE_RAM_KEY_ID, &slot);
+        if (ret == 0) {
+            XMEMCPY(packet->sheExportRamKeyRes.messageTwo + WOLFHSM_SHE_KEY_SZ,
+                slot->key, WOLFHSM_SHE_KEY_SZ);
+        }
+        else
             ret = WH_SHE_ERC_KEY_NOT_AVAILABLE;
     }
     /* encrypt M2 with K1 */
@@ -606,11 +777,11 @@ static int hsmSheExportRamKey(whServerContext* server, whPacket* packet,
     wc_AesFree(sheAes);
     if (ret == 0) {
         /* add WOLFHSM_SHE_KEY_UPDATE_MAC_C to the input */
-        XMEMCPY(kdfInput + meta->len, WOLFHSM_SHE_KEY_UPDATE_MAC_C,
+        XMEMCPY(kdfInput + keySz, WOLFHSM_SHE_KEY_UPDATE_MAC_C,
             sizeof(WOLFHSM_SHE_KEY_UPDATE_MAC_C));
         /* generate K2 */
         ret = wh_AesMp16(server, kdfInput,
-            meta->len + sizeof(WOLFHSM_SHE_KEY_UPDATE_MAC_C), tmpKey);
+            keySz + sizeof(WOLFHSM_SHE_KEY_UPDATE_MAC_C), tmpKey);
     }
     /* cmac messageOne and messageTwo using K2 as the cmac key */
     if (ret == 0) {
@@ -685,21 +856,20 @@ static int hsmSheInitRnd(whServerContext* server, whPacket* packet,
     uint16_t* size)
 {
     int ret = 0;
-    uint32_t keySz;
     uint8_t kdfInput[WOLFHSM_SHE_KEY_SZ * 2];
     uint8_t cmacOutput[AES_BLOCK_SIZE];
     uint8_t tmpKey[WOLFHSM_SHE_KEY_SZ];
     whNvmMetadata meta[1];
+    whServerSheSlot* slot;
     /* check that init hasn't already been called since startup */
     if (server->she->rndInited == 1)
         ret = WH_SHE_ERC_SEQUENCE_ERROR;
     /* read secret key */
     if (ret == 0) {
-        keySz = WOLFHSM_SHE_KEY_SZ;
-        ret = hsmReadKey(server, MAKE_WOLFHSM_KEYID(WOLFHSM_KEYTYPE_SHE,
-            server->comm->client_id, WOLFHSM_SHE_SECRET_KEY_ID), meta,
-            kdfInput, &keySz);
-        if (ret != 0)
+        ret = hsmSheGetSlot(server, WOLFHSM_SHE_SECRET_KEY_ID, &slot);
+        if (ret == 0)
+            XMEMCPY(kdfInput, slot->key, WOLFHSM_SHE_KEY_SZ);
+        else
             ret = WH_SHE_ERC_KEY_NOT_AVAILABLE;
     }
     if (ret == 0) {
@@ -712,11 +882,12 @@ static int hsmSheInitRnd(whServerContext* server, whPacket* packet,
     }
     /* read the current PRNG_SEED, i - 1, to cmacOutput */
     if (ret == 0) {
-        keySz = WOLFHSM_SHE_KEY_SZ;
-        ret = hsmReadKey(server, MAKE_WOLFHSM_KEYID(WOLFHSM_KEYTYPE_SHE,
-            server->comm->client_id, WOLFHSM_SHE_PRNG_SEED_ID), meta,
-            cmacOutput, &keySz);
-        if (ret != 0)
+        ret = hsmSheGetSlot(server, WOLFHSM_SHE_PRNG_SEED_ID, &slot);
+        if (ret == 0) {
+            XMEMCPY((uint8_t*)meta, (uint8_t*)slot->meta, sizeof(meta));
+            XMEMCPY(cmacOutput, slot->key, WOLFHSM_SHE_KEY_SZ);
+        }
+        else
             ret = WH_SHE_ERC_KEY_NOT_AVAILABLE;
     }
     /* set up aes */
@@ -738,7 +909,7 @@ static int hsmSheInitRnd(whServerContext* server, whPacket* packet,
         meta->id = MAKE_WOLFHSM_KEYID(WOLFHSM_KEYTYPE_SHE,
             server->comm->client_id, WOLFHSM_SHE_PRNG_SEED_ID);
         meta->len = WOLFHSM_SHE_KEY_SZ;
-        ret = wh_Nvm_AddObject(server->nvm, meta, meta->len, cmacOutput);
+        ret = wh_Server_NvmAddObject(server, meta, meta->len, cmacOutput);
         if (ret != 0)
             ret = WH_SHE_ERC_KEY_UPDATE_ERROR;
     }
@@ -797,9 +968,9 @@ static int hsmSheExtendSeed(whServerContext* server, whPacket* packet,
     uint16_t* size)
 {
     int ret = 0;
-    uint32_t keySz;
     uint8_t kdfInput[WOLFHSM_SHE_KEY_SZ * 2];
     whNvmMetadata meta[1];
+    whServerSheSlot* slot;
     /* check that rng has been inited */
     if (server->she->rndInited == 0)
         ret = WH_SHE_ERC_RNG_SEED;
@@ -817,11 +988,12 @@ static int hsmSheExtendSeed(whServerContext* server, whPacket* packet,
     }
     /* read the PRNG_SEED into kdfInput */
     if (ret == 0) {
-        keySz = WOLFHSM_SHE_KEY_SZ;
-        ret = hsmReadKey(server, MAKE_WOLFHSM_KEYID(WOLFHSM_KEYTYPE_SHE,
-            server->comm->client_id, WOLFHSM_SHE_PRNG_SEED_ID), meta,
-            kdfInput, &keySz);
-        if (ret != 0)
+        ret = hsmSheGetSlot(server, WOLFHSM_SHE_PRNG_SEED_ID, &slot);
+        if (ret == 0) {
+            XMEMCPY((uint8_t*)meta, (uint8_t*)slot->meta, sizeof(meta));
+            XMEMCPY(kdfInput, slot->key, WOLFHSM_SHE_KEY_SZ);
+        }
+        else
             ret = WH_SHE_ERC_KEY_NOT_AVAILABLE;
     }
     if (ret == 0) {
@@ -835,7 +1007,7 @@ static int hsmSheExtendSeed(whServerContext* server, whPacket* packet,
         meta->id = MAKE_WOLFHSM_KEYID(WOLFHSM_KEYTYPE_SHE,
             server->comm->client_id, WOLFHSM_SHE_PRNG_SEED_ID);
         meta->len = WOLFHSM_SHE_KEY_SZ;
-        ret = wh_Nvm_AddObject(server->nvm, meta, meta->len, kdfInput);
+        ret = wh_Server_NvmAddObject(server, meta, meta->len, kdfInput);
         if (ret != 0)
             ret = WH_SHE_ERC_KEY_UPDATE_ERROR;
     }
@@ -855,7 +1027,7 @@ static int hsmSheEncEcb(whServerContext* server, whPacket* packet,
     uint32_t keySz;
     uint8_t* in;
     uint8_t* out;
-    uint8_t tmpKey[WOLFHSM_SHE_KEY_SZ];
+    whServerSheSlot* slot;
     /* in and out are after the fixed sized fields */
     in = (uint8_t*)(&packet->sheEncEcbReq + 1);
     out = (uint8_t*)(&packet->sheEncEcbRes + 1);
@@ -864,15 +1036,13 @@ static int hsmSheEncEcb(whServerContext* server, whPacket* packet,
     field = packet->sheEncEcbReq.sz;
     /* only process a multiple of block size */
     field -= (field % AES_BLOCK_SIZE);
-    ret = hsmReadKey(server, MAKE_WOLFHSM_KEYID(WOLFHSM_KEYTYPE_SHE,
-        server->comm->client_id, packet->sheEncEcbReq.keyId), NULL,
-        tmpKey, &keySz);
+    ret = hsmSheGetSlot(server, packet->sheEncEcbReq.keyId, &slot);
     if (ret == 0)
         ret = wc_AesInit(sheAes, NULL, server->crypto->devId);
     else
         ret = WH_SHE_ERC_KEY_NOT_AVAILABLE;
     if (ret == 0)
-        ret = wc_AesSetKey(sheAes, tmpKey, keySz, NULL, AES_ENCRYPTION);
+        ret = wc_AesSetKey(sheAes, slot->key, keySz, NULL, AES_ENCRYPTION);
     if (ret == 0)
         ret = wc_AesEcbEncrypt(sheAes, out, in, field);
     /* free aes for protection */
@@ -892,7 +1062,7 @@ static int hsmSheEncCbc(whServerContext* server, whPacket* packet,
     uint32_t keySz;
     uint8_t* in;
     uint8_t* out;
-    uint8_t tmpKey[WOLFHSM_SHE_KEY_SZ];
+    whServerSheSlot* slot;
     /* in and out are after the fixed sized fields */
     in = (uint8_t*)(&packet->sheEncCbcReq + 1);
     out = (uint8_t*)(&packet->sheEncCbcRes + 1);
@@ -901,15 +1071,13 @@ static int hsmSheEncCbc(whServerContext* server, whPacket* packet,
     field = packet->sheEncCbcReq.sz;
     /* only process a multiple of block size */
     field -= (field % AES_BLOCK_SIZE);
-    ret = hsmReadKey(server, MAKE_WOLFHSM_KEYID(WOLFHSM_KEYTYPE_SHE,
-        server->comm->client_id, packet->sheEncCbcReq.keyId), NULL,
-        tmpKey, &keySz);
+    ret = hsmSheGetSlot(server, packet->sheEncCbcReq.keyId, &slot);
     if (ret == 0)
         ret = wc_AesInit(sheAes, NULL, server->crypto->devId);
     else
         ret = WH_SHE_ERC_KEY_NOT_AVAILABLE;
     if (ret == 0) {
-        ret = wc_AesSetKey(sheAes, tmpKey, keySz, packet->sheEncCbcReq.iv,
+        ret = wc_AesSetKey(sheAes, slot->key, keySz, packet->sheEncCbcReq.iv,
             AES_ENCRYPTION);
     }
     if (ret == 0)
@@ -931,7 +1099,7 @@ static int hsmSheDecEcb(whServerContext* server, whPacket* packet,
     uint32_t keySz;
     uint8_t* in;
     uint8_t* out;
-    uint8_t tmpKey[WOLFHSM_SHE_KEY_SZ];
+    whServerSheSlot* slot;
     /* in and out are after the fixed sized fields */
     in = (uint8_t*)(&packet->sheDecEcbReq + 1);
     out = (uint8_t*)(&packet->sheDecEcbRes + 1);
@@ -940,15 +1108,13 @@ static int hsmSheDecEcb(whServerContext* server, whPacket* packet,
     field = packet->sheDecEcbReq.sz;
     /* only process a multiple of block size */
     field -= (field % AES_BLOCK_SIZE);
-    ret = hsmReadKey(server, MAKE_WOLFHSM_KEYID(WOLFHSM_KEYTYPE_SHE,
-        server->comm->client_id, packet->sheDecEcbReq.keyId), NULL,
-        tmpKey, &keySz);
+    ret = hsmSheGetSlot(server, packet->sheDecEcbReq.keyId, &slot);
     if (ret == 0)
         ret = wc_AesInit(sheAes, NULL, server->crypto->devId);
     else
         ret = WH_SHE_ERC_KEY_NOT_AVAILABLE;
     if (ret == 0)
-        ret = wc_AesSetKey(sheAes, tmpKey, keySz, NULL, AES_DECRYPTION);
+        ret = wc_AesSetKey(sheAes, slot->key, keySz, NULL, AES_DECRYPTION);
     if (ret == 0)
         ret = wc_AesEcbDecrypt(sheAes, out, in, field);
     /* free aes for protection */
@@ -968,7 +1134,7 @@ static int hsmSheDecCbc(whServerContext* server, whPacket* packet,
     uint32_t keySz;
     uint8_t* in;
     uint8_t* out;
-    uint8_t tmpKey[WOLFHSM_SHE_KEY_SZ];
+    whServerSheSlot* slot;
     /* in and out are after the fixed sized fields */
     in = (uint8_t*)(&packet->sheDecCbcReq + 1);
     out = (uint8_t*)(&packet->sheDecCbcRes + 1);
@@ -977,15 +1143,13 @@ static int hsmSheDecCbc(whServerContext* server, whPacket* packet,
     field = packet->sheDecCbcReq.sz;
     /* only process a multiple of block size */
     field -= (field % AES_BLOCK_SIZE);
-    ret = hsmReadKey(server, MAKE_WOLFHSM_KEYID(WOLFHSM_KEYTYPE_SHE,
-        server->comm->client_id, packet->sheDecCbcReq.keyId), NULL,
-        tmpKey, &keySz);
+    ret = hsmSheGetSlot(server, packet->sheDecCbcReq.keyId, &slot);
     if (ret == 0)
         ret = wc_AesInit(sheAes, NULL, server->crypto->devId);
     else
         ret = WH_SHE_ERC_KEY_NOT_AVAILABLE;
     if (ret == 0) {
-        ret = wc_AesSetKey(sheAes, tmpKey, keySz, packet->sheDecCbcReq.iv,
+        ret = wc_AesSetKey(sheAes, slot->key, keySz, packet->sheDecCbcReq.iv,
             AES_DECRYPTION);
     }
     if (ret == 0)
@@ -1004,20 +1168,16 @@ static int hsmSheGenerateMac(whServerContext* server, whPacket* packet,
 {
     int ret;
     uint32_t field = AES_BLOCK_SIZE;
-    uint32_t keySz;
     uint8_t* in;
-    uint8_t tmpKey[WOLFHSM_SHE_KEY_SZ];
+    whServerSheSlot* slot;
     /* in and out are after the fixed sized fields */
     in = (uint8_t*)(&packet->sheGenMacReq + 1);
     /* load the key */
-    keySz = WOLFHSM_SHE_KEY_SZ;
-    ret = hsmReadKey(server, MAKE_WOLFHSM_KEYID(WOLFHSM_KEYTYPE_SHE,
-        server->comm->client_id, packet->sheGenMacReq.keyId), NULL, tmpKey,
-        &keySz);
+    ret = hsmSheGetSlot(server, packet->sheGenMacReq.keyId, &slot);
     /* hash the message */
     if (ret == 0) {
         ret = wc_AesCmacGenerate_ex(sheCmac, packet->sheGenMacRes.mac, &field,
-            in, packet->sheGenMacReq.sz, tmpKey, WOLFHSM_SHE_KEY_SZ, NULL,
+            in, packet->sheGenMacReq.sz, slot->key, WOLFHSM_SHE_KEY_SZ, NULL,
             server->crypto->devId);
     }
     else
@@ -1034,20 +1194,18 @@ static int hsmSheVerifyMac(whServerContext* server, whPacket* packet,
     uint32_t keySz;
     uint8_t* message;
     uint8_t* mac;
-    uint8_t tmpKey[WOLFHSM_SHE_KEY_SZ];
+    whServerSheSlot* slot;
     /* in and mac are after the fixed sized fields */
     message = (uint8_t*)(&packet->sheVerifyMacReq + 1);
     mac = message + packet->sheVerifyMacReq.messageLen;
     /* load the key */
     keySz = WOLFHSM_SHE_KEY_SZ;
-    ret = hsmReadKey(server, MAKE_WOLFHSM_KEYID(WOLFHSM_KEYTYPE_SHE,
-        server->comm->client_id, packet->sheVerifyMacReq.keyId), NULL, tmpKey,
-        &keySz);
+    ret = hsmSheGetSlot(server, packet->sheVerifyMacReq.keyId, &slot);
     /* verify the mac */
     if (ret == 0) {
         ret = wc_AesCmacVerify_ex(sheCmac, mac, packet->sheVerifyMacReq.macLen,
-            message, packet->sheVerifyMacReq.messageLen, tmpKey, keySz, NULL,
-            server->crypto->devId);
+            message, packet->sheVerifyMacReq.messageLen, slot->key, keySz,
+            NULL, server->crypto->devId);
         /* only evaluate if key was found */
         if (ret == 0)
             packet->sheVerifyMacRes.status = 0;
@@ -1136,6 +1294,9 @@ int wh_Server_HandleSheRequest(whServerContext* server,
     case WH_SHE_VERIFY_MAC:
         ret = hsmSheVerifyMac(server, packet, size);
         break;
+    case WH_SHE_LOAD_KEY_BATCH:
+        ret = hsmSheLoadKeyBatch(server, packet, size);
+        break;
     default:
         ret = WH_ERROR_BADARGS;
         break;
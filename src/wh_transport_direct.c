@@ -0,0 +1,218 @@
+/*
+ * Copyright (C) 2024 wolfSSL Inc.
+ *
+ * This file is part of wolfHSM.
+ *
+ * wolfHSM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfHSM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wolfHSM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * src/wh_transport_direct.c
+ *
+ * Implementation of transport callbacks using direct calls within one image
+ */
+
+#include <stddef.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "wolfhsm/wh_error.h"
+#include "wolfhsm/wh_comm.h"
+#include "wolfhsm/wh_transport_direct.h"
+
+int wh_TransportDirect_InitClient(void* c, const void* cf,
+        whCommSetConnectedCb connectcb, void* connectcb_arg)
+{
+    whTransportDirectContext* context = c;
+    const whTransportDirectConfig* config = cf;
+
+    (void)connectcb; (void)connectcb_arg; /* Not used */
+
+    if (    (context == NULL) ||
+            (config == NULL)) {
+        return WH_ERROR_BADARGS;
+    }
+
+    context->dispatch       = config->dispatch;
+    context->dispatch_arg   = config->dispatch_arg;
+    context->req            = NULL;
+    context->resp           = NULL;
+    context->req_len        = 0;
+    context->resp_len       = 0;
+    context->req_ready      = 0;
+    context->resp_ready     = 0;
+    context->client_initialized = 1;
+    return 0;
+}
+
+int wh_TransportDirect_InitServer(void* c, const void* cf,
+        whCommSetConnectedCb connectcb, void* connectcb_arg)
+{
+    whTransportDirectContext* context = c;
+
+    (void)cf; (void)connectcb; (void)connectcb_arg; /* Not used */
+
+    if (context == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+
+    /* Leave any client state alone, as either end may be initialized first */
+    context->server_initialized = 1;
+    return 0;
+}
+
+int wh_TransportDirect_CleanupClient(void* c)
+{
+    whTransportDirectContext* context = c;
+
+    if (context == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+
+    context->dispatch       = NULL;
+    context->dispatch_arg   = NULL;
+    context->req            = NULL;
+    context->resp           = NULL;
+    context->req_ready      = 0;
+    context->resp_ready     = 0;
+    context->client_initialized = 0;
+    return 0;
+}
+
+int wh_TransportDirect_CleanupServer(void* c)
+{
+    whTransportDirectContext* context = c;
+
+    if (context == NULL) {
+        return WH_ERROR_BADARGS;
+    }
+
+    context->server_initialized = 0;
+    return 0;
+}
+
+int wh_TransportDirect_SendRequest(void* c, uint16_t len, const void* data)
+{
+    whTransportDirectContext* context = c;
+
+    if (    (context == NULL) ||
+            (context->client_initialized == 0) ||
+            (data == NULL) ||
+            (len > WH_COMM_MTU)) {
+        return WH_ERROR_BADARGS;
+    }
+
+    /* Server has not picked up the previous request yet */
+    if (context->req_ready != 0) {
+        return WH_ERROR_NOTREADY;
+    }
+
+    /* The response is written back over the request in the client's packet,
+     * which the comm layer does not touch until Recv succeeds */
+    context->req        = data;
+    context->resp       = (void*)data;
+    context->req_len    = len;
+    context->resp_len   = 0;
+    context->resp_ready = 0;
+    context->req_ready  = 1;
+
+    /* Failures leave the request posted for Recv to dispatch again */
+    if (context->dispatch != NULL) {
+        (void)context->dispatch(context->dispatch_arg);
+    }
+    return 0;
+}
+
+int wh_TransportDirect_RecvRequest(void* c, uint16_t *out_len, void* data)
+{
+    whTransportDirectContext* context = c;
+
+    if (    (context == NULL) ||
+            (context->server_initialized == 0)) {
+        return WH_ERROR_BADARGS;
+    }
+
+    if (context->req_ready == 0) {
+        return WH_ERROR_NOTREADY;
+    }
+
+    if (    (data != NULL) &&
+            (data != context->req) &&
+            (context->req_len != 0)) {
+        memcpy(data, context->req, context->req_len);
+    }
+    if (out_len != NULL) {
+        *out_len = context->req_len;
+    }
+    context->req_ready = 0;
+
+    return 0;
+}
+
+int wh_TransportDirect_SendResponse(void* c, uint16_t len, const void* data)
+{
+    whTransportDirectContext* context = c;
+
+    if (    (context == NULL) ||
+            (context->server_initialized == 0) ||
+            (len > WH_COMM_MTU)) {
+        return WH_ERROR_BADARGS;
+    }
+
+    /* No client packet to respond into */
+    if (context->resp == NULL) {
+        return WH_ERROR_NOTREADY;
+    }
+
+    if (    (data != NULL) &&
+            (data != context->resp) &&
+            (len != 0)) {
+        memcpy(context->resp, data, len);
+    }
+    context->resp_len   = len;
+    context->resp_ready = 1;
+
+    return 0;
+}
+
+int wh_TransportDirect_RecvResponse(void* c, uint16_t *out_len, void* data)
+{
+    whTransportDirectContext* context = c;
+
+    if (    (context == NULL) ||
+            (context->client_initialized == 0)) {
+        return WH_ERROR_BADARGS;
+    }
+
+    /* Give the server another chance, such as to flush a deferred response */
+    if (    (context->resp_ready == 0) &&
+            (context->dispatch != NULL)) {
+        (void)context->dispatch(context->dispatch_arg);
+    }
+
+    if (context->resp_ready == 0) {
+        return WH_ERROR_NOTREADY;
+    }
+
+    if (    (data != NULL) &&
+            (data != context->resp) &&
+            (context->resp_len != 0)) {
+        memcpy(data, context->resp, context->resp_len);
+    }
+    if (out_len != NULL) {
+        *out_len = context->resp_len;
+    }
+    context->resp_ready = 0;
+
+    return 0;
+}
@@ -56,6 +56,16 @@ int wh_TransportMem_Init(void* c, const void* cf,
     context->resp_size  = config->resp_size;
     context->resp_data  = (void*)(context->resp + 1);
 
+    if ((config->bulk != NULL) && (config->bulk_size > 0)) {
+        context->bulk       = (uint8_t*)config->bulk;
+        context->bulk_size  = config->bulk_size;
+        context->bulk_slots = config->bulk_size /
+                WH_TRANSPORT_MEM_BULK_SLOT_SIZE;
+        if (context->bulk_slots > WH_TRANSPORT_MEM_BULK_MAX_SLOTS) {
+            context->bulk_slots = WH_TRANSPORT_MEM_BULK_MAX_SLOTS;
+        }
+    }
+
     context->initialized = 1;
     return WH_ERROR_OK;
 }
@@ -205,3 +215,111 @@ int wh_TransportMem_RecvResponse(void* c, uint16_t *out_len, void* data)
 
     return 0;
 }
+
+static int _BulkSlotUsed(whTransportMemContext* context, uint32_t slot)
+{
+    return (context->bulk_map[slot / 32] >> (slot % 32)) & 1;
+}
+
+static void _BulkSlotsSet(whTransportMemContext* context, uint32_t first,
+        uint32_t count, int used)
+{
+    uint32_t slot;
+
+    for (slot = first; slot < first + count; slot++) {
+        if (used) {
+            context->bulk_map[slot / 32] |= (1u << (slot % 32));
+        } else {
+            context->bulk_map[slot / 32] &= ~(1u << (slot % 32));
+        }
+    }
+}
+
+int wh_TransportMem_BulkAlloc(void* c, uint32_t size, uint32_t* out_offset,
+        void** out_ptr)
+{
+    whTransportMemContext* context = c;
+    uint32_t count = 0;
+    uint32_t first = 0;
+    uint32_t run = 0;
+    uint32_t slot = 0;
+
+    if (    (context == NULL) ||
+            (context->initialized == 0) ||
+            (context->bulk == NULL) ||
+            (size == 0) ||
+            (out_offset == NULL) ) {
+        return WH_ERROR_BADARGS;
+    }
+
+    count = (size + WH_TRANSPORT_MEM_BULK_SLOT_SIZE - 1) /
+            WH_TRANSPORT_MEM_BULK_SLOT_SIZE;
+
+    /* First fit over the slot bitmap */
+    for (slot = 0; slot < context->bulk_slots; slot++) {
+        if (_BulkSlotUsed(context, slot)) {
+            run = 0;
+            continue;
+        }
+        if (run == 0) {
+            first = slot;
+        }
+        if (++run == count) {
+            _BulkSlotsSet(context, first, count, 1);
+            *out_offset = first * WH_TRANSPORT_MEM_BULK_SLOT_SIZE;
+            if (out_ptr != NULL) {
+                *out_ptr = context->bulk + *out_offset;
+            }
+            return WH_ERROR_OK;
+        }
+    }
+    return WH_ERROR_NOSPACE;
+}
+
+int wh_TransportMem_BulkFree(void* c, uint32_t offset, uint32_t size)
+{
+    whTransportMemContext* context = c;
+    uint32_t first = 0;
+    uint32_t count = 0;
+
+    if (    (context == NULL) ||
+            (context->initialized == 0) ||
+            (context->bulk == NULL) ||
+            (size == 0) ||
+            ((offset % WH_TRANSPORT_MEM_BULK_SLOT_SIZE) != 0) ) {
+        return WH_ERROR_BADARGS;
+    }
+
+    first = offset / WH_TRANSPORT_MEM_BULK_SLOT_SIZE;
+    count = (size + WH_TRANSPORT_MEM_BULK_SLOT_SIZE - 1) /
+            WH_TRANSPORT_MEM_BULK_SLOT_SIZE;
+    if (    (first >= context->bulk_slots) ||
+            (count > context->bulk_slots - first) ) {
+        return WH_ERROR_BADARGS;
+    }
+
+    _BulkSlotsSet(context, first, count, 0);
+    return WH_ERROR_OK;
+}
+
+int wh_TransportMem_BulkGet(void* c, uint32_t offset, uint32_t size,
+        void** out_ptr)
+{
+    whTransportMemContext* context = c;
+
+    if (    (context == NULL) ||
+            (context->initialized == 0) ||
+            (out_ptr == NULL) ) {
+        return WH_ERROR_BADARGS;
+    }
+    if (context->bulk == NULL) {
+        return WH_ERROR_NOHANDLER;
+    }
+    if (    (offset > context->bulk_size) ||
+            (size > context->bulk_size - offset) ) {
+        return WH_ERROR_ACCESS;
+    }
+
+    *out_ptr = context->bulk + offset;
+    return WH_ERROR_OK;
+}
@@ -83,6 +83,12 @@ extern "C" {
 #define HAVE_ECC
 #define TFM_ECC256
 #define ECC_SHAMIR
+/* Fixed point tables for the generator and every cached verify key
+ * (WOLFHSM_NUM_ECC_VERIFY_CACHE), with spare entries for other points.
+ * wolfCrypt builds a point's table on its second use, so no warm-up is done */
+#define FP_ECC
+#define FP_ENTRIES 8
+#define FP_LUT 4
 #define HAVE_SUPPORTED_CURVES
 
 /** Curve25519 Options */
@@ -101,6 +107,10 @@ extern "C" {
 #define HAVE_AES_ECB
 #define WOLFSSL_CMAC
 
+/** ChaCha20-Poly1305 Options */
+#define HAVE_CHACHA
+#define HAVE_POLY1305
+
 /** SHA Options */
 #define NO_SHA
 /* #define NO_SHA256 */
@@ -110,6 +120,10 @@ extern "C" {
 /** Composite features */
 #define HAVE_HKDF
 
+/** Certificate Options */
+#define WOLFSSL_SMALL_CERT_VERIFY
+#define USE_CERT_BUFFERS_256
+
 /* Remove unneeded crypto */
 #define NO_DSA
 #define NO_RC4
@@ -29,18 +29,42 @@
 
 #include "wolfhsm/wh_comm.h"
 #include "wolfhsm/wh_transport_mem.h"
+#include "wolfhsm/wh_transport_direct.h"
 
 #include "wolfhsm/wh_nvm.h"
 #include "wolfhsm/wh_nvm_flash.h"
 #include "wolfhsm/wh_flash_ramsim.h"
 
 #include "wolfhsm/wh_server.h"
+#include "wolfhsm/wh_server_nvm.h"
+#include "wolfhsm/wh_server_keystore.h"
 #include "wolfhsm/wh_message.h"
+#include "wolfhsm/wh_message_comm.h"
+#include "wolfhsm/wh_message_nvm.h"
 #include "wolfhsm/wh_client.h"
+#include "wolfhsm/wh_client_pkcs11.h"
+#include "wolfhsm/wh_message_pkcs11.h"
+#include "wolfhsm/wh_client_cert.h"
+#include "wolfhsm/wh_client_image.h"
+#include "wolfhsm/wh_client_keywrap.h"
+#include "wolfhsm/wh_client_chacha.h"
+#include "wolfhsm/wh_client_prepared.h"
+#include "wolfhsm/wh_client_pool.h"
+#include "wolfhsm/wh_client_async.h"
+
+#if !defined(WOLFHSM_NO_CRYPTO) && defined(HAVE_ECC) && \
+    defined(USE_CERT_BUFFERS_256)
+#include "wolfssl/certs_test.h"
+#endif
 
 #if defined(WH_CFG_TEST_POSIX)
 #include <pthread.h> /* For pthread_create/cancel/join/_t */
 #include <unistd.h>  /* For sleep */
+#include <sched.h>   /* For sched_yield */
+#include <time.h>    /* For clock_gettime */
+#include "port/posix/posix_dma_engine.h"
+#include "port/posix/posix_capture.h"
+#include "port/posix/posix_lock.h"
 #endif
 
 
@@ -175,6 +199,125 @@ static int _testCallbacks(whServerContext* server, whClientContext* client)
     return WH_ERROR_OK;
 }
 
+static int _deferredSteps = 0;
+
+/* Continuation that needs three server iterations to complete */
+static int _customServerResumeCb(whServerContext* server,
+                                 const whMessageCustomCb_Request* req,
+                                 whMessageCustomCb_Response*      resp)
+{
+    _deferredSteps++;
+    if (_deferredSteps < 3) {
+        return wh_Server_CustomCbDefer(server, _customServerResumeCb, 0);
+    }
+    resp->type                = req->type;
+    resp->data.buffer.data[0] = req->data.buffer.data[0] + 1;
+    return 42;
+}
+
+static int _customServerDeferCb(whServerContext* server,
+                                const whMessageCustomCb_Request* req,
+                                whMessageCustomCb_Response*      resp)
+{
+    (void)resp;
+    _deferredSteps = 0;
+    /* Wait for an external event if the client asked for it */
+    return wh_Server_CustomCbDefer(server, _customServerResumeCb,
+                                   req->data.buffer.data[1]);
+}
+
+static int _testCallbacksDeferred(whServerContext* server,
+                                  whClientContext* client)
+{
+    whMessageCustomCb_Request  req  = {0};
+    whMessageCustomCb_Response resp = {0};
+    int i = 0;
+
+    WH_TEST_RETURN_ON_FAIL(
+        wh_Server_RegisterCustomCb(server, 0, _customServerDeferCb));
+
+    /* The server keeps iterating while the callback is in progress and only
+     * responds once the continuation completes */
+    req.id   = 0;
+    req.type = WH_MESSAGE_CUSTOM_CB_TYPE_USER_DEFINED_START;
+    req.data.buffer.data[0] = 7;
+    WH_TEST_RETURN_ON_FAIL(wh_Client_CustomCbRequest(client, &req));
+    for (i = 0; i < 3; i++) {
+        WH_TEST_ASSERT_RETURN(WH_ERROR_NOTREADY ==
+                              wh_Server_HandleRequestMessage(server));
+        WH_TEST_ASSERT_RETURN(WH_ERROR_NOTREADY ==
+                              wh_Client_CustomCbResponse(client, &resp));
+    }
+    WH_TEST_ASSERT_RETURN(_deferredSteps == 2);
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_CustomCbResponse(client, &resp));
+    WH_TEST_ASSERT_RETURN(_deferredSteps == 3);
+    WH_TEST_ASSERT_RETURN(resp.err == WH_ERROR_OK);
+    WH_TEST_ASSERT_RETURN(resp.rc == 42);
+    WH_TEST_ASSERT_RETURN(resp.data.buffer.data[0] == 8);
+
+    /* An event-driven callback is not resumed until it is signaled */
+    req.data.buffer.data[1] = 1;
+    WH_TEST_RETURN_ON_FAIL(wh_Client_CustomCbRequest(client, &req));
+    for (i = 0; i < 3; i++) {
+        WH_TEST_ASSERT_RETURN(WH_ERROR_NOTREADY ==
+                              wh_Server_HandleRequestMessage(server));
+    }
+    WH_TEST_ASSERT_RETURN(_deferredSteps == 0);
+    WH_TEST_RETURN_ON_FAIL(wh_Server_CustomCbSignal(server));
+    for (i = 0; i < 2; i++) {
+        WH_TEST_ASSERT_RETURN(WH_ERROR_NOTREADY ==
+                              wh_Server_HandleRequestMessage(server));
+    }
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_CustomCbResponse(client, &resp));
+    WH_TEST_ASSERT_RETURN(resp.rc == 42);
+
+    /* The application may give up on an event that never arrives */
+    WH_TEST_RETURN_ON_FAIL(wh_Client_CustomCbRequest(client, &req));
+    WH_TEST_ASSERT_RETURN(WH_ERROR_NOTREADY ==
+                          wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_CustomCbCancel(server));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_CustomCbResponse(client, &resp));
+    WH_TEST_ASSERT_RETURN(resp.err == WH_ERROR_ABORTED);
+    WH_TEST_ASSERT_RETURN(_deferredSteps == 0);
+
+    /* A disconnect drops the callback, so nothing from it is sent after
+     * reconnecting.  The shared memory transport still holds the request,
+     * which starts over and waits for a new signal */
+    WH_TEST_RETURN_ON_FAIL(wh_Client_CustomCbRequest(client, &req));
+    WH_TEST_ASSERT_RETURN(WH_ERROR_NOTREADY ==
+                          wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(
+        wh_Server_SetConnected(server, WH_COMM_DISCONNECTED));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_CustomCbSignal(server));
+    WH_TEST_ASSERT_RETURN(WH_ERROR_NOTREADY ==
+                          wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(
+        wh_Server_SetConnected(server, WH_COMM_CONNECTED));
+    for (i = 0; i < 3; i++) {
+        WH_TEST_ASSERT_RETURN(WH_ERROR_NOTREADY ==
+                              wh_Server_HandleRequestMessage(server));
+        WH_TEST_ASSERT_RETURN(WH_ERROR_NOTREADY ==
+                              wh_Client_CustomCbResponse(client, &resp));
+    }
+    WH_TEST_ASSERT_RETURN(_deferredSteps == 0);
+    WH_TEST_RETURN_ON_FAIL(wh_Server_CustomCbSignal(server));
+    for (i = 0; i < 2; i++) {
+        WH_TEST_ASSERT_RETURN(WH_ERROR_NOTREADY ==
+                              wh_Server_HandleRequestMessage(server));
+    }
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_CustomCbResponse(client, &resp));
+    WH_TEST_ASSERT_RETURN(resp.err == WH_ERROR_OK);
+    WH_TEST_ASSERT_RETURN(resp.rc == 42);
+
+    WH_TEST_RETURN_ON_FAIL(
+        wh_Server_RegisterCustomCb(server, 0, _customServerCb));
+    return WH_ERROR_OK;
+}
+
 static int _customServerDmaCb(struct whServerContext_t* server,
                               void* clientAddr, void** serverPtr, uint32_t len,
                               whServerDmaOper oper, whServerDmaFlags flags)
@@ -235,370 +378,2523 @@ static int _customServerDma64Cb(struct whServerContext_t* server,
                               len, oper, flags);
 }
 
-static int _testDma(whServerContext* server, whClientContext* client)
+/* Run a whole find operation for objects with the given label prefix */
+static int _pkcs11Find(whServerContext* server, whClientContext* client,
+        uint32_t session, const uint8_t* prefix, uint16_t prefix_len,
+        uint32_t* handles, uint16_t* inout_count)
 {
-    int        rc      = 0;
-    TestMemory testMem = {0};
+    int32_t server_rc = 0;
 
-    const whServerDmaAddrAllowList allowList = {
-        .readList =
-            {
-                {&testMem.srvBufAllow, sizeof(testMem.srvBufAllow)},
-                {&testMem.srvRemapBufAllow, sizeof(testMem.srvRemapBufAllow)},
-            },
-        .writeList =
-            {
-                {&testMem.srvBufAllow, sizeof(testMem.srvBufAllow)},
-                {&testMem.srvRemapBufAllow, sizeof(testMem.srvRemapBufAllow)},
-            },
-    };
+    WH_TEST_RETURN_ON_FAIL(wh_Client_Pkcs11FindObjectsInitRequest(client,
+            session, WOLFHSM_NVM_ACCESS_ANY, WOLFHSM_NVM_FLAGS_ANY, 0, 0,
+            prefix_len, prefix));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(
+        wh_Client_Pkcs11FindObjectsInitResponse(client, &server_rc));
+    WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
 
-    /* Register a custom DMA callback */
+    WH_TEST_RETURN_ON_FAIL(wh_Client_Pkcs11FindObjectsRequest(client,
+            session, *inout_count));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_Pkcs11FindObjectsResponse(client,
+            &server_rc, inout_count, handles));
+    WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
+
+    WH_TEST_RETURN_ON_FAIL(wh_Client_Pkcs11FindObjectsFinalRequest(client,
+            session));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
     WH_TEST_RETURN_ON_FAIL(
-        wh_Server_DmaRegisterCb32(server, _customServerDma32Cb));
+        wh_Client_Pkcs11FindObjectsFinalResponse(client, &server_rc));
+    WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
+    return 0;
+}
+
+#if !defined(WOLFHSM_NO_CRYPTO) && defined(HAVE_ECC)
+/* Sign with a cached P-256 key through both ECDSA mechanisms and check the
+ * signatures against the public key */
+static int _testPkcs11Ecdsa(whServerContext* server, whClientContext* client,
+        uint32_t session)
+{
+    WC_RNG   rng[1];
+    ecc_key  key[1];
+    uint8_t  raw[3 * 32];
+    word32   qxLen = 32;
+    word32   qyLen = 32;
+    word32   dLen  = 32;
+    uint8_t  hash[WC_SHA256_DIGEST_SIZE];
+    uint8_t  sig[2 * 32];
+    uint16_t sigLen = sizeof(sig);
+    uint8_t  der[ECC_MAX_SIG_SIZE];
+    word32   derLen = sizeof(der);
+    int      verified = 0;
+    int32_t  server_rc = 0;
+    uint32_t object = 0;
+    uint16_t count  = 1;
+    uint16_t keyId  = 0;
+    uint8_t  label[] = "Pkcs11Ecdsa";
+    const uint8_t msg[] = "PKCS11 multi-part message";
+
+    WH_TEST_RETURN_ON_FAIL(wc_InitRng(rng));
+    WH_TEST_RETURN_ON_FAIL(wc_ecc_init(key));
+    WH_TEST_RETURN_ON_FAIL(wc_ecc_make_key(rng, 32, key));
+    WH_TEST_RETURN_ON_FAIL(wc_ecc_export_private_raw(key, raw, &qxLen,
+            raw + qxLen, &qyLen, raw + qxLen + qyLen, &dLen));
+    WH_TEST_RETURN_ON_FAIL(wc_Sha256Hash(msg, sizeof(msg), hash));
+
+    WH_TEST_RETURN_ON_FAIL(wh_Client_KeyCacheRequest(client, 0, label,
+            sizeof(label), raw, qxLen + qyLen + dLen));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_KeyCacheResponse(client, &keyId));
+
+    /* The cached key is found before it is committed */
+    WH_TEST_RETURN_ON_FAIL(_pkcs11Find(server, client, session, label,
+            sizeof(label) - 1, &object, &count));
+    WH_TEST_ASSERT_RETURN(count == 1);
+
+    /* Multi-part ECDSA with SHA-256 */
+    WH_TEST_RETURN_ON_FAIL(wh_Client_Pkcs11SignInitRequest(client, session,
+            object, WH_PKCS11_MECH_ECDSA_SHA256));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
     WH_TEST_RETURN_ON_FAIL(
-        wh_Server_DmaRegisterCb64(server, _customServerDma64Cb));
+        wh_Client_Pkcs11SignInitResponse(client, &server_rc));
+    WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
 
-    /* Register our custom allow list */
-    WH_TEST_RETURN_ON_FAIL(wh_Server_DmaRegisterAllowList(server, &allowList));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_Pkcs11SignUpdateRequest(client, session,
+            msg, 10));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(
+        wh_Client_Pkcs11SignUpdateResponse(client, &server_rc));
+    WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
 
-    /* Check allowed operations for addresses in the allowlist */
-    WH_TEST_ASSERT_RETURN(
-        WH_ERROR_OK == wh_Server_DmaCheckMemOperAllowed(
-                           server, WH_DMA_OPER_CLIENT_READ_PRE,
-                           testMem.srvBufAllow, sizeof(testMem.srvBufAllow)));
-    WH_TEST_ASSERT_RETURN(
-        WH_ERROR_OK ==
-        wh_Server_DmaCheckMemOperAllowed(server, WH_DMA_OPER_CLIENT_READ_PRE,
-                                         testMem.srvRemapBufAllow,
-                                         sizeof(testMem.srvRemapBufAllow)));
-    WH_TEST_ASSERT_RETURN(
-        WH_ERROR_OK == wh_Server_DmaCheckMemOperAllowed(
-                           server, WH_DMA_OPER_CLIENT_WRITE_PRE,
-                           testMem.srvBufAllow, sizeof(testMem.srvBufAllow)));
-    WH_TEST_ASSERT_RETURN(
-        WH_ERROR_OK ==
-        wh_Server_DmaCheckMemOperAllowed(server, WH_DMA_OPER_CLIENT_WRITE_PRE,
-                                         testMem.srvRemapBufAllow,
-                                         sizeof(testMem.srvRemapBufAllow)));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_Pkcs11SignUpdateRequest(client, session,
+            msg + 10, sizeof(msg) - 10));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(
+        wh_Client_Pkcs11SignUpdateResponse(client, &server_rc));
+    WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
 
-    /* Ensure an address not in the allowlist is denied for all operations */
-    WH_TEST_ASSERT_RETURN(WH_ERROR_ACCESS ==
-                          wh_Server_DmaCheckMemOperAllowed(
-                              server, WH_DMA_OPER_CLIENT_READ_PRE,
-                              testMem.srvBufDeny, sizeof(testMem.srvBufDeny)));
-    WH_TEST_ASSERT_RETURN(WH_ERROR_ACCESS ==
-                          wh_Server_DmaCheckMemOperAllowed(
-                              server, WH_DMA_OPER_CLIENT_WRITE_PRE,
-                              testMem.srvBufDeny, sizeof(testMem.srvBufDeny)));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_Pkcs11SignFinalRequest(client,
+            session));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_Pkcs11SignFinalResponse(client,
+            &server_rc, sig, &sigLen));
+    WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
+    WH_TEST_ASSERT_RETURN(sigLen == sizeof(sig));
 
-    /* Zero-sized operations should be denied */
-    WH_TEST_ASSERT_RETURN(
-        WH_ERROR_BADARGS ==
-        wh_Server_DmaCheckMemOperAllowed(server, WH_DMA_OPER_CLIENT_READ_PRE,
-                                         testMem.srvBufAllow, 0));
-    WH_TEST_ASSERT_RETURN(
-        WH_ERROR_BADARGS ==
-        wh_Server_DmaCheckMemOperAllowed(server, WH_DMA_OPER_CLIENT_WRITE_PRE,
-                                         testMem.srvBufAllow, 0));
+    WH_TEST_RETURN_ON_FAIL(wc_ecc_rs_raw_to_sig(sig, 32, sig + 32, 32, der,
+            &derLen));
+    WH_TEST_RETURN_ON_FAIL(wc_ecc_verify_hash(der, derLen, hash,
+            sizeof(hash), &verified, key));
+    WH_TEST_ASSERT_RETURN(verified == 1);
 
-    /* Set known pattern in client Buffer */
-    memset(testMem.cliBuf, TEST_MEM_CLI_BYTE, sizeof(testMem.cliBuf));
+    /* The operation ended with SignFinal */
+    WH_TEST_RETURN_ON_FAIL(wh_Client_Pkcs11SignFinalRequest(client,
+            session));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_Pkcs11SignFinalResponse(client,
+            &server_rc, NULL, NULL));
+    WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_NOTINIT);
 
-    /* Perform a copy from "client mem" to allowed "server mem" */
-    if (sizeof(void*) == sizeof(uint64_t)) {
-        /* 64-bit host system */
-        WH_TEST_RETURN_ON_FAIL(whServerDma_CopyFromClient64(
-            server, testMem.srvBufAllow, (uint64_t)((uintptr_t)testMem.cliBuf),
-            sizeof(testMem.cliBuf), (whServerDmaFlags){0}));
-    }
-    else if (sizeof(void*) == sizeof(uint32_t)) {
-        /* 32-bit host system */
-        WH_TEST_RETURN_ON_FAIL(whServerDma_CopyFromClient32(
-            server, testMem.srvBufAllow, (uint32_t)((uintptr_t)testMem.cliBuf),
-            sizeof(testMem.cliBuf), (whServerDmaFlags){0}));
-    }
+    /* Single-part raw ECDSA over the digest */
+    WH_TEST_RETURN_ON_FAIL(wh_Client_Pkcs11SignInitRequest(client, session,
+            object, WH_PKCS11_MECH_ECDSA));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(
+        wh_Client_Pkcs11SignInitResponse(client, &server_rc));
+    WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
 
-    /* Ensure data was copied */
-    WH_TEST_ASSERT_RETURN(0 == memcmp(testMem.cliBuf, testMem.srvBufAllow,
-                                      sizeof(testMem.cliBuf)));
+    sigLen = sizeof(sig);
+    WH_TEST_RETURN_ON_FAIL(wh_Client_Pkcs11SignRequest(client, session,
+            hash, sizeof(hash)));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_Pkcs11SignResponse(client,
+            &server_rc, sig, &sigLen));
+    WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
+    WH_TEST_ASSERT_RETURN(sigLen == sizeof(sig));
+
+    derLen = sizeof(der);
+    verified = 0;
+    WH_TEST_RETURN_ON_FAIL(wc_ecc_rs_raw_to_sig(sig, 32, sig + 32, 32, der,
+            &derLen));
+    WH_TEST_RETURN_ON_FAIL(wc_ecc_verify_hash(der, derLen, hash,
+            sizeof(hash), &verified, key));
+    WH_TEST_ASSERT_RETURN(verified == 1);
+
+    /* Raw ECDSA is single-part, an update aborts the operation */
+    WH_TEST_RETURN_ON_FAIL(wh_Client_Pkcs11SignInitRequest(client, session,
+            object, WH_PKCS11_MECH_ECDSA));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(
+        wh_Client_Pkcs11SignInitResponse(client, &server_rc));
+    WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
 
-    /* custom DMA callback uses the tmp server buffer for input data and
-     * should set it to a known pattern on exit */
-    uint8_t tmp[sizeof(testMem.srvRemapBufAllow)];
-    memset(tmp, TEST_MEM_UNMAPPED_BYTE, sizeof(tmp));
-    WH_TEST_ASSERT_RETURN(0 == memcmp(testMem.srvRemapBufAllow, tmp,
-                                      sizeof(testMem.srvRemapBufAllow)));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_Pkcs11SignUpdateRequest(client, session,
+            msg, sizeof(msg)));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(
+        wh_Client_Pkcs11SignUpdateResponse(client, &server_rc));
+    WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_BADARGS);
 
-    /* Clear client data */
-    memset(testMem.cliBuf, 0, sizeof(testMem.cliBuf));
-    memset(testMem.srvRemapBufAllow, 0, sizeof(testMem.srvRemapBufAllow));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_Pkcs11SignFinalRequest(client,
+            session));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_Pkcs11SignFinalResponse(client,
+            &server_rc, NULL, NULL));
+    WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_NOTINIT);
 
-    /* Perform a copy from "server mem" to "client mem" */
-    if (sizeof(void*) == sizeof(uint64_t)) {
-        /* 64-bit host system */
-        WH_TEST_RETURN_ON_FAIL(whServerDma_CopyToClient64(
-            server, (uint64_t)((uintptr_t)testMem.cliBuf), testMem.srvBufAllow,
-            sizeof(testMem.srvBufAllow), (whServerDmaFlags){0}));
-    }
-    else if (sizeof(void*) == sizeof(uint32_t)) {
-        /* 32-bit host system */
-        WH_TEST_RETURN_ON_FAIL(whServerDma_CopyToClient32(
-            server, (uint32_t)((uintptr_t)testMem.cliBuf), testMem.srvBufAllow,
-            sizeof(testMem.srvBufAllow), (whServerDmaFlags){0}));
-    }
+    wc_ecc_free(key);
+    wc_FreeRng(rng);
 
-    /* Ensure data was copied */
-    WH_TEST_ASSERT_RETURN(0 == memcmp(testMem.srvBufAllow, testMem.cliBuf,
-                                      sizeof(testMem.srvBufAllow)));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_KeyEvictRequest(client, keyId));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_KeyEvictResponse(client));
+    return 0;
+}
+#endif /* !WOLFHSM_NO_CRYPTO && HAVE_ECC */
 
-    /* Now try and copy from the denylisted addresses */
-    if (sizeof(void*) == sizeof(uint64_t)) {
-        /* 64-bit host system */
-        WH_TEST_ASSERT_RETURN(
-            WH_ERROR_ACCESS ==
-            whServerDma_CopyFromClient64(server, testMem.srvBufDeny,
-                                         (uint64_t)((uintptr_t)testMem.cliBuf),
-                                         sizeof(testMem.cliBuf),
-                                         (whServerDmaFlags){0}));
-        WH_TEST_ASSERT_RETURN(WH_ERROR_ACCESS ==
-                              whServerDma_CopyToClient64(
-                                  server, (uint64_t)((uintptr_t)testMem.cliBuf),
-                                  testMem.srvBufDeny,
-                                  sizeof(testMem.srvBufDeny),
-                                  (whServerDmaFlags){0}));
-    }
-    else if (sizeof(void*) == sizeof(uint32_t)) {
-        /* 32-bit host system */
-        WH_TEST_ASSERT_RETURN(
-            WH_ERROR_ACCESS ==
-            whServerDma_CopyFromClient32(server, testMem.srvBufDeny,
-                                         (uint32_t)((uintptr_t)testMem.cliBuf),
-                                         sizeof(testMem.cliBuf),
-                                         (whServerDmaFlags){0}));
-        WH_TEST_ASSERT_RETURN(WH_ERROR_ACCESS ==
-                              whServerDma_CopyToClient32(
-                                  server, (uint32_t)((uintptr_t)testMem.cliBuf),
-                                  testMem.srvBufDeny,
-                                  sizeof(testMem.srvBufDeny),
-                                  (whServerDmaFlags){0}));
+static int _testPkcs11(whServerContext* server, whClientContext* client)
+{
+    int32_t  server_rc = 0;
+    uint32_t session   = 0;
+    uint16_t count     = 0;
+    uint32_t handles[8] = {0};
+    uint32_t other     = 0;
+    whNvmId  otherId   = 0;
+    uint8_t  ownClient = server->comm->client_id;
+    uint8_t  otherClient = (uint8_t)(ownClient + 1);
+    whNvmId  id        = 0;
+    whNvmSize len      = 0;
+    uint8_t  label[WOLFHSM_NVM_LABEL_LEN] = {0};
+    int      i;
+
+    const whNvmId  ids[]    = {0x50, 0x51, 0x60};
+    uint8_t        labels[][WOLFHSM_NVM_LABEL_LEN] = {
+        "Pkcs11A", "Pkcs11B", "Other"};
+    const uint8_t  prefix[] = "Pkcs11";
+    const uint8_t  data[]   = "Pkcs11 object data";
+    uint8_t        otherLabel[WOLFHSM_NVM_LABEL_LEN] = "Pkcs11Other";
+
+    /* Populate NVM with a few objects to search over */
+    for (i = 0; i < (int)(sizeof(ids) / sizeof(ids[0])); i++) {
+        WH_TEST_RETURN_ON_FAIL(wh_Client_NvmAddObjectRequest(client, ids[i],
+                0, 0, sizeof(labels[i]), labels[i], sizeof(data), data));
+        WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+        WH_TEST_RETURN_ON_FAIL(
+            wh_Client_NvmAddObjectResponse(client, &server_rc));
+        WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
     }
 
-    /* Check that zero-sized copies fail, even from allowed addresses */
-    if (sizeof(void*) == sizeof(uint64_t)) {
-        /* 64-bit host system */
-        WH_TEST_ASSERT_RETURN(
-            WH_ERROR_BADARGS ==
-            whServerDma_CopyFromClient64(server, testMem.srvBufAllow,
-                                         (uint64_t)((uintptr_t)testMem.cliBuf),
-                                         0, (whServerDmaFlags){0}));
-        WH_TEST_ASSERT_RETURN(WH_ERROR_BADARGS ==
-                              whServerDma_CopyToClient64(
-                                  server, (uint64_t)((uintptr_t)testMem.cliBuf),
-                                  testMem.srvBufAllow, 0,
-                                  (whServerDmaFlags){0}));
-    }
-    else if (sizeof(void*) == sizeof(uint32_t)) {
-        /* 32-bit host system */
-        WH_TEST_ASSERT_RETURN(
-            WH_ERROR_BADARGS ==
-            whServerDma_CopyFromClient32(server, testMem.srvBufAllow,
-                                         (uint32_t)((uintptr_t)testMem.cliBuf),
-                                         0, (whServerDmaFlags){0}));
-        WH_TEST_ASSERT_RETURN(WH_ERROR_BADARGS ==
-                              whServerDma_CopyToClient32(
-                                  server, (uint32_t)((uintptr_t)testMem.cliBuf),
-                                  testMem.srvBufAllow, 0,
-                                  (whServerDmaFlags){0}));
-    }
+    /* A key of another client matches the label prefix but must stay out of
+     * this client's searches */
+    otherId = MAKE_WOLFHSM_KEYID(WOLFHSM_KEYTYPE_CRYPTO, otherClient, 0x52);
+    WH_TEST_RETURN_ON_FAIL(wh_Client_NvmAddObjectRequest(client, otherId,
+            0, 0, sizeof(otherLabel), otherLabel, sizeof(data), data));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(
+        wh_Client_NvmAddObjectResponse(client, &server_rc));
+    WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
 
-    /* Finally, check that registering a NULL callbacks clears the DMA callback
-     * table, and that the copies otherwise work as normal */
-    WH_TEST_RETURN_ON_FAIL(wh_Server_DmaRegisterCb32(server, NULL));
-    WH_TEST_RETURN_ON_FAIL(wh_Server_DmaRegisterCb64(server, NULL));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_Pkcs11OpenSessionRequest(client, 0));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(
+        wh_Client_Pkcs11OpenSessionResponse(client, &server_rc, &session));
+    WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
+    WH_TEST_ASSERT_RETURN(session != WH_PKCS11_INVALID_HANDLE);
 
-    /* Use remap buffer as copy src, since client address isn't in allowlist */
-    memcpy(testMem.srvRemapBufAllow, testMem.cliBuf, sizeof(testMem.cliBuf));
+    /* Find only the objects with a matching label prefix */
+    WH_TEST_RETURN_ON_FAIL(wh_Client_Pkcs11FindObjectsInitRequest(client,
+            session, WOLFHSM_NVM_ACCESS_ANY, WOLFHSM_NVM_FLAGS_ANY, 0, 0,
+            sizeof(prefix) - 1, prefix));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(
+        wh_Client_Pkcs11FindObjectsInitResponse(client, &server_rc));
+    WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
 
-    if (sizeof(void*) == sizeof(uint64_t)) {
-        WH_TEST_RETURN_ON_FAIL(whServerDma_CopyFromClient64(
-            server, testMem.srvBufAllow,
-            (uint64_t)((uintptr_t)testMem.srvRemapBufAllow),
-            sizeof(testMem.cliBuf), (whServerDmaFlags){0}));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_Pkcs11FindObjectsRequest(client,
+            session, 1));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_Pkcs11FindObjectsResponse(client,
+            &server_rc, &count, &handles[0]));
+    WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
+    WH_TEST_ASSERT_RETURN(count == 1);
+
+    /* The find cursor resumes where the previous call left off */
+    WH_TEST_RETURN_ON_FAIL(wh_Client_Pkcs11FindObjectsRequest(client,
+            session, sizeof(handles) / sizeof(handles[0]) - 1));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_Pkcs11FindObjectsResponse(client,
+            &server_rc, &count, &handles[1]));
+    WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
+    WH_TEST_ASSERT_RETURN(count == 1);
+    WH_TEST_ASSERT_RETURN(handles[0] != handles[1]);
+
+    WH_TEST_RETURN_ON_FAIL(wh_Client_Pkcs11FindObjectsFinalRequest(client,
+            session));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(
+        wh_Client_Pkcs11FindObjectsFinalResponse(client, &server_rc));
+    WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
+
+    /* Find without an active find operation is rejected */
+    WH_TEST_RETURN_ON_FAIL(wh_Client_Pkcs11FindObjectsRequest(client,
+            session, 1));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_Pkcs11FindObjectsResponse(client,
+            &server_rc, &count, NULL));
+    WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_NOTINIT);
+
+    for (i = 0; i < 2; i++) {
+        WH_TEST_RETURN_ON_FAIL(wh_Client_Pkcs11GetObjectInfoRequest(client,
+                session, handles[i]));
+        WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+        WH_TEST_RETURN_ON_FAIL(wh_Client_Pkcs11GetObjectInfoResponse(client,
+                &server_rc, &id, NULL, NULL, &len, sizeof(label), label));
+        WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
+        WH_TEST_ASSERT_RETURN((id == ids[0]) || (id == ids[1]));
+        WH_TEST_ASSERT_RETURN(len == sizeof(data));
+        WH_TEST_ASSERT_RETURN(0 == memcmp(label, prefix, sizeof(prefix) - 1));
     }
-    else if (sizeof(void*) == sizeof(uint32_t)) {
-        WH_TEST_RETURN_ON_FAIL(whServerDma_CopyFromClient32(
-            server, testMem.srvBufAllow,
-            (uint32_t)((uintptr_t)testMem.srvRemapBufAllow),
-            sizeof(testMem.cliBuf), (whServerDmaFlags){0}));
+
+#ifdef WOLFHSM_NO_CRYPTO
+    WH_TEST_RETURN_ON_FAIL(wh_Client_Pkcs11SignInitRequest(client, session,
+            handles[1], WH_PKCS11_MECH_ECDSA));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(
+        wh_Client_Pkcs11SignInitResponse(client, &server_rc));
+    WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_NOHANDLER);
+#elif defined(HAVE_ECC)
+    WH_TEST_RETURN_ON_FAIL(_testPkcs11Ecdsa(server, client, session));
+#endif
+
+    /* The owner gets a handle to its key */
+    server->comm->client_id = otherClient;
+    count = 1;
+    WH_TEST_RETURN_ON_FAIL(_pkcs11Find(server, client, session, otherLabel,
+            (uint16_t)strlen((char*)otherLabel), &other, &count));
+    server->comm->client_id = ownClient;
+    WH_TEST_ASSERT_RETURN(count == 1);
+
+    /* Which does not resolve for any other client */
+    WH_TEST_RETURN_ON_FAIL(wh_Client_Pkcs11GetObjectInfoRequest(client,
+            session, other));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_Pkcs11GetObjectInfoResponse(client,
+            &server_rc, NULL, NULL, NULL, NULL, 0, NULL));
+    WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_BADHANDLE);
+
+    WH_TEST_RETURN_ON_FAIL(wh_Client_Pkcs11DestroyObjectRequest(client,
+            session, other));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(
+        wh_Client_Pkcs11DestroyObjectResponse(client, &server_rc));
+    WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_BADHANDLE);
+    WH_TEST_RETURN_ON_FAIL(wh_Client_NvmGetMetadataRequest(client, otherId));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_NvmGetMetadataResponse(client,
+            &server_rc, NULL, NULL, NULL, NULL, 0, NULL));
+    WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
+
+    /* Destroying an object invalidates its handle */
+    WH_TEST_RETURN_ON_FAIL(wh_Client_Pkcs11DestroyObjectRequest(client,
+            session, handles[0]));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(
+        wh_Client_Pkcs11DestroyObjectResponse(client, &server_rc));
+    WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
+
+    WH_TEST_RETURN_ON_FAIL(wh_Client_Pkcs11GetObjectInfoRequest(client,
+            session, handles[0]));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_Pkcs11GetObjectInfoResponse(client,
+            &server_rc, NULL, NULL, NULL, NULL, 0, NULL));
+    WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_BADHANDLE);
+
+    WH_TEST_RETURN_ON_FAIL(wh_Client_Pkcs11CloseSessionRequest(client,
+            session));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(
+        wh_Client_Pkcs11CloseSessionResponse(client, &server_rc));
+    WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
+
+    /* Handles do not outlive their session */
+    WH_TEST_RETURN_ON_FAIL(wh_Client_Pkcs11GetObjectInfoRequest(client,
+            session, handles[1]));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_Pkcs11GetObjectInfoResponse(client,
+            &server_rc, NULL, NULL, NULL, NULL, 0, NULL));
+    WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_BADHANDLE);
+
+    /* Remove the remaining objects */
+    WH_TEST_RETURN_ON_FAIL(wh_Client_NvmDestroyObjectsRequest(client,
+            sizeof(ids) / sizeof(ids[0]), ids));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(
+        wh_Client_NvmDestroyObjectsResponse(client, &server_rc));
+    WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
+    WH_TEST_RETURN_ON_FAIL(wh_Client_NvmDestroyObjectsRequest(client,
+            1, &otherId));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(
+        wh_Client_NvmDestroyObjectsResponse(client, &server_rc));
+    WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
+
+    return WH_ERROR_OK;
+}
+
+static int _testCert(whServerContext* server, whClientContext* client)
+{
+    int32_t  server_rc = 0;
+    uint16_t depth     = 0;
+
+#if !defined(WOLFHSM_NO_CRYPTO) && defined(HAVE_ECC) && \
+    defined(USE_CERT_BUFFERS_256)
+    const whNvmId anchor_id = 0x70;
+    uint8_t label[WOLFHSM_NVM_LABEL_LEN] = "EccCa";
+    uint8_t chain[sizeof(serv_ecc_der_256) + sizeof(ca_ecc_cert_der_256)];
+
+    /* Store the CA as a trust anchor */
+    WH_TEST_RETURN_ON_FAIL(wh_Client_NvmAddObjectRequest(client, anchor_id,
+            0, 0, sizeof(label), label, sizeof_ca_ecc_cert_der_256,
+            ca_ecc_cert_der_256));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_NvmAddObjectResponse(client, &server_rc));
+    WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
+
+    /* Leaf only, twice so the second pass uses the cached anchor */
+    memcpy(chain, serv_ecc_der_256, sizeof_serv_ecc_der_256);
+    WH_TEST_RETURN_ON_FAIL(wh_Client_CertVerifyRequest(client, chain,
+            sizeof_serv_ecc_der_256, anchor_id));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(
+        wh_Client_CertVerifyResponse(client, &server_rc, &depth));
+    WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
+    WH_TEST_ASSERT_RETURN(depth == 1);
+
+    WH_TEST_RETURN_ON_FAIL(wh_Client_CertVerifyRequest(client, chain,
+            sizeof_serv_ecc_der_256, anchor_id));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(
+        wh_Client_CertVerifyResponse(client, &server_rc, &depth));
+    WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
+
+    /* Anchor included at the top of the chain */
+    memcpy(chain + sizeof_serv_ecc_der_256, ca_ecc_cert_der_256,
+            sizeof_ca_ecc_cert_der_256);
+    WH_TEST_RETURN_ON_FAIL(wh_Client_CertVerifyRequest(client, chain,
+            sizeof(chain), anchor_id));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(
+        wh_Client_CertVerifyResponse(client, &server_rc, &depth));
+    WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
+    WH_TEST_ASSERT_RETURN(depth == 2);
+
+    /* A corrupted signature must not verify */
+    chain[sizeof_serv_ecc_der_256 - 1] ^= 0x01;
+    WH_TEST_RETURN_ON_FAIL(wh_Client_CertVerifyRequest(client, chain,
+            sizeof_serv_ecc_der_256, anchor_id));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(
+        wh_Client_CertVerifyResponse(client, &server_rc, &depth));
+    WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_CERTVERIFY);
+
+    /* An anchor replaced directly in NVM, bypassing the server handlers, is
+     * parsed again rather than served from the cache */
+    chain[sizeof_serv_ecc_der_256 - 1] ^= 0x01;
+    {
+        whNvmMetadata meta = {0};
+
+        meta.id = anchor_id;
+        meta.len = sizeof_serv_ecc_der_256;
+        memcpy(meta.label, label, sizeof(meta.label));
+        WH_TEST_RETURN_ON_FAIL(wh_Nvm_AddObject(server->nvm, &meta,
+                sizeof_serv_ecc_der_256, serv_ecc_der_256));
+        WH_TEST_RETURN_ON_FAIL(wh_Client_CertVerifyRequest(client, chain,
+                sizeof_serv_ecc_der_256, anchor_id));
+        WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+        WH_TEST_RETURN_ON_FAIL(
+            wh_Client_CertVerifyResponse(client, &server_rc, &depth));
+        WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_CERTVERIFY);
+
+        meta.len = sizeof_ca_ecc_cert_der_256;
+        WH_TEST_RETURN_ON_FAIL(wh_Nvm_AddObject(server->nvm, &meta,
+                sizeof_ca_ecc_cert_der_256, ca_ecc_cert_der_256));
+        WH_TEST_RETURN_ON_FAIL(wh_Client_CertVerifyRequest(client, chain,
+                sizeof_serv_ecc_der_256, anchor_id));
+        WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+        WH_TEST_RETURN_ON_FAIL(
+            wh_Client_CertVerifyResponse(client, &server_rc, &depth));
+        WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
     }
+    chain[sizeof_serv_ecc_der_256 - 1] ^= 0x01;
 
-    WH_TEST_ASSERT_RETURN(0 == memcmp(testMem.srvRemapBufAllow,
-                                      testMem.srvBufAllow,
-                                      sizeof(testMem.srvBufAllow)));
-    memset(testMem.srvRemapBufAllow, 0, sizeof(testMem.srvRemapBufAllow));
+    /* Destroying the anchor drops the cached copy */
+    WH_TEST_RETURN_ON_FAIL(wh_Client_NvmDestroyObjectsRequest(client, 1,
+            &anchor_id));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(
+        wh_Client_NvmDestroyObjectsResponse(client, &server_rc));
+    WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
 
-    if (sizeof(void*) == sizeof(uint64_t)) {
-        WH_TEST_RETURN_ON_FAIL(whServerDma_CopyToClient64(
-            server, (uint64_t)((uintptr_t)testMem.srvRemapBufAllow),
-            testMem.srvBufAllow, sizeof(testMem.srvRemapBufAllow),
-            (whServerDmaFlags){0}));
+    chain[sizeof_serv_ecc_der_256 - 1] ^= 0x01;
+    WH_TEST_RETURN_ON_FAIL(wh_Client_CertVerifyRequest(client, chain,
+            sizeof_serv_ecc_der_256, anchor_id));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(
+        wh_Client_CertVerifyResponse(client, &server_rc, &depth));
+    WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_NOTFOUND);
+
+    /* A leaf certificate is not accepted as a trust anchor */
+    WH_TEST_RETURN_ON_FAIL(wh_Client_NvmAddObjectRequest(client, anchor_id,
+            0, 0, sizeof(label), label, sizeof_serv_ecc_der_256,
+            serv_ecc_der_256));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_NvmAddObjectResponse(client, &server_rc));
+    WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
+
+    WH_TEST_RETURN_ON_FAIL(wh_Client_CertVerifyRequest(client, chain,
+            sizeof_serv_ecc_der_256, anchor_id));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(
+        wh_Client_CertVerifyResponse(client, &server_rc, &depth));
+    WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_CERTVERIFY);
+
+    WH_TEST_RETURN_ON_FAIL(wh_Client_NvmDestroyObjectsRequest(client, 1,
+            &anchor_id));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(
+        wh_Client_NvmDestroyObjectsResponse(client, &server_rc));
+    WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
+#else
+    const uint8_t chain[] = {0x30, 0x03, 0x02, 0x01, 0x00};
+
+    WH_TEST_ASSERT_RETURN(WH_ERROR_BADARGS ==
+            wh_Client_CertVerifyRequest(client, chain, 0, 1));
+
+    /* Without crypto the request is framed but not handled */
+    WH_TEST_RETURN_ON_FAIL(wh_Client_CertVerifyRequest(client, chain,
+            sizeof(chain), 1));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(
+        wh_Client_CertVerifyResponse(client, &server_rc, &depth));
+    WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_NOHANDLER);
+    WH_TEST_ASSERT_RETURN(depth == 0);
+#endif
+
+    return WH_ERROR_OK;
+}
+
+#if !defined(WOLFHSM_NO_CRYPTO) && defined(HAVE_AESGCM)
+/* Seal two 16 byte keys with the given ids under kek, laid out as an export
+ * would */
+static int _keyWrapSeal(const uint8_t* kek, uint32_t kekSz, uint16_t id1,
+        uint16_t id2, uint8_t* blob, uint16_t* out_len)
+{
+    Aes      aes[1];
+    uint8_t  records[2 * (WH_KEYWRAP_RECORD_HDR_LEN + 16)];
+    uint8_t* rec    = records;
+    uint16_t ids[2];
+    int      ret    = 0;
+    int      i      = 0;
+
+    ids[0] = id1;
+    ids[1] = id2;
+    memset(records, 0, sizeof(records));
+    for (i = 0; i < 2; i++) {
+        rec[0] = (uint8_t)(ids[i] & 0xFF);
+        rec[1] = (uint8_t)(ids[i] >> 8);
+        rec[6] = 16;
+        memset(rec + WH_KEYWRAP_RECORD_HDR_LEN, 0x33 + i, 16);
+        rec += WH_KEYWRAP_RECORD_HDR_LEN + 16;
     }
-    else if (sizeof(void*) == sizeof(uint32_t)) {
-        WH_TEST_RETURN_ON_FAIL(whServerDma_CopyToClient32(
-            server, (uint32_t)((uintptr_t)testMem.srvRemapBufAllow),
-            testMem.srvBufAllow, sizeof(testMem.srvBufAllow),
-            (whServerDmaFlags){0}));
+
+    memset(blob, 0, WH_KEYWRAP_BLOB_OVERHEAD);
+    blob[0] = WH_KEYWRAP_BLOB_VERSION;
+    blob[2] = 2;
+    memset(blob + WH_KEYWRAP_BLOB_HDR_LEN, 0x5A, WH_KEYWRAP_BLOB_IV_LEN);
+    ret = wc_AesInit(aes, NULL, INVALID_DEVID);
+    if (ret == 0) {
+        ret = wc_AesGcmSetKey(aes, kek, kekSz);
+        if (ret == 0) {
+            ret = wc_AesGcmEncrypt(aes, blob + WH_KEYWRAP_BLOB_OVERHEAD,
+                    records, sizeof(records),
+                    blob + WH_KEYWRAP_BLOB_HDR_LEN, WH_KEYWRAP_BLOB_IV_LEN,
+                    blob + WH_KEYWRAP_BLOB_HDR_LEN + WH_KEYWRAP_BLOB_IV_LEN,
+                    WH_KEYWRAP_BLOB_TAG_LEN, blob, WH_KEYWRAP_BLOB_HDR_LEN);
+        }
+        wc_AesFree(aes);
+    }
+    *out_len = WH_KEYWRAP_BLOB_OVERHEAD + sizeof(records);
+    return ret;
+}
+#endif
+
+static int _testKeyWrap(whServerContext* server, whClientContext* client)
+{
+    int32_t  server_rc = 0;
+    uint16_t count     = 0;
+    uint16_t blob_len  = 0;
+    whNvmId  cursor    = 0;
+    uint8_t  done      = 0;
+    uint8_t  blob[WH_MESSAGE_KEYWRAP_MAX_BLOB_LEN];
+
+#if !defined(WOLFHSM_NO_CRYPTO) && defined(HAVE_AESGCM)
+    uint8_t  label[WOLFHSM_NVM_LABEL_LEN] = "WrapKey";
+    uint8_t  kek[32];
+    uint8_t  key1[16];
+    uint8_t  key2[48];
+    uint8_t  out[sizeof(key2)];
+    uint32_t outSz = 0;
+    uint16_t kek_id = 0;
+    uint16_t key_ids[2] = {0};
+    uint16_t total = 0;
+    uint16_t saved_len = 0;
+    uint8_t  saved[sizeof(blob)];
+    int      i = 0;
+
+    memset(kek, 0xA5, sizeof(kek));
+    memset(key1, 0x11, sizeof(key1));
+    memset(key2, 0x22, sizeof(key2));
+
+    /* The KEK only needs to be cached, the wrapped keys must be committed */
+    WH_TEST_RETURN_ON_FAIL(wh_Client_KeyCacheRequest(client, 0, label,
+            sizeof(label), kek, sizeof(kek)));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_KeyCacheResponse(client, &kek_id));
+    for (i = 0; i < 2; i++) {
+        WH_TEST_RETURN_ON_FAIL(wh_Client_KeyCacheRequest(client, 0, label,
+                sizeof(label), (i == 0) ? key1 : key2,
+                (i == 0) ? sizeof(key1) : sizeof(key2)));
+        WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+        WH_TEST_RETURN_ON_FAIL(
+            wh_Client_KeyCacheResponse(client, &key_ids[i]));
+        WH_TEST_RETURN_ON_FAIL(wh_Client_KeyCommitRequest(client, key_ids[i]));
+        WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+        WH_TEST_RETURN_ON_FAIL(wh_Client_KeyCommitResponse(client));
+    }
+
+    /* Stream the export until the cursor reaches the end of NVM */
+    do {
+        blob_len = sizeof(blob);
+        WH_TEST_RETURN_ON_FAIL(wh_Client_KeyWrapExportRequest(client, kek_id,
+                cursor, blob_len));
+        WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+        WH_TEST_RETURN_ON_FAIL(wh_Client_KeyWrapExportResponse(client,
+                &server_rc, blob, &blob_len, &count, &cursor, &done));
+        WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
+        if (count > 0) {
+            memcpy(saved, blob, blob_len);
+            saved_len = blob_len;
+        }
+        total += count;
+    } while (done == 0);
+    WH_TEST_ASSERT_RETURN(total == 2);
+
+    /* Remove the keys, then restore them from the blob */
+    for (i = 0; i < 2; i++) {
+        WH_TEST_RETURN_ON_FAIL(wh_Client_KeyEraseRequest(client, key_ids[i]));
+        WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+        WH_TEST_RETURN_ON_FAIL(wh_Client_KeyEraseResponse(client));
+    }
+
+    /* A modified blob must not authenticate */
+    saved[saved_len - 1] ^= 0x01;
+    WH_TEST_RETURN_ON_FAIL(wh_Client_KeyWrapImportRequest(client, kek_id,
+            saved, saved_len));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(
+        wh_Client_KeyWrapImportResponse(client, &server_rc, &count));
+    WH_TEST_ASSERT_RETURN(server_rc != WH_ERROR_OK);
+    saved[saved_len - 1] ^= 0x01;
+
+    WH_TEST_RETURN_ON_FAIL(wh_Client_KeyWrapImportRequest(client, kek_id,
+            saved, saved_len));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(
+        wh_Client_KeyWrapImportResponse(client, &server_rc, &count));
+    WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
+    WH_TEST_ASSERT_RETURN(count == 2);
+
+    outSz = sizeof(out);
+    WH_TEST_RETURN_ON_FAIL(wh_Client_KeyExportRequest(client, key_ids[1]));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_KeyExportResponse(client, label,
+            sizeof(label), out, &outSz));
+    WH_TEST_ASSERT_RETURN(outSz == sizeof(key2));
+    WH_TEST_ASSERT_RETURN(memcmp(out, key2, sizeof(key2)) == 0);
+
+    /* A blob may neither replace its own KEK nor carry a key twice, and
+     * nothing from a rejected blob is added */
+    for (i = 0; i < 2; i++) {
+        WH_TEST_RETURN_ON_FAIL(_keyWrapSeal(kek, sizeof(kek), key_ids[0],
+                (i == 0) ? kek_id : key_ids[0], saved, &saved_len));
+        WH_TEST_RETURN_ON_FAIL(wh_Client_KeyWrapImportRequest(client, kek_id,
+                saved, saved_len));
+        WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+        WH_TEST_RETURN_ON_FAIL(
+            wh_Client_KeyWrapImportResponse(client, &server_rc, &count));
+        WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_ABORTED);
+    }
+    outSz = sizeof(out);
+    WH_TEST_RETURN_ON_FAIL(wh_Client_KeyExportRequest(client, key_ids[0]));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_KeyExportResponse(client, label,
+            sizeof(label), out, &outSz));
+    WH_TEST_ASSERT_RETURN(outSz == sizeof(key1));
+    WH_TEST_ASSERT_RETURN(memcmp(out, key1, sizeof(key1)) == 0);
+    outSz = sizeof(out);
+    WH_TEST_RETURN_ON_FAIL(wh_Client_KeyExportRequest(client, kek_id));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_KeyExportResponse(client, label,
+            sizeof(label), out, &outSz));
+    WH_TEST_ASSERT_RETURN(outSz == sizeof(kek));
+    WH_TEST_ASSERT_RETURN(memcmp(out, kek, sizeof(kek)) == 0);
+
+    for (i = 0; i < 2; i++) {
+        WH_TEST_RETURN_ON_FAIL(wh_Client_KeyEraseRequest(client, key_ids[i]));
+        WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+        WH_TEST_RETURN_ON_FAIL(wh_Client_KeyEraseResponse(client));
+    }
+    WH_TEST_RETURN_ON_FAIL(wh_Client_KeyEvictRequest(client, kek_id));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_KeyEvictResponse(client));
+#else
+    memset(blob, 0, sizeof(blob));
+
+    WH_TEST_ASSERT_RETURN(WH_ERROR_BADARGS ==
+            wh_Client_KeyWrapImportRequest(client, 1, blob, 0));
+
+    /* Without crypto the requests are framed but not handled */
+    blob_len = sizeof(blob);
+    WH_TEST_RETURN_ON_FAIL(wh_Client_KeyWrapExportRequest(client, 1, cursor,
+            blob_len));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_KeyWrapExportResponse(client,
+            &server_rc, blob, &blob_len, &count, &cursor, &done));
+    WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_NOHANDLER);
+    WH_TEST_ASSERT_RETURN(blob_len == 0);
+
+    WH_TEST_RETURN_ON_FAIL(wh_Client_KeyWrapImportRequest(client, 1, blob,
+            WH_KEYWRAP_BLOB_OVERHEAD + WH_KEYWRAP_RECORD_HDR_LEN));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(
+        wh_Client_KeyWrapImportResponse(client, &server_rc, &count));
+    WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_NOHANDLER);
+    WH_TEST_ASSERT_RETURN(count == 0);
+#endif
+
+    return WH_ERROR_OK;
+}
+
+static int _testBulk(whServerContext* server, whClientContext* client)
+{
+    void*         tmcc      = client->comm->transport_context;
+    int32_t       server_rc = 0;
+    const whNvmId id        = 0x71;
+    whNvmMetadata* meta     = NULL;
+    uint8_t*      data      = NULL;
+    uint8_t*      out       = NULL;
+    uint32_t      meta_off  = 0;
+    uint32_t      data_off  = 0;
+    uint32_t      out_off   = 0;
+    uint32_t      reuse_off = 0;
+    const uint32_t data_len = 3 * WH_TRANSPORT_MEM_BULK_SLOT_SIZE - 16;
+    uint32_t      i         = 0;
+
+    /* Slab allocations are slot aligned and freed slots are reused */
+    WH_TEST_RETURN_ON_FAIL(wh_TransportMem_BulkAlloc(tmcc, sizeof(*meta),
+            &meta_off, (void**)&meta));
+    WH_TEST_RETURN_ON_FAIL(wh_TransportMem_BulkAlloc(tmcc, data_len,
+            &data_off, (void**)&data));
+    WH_TEST_RETURN_ON_FAIL(wh_TransportMem_BulkAlloc(tmcc, data_len,
+            &out_off, (void**)&out));
+    WH_TEST_ASSERT_RETURN(data_off == meta_off +
+            WH_TRANSPORT_MEM_BULK_SLOT_SIZE);
+    WH_TEST_ASSERT_RETURN(out_off == data_off +
+            3 * WH_TRANSPORT_MEM_BULK_SLOT_SIZE);
+    WH_TEST_RETURN_ON_FAIL(wh_TransportMem_BulkFree(tmcc, data_off, data_len));
+    WH_TEST_RETURN_ON_FAIL(wh_TransportMem_BulkAlloc(tmcc,
+            WH_TRANSPORT_MEM_BULK_SLOT_SIZE, &reuse_off, NULL));
+    WH_TEST_ASSERT_RETURN(reuse_off == data_off);
+    WH_TEST_RETURN_ON_FAIL(wh_TransportMem_BulkFree(tmcc, reuse_off,
+            WH_TRANSPORT_MEM_BULK_SLOT_SIZE));
+    WH_TEST_RETURN_ON_FAIL(wh_TransportMem_BulkAlloc(tmcc, data_len,
+            &data_off, (void**)&data));
+    WH_TEST_ASSERT_RETURN(WH_ERROR_NOSPACE == wh_TransportMem_BulkAlloc(tmcc,
+            WH_TRANSPORT_MEM_BULK_MAX_SLOTS * WH_TRANSPORT_MEM_BULK_SLOT_SIZE,
+            &reuse_off, NULL));
+
+    /* Add and read back an object without copying it through the packet */
+    memset(meta, 0, sizeof(*meta));
+    meta->id = id;
+    memcpy(meta->label, "Bulk", sizeof("Bulk"));
+    for (i = 0; i < data_len; i++) {
+        data[i] = (uint8_t)i;
+    }
+    WH_TEST_RETURN_ON_FAIL(wh_Client_NvmAddObjectBulkRequest(client, meta_off,
+            data_len, data_off));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(
+        wh_Client_NvmAddObjectBulkResponse(client, &server_rc));
+    WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
+
+    memset(out, 0, data_len);
+    WH_TEST_RETURN_ON_FAIL(wh_Client_NvmReadBulkRequest(client, id, 0,
+            data_len, out_off));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_NvmReadBulkResponse(client, &server_rc));
+    WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
+    WH_TEST_ASSERT_RETURN(memcmp(out, data, data_len) == 0);
+
+    /* Ranges outside the region are refused by the server */
+    WH_TEST_RETURN_ON_FAIL(wh_Client_NvmReadBulkRequest(client, id, 0,
+            data_len, BUFFER_SIZE - 1));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_NvmReadBulkResponse(client, &server_rc));
+    WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_ACCESS);
+
+    WH_TEST_RETURN_ON_FAIL(wh_Client_NvmDestroyObjectsRequest(client, 1, &id));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(
+        wh_Client_NvmDestroyObjectsResponse(client, &server_rc));
+    WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
+
+    WH_TEST_RETURN_ON_FAIL(wh_TransportMem_BulkFree(tmcc, meta_off,
+            sizeof(*meta)));
+    WH_TEST_RETURN_ON_FAIL(wh_TransportMem_BulkFree(tmcc, data_off, data_len));
+    WH_TEST_RETURN_ON_FAIL(wh_TransportMem_BulkFree(tmcc, out_off, data_len));
+
+    return WH_ERROR_OK;
+}
+
+static int _testNvmDestroyMatching(whServerContext* server,
+        whClientContext* client)
+{
+    int32_t       server_rc = 0;
+    whNvmId       count     = 0;
+    whNvmFilter   filter    = {0};
+    uint8_t       label[WOLFHSM_NVM_LABEL_LEN] = "Filtered";
+    const uint8_t data[]    = "Destroyed together";
+    whNvmId       id        = 0;
+
+    for (id = 0x81; id <= 0x84; id++) {
+        WH_TEST_RETURN_ON_FAIL(wh_Client_NvmAddObjectRequest(client, id,
+                (whNvmAccess)(id & 1), 0, sizeof(label), label, sizeof(data),
+                data));
+        WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+        WH_TEST_RETURN_ON_FAIL(
+            wh_Client_NvmAddObjectResponse(client, &server_rc));
+        WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
+    }
+
+    /* Only the odd access values in the range */
+    filter.id_first     = 0x81;
+    filter.id_last      = 0x84;
+    filter.access_mask  = 1;
+    filter.access_match = 1;
+    WH_TEST_RETURN_ON_FAIL(wh_Client_NvmDestroyMatchingRequest(client,
+            &filter));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_NvmDestroyMatchingResponse(client,
+            &server_rc, &count));
+    WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
+    WH_TEST_ASSERT_RETURN(count == 2);
+
+    /* Then the rest of the range */
+    filter.access_mask  = 0;
+    filter.access_match = 0;
+    WH_TEST_RETURN_ON_FAIL(wh_Client_NvmDestroyMatchingRequest(client,
+            &filter));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_NvmDestroyMatchingResponse(client,
+            &server_rc, &count));
+    WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
+    WH_TEST_ASSERT_RETURN(count == 2);
+
+    WH_TEST_ASSERT_RETURN(WH_ERROR_BADARGS ==
+            wh_Client_NvmDestroyMatchingRequest(client, NULL));
+
+    return WH_ERROR_OK;
+}
+
+static int _busySendCount = 0;
+
+/* Server transport Send that reports busy a set number of times */
+static int _busySend(void* context, uint16_t size, const void* data)
+{
+    if (_busySendCount > 0) {
+        _busySendCount--;
+        return WH_ERROR_NOTREADY;
+    }
+    return wh_TransportMem_SendResponse(context, size, data);
+}
+
+static int _testDeferredResponse(whServerContext* server,
+        whClientContext* client)
+{
+    const whTransportServerCb* saved_cb = server->comm->transport_cb;
+    whTransportServerCb busy_cb[1] = {WH_TRANSPORT_MEM_SERVER_CB};
+    char     send_buffer[] = "Deferred";
+    char     recv_buffer[sizeof(send_buffer)] = {0};
+    uint16_t recv_len = 0;
+
+    busy_cb->Send = _busySend;
+    server->comm->transport_cb = busy_cb;
+
+    /* The response is held instead of spinning while the transport is busy */
+    _busySendCount = 2;
+    WH_TEST_RETURN_ON_FAIL(wh_Client_EchoRequest(client, sizeof(send_buffer),
+            send_buffer));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_ASSERT_RETURN(server->pending->active == 1);
+    WH_TEST_ASSERT_RETURN(WH_ERROR_NOTREADY ==
+            wh_Client_EchoResponse(client, &recv_len, recv_buffer));
+
+    /* Later calls retry the held response before receiving anything new */
+    WH_TEST_ASSERT_RETURN(WH_ERROR_NOTREADY ==
+            wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_ASSERT_RETURN(server->pending->active == 0);
+    WH_TEST_RETURN_ON_FAIL(
+        wh_Client_EchoResponse(client, &recv_len, recv_buffer));
+    WH_TEST_ASSERT_RETURN(recv_len == sizeof(send_buffer));
+    WH_TEST_ASSERT_RETURN(memcmp(recv_buffer, send_buffer, recv_len) == 0);
+
+    server->comm->transport_cb = saved_cb;
+    return WH_ERROR_OK;
+}
+
+static int _testNvmGc(whServerContext* server)
+{
+    whServerNvmGcConfig gcConfig = {0};
+    whNvmMetadata meta = {.id = 0x50, .label = "Gc"};
+    uint8_t data[32];
+    uint32_t reclaimSize = 0;
+    whNvmId reclaimObjects = 0;
+    whNvmId availObjects = 0;
+    int i = 0;
+
+    memset(data, 0x5A, sizeof(data));
+    server->nvmGc->config = &gcConfig;
+    server->nvmGc->idleCount = 0;
+    server->nvmGc->inlineCount = 0;
+
+    /* With no thresholds, overwriting past the directory size only succeeds
+     * by compacting inline */
+    for (i = 0; i < WOLFHSM_NUM_NVMOBJECTS + 2; i++) {
+        WH_TEST_RETURN_ON_FAIL(
+            wh_Server_NvmAddObject(server, &meta, sizeof(data), data));
+    }
+    WH_TEST_ASSERT_RETURN(server->nvmGc->inlineCount > 0);
+    WH_TEST_ASSERT_RETURN(server->nvmGc->idleCount == 0);
+    WH_TEST_ASSERT_RETURN(WH_ERROR_NOTREADY ==
+            wh_Server_HandleRequestMessage(server));
+    WH_TEST_ASSERT_RETURN(server->nvmGc->idleCount == 0);
+
+    /* Idle compaction once the reclaimable entry threshold is crossed */
+    gcConfig.reclaimObjects = 2;
+    for (i = 0; i < 2; i++) {
+        WH_TEST_RETURN_ON_FAIL(
+            wh_Server_NvmAddObject(server, &meta, sizeof(data), data));
+    }
+    WH_TEST_ASSERT_RETURN(WH_ERROR_NOTREADY ==
+            wh_Server_HandleRequestMessage(server));
+    WH_TEST_ASSERT_RETURN(server->nvmGc->idleCount == 1);
+    WH_TEST_RETURN_ON_FAIL(wh_Nvm_GetAvailable(server->nvm, NULL, NULL,
+            &reclaimSize, &reclaimObjects));
+    WH_TEST_ASSERT_RETURN((reclaimSize == 0) && (reclaimObjects == 0));
+
+    /* Nothing left to reclaim, so further idle calls do not compact */
+    WH_TEST_ASSERT_RETURN(WH_ERROR_NOTREADY ==
+            wh_Server_HandleRequestMessage(server));
+    WH_TEST_ASSERT_RETURN(server->nvmGc->idleCount == 1);
+
+    /* Running low does not compact when compacting cannot clear it */
+    gcConfig.reclaimObjects = 0;
+    gcConfig.availObjects = WOLFHSM_NUM_NVMOBJECTS + 1;
+    WH_TEST_RETURN_ON_FAIL(
+        wh_Server_NvmAddObject(server, &meta, sizeof(data), data));
+    for (i = 0; i < 2; i++) {
+        WH_TEST_ASSERT_RETURN(WH_ERROR_NOTREADY ==
+                wh_Server_HandleRequestMessage(server));
+    }
+    WH_TEST_ASSERT_RETURN(server->nvmGc->idleCount == 1);
+    WH_TEST_ASSERT_RETURN(server->nvmGc->generation ==
+            wh_Nvm_GetGeneration(server->nvm));
+
+    /* It does once compacting gets back to the threshold */
+    WH_TEST_RETURN_ON_FAIL(wh_Nvm_GetAvailable(server->nvm, NULL,
+            &availObjects, NULL, &reclaimObjects));
+    WH_TEST_ASSERT_RETURN(reclaimObjects > 0);
+    gcConfig.availObjects = availObjects + reclaimObjects;
+    WH_TEST_RETURN_ON_FAIL(
+        wh_Server_NvmAddObject(server, &meta, sizeof(data), data));
+    for (i = 0; i < 2; i++) {
+        WH_TEST_ASSERT_RETURN(WH_ERROR_NOTREADY ==
+                wh_Server_HandleRequestMessage(server));
+    }
+    WH_TEST_ASSERT_RETURN(server->nvmGc->idleCount == 2);
+    WH_TEST_RETURN_ON_FAIL(wh_Nvm_GetAvailable(server->nvm, NULL,
+            &availObjects, NULL, &reclaimObjects));
+    WH_TEST_ASSERT_RETURN(reclaimObjects == 0);
+    WH_TEST_ASSERT_RETURN(availObjects >= gcConfig.availObjects);
+
+    WH_TEST_RETURN_ON_FAIL(wh_Nvm_DestroyObjects(server->nvm, 1, &meta.id));
+    server->nvmGc->config = NULL;
+    return WH_ERROR_OK;
+}
+
+#if defined(WH_CFG_TEST_POSIX)
+/* Hold a submitted copy back from the helper thread until released, so the
+ * destination can be checked between submit and completion */
+static int         _dmaGateHeld = 0;
+static void*       _dmaGateDst  = NULL;
+static const void* _dmaGateSrc  = NULL;
+static size_t      _dmaGateLen  = 0;
+
+static int _dmaGateSubmit(void* c, void* dst, const void* src, size_t len)
+{
+    if (_dmaGateHeld == 0) {
+        return posixDmaEngine_Submit(c, dst, src, len);
+    }
+    _dmaGateDst = dst;
+    _dmaGateSrc = src;
+    _dmaGateLen = len;
+    return WH_ERROR_OK;
+}
+
+static int _dmaGatePoll(void* c)
+{
+    int rc = 0;
+
+    if (_dmaGateHeld != 0) {
+        return WH_ERROR_NOTREADY;
+    }
+    if (_dmaGateLen != 0) {
+        rc = posixDmaEngine_Submit(c, _dmaGateDst, _dmaGateSrc, _dmaGateLen);
+        _dmaGateLen = 0;
+        if (rc != 0) {
+            return rc;
+        }
+    }
+    return posixDmaEngine_Poll(c);
+}
+
+static int _testDmaEngine(whServerContext* server, whClientContext* client)
+{
+    const whServerDmaEngineCb engineCb[1] = {POSIX_DMA_ENGINE_CB};
+    const whServerDmaEngineCb gateCb[1] = {{
+        .Init    = posixDmaEngine_Init,
+        .Cleanup = posixDmaEngine_Cleanup,
+        .Submit  = _dmaGateSubmit,
+        .Poll    = _dmaGatePoll,
+    }};
+    posixDmaEngineContext engineCtx[1] = {0};
+    whNvmMetadata meta = {.id = 0x60, .label = "DmaEngine"};
+    static uint8_t data[3 * WOLFHSM_DMA_STAGE_LEN + 17];
+    static uint8_t readBack[sizeof(data)];
+    int32_t server_rc = 0;
+    size_t i = 0;
+
+    for (i = 0; i < sizeof(data); i++) {
+        data[i] = (uint8_t)i;
+    }
+    WH_TEST_RETURN_ON_FAIL(wh_Nvm_AddObject(server->nvm, &meta,
+            sizeof(data), data));
+
+    WH_TEST_RETURN_ON_FAIL(posixDmaEngine_Init(engineCtx, NULL));
+    server->dma.engineCb = gateCb;
+    server->dma.engineContext = engineCtx;
+
+    /* Submit leaves the copy to the engine instead of copying itself */
+    memset(readBack, 0, sizeof(readBack));
+    _dmaGateHeld = 1;
+    WH_TEST_RETURN_ON_FAIL(wh_Server_DmaCopySubmit(server, readBack, data,
+            sizeof(data)));
+    WH_TEST_ASSERT_RETURN(WH_ERROR_NOTREADY == wh_Server_DmaCopyPoll(server));
+    for (i = 0; i < sizeof(readBack); i++) {
+        WH_TEST_ASSERT_RETURN(readBack[i] == 0);
+    }
+    _dmaGateHeld = 0;
+    WH_TEST_RETURN_ON_FAIL(wh_Server_DmaCopyWait(server));
+    WH_TEST_ASSERT_RETURN(0 == memcmp(readBack, data, sizeof(data)));
+    server->dma.engineCb = engineCb;
+
+    /* NVM reads are staged through the engine in several chunks */
+    memset(readBack, 0, sizeof(readBack));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_NvmReadDmaRequest(client, meta.id, 0,
+            sizeof(readBack), readBack));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_NvmReadDmaResponse(client, &server_rc));
+    WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
+    WH_TEST_ASSERT_RETURN(0 == memcmp(readBack, data, sizeof(data)));
+    WH_TEST_ASSERT_RETURN(WH_ERROR_OK == wh_Server_DmaCopyPoll(server));
+
+    server->dma.engineCb = NULL;
+    server->dma.engineContext = NULL;
+    WH_TEST_RETURN_ON_FAIL(posixDmaEngine_Cleanup(engineCtx));
+    WH_TEST_RETURN_ON_FAIL(wh_Nvm_DestroyObjects(server->nvm, 1, &meta.id));
+    return WH_ERROR_OK;
+}
+#endif
+
+static int _testImage(whServerContext* server, whClientContext* client)
+{
+    int32_t  server_rc = 0;
+    uint32_t offset    = 0;
+    uint8_t  done      = 0;
+    uint8_t  verified  = 0;
+    uint8_t  digest[WH_MESSAGE_IMAGE_MAX_DIGEST_LEN] = {0};
+    uint16_t digest_len = sizeof(digest);
+    static uint8_t image[3000];
+    size_t   i;
+
+    for (i = 0; i < sizeof(image); i++) {
+        image[i] = (uint8_t)i;
+    }
+
+#if !defined(WOLFHSM_NO_CRYPTO) && defined(HAVE_ECC)
+    {
+        WC_RNG   rng[1];
+        ecc_key  key[1];
+        uint8_t  raw[3 * 32];
+        word32   qxLen = 32;
+        word32   qyLen = 32;
+        word32   dLen  = 32;
+        uint8_t  hash[WC_SHA256_DIGEST_SIZE];
+        uint8_t  sig[ECC_MAX_SIG_SIZE];
+        word32   sigLen = sizeof(sig);
+        uint16_t keyId  = 0;
+        uint8_t  label[] = "ImageKey";
+
+        WH_TEST_RETURN_ON_FAIL(wc_InitRng(rng));
+        WH_TEST_RETURN_ON_FAIL(wc_ecc_init(key));
+        WH_TEST_RETURN_ON_FAIL(wc_ecc_make_key(rng, 32, key));
+        WH_TEST_RETURN_ON_FAIL(wc_ecc_export_private_raw(key, raw, &qxLen,
+                raw + qxLen, &qyLen, raw + qxLen + qyLen, &dLen));
+        WH_TEST_RETURN_ON_FAIL(wc_Sha256Hash(image, sizeof(image), hash));
+        WH_TEST_RETURN_ON_FAIL(wc_ecc_sign_hash(hash, sizeof(hash), sig,
+                &sigLen, rng, key));
+        wc_ecc_free(key);
+        wc_FreeRng(rng);
+
+        WH_TEST_RETURN_ON_FAIL(wh_Client_KeyCacheRequest(client, 0, label,
+                sizeof(label), raw, qxLen + qyLen + dLen));
+        WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+        WH_TEST_RETURN_ON_FAIL(wh_Client_KeyCacheResponse(client, &keyId));
+
+        /* Hash 1KB per request to exercise the resumable path */
+        WH_TEST_RETURN_ON_FAIL(wh_Client_ImageVerifyDma64Request(client,
+                (uint64_t)((uintptr_t)image), sizeof(image), 1024, keyId,
+                ECC_SECP256R1, WH_IMAGE_HASH_SHA256, sig, sigLen));
+        WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+        WH_TEST_RETURN_ON_FAIL(wh_Client_ImageVerifyDma64Response(client,
+                &server_rc, &offset, &done, &verified, digest, &digest_len));
+        WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
+        WH_TEST_ASSERT_RETURN(offset == 1024);
+        WH_TEST_ASSERT_RETURN(done == 0);
+
+        while (done == 0) {
+            WH_TEST_RETURN_ON_FAIL(wh_Client_ImageContinueRequest(client,
+                    1024));
+            WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+            WH_TEST_RETURN_ON_FAIL(wh_Client_ImageContinueResponse(client,
+                    &server_rc, &offset, &done, &verified, digest,
+                    &digest_len));
+            WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
+        }
+        WH_TEST_ASSERT_RETURN(offset == sizeof(image));
+        WH_TEST_ASSERT_RETURN(verified == 1);
+        WH_TEST_ASSERT_RETURN(digest_len == sizeof(hash));
+        WH_TEST_ASSERT_RETURN(0 == memcmp(digest, hash, sizeof(hash)));
+
+        /* A modified image must not verify */
+        image[0] ^= 0xFF;
+        WH_TEST_RETURN_ON_FAIL(wh_Client_ImageVerifyDma64Request(client,
+                (uint64_t)((uintptr_t)image), sizeof(image), 0, keyId,
+                ECC_SECP256R1, WH_IMAGE_HASH_SHA256, sig, sigLen));
+        WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+        WH_TEST_RETURN_ON_FAIL(wh_Client_ImageVerifyDma64Response(client,
+                &server_rc, &offset, &done, &verified, digest, &digest_len));
+        WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
+        WH_TEST_ASSERT_RETURN(done == 1);
+        WH_TEST_ASSERT_RETURN(verified == 0);
+
+        WH_TEST_RETURN_ON_FAIL(wh_Client_KeyEvictRequest(client, keyId));
+        WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+        WH_TEST_RETURN_ON_FAIL(wh_Client_KeyEvictResponse(client));
+    }
+#else
+    {
+        const uint8_t sig[] = {0x30, 0x00};
+
+        /* Without crypto the request is framed but not handled */
+        WH_TEST_RETURN_ON_FAIL(wh_Client_ImageVerifyDma64Request(client,
+                (uint64_t)((uintptr_t)image), sizeof(image), 1024, 1, 0,
+                WH_IMAGE_HASH_SHA256, sig, sizeof(sig)));
+        WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+        WH_TEST_RETURN_ON_FAIL(wh_Client_ImageVerifyDma64Response(client,
+                &server_rc, &offset, &done, &verified, digest, &digest_len));
+        WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_NOHANDLER);
+        WH_TEST_ASSERT_RETURN(done == 0);
+
+        WH_TEST_RETURN_ON_FAIL(wh_Client_ImageContinueRequest(client, 0));
+        WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+        WH_TEST_RETURN_ON_FAIL(wh_Client_ImageContinueResponse(client,
+                &server_rc, &offset, &done, &verified, digest, &digest_len));
+        WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_NOHANDLER);
+    }
+#endif
+
+    return WH_ERROR_OK;
+}
+
+static int _testChaCha(whServerContext* server, whClientContext* client)
+{
+    int32_t  server_rc = 0;
+    uint16_t session   = 0;
+    uint16_t out_len   = 0;
+    uint8_t  iv[WH_CHACHA_IV_LEN];
+    uint8_t  tag[WH_CHACHA_TAG_LEN];
+    uint8_t  aad[20];
+    uint8_t  data[300];
+    uint8_t  out[sizeof(data)];
+
+    memset(iv, 0x0C, sizeof(iv));
+    memset(tag, 0, sizeof(tag));
+    memset(aad, 0xAD, sizeof(aad));
+    memset(data, 0x5D, sizeof(data));
+
+#if !defined(WOLFHSM_NO_CRYPTO) && defined(HAVE_CHACHA) && \
+    defined(HAVE_POLY1305)
+    {
+        uint8_t  label[WOLFHSM_NVM_LABEL_LEN] = "ChaChaKey";
+        uint8_t  key[WH_CHACHA_KEY_LEN];
+        uint8_t  shortKey[16];
+        uint8_t  refCipher[sizeof(data)];
+        uint8_t  refTag[WH_CHACHA_TAG_LEN];
+        uint8_t  plain[sizeof(data)];
+        uint16_t keyId = 0;
+        uint16_t shortId = 0;
+
+        memset(key, 0x4B, sizeof(key));
+        memset(shortKey, 0x53, sizeof(shortKey));
+        WH_TEST_RETURN_ON_FAIL(wc_ChaCha20Poly1305_Encrypt(key, iv, aad,
+                sizeof(aad), data, sizeof(data), refCipher, refTag));
+
+        WH_TEST_RETURN_ON_FAIL(wh_Client_KeyCacheRequest(client, 0, label,
+                sizeof(label), key, sizeof(key)));
+        WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+        WH_TEST_RETURN_ON_FAIL(wh_Client_KeyCacheResponse(client, &keyId));
+
+        /* One-shot encrypt matches wolfCrypt */
+        WH_TEST_RETURN_ON_FAIL(wh_Client_ChaChaCryptRequest(client, keyId, 1,
+                iv, aad, sizeof(aad), data, sizeof(data), NULL));
+        WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+        out_len = sizeof(out);
+        WH_TEST_RETURN_ON_FAIL(wh_Client_ChaChaCryptResponse(client,
+                &server_rc, out, &out_len, tag));
+        WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
+        WH_TEST_ASSERT_RETURN(out_len == sizeof(data));
+        WH_TEST_ASSERT_RETURN(0 == memcmp(out, refCipher, sizeof(out)));
+        WH_TEST_ASSERT_RETURN(0 == memcmp(tag, refTag, sizeof(tag)));
+
+        /* One-shot decrypt, then with a modified tag */
+        WH_TEST_RETURN_ON_FAIL(wh_Client_ChaChaCryptRequest(client, keyId, 0,
+                iv, aad, sizeof(aad), refCipher, sizeof(refCipher), refTag));
+        WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+        out_len = sizeof(plain);
+        WH_TEST_RETURN_ON_FAIL(wh_Client_ChaChaCryptResponse(client,
+                &server_rc, plain, &out_len, NULL));
+        WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
+        WH_TEST_ASSERT_RETURN(0 == memcmp(plain, data, sizeof(data)));
+
+        refTag[0] ^= 0x01;
+        WH_TEST_RETURN_ON_FAIL(wh_Client_ChaChaCryptRequest(client, keyId, 0,
+                iv, aad, sizeof(aad), refCipher, sizeof(refCipher), refTag));
+        WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+        out_len = sizeof(plain);
+        WH_TEST_RETURN_ON_FAIL(wh_Client_ChaChaCryptResponse(client,
+                &server_rc, plain, &out_len, NULL));
+        WH_TEST_ASSERT_RETURN(server_rc != WH_ERROR_OK);
+        WH_TEST_ASSERT_RETURN(out_len == 0);
+        refTag[0] ^= 0x01;
+
+        /* Streaming over uneven pieces produces the same result */
+        WH_TEST_RETURN_ON_FAIL(wh_Client_ChaChaInitRequest(client, keyId, 1,
+                iv));
+        WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+        WH_TEST_RETURN_ON_FAIL(wh_Client_ChaChaInitResponse(client,
+                &server_rc, &session));
+        WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
+        WH_TEST_RETURN_ON_FAIL(wh_Client_ChaChaUpdateRequest(client, session,
+                aad, sizeof(aad), data, 100));
+        WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+        out_len = sizeof(out);
+        WH_TEST_RETURN_ON_FAIL(wh_Client_ChaChaUpdateResponse(client,
+                &server_rc, out, &out_len));
+        WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
+        WH_TEST_ASSERT_RETURN(out_len == 100);
+        WH_TEST_RETURN_ON_FAIL(wh_Client_ChaChaUpdateRequest(client, session,
+                NULL, 0, data + 100, sizeof(data) - 100));
+        WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+        out_len = sizeof(out) - 100;
+        WH_TEST_RETURN_ON_FAIL(wh_Client_ChaChaUpdateResponse(client,
+                &server_rc, out + 100, &out_len));
+        WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
+        WH_TEST_RETURN_ON_FAIL(wh_Client_ChaChaFinalRequest(client, session,
+                NULL));
+        WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+        WH_TEST_RETURN_ON_FAIL(wh_Client_ChaChaFinalResponse(client,
+                &server_rc, tag));
+        WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
+        WH_TEST_ASSERT_RETURN(0 == memcmp(out, refCipher, sizeof(out)));
+        WH_TEST_ASSERT_RETURN(0 == memcmp(tag, refTag, sizeof(tag)));
+
+        /* The session ended with Final */
+        WH_TEST_RETURN_ON_FAIL(wh_Client_ChaChaFinalRequest(client, session,
+                NULL));
+        WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+        WH_TEST_RETURN_ON_FAIL(wh_Client_ChaChaFinalResponse(client,
+                &server_rc, tag));
+        WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_BADHANDLE);
+
+        /* DMA decrypts in place in client memory */
+        memcpy(out, refCipher, sizeof(out));
+        WH_TEST_RETURN_ON_FAIL(wh_Client_ChaChaCryptDmaRequest(client, keyId,
+                0, iv, (uint64_t)((uintptr_t)aad), sizeof(aad),
+                (uint64_t)((uintptr_t)out), (uint64_t)((uintptr_t)out),
+                sizeof(out), refTag));
+        WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+        WH_TEST_RETURN_ON_FAIL(wh_Client_ChaChaCryptDmaResponse(client,
+                &server_rc, NULL));
+        WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
+        WH_TEST_ASSERT_RETURN(0 == memcmp(out, data, sizeof(data)));
+
+#if defined(WH_CFG_TEST_POSIX)
+        /* Through a copy engine, AAD and data spanning several staging
+         * buffers give the same result */
+        {
+            const whServerDmaEngineCb engineCb[1] = {POSIX_DMA_ENGINE_CB};
+            posixDmaEngineContext engineCtx[1] = {0};
+            static uint8_t big[2 * WOLFHSM_DMA_STAGE_LEN + 33];
+            static uint8_t bigRef[sizeof(big)];
+            static uint8_t bigOut[sizeof(big)];
+            size_t i = 0;
+
+            for (i = 0; i < sizeof(big); i++) {
+                big[i] = (uint8_t)i;
+            }
+            WH_TEST_RETURN_ON_FAIL(wc_ChaCha20Poly1305_Encrypt(key, iv, big,
+                    sizeof(big), big, sizeof(big), bigRef, refTag));
+            WH_TEST_RETURN_ON_FAIL(posixDmaEngine_Init(engineCtx, NULL));
+            server->dma.engineCb = engineCb;
+            server->dma.engineContext = engineCtx;
+            memset(bigOut, 0, sizeof(bigOut));
+            WH_TEST_RETURN_ON_FAIL(wh_Client_ChaChaCryptDmaRequest(client,
+                    keyId, 1, iv, (uint64_t)((uintptr_t)big), sizeof(big),
+                    (uint64_t)((uintptr_t)big), (uint64_t)((uintptr_t)bigOut),
+                    sizeof(big), NULL));
+            WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+            server->dma.engineCb = NULL;
+            server->dma.engineContext = NULL;
+            WH_TEST_RETURN_ON_FAIL(posixDmaEngine_Cleanup(engineCtx));
+            WH_TEST_RETURN_ON_FAIL(wh_Client_ChaChaCryptDmaResponse(client,
+                    &server_rc, tag));
+            WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
+            WH_TEST_ASSERT_RETURN(0 == memcmp(bigOut, bigRef, sizeof(big)));
+            WH_TEST_ASSERT_RETURN(0 == memcmp(tag, refTag, sizeof(tag)));
+        }
+#endif
+
+        /* Only 256-bit keys are accepted */
+        WH_TEST_RETURN_ON_FAIL(wh_Client_KeyCacheRequest(client, 0, label,
+                sizeof(label), shortKey, sizeof(shortKey)));
+        WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+        WH_TEST_RETURN_ON_FAIL(wh_Client_KeyCacheResponse(client, &shortId));
+        WH_TEST_RETURN_ON_FAIL(wh_Client_ChaChaInitRequest(client, shortId, 1,
+                iv));
+        WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+        WH_TEST_RETURN_ON_FAIL(wh_Client_ChaChaInitResponse(client,
+                &server_rc, &session));
+        WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_BADARGS);
+
+        WH_TEST_RETURN_ON_FAIL(wh_Client_KeyEvictRequest(client, shortId));
+        WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+        WH_TEST_RETURN_ON_FAIL(wh_Client_KeyEvictResponse(client));
+        WH_TEST_RETURN_ON_FAIL(wh_Client_KeyEvictRequest(client, keyId));
+        WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+        WH_TEST_RETURN_ON_FAIL(wh_Client_KeyEvictResponse(client));
+    }
+#else
+    WH_TEST_ASSERT_RETURN(WH_ERROR_BADARGS ==
+            wh_Client_ChaChaCryptRequest(client, 1, 0, iv, NULL, 0, data,
+                sizeof(data), NULL));
+    WH_TEST_ASSERT_RETURN(WH_ERROR_BADARGS ==
+            wh_Client_ChaChaUpdateRequest(client, 1, data, sizeof(data), out,
+                WH_MESSAGE_CHACHA_MAX_INLINE_LEN));
+
+    /* Without crypto the requests are framed but not handled */
+    WH_TEST_RETURN_ON_FAIL(wh_Client_ChaChaCryptRequest(client, 1, 1, iv,
+            aad, sizeof(aad), data, sizeof(data), NULL));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    out_len = sizeof(out);
+    WH_TEST_RETURN_ON_FAIL(wh_Client_ChaChaCryptResponse(client, &server_rc,
+            out, &out_len, tag));
+    WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_NOHANDLER);
+    WH_TEST_ASSERT_RETURN(out_len == 0);
+
+    WH_TEST_RETURN_ON_FAIL(wh_Client_ChaChaInitRequest(client, 1, 1, iv));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_ChaChaInitResponse(client, &server_rc,
+            &session));
+    WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_NOHANDLER);
+
+    WH_TEST_RETURN_ON_FAIL(wh_Client_ChaChaUpdateRequest(client, 1, aad,
+            sizeof(aad), data, sizeof(data)));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    out_len = sizeof(out);
+    WH_TEST_RETURN_ON_FAIL(wh_Client_ChaChaUpdateResponse(client, &server_rc,
+            out, &out_len));
+    WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_NOHANDLER);
+
+    WH_TEST_RETURN_ON_FAIL(wh_Client_ChaChaFinalRequest(client, 1, NULL));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_ChaChaFinalResponse(client, &server_rc,
+            tag));
+    WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_NOHANDLER);
+
+    WH_TEST_RETURN_ON_FAIL(wh_Client_ChaChaCryptDmaRequest(client, 1, 1, iv,
+            (uint64_t)((uintptr_t)aad), sizeof(aad),
+            (uint64_t)((uintptr_t)data), (uint64_t)((uintptr_t)out),
+            sizeof(data), NULL));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_ChaChaCryptDmaResponse(client,
+            &server_rc, tag));
+    WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_NOHANDLER);
+#endif
+
+    return WH_ERROR_OK;
+}
+
+/* Round trip one Exec through the request and response halves */
+static int _preparedExec(whServerContext* server, whClientContext* client,
+        uint16_t handle, const uint8_t* iv, uint16_t iv_len,
+        const uint8_t* aad, uint16_t aad_len, const uint8_t* in,
+        uint16_t in_len, const uint8_t* tag, uint16_t tag_len, uint8_t* out,
+        uint16_t* inout_out_len, int32_t* out_rc)
+{
+    WH_TEST_RETURN_ON_FAIL(wh_Client_PreparedExecRequest(client, handle, iv,
+            iv_len, aad, aad_len, in, in_len, tag, tag_len));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    return wh_Client_PreparedExecResponse(client, out_rc, out,
+            inout_out_len);
+}
+
+static int _preparedClose(whServerContext* server, whClientContext* client,
+        uint16_t handle, int32_t* out_rc)
+{
+    WH_TEST_RETURN_ON_FAIL(wh_Client_PreparedCloseRequest(client, handle));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    return wh_Client_PreparedCloseResponse(client, out_rc);
+}
+
+static int _testPrepared(whServerContext* server, whClientContext* client)
+{
+    int32_t  server_rc = 0;
+    uint16_t handle    = 0;
+    uint16_t out_len   = 0;
+    uint8_t  iv[12];
+    uint8_t  tag[16];
+    uint8_t  aad[20];
+    uint8_t  data[200];
+    uint8_t  out[sizeof(data) + sizeof(tag)];
+
+    memset(iv, 0x1C, sizeof(iv));
+    memset(tag, 0, sizeof(tag));
+    memset(aad, 0xAD, sizeof(aad));
+    memset(data, 0x5D, sizeof(data));
+
+#if !defined(WOLFHSM_NO_CRYPTO) && defined(HAVE_AESGCM) && defined(HAVE_ECC)
+    {
+        uint8_t  label[WOLFHSM_NVM_LABEL_LEN] = "PreparedKey";
+        uint8_t  key[16];
+        uint8_t  refCipher[sizeof(data)];
+        uint8_t  refTag[sizeof(tag)];
+        uint8_t  plain[sizeof(data)];
+        uint8_t  raw[3 * 32];
+        word32   qxLen = 32;
+        word32   qyLen = 32;
+        word32   dLen  = 32;
+        uint8_t  hash[32];
+        int      verified = 0;
+        uint16_t keyId  = 0;
+        uint16_t eccId  = 0;
+        uint16_t encH   = 0;
+        uint16_t decH   = 0;
+        uint16_t signH  = 0;
+        uint16_t fillH  = 0;
+        uint16_t firstH = 0;
+        whNvmId  eccNvmId = 0;
+        uint8_t  clientId = 0;
+        Aes      ref[1];
+        WC_RNG   rng[1];
+        ecc_key  ecc[1];
+        int      i;
+
+        memset(key, 0x4B, sizeof(key));
+        memset(hash, 0x48, sizeof(hash));
+        WH_TEST_RETURN_ON_FAIL(wc_AesInit(ref, NULL, INVALID_DEVID));
+        WH_TEST_RETURN_ON_FAIL(wc_AesGcmSetKey(ref, key, sizeof(key)));
+        WH_TEST_RETURN_ON_FAIL(wc_AesGcmEncrypt(ref, refCipher, data,
+                sizeof(data), iv, sizeof(iv), refTag, sizeof(refTag), aad,
+                sizeof(aad)));
+        wc_AesFree(ref);
+
+        WH_TEST_RETURN_ON_FAIL(wh_Client_KeyCacheRequest(client, 0, label,
+                sizeof(label), key, sizeof(key)));
+        WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+        WH_TEST_RETURN_ON_FAIL(wh_Client_KeyCacheResponse(client, &keyId));
+
+        /* One prepared encrypt serves repeated calls */
+        WH_TEST_RETURN_ON_FAIL(wh_Client_PrepareAesGcmRequest(client, keyId,
+                1, sizeof(iv), sizeof(tag)));
+        WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+        WH_TEST_RETURN_ON_FAIL(wh_Client_PrepareResponse(client, &server_rc,
+                &encH));
+        WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
+        WH_TEST_ASSERT_RETURN(encH != 0);
+        for (i = 0; i < 2; i++) {
+            out_len = sizeof(out);
+            WH_TEST_RETURN_ON_FAIL(_preparedExec(server, client, encH, iv,
+                    sizeof(iv), aad, sizeof(aad), data, sizeof(data), NULL,
+                    0, out, &out_len, &server_rc));
+            WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
+            WH_TEST_ASSERT_RETURN(out_len == sizeof(data) + sizeof(tag));
+            WH_TEST_ASSERT_RETURN(0 == memcmp(out, refCipher, sizeof(data)));
+            WH_TEST_ASSERT_RETURN(
+                    0 == memcmp(out + sizeof(data), refTag, sizeof(tag)));
+        }
+
+        /* An IV of the wrong length is rejected */
+        out_len = sizeof(out);
+        WH_TEST_RETURN_ON_FAIL(_preparedExec(server, client, encH, iv,
+                sizeof(iv) - 1, aad, sizeof(aad), data, sizeof(data), NULL, 0,
+                out, &out_len, &server_rc));
+        WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_BADARGS);
+        WH_TEST_ASSERT_RETURN(out_len == 0);
+
+        /* A failed tag check clears the output and keeps the handle */
+        WH_TEST_RETURN_ON_FAIL(wh_Client_PrepareAesGcm(client, keyId, 0,
+                sizeof(iv), sizeof(tag), &server_rc, &decH));
+        WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
+        refTag[0] ^= 0x01;
+        out_len = sizeof(plain);
+        WH_TEST_RETURN_ON_FAIL(_preparedExec(server, client, decH, iv,
+                sizeof(iv), aad, sizeof(aad), refCipher, sizeof(refCipher),
+                refTag, sizeof(refTag), plain, &out_len, &server_rc));
+        WH_TEST_ASSERT_RETURN(server_rc != WH_ERROR_OK);
+        WH_TEST_ASSERT_RETURN(out_len == 0);
+        refTag[0] ^= 0x01;
+        out_len = sizeof(plain);
+        WH_TEST_RETURN_ON_FAIL(_preparedExec(server, client, decH, iv,
+                sizeof(iv), aad, sizeof(aad), refCipher, sizeof(refCipher),
+                refTag, sizeof(refTag), plain, &out_len, &server_rc));
+        WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
+        WH_TEST_ASSERT_RETURN(out_len == sizeof(data));
+        WH_TEST_ASSERT_RETURN(0 == memcmp(plain, data, sizeof(data)));
+
+        /* Closed handles are gone */
+        WH_TEST_RETURN_ON_FAIL(_preparedClose(server, client, encH,
+                &server_rc));
+        WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
+        out_len = sizeof(out);
+        WH_TEST_RETURN_ON_FAIL(_preparedExec(server, client, encH, iv,
+                sizeof(iv), aad, sizeof(aad), data, sizeof(data), NULL, 0,
+                out, &out_len, &server_rc));
+        WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_BADHANDLE);
+        WH_TEST_RETURN_ON_FAIL(_preparedClose(server, client, encH,
+                &server_rc));
+        WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_BADHANDLE);
+
+        /* ECDSA signing with a private key imported once */
+        WH_TEST_RETURN_ON_FAIL(wc_InitRng(rng));
+        WH_TEST_RETURN_ON_FAIL(wc_ecc_init(ecc));
+        WH_TEST_RETURN_ON_FAIL(wc_ecc_make_key(rng, 32, ecc));
+        WH_TEST_RETURN_ON_FAIL(wc_ecc_export_private_raw(ecc, raw, &qxLen,
+                raw + qxLen, &qyLen, raw + qxLen + qyLen, &dLen));
+        wc_FreeRng(rng);
+        WH_TEST_RETURN_ON_FAIL(wh_Client_KeyCacheRequest(client, 0, label,
+                sizeof(label), raw, qxLen + qyLen + dLen));
+        WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+        WH_TEST_RETURN_ON_FAIL(wh_Client_KeyCacheResponse(client, &eccId));
+
+        WH_TEST_RETURN_ON_FAIL(wh_Client_PrepareEccSignRequest(client, eccId,
+                ECC_SECP256R1));
+        WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+        WH_TEST_RETURN_ON_FAIL(wh_Client_PrepareResponse(client, &server_rc,
+                &signH));
+        WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
+        out_len = sizeof(out);
+        WH_TEST_RETURN_ON_FAIL(_preparedExec(server, client, signH, NULL, 0,
+                NULL, 0, hash, sizeof(hash), NULL, 0, out, &out_len,
+                &server_rc));
+        WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
+        WH_TEST_RETURN_ON_FAIL(wc_ecc_verify_hash(out, out_len, hash,
+                sizeof(hash), &verified, ecc));
+        WH_TEST_ASSERT_RETURN(verified == 1);
+        wc_ecc_free(ecc);
+
+        /* Fill the table, then touch decH so signH is least recently used */
+        for (i = 0; i < WOLFHSM_NUM_PREPARED_OPS - 2; i++) {
+            WH_TEST_RETURN_ON_FAIL(wh_Client_PrepareAesGcm(client, keyId, 1,
+                    sizeof(iv), sizeof(tag), &server_rc, &fillH));
+            WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
+            if (i == 0) {
+                firstH = fillH;
+            }
+        }
+        out_len = sizeof(plain);
+        WH_TEST_RETURN_ON_FAIL(_preparedExec(server, client, decH, iv,
+                sizeof(iv), aad, sizeof(aad), refCipher, sizeof(refCipher),
+                refTag, sizeof(refTag), plain, &out_len, &server_rc));
+        WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
+        WH_TEST_RETURN_ON_FAIL(wh_Client_PrepareAesGcm(client, keyId, 1,
+                sizeof(iv), sizeof(tag), &server_rc, &handle));
+        WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
+        WH_TEST_ASSERT_RETURN(handle != signH);
+        out_len = sizeof(out);
+        WH_TEST_RETURN_ON_FAIL(_preparedExec(server, client, signH, NULL, 0,
+                NULL, 0, hash, sizeof(hash), NULL, 0, out, &out_len,
+                &server_rc));
+        WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_BADHANDLE);
+
+        /* A Prepare that fails to load its key closes nothing */
+        WH_TEST_RETURN_ON_FAIL(wh_Client_PrepareAesGcm(client, 0xFE, 1,
+                sizeof(iv), sizeof(tag), &server_rc, &fillH));
+        WH_TEST_ASSERT_RETURN(server_rc != WH_ERROR_OK);
+        out_len = sizeof(out);
+        WH_TEST_RETURN_ON_FAIL(_preparedExec(server, client, firstH, iv,
+                sizeof(iv), aad, sizeof(aad), data, sizeof(data), NULL, 0,
+                out, &out_len, &server_rc));
+        WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
+
+        /* Handles do not resolve for another client */
+        clientId = server->comm->client_id;
+        server->comm->client_id = clientId + 1;
+        out_len = sizeof(plain);
+        WH_TEST_RETURN_ON_FAIL(_preparedExec(server, client, decH, iv,
+                sizeof(iv), aad, sizeof(aad), refCipher, sizeof(refCipher),
+                refTag, sizeof(refTag), plain, &out_len, &server_rc));
+        WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_BADHANDLE);
+        server->comm->client_id = clientId;
+
+        /* Evicting the key closes everything prepared from it */
+        WH_TEST_RETURN_ON_FAIL(wh_Client_KeyEvictRequest(client, keyId));
+        WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+        WH_TEST_RETURN_ON_FAIL(wh_Client_KeyEvictResponse(client));
+        out_len = sizeof(plain);
+        WH_TEST_RETURN_ON_FAIL(_preparedExec(server, client, decH, iv,
+                sizeof(iv), aad, sizeof(aad), refCipher, sizeof(refCipher),
+                refTag, sizeof(refTag), plain, &out_len, &server_rc));
+        WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_BADHANDLE);
+        WH_TEST_RETURN_ON_FAIL(_preparedClose(server, client, handle,
+                &server_rc));
+        WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_BADHANDLE);
+
+        /* A disconnect closes the client's prepared operations */
+        WH_TEST_RETURN_ON_FAIL(wh_Client_PrepareEccSign(client, eccId,
+                ECC_SECP256R1, &server_rc, &signH));
+        WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
+        WH_TEST_RETURN_ON_FAIL(
+            wh_Server_SetConnected(server, WH_COMM_DISCONNECTED));
+        WH_TEST_RETURN_ON_FAIL(
+            wh_Server_SetConnected(server, WH_COMM_CONNECTED));
+        out_len = sizeof(out);
+        WH_TEST_RETURN_ON_FAIL(_preparedExec(server, client, signH, NULL, 0,
+                NULL, 0, hash, sizeof(hash), NULL, 0, out, &out_len,
+                &server_rc));
+        WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_BADHANDLE);
+
+        /* So does destroying the committed key through the NVM API */
+        WH_TEST_RETURN_ON_FAIL(wh_Client_KeyCommitRequest(client, eccId));
+        WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+        WH_TEST_RETURN_ON_FAIL(wh_Client_KeyCommitResponse(client));
+        WH_TEST_RETURN_ON_FAIL(wh_Client_PrepareEccSign(client, eccId,
+                ECC_SECP256R1, &server_rc, &signH));
+        WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
+        eccNvmId = MAKE_WOLFHSM_KEYID(WOLFHSM_KEYTYPE_CRYPTO,
+                server->comm->client_id, eccId);
+        WH_TEST_RETURN_ON_FAIL(wh_Client_NvmDestroyObjectsRequest(client, 1,
+                &eccNvmId));
+        WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+        WH_TEST_RETURN_ON_FAIL(
+            wh_Client_NvmDestroyObjectsResponse(client, &server_rc));
+        WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
+        out_len = sizeof(out);
+        WH_TEST_RETURN_ON_FAIL(_preparedExec(server, client, signH, NULL, 0,
+                NULL, 0, hash, sizeof(hash), NULL, 0, out, &out_len,
+                &server_rc));
+        WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_BADHANDLE);
+    }
+#else
+    WH_TEST_ASSERT_RETURN(WH_ERROR_BADARGS ==
+            wh_Client_PreparedExecRequest(client, 1, NULL, sizeof(iv), aad,
+                sizeof(aad), data, sizeof(data), NULL, 0));
+    WH_TEST_ASSERT_RETURN(WH_ERROR_BADARGS ==
+            wh_Client_PreparedExecRequest(client, 1, iv, sizeof(iv), aad,
+                sizeof(aad), out, WH_MESSAGE_PREPARED_MAX_INLINE_LEN, NULL,
+                0));
+
+    /* Without crypto the requests are framed but not handled */
+    WH_TEST_RETURN_ON_FAIL(wh_Client_PrepareAesGcmRequest(client, 1, 1,
+            sizeof(iv), sizeof(tag)));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_PrepareResponse(client, &server_rc,
+            &handle));
+    WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_NOHANDLER);
+
+    WH_TEST_RETURN_ON_FAIL(wh_Client_PrepareEccSignRequest(client, 1, 7));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_PrepareResponse(client, &server_rc,
+            &handle));
+    WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_NOHANDLER);
+
+    out_len = sizeof(out);
+    WH_TEST_RETURN_ON_FAIL(_preparedExec(server, client, 1, iv, sizeof(iv),
+            aad, sizeof(aad), data, sizeof(data), NULL, 0, out, &out_len,
+            &server_rc));
+    WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_NOHANDLER);
+    WH_TEST_ASSERT_RETURN(out_len == 0);
+
+    WH_TEST_RETURN_ON_FAIL(_preparedClose(server, client, 1, &server_rc));
+    WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_NOHANDLER);
+#endif
+
+    return WH_ERROR_OK;
+}
+
+static int _testDma(whServerContext* server, whClientContext* client)
+{
+    int        rc      = 0;
+    TestMemory testMem = {0};
+
+    const whServerDmaAddrAllowList allowList = {
+        .readList =
+            {
+                {&testMem.srvBufAllow, sizeof(testMem.srvBufAllow)},
+                {&testMem.srvRemapBufAllow, sizeof(testMem.srvRemapBufAllow)},
+            },
+        .writeList =
+            {
+                {&testMem.srvBufAllow, sizeof(testMem.srvBufAllow)},
+                {&testMem.srvRemapBufAllow, sizeof(testMem.srvRemapBufAllow)},
+            },
+    };
+
+    /* Register a custom DMA callback */
+    WH_TEST_RETURN_ON_FAIL(
+        wh_Server_DmaRegisterCb32(server, _customServerDma32Cb));
+    WH_TEST_RETURN_ON_FAIL(
+        wh_Server_DmaRegisterCb64(server, _customServerDma64Cb));
+
+    /* Register our custom allow list */
+    WH_TEST_RETURN_ON_FAIL(wh_Server_DmaRegisterAllowList(server, &allowList));
+
+    /* Check allowed operations for addresses in the allowlist */
+    WH_TEST_ASSERT_RETURN(
+        WH_ERROR_OK == wh_Server_DmaCheckMemOperAllowed(
+                           server, WH_DMA_OPER_CLIENT_READ_PRE,
+                           testMem.srvBufAllow, sizeof(testMem.srvBufAllow)));
+    WH_TEST_ASSERT_RETURN(
+        WH_ERROR_OK ==
+        wh_Server_DmaCheckMemOperAllowed(server, WH_DMA_OPER_CLIENT_READ_PRE,
+                                         testMem.srvRemapBufAllow,
+                                         sizeof(testMem.srvRemapBufAllow)));
+    WH_TEST_ASSERT_RETURN(
+        WH_ERROR_OK == wh_Server_DmaCheckMemOperAllowed(
+                           server, WH_DMA_OPER_CLIENT_WRITE_PRE,
+                           testMem.srvBufAllow, sizeof(testMem.srvBufAllow)));
+    WH_TEST_ASSERT_RETURN(
+        WH_ERROR_OK ==
+        wh_Server_DmaCheckMemOperAllowed(server, WH_DMA_OPER_CLIENT_WRITE_PRE,
+                                         testMem.srvRemapBufAllow,
+                                         sizeof(testMem.srvRemapBufAllow)));
+
+    /* Ensure an address not in the allowlist is denied for all operations */
+    WH_TEST_ASSERT_RETURN(WH_ERROR_ACCESS ==
+                          wh_Server_DmaCheckMemOperAllowed(
+                              server, WH_DMA_OPER_CLIENT_READ_PRE,
+                              testMem.srvBufDeny, sizeof(testMem.srvBufDeny)));
+    WH_TEST_ASSERT_RETURN(WH_ERROR_ACCESS ==
+                          wh_Server_DmaCheckMemOperAllowed(
+                              server, WH_DMA_OPER_CLIENT_WRITE_PRE,
+                              testMem.srvBufDeny, sizeof(testMem.srvBufDeny)));
+
+    /* Zero-sized operations should be denied */
+    WH_TEST_ASSERT_RETURN(
+        WH_ERROR_BADARGS ==
+        wh_Server_DmaCheckMemOperAllowed(server, WH_DMA_OPER_CLIENT_READ_PRE,
+                                         testMem.srvBufAllow, 0));
+    WH_TEST_ASSERT_RETURN(
+        WH_ERROR_BADARGS ==
+        wh_Server_DmaCheckMemOperAllowed(server, WH_DMA_OPER_CLIENT_WRITE_PRE,
+                                         testMem.srvBufAllow, 0));
+
+    /* Set known pattern in client Buffer */
+    memset(testMem.cliBuf, TEST_MEM_CLI_BYTE, sizeof(testMem.cliBuf));
+
+    /* Perform a copy from "client mem" to allowed "server mem" */
+    if (sizeof(void*) == sizeof(uint64_t)) {
+        /* 64-bit host system */
+        WH_TEST_RETURN_ON_FAIL(whServerDma_CopyFromClient64(
+            server, testMem.srvBufAllow, (uint64_t)((uintptr_t)testMem.cliBuf),
+            sizeof(testMem.cliBuf), (whServerDmaFlags){0}));
+    }
+    else if (sizeof(void*) == sizeof(uint32_t)) {
+        /* 32-bit host system */
+        WH_TEST_RETURN_ON_FAIL(whServerDma_CopyFromClient32(
+            server, testMem.srvBufAllow, (uint32_t)((uintptr_t)testMem.cliBuf),
+            sizeof(testMem.cliBuf), (whServerDmaFlags){0}));
+    }
+
+    /* Ensure data was copied */
+    WH_TEST_ASSERT_RETURN(0 == memcmp(testMem.cliBuf, testMem.srvBufAllow,
+                                      sizeof(testMem.cliBuf)));
+
+    /* custom DMA callback uses the tmp server buffer for input data and
+     * should set it to a known pattern on exit */
+    uint8_t tmp[sizeof(testMem.srvRemapBufAllow)];
+    memset(tmp, TEST_MEM_UNMAPPED_BYTE, sizeof(tmp));
+    WH_TEST_ASSERT_RETURN(0 == memcmp(testMem.srvRemapBufAllow, tmp,
+                                      sizeof(testMem.srvRemapBufAllow)));
+
+    /* Clear client data */
+    memset(testMem.cliBuf, 0, sizeof(testMem.cliBuf));
+    memset(testMem.srvRemapBufAllow, 0, sizeof(testMem.srvRemapBufAllow));
+
+    /* Perform a copy from "server mem" to "client mem" */
+    if (sizeof(void*) == sizeof(uint64_t)) {
+        /* 64-bit host system */
+        WH_TEST_RETURN_ON_FAIL(whServerDma_CopyToClient64(
+            server, (uint64_t)((uintptr_t)testMem.cliBuf), testMem.srvBufAllow,
+            sizeof(testMem.srvBufAllow), (whServerDmaFlags){0}));
+    }
+    else if (sizeof(void*) == sizeof(uint32_t)) {
+        /* 32-bit host system */
+        WH_TEST_RETURN_ON_FAIL(whServerDma_CopyToClient32(
+            server, (uint32_t)((uintptr_t)testMem.cliBuf), testMem.srvBufAllow,
+            sizeof(testMem.srvBufAllow), (whServerDmaFlags){0}));
+    }
+
+    /* Ensure data was copied */
+    WH_TEST_ASSERT_RETURN(0 == memcmp(testMem.srvBufAllow, testMem.cliBuf,
+                                      sizeof(testMem.srvBufAllow)));
+
+    /* Now try and copy from the denylisted addresses */
+    if (sizeof(void*) == sizeof(uint64_t)) {
+        /* 64-bit host system */
+        WH_TEST_ASSERT_RETURN(
+            WH_ERROR_ACCESS ==
+            whServerDma_CopyFromClient64(server, testMem.srvBufDeny,
+                                         (uint64_t)((uintptr_t)testMem.cliBuf),
+                                         sizeof(testMem.cliBuf),
+                                         (whServerDmaFlags){0}));
+        WH_TEST_ASSERT_RETURN(WH_ERROR_ACCESS ==
+                              whServerDma_CopyToClient64(
+                                  server, (uint64_t)((uintptr_t)testMem.cliBuf),
+                                  testMem.srvBufDeny,
+                                  sizeof(testMem.srvBufDeny),
+                                  (whServerDmaFlags){0}));
+    }
+    else if (sizeof(void*) == sizeof(uint32_t)) {
+        /* 32-bit host system */
+        WH_TEST_ASSERT_RETURN(
+            WH_ERROR_ACCESS ==
+            whServerDma_CopyFromClient32(server, testMem.srvBufDeny,
+                                         (uint32_t)((uintptr_t)testMem.cliBuf),
+                                         sizeof(testMem.cliBuf),
+                                         (whServerDmaFlags){0}));
+        WH_TEST_ASSERT_RETURN(WH_ERROR_ACCESS ==
+                              whServerDma_CopyToClient32(
+                                  server, (uint32_t)((uintptr_t)testMem.cliBuf),
+                                  testMem.srvBufDeny,
+                                  sizeof(testMem.srvBufDeny),
+                                  (whServerDmaFlags){0}));
+    }
+
+    /* Check that zero-sized copies fail, even from allowed addresses */
+    if (sizeof(void*) == sizeof(uint64_t)) {
+        /* 64-bit host system */
+        WH_TEST_ASSERT_RETURN(
+            WH_ERROR_BADARGS ==
+            whServerDma_CopyFromClient64(server, testMem.srvBufAllow,
+                                         (uint64_t)((uintptr_t)testMem.cliBuf),
+                                         0, (whServerDmaFlags){0}));
+        WH_TEST_ASSERT_RETURN(WH_ERROR_BADARGS ==
+                              whServerDma_CopyToClient64(
+                                  server, (uint64_t)((uintptr_t)testMem.cliBuf),
+                                  testMem.srvBufAllow, 0,
+                                  (whServerDmaFlags){0}));
+    }
+    else if (sizeof(void*) == sizeof(uint32_t)) {
+        /* 32-bit host system */
+        WH_TEST_ASSERT_RETURN(
+            WH_ERROR_BADARGS ==
+            whServerDma_CopyFromClient32(server, testMem.srvBufAllow,
+                                         (uint32_t)((uintptr_t)testMem.cliBuf),
+                                         0, (whServerDmaFlags){0}));
+        WH_TEST_ASSERT_RETURN(WH_ERROR_BADARGS ==
+                              whServerDma_CopyToClient32(
+                                  server, (uint32_t)((uintptr_t)testMem.cliBuf),
+                                  testMem.srvBufAllow, 0,
+                                  (whServerDmaFlags){0}));
+    }
+
+    /* Finally, check that registering a NULL callbacks clears the DMA callback
+     * table, and that the copies otherwise work as normal */
+    WH_TEST_RETURN_ON_FAIL(wh_Server_DmaRegisterCb32(server, NULL));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_DmaRegisterCb64(server, NULL));
+
+    /* Use remap buffer as copy src, since client address isn't in allowlist */
+    memcpy(testMem.srvRemapBufAllow, testMem.cliBuf, sizeof(testMem.cliBuf));
+
+    if (sizeof(void*) == sizeof(uint64_t)) {
+        WH_TEST_RETURN_ON_FAIL(whServerDma_CopyFromClient64(
+            server, testMem.srvBufAllow,
+            (uint64_t)((uintptr_t)testMem.srvRemapBufAllow),
+            sizeof(testMem.cliBuf), (whServerDmaFlags){0}));
+    }
+    else if (sizeof(void*) == sizeof(uint32_t)) {
+        WH_TEST_RETURN_ON_FAIL(whServerDma_CopyFromClient32(
+            server, testMem.srvBufAllow,
+            (uint32_t)((uintptr_t)testMem.srvRemapBufAllow),
+            sizeof(testMem.cliBuf), (whServerDmaFlags){0}));
+    }
+
+    WH_TEST_ASSERT_RETURN(0 == memcmp(testMem.srvRemapBufAllow,
+                                      testMem.srvBufAllow,
+                                      sizeof(testMem.srvBufAllow)));
+    memset(testMem.srvRemapBufAllow, 0, sizeof(testMem.srvRemapBufAllow));
+
+    if (sizeof(void*) == sizeof(uint64_t)) {
+        WH_TEST_RETURN_ON_FAIL(whServerDma_CopyToClient64(
+            server, (uint64_t)((uintptr_t)testMem.srvRemapBufAllow),
+            testMem.srvBufAllow, sizeof(testMem.srvRemapBufAllow),
+            (whServerDmaFlags){0}));
+    }
+    else if (sizeof(void*) == sizeof(uint32_t)) {
+        WH_TEST_RETURN_ON_FAIL(whServerDma_CopyToClient32(
+            server, (uint32_t)((uintptr_t)testMem.srvRemapBufAllow),
+            testMem.srvBufAllow, sizeof(testMem.srvBufAllow),
+            (whServerDmaFlags){0}));
+    }
+
+    WH_TEST_ASSERT_RETURN(0 == memcmp(testMem.srvBufAllow,
+                                      testMem.srvRemapBufAllow,
+                                      sizeof(testMem.srvBufAllow)));
+
+    return rc;
+}
+
+int _clientServerSequentialTestConnectCb(void* context, whCommConnected connected)
+{
+    if (clientServerSequentialTestServerCtx == NULL) {
+        WH_ERROR_PRINT("Client connect callback server context is NULL\n");
+        WH_TEST_ASSERT_RETURN(0);
+    }
+
+    /* Set server connect flag. In a "real" system, this should signal the
+     * server via out-of-band mechanism. The server app is responsible for
+     * receiving this signal and calling wh_Server_SetConnected() */
+    return wh_Server_SetConnected(clientServerSequentialTestServerCtx,
+                                  connected);
+}
+
+int whTest_ClientServerSequential(void)
+{
+    int ret = 0;
+
+    /* Transport memory configuration */
+    uint8_t              req[BUFFER_SIZE];
+    uint8_t              resp[BUFFER_SIZE];
+    uint64_t             bulk[BUFFER_SIZE / sizeof(uint64_t)];
+    whTransportMemConfig tmcf[1] = {{
+        .req       = (whTransportMemCsr*)req,
+        .req_size  = sizeof(req),
+        .resp      = (whTransportMemCsr*)resp,
+        .resp_size = sizeof(resp),
+        .bulk      = bulk,
+        .bulk_size = sizeof(bulk),
+    }};
+
+    /* Client configuration/contexts */
+    whTransportClientCb         tccb[1]    = {WH_TRANSPORT_MEM_CLIENT_CB};
+    whTransportMemClientContext tmcc[1]    = {0};
+    whCommClientConfig          cc_conf[1] = {{
+                 .transport_cb      = tccb,
+                 .transport_context = (void*)tmcc,
+                 .transport_config  = (void*)tmcf,
+                 .client_id         = 123,
+                 .connect_cb        = _clientServerSequentialTestConnectCb,
+    }};
+
+    whClientContext client[1] = {0};
+
+    whClientConfig c_conf[1] = {{
+        .comm = cc_conf,
+    }};
+
+    /* Server configuration/contexts */
+    whTransportServerCb         tscb[1]    = {WH_TRANSPORT_MEM_SERVER_CB};
+    whTransportMemServerContext tmsc[1]    = {0};
+    whCommServerConfig          cs_conf[1] = {{
+                 .transport_cb      = tscb,
+                 .transport_context = (void*)tmsc,
+                 .transport_config  = (void*)tmcf,
+                 .server_id         = 124,
+    }};
+
+    /* RamSim Flash state and configuration */
+    whFlashRamsimCtx fc[1]      = {0};
+    whFlashRamsimCfg fc_conf[1] = {{
+        .size       = 1024 * 1024, /* 1MB  Flash */
+        .sectorSize = 128 * 1024,  /* 128KB  Sector Size */
+        .pageSize   = 8,           /* 8B   Page Size */
+        .erasedByte = ~(uint8_t)0,
+    }};
+    const whFlashCb  fcb[1]     = {WH_FLASH_RAMSIM_CB};
+
+    /* NVM Flash Configuration using RamSim HAL Flash */
+    whNvmFlashConfig  nf_conf[1] = {{
+         .cb      = fcb,
+         .context = fc,
+         .config  = fc_conf,
+    }};
+    whNvmFlashContext nfc[1]     = {0};
+    whNvmCb           nfcb[1]    = {WH_NVM_FLASH_CB};
+
+    whNvmConfig  n_conf[1] = {{
+         .cb      = nfcb,
+         .context = nfc,
+         .config  = nf_conf,
+    }};
+    whNvmContext nvm[1]    = {{0}};
+#ifndef WOLFHSM_NO_CRYPTO
+    crypto_context crypto[1] = {{
+        .devId = INVALID_DEVID,
+    }};
+#endif
+
+    whServerConfig  s_conf[1] = {{
+         .comm_config = cs_conf,
+         .nvm         = nvm,
+#ifndef WOLFHSM_NO_CRYPTO
+         .crypto      = crypto,
+#endif
+    }};
+    whServerContext server[1] = {0};
+
+    whCommConnected server_connected = WH_COMM_DISCONNECTED;
+
+    /* Expose the server context to our client connect callback */
+    clientServerSequentialTestServerCtx = server;
+
+#ifndef WOLFHSM_NO_CRYPTO
+    WH_TEST_RETURN_ON_FAIL(wolfCrypt_Init());
+    WH_TEST_RETURN_ON_FAIL(wc_InitRng_ex(crypto->rng, NULL, crypto->devId));
+#endif
+    WH_TEST_RETURN_ON_FAIL(wh_Nvm_Init(nvm, n_conf));
+
+    /* Server API should return NOTREADY until the server is connected */
+    WH_TEST_RETURN_ON_FAIL(wh_Server_GetConnected(server, &server_connected));
+    WH_TEST_ASSERT_RETURN(WH_COMM_DISCONNECTED == server_connected);
+    WH_TEST_ASSERT_RETURN(WH_ERROR_NOTREADY ==
+                          wh_Server_HandleRequestMessage(server));
+
+
+    /* Init client and server contexts. NOTE: in this test the server MUST be
+    initialized before the client, as the client init function triggers the
+    server "connect" via the connect callback, and this will be overwritten (set
+    to zero) on server init */
+    WH_TEST_RETURN_ON_FAIL(wh_Server_Init(server, s_conf));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_Init(client, c_conf));
+
+    /* Ensure server is now "connected" */
+    WH_TEST_RETURN_ON_FAIL(wh_Server_GetConnected(server, &server_connected));
+    WH_TEST_ASSERT_RETURN(WH_COMM_CONNECTED == server_connected);
+
+    int      counter                  = 1;
+    char     recv_buffer[WH_COMM_DATA_LEN] = {0};
+    char     send_buffer[WH_COMM_DATA_LEN] = {0};
+    uint16_t send_len                 = 0;
+    uint16_t recv_len                 = 0;
+
+    int32_t  server_rc       = 0;
+    uint32_t client_id       = 0;
+    uint32_t server_id       = 0;
+    uint32_t avail_size      = 0;
+    uint32_t reclaim_size    = 0;
+    whNvmId  avail_objects   = 0;
+    whNvmId  reclaim_objects = 0;
+
+    /* Check that the server side is ready to recv */
+    WH_TEST_ASSERT_RETURN(WH_ERROR_NOTREADY ==
+                          wh_Server_HandleRequestMessage(server));
+
+    for (counter = 0; counter < REPEAT_COUNT; counter++) {
+
+        /* Prepare echo test */
+        send_len =
+            snprintf(send_buffer, sizeof(send_buffer), "Request:%u", counter);
+        snprintf(recv_buffer, sizeof(recv_buffer), "NOTHING RECEIVED");
+        recv_len = 0;
+
+        WH_TEST_RETURN_ON_FAIL(
+            wh_Client_EchoRequest(client, send_len, send_buffer));
+#if defined(WH_CFG_TEST_VERBOSE)
+        printf("Client EchoRequest:%d, len:%d, %.*s\n", ret, send_len, send_len,
+               send_buffer);
+#endif
+
+        if (counter == 0) {
+            WH_TEST_ASSERT_RETURN(
+                WH_ERROR_NOTREADY ==
+                wh_Client_EchoResponse(client, &recv_len, recv_buffer));
+        }
+
+        WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+
+#if defined(WH_CFG_TEST_VERBOSE)
+        printf("Server HandleRequestMessage:%d\n", ret);
+#endif
+
+        WH_TEST_RETURN_ON_FAIL(
+            wh_Client_EchoResponse(client, &recv_len, recv_buffer));
+
+#if defined(WH_CFG_TEST_VERBOSE)
+        printf("Client EchoResponse:%d, len:%d, %.*s, expected:%.*s\n", ret,
+               recv_len, recv_len, recv_buffer, send_len, send_buffer);
+#endif
+        WH_TEST_ASSERT_RETURN(recv_len == send_len);
+        WH_TEST_ASSERT_RETURN(strncmp(recv_buffer, send_buffer, recv_len) == 0);
+    }
+
+    /* Perform NVM tests */
+    WH_TEST_RETURN_ON_FAIL(wh_Client_NvmInitRequest(client));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(
+        wh_Client_NvmInitResponse(client, &server_rc, &client_id, &server_id));
+
+#if defined(WH_CFG_TEST_VERBOSE)
+    printf("Client NvmInitResponse:%d, server_rc:%d, clientid:%d serverid:%d\n",
+           ret, (int)server_rc, (int)client_id, (int)server_id);
+#endif
+    WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
+
+
+    WH_TEST_RETURN_ON_FAIL(wh_Client_NvmGetAvailableRequest(client));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_NvmGetAvailableResponse(
+        client, &server_rc, &avail_size, &avail_objects, &reclaim_size,
+        &reclaim_objects));
+#if defined(WH_CFG_TEST_VERBOSE)
+    printf("Client NvmGetAvailableResponse:%d, server_rc:%d avail_size:%d "
+           "avail_objects:%d, reclaim_size:%d reclaim_objects:%d\n",
+           ret, (int)server_rc, (int)avail_size, (int)avail_objects, (int)reclaim_size,
+           (int)reclaim_objects);
+#endif
+    WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
+    WH_TEST_ASSERT_RETURN(avail_objects == NF_OBJECT_COUNT);
+
+
+    for (counter = 0; counter < 5; counter++) {
+        whNvmId     id                           = counter + 20;
+        whNvmAccess access                       = WOLFHSM_NVM_ACCESS_ANY;
+        whNvmFlags  flags                        = WOLFHSM_NVM_FLAGS_ANY;
+        whNvmSize   label_len                    = 0;
+        char        label[WOLFHSM_NVM_LABEL_LEN] = {0};
+        whNvmSize   len                          = 0;
+
+        whNvmId     gid                           = 0;
+        whNvmAccess gaccess                       = 0;
+        whNvmFlags  gflags                        = 0;
+        char        glabel[WOLFHSM_NVM_LABEL_LEN] = {0};
+        whNvmSize   glen                          = 0;
+        whNvmSize   rlen                          = 0;
+
+        whNvmId lastAvailObjects = 0;
+
+        label_len = snprintf(label, sizeof(label), "Label:%d", id);
+        len = snprintf(send_buffer, sizeof(send_buffer), "Data:%d Counter:%d",
+                       id, counter);
+
+#if defined(WH_CFG_TEST_VERBOSE)
+        printf("Client NvmAddObjectRequest:%d, id:%u, access:0x%x, flags:0x%x, "
+               "len:%u label:%s\nData:%s\n",
+               ret, id, access, flags, len, label, send_buffer);
+#endif
+
+        lastAvailObjects = avail_objects;
+
+        WH_TEST_RETURN_ON_FAIL(wh_Client_NvmAddObjectRequest(
+            client, id, access, flags, label_len, (uint8_t*)label, len,
+            (uint8_t*)send_buffer));
+        WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+        WH_TEST_RETURN_ON_FAIL(
+            wh_Client_NvmAddObjectResponse(client, &server_rc));
+#if defined(WH_CFG_TEST_VERBOSE)
+        printf("Client NvmAddObjectResponse:%d, server_rc:%d\n", ret,
+                (int)server_rc);
+#endif
+        WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
+
+        WH_TEST_RETURN_ON_FAIL(wh_Client_NvmGetAvailableRequest(client));
+        WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+        WH_TEST_RETURN_ON_FAIL(wh_Client_NvmGetAvailableResponse(
+            client, &server_rc, &avail_size, &avail_objects, &reclaim_size,
+            &reclaim_objects));
+#if defined(WH_CFG_TEST_VERBOSE)
+        printf("Client NvmGetAvailableResponse:%d, server_rc:%d, avail_size:%d "
+               "avail_objects:%d, reclaim_size:%d reclaim_objects:%d\n",
+               ret, (int)server_rc, (int)avail_size, (int)avail_objects, (int)reclaim_size,
+               (int)reclaim_objects);
+#endif
+
+        /* Check that available objects decreased by one */
+        WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
+        WH_TEST_ASSERT_RETURN(lastAvailObjects - 1 == avail_objects);
+
+        WH_TEST_RETURN_ON_FAIL(wh_Client_NvmGetMetadataRequest(client, id));
+        WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+        WH_TEST_RETURN_ON_FAIL(wh_Client_NvmGetMetadataResponse(
+            client, &server_rc, &gid, &gaccess, &gflags, &glen, sizeof(glabel),
+            (uint8_t*)glabel));
+#if defined(WH_CFG_TEST_VERBOSE)
+        printf("Client NvmGetMetadataResponse:%d, id:%u, access:0x%x, "
+               "flags:0x%x, len:%u label:%s\n",
+               ret, gid, gaccess, gflags, glen, glabel);
+#endif
+
+        /* Ensure metadata matches that of the object we just wrote */
+        WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
+        WH_TEST_ASSERT_RETURN(gid == id);
+
+        memset(recv_buffer, 0, sizeof(recv_buffer));
+        WH_TEST_RETURN_ON_FAIL(wh_Client_NvmReadRequest(client, id, 0, glen));
+        WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+        WH_TEST_RETURN_ON_FAIL(wh_Client_NvmReadResponse(
+            client, &server_rc, &rlen, (uint8_t*)recv_buffer));
+#if defined(WH_CFG_TEST_VERBOSE)
+        printf(
+            "Client NvmReadResponse:%d, server_rc:%d id:%u, len:%u data:%s\n",
+            ret, (int)server_rc, (unsigned int)gid, (unsigned int)rlen, recv_buffer);
+#endif
+
+        /* Ensure data and size of response object matches that of the written
+         * object */
+        WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
+        WH_TEST_ASSERT_RETURN(rlen == len);
+        WH_TEST_ASSERT_RETURN(0 == memcmp(send_buffer, recv_buffer, len));
+    }
+
+    whNvmAccess list_access = WOLFHSM_NVM_ACCESS_ANY;
+    whNvmFlags  list_flags  = WOLFHSM_NVM_FLAGS_ANY;
+    whNvmId     list_id     = 0;
+    whNvmId     list_count  = 0;
+    do {
+        WH_TEST_RETURN_ON_FAIL(
+            wh_Client_NvmListRequest(client, list_access, list_flags, list_id));
+        WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+        WH_TEST_RETURN_ON_FAIL(wh_Client_NvmListResponse(
+            client, &server_rc, &list_count, &list_id));
+#if defined(WH_CFG_TEST_VERBOSE)
+        printf("Client NvmListResponse:%d, server_rc:%d count:%u id:%u\n", ret,
+                (int)server_rc, (unsigned int)list_count, (unsigned int)list_id);
+#endif
+
+        if (list_count > 0) {
+            /* ensure list_id contains ID of object written, and list_count
+             * shows remaining items in list */
+            WH_TEST_ASSERT_RETURN(list_id == 20 + (5 - list_count));
+
+            WH_TEST_RETURN_ON_FAIL(
+                wh_Client_NvmDestroyObjectsRequest(client, 1, &list_id));
+            WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+            WH_TEST_RETURN_ON_FAIL(
+                wh_Client_NvmDestroyObjectsResponse(client, &server_rc));
+#if defined(WH_CFG_TEST_VERBOSE)
+            printf("Client NvmDestroyObjectsResponse:%d, server_rc:%d for "
+                   "id:%u with count:%u\n",
+                   ret, (int)server_rc, (unsigned int)list_id, (unsigned int)list_count);
+#endif
+            WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
+
+            /* Ensure object was destroyed and no longer exists */
+            WH_TEST_RETURN_ON_FAIL(
+                wh_Client_NvmGetMetadataRequest(client, list_id));
+            WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+            WH_TEST_RETURN_ON_FAIL(wh_Client_NvmGetMetadataResponse(
+                client, &server_rc, NULL, NULL, NULL, NULL, 0, NULL));
+            WH_TEST_ASSERT_RETURN(WH_ERROR_NOTFOUND == server_rc);
+
+#if defined(WH_CFG_TEST_VERBOSE)
+            printf("Client NvmListResponse:%d, server_rc:%d count:%u id:%u\n",
+                   ret, (int)server_rc, (unsigned int)list_count, (unsigned int)list_id);
+#endif
+
+            list_id = 0;
+        }
+    } while (list_count > 0);
+
+
+    WH_TEST_RETURN_ON_FAIL(wh_Client_NvmGetAvailableRequest(client));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_NvmGetAvailableResponse(
+        client, &server_rc, &avail_size, &avail_objects, &reclaim_size,
+        &reclaim_objects));
+    WH_TEST_ASSERT_RETURN(avail_objects == NF_OBJECT_COUNT);
+
+    for (counter = 0; counter < 5; counter++) {
+        whNvmMetadata meta = {
+            .id     = counter + 40,
+            .access = WOLFHSM_NVM_ACCESS_ANY,
+            .flags  = WOLFHSM_NVM_FLAGS_ANY,
+            .len    = 0,
+            .label  = {0},
+        };
+        whNvmSize len = 0;
+
+        whNvmId     gid                           = 0;
+        whNvmAccess gaccess                       = 0;
+        whNvmFlags  gflags                        = 0;
+        char        glabel[WOLFHSM_NVM_LABEL_LEN] = {0};
+        whNvmSize   glen                          = 0;
+
+        whNvmId lastAvailObjects = 0;
+
+        snprintf((char*)(meta.label), sizeof(meta.label), "Label:%d", meta.id);
+        len = snprintf(send_buffer, sizeof(send_buffer), "Data:%d Counter:%d",
+                       meta.id, counter);
+
+#if defined(WH_CFG_TEST_VERBOSE)
+        printf("Client NvmAddObjectDmaRequest:%d, id:%u, access:0x%x, "
+               "flags:0x%x, len:%u label:%s\nData:%s\n",
+               ret, meta.id, meta.access, meta.flags, len, meta.label,
+               send_buffer);
+#endif
+
+        lastAvailObjects = avail_objects;
+
+        WH_TEST_RETURN_ON_FAIL(wh_Client_NvmAddObjectDmaRequest(
+            client, &meta, len, (uint8_t*)send_buffer));
+        WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+        WH_TEST_RETURN_ON_FAIL(
+            wh_Client_NvmAddObjectDmaResponse(client, &server_rc));
+#if defined(WH_CFG_TEST_VERBOSE)
+        printf("Client NvmAddObjectDmaResponse:%d, server_rc:%d, meta.len:%u\n",
+               ret, (int)server_rc, (unsigned int)meta.len);
+#endif
+        WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
+
+        WH_TEST_RETURN_ON_FAIL(wh_Client_NvmGetAvailableRequest(client));
+        WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+        WH_TEST_RETURN_ON_FAIL(wh_Client_NvmGetAvailableResponse(
+            client, &server_rc, &avail_size, &avail_objects, &reclaim_size,
+            &reclaim_objects));
+#if defined(WH_CFG_TEST_VERBOSE)
+        printf("Client NvmGetAvailableResponse:%d, server_rc:%d, avail_size:%d "
+               "avail_objects:%d, reclaim_size:%d reclaim_objects:%d\n",
+               ret, (int)server_rc, (int)avail_size, (int)avail_objects, (int)reclaim_size,
+               (int)reclaim_objects);
+#endif
+        WH_TEST_ASSERT_RETURN(lastAvailObjects - 1 == avail_objects);
+
+        WH_TEST_RETURN_ON_FAIL(
+            wh_Client_NvmGetMetadataRequest(client, meta.id));
+        WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+        WH_TEST_RETURN_ON_FAIL(wh_Client_NvmGetMetadataResponse(
+            client, &server_rc, &gid, &gaccess, &gflags, &glen, sizeof(glabel),
+            (uint8_t*)glabel));
+#if defined(WH_CFG_TEST_VERBOSE)
+        printf("Client NvmGetMetadataResponse:%d, id:%u, access:0x%x, "
+               "flags:0x%x, len:%u label:%s\n",
+               ret, gid, gaccess, gflags, glen, glabel);
+#endif
+
+        /* Ensure metadata matches that of the object we just wrote */
+        WH_TEST_ASSERT_RETURN(gid == meta.id);
+
+
+        memset(recv_buffer, 0, sizeof(recv_buffer));
+        WH_TEST_RETURN_ON_FAIL(wh_Client_NvmReadDmaRequest(
+            client, meta.id, 0, glen, (uint8_t*)recv_buffer));
+        WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+        WH_TEST_RETURN_ON_FAIL(
+            wh_Client_NvmReadDmaResponse(client, &server_rc));
+#if defined(WH_CFG_TEST_VERBOSE)
+        printf("Client NvmReadDmaResponse:%d, server_rc:%d id:%u, len:%u "
+               "data:%s\n",
+               ret, (int)server_rc, (unsigned int)gid, (unsigned int)glen, recv_buffer);
+#endif
+
+        /* Ensure data and size of response object matches that of the written
+         * object */
+        WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
+        WH_TEST_ASSERT_RETURN(glen == len);
+        WH_TEST_ASSERT_RETURN(0 == memcmp(send_buffer, recv_buffer, len));
     }
 
-    WH_TEST_ASSERT_RETURN(0 == memcmp(testMem.srvBufAllow,
-                                      testMem.srvRemapBufAllow,
-                                      sizeof(testMem.srvBufAllow)));
+    do {
+        WH_TEST_RETURN_ON_FAIL(
+            wh_Client_NvmListRequest(client, list_access, list_flags, list_id));
+        WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+        WH_TEST_RETURN_ON_FAIL(wh_Client_NvmListResponse(
+            client, &server_rc, &list_count, &list_id));
+#if defined(WH_CFG_TEST_VERBOSE)
+        printf("Client NvmListResponse:%d, server_rc:%d count:%u id:%u\n", ret,
+                (int)server_rc, (unsigned int)list_count, (unsigned int)list_id);
+#endif
+        WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
 
-    return rc;
-}
+        if (list_count > 0) {
+            /* ensure list_id contains ID of object written, and list_count
+             * shows remaining items in list */
+            WH_TEST_ASSERT_RETURN(list_id == 40 + (5 - list_count));
 
-int _clientServerSequentialTestConnectCb(void* context, whCommConnected connected)
-{
-    if (clientServerSequentialTestServerCtx == NULL) {
-        WH_ERROR_PRINT("Client connect callback server context is NULL\n");
-        WH_TEST_ASSERT_RETURN(0);
-    }
+            WH_TEST_RETURN_ON_FAIL(
+                wh_Client_NvmDestroyObjectsRequest(client, 1, &list_id));
+            WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+            WH_TEST_RETURN_ON_FAIL(
+                wh_Client_NvmDestroyObjectsResponse(client, &server_rc));
+            WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
 
-    /* Set server connect flag. In a "real" system, this should signal the
-     * server via out-of-band mechanism. The server app is responsible for
-     * receiving this signal and calling wh_Server_SetConnected() */
-    return wh_Server_SetConnected(clientServerSequentialTestServerCtx,
-                                  connected);
-}
+#if defined(WH_CFG_TEST_VERBOSE)
+            printf("Client NvmDestroyObjectsResponse:%d, server_rc:%d for "
+                   "id:%u with count:%u\n",
+                   ret, (int)server_rc, (unsigned int)list_id, (unsigned int)list_count);
+#endif
 
-int whTest_ClientServerSequential(void)
-{
-    int ret = 0;
+            /* Ensure object was destroyed and no longer exists */
+            WH_TEST_RETURN_ON_FAIL(
+                wh_Client_NvmGetMetadataRequest(client, list_id));
+            WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+            WH_TEST_RETURN_ON_FAIL(wh_Client_NvmGetMetadataResponse(
+                client, &server_rc, NULL, NULL, NULL, NULL, 0, NULL));
+            WH_TEST_ASSERT_RETURN(WH_ERROR_NOTFOUND == server_rc);
 
-    /* Transport memory configuration */
-    uint8_t              req[BUFFER_SIZE];
-    uint8_t              resp[BUFFER_SIZE];
-    whTransportMemConfig tmcf[1] = {{
-        .req       = (whTransportMemCsr*)req,
-        .req_size  = sizeof(req),
-        .resp      = (whTransportMemCsr*)resp,
-        .resp_size = sizeof(resp),
-    }};
+            list_id = 0;
+        }
+    } while (list_count > 0);
 
-    /* Client configuration/contexts */
-    whTransportClientCb         tccb[1]    = {WH_TRANSPORT_MEM_CLIENT_CB};
-    whTransportMemClientContext tmcc[1]    = {0};
-    whCommClientConfig          cc_conf[1] = {{
-                 .transport_cb      = tccb,
-                 .transport_context = (void*)tmcc,
-                 .transport_config  = (void*)tmcf,
-                 .client_id         = 123,
-                 .connect_cb        = _clientServerSequentialTestConnectCb,
-    }};
 
-    whClientContext client[1] = {0};
+    WH_TEST_RETURN_ON_FAIL(wh_Client_NvmCleanupRequest(client));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_NvmCleanupResponse(client, &server_rc));
+#if defined(WH_CFG_TEST_VERBOSE)
+    printf("Client NvmCleanupResponse:%d, server_rc:%d\n", ret, (int)server_rc);
+#endif
+    WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
 
-    whClientConfig c_conf[1] = {{
-        .comm = cc_conf,
-    }};
+    WH_TEST_RETURN_ON_FAIL(wh_Client_NvmGetAvailableRequest(client));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_NvmGetAvailableResponse(
+        client, &server_rc, &avail_size, &avail_objects, &reclaim_size,
+        &reclaim_objects));
+#if defined(WH_CFG_TEST_VERBOSE)
+    printf("Client NvmGetAvailableResponse:%d, server_rc:%d, avail_size:%d "
+           "avail_objects:%d, reclaim_size:%d reclaim_objects:%d\n",
+           ret, (int)server_rc, (int)avail_size, (int)avail_objects, (int)reclaim_size,
+           (int)reclaim_objects);
+#endif
+    WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
+    WH_TEST_ASSERT_RETURN(avail_objects == NF_OBJECT_COUNT);
 
-    /* Server configuration/contexts */
-    whTransportServerCb         tscb[1]    = {WH_TRANSPORT_MEM_SERVER_CB};
-    whTransportMemServerContext tmsc[1]    = {0};
-    whCommServerConfig          cs_conf[1] = {{
-                 .transport_cb      = tscb,
-                 .transport_context = (void*)tmsc,
-                 .transport_config  = (void*)tmcf,
-                 .server_id         = 124,
-    }};
+    /* Test custom registered callbacks */
+    WH_TEST_RETURN_ON_FAIL(_testCallbacks(server, client));
+    WH_TEST_RETURN_ON_FAIL(_testCallbacksDeferred(server, client));
 
-    /* RamSim Flash state and configuration */
-    whFlashRamsimCtx fc[1]      = {0};
-    whFlashRamsimCfg fc_conf[1] = {{
-        .size       = 1024 * 1024, /* 1MB  Flash */
-        .sectorSize = 128 * 1024,  /* 128KB  Sector Size */
-        .pageSize   = 8,           /* 8B   Page Size */
-        .erasedByte = ~(uint8_t)0,
-    }};
-    const whFlashCb  fcb[1]     = {WH_FLASH_RAMSIM_CB};
+    /* Test image verification, before DMA allowlists are registered */
+    WH_TEST_RETURN_ON_FAIL(_testImage(server, client));
 
-    /* NVM Flash Configuration using RamSim HAL Flash */
-    whNvmFlashConfig  nf_conf[1] = {{
-         .cb      = fcb,
-         .context = fc,
-         .config  = fc_conf,
-    }};
-    whNvmFlashContext nfc[1]     = {0};
-    whNvmCb           nfcb[1]    = {WH_NVM_FLASH_CB};
+    /* Test ChaCha20-Poly1305 with keystore keys, before DMA allowlists */
+    WH_TEST_RETURN_ON_FAIL(_testChaCha(server, client));
 
-    whNvmConfig  n_conf[1] = {{
-         .cb      = nfcb,
-         .context = nfc,
-         .config  = nf_conf,
-    }};
-    whNvmContext nvm[1]    = {{0}};
-#ifndef WOLFHSM_NO_CRYPTO
-    crypto_context crypto[1] = {{
-        .devId = INVALID_DEVID,
-    }};
-#endif
+    /* Test prepared operation handles, reclaim and key invalidation */
+    WH_TEST_RETURN_ON_FAIL(_testPrepared(server, client));
 
-    whServerConfig  s_conf[1] = {{
-         .comm_config = cs_conf,
-         .nvm         = nvm,
-#ifndef WOLFHSM_NO_CRYPTO
-         .crypto      = crypto,
+#if defined(WH_CFG_TEST_POSIX)
+    /* Test copies through an asynchronous DMA engine */
+    WH_TEST_RETURN_ON_FAIL(_testDmaEngine(server, client));
 #endif
-    }};
-    whServerContext server[1] = {0};
 
-    whCommConnected server_connected = WH_COMM_DISCONNECTED;
+    /* Test DMA callbacks and address allowlisting */
+    WH_TEST_RETURN_ON_FAIL(_testDma(server, client));
 
-    /* Expose the server context to our client connect callback */
-    clientServerSequentialTestServerCtx = server;
+    /* Test PKCS11 sessions, object handles and find operations */
+    WH_TEST_RETURN_ON_FAIL(_testPkcs11(server, client));
 
-#ifndef WOLFHSM_NO_CRYPTO
-    WH_TEST_RETURN_ON_FAIL(wolfCrypt_Init());
-    WH_TEST_RETURN_ON_FAIL(wc_InitRng_ex(crypto->rng, NULL, crypto->devId));
-#endif
-    WH_TEST_RETURN_ON_FAIL(wh_Nvm_Init(nvm, n_conf));
+    /* Test certificate chain verification */
+    WH_TEST_RETURN_ON_FAIL(_testCert(server, client));
 
-    /* Server API should return NOTREADY until the server is connected */
-    WH_TEST_RETURN_ON_FAIL(wh_Server_GetConnected(server, &server_connected));
-    WH_TEST_ASSERT_RETURN(WH_COMM_DISCONNECTED == server_connected);
-    WH_TEST_ASSERT_RETURN(WH_ERROR_NOTREADY ==
-                          wh_Server_HandleRequestMessage(server));
+    /* Test wrapped bulk key export and import */
+    WH_TEST_RETURN_ON_FAIL(_testKeyWrap(server, client));
 
+    /* Test NVM transfers through the shared bulk data region */
+    WH_TEST_RETURN_ON_FAIL(_testBulk(server, client));
 
-    /* Init client and server contexts. NOTE: in this test the server MUST be
-    initialized before the client, as the client init function triggers the
-    server "connect" via the connect callback, and this will be overwritten (set
-    to zero) on server init */
-    WH_TEST_RETURN_ON_FAIL(wh_Server_Init(server, s_conf));
-    WH_TEST_RETURN_ON_FAIL(wh_Client_Init(client, c_conf));
+    /* Test destroying NVM objects selected by a filter */
+    WH_TEST_RETURN_ON_FAIL(_testNvmDestroyMatching(server, client));
 
-    /* Ensure server is now "connected" */
+    /* Test responses held while the transport is busy */
+    WH_TEST_RETURN_ON_FAIL(_testDeferredResponse(server, client));
+    WH_TEST_RETURN_ON_FAIL(_testNvmGc(server));
+
+    /* Check that we are still connected */
     WH_TEST_RETURN_ON_FAIL(wh_Server_GetConnected(server, &server_connected));
-    WH_TEST_ASSERT_RETURN(WH_COMM_CONNECTED == server_connected);
+    WH_TEST_ASSERT_RETURN(server_connected == WH_COMM_CONNECTED);
 
-    int      counter                  = 1;
-    char     recv_buffer[WH_COMM_DATA_LEN] = {0};
-    char     send_buffer[WH_COMM_DATA_LEN] = {0};
-    uint16_t send_len                 = 0;
-    uint16_t recv_len                 = 0;
+    /* Disconnect the server */
+    WH_TEST_RETURN_ON_FAIL(wh_Client_CommCloseRequest(client));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_CommCloseResponse(client));
 
-    int32_t  server_rc       = 0;
-    uint32_t client_id       = 0;
-    uint32_t server_id       = 0;
-    uint32_t avail_size      = 0;
-    uint32_t reclaim_size    = 0;
-    whNvmId  avail_objects   = 0;
-    whNvmId  reclaim_objects = 0;
+    /* Ensure we show as disconnected */
+    WH_TEST_RETURN_ON_FAIL(wh_Server_GetConnected(server, &server_connected));
+    WH_TEST_ASSERT_RETURN(server_connected == WH_COMM_DISCONNECTED);
 
-    /* Check that the server side is ready to recv */
-    WH_TEST_ASSERT_RETURN(WH_ERROR_NOTREADY ==
-                          wh_Server_HandleRequestMessage(server));
+    /* Clean up the contexts */
+    WH_TEST_RETURN_ON_FAIL(wh_Server_Cleanup(server));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_Cleanup(client));
+
+    wh_Nvm_Cleanup(nvm);
+#ifndef WOLFHSM_NO_CRYPTO
+    wc_FreeRng(crypto->rng);
+    wolfCrypt_Cleanup();
+#endif
+
+    return ret;
+}
+
+int whTest_ClientCfg(whClientConfig* clientCfg)
+{
+    int ret = 0;
+    whClientContext client[1] = {0};
+
+    WH_TEST_RETURN_ON_FAIL(wh_Client_Init(client, clientCfg));
+
+    int counter = 1;
+    char recv_buffer[WH_COMM_DATA_LEN] = {0};
+    char send_buffer[WH_COMM_DATA_LEN] = {0};
+    uint16_t send_len = 0;
+    uint16_t recv_len = 0;
+
+    int32_t server_rc = 0;
+    uint32_t client_id = 0;
+    uint32_t server_id = 0;
+    uint32_t avail_size = 0;
+    uint32_t reclaim_size = 0;
+    whNvmId avail_objects = 0;
+    whNvmId reclaim_objects = 0;
 
     for (counter = 0; counter < REPEAT_COUNT; counter++) {
 
@@ -608,56 +2904,27 @@ int whTest_ClientServerSequential(void)
         snprintf(recv_buffer, sizeof(recv_buffer), "NOTHING RECEIVED");
         recv_len = 0;
 
-        WH_TEST_RETURN_ON_FAIL(
-            wh_Client_EchoRequest(client, send_len, send_buffer));
-#if defined(WH_CFG_TEST_VERBOSE)
-        printf("Client EchoRequest:%d, len:%d, %.*s\n", ret, send_len, send_len,
-               send_buffer);
-#endif
-
-        if (counter == 0) {
-            WH_TEST_ASSERT_RETURN(
-                WH_ERROR_NOTREADY ==
-                wh_Client_EchoResponse(client, &recv_len, recv_buffer));
-        }
-
-        WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
-
-#if defined(WH_CFG_TEST_VERBOSE)
-        printf("Server HandleRequestMessage:%d\n", ret);
-#endif
-
-        WH_TEST_RETURN_ON_FAIL(
-            wh_Client_EchoResponse(client, &recv_len, recv_buffer));
+        WH_TEST_RETURN_ON_FAIL(ret = wh_Client_Echo(client, send_len, send_buffer, &recv_len, recv_buffer));
 
 #if defined(WH_CFG_TEST_VERBOSE)
-        printf("Client EchoResponse:%d, len:%d, %.*s, expected:%.*s\n", ret,
-               recv_len, recv_len, recv_buffer, send_len, send_buffer);
+        printf("Client Echo:%d, len:%d, %.*s, expected:%.*s\n",
+            ret, recv_len, recv_len, recv_buffer, send_len, send_buffer);
 #endif
-        WH_TEST_ASSERT_RETURN(recv_len == send_len);
-        WH_TEST_ASSERT_RETURN(strncmp(recv_buffer, send_buffer, recv_len) == 0);
+        WH_TEST_ASSERT_RETURN( recv_len == send_len);
+        WH_TEST_ASSERT_RETURN( strncmp(recv_buffer, send_buffer, recv_len) == 0);
     }
 
     /* Perform NVM tests */
-    WH_TEST_RETURN_ON_FAIL(wh_Client_NvmInitRequest(client));
-    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
-    WH_TEST_RETURN_ON_FAIL(
-        wh_Client_NvmInitResponse(client, &server_rc, &client_id, &server_id));
 
-#if defined(WH_CFG_TEST_VERBOSE)
-    printf("Client NvmInitResponse:%d, server_rc:%d, clientid:%d serverid:%d\n",
-           ret, (int)server_rc, (int)client_id, (int)server_id);
-#endif
+    WH_TEST_RETURN_ON_FAIL(ret = wh_Client_NvmInit(client, &server_rc, &client_id, &server_id));
     WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
 
-
-    WH_TEST_RETURN_ON_FAIL(wh_Client_NvmGetAvailableRequest(client));
-    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
-    WH_TEST_RETURN_ON_FAIL(wh_Client_NvmGetAvailableResponse(
+    WH_TEST_RETURN_ON_FAIL(ret = wh_Client_NvmGetAvailable(
         client, &server_rc, &avail_size, &avail_objects, &reclaim_size,
         &reclaim_objects));
+
 #if defined(WH_CFG_TEST_VERBOSE)
-    printf("Client NvmGetAvailableResponse:%d, server_rc:%d avail_size:%d "
+    printf("Client NvmGetAvailable:%d, server_rc:%d avail_size:%d "
            "avail_objects:%d, reclaim_size:%d reclaim_objects:%d\n",
            ret, (int)server_rc, (int)avail_size, (int)avail_objects, (int)reclaim_size,
            (int)reclaim_objects);
@@ -687,33 +2954,24 @@ int whTest_ClientServerSequential(void)
         len = snprintf(send_buffer, sizeof(send_buffer), "Data:%d Counter:%d",
                        id, counter);
 
-#if defined(WH_CFG_TEST_VERBOSE)
-        printf("Client NvmAddObjectRequest:%d, id:%u, access:0x%x, flags:0x%x, "
-               "len:%u label:%s\nData:%s\n",
-               ret, id, access, flags, len, label, send_buffer);
-#endif
-
         lastAvailObjects = avail_objects;
 
-        WH_TEST_RETURN_ON_FAIL(wh_Client_NvmAddObjectRequest(
+        WH_TEST_RETURN_ON_FAIL(ret = wh_Client_NvmAddObject(
             client, id, access, flags, label_len, (uint8_t*)label, len,
-            (uint8_t*)send_buffer));
-        WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
-        WH_TEST_RETURN_ON_FAIL(
-            wh_Client_NvmAddObjectResponse(client, &server_rc));
+            (uint8_t*)send_buffer, &server_rc));
+
 #if defined(WH_CFG_TEST_VERBOSE)
-        printf("Client NvmAddObjectResponse:%d, server_rc:%d\n", ret,
-                (int)server_rc);
+        printf("Client NvmAddObject:%d, server_rc:%d\n", ret,
+               (int)server_rc);
 #endif
         WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
 
-        WH_TEST_RETURN_ON_FAIL(wh_Client_NvmGetAvailableRequest(client));
-        WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
-        WH_TEST_RETURN_ON_FAIL(wh_Client_NvmGetAvailableResponse(
+        WH_TEST_RETURN_ON_FAIL(ret = wh_Client_NvmGetAvailable(
             client, &server_rc, &avail_size, &avail_objects, &reclaim_size,
             &reclaim_objects));
+
 #if defined(WH_CFG_TEST_VERBOSE)
-        printf("Client NvmGetAvailableResponse:%d, server_rc:%d, avail_size:%d "
+        printf("Client NvmGetAvailable:%d, server_rc:%d, avail_size:%d "
                "avail_objects:%d, reclaim_size:%d reclaim_objects:%d\n",
                ret, (int)server_rc, (int)avail_size, (int)avail_objects, (int)reclaim_size,
                (int)reclaim_objects);
@@ -723,13 +2981,13 @@ int whTest_ClientServerSequential(void)
         WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
         WH_TEST_ASSERT_RETURN(lastAvailObjects - 1 == avail_objects);
 
-        WH_TEST_RETURN_ON_FAIL(wh_Client_NvmGetMetadataRequest(client, id));
-        WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
-        WH_TEST_RETURN_ON_FAIL(wh_Client_NvmGetMetadataResponse(
-            client, &server_rc, &gid, &gaccess, &gflags, &glen, sizeof(glabel),
-            (uint8_t*)glabel));
+        WH_TEST_RETURN_ON_FAIL(
+            ret = wh_Client_NvmGetMetadata(client, id, &server_rc, &gid,
+                                           &gaccess, &gflags, &glen,
+                                           sizeof(glabel), (uint8_t*)glabel));
+
 #if defined(WH_CFG_TEST_VERBOSE)
-        printf("Client NvmGetMetadataResponse:%d, id:%u, access:0x%x, "
+        printf("Client NvmGetMetadata:%d, id:%u, access:0x%x, "
                "flags:0x%x, len:%u label:%s\n",
                ret, gid, gaccess, gflags, glen, glabel);
 #endif
@@ -739,13 +2997,13 @@ int whTest_ClientServerSequential(void)
         WH_TEST_ASSERT_RETURN(gid == id);
 
         memset(recv_buffer, 0, sizeof(recv_buffer));
-        WH_TEST_RETURN_ON_FAIL(wh_Client_NvmReadRequest(client, id, 0, glen));
-        WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
-        WH_TEST_RETURN_ON_FAIL(wh_Client_NvmReadResponse(
-            client, &server_rc, &rlen, (uint8_t*)recv_buffer));
+        WH_TEST_RETURN_ON_FAIL(ret = wh_Client_NvmRead(client, id, 0, glen,
+                                                       &server_rc, &rlen,
+                                                       (uint8_t*)recv_buffer));
+
 #if defined(WH_CFG_TEST_VERBOSE)
         printf(
-            "Client NvmReadResponse:%d, server_rc:%d id:%u, len:%u data:%s\n",
+            "Client NvmRead:%d, server_rc:%d id:%u, len:%u data:%s\n",
             ret, (int)server_rc, (unsigned int)gid, (unsigned int)rlen, recv_buffer);
 #endif
 
@@ -762,12 +3020,10 @@ int whTest_ClientServerSequential(void)
     whNvmId     list_count  = 0;
     do {
         WH_TEST_RETURN_ON_FAIL(
-            wh_Client_NvmListRequest(client, list_access, list_flags, list_id));
-        WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
-        WH_TEST_RETURN_ON_FAIL(wh_Client_NvmListResponse(
-            client, &server_rc, &list_count, &list_id));
+            ret = wh_Client_NvmList(client, list_access, list_flags, list_id,
+                              &server_rc, &list_count, &list_id));
 #if defined(WH_CFG_TEST_VERBOSE)
-        printf("Client NvmListResponse:%d, server_rc:%d count:%u id:%u\n", ret,
+        printf("Client NvmList:%d, server_rc:%d count:%u id:%u\n", ret,
                 (int)server_rc, (unsigned int)list_count, (unsigned int)list_id);
 #endif
 
@@ -777,27 +3033,22 @@ int whTest_ClientServerSequential(void)
             WH_TEST_ASSERT_RETURN(list_id == 20 + (5 - list_count));
 
             WH_TEST_RETURN_ON_FAIL(
-                wh_Client_NvmDestroyObjectsRequest(client, 1, &list_id));
-            WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
-            WH_TEST_RETURN_ON_FAIL(
-                wh_Client_NvmDestroyObjectsResponse(client, &server_rc));
+                ret = wh_Client_NvmDestroyObjects(client, 1, &list_id, 0, NULL,
+                                                  &server_rc));
+
 #if defined(WH_CFG_TEST_VERBOSE)
-            printf("Client NvmDestroyObjectsResponse:%d, server_rc:%d for "
+            printf("Client NvmDestroyObjects:%d, server_rc:%d for "
                    "id:%u with count:%u\n",
                    ret, (int)server_rc, (unsigned int)list_id, (unsigned int)list_count);
 #endif
             WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
 
             /* Ensure object was destroyed and no longer exists */
-            WH_TEST_RETURN_ON_FAIL(
-                wh_Client_NvmGetMetadataRequest(client, list_id));
-            WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
-            WH_TEST_RETURN_ON_FAIL(wh_Client_NvmGetMetadataResponse(
-                client, &server_rc, NULL, NULL, NULL, NULL, 0, NULL));
+            WH_TEST_RETURN_ON_FAIL(ret = wh_Client_NvmGetMetadata(client, list_id, &server_rc, NULL, NULL, NULL, NULL, 0, NULL));
             WH_TEST_ASSERT_RETURN(WH_ERROR_NOTFOUND == server_rc);
 
 #if defined(WH_CFG_TEST_VERBOSE)
-            printf("Client NvmListResponse:%d, server_rc:%d count:%u id:%u\n",
+            printf("Client NvmGetMetadata:%d, server_rc:%d count:%u id:%u\n",
                    ret, (int)server_rc, (unsigned int)list_count, (unsigned int)list_id);
 #endif
 
@@ -806,12 +3057,10 @@ int whTest_ClientServerSequential(void)
     } while (list_count > 0);
 
 
-    WH_TEST_RETURN_ON_FAIL(wh_Client_NvmGetAvailableRequest(client));
-    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
-    WH_TEST_RETURN_ON_FAIL(wh_Client_NvmGetAvailableResponse(
+    WH_TEST_RETURN_ON_FAIL(wh_Client_NvmGetAvailable(
         client, &server_rc, &avail_size, &avail_objects, &reclaim_size,
         &reclaim_objects));
-    WH_TEST_ASSERT_RETURN(avail_objects == NF_OBJECT_COUNT);
+    WH_TEST_ASSERT_RETURN(avail_objects == WOLFHSM_NUM_NVMOBJECTS);
 
     for (counter = 0; counter < 5; counter++) {
         whNvmMetadata meta = {
@@ -835,49 +3084,32 @@ int whTest_ClientServerSequential(void)
         len = snprintf(send_buffer, sizeof(send_buffer), "Data:%d Counter:%d",
                        meta.id, counter);
 
-#if defined(WH_CFG_TEST_VERBOSE)
-        printf("Client NvmAddObjectDmaRequest:%d, id:%u, access:0x%x, "
-               "flags:0x%x, len:%u label:%s\nData:%s\n",
-               ret, meta.id, meta.access, meta.flags, len, meta.label,
-               send_buffer);
-#endif
-
         lastAvailObjects = avail_objects;
 
-        WH_TEST_RETURN_ON_FAIL(wh_Client_NvmAddObjectDmaRequest(
-            client, &meta, len, (uint8_t*)send_buffer));
-        WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
-        WH_TEST_RETURN_ON_FAIL(
-            wh_Client_NvmAddObjectDmaResponse(client, &server_rc));
+        WH_TEST_RETURN_ON_FAIL(ret = wh_Client_NvmAddObjectDma(client, &meta, len, (uint8_t*)send_buffer, &server_rc));
+
 #if defined(WH_CFG_TEST_VERBOSE)
-        printf("Client NvmAddObjectDmaResponse:%d, server_rc:%d, meta.len:%u\n",
-               ret, (int)server_rc, (unsigned int)meta.len);
+        printf("Client NvmAddObjectDma:%d, server_rc:%d, meta.len:%u\n",
+               ret, (int)server_rc, meta.len);
 #endif
         WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
 
-        WH_TEST_RETURN_ON_FAIL(wh_Client_NvmGetAvailableRequest(client));
-        WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
-        WH_TEST_RETURN_ON_FAIL(wh_Client_NvmGetAvailableResponse(
-            client, &server_rc, &avail_size, &avail_objects, &reclaim_size,
-            &reclaim_objects));
+        WH_TEST_RETURN_ON_FAIL(ret = wh_Client_NvmGetAvailable(client, &server_rc, &avail_size, &avail_objects, &reclaim_size, &reclaim_objects));
+
 #if defined(WH_CFG_TEST_VERBOSE)
-        printf("Client NvmGetAvailableResponse:%d, server_rc:%d, avail_size:%d "
+        printf("Client NvmGetAvailable:%d, server_rc:%d, avail_size:%d "
                "avail_objects:%d, reclaim_size:%d reclaim_objects:%d\n",
                ret, (int)server_rc, (int)avail_size, (int)avail_objects, (int)reclaim_size,
                (int)reclaim_objects);
 #endif
         WH_TEST_ASSERT_RETURN(lastAvailObjects - 1 == avail_objects);
 
-        WH_TEST_RETURN_ON_FAIL(
-            wh_Client_NvmGetMetadataRequest(client, meta.id));
-        WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
-        WH_TEST_RETURN_ON_FAIL(wh_Client_NvmGetMetadataResponse(
-            client, &server_rc, &gid, &gaccess, &gflags, &glen, sizeof(glabel),
-            (uint8_t*)glabel));
+        WH_TEST_RETURN_ON_FAIL(ret = wh_Client_NvmGetMetadata(client, meta.id, &server_rc, &gid, &gaccess, &gflags, &glen, sizeof(glabel), (uint8_t*)glabel));
+
 #if defined(WH_CFG_TEST_VERBOSE)
-        printf("Client NvmGetMetadataResponse:%d, id:%u, access:0x%x, "
+        printf("Client NvmGetMetadata:%d, id:%u, access:0x%x, "
                "flags:0x%x, len:%u label:%s\n",
-               ret, gid, gaccess, gflags, glen, glabel);
+               ret, (unsigned int)gid, (unsigned int)gaccess, (unsigned int)gflags, (unsigned int)glen, glabel);
 #endif
 
         /* Ensure metadata matches that of the object we just wrote */
@@ -885,13 +3117,11 @@ int whTest_ClientServerSequential(void)
 
 
         memset(recv_buffer, 0, sizeof(recv_buffer));
-        WH_TEST_RETURN_ON_FAIL(wh_Client_NvmReadDmaRequest(
-            client, meta.id, 0, glen, (uint8_t*)recv_buffer));
-        WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
         WH_TEST_RETURN_ON_FAIL(
-            wh_Client_NvmReadDmaResponse(client, &server_rc));
+            ret = wh_Client_NvmReadDma(client, meta.id, 0, glen,
+                                       (uint8_t*)recv_buffer, &server_rc));
 #if defined(WH_CFG_TEST_VERBOSE)
-        printf("Client NvmReadDmaResponse:%d, server_rc:%d id:%u, len:%u "
+        printf("Client NvmReadDma:%d, server_rc:%d id:%u, len:%u "
                "data:%s\n",
                ret, (int)server_rc, (unsigned int)gid, (unsigned int)glen, recv_buffer);
 #endif
@@ -905,13 +3135,11 @@ int whTest_ClientServerSequential(void)
 
     do {
         WH_TEST_RETURN_ON_FAIL(
-            wh_Client_NvmListRequest(client, list_access, list_flags, list_id));
-        WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
-        WH_TEST_RETURN_ON_FAIL(wh_Client_NvmListResponse(
-            client, &server_rc, &list_count, &list_id));
+            ret = wh_Client_NvmList(client, list_access, list_flags, list_id,
+                                    &server_rc, &list_count, &list_id));
 #if defined(WH_CFG_TEST_VERBOSE)
-        printf("Client NvmListResponse:%d, server_rc:%d count:%u id:%u\n", ret,
-                (int)server_rc, (unsigned int)list_count, (unsigned int)list_id);
+        printf("Client NvmList:%d, server_rc:%d count:%u id:%u\n", ret,
+               (int)server_rc, (unsigned int)list_count, (unsigned int)list_id);
 #endif
         WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
 
@@ -921,577 +3149,1724 @@ int whTest_ClientServerSequential(void)
             WH_TEST_ASSERT_RETURN(list_id == 40 + (5 - list_count));
 
             WH_TEST_RETURN_ON_FAIL(
-                wh_Client_NvmDestroyObjectsRequest(client, 1, &list_id));
-            WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
-            WH_TEST_RETURN_ON_FAIL(
-                wh_Client_NvmDestroyObjectsResponse(client, &server_rc));
+                ret = wh_Client_NvmDestroyObjects(client, 1, &list_id, 0, NULL,
+                                                  &server_rc));
+
             WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
 
-#if defined(WH_CFG_TEST_VERBOSE)
-            printf("Client NvmDestroyObjectsResponse:%d, server_rc:%d for "
-                   "id:%u with count:%u\n",
-                   ret, (int)server_rc, (unsigned int)list_id, (unsigned int)list_count);
-#endif
+#if defined(WH_CFG_TEST_VERBOSE)
+            printf("Client NvmDestroyObjects:%d, server_rc:%d for "
+                   "id:%u with count:%u\n",
+                   ret, (int)server_rc, (unsigned int)list_id, (unsigned int)list_count);
+#endif
+
+            /* Ensure object was destroyed and no longer exists */
+            WH_TEST_RETURN_ON_FAIL(ret = wh_Client_NvmGetMetadata(client, list_id, &server_rc, NULL, NULL, NULL, NULL, 0, NULL));
+            WH_TEST_ASSERT_RETURN(WH_ERROR_NOTFOUND == server_rc);
+
+            list_id = 0;
+        }
+    } while (list_count > 0);
+
+
+    WH_TEST_RETURN_ON_FAIL(ret = wh_Client_NvmCleanup(client, &server_rc));
+#if defined(WH_CFG_TEST_VERBOSE)
+    printf("Client NvmCleanup:%d, server_rc:%d\n", ret, (int)server_rc);
+#endif
+    WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
+
+    WH_TEST_RETURN_ON_FAIL(ret = wh_Client_NvmGetAvailable(
+        client, &server_rc, &avail_size, &avail_objects, &reclaim_size,
+        &reclaim_objects));
+#if defined(WH_CFG_TEST_VERBOSE)
+    printf("Client NvmGetAvailable:%d, server_rc:%d, avail_size:%d "
+           "avail_objects:%d, reclaim_size:%d reclaim_objects:%d\n",
+           ret, (int)server_rc, (int)avail_size, (int)avail_objects, (int)reclaim_size,
+           (int)reclaim_objects);
+#endif
+    WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
+    WH_TEST_ASSERT_RETURN(avail_objects == NF_OBJECT_COUNT);
+
+    WH_TEST_RETURN_ON_FAIL(wh_Client_CommClose(client));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_Cleanup(client));
+
+    return ret;
+}
+
+
+int whTest_ServerCfgLoop(whServerConfig* serverCfg)
+{
+    whServerContext server[1] = {0};
+    whCommConnected am_connected = WH_COMM_CONNECTED;
+    int ret = 0;
+
+    WH_TEST_RETURN_ON_FAIL(wh_Server_Init(server, serverCfg));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_SetConnected(server, am_connected));
+
+    while(am_connected == WH_COMM_CONNECTED) {
+        ret = wh_Server_HandleRequestMessage(server);
+        if ((ret != WH_ERROR_NOTREADY) &&
+                (ret != WH_ERROR_OK)) {
+            WH_ERROR_PRINT("[server] Failed to wh_Server_HandleRequestMessage ret=%d\n", ret);
+            break;
+        }
+        wh_Server_GetConnected(server, &am_connected);
+    }
+
+    if ((ret == 0) || (ret == WH_ERROR_NOTREADY)){
+        ret = 0;
+        WH_TEST_RETURN_ON_FAIL(wh_Server_Cleanup(server));
+    } else {
+        ret = wh_Server_Cleanup(server);
+    }
+	
+    return ret;
+}
+
+
+#if defined(WH_CFG_TEST_POSIX)
+static void* _whClientTask(void *cf)
+{
+    WH_TEST_ASSERT(0 == whTest_ClientCfg(cf));
+    return NULL;
+}
+
+static void* _whServerTask(void* cf)
+{
+    WH_TEST_ASSERT(0 == whTest_ServerCfgLoop(cf));
+    return NULL;
+}
+
+
+static void _whClientServerThreadTest(whClientConfig* c_conf,
+                                whServerConfig* s_conf)
+{
+    pthread_t cthread = {0};
+    pthread_t sthread = {0};
+
+    void* retval;
+    int rc = 0;
 
-            /* Ensure object was destroyed and no longer exists */
-            WH_TEST_RETURN_ON_FAIL(
-                wh_Client_NvmGetMetadataRequest(client, list_id));
-            WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
-            WH_TEST_RETURN_ON_FAIL(wh_Client_NvmGetMetadataResponse(
-                client, &server_rc, NULL, NULL, NULL, NULL, 0, NULL));
-            WH_TEST_ASSERT_RETURN(WH_ERROR_NOTFOUND == server_rc);
+    rc = pthread_create(&sthread, NULL, _whServerTask, s_conf);
+    if (rc == 0) {
+        rc = pthread_create(&cthread, NULL, _whClientTask, c_conf);
+        if (rc == 0) {
+            /* All good. Block on joining */
+
+            pthread_join(cthread, &retval);
+            pthread_cancel(sthread);
+        } else {
+            /* Cancel the server thread */
+            pthread_cancel(sthread);
 
-            list_id = 0;
         }
-    } while (list_count > 0);
+    }
+}
 
+static int wh_ClientServer_MemThreadTest(void)
+{
+    uint8_t req[BUFFER_SIZE] = {0};
+    uint8_t resp[BUFFER_SIZE] = {0};
 
-    WH_TEST_RETURN_ON_FAIL(wh_Client_NvmCleanupRequest(client));
-    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
-    WH_TEST_RETURN_ON_FAIL(wh_Client_NvmCleanupResponse(client, &server_rc));
-#if defined(WH_CFG_TEST_VERBOSE)
-    printf("Client NvmCleanupResponse:%d, server_rc:%d\n", ret, (int)server_rc);
-#endif
-    WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
+    whTransportMemConfig tmcf[1] = {{
+        .req       = (whTransportMemCsr*)req,
+        .req_size  = sizeof(req),
+        .resp      = (whTransportMemCsr*)resp,
+        .resp_size = sizeof(resp),
+    }};
+    /* Client configuration/contexts */
+    whTransportClientCb         tccb[1]   = {WH_TRANSPORT_MEM_CLIENT_CB};
+    whTransportMemClientContext tmcc[1]   = {0};
+    whCommClientConfig          cc_conf[1] = {{
+                 .transport_cb      = tccb,
+                 .transport_context = (void*)tmcc,
+                 .transport_config  = (void*)tmcf,
+                 .client_id         = 123,
+    }};
+    whClientConfig c_conf[1] = {{
+       .comm = cc_conf,
+    }};
+    /* Server configuration/contexts */
+    whTransportServerCb         tscb[1]   = {WH_TRANSPORT_MEM_SERVER_CB};
+    whTransportMemServerContext tmsc[1]   = {0};
+    whCommServerConfig          cs_conf[1] = {{
+                 .transport_cb      = tscb,
+                 .transport_context = (void*)tmsc,
+                 .transport_config  = (void*)tmcf,
+                 .server_id         = 124,
+    }};
 
-    WH_TEST_RETURN_ON_FAIL(wh_Client_NvmGetAvailableRequest(client));
-    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
-    WH_TEST_RETURN_ON_FAIL(wh_Client_NvmGetAvailableResponse(
-        client, &server_rc, &avail_size, &avail_objects, &reclaim_size,
-        &reclaim_objects));
-#if defined(WH_CFG_TEST_VERBOSE)
-    printf("Client NvmGetAvailableResponse:%d, server_rc:%d, avail_size:%d "
-           "avail_objects:%d, reclaim_size:%d reclaim_objects:%d\n",
-           ret, (int)server_rc, (int)avail_size, (int)avail_objects, (int)reclaim_size,
-           (int)reclaim_objects);
-#endif
-    WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
-    WH_TEST_ASSERT_RETURN(avail_objects == NF_OBJECT_COUNT);
+    /* RamSim Flash state and configuration */
+    whFlashRamsimCtx fc[1] = {0};
+    whFlashRamsimCfg fc_conf[1] = {{
+        .size       = FLASH_RAM_SIZE,
+        .sectorSize = FLASH_RAM_SIZE/2,
+        .pageSize   = 8,
+        .erasedByte = (uint8_t)0,
+    }};
+    const whFlashCb  fcb[1]          = {WH_FLASH_RAMSIM_CB};
 
-    /* Test custom registered callbacks */
-    WH_TEST_RETURN_ON_FAIL(_testCallbacks(server, client));
+    /* NVM Flash Configuration using RamSim HAL Flash */
+    whNvmFlashConfig nf_conf[1] = {{
+        .cb      = fcb,
+        .context = fc,
+        .config  = fc_conf,
+    }};
+    whNvmFlashContext nfc[1] = {0};
+    whNvmCb nfcb[1] = {WH_NVM_FLASH_CB};
 
-    /* Test DMA callbacks and address allowlisting */
-    WH_TEST_RETURN_ON_FAIL(_testDma(server, client));
+    whNvmConfig n_conf[1] = {{
+            .cb = nfcb,
+            .context = nfc,
+            .config = nf_conf,
+    }};
+    whNvmContext nvm[1] = {{0}};
 
-    /* Check that we are still connected */
-    WH_TEST_RETURN_ON_FAIL(wh_Server_GetConnected(server, &server_connected));
-    WH_TEST_ASSERT_RETURN(server_connected == WH_COMM_CONNECTED);
+#ifndef WOLFHSM_NO_CRYPTO
+    /* Crypto context */
+    crypto_context crypto[1] = {{
+            .devId = INVALID_DEVID,
+    }};
+#endif
 
-    /* Disconnect the server */
-    WH_TEST_RETURN_ON_FAIL(wh_Client_CommCloseRequest(client));
-    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(server));
-    WH_TEST_RETURN_ON_FAIL(wh_Client_CommCloseResponse(client));
+    whServerConfig                  s_conf[1] = {{
+       .comm_config = cs_conf,
+       .nvm = nvm,
+#ifndef WOLFHSM_NO_CRYPTO
+       .crypto = crypto,
+#endif
+    }};
 
-    /* Ensure we show as disconnected */
-    WH_TEST_RETURN_ON_FAIL(wh_Server_GetConnected(server, &server_connected));
-    WH_TEST_ASSERT_RETURN(server_connected == WH_COMM_DISCONNECTED);
+    WH_TEST_RETURN_ON_FAIL(wh_Nvm_Init(nvm, n_conf));
 
-    /* Clean up the contexts */
-    WH_TEST_RETURN_ON_FAIL(wh_Server_Cleanup(server));
-    WH_TEST_RETURN_ON_FAIL(wh_Client_Cleanup(client));
+#ifndef WOLFHSM_NO_CRYPTO
+    WH_TEST_RETURN_ON_FAIL(wolfCrypt_Init());
+    WH_TEST_RETURN_ON_FAIL(wc_InitRng_ex(crypto->rng, NULL, crypto->devId));
+#endif
+    _whClientServerThreadTest(c_conf, s_conf);
 
     wh_Nvm_Cleanup(nvm);
+
 #ifndef WOLFHSM_NO_CRYPTO
     wc_FreeRng(crypto->rng);
     wolfCrypt_Cleanup();
 #endif
 
-    return ret;
+    return WH_ERROR_OK;
 }
+#endif /* WH_CFG_TEST_POSIX */
 
-int whTest_ClientCfg(whClientConfig* clientCfg)
-{
-    int ret = 0;
-    whClientContext client[1] = {0};
 
-    WH_TEST_RETURN_ON_FAIL(wh_Client_Init(client, clientCfg));
 
-    int counter = 1;
-    char recv_buffer[WH_COMM_DATA_LEN] = {0};
-    char send_buffer[WH_COMM_DATA_LEN] = {0};
-    uint16_t send_len = 0;
-    uint16_t recv_len = 0;
+/* Independent client/server pairs over the memory transport, for tests that
+ * need several servers at once */
+#define MEM_PAIRS_MAX 8
 
-    int32_t server_rc = 0;
-    uint32_t client_id = 0;
-    uint32_t server_id = 0;
-    uint32_t avail_size = 0;
-    uint32_t reclaim_size = 0;
-    whNvmId avail_objects = 0;
-    whNvmId reclaim_objects = 0;
+typedef struct {
+    uint8_t                     req[BUFFER_SIZE];
+    uint8_t                     resp[BUFFER_SIZE];
+    whTransportMemConfig        tmcf[1];
+    whTransportMemClientContext tmcc[1];
+    whCommClientConfig          cc_conf[1];
+    whClientConfig              c_conf[1];
+    whClientContext             client[1];
+    whTransportMemServerContext tmsc[1];
+    whCommServerConfig          cs_conf[1];
+    whServerConfig              s_conf[1];
+    whServerContext             server[1];
+} whTestMemPair;
+
+static const whTransportClientCb _memPairClientCb[1] = {
+    WH_TRANSPORT_MEM_CLIENT_CB};
+static const whTransportServerCb _memPairServerCb[1] = {
+    WH_TRANSPORT_MEM_SERVER_CB};
+
+/* Large enough to be unsuitable for the stack */
+static whTestMemPair _memPairs[MEM_PAIRS_MAX];
+
+static int _memPairsInit(int count)
+{
+    whTestMemPair* pair = NULL;
+    int            i    = 0;
+
+    for (i = 0; i < count; i++) {
+        pair = &_memPairs[i];
+        memset(pair, 0, sizeof(*pair));
+
+        pair->tmcf->req       = (whTransportMemCsr*)pair->req;
+        pair->tmcf->req_size  = sizeof(pair->req);
+        pair->tmcf->resp      = (whTransportMemCsr*)pair->resp;
+        pair->tmcf->resp_size = sizeof(pair->resp);
+
+        pair->cc_conf->transport_cb      = _memPairClientCb;
+        pair->cc_conf->transport_context = (void*)pair->tmcc;
+        pair->cc_conf->transport_config  = (void*)pair->tmcf;
+        pair->cc_conf->client_id         = 10 + i;
+        pair->c_conf->comm               = pair->cc_conf;
+
+        pair->cs_conf->transport_cb      = _memPairServerCb;
+        pair->cs_conf->transport_context = (void*)pair->tmsc;
+        pair->cs_conf->transport_config  = (void*)pair->tmcf;
+        pair->cs_conf->server_id         = 20 + i;
+        pair->s_conf->comm_config        = pair->cs_conf;
+
+        WH_TEST_RETURN_ON_FAIL(wh_Server_Init(pair->server, pair->s_conf));
+        WH_TEST_RETURN_ON_FAIL(wh_Client_Init(pair->client, pair->c_conf));
+        WH_TEST_RETURN_ON_FAIL(
+            wh_Server_SetConnected(pair->server, WH_COMM_CONNECTED));
+    }
+    return 0;
+}
 
-    for (counter = 0; counter < REPEAT_COUNT; counter++) {
+static int _memPairsCleanup(int count)
+{
+    int i = 0;
 
-        /* Prepare echo test */
-        send_len =
-            snprintf(send_buffer, sizeof(send_buffer), "Request:%u", counter);
-        snprintf(recv_buffer, sizeof(recv_buffer), "NOTHING RECEIVED");
-        recv_len = 0;
+    for (i = 0; i < count; i++) {
+        WH_TEST_RETURN_ON_FAIL(wh_Client_Cleanup(_memPairs[i].client));
+        WH_TEST_RETURN_ON_FAIL(wh_Server_Cleanup(_memPairs[i].server));
+    }
+    return 0;
+}
 
-        WH_TEST_RETURN_ON_FAIL(ret = wh_Client_Echo(client, send_len, send_buffer, &recv_len, recv_buffer));
+static int _memPairsIndex(int count, whClientContext* client)
+{
+    int i = 0;
 
-#if defined(WH_CFG_TEST_VERBOSE)
-        printf("Client Echo:%d, len:%d, %.*s, expected:%.*s\n",
-            ret, recv_len, recv_len, recv_buffer, send_len, send_buffer);
-#endif
-        WH_TEST_ASSERT_RETURN( recv_len == send_len);
-        WH_TEST_ASSERT_RETURN( strncmp(recv_buffer, send_buffer, recv_len) == 0);
+    for (i = 0; i < count; i++) {
+        if (_memPairs[i].client == client) {
+            return i;
+        }
     }
+    return -1;
+}
 
-    /* Perform NVM tests */
+#define POOL_TEST_MEMBERS 3
 
-    WH_TEST_RETURN_ON_FAIL(ret = wh_Client_NvmInit(client, &server_rc, &client_id, &server_id));
-    WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
+/* Manually advanced clock so the latency policy is deterministic */
+static uint32_t _poolTestTime = 0;
 
-    WH_TEST_RETURN_ON_FAIL(ret = wh_Client_NvmGetAvailable(
-        client, &server_rc, &avail_size, &avail_objects, &reclaim_size,
-        &reclaim_objects));
+static uint32_t _poolTestTimeCb(void* context)
+{
+    (void)context;
+    return _poolTestTime;
+}
 
-#if defined(WH_CFG_TEST_VERBOSE)
-    printf("Client NvmGetAvailable:%d, server_rc:%d avail_size:%d "
-           "avail_objects:%d, reclaim_size:%d reclaim_objects:%d\n",
-           ret, (int)server_rc, (int)avail_size, (int)avail_objects, (int)reclaim_size,
-           (int)reclaim_objects);
-#endif
-    WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
-    WH_TEST_ASSERT_RETURN(avail_objects == NF_OBJECT_COUNT);
+/* Acquire a member, check it is the expected one, and echo through it */
+static int _poolTestRoundTrip(whClientPool* pool, int expected,
+        uint32_t elapsed)
+{
+    whClientContext* client = NULL;
+    uint32_t token = 0;
+    char     send_buffer[WH_COMM_DATA_LEN] = {0};
+    char     recv_buffer[WH_COMM_DATA_LEN] = {0};
+    uint16_t send_len = 0;
+    uint16_t recv_len = 0;
+    int idx = 0;
+    int rc = 0;
 
+    WH_TEST_RETURN_ON_FAIL(wh_ClientPool_Acquire(pool, &client, &token));
+    idx = _memPairsIndex(POOL_TEST_MEMBERS, client);
+    WH_TEST_ASSERT_RETURN(idx == expected);
 
-    for (counter = 0; counter < 5; counter++) {
-        whNvmId     id                           = counter + 20;
-        whNvmAccess access                       = WOLFHSM_NVM_ACCESS_ANY;
-        whNvmFlags  flags                        = WOLFHSM_NVM_FLAGS_ANY;
-        whNvmSize   label_len                    = 0;
-        char        label[WOLFHSM_NVM_LABEL_LEN] = {0};
-        whNvmSize   len                          = 0;
+    send_len = snprintf(send_buffer, sizeof(send_buffer), "Pool:%d", idx);
+    WH_TEST_RETURN_ON_FAIL(wh_Client_EchoRequest(client, send_len,
+                send_buffer));
+    WH_TEST_RETURN_ON_FAIL(
+        wh_Server_HandleRequestMessage(_memPairs[idx].server));
+    rc = wh_Client_EchoResponse(client, &recv_len, recv_buffer);
+    WH_TEST_ASSERT_RETURN(recv_len == send_len);
+    WH_TEST_ASSERT_RETURN(0 == memcmp(recv_buffer, send_buffer, send_len));
 
-        whNvmId     gid                           = 0;
-        whNvmAccess gaccess                       = 0;
-        whNvmFlags  gflags                        = 0;
-        char        glabel[WOLFHSM_NVM_LABEL_LEN] = {0};
-        whNvmSize   glen                          = 0;
-        whNvmSize   rlen                          = 0;
+    _poolTestTime += elapsed;
+    WH_TEST_RETURN_ON_FAIL(wh_ClientPool_Release(pool, client, token, rc));
+    return rc;
+}
 
-        whNvmId lastAvailObjects = 0;
+static int _testClientPool(void)
+{
+    whClientContext*   members[POOL_TEST_MEMBERS];
+    whClientPoolConfig pool_conf[1];
+    whClientPool       pool[1];
+    whClientContext*   client = NULL;
+    whClientContext*   acquired[POOL_TEST_MEMBERS];
+    uint32_t           tokens[POOL_TEST_MEMBERS];
+    int                expected = 0;
+    int                i = 0;
+
+    /* Several independent servers, each with its own client */
+    WH_TEST_RETURN_ON_FAIL(_memPairsInit(POOL_TEST_MEMBERS));
+    for (i = 0; i < POOL_TEST_MEMBERS; i++) {
+        members[i] = _memPairs[i].client;
+    }
 
-        label_len = snprintf(label, sizeof(label), "Label:%d", id);
-        len = snprintf(send_buffer, sizeof(send_buffer), "Data:%d Counter:%d",
-                       id, counter);
+    memset(pool_conf, 0, sizeof(pool_conf));
+    pool_conf->clients     = members;
+    pool_conf->count       = POOL_TEST_MEMBERS;
+    pool_conf->timeCb      = _poolTestTimeCb;
+    pool_conf->maxFailures = 2;
+
+    /* Bad configurations are rejected */
+    pool_conf->count = 0;
+    WH_TEST_ASSERT_RETURN(WH_ERROR_BADARGS ==
+                          wh_ClientPool_Init(pool, pool_conf));
+    pool_conf->count = WH_CLIENT_POOL_MAX_MEMBERS + 1;
+    WH_TEST_ASSERT_RETURN(WH_ERROR_BADARGS ==
+                          wh_ClientPool_Init(pool, pool_conf));
+    pool_conf->count  = POOL_TEST_MEMBERS;
+    pool_conf->timeCb = NULL;
+    pool_conf->policy = WH_CLIENT_POOL_LATENCY;
+    WH_TEST_ASSERT_RETURN(WH_ERROR_BADARGS ==
+                          wh_ClientPool_Init(pool, pool_conf));
+    pool_conf->timeCb = _poolTestTimeCb;
+    pool_conf->policy = WH_CLIENT_POOL_LEAST_OUTSTANDING;
+
+    /* Each in-flight request occupies a different member */
+    WH_TEST_RETURN_ON_FAIL(wh_ClientPool_Init(pool, pool_conf));
+    for (i = 0; i < POOL_TEST_MEMBERS; i++) {
+        WH_TEST_RETURN_ON_FAIL(
+            wh_ClientPool_Acquire(pool, &acquired[i], &tokens[i]));
+        WH_TEST_ASSERT_RETURN(acquired[i] == _memPairs[i].client);
+    }
+    WH_TEST_ASSERT_RETURN(WH_ERROR_NOTREADY ==
+                          wh_ClientPool_Acquire(pool, &client, &tokens[0]));
+    for (i = 0; i < POOL_TEST_MEMBERS; i++) {
+        WH_TEST_RETURN_ON_FAIL(
+            wh_ClientPool_Release(pool, acquired[i], tokens[i], 0));
+    }
 
-        lastAvailObjects = avail_objects;
+    /* Sequential requests rotate through the servers */
+    for (i = 0; i < 2 * POOL_TEST_MEMBERS; i++) {
+        expected = i % POOL_TEST_MEMBERS;
+        WH_TEST_RETURN_ON_FAIL(_poolTestRoundTrip(pool, expected, 1));
+    }
+    WH_TEST_RETURN_ON_FAIL(wh_ClientPool_Cleanup(pool));
 
-        WH_TEST_RETURN_ON_FAIL(ret = wh_Client_NvmAddObject(
-            client, id, access, flags, label_len, (uint8_t*)label, len,
-            (uint8_t*)send_buffer, &server_rc));
+    /* Latency policy measures each member once, then prefers the fastest */
+    pool_conf->policy = WH_CLIENT_POOL_LATENCY;
+    WH_TEST_RETURN_ON_FAIL(wh_ClientPool_Init(pool, pool_conf));
+    WH_TEST_RETURN_ON_FAIL(_poolTestRoundTrip(pool, 0, 10));
+    WH_TEST_RETURN_ON_FAIL(_poolTestRoundTrip(pool, 1, 2));
+    WH_TEST_RETURN_ON_FAIL(_poolTestRoundTrip(pool, 2, 5));
+    WH_TEST_RETURN_ON_FAIL(_poolTestRoundTrip(pool, 1, 2));
 
-#if defined(WH_CFG_TEST_VERBOSE)
-        printf("Client NvmAddObject:%d, server_rc:%d\n", ret,
-               (int)server_rc);
-#endif
-        WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
+    /* The fastest member being busy falls back to the next fastest */
+    WH_TEST_RETURN_ON_FAIL(
+        wh_ClientPool_Acquire(pool, &acquired[0], &tokens[0]));
+    WH_TEST_ASSERT_RETURN(acquired[0] == _memPairs[1].client);
+    WH_TEST_RETURN_ON_FAIL(_poolTestRoundTrip(pool, 2, 5));
+
+    /* Transport failures take the member out after maxFailures */
+    WH_TEST_RETURN_ON_FAIL(wh_ClientPool_Release(pool, acquired[0],
+                tokens[0], WH_ERROR_ABORTED));
+    WH_TEST_RETURN_ON_FAIL(
+        wh_ClientPool_Acquire(pool, &acquired[0], &tokens[0]));
+    WH_TEST_ASSERT_RETURN(acquired[0] == _memPairs[1].client);
+    WH_TEST_RETURN_ON_FAIL(wh_ClientPool_Release(pool, acquired[0],
+                tokens[0], WH_ERROR_ABORTED));
+    WH_TEST_RETURN_ON_FAIL(_poolTestRoundTrip(pool, 2, 5));
+
+    /* No members left in rotation */
+    WH_TEST_RETURN_ON_FAIL(
+        wh_ClientPool_SetAvailable(pool, _memPairs[0].client, 0));
+    WH_TEST_RETURN_ON_FAIL(
+        wh_ClientPool_SetAvailable(pool, _memPairs[2].client, 0));
+    WH_TEST_ASSERT_RETURN(WH_ERROR_ABORTED ==
+                          wh_ClientPool_Acquire(pool, &client, &tokens[0]));
+
+    /* Bringing a member back restores service */
+    WH_TEST_RETURN_ON_FAIL(
+        wh_ClientPool_SetAvailable(pool, _memPairs[1].client, 1));
+    WH_TEST_RETURN_ON_FAIL(_poolTestRoundTrip(pool, 1, 2));
 
-        WH_TEST_RETURN_ON_FAIL(ret = wh_Client_NvmGetAvailable(
-            client, &server_rc, &avail_size, &avail_objects, &reclaim_size,
-            &reclaim_objects));
+    WH_TEST_RETURN_ON_FAIL(wh_ClientPool_Cleanup(pool));
+    return _memPairsCleanup(POOL_TEST_MEMBERS);
+}
 
-#if defined(WH_CFG_TEST_VERBOSE)
-        printf("Client NvmGetAvailable:%d, server_rc:%d, avail_size:%d "
-               "avail_objects:%d, reclaim_size:%d reclaim_objects:%d\n",
-               ret, (int)server_rc, (int)avail_size, (int)avail_objects, (int)reclaim_size,
-               (int)reclaim_objects);
-#endif
+/* Client clock is advanced by hand.  Server clock ticks on every read */
+static uint64_t _latencyClientTime = 0;
+static uint64_t _latencyServerTime = 0;
 
-        /* Check that available objects decreased by one */
-        WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
-        WH_TEST_ASSERT_RETURN(lastAvailObjects - 1 == avail_objects);
+static uint64_t _latencyClientTimeCb(void* context)
+{
+    (void)context;
+    return _latencyClientTime;
+}
 
-        WH_TEST_RETURN_ON_FAIL(
-            ret = wh_Client_NvmGetMetadata(client, id, &server_rc, &gid,
-                                           &gaccess, &gflags, &glen,
-                                           sizeof(glabel), (uint8_t*)glabel));
+static uint64_t _latencyServerTimeCb(void* context)
+{
+    (void)context;
+    _latencyServerTime += 5;
+    return _latencyServerTime;
+}
 
-#if defined(WH_CFG_TEST_VERBOSE)
-        printf("Client NvmGetMetadata:%d, id:%u, access:0x%x, "
-               "flags:0x%x, len:%u label:%s\n",
-               ret, gid, gaccess, gflags, glen, glabel);
-#endif
+/* Round trip a small fixed-size response, with room for the trailer */
+static int _latencyCommInit(whTestMemPair* pair, uint32_t serverDelay)
+{
+    uint32_t client_id = 0;
+    uint32_t server_id = 0;
 
-        /* Ensure metadata matches that of the object we just wrote */
-        WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
-        WH_TEST_ASSERT_RETURN(gid == id);
+    WH_TEST_RETURN_ON_FAIL(wh_Client_CommInitRequest(pair->client));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(pair->server));
+    _latencyClientTime += serverDelay;
+    WH_TEST_RETURN_ON_FAIL(
+        wh_Client_CommInitResponse(pair->client, &client_id, &server_id));
 
-        memset(recv_buffer, 0, sizeof(recv_buffer));
-        WH_TEST_RETURN_ON_FAIL(ret = wh_Client_NvmRead(client, id, 0, glen,
-                                                       &server_rc, &rlen,
-                                                       (uint8_t*)recv_buffer));
+    /* Any timing trailer is removed before the data is interpreted */
+    WH_TEST_ASSERT_RETURN(client_id == pair->cc_conf->client_id);
+    WH_TEST_ASSERT_RETURN(server_id == pair->cs_conf->server_id);
+    return 0;
+}
 
-#if defined(WH_CFG_TEST_VERBOSE)
-        printf(
-            "Client NvmRead:%d, server_rc:%d id:%u, len:%u data:%s\n",
-            ret, (int)server_rc, (unsigned int)gid, (unsigned int)rlen, recv_buffer);
-#endif
+/* Echo responses always fill the packet */
+static int _latencyEcho(whTestMemPair* pair, uint32_t serverDelay)
+{
+    char     send_buffer[WH_COMM_DATA_LEN / 2];
+    char     recv_buffer[WH_COMM_DATA_LEN];
+    uint16_t recv_len = 0;
 
-        /* Ensure data and size of response object matches that of the written
-         * object */
-        WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
-        WH_TEST_ASSERT_RETURN(rlen == len);
-        WH_TEST_ASSERT_RETURN(0 == memcmp(send_buffer, recv_buffer, len));
-    }
+    memset(send_buffer, 0x5A, sizeof(send_buffer));
+    memset(recv_buffer, 0, sizeof(recv_buffer));
 
-    whNvmAccess list_access = WOLFHSM_NVM_ACCESS_ANY;
-    whNvmFlags  list_flags  = WOLFHSM_NVM_FLAGS_ANY;
-    whNvmId     list_id     = 0;
-    whNvmId     list_count  = 0;
-    do {
+    WH_TEST_RETURN_ON_FAIL(wh_Client_EchoRequest(pair->client,
+                sizeof(send_buffer), send_buffer));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(pair->server));
+    _latencyClientTime += serverDelay;
+    WH_TEST_RETURN_ON_FAIL(
+        wh_Client_EchoResponse(pair->client, &recv_len, recv_buffer));
+    WH_TEST_ASSERT_RETURN(recv_len == sizeof(send_buffer));
+    WH_TEST_ASSERT_RETURN(0 == memcmp(recv_buffer, send_buffer, recv_len));
+    return 0;
+}
+
+static int _testClientLatency(void)
+{
+    whTestMemPair*        pair = &_memPairs[0];
+    whClientLatency       latency[1];
+    whClientLatencySample sample[1];
+    whCommTiming          timing[1];
+    whMessageCustomCb_Request  req  = {0};
+    whMessageCustomCb_Response resp = {0};
+    uint32_t              count = 0;
+    uint64_t              total = 0;
+    uint32_t              us    = 0;
+    int                   i     = 0;
+
+    WH_TEST_RETURN_ON_FAIL(_memPairsInit(1));
+    req.type = WH_MESSAGE_CUSTOM_CB_TYPE_USER_DEFINED_START;
+
+    /* Without configuration nothing is requested or recorded */
+    WH_TEST_RETURN_ON_FAIL(_latencyCommInit(pair, 0));
+    WH_TEST_ASSERT_RETURN(WH_ERROR_NOTFOUND ==
+                          wh_Client_GetLatency(pair->client, sample));
+    WH_TEST_ASSERT_RETURN(WH_ERROR_NOTFOUND ==
+                          wh_CommClient_GetServerTiming(pair->client->comm,
+                                                        timing));
+
+    /* Client asks, but the server has no clock to answer with */
+    WH_TEST_RETURN_ON_FAIL(wh_Client_Cleanup(pair->client));
+    WH_TEST_RETURN_ON_FAIL(wh_ClientLatency_Reset(latency));
+    pair->c_conf->latency = latency;
+    pair->c_conf->timeCb  = _latencyClientTimeCb;
+    WH_TEST_RETURN_ON_FAIL(wh_Client_Init(pair->client, pair->c_conf));
+    _latencyClientTime = 1000;
+    WH_TEST_RETURN_ON_FAIL(_latencyCommInit(pair, 30));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_GetLatency(pair->client, sample));
+    WH_TEST_ASSERT_RETURN(30 == sample->us[WH_CLIENT_LATENCY_TRANSPORT]);
+    WH_TEST_ASSERT_RETURN(0 == sample->us[WH_CLIENT_LATENCY_SERVER]);
+
+    /* Server now reports 5us before dispatch and 5us in the handler */
+    WH_TEST_RETURN_ON_FAIL(wh_Server_Cleanup(pair->server));
+    pair->cs_conf->time_cb = _latencyServerTimeCb;
+    WH_TEST_RETURN_ON_FAIL(wh_Server_Init(pair->server, pair->s_conf));
+    WH_TEST_RETURN_ON_FAIL(
+        wh_Server_SetConnected(pair->server, WH_COMM_CONNECTED));
+    for (i = 0; i < REPEAT_COUNT; i++) {
+        WH_TEST_RETURN_ON_FAIL(_latencyCommInit(pair, 50));
         WH_TEST_RETURN_ON_FAIL(
-            ret = wh_Client_NvmList(client, list_access, list_flags, list_id,
-                              &server_rc, &list_count, &list_id));
-#if defined(WH_CFG_TEST_VERBOSE)
-        printf("Client NvmList:%d, server_rc:%d count:%u id:%u\n", ret,
-                (int)server_rc, (unsigned int)list_count, (unsigned int)list_id);
-#endif
+            wh_CommClient_GetServerTiming(pair->client->comm, timing));
+        WH_TEST_ASSERT_RETURN(5 == timing->recv_to_dispatch);
+        WH_TEST_ASSERT_RETURN(5 == timing->dispatch_to_send);
+        WH_TEST_RETURN_ON_FAIL(wh_Client_GetLatency(pair->client, sample));
+        WH_TEST_ASSERT_RETURN(0 == sample->us[WH_CLIENT_LATENCY_SEND]);
+        WH_TEST_ASSERT_RETURN(40 == sample->us[WH_CLIENT_LATENCY_TRANSPORT]);
+        WH_TEST_ASSERT_RETURN(10 == sample->us[WH_CLIENT_LATENCY_SERVER]);
+        WH_TEST_ASSERT_RETURN(0 == sample->us[WH_CLIENT_LATENCY_RECV]);
+    }
 
-        if (list_count > 0) {
-            /* ensure list_id contains ID of object written, and list_count
-             * shows remaining items in list */
-            WH_TEST_ASSERT_RETURN(list_id == 20 + (5 - list_count));
+    /* A deferred request is timed from its first receive, however many
+     * times the transport delivers it again */
+    WH_TEST_RETURN_ON_FAIL(
+        wh_Server_RegisterCustomCb(pair->server, 0, _customServerDeferCb));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_CustomCbRequest(pair->client, &req));
+    for (i = 0; i < 3; i++) {
+        WH_TEST_ASSERT_RETURN(WH_ERROR_NOTREADY ==
+                              wh_Server_HandleRequestMessage(pair->server));
+        _latencyServerTime += 100;
+    }
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(pair->server));
+    _latencyClientTime += 400;
+    WH_TEST_RETURN_ON_FAIL(wh_Client_CustomCbResponse(pair->client, &resp));
+    WH_TEST_ASSERT_RETURN(resp.rc == 42);
+    WH_TEST_RETURN_ON_FAIL(
+        wh_CommClient_GetServerTiming(pair->client->comm, timing));
+    WH_TEST_ASSERT_RETURN(5 == timing->recv_to_dispatch);
+    WH_TEST_ASSERT_RETURN(305 == timing->dispatch_to_send);
+
+    /* A full response leaves no room for the trailer */
+    WH_TEST_RETURN_ON_FAIL(_latencyEcho(pair, 20));
+    WH_TEST_ASSERT_RETURN(WH_ERROR_NOTFOUND ==
+                          wh_CommClient_GetServerTiming(pair->client->comm,
+                                                        timing));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_GetLatency(pair->client, sample));
+    WH_TEST_ASSERT_RETURN(20 == sample->us[WH_CLIENT_LATENCY_TRANSPORT]);
+
+    /* Histograms hold every configured request, grouped by message group */
+    WH_TEST_RETURN_ON_FAIL(wh_ClientLatency_GetTotal(latency,
+                WH_MESSAGE_GROUP_COMM, WH_CLIENT_LATENCY_SERVER, &count,
+                &total));
+    WH_TEST_ASSERT_RETURN(REPEAT_COUNT + 2 == count);
+    WH_TEST_ASSERT_RETURN(10 * REPEAT_COUNT == total);
+    WH_TEST_RETURN_ON_FAIL(wh_ClientLatency_GetTotal(latency,
+                WH_MESSAGE_GROUP_CUSTOM, WH_CLIENT_LATENCY_SERVER, &count,
+                &total));
+    WH_TEST_ASSERT_RETURN((1 == count) && (310 == total));
+    WH_TEST_RETURN_ON_FAIL(wh_ClientLatency_GetPercentile(latency,
+                WH_MESSAGE_GROUP_COMM, WH_CLIENT_LATENCY_TRANSPORT, 50, &us));
+    WH_TEST_ASSERT_RETURN(63 == us);
+    WH_TEST_RETURN_ON_FAIL(wh_ClientLatency_GetPercentile(latency,
+                WH_MESSAGE_GROUP_COMM, WH_CLIENT_LATENCY_TRANSPORT, 0, &us));
+    WH_TEST_ASSERT_RETURN(31 == us);
+    WH_TEST_ASSERT_RETURN(WH_ERROR_NOTFOUND ==
+                          wh_ClientLatency_GetPercentile(latency,
+                              WH_MESSAGE_GROUP_NVM,
+                              WH_CLIENT_LATENCY_TRANSPORT, 50, &us));
+
+    pair->c_conf->latency  = NULL;
+    pair->c_conf->timeCb   = NULL;
+    pair->cs_conf->time_cb = NULL;
+    return _memPairsCleanup(1);
+}
 
-            WH_TEST_RETURN_ON_FAIL(
-                ret = wh_Client_NvmDestroyObjects(client, 1, &list_id, 0, NULL,
-                                                  &server_rc));
+static int _testNvmLazyMount(void)
+{
+    whTestMemPair*   pair       = &_memPairs[0];
+    whFlashRamsimCtx fc[1]      = {0};
+    whFlashRamsimCfg fc_conf[1] = {{
+        .size       = 64 * 1024, /* 64KB Flash */
+        .sectorSize = 8 * 1024,  /* 8KB Sector Size */
+        .pageSize   = 8,         /* 8B Page Size */
+        .erasedByte = ~(uint8_t)0,
+    }};
+    const whFlashCb  fcb[1]     = {WH_FLASH_RAMSIM_CB};
+    whNvmFlashConfig nf_conf[1] = {{
+        .cb      = fcb,
+        .context = fc,
+        .config  = fc_conf,
+    }};
+    whNvmFlashContext nfc[1]    = {0};
+    whNvmCb           nfcb[1]   = {WH_NVM_FLASH_CB};
+    whNvmConfig       n_conf[1] = {{
+        .cb         = nfcb,
+        .context    = nfc,
+        .config     = nf_conf,
+        .lazy_mount = 1,
+    }};
+    whNvmContext nvm[1]        = {{0}};
+    int32_t      server_rc     = 0;
+    uint32_t     avail_size    = 0;
+    uint32_t     reclaim_size  = 0;
+    whNvmId      avail_objects = 0;
+    whNvmId      reclaim_objs  = 0;
+
+    WH_TEST_RETURN_ON_FAIL(_memPairsInit(1));
+    WH_TEST_RETURN_ON_FAIL(wh_Nvm_Init(nvm, n_conf));
+    WH_TEST_ASSERT_RETURN(0 == wh_Nvm_IsMounted(nvm));
 
-#if defined(WH_CFG_TEST_VERBOSE)
-            printf("Client NvmDestroyObjects:%d, server_rc:%d for "
-                   "id:%u with count:%u\n",
-                   ret, (int)server_rc, (unsigned int)list_id, (unsigned int)list_count);
-#endif
-            WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
+    WH_TEST_RETURN_ON_FAIL(wh_Server_Cleanup(pair->server));
+    pair->s_conf->nvm = nvm;
+    WH_TEST_RETURN_ON_FAIL(wh_Server_Init(pair->server, pair->s_conf));
+    WH_TEST_RETURN_ON_FAIL(
+        wh_Server_SetConnected(pair->server, WH_COMM_CONNECTED));
 
-            /* Ensure object was destroyed and no longer exists */
-            WH_TEST_RETURN_ON_FAIL(ret = wh_Client_NvmGetMetadata(client, list_id, &server_rc, NULL, NULL, NULL, NULL, 0, NULL));
-            WH_TEST_ASSERT_RETURN(WH_ERROR_NOTFOUND == server_rc);
+    /* Requests that do not touch NVM are served before the mount */
+    WH_TEST_RETURN_ON_FAIL(_latencyCommInit(pair, 0));
+    WH_TEST_ASSERT_RETURN(0 == wh_Nvm_IsMounted(nvm));
 
-#if defined(WH_CFG_TEST_VERBOSE)
-            printf("Client NvmGetMetadata:%d, server_rc:%d count:%u id:%u\n",
-                   ret, (int)server_rc, (unsigned int)list_count, (unsigned int)list_id);
-#endif
+    /* The first idle slot mounts, later ones run maintenance */
+    WH_TEST_ASSERT_RETURN(WH_ERROR_NOTREADY ==
+                          wh_Server_HandleRequestMessage(pair->server));
+    WH_TEST_ASSERT_RETURN(1 == wh_Nvm_IsMounted(nvm));
+    WH_TEST_ASSERT_RETURN(WH_ERROR_NOTREADY ==
+                          wh_Server_HandleRequestMessage(pair->server));
+    WH_TEST_ASSERT_RETURN(1 == nfc->inactive_blank);
 
-            list_id = 0;
-        }
-    } while (list_count > 0);
+    /* Without idle time the first NVM request mounts */
+    WH_TEST_RETURN_ON_FAIL(wh_Nvm_Cleanup(nvm));
+    WH_TEST_RETURN_ON_FAIL(wh_Nvm_Init(nvm, n_conf));
+    WH_TEST_ASSERT_RETURN(0 == wh_Nvm_IsMounted(nvm));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_NvmGetAvailableRequest(pair->client));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(pair->server));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_NvmGetAvailableResponse(pair->client,
+                &server_rc, &avail_size, &avail_objects, &reclaim_size,
+                &reclaim_objs));
+    WH_TEST_RETURN_ON_FAIL(server_rc);
+    WH_TEST_ASSERT_RETURN(1 == wh_Nvm_IsMounted(nvm));
+    WH_TEST_ASSERT_RETURN(avail_size > 0);
+
+    WH_TEST_RETURN_ON_FAIL(_memPairsCleanup(1));
+    pair->s_conf->nvm = NULL;
+    return wh_Nvm_Cleanup(nvm);
+}
 
+/* Client and server in one image over the direct-call transport */
+typedef struct {
+    whTransportDirectConfig  tdcf[1];
+    whTransportDirectContext tdc[1];
+    whCommClientConfig       cc_conf[1];
+    whClientConfig           c_conf[1];
+    whClientContext          client[1];
+    whCommServerConfig       cs_conf[1];
+    whServerConfig           s_conf[1];
+    whServerContext          server[1];
+} whTestDirectPair;
+
+static const whTransportClientCb _directPairClientCb[1] = {
+    WH_TRANSPORT_DIRECT_CLIENT_CB};
+static const whTransportServerCb _directPairServerCb[1] = {
+    WH_TRANSPORT_DIRECT_SERVER_CB};
+
+static whTestDirectPair _directPair[1];
+
+static int _directPairDispatch(void* arg)
+{
+    return wh_Server_HandleRequestMessage((whServerContext*)arg);
+}
 
-    WH_TEST_RETURN_ON_FAIL(wh_Client_NvmGetAvailable(
-        client, &server_rc, &avail_size, &avail_objects, &reclaim_size,
-        &reclaim_objects));
-    WH_TEST_ASSERT_RETURN(avail_objects == WOLFHSM_NUM_NVMOBJECTS);
+static int _directPairInit(whNvmContext* nvm)
+{
+    whTestDirectPair* pair = _directPair;
 
-    for (counter = 0; counter < 5; counter++) {
-        whNvmMetadata meta = {
-            .id     = counter + 40,
-            .access = WOLFHSM_NVM_ACCESS_ANY,
-            .flags  = WOLFHSM_NVM_FLAGS_ANY,
-            .len    = 0,
-            .label  = {0},
-        };
-        whNvmSize len = 0;
+    memset(pair, 0, sizeof(*pair));
 
-        whNvmId     gid                           = 0;
-        whNvmAccess gaccess                       = 0;
-        whNvmFlags  gflags                        = 0;
-        char        glabel[WOLFHSM_NVM_LABEL_LEN] = {0};
-        whNvmSize   glen                          = 0;
+    pair->tdcf->dispatch     = _directPairDispatch;
+    pair->tdcf->dispatch_arg = pair->server;
 
-        whNvmId lastAvailObjects = 0;
+    pair->cc_conf->transport_cb      = _directPairClientCb;
+    pair->cc_conf->transport_context = (void*)pair->tdc;
+    pair->cc_conf->transport_config  = (void*)pair->tdcf;
+    pair->cc_conf->client_id         = 30;
+    pair->c_conf->comm               = pair->cc_conf;
 
-        snprintf((char*)(meta.label), sizeof(meta.label), "Label:%d", meta.id);
-        len = snprintf(send_buffer, sizeof(send_buffer), "Data:%d Counter:%d",
-                       meta.id, counter);
+    pair->cs_conf->transport_cb      = _directPairServerCb;
+    pair->cs_conf->transport_context = (void*)pair->tdc;
+    pair->cs_conf->transport_config  = (void*)pair->tdcf;
+    pair->cs_conf->server_id         = 40;
+    pair->s_conf->comm_config        = pair->cs_conf;
+    pair->s_conf->nvm                = nvm;
 
-        lastAvailObjects = avail_objects;
+    WH_TEST_RETURN_ON_FAIL(wh_Server_Init(pair->server, pair->s_conf));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_Init(pair->client, pair->c_conf));
+    return wh_Server_SetConnected(pair->server, WH_COMM_CONNECTED);
+}
 
-        WH_TEST_RETURN_ON_FAIL(ret = wh_Client_NvmAddObjectDma(client, &meta, len, (uint8_t*)send_buffer, &server_rc));
+static int _directPairCleanup(void)
+{
+    WH_TEST_RETURN_ON_FAIL(wh_Client_Cleanup(_directPair->client));
+    return wh_Server_Cleanup(_directPair->server);
+}
 
-#if defined(WH_CFG_TEST_VERBOSE)
-        printf("Client NvmAddObjectDma:%d, server_rc:%d, meta.len:%u\n",
-               ret, (int)server_rc, meta.len);
-#endif
-        WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
+/* Blocking client calls complete without anything driving the server, and
+ * the results match those seen over the memory transport */
+static int _testDirectTransport(void)
+{
+    whTestDirectPair* direct     = _directPair;
+    whTestMemPair*    mem        = &_memPairs[0];
+    whFlashRamsimCtx  fc[1]      = {0};
+    whFlashRamsimCfg  fc_conf[1] = {{
+        .size       = 64 * 1024, /* 64KB Flash */
+        .sectorSize = 8 * 1024,  /* 8KB Sector Size */
+        .pageSize   = 8,         /* 8B Page Size */
+        .erasedByte = ~(uint8_t)0,
+    }};
+    const whFlashCb  fcb[1]     = {WH_FLASH_RAMSIM_CB};
+    whNvmFlashConfig nf_conf[1] = {{
+        .cb      = fcb,
+        .context = fc,
+        .config  = fc_conf,
+    }};
+    whNvmFlashContext nfc[1]    = {0};
+    whNvmCb           nfcb[1]   = {WH_NVM_FLASH_CB};
+    whNvmConfig       n_conf[1] = {{
+        .cb      = nfcb,
+        .context = nfc,
+        .config  = nf_conf,
+    }};
+    whNvmContext nvm[1]   = {{0}};
+    uint8_t      label[]  = "direct";
+    uint8_t      data[]   = "Data written over the direct transport";
+    uint8_t      direct_read[sizeof(data)];
+    uint8_t      mem_read[sizeof(data)];
+    char         send_buffer[WH_COMM_DATA_LEN - sizeof(uint16_t)];
+    char         recv_buffer[WH_COMM_DATA_LEN];
+    uint16_t     recv_len  = 0;
+    uint32_t     client_id = 0;
+    uint32_t     server_id = 0;
+    int32_t      server_rc = 0;
+    whNvmId      out_id    = 0;
+    whNvmAccess  out_access = 0;
+    whNvmFlags   out_flags  = 0;
+    whNvmSize    out_len    = 0;
+    whNvmSize    mem_len    = 0;
 
-        WH_TEST_RETURN_ON_FAIL(ret = wh_Client_NvmGetAvailable(client, &server_rc, &avail_size, &avail_objects, &reclaim_size, &reclaim_objects));
+    WH_TEST_RETURN_ON_FAIL(wh_Nvm_Init(nvm, n_conf));
+    WH_TEST_RETURN_ON_FAIL(_directPairInit(nvm));
 
-#if defined(WH_CFG_TEST_VERBOSE)
-        printf("Client NvmGetAvailable:%d, server_rc:%d, avail_size:%d "
-               "avail_objects:%d, reclaim_size:%d reclaim_objects:%d\n",
-               ret, (int)server_rc, (int)avail_size, (int)avail_objects, (int)reclaim_size,
-               (int)reclaim_objects);
-#endif
-        WH_TEST_ASSERT_RETURN(lastAvailObjects - 1 == avail_objects);
+    WH_TEST_RETURN_ON_FAIL(
+        wh_Client_CommInit(direct->client, &client_id, &server_id));
+    WH_TEST_ASSERT_RETURN(client_id == direct->cc_conf->client_id);
+    WH_TEST_ASSERT_RETURN(server_id == direct->cs_conf->server_id);
+
+    /* Largest echo fills the client packet with the response in place */
+    memset(send_buffer, 0xA5, sizeof(send_buffer));
+    memset(recv_buffer, 0, sizeof(recv_buffer));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_Echo(direct->client, sizeof(send_buffer),
+                send_buffer, &recv_len, recv_buffer));
+    WH_TEST_ASSERT_RETURN(recv_len == sizeof(send_buffer));
+    WH_TEST_ASSERT_RETURN(0 == memcmp(recv_buffer, send_buffer, recv_len));
+
+    /* Split calls work too, with Send having already run the server */
+    WH_TEST_RETURN_ON_FAIL(wh_Client_EchoRequest(direct->client, 5, "Split"));
+    WH_TEST_RETURN_ON_FAIL(
+        wh_Client_EchoResponse(direct->client, &recv_len, recv_buffer));
+    WH_TEST_ASSERT_RETURN(recv_len == 5);
+    WH_TEST_ASSERT_RETURN(0 == memcmp(recv_buffer, "Split", 5));
+
+    WH_TEST_RETURN_ON_FAIL(wh_Client_NvmAddObject(direct->client, 5,
+                WOLFHSM_NVM_ACCESS_ANY, 0, sizeof(label), label,
+                sizeof(data), data, &server_rc));
+    WH_TEST_RETURN_ON_FAIL(server_rc);
+    WH_TEST_RETURN_ON_FAIL(wh_Client_NvmGetMetadata(direct->client, 5,
+                &server_rc, &out_id, &out_access, &out_flags, &out_len, 0,
+                NULL));
+    WH_TEST_RETURN_ON_FAIL(server_rc);
+    WH_TEST_ASSERT_RETURN(out_id == 5);
+    WH_TEST_ASSERT_RETURN(out_len == sizeof(data));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_NvmRead(direct->client, 5, 0,
+                sizeof(direct_read), &server_rc, &out_len, direct_read));
+    WH_TEST_RETURN_ON_FAIL(server_rc);
+    WH_TEST_ASSERT_RETURN(out_len == sizeof(data));
+    WH_TEST_ASSERT_RETURN(0 == memcmp(direct_read, data, out_len));
+
+    /* Same object read through a memory transport server on the same NVM */
+    WH_TEST_RETURN_ON_FAIL(_memPairsInit(1));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_Cleanup(mem->server));
+    mem->s_conf->nvm = nvm;
+    WH_TEST_RETURN_ON_FAIL(wh_Server_Init(mem->server, mem->s_conf));
+    WH_TEST_RETURN_ON_FAIL(
+        wh_Server_SetConnected(mem->server, WH_COMM_CONNECTED));
+    WH_TEST_RETURN_ON_FAIL(
+        wh_Client_NvmReadRequest(mem->client, 5, 0, sizeof(mem_read)));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(mem->server));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_NvmReadResponse(mem->client, &server_rc,
+                &mem_len, mem_read));
+    WH_TEST_RETURN_ON_FAIL(server_rc);
+    WH_TEST_ASSERT_RETURN(mem_len == out_len);
+    WH_TEST_ASSERT_RETURN(0 == memcmp(mem_read, direct_read, mem_len));
+    WH_TEST_RETURN_ON_FAIL(_memPairsCleanup(1));
+    mem->s_conf->nvm = NULL;
+
+    /* Errors come back the same way as any other transport */
+    WH_TEST_RETURN_ON_FAIL(wh_Client_NvmRead(direct->client, 6, 0,
+                sizeof(direct_read), &server_rc, &out_len, direct_read));
+    WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_NOTFOUND);
+
+    WH_TEST_RETURN_ON_FAIL(_directPairCleanup());
+    return wh_Nvm_Cleanup(nvm);
+}
 
-        WH_TEST_RETURN_ON_FAIL(ret = wh_Client_NvmGetMetadata(client, meta.id, &server_rc, &gid, &gaccess, &gflags, &glen, sizeof(glabel), (uint8_t*)glabel));
+#if !defined(WOLFHSM_NO_CRYPTO) && defined(HAVE_ECC)
+/* Registered for the pool, distinct from WOLFHSM_DEV_ID */
+#define POOL_TEST_DEV_ID 0x504F4F4C
 
-#if defined(WH_CFG_TEST_VERBOSE)
-        printf("Client NvmGetMetadata:%d, id:%u, access:0x%x, "
-               "flags:0x%x, len:%u label:%s\n",
-               ret, (unsigned int)gid, (unsigned int)gaccess, (unsigned int)gflags, (unsigned int)glen, glabel);
-#endif
+static whTestDirectPair _poolPairs[POOL_TEST_MEMBERS];
 
-        /* Ensure metadata matches that of the object we just wrote */
-        WH_TEST_ASSERT_RETURN(gid == meta.id);
+/* Client link that fails as if the connection to its server were lost */
+static whTransportDirectContext* _poolBrokenLink = NULL;
 
+static int _poolTestSend(void* c, uint16_t len, const void* data)
+{
+    if (c == _poolBrokenLink) {
+        return WH_ERROR_ABORTED;
+    }
+    return wh_TransportDirect_SendRequest(c, len, data);
+}
 
-        memset(recv_buffer, 0, sizeof(recv_buffer));
+static const whTransportClientCb _poolPairClientCb[1] = {{
+    .Init    = wh_TransportDirect_InitClient,
+    .Send    = _poolTestSend,
+    .Recv    = wh_TransportDirect_RecvResponse,
+    .Cleanup = wh_TransportDirect_CleanupClient,
+}};
+
+static int _poolPairsInit(whNvmContext* nvm, crypto_context* crypto)
+{
+    whTestDirectPair* pair = NULL;
+    int i;
+
+    for (i = 0; i < POOL_TEST_MEMBERS; i++) {
+        pair = &_poolPairs[i];
+        memset(pair, 0, sizeof(*pair));
+
+        pair->tdcf->dispatch     = _directPairDispatch;
+        pair->tdcf->dispatch_arg = pair->server;
+
+        pair->cc_conf->transport_cb      = _poolPairClientCb;
+        pair->cc_conf->transport_context = (void*)pair->tdc;
+        pair->cc_conf->transport_config  = (void*)pair->tdcf;
+        pair->cc_conf->client_id         = 50 + i;
+        pair->c_conf->comm               = pair->cc_conf;
+
+        pair->cs_conf->transport_cb      = _directPairServerCb;
+        pair->cs_conf->transport_context = (void*)pair->tdc;
+        pair->cs_conf->transport_config  = (void*)pair->tdcf;
+        pair->cs_conf->server_id         = 60 + i;
+        pair->s_conf->comm_config        = pair->cs_conf;
+        pair->s_conf->nvm                = nvm;
+        pair->s_conf->crypto             = &crypto[i];
+
+        memset(&crypto[i], 0, sizeof(crypto[i]));
+        crypto[i].devId = INVALID_DEVID;
+        WH_TEST_RETURN_ON_FAIL(wc_InitRng_ex(crypto[i].rng, NULL,
+                crypto[i].devId));
+        WH_TEST_RETURN_ON_FAIL(wh_Server_Init(pair->server, pair->s_conf));
+        WH_TEST_RETURN_ON_FAIL(wh_Client_Init(pair->client, pair->c_conf));
         WH_TEST_RETURN_ON_FAIL(
-            ret = wh_Client_NvmReadDma(client, meta.id, 0, glen,
-                                       (uint8_t*)recv_buffer, &server_rc));
-#if defined(WH_CFG_TEST_VERBOSE)
-        printf("Client NvmReadDma:%d, server_rc:%d id:%u, len:%u "
-               "data:%s\n",
-               ret, (int)server_rc, (unsigned int)gid, (unsigned int)glen, recv_buffer);
-#endif
+            wh_Server_SetConnected(pair->server, WH_COMM_CONNECTED));
+    }
+    return 0;
+}
 
-        /* Ensure data and size of response object matches that of the written
-         * object */
-        WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
-        WH_TEST_ASSERT_RETURN(glen == len);
-        WH_TEST_ASSERT_RETURN(0 == memcmp(send_buffer, recv_buffer, len));
+static int _poolPairsCleanup(crypto_context* crypto)
+{
+    int i;
+
+    for (i = 0; i < POOL_TEST_MEMBERS; i++) {
+        WH_TEST_RETURN_ON_FAIL(wh_Client_Cleanup(_poolPairs[i].client));
+        WH_TEST_RETURN_ON_FAIL(wh_Server_Cleanup(_poolPairs[i].server));
+        (void)wc_FreeRng(crypto[i].rng);
     }
+    return 0;
+}
 
-    do {
-        WH_TEST_RETURN_ON_FAIL(
-            ret = wh_Client_NvmList(client, list_access, list_flags, list_id,
-                                    &server_rc, &list_count, &list_id));
-#if defined(WH_CFG_TEST_VERBOSE)
-        printf("Client NvmList:%d, server_rc:%d count:%u id:%u\n", ret,
-               (int)server_rc, (unsigned int)list_count, (unsigned int)list_id);
-#endif
-        WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
+/* Sign and verify with key, which must stay usable however many times */
+static int _poolSignVerify(WC_RNG* rng, ecc_key* key)
+{
+    uint8_t hash[WC_SHA256_DIGEST_SIZE];
+    uint8_t sig[ECC_MAX_SIG_SIZE];
+    word32  sigLen   = 0;
+    int     verified = 0;
+    int     i;
+
+    memset(hash, 0x48, sizeof(hash));
+    for (i = 0; i < POOL_TEST_MEMBERS; i++) {
+        sigLen = sizeof(sig);
+        WH_TEST_RETURN_ON_FAIL(wc_ecc_sign_hash(hash, sizeof(hash), sig,
+                &sigLen, rng, key));
+        verified = 0;
+        WH_TEST_RETURN_ON_FAIL(wc_ecc_verify_hash(sig, sigLen, hash,
+                sizeof(hash), &verified, key));
+        WH_TEST_ASSERT_RETURN(verified == 1);
+    }
+    return 0;
+}
 
-        if (list_count > 0) {
-            /* ensure list_id contains ID of object written, and list_count
-             * shows remaining items in list */
-            WH_TEST_ASSERT_RETURN(list_id == 40 + (5 - list_count));
+static whClientContext* _poolWaitHeld[POOL_TEST_MEMBERS];
+static uint32_t         _poolWaitTokens[POOL_TEST_MEMBERS];
+static int              _poolWaitCalls = 0;
 
-            WH_TEST_RETURN_ON_FAIL(
-                ret = wh_Client_NvmDestroyObjects(client, 1, &list_id, 0, NULL,
-                                                  &server_rc));
+/* Stands in for another thread finishing with the first member on the
+ * second wait */
+static int _poolWaitCb(void* context)
+{
+    _poolWaitCalls++;
+    if (_poolWaitCalls == 2) {
+        return wh_ClientPool_Release((whClientPool*)context,
+                _poolWaitHeld[0], _poolWaitTokens[0], 0);
+    }
+    return 0;
+}
 
-            WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
+/* Operations through the pool's crypto callback.  RNG is spread across the
+ * members and moves past one whose link fails.  A generated key is only
+ * known to the server that made it, so the key generation and every use of
+ * the key stay on the primary member */
+static int _testClientPoolCrypto(void)
+{
+    static crypto_context crypto[POOL_TEST_MEMBERS];
 
-#if defined(WH_CFG_TEST_VERBOSE)
-            printf("Client NvmDestroyObjects:%d, server_rc:%d for "
-                   "id:%u with count:%u\n",
-                   ret, (int)server_rc, (unsigned int)list_id, (unsigned int)list_count);
-#endif
+    whFlashRamsimCtx  fc[1]      = {0};
+    whFlashRamsimCfg  fc_conf[1] = {{
+        .size       = 64 * 1024, /* 64KB Flash */
+        .sectorSize = 8 * 1024,  /* 8KB Sector Size */
+        .pageSize   = 8,         /* 8B Page Size */
+        .erasedByte = ~(uint8_t)0,
+    }};
+    const whFlashCb  fcb[1]     = {WH_FLASH_RAMSIM_CB};
+    whNvmFlashConfig nf_conf[1] = {{
+        .cb      = fcb,
+        .context = fc,
+        .config  = fc_conf,
+    }};
+    whNvmFlashContext nfc[1]    = {0};
+    whNvmCb           nfcb[1]   = {WH_NVM_FLASH_CB};
+    whNvmConfig       n_conf[1] = {{
+        .cb      = nfcb,
+        .context = nfc,
+        .config  = nf_conf,
+    }};
+    whNvmContext       nvm[1] = {{0}};
+    whClientContext*   members[POOL_TEST_MEMBERS];
+    whClientPoolConfig pool_conf[1];
+    whClientPool       pool[1];
+    WC_RNG             rng[1];
+    ecc_key            key[1];
+    ecc_key            other[1];
+    uint8_t            out[16];
+    uint16_t           next = 0;
+    int                i;
+
+    WH_TEST_RETURN_ON_FAIL(wolfCrypt_Init());
+    WH_TEST_RETURN_ON_FAIL(wh_Nvm_Init(nvm, n_conf));
+    WH_TEST_RETURN_ON_FAIL(_poolPairsInit(nvm, crypto));
+    for (i = 0; i < POOL_TEST_MEMBERS; i++) {
+        members[i] = _poolPairs[i].client;
+    }
+
+    memset(pool_conf, 0, sizeof(pool_conf));
+    pool_conf->clients     = members;
+    pool_conf->count       = POOL_TEST_MEMBERS;
+    pool_conf->maxFailures = 1;
+    WH_TEST_RETURN_ON_FAIL(wh_ClientPool_Init(pool, pool_conf));
+    WH_TEST_ASSERT_RETURN(WH_ERROR_BADARGS ==
+            wh_ClientPool_RegisterCryptoCb(pool, WOLFHSM_DEV_ID));
+    WH_TEST_RETURN_ON_FAIL(
+        wh_ClientPool_RegisterCryptoCb(pool, POOL_TEST_DEV_ID));
+
+    /* Each block comes from the member after the previous one */
+    WH_TEST_RETURN_ON_FAIL(wc_InitRng_ex(rng, NULL, POOL_TEST_DEV_ID));
+    for (i = 0; i < POOL_TEST_MEMBERS; i++) {
+        next = (uint16_t)((pool->next + 1) % POOL_TEST_MEMBERS);
+        WH_TEST_RETURN_ON_FAIL(wc_RNG_GenerateBlock(rng, out, sizeof(out)));
+        WH_TEST_ASSERT_RETURN(pool->next == next);
+    }
 
-            /* Ensure object was destroyed and no longer exists */
-            WH_TEST_RETURN_ON_FAIL(ret = wh_Client_NvmGetMetadata(client, list_id, &server_rc, NULL, NULL, NULL, NULL, 0, NULL));
-            WH_TEST_ASSERT_RETURN(WH_ERROR_NOTFOUND == server_rc);
+    /* With every member busy the callback waits through waitCb, here
+     * releasing a member as another thread would, and fails without it */
+    for (i = 0; i < POOL_TEST_MEMBERS; i++) {
+        WH_TEST_RETURN_ON_FAIL(wh_ClientPool_Acquire(pool, &_poolWaitHeld[i],
+                &_poolWaitTokens[i]));
+    }
+    WH_TEST_ASSERT_RETURN(0 != wc_RNG_GenerateBlock(rng, out, sizeof(out)));
+    _poolWaitCalls = 0;
+    pool->waitCb = _poolWaitCb;
+    pool->waitContext = pool;
+    WH_TEST_RETURN_ON_FAIL(wc_RNG_GenerateBlock(rng, out, sizeof(out)));
+    WH_TEST_ASSERT_RETURN(_poolWaitCalls == 2);
+    pool->waitCb = NULL;
+    pool->waitContext = NULL;
+    for (i = 1; i < POOL_TEST_MEMBERS; i++) {
+        WH_TEST_RETURN_ON_FAIL(wh_ClientPool_Release(pool, _poolWaitHeld[i],
+                _poolWaitTokens[i], 0));
+    }
 
-            list_id = 0;
+    /* A failed link takes its member out and the block comes from the next */
+    i    = pool->next;
+    next = (uint16_t)((i + 2) % POOL_TEST_MEMBERS);
+    _poolBrokenLink = _poolPairs[i].tdc;
+    WH_TEST_RETURN_ON_FAIL(wc_RNG_GenerateBlock(rng, out, sizeof(out)));
+    WH_TEST_ASSERT_RETURN(pool->members[i].down == 1);
+    WH_TEST_ASSERT_RETURN(pool->next == next);
+    _poolBrokenLink = NULL;
+    WH_TEST_RETURN_ON_FAIL(wh_ClientPool_SetAvailable(pool, members[i], 1));
+
+    /* Generated on and used through the primary only */
+    WH_TEST_RETURN_ON_FAIL(wc_ecc_init_ex(key, NULL, POOL_TEST_DEV_ID));
+    WH_TEST_RETURN_ON_FAIL(wc_ecc_make_key(rng, 32, key));
+    next = pool->next;
+    WH_TEST_RETURN_ON_FAIL(_poolSignVerify(rng, key));
+    WH_TEST_ASSERT_RETURN(pool->next == next);
+
+    /* Losing the primary fails the operation rather than moving it to a
+     * server without the key */
+    _poolBrokenLink = _poolPairs[0].tdc;
+    WH_TEST_ASSERT_RETURN(0 != _poolSignVerify(rng, key));
+    WH_TEST_ASSERT_RETURN(pool->members[0].down == 1);
+
+    /* The next member becomes the primary for new keys */
+    WH_TEST_RETURN_ON_FAIL(wc_ecc_init_ex(other, NULL, POOL_TEST_DEV_ID));
+    WH_TEST_RETURN_ON_FAIL(wc_ecc_make_key(rng, 32, other));
+    WH_TEST_RETURN_ON_FAIL(_poolSignVerify(rng, other));
+    wc_ecc_free(other);
+
+    /* Once back in rotation, the first key works again */
+    _poolBrokenLink = NULL;
+    WH_TEST_RETURN_ON_FAIL(wh_ClientPool_SetAvailable(pool, members[0], 1));
+    WH_TEST_RETURN_ON_FAIL(_poolSignVerify(rng, key));
+    wc_ecc_free(key);
+
+    (void)wc_FreeRng(rng);
+    (void)wc_CryptoCb_UnRegisterDevice(POOL_TEST_DEV_ID);
+    WH_TEST_RETURN_ON_FAIL(wh_ClientPool_Cleanup(pool));
+    WH_TEST_RETURN_ON_FAIL(_poolPairsCleanup(crypto));
+    WH_TEST_RETURN_ON_FAIL(wh_Nvm_Cleanup(nvm));
+    WH_TEST_RETURN_ON_FAIL(wolfCrypt_Cleanup());
+    return 0;
+}
+#endif /* !WOLFHSM_NO_CRYPTO && HAVE_ECC */
+
+#define ASYNC_TEST_TASKS 4
+
+/* Per-task state kept across awaits */
+typedef struct {
+    int      count;     /* Echoes remaining */
+    int      done;      /* Echoes completed */
+    uint16_t len;
+    uint8_t  padding[2];
+    char     buf[WH_COMM_DATA_LEN];
+} whTestAsyncEcho;
+
+static int _asyncEchoTask(whClientAsyncTask* task)
+{
+    whTestAsyncEcho* s  = (whTestAsyncEcho*)task->context;
+    int              rc = 0;
+
+    WH_CLIENT_ASYNC_BEGIN(task);
+    while (s->count > 0) {
+        s->len = snprintf(s->buf, sizeof(s->buf), "Async:%d", s->count);
+        WH_CLIENT_ASYNC_AWAIT(task, rc,
+            wh_Client_EchoRequest(task->client, s->len, s->buf));
+        if (rc != 0) {
+            break;
         }
-    } while (list_count > 0);
+        WH_CLIENT_ASYNC_AWAIT(task, rc,
+            wh_Client_EchoResponse(task->client, &s->len, s->buf));
+        if (rc != 0) {
+            break;
+        }
+        s->count--;
+        s->done++;
+    }
+    WH_CLIENT_ASYNC_END(task, rc);
+}
 
+/* Idle callback for a single-threaded test: run every server once */
+static int _asyncServeAll(void* context)
+{
+    int count = *(int*)context;
+    int i     = 0;
+    int rc    = 0;
+
+    for (i = 0; i < count; i++) {
+        rc = wh_Server_HandleRequestMessage(_memPairs[i].server);
+        if ((rc != 0) && (rc != WH_ERROR_NOTREADY)) {
+            return rc;
+        }
+    }
+    return 0;
+}
 
-    WH_TEST_RETURN_ON_FAIL(ret = wh_Client_NvmCleanup(client, &server_rc));
-#if defined(WH_CFG_TEST_VERBOSE)
-    printf("Client NvmCleanup:%d, server_rc:%d\n", ret, (int)server_rc);
-#endif
-    WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
+static int _testClientAsync(void)
+{
+    whClientAsync     loop[1];
+    whClientAsyncTask tasks[ASYNC_TEST_TASKS];
+    whTestAsyncEcho   state[ASYNC_TEST_TASKS];
+    uint32_t          progress = 0;
+    int               count    = ASYNC_TEST_TASKS;
+    int               i        = 0;
+
+    WH_TEST_RETURN_ON_FAIL(_memPairsInit(ASYNC_TEST_TASKS));
+    WH_TEST_RETURN_ON_FAIL(wh_ClientAsync_Init(loop, _asyncServeAll, &count));
+
+    memset(state, 0, sizeof(state));
+    for (i = 0; i < ASYNC_TEST_TASKS; i++) {
+        /* Uneven amounts of work so tasks finish at different times */
+        state[i].count = REPEAT_COUNT + i;
+        WH_TEST_RETURN_ON_FAIL(wh_ClientAsync_Start(loop, &tasks[i],
+                    _asyncEchoTask, _memPairs[i].client, &state[i]));
+    }
 
-    WH_TEST_RETURN_ON_FAIL(ret = wh_Client_NvmGetAvailable(
-        client, &server_rc, &avail_size, &avail_objects, &reclaim_size,
-        &reclaim_objects));
-#if defined(WH_CFG_TEST_VERBOSE)
-    printf("Client NvmGetAvailable:%d, server_rc:%d, avail_size:%d "
-           "avail_objects:%d, reclaim_size:%d reclaim_objects:%d\n",
-           ret, (int)server_rc, (int)avail_size, (int)avail_objects, (int)reclaim_size,
-           (int)reclaim_objects);
-#endif
-    WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
-    WH_TEST_ASSERT_RETURN(avail_objects == NF_OBJECT_COUNT);
+    /* First pass sends every request, with no server having run yet */
+    WH_TEST_ASSERT_RETURN(WH_ERROR_NOTREADY ==
+                          wh_ClientAsync_Poll(loop, &progress));
+    WH_TEST_ASSERT_RETURN(progress == ASYNC_TEST_TASKS);
+    WH_TEST_ASSERT_RETURN(WH_ERROR_NOTREADY ==
+                          wh_ClientAsync_Poll(loop, &progress));
+    WH_TEST_ASSERT_RETURN(progress == 0);
+    for (i = 0; i < ASYNC_TEST_TASKS; i++) {
+        WH_TEST_ASSERT_RETURN(0 == state[i].done);
+        WH_TEST_ASSERT_RETURN(!WH_CLIENT_ASYNC_IS_DONE(&tasks[i]));
+    }
 
-    WH_TEST_RETURN_ON_FAIL(wh_Client_CommClose(client));
-    WH_TEST_RETURN_ON_FAIL(wh_Client_Cleanup(client));
+    WH_TEST_RETURN_ON_FAIL(wh_ClientAsync_Run(loop));
+    WH_TEST_ASSERT_RETURN(0 == loop->active);
+    for (i = 0; i < ASYNC_TEST_TASKS; i++) {
+        WH_TEST_ASSERT_RETURN(WH_CLIENT_ASYNC_IS_DONE(&tasks[i]));
+        WH_TEST_ASSERT_RETURN(0 == tasks[i].rc);
+        WH_TEST_ASSERT_RETURN(REPEAT_COUNT + i == state[i].done);
+        WH_TEST_ASSERT_RETURN(0 == memcmp(state[i].buf, "Async:1",
+                    state[i].len));
+    }
 
-    return ret;
+    return _memPairsCleanup(ASYNC_TEST_TASKS);
 }
 
+#if defined(WH_CFG_TEST_POSIX)
+#define CAPTURE_TEST_FILE "whCapture.bin"
 
-int whTest_ServerCfgLoop(whServerConfig* serverCfg)
+static int _captureServeOne(void* context)
 {
-    whServerContext server[1] = {0};
-    whCommConnected am_connected = WH_COMM_CONNECTED;
-    int ret = 0;
+    int rc = wh_Server_HandleRequestMessage((whServerContext*)context);
+    return ((rc == 0) || (rc == WH_ERROR_NOTREADY)) ? 0 : rc;
+}
 
-    WH_TEST_RETURN_ON_FAIL(wh_Server_Init(server, serverCfg));
-    WH_TEST_RETURN_ON_FAIL(wh_Server_SetConnected(server, am_connected));
+/* Count the records in a capture and check the data of the echo requests */
+static int _captureCheckFile(uint32_t* out_records, int expectZeros)
+{
+    posixCaptureFileHeader hdr;
+    posixCaptureRecord     rec;
+    uint8_t                data[WH_COMM_DATA_LEN];
+    uint16_t               i    = 0;
+    FILE*                  file = fopen(CAPTURE_TEST_FILE, "rb");
+
+    WH_TEST_ASSERT_RETURN(file != NULL);
+    WH_TEST_ASSERT_RETURN(1 == fread(&hdr, sizeof(hdr), 1, file));
+    WH_TEST_ASSERT_RETURN(POSIX_CAPTURE_FILE_MAGIC == hdr.magic);
+
+    *out_records = 0;
+    while (1 == fread(&rec, sizeof(rec), 1, file)) {
+        WH_TEST_ASSERT_RETURN(rec.size <= sizeof(data));
+        WH_TEST_ASSERT_RETURN(1 == fread(data, rec.size, 1, file));
+        if (    (rec.dir == WH_COMM_CAPTURE_REQUEST) &&
+                (rec.kind == WH_MESSAGE_KIND(WH_MESSAGE_GROUP_COMM,
+                                             WH_MESSAGE_COMM_ACTION_ECHO))) {
+            WH_TEST_ASSERT_RETURN(rec.redacted == expectZeros);
+            /* Payload sent by _latencyEcho follows the length field */
+            WH_TEST_ASSERT_RETURN(rec.size >=
+                                  sizeof(uint16_t) + WH_COMM_DATA_LEN / 2);
+            for (i = sizeof(uint16_t);
+                 i < sizeof(uint16_t) + WH_COMM_DATA_LEN / 2; i++) {
+                WH_TEST_ASSERT_RETURN(data[i] ==
+                                      (expectZeros ? 0 : 0x5A));
+            }
+        }
+        (*out_records)++;
+    }
+    fclose(file);
+    return 0;
+}
 
-    while(am_connected == WH_COMM_CONNECTED) {
-        ret = wh_Server_HandleRequestMessage(server);
-        if ((ret != WH_ERROR_NOTREADY) &&
-                (ret != WH_ERROR_OK)) {
-            WH_ERROR_PRINT("[server] Failed to wh_Server_HandleRequestMessage ret=%d\n", ret);
-            break;
+static int _testCapture(void)
+{
+    whTestMemPair*           pair   = &_memPairs[0];
+    whTestMemPair*           replay = &_memPairs[1];
+    posixCaptureContext      cap[1];
+    posixCaptureConfig       cap_conf[1];
+    posixCaptureReplayConfig rp_conf[1];
+    posixCaptureReplayStats  stats[1];
+    whMessageCustomCb_Request  req  = {0};
+    whMessageCustomCb_Response resp = {0};
+    uint8_t                  dma[WH_COMM_DATA_LEN];
+    uint32_t                 records = 0;
+    int                      redact  = 0;
+    int                      rc      = 0;
+    int                      i       = 0;
+
+    WH_TEST_RETURN_ON_FAIL(_memPairsInit(2));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_Cleanup(pair->server));
+    pair->cs_conf->capture_cb      = posixCapture_Record;
+    pair->cs_conf->capture_context = cap;
+    WH_TEST_RETURN_ON_FAIL(wh_Server_Init(pair->server, pair->s_conf));
+    WH_TEST_RETURN_ON_FAIL(
+        wh_Server_SetConnected(pair->server, WH_COMM_CONNECTED));
+    WH_TEST_RETURN_ON_FAIL(
+        wh_Server_RegisterCustomCb(pair->server, 0, _customServerDeferCb));
+    WH_TEST_RETURN_ON_FAIL(
+        wh_Server_RegisterCustomCb(replay->server, 0, _customServerDeferCb));
+    req.type = WH_MESSAGE_CUSTOM_CB_TYPE_USER_DEFINED_START;
+
+    memset(cap_conf, 0, sizeof(cap_conf));
+    cap_conf->filename = CAPTURE_TEST_FILE;
+
+    for (redact = 0; redact < 2; redact++) {
+        cap_conf->redact = redact ? POSIX_CAPTURE_REDACT_ALL :
+                                    POSIX_CAPTURE_REDACT_NONE;
+        WH_TEST_RETURN_ON_FAIL(posixCapture_Init(cap, cap_conf));
+
+        /* A small mix of traffic, each request answered */
+        for (i = 0; i < REPEAT_COUNT; i++) {
+            if ((i % 2) == 0) {
+                WH_TEST_RETURN_ON_FAIL(_latencyEcho(pair, 0));
+            } else {
+                WH_TEST_RETURN_ON_FAIL(_latencyCommInit(pair, 0));
+            }
         }
-        wh_Server_GetConnected(server, &am_connected);
+
+        /* The transport hands a deferred request to the server on every
+         * poll, but it is captured once */
+        WH_TEST_RETURN_ON_FAIL(wh_Client_CustomCbRequest(pair->client, &req));
+        do {
+            rc = wh_Server_HandleRequestMessage(pair->server);
+        } while (rc == WH_ERROR_NOTREADY);
+        WH_TEST_RETURN_ON_FAIL(rc);
+        WH_TEST_ASSERT_RETURN(_deferredSteps == 3);
+        WH_TEST_RETURN_ON_FAIL(wh_Client_CustomCbResponse(pair->client,
+                &resp));
+        WH_TEST_ASSERT_RETURN(resp.rc == 42);
+
+        /* Requests naming client memory, which replay must not send */
+        memset(dma, 0xA5, sizeof(dma));
+        WH_TEST_RETURN_ON_FAIL(posixCapture_Record(cap,
+            WH_COMM_CAPTURE_REQUEST, WH_COMM_MAGIC_NATIVE,
+            WH_MESSAGE_KIND(WH_MESSAGE_GROUP_NVM,
+                            WH_MESSAGE_NVM_ACTION_READDMA32),
+            0, sizeof(whMessageNvm_ReadDma32Request), dma));
+        WH_TEST_RETURN_ON_FAIL(posixCapture_Record(cap,
+            WH_COMM_CAPTURE_REQUEST, WH_COMM_MAGIC_NATIVE,
+            WH_MESSAGE_KIND(WH_MESSAGE_GROUP_NVM,
+                            WH_MESSAGE_NVM_ACTION_ADDOBJECTBULK),
+            0, sizeof(dma), dma));
+
+        WH_TEST_ASSERT_RETURN(2 * REPEAT_COUNT + 4 == cap->records);
+        WH_TEST_ASSERT_RETURN(0 == cap->errors);
+        WH_TEST_RETURN_ON_FAIL(posixCapture_Cleanup(cap));
+
+        WH_TEST_RETURN_ON_FAIL(_captureCheckFile(&records, redact));
+        WH_TEST_ASSERT_RETURN(2 * REPEAT_COUNT + 4 == records);
     }
 
-    if ((ret == 0) || (ret == WH_ERROR_NOTREADY)){
-        ret = 0;
-        WH_TEST_RETURN_ON_FAIL(wh_Server_Cleanup(server));
-    } else {
-        ret = wh_Server_Cleanup(server);
+    /* Replay the redacted capture against another server, unpaced and at
+     * the original pace */
+    memset(rp_conf, 0, sizeof(rp_conf));
+    rp_conf->filename    = CAPTURE_TEST_FILE;
+    rp_conf->idleCb      = _captureServeOne;
+    rp_conf->idleContext = replay->server;
+    for (i = 0; i < 2; i++) {
+        rp_conf->speedup = i;
+        WH_TEST_RETURN_ON_FAIL(
+            posixCapture_Replay(replay->client, rp_conf, stats));
+        WH_TEST_ASSERT_RETURN(REPEAT_COUNT + 1 == stats->requests);
+        WH_TEST_ASSERT_RETURN(REPEAT_COUNT + 1 == stats->redacted);
+        WH_TEST_ASSERT_RETURN(2 == stats->skipped);
+        WH_TEST_ASSERT_RETURN(0 == stats->failures);
+        WH_TEST_ASSERT_RETURN(stats->latency_max_us <= stats->elapsed_us);
+#if defined(WH_CFG_TEST_VERBOSE)
+        printf("  replay speedup %d: %u requests in %lu us, max %u us\n", i,
+               (unsigned)stats->requests, (unsigned long)stats->elapsed_us,
+               (unsigned)stats->latency_max_us);
+#endif
     }
-	
-    return ret;
+
+    rp_conf->filename = "whCaptureMissing.bin";
+    WH_TEST_ASSERT_RETURN(WH_ERROR_NOTFOUND ==
+                          posixCapture_Replay(replay->client, rp_conf, stats));
+
+    pair->cs_conf->capture_cb      = NULL;
+    pair->cs_conf->capture_context = NULL;
+    (void)remove(CAPTURE_TEST_FILE);
+    return _memPairsCleanup(2);
 }
 
+#define ASYNC_BENCH_STREAMS MEM_PAIRS_MAX
+#define ASYNC_BENCH_ECHOES 100
 
-#if defined(WH_CFG_TEST_POSIX)
-static void* _whClientTask(void *cf)
+static volatile int _asyncBenchStop = 0;
+
+static void* _asyncBenchServerTask(void* cf)
 {
-    WH_TEST_ASSERT(0 == whTest_ClientCfg(cf));
+    int count = ASYNC_BENCH_STREAMS;
+
+    (void)cf;
+    while (_asyncBenchStop == 0) {
+        (void)_asyncServeAll(&count);
+    }
     return NULL;
 }
 
-static void* _whServerTask(void* cf)
+static int _asyncBenchYield(void* context)
 {
-    WH_TEST_ASSERT(0 == whTest_ServerCfgLoop(cf));
+    (void)context;
+    return sched_yield();
+}
+
+static void* _asyncBenchClientTask(void* cf)
+{
+    whClientContext* client = (whClientContext*)cf;
+    char     buf[WH_COMM_DATA_LEN] = "Bench";
+    uint16_t len = 0;
+    int      i   = 0;
+
+    for (i = 0; i < ASYNC_BENCH_ECHOES; i++) {
+        if (0 != wh_Client_Echo(client, 5, buf, &len, buf)) {
+            return (void*)-1;
+        }
+    }
     return NULL;
 }
 
+static uint64_t _asyncBenchNowUs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ull + (uint64_t)ts.tv_nsec / 1000;
+}
 
-static void _whClientServerThreadTest(whClientConfig* c_conf,
-                                whServerConfig* s_conf)
+/* Compare one thread driving every stream with the async loop against one
+ * blocking client thread per stream.  Both share a single server thread */
+static int wh_ClientServer_AsyncBenchmark(void)
 {
-    pthread_t cthread = {0};
-    pthread_t sthread = {0};
+    whClientAsync     loop[1];
+    whClientAsyncTask tasks[ASYNC_BENCH_STREAMS];
+    whTestAsyncEcho   state[ASYNC_BENCH_STREAMS];
+    pthread_t         sthread;
+    pthread_t         cthreads[ASYNC_BENCH_STREAMS];
+    void*             retval  = NULL;
+    uint64_t          start   = 0;
+    uint64_t          asyncUs = 0;
+    uint64_t          thrUs   = 0;
+    int               i       = 0;
+
+    WH_TEST_RETURN_ON_FAIL(_memPairsInit(ASYNC_BENCH_STREAMS));
+    _asyncBenchStop = 0;
+    WH_TEST_ASSERT_RETURN(0 ==
+            pthread_create(&sthread, NULL, _asyncBenchServerTask, NULL));
+
+    WH_TEST_RETURN_ON_FAIL(wh_ClientAsync_Init(loop, _asyncBenchYield, NULL));
+    memset(state, 0, sizeof(state));
+    start = _asyncBenchNowUs();
+    for (i = 0; i < ASYNC_BENCH_STREAMS; i++) {
+        state[i].count = ASYNC_BENCH_ECHOES;
+        WH_TEST_RETURN_ON_FAIL(wh_ClientAsync_Start(loop, &tasks[i],
+                    _asyncEchoTask, _memPairs[i].client, &state[i]));
+    }
+    WH_TEST_RETURN_ON_FAIL(wh_ClientAsync_Run(loop));
+    asyncUs = _asyncBenchNowUs() - start;
 
-    void* retval;
-    int rc = 0;
+    start = _asyncBenchNowUs();
+    for (i = 0; i < ASYNC_BENCH_STREAMS; i++) {
+        WH_TEST_ASSERT_RETURN(0 == pthread_create(&cthreads[i], NULL,
+                    _asyncBenchClientTask, _memPairs[i].client));
+    }
+    for (i = 0; i < ASYNC_BENCH_STREAMS; i++) {
+        pthread_join(cthreads[i], &retval);
+        WH_TEST_ASSERT_RETURN(retval == NULL);
+    }
+    thrUs = _asyncBenchNowUs() - start;
 
-    rc = pthread_create(&sthread, NULL, _whServerTask, s_conf);
-    if (rc == 0) {
-        rc = pthread_create(&cthread, NULL, _whClientTask, c_conf);
-        if (rc == 0) {
-            /* All good. Block on joining */
+    _asyncBenchStop = 1;
+    pthread_join(sthread, &retval);
 
-            pthread_join(cthread, &retval);
-            pthread_cancel(sthread);
-        } else {
-            /* Cancel the server thread */
-            pthread_cancel(sthread);
+    for (i = 0; i < ASYNC_BENCH_STREAMS; i++) {
+        WH_TEST_ASSERT_RETURN(0 == tasks[i].rc);
+        WH_TEST_ASSERT_RETURN(ASYNC_BENCH_ECHOES == state[i].done);
+    }
 
-        }
+    printf("  %d streams x %d echoes: async loop %lu us, "
+           "thread per stream %lu us\n",
+           ASYNC_BENCH_STREAMS, ASYNC_BENCH_ECHOES, (unsigned long)asyncUs,
+           (unsigned long)thrUs);
+
+    return _memPairsCleanup(ASYNC_BENCH_STREAMS);
+}
+#define DIRECT_BENCH_ECHOES 2000
+
+/* Round trips of a small echo over the direct-call transport, against the
+ * memory transport with the server handled inline after each request */
+static int wh_ClientServer_DirectBenchmark(void)
+{
+    whTestMemPair* mem      = &_memPairs[0];
+    char           buf[8]   = "Bench";
+    uint16_t       len      = 0;
+    uint64_t       start    = 0;
+    uint64_t       directUs = 0;
+    uint64_t       memUs    = 0;
+    int            i        = 0;
+
+    WH_TEST_RETURN_ON_FAIL(_directPairInit(NULL));
+    start = _asyncBenchNowUs();
+    for (i = 0; i < DIRECT_BENCH_ECHOES; i++) {
+        WH_TEST_RETURN_ON_FAIL(
+            wh_Client_Echo(_directPair->client, 5, buf, &len, buf));
     }
+    directUs = _asyncBenchNowUs() - start;
+    WH_TEST_RETURN_ON_FAIL(_directPairCleanup());
+
+    WH_TEST_RETURN_ON_FAIL(_memPairsInit(1));
+    start = _asyncBenchNowUs();
+    for (i = 0; i < DIRECT_BENCH_ECHOES; i++) {
+        WH_TEST_RETURN_ON_FAIL(wh_Client_EchoRequest(mem->client, 5, buf));
+        WH_TEST_RETURN_ON_FAIL(wh_Server_HandleRequestMessage(mem->server));
+        WH_TEST_RETURN_ON_FAIL(wh_Client_EchoResponse(mem->client, &len, buf));
+    }
+    memUs = _asyncBenchNowUs() - start;
+
+    printf("  %d echoes: direct %lu us, mem %lu us\n", DIRECT_BENCH_ECHOES,
+           (unsigned long)directUs, (unsigned long)memUs);
+
+    return _memPairsCleanup(1);
 }
+#if !defined(WOLFHSM_NO_CRYPTO)
+#define SHARED_KEYSTORE_SERVERS 2
+#define SHARED_KEYSTORE_READS 500
 
-static int wh_ClientServer_MemThreadTest(void)
+typedef struct {
+    whTestMemPair* pair;
+    const uint8_t* key;
+    uint32_t       keySz;
+    uint16_t       keyId;
+    int            rc;
+} whTestKeystoreReader;
+
+/* Export the same cached key repeatedly through one client/server pair */
+static void* _sharedKeystoreReader(void* arg)
 {
-    uint8_t req[BUFFER_SIZE] = {0};
-    uint8_t resp[BUFFER_SIZE] = {0};
+    whTestKeystoreReader* reader = (whTestKeystoreReader*)arg;
+    uint8_t  label[WOLFHSM_NVM_LABEL_LEN];
+    uint8_t  out[64];
+    uint32_t outSz = 0;
+    int      i;
+
+    for (i = 0; (i < SHARED_KEYSTORE_READS) && (reader->rc == 0); i++) {
+        outSz = sizeof(out);
+        reader->rc = wh_Client_KeyExportRequest(reader->pair->client,
+                reader->keyId);
+        if (reader->rc == 0) {
+            reader->rc = wh_Server_HandleRequestMessage(reader->pair->server);
+        }
+        if (reader->rc == 0) {
+            reader->rc = wh_Client_KeyExportResponse(reader->pair->client,
+                    label, sizeof(label), out, &outSz);
+        }
+        if (    (reader->rc == 0) &&
+                ((outSz != reader->keySz) ||
+                 (memcmp(out, reader->key, outSz) != 0)) ) {
+            reader->rc = WH_ERROR_ABORTED;
+        }
+    }
+    return NULL;
+}
 
-    whTransportMemConfig tmcf[1] = {{
-        .req       = (whTransportMemCsr*)req,
-        .req_size  = sizeof(req),
-        .resp      = (whTransportMemCsr*)resp,
-        .resp_size = sizeof(resp),
-    }};
-    /* Client configuration/contexts */
-    whTransportClientCb         tccb[1]   = {WH_TRANSPORT_MEM_CLIENT_CB};
-    whTransportMemClientContext tmcc[1]   = {0};
-    whCommClientConfig          cc_conf[1] = {{
-                 .transport_cb      = tccb,
-                 .transport_context = (void*)tmcc,
-                 .transport_config  = (void*)tmcf,
-                 .client_id         = 123,
-    }};
-    whClientConfig c_conf[1] = {{
-       .comm = cc_conf,
+/* Servers on separate threads share one keystore and NVM.  A key cached
+ * through one server is exported concurrently through both, and a key evicted
+ * through one is gone, along with what was prepared from it, on the other */
+static int _testSharedKeystore(void)
+{
+    /* Large enough to be unsuitable for the stack */
+    static whServerKeystore keystore[1];
+    static crypto_context   crypto[SHARED_KEYSTORE_SERVERS];
+    static whTestKeystoreReader readers[SHARED_KEYSTORE_SERVERS];
+
+    const whLockCb   lockCb[1]         = {POSIX_LOCK_CB};
+    posixLockContext keystoreLock[1]   = {0};
+    posixLockContext nvmLock[1]        = {0};
+    whLockConfig     keystoreLockCfg[1] = {{
+        .cb      = lockCb,
+        .context = keystoreLock,
     }};
-    /* Server configuration/contexts */
-    whTransportServerCb         tscb[1]   = {WH_TRANSPORT_MEM_SERVER_CB};
-    whTransportMemServerContext tmsc[1]   = {0};
-    whCommServerConfig          cs_conf[1] = {{
-                 .transport_cb      = tscb,
-                 .transport_context = (void*)tmsc,
-                 .transport_config  = (void*)tmcf,
-                 .server_id         = 124,
+    whLockConfig     nvmLockCfg[1]     = {{
+        .cb      = lockCb,
+        .context = nvmLock,
     }};
 
-    /* RamSim Flash state and configuration */
-    whFlashRamsimCtx fc[1] = {0};
+    whFlashRamsimCtx fc[1]      = {0};
     whFlashRamsimCfg fc_conf[1] = {{
-        .size       = FLASH_RAM_SIZE,
-        .sectorSize = FLASH_RAM_SIZE/2,
-        .pageSize   = 8,
-        .erasedByte = (uint8_t)0,
+        .size       = 1024 * 1024, /* 1MB  Flash */
+        .sectorSize = 128 * 1024,  /* 128KB  Sector Size */
+        .pageSize   = 8,           /* 8B   Page Size */
+        .erasedByte = ~(uint8_t)0,
     }};
-    const whFlashCb  fcb[1]          = {WH_FLASH_RAMSIM_CB};
-
-    /* NVM Flash Configuration using RamSim HAL Flash */
-    whNvmFlashConfig nf_conf[1] = {{
-        .cb      = fcb,
-        .context = fc,
-        .config  = fc_conf,
+    const whFlashCb  fcb[1]     = {WH_FLASH_RAMSIM_CB};
+    whNvmFlashConfig  nf_conf[1] = {{
+         .cb      = fcb,
+         .context = fc,
+         .config  = fc_conf,
     }};
-    whNvmFlashContext nfc[1] = {0};
-    whNvmCb nfcb[1] = {WH_NVM_FLASH_CB};
-
-    whNvmConfig n_conf[1] = {{
-            .cb = nfcb,
-            .context = nfc,
-            .config = nf_conf,
+    whNvmFlashContext nfc[1]     = {0};
+    whNvmCb           nfcb[1]    = {WH_NVM_FLASH_CB};
+    whNvmConfig  n_conf[1] = {{
+         .cb          = nfcb,
+         .context     = nfc,
+         .config      = nf_conf,
+         .lock_config = nvmLockCfg,
     }};
-    whNvmContext nvm[1] = {{0}};
+    whNvmContext nvm[1]    = {{0}};
 
-#ifndef WOLFHSM_NO_CRYPTO
-    /* Crypto context */
-    crypto_context crypto[1] = {{
-            .devId = INVALID_DEVID,
-    }};
-#endif
+    uint8_t   label[WOLFHSM_NVM_LABEL_LEN] = "SharedKey";
+    uint8_t   key[16];
+    uint8_t   out[sizeof(key)];
+    uint32_t  outSz  = 0;
+    uint16_t  keyId  = 0;
+    pthread_t threads[SHARED_KEYSTORE_SERVERS];
+    void*     retval = NULL;
+    whTestMemPair* pair = NULL;
+    int       i;
 
-    whServerConfig                  s_conf[1] = {{
-       .comm_config = cs_conf,
-       .nvm = nvm,
-#ifndef WOLFHSM_NO_CRYPTO
-       .crypto = crypto,
-#endif
-    }};
+    memset(key, 0x5C, sizeof(key));
+    memset(readers, 0, sizeof(readers));
 
+    WH_TEST_RETURN_ON_FAIL(wolfCrypt_Init());
     WH_TEST_RETURN_ON_FAIL(wh_Nvm_Init(nvm, n_conf));
+    WH_TEST_RETURN_ON_FAIL(wh_Server_KeystoreInit(keystore, keystoreLockCfg));
+
+    /* Restart each paired server on the shared NVM and keystore.  Neither
+     * client sends CommInit, so both servers use client id 0 */
+    WH_TEST_RETURN_ON_FAIL(_memPairsInit(SHARED_KEYSTORE_SERVERS));
+    for (i = 0; i < SHARED_KEYSTORE_SERVERS; i++) {
+        pair = &_memPairs[i];
+        memset(&crypto[i], 0, sizeof(crypto[i]));
+        crypto[i].devId = INVALID_DEVID;
+        WH_TEST_RETURN_ON_FAIL(wc_InitRng_ex(crypto[i].rng, NULL,
+                crypto[i].devId));
+        WH_TEST_RETURN_ON_FAIL(wh_Server_Cleanup(pair->server));
+        pair->s_conf->nvm      = nvm;
+        pair->s_conf->crypto   = &crypto[i];
+        pair->s_conf->keystore = keystore;
+        WH_TEST_RETURN_ON_FAIL(wh_Server_Init(pair->server, pair->s_conf));
+        WH_TEST_RETURN_ON_FAIL(
+            wh_Server_SetConnected(pair->server, WH_COMM_CONNECTED));
+    }
 
-#ifndef WOLFHSM_NO_CRYPTO
-    WH_TEST_RETURN_ON_FAIL(wolfCrypt_Init());
-    WH_TEST_RETURN_ON_FAIL(wc_InitRng_ex(crypto->rng, NULL, crypto->devId));
-#endif
-    _whClientServerThreadTest(c_conf, s_conf);
+    /* Cache through the first server */
+    WH_TEST_RETURN_ON_FAIL(wh_Client_KeyCacheRequest(_memPairs[0].client, 0,
+            label, sizeof(label), key, sizeof(key)));
+    WH_TEST_RETURN_ON_FAIL(
+        wh_Server_HandleRequestMessage(_memPairs[0].server));
+    WH_TEST_RETURN_ON_FAIL(
+        wh_Client_KeyCacheResponse(_memPairs[0].client, &keyId));
+
+    /* Export through both servers at once */
+    for (i = 0; i < SHARED_KEYSTORE_SERVERS; i++) {
+        readers[i].pair  = &_memPairs[i];
+        readers[i].key   = key;
+        readers[i].keySz = sizeof(key);
+        readers[i].keyId = keyId;
+        WH_TEST_ASSERT_RETURN(0 == pthread_create(&threads[i], NULL,
+                _sharedKeystoreReader, &readers[i]));
+    }
+    for (i = 0; i < SHARED_KEYSTORE_SERVERS; i++) {
+        pthread_join(threads[i], &retval);
+    }
+    for (i = 0; i < SHARED_KEYSTORE_SERVERS; i++) {
+        WH_TEST_ASSERT_RETURN(readers[i].rc == 0);
+    }
 
-    wh_Nvm_Cleanup(nvm);
+#if defined(HAVE_AESGCM)
+    {
+        int32_t  server_rc = 0;
+        uint16_t handle    = 0;
+        uint16_t out_len   = 0;
+        uint8_t  iv[12];
+        uint8_t  data[16];
+        uint8_t  enc[sizeof(data) + 16];
+
+        memset(iv, 0x1C, sizeof(iv));
+        memset(data, 0x5D, sizeof(data));
+        WH_TEST_RETURN_ON_FAIL(wh_Client_PrepareAesGcmRequest(
+                _memPairs[0].client, keyId, 1, sizeof(iv), 16));
+        WH_TEST_RETURN_ON_FAIL(
+            wh_Server_HandleRequestMessage(_memPairs[0].server));
+        WH_TEST_RETURN_ON_FAIL(wh_Client_PrepareResponse(
+                _memPairs[0].client, &server_rc, &handle));
+        WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_OK);
 
-#ifndef WOLFHSM_NO_CRYPTO
-    wc_FreeRng(crypto->rng);
-    wolfCrypt_Cleanup();
+        /* Evict through the second server */
+        WH_TEST_RETURN_ON_FAIL(
+            wh_Client_KeyEvictRequest(_memPairs[1].client, keyId));
+        WH_TEST_RETURN_ON_FAIL(
+            wh_Server_HandleRequestMessage(_memPairs[1].server));
+        WH_TEST_RETURN_ON_FAIL(wh_Client_KeyEvictResponse(
+                _memPairs[1].client));
+
+        /* The first server drops what it prepared from the evicted key */
+        out_len = sizeof(enc);
+        WH_TEST_RETURN_ON_FAIL(_preparedExec(_memPairs[0].server,
+                _memPairs[0].client, handle, iv, sizeof(iv), NULL, 0, data,
+                sizeof(data), NULL, 0, enc, &out_len, &server_rc));
+        WH_TEST_ASSERT_RETURN(server_rc == WH_ERROR_BADHANDLE);
+    }
+#else
+    WH_TEST_RETURN_ON_FAIL(
+        wh_Client_KeyEvictRequest(_memPairs[1].client, keyId));
+    WH_TEST_RETURN_ON_FAIL(
+        wh_Server_HandleRequestMessage(_memPairs[1].server));
+    WH_TEST_RETURN_ON_FAIL(wh_Client_KeyEvictResponse(_memPairs[1].client));
 #endif
 
-    return WH_ERROR_OK;
+    /* The key is gone for the first server too */
+    outSz = sizeof(out);
+    WH_TEST_RETURN_ON_FAIL(
+        wh_Client_KeyExportRequest(_memPairs[0].client, keyId));
+    WH_TEST_RETURN_ON_FAIL(
+        wh_Server_HandleRequestMessage(_memPairs[0].server));
+    WH_TEST_ASSERT_RETURN(WH_ERROR_NOTFOUND == wh_Client_KeyExportResponse(
+            _memPairs[0].client, label, sizeof(label), out, &outSz));
+
+    WH_TEST_RETURN_ON_FAIL(_memPairsCleanup(SHARED_KEYSTORE_SERVERS));
+    for (i = 0; i < SHARED_KEYSTORE_SERVERS; i++) {
+        (void)wc_FreeRng(crypto[i].rng);
+    }
+    WH_TEST_RETURN_ON_FAIL(wh_Server_KeystoreCleanup(keystore));
+    WH_TEST_RETURN_ON_FAIL(wh_Nvm_Cleanup(nvm));
+    WH_TEST_RETURN_ON_FAIL(wolfCrypt_Cleanup());
+    return 0;
 }
+#endif /* !WOLFHSM_NO_CRYPTO */
 #endif /* WH_CFG_TEST_POSIX */
 
 
-
 int whTest_ClientServer(void)
 {
     printf("Testing client/server sequential: mem...\n");
     WH_TEST_ASSERT(0 == whTest_ClientServerSequential());
 
+    printf("Testing client pool: mem...\n");
+    WH_TEST_ASSERT(0 == _testClientPool());
+
+    printf("Testing client async loop: mem...\n");
+    WH_TEST_ASSERT(0 == _testClientAsync());
+
+    printf("Testing client latency breakdown: mem...\n");
+    WH_TEST_ASSERT(0 == _testClientLatency());
+
+    printf("Testing lazy NVM mount: mem...\n");
+    WH_TEST_ASSERT(0 == _testNvmLazyMount());
+
+    printf("Testing client/server: direct...\n");
+    WH_TEST_ASSERT(0 == _testDirectTransport());
+
+#if !defined(WOLFHSM_NO_CRYPTO) && defined(HAVE_ECC)
+    printf("Testing client pool crypto callback: direct...\n");
+    WH_TEST_ASSERT(0 == _testClientPoolCrypto());
+#endif
+
 #if defined(WH_CFG_TEST_POSIX)
     printf("Testing client/server: (pthread) mem...\n");
     WH_TEST_ASSERT(0 == wh_ClientServer_MemThreadTest());
 
+    printf("Benchmarking client async loop: (pthread) mem...\n");
+    WH_TEST_ASSERT(0 == wh_ClientServer_AsyncBenchmark());
+
+    printf("Benchmarking echo round trip: direct vs mem...\n");
+    WH_TEST_ASSERT(0 == wh_ClientServer_DirectBenchmark());
+
+    printf("Testing traffic capture and replay: mem...\n");
+    WH_TEST_ASSERT(0 == _testCapture());
+
+#if !defined(WOLFHSM_NO_CRYPTO)
+    printf("Testing shared keystore: (pthread) mem...\n");
+    WH_TEST_ASSERT(0 == _testSharedKeystore());
+#endif
+
 
 #endif /* defined(WH_CFG_TEST_POSIX) */
 
@@ -29,6 +29,7 @@
 #include "wolfhsm/wh_error.h"
 #include "wolfhsm/wh_comm.h"
 #include "wolfhsm/wh_transport_mem.h"
+#include "wolfhsm/wh_transport_direct.h"
 #include "wolfhsm/wh_server.h"
 #include "wolfhsm/wh_client.h"
 
@@ -182,6 +183,132 @@ int whTest_CommMem(void)
 }
 
 
+/* Server side of the direct transport test.  Echoes one request per call */
+typedef struct {
+    whCommServer* server;
+    int           count;
+    uint8_t       padding[4];
+} whTestCommDirectEcho;
+
+static int _whTestCommDirectDispatch(void* arg)
+{
+    whTestCommDirectEcho* echo = (whTestCommDirectEcho*)arg;
+    int      ret;
+    uint8_t  rx_req[REQ_SIZE] = {0};
+    uint16_t rx_req_len       = 0;
+    uint16_t rx_req_flags     = 0;
+    uint16_t rx_req_type      = 0;
+    uint16_t rx_req_seq       = 0;
+    uint8_t  tx_resp[RESP_SIZE] = {0};
+
+    echo->count++;
+    ret = wh_CommServer_RecvRequest(echo->server, &rx_req_flags, &rx_req_type,
+                                    &rx_req_seq, &rx_req_len, rx_req);
+    if (ret == 0) {
+        snprintf((char*)tx_resp, sizeof(tx_resp), "Response:%s", rx_req);
+        ret = wh_CommServer_SendResponse(echo->server, rx_req_flags,
+                rx_req_type, rx_req_seq, strlen((char*)tx_resp), tx_resp);
+    }
+    return ret;
+}
+
+int whTest_CommDirect(void)
+{
+    int ret = 0;
+
+    whCommServer         server[1] = {0};
+    whTestCommDirectEcho echo[1]   = {{.server = server}};
+
+    /* Transport configuration and context, shared by both ends */
+    whTransportDirectConfig  tdcf[1] = {{
+        .dispatch     = _whTestCommDirectDispatch,
+        .dispatch_arg = echo,
+    }};
+    whTransportDirectContext tdc[1] = {0};
+
+    /* Client configuration/contexts */
+    whTransportClientCb tccb[1]   = {WH_TRANSPORT_DIRECT_CLIENT_CB};
+    whCommClientConfig  c_conf[1] = {{
+                 .transport_cb      = tccb,
+                 .transport_context = (void*)tdc,
+                 .transport_config  = (void*)tdcf,
+                 .client_id         = 123,
+    }};
+    whCommClient        client[1] = {0};
+
+    /* Server configuration/contexts */
+    whTransportServerCb tscb[1]   = {WH_TRANSPORT_DIRECT_SERVER_CB};
+    whCommServerConfig  s_conf[1] = {{
+                 .transport_cb      = tscb,
+                 .transport_context = (void*)tdc,
+                 .transport_config  = (void*)tdcf,
+                 .server_id         = 124,
+    }};
+
+    int counter = 0;
+
+    uint8_t  tx_req[REQ_SIZE] = {0};
+    uint16_t tx_req_len       = 0;
+    uint16_t tx_req_flags     = WH_COMM_MAGIC_NATIVE;
+    uint16_t tx_req_type      = 0;
+    uint16_t tx_req_seq       = 0;
+
+    uint8_t  expected[RESP_SIZE] = {0};
+    uint8_t  rx_resp[RESP_SIZE]  = {0};
+    uint16_t rx_resp_len         = 0;
+    uint16_t rx_resp_flags       = 0;
+    uint16_t rx_resp_type        = 0;
+    uint16_t rx_resp_seq         = 0;
+
+    /* Init server and client */
+    WH_TEST_RETURN_ON_FAIL(wh_CommServer_Init(server, s_conf, NULL, NULL));
+    WH_TEST_RETURN_ON_FAIL(wh_CommClient_Init(client, c_conf));
+
+    /* Nothing posted yet */
+    WH_TEST_ASSERT_RETURN(WH_ERROR_NOTREADY ==
+                          wh_CommClient_RecvResponse(
+                              client, &rx_resp_flags, &rx_resp_type,
+                              &rx_resp_seq, &rx_resp_len, rx_resp));
+    WH_TEST_ASSERT_RETURN(echo->count == 1);
+
+    for (counter = 0; counter < REPEAT_COUNT; counter++) {
+        snprintf((char*)tx_req, sizeof(tx_req), "Request:%u", counter);
+        tx_req_len  = strlen((char*)tx_req);
+        tx_req_type = counter * 2;
+        echo->count = 0;
+
+        /* Send runs the server, so the response is waiting on return */
+        WH_TEST_RETURN_ON_FAIL(
+            wh_CommClient_SendRequest(client, tx_req_flags, tx_req_type,
+                &tx_req_seq, tx_req_len, tx_req));
+        WH_TEST_ASSERT_RETURN(echo->count == 1);
+
+        memset(rx_resp, 0, sizeof(rx_resp));
+        WH_TEST_RETURN_ON_FAIL(
+            wh_CommClient_RecvResponse(client, &rx_resp_flags, &rx_resp_type,
+                                       &rx_resp_seq, &rx_resp_len, rx_resp));
+        WH_TEST_ASSERT_RETURN(echo->count == 1);
+
+        snprintf((char*)expected, sizeof(expected), "Response:%s", tx_req);
+        WH_TEST_ASSERT_RETURN(rx_resp_len == strlen((char*)expected));
+        WH_TEST_ASSERT_RETURN(0 == memcmp(rx_resp, expected, rx_resp_len));
+        WH_TEST_ASSERT_RETURN(rx_resp_type == tx_req_type);
+        WH_TEST_ASSERT_RETURN(rx_resp_seq == tx_req_seq);
+
+        /* The response is only delivered once */
+        WH_TEST_ASSERT_RETURN(WH_ERROR_NOTREADY ==
+                              wh_CommClient_RecvResponse(
+                                  client, &rx_resp_flags, &rx_resp_type,
+                                  &rx_resp_seq, &rx_resp_len, rx_resp));
+    }
+
+    WH_TEST_RETURN_ON_FAIL(wh_CommClient_Cleanup(client));
+    WH_TEST_RETURN_ON_FAIL(wh_CommServer_Cleanup(server));
+
+    return ret;
+}
+
+
 #if defined WH_CFG_TEST_POSIX
 
 
@@ -443,6 +570,9 @@ int whTest_Comm(void)
     printf("Testing comms: mem...\n");
     WH_TEST_ASSERT(0 == whTest_CommMem());
 
+    printf("Testing comms: direct...\n");
+    WH_TEST_ASSERT(0 == whTest_CommDirect());
+
 #if defined(WH_CFG_TEST_POSIX)
     printf("Testing comms: (pthread) mem...\n");
     wh_CommClientServer_MemThreadTest();
@@ -25,6 +25,13 @@
  */
 int whTest_CommMem(void);
 
+/*
+ * Runs the comms tests using the direct-call transport, with the server
+ * dispatched from within the client's send.
+ * Returns 0 on success and a non-zero error code on failure
+ */
+int whTest_CommDirect(void);
+
 /* Runs all the comms tests using a memory transport as the backend, and
  * optionally using the POSIX TCP backend if WH_CFG_TEST_POSIX is defined.
  *
@@ -41,6 +41,7 @@
 #include "wolfhsm/wh_message.h"
 #include "wolfhsm/wh_server.h"
 #include "wolfhsm/wh_client.h"
+#include "wolfhsm/wh_client_chacha.h"
 #include "wolfhsm/wh_transport_mem.h"
 
 #include "wh_test_common.h"
@@ -52,6 +53,7 @@
 #endif
 
 #if defined(WH_CFG_TEST_POSIX)
+#include <time.h> /* For clock_gettime */
 #include <unistd.h> /* For sleep */
 #include <pthread.h> /* For pthread_create/cancel/join/_t */
 #include "port/posix/posix_transport_tcp.h"
@@ -67,6 +69,13 @@ enum {
 
 #define PLAINTEXT "mytextisbigplain"
 
+/* Verifies timed against a single server-held key */
+#define ECC_VERIFY_BENCH_COUNT 200
+
+/* AEAD throughput is measured over this many buffers of this size */
+#define AEAD_BENCH_COUNT 256
+#define AEAD_BENCH_LEN 1024
+
 int whTest_CryptoClientConfig(whClientConfig* config)
 {
     whClientContext client[1] = {0};
@@ -327,6 +336,100 @@ int whTest_CryptoClientConfig(whClientConfig* config)
         printf("AES GCM SUCCESS\n");
     else
         printf("AES GCM FAILED TO MATCH\n");
+#if defined(WH_CFG_TEST_POSIX) && defined(HAVE_CHACHA) && \
+    defined(HAVE_POLY1305)
+    /* Compare AES-GCM and ChaCha20-Poly1305 throughput on the same data */
+    {
+        struct timespec start;
+        struct timespec end;
+        uint64_t gcmUs;
+        uint64_t chachaUs;
+        uint8_t chachaKey[WH_CHACHA_KEY_LEN];
+        uint8_t benchIn[AEAD_BENCH_LEN];
+        uint8_t benchOut[AEAD_BENCH_LEN];
+        uint8_t benchIv[WH_CHACHA_IV_LEN];
+        uint16_t chachaId = 0;
+        int32_t serverRc = 0;
+        int i;
+
+        memset(benchIn, 0xA5, sizeof(benchIn));
+        memset(benchIv, 0x1C, sizeof(benchIv));
+        memset(chachaKey, 0x3C, sizeof(chachaKey));
+
+        if ((ret = wc_AesInit(aes, NULL, WOLFHSM_DEV_ID)) != 0) {
+            WH_ERROR_PRINT("Failed to wc_AesInit %d\n", ret);
+            goto exit;
+        }
+#ifdef WOLFHSM_SYMMETRIC_INTERNAL
+        keyId = 0;
+        if ((ret = wh_Client_KeyCache(client, 0, labelStart,
+                sizeof(labelStart), key, sizeof(key), &keyId)) != 0) {
+            WH_ERROR_PRINT("Failed to wh_Client_KeyCache %d\n", ret);
+            goto exit;
+        }
+        wh_Client_SetKeyAes(aes, keyId);
+#else
+        if ((ret = wc_AesGcmSetKey(aes, key, sizeof(key))) != 0) {
+            WH_ERROR_PRINT("Failed to wc_AesGcmSetKey %d\n", ret);
+            goto exit;
+        }
+#endif
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (i = 0; (ret == 0) && (i < AEAD_BENCH_COUNT); i++) {
+            ret = wc_AesGcmEncrypt(aes, benchOut, benchIn, sizeof(benchIn),
+                benchIv, sizeof(benchIv), authTag, sizeof(authTag), authIn,
+                sizeof(authIn));
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+#ifdef WOLFHSM_SYMMETRIC_INTERNAL
+        (void)wh_Client_KeyEvict(client, keyId);
+#endif
+        if (ret != 0) {
+            WH_ERROR_PRINT("AES GCM benchmark failed %d\n", ret);
+            goto exit;
+        }
+        gcmUs = (uint64_t)(end.tv_sec - start.tv_sec) * 1000000ull +
+            (uint64_t)(end.tv_nsec - start.tv_nsec) / 1000;
+
+        if ((ret = wh_Client_KeyCache(client, 0, labelStart,
+                sizeof(labelStart), chachaKey, sizeof(chachaKey),
+                &chachaId)) != 0) {
+            WH_ERROR_PRINT("Failed to wh_Client_KeyCache %d\n", ret);
+            goto exit;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (i = 0; (ret == 0) && (i < AEAD_BENCH_COUNT); i++) {
+            ret = wh_Client_ChaChaCrypt(client, chachaId, 1, benchIv, authIn,
+                sizeof(authIn), benchIn, sizeof(benchIn), benchOut, authTag,
+                &serverRc);
+            if (ret == 0) {
+                ret = serverRc;
+            }
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        (void)wh_Client_KeyEvict(client, chachaId);
+        if (ret != 0) {
+            WH_ERROR_PRINT("ChaCha20-Poly1305 benchmark failed %d\n", ret);
+            goto exit;
+        }
+        chachaUs = (uint64_t)(end.tv_sec - start.tv_sec) * 1000000ull +
+            (uint64_t)(end.tv_nsec - start.tv_nsec) / 1000;
+
+        if (gcmUs == 0) {
+            gcmUs = 1;
+        }
+        if (chachaUs == 0) {
+            chachaUs = 1;
+        }
+        printf("AEAD BENCHMARK: %d x %d bytes, AES-GCM %lu KB/s, "
+            "ChaCha20-Poly1305 %lu KB/s\n",
+            AEAD_BENCH_COUNT, AEAD_BENCH_LEN,
+            (unsigned long)((uint64_t)AEAD_BENCH_COUNT * AEAD_BENCH_LEN *
+                1000000ull / 1024 / gcmUs),
+            (unsigned long)((uint64_t)AEAD_BENCH_COUNT * AEAD_BENCH_LEN *
+                1000000ull / 1024 / chachaUs));
+    }
+#endif
     /* test rsa */
     if((ret = wc_InitRsaKey_ex(rsa, NULL, WOLFHSM_DEV_ID)) != 0) {
         printf("Failed to wc_InitRsaKey_ex %d\n", ret);
@@ -410,6 +513,38 @@ int whTest_CryptoClientConfig(whClientConfig* config)
         printf("ECC SIGN/VERIFY SUCCESS\n");
     else
         printf("ECC SIGN/VERIFY FAIL\n");
+#if defined(WH_CFG_TEST_POSIX)
+    /* Repeated verifies against one key hit the server verifier cache */
+    {
+        struct timespec start;
+        struct timespec end;
+        uint64_t elapsedUs;
+        int i;
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (i = 0; (ret == 0) && (i < ECC_VERIFY_BENCH_COUNT); i++) {
+            ret = wc_ecc_verify_hash((void*)finalText, outLen,
+                (void*)cipherText, sizeof(cipherText), &res, eccPrivate);
+            if ((ret == 0) && (res != 1)) {
+                ret = -1;
+            }
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        if (ret != 0) {
+            WH_ERROR_PRINT("ECC verify benchmark failed %d\n", ret);
+            goto exit;
+        }
+        elapsedUs = (uint64_t)(end.tv_sec - start.tv_sec) * 1000000ull +
+            (uint64_t)(end.tv_nsec - start.tv_nsec) / 1000;
+        if (elapsedUs == 0) {
+            elapsedUs = 1;
+        }
+        printf("ECC VERIFY BENCHMARK: %d verifies in %lu us, %lu ops/sec\n",
+            ECC_VERIFY_BENCH_COUNT, (unsigned long)elapsedUs,
+            (unsigned long)((uint64_t)ECC_VERIFY_BENCH_COUNT * 1000000ull /
+                elapsedUs));
+    }
+#endif
     /* test curve25519 */
     if ((ret = wc_curve25519_init_ex(curve25519PrivateKey, NULL, WOLFHSM_DEV_ID)) != 0) {
         WH_ERROR_PRINT("Failed to wc_curve25519_init_ex %d\n", ret);
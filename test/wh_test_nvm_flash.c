@@ -28,8 +28,11 @@
 
 /* APIs to test */
 #include "wolfhsm/wh_error.h"
+#include "wolfhsm/wh_lock.h"
 #include "wolfhsm/wh_nvm.h"
 #include "wolfhsm/wh_nvm_flash.h"
+#include "wolfhsm/wh_nvm_ram.h"
+#include "wolfhsm/wh_nvm_tier.h"
 
 /* NVM simulator backends to use for testing NVM module */
 #include "wolfhsm/wh_flash_ramsim.h"
@@ -37,6 +40,7 @@
 #include <unistd.h>  /* For unlink */
 #include "port/posix/posix_transport_tcp.h"
 #include "port/posix/posix_flash_file.h"
+#include "port/posix/posix_lock.h"
 #endif
 
 #if defined(WH_CFG_TEST_VERBOSE)
@@ -310,6 +314,186 @@ int whTest_NvmFlashCfg(whNvmFlashConfig* cfg)
     _ShowList(cb, context);
 #endif
 
+    /* Add a list of objects through the generic NVM layer.  The backend is
+     * already initialized, so the context is marked as mounted */
+    {
+        whNvmContext nvm[1] = {{.cb = (whNvmCb*)cb,
+                                .context = context,
+                                .mounted = 1}};
+        whNvmMetadata metaList[2] = {{.id = ids[0], .label = "List1"},
+                                     {.id = ids[1], .label = "List2"}};
+        const uint8_t* dataList[2] = {data1, update2};
+        whNvmMetadata metaBuf = {0};
+        unsigned char dataBuf[256];
+        size_t i = 0;
+
+        printf("--Add a list of objects\n");
+        metaList[0].len = sizeof(data1);
+        metaList[1].len = sizeof(update2);
+        if ((ret = wh_Nvm_AddObjects(nvm, 2, metaList, dataList)) != 0) {
+            WH_ERROR_PRINT("AddObjects returned %d\n", ret);
+            goto cleanup;
+        }
+        for (i = 0; i < 2; i++) {
+            if (    ((ret = cb->GetMetadata(context, ids[i], &metaBuf)) != 0) ||
+                    ((ret = cb->Read(context, ids[i], 0, metaBuf.len,
+                        dataBuf)) != 0) ) {
+                goto cleanup;
+            }
+            if (    (metaBuf.len != metaList[i].len) ||
+                    (memcmp(dataBuf, dataList[i], metaBuf.len) != 0) ) {
+                WH_ERROR_PRINT("AddObjects readback mismatch\n");
+                ret = -1;
+                goto cleanup;
+            }
+        }
+        if ((ret = destroyObjectWithReadBackCheck(cb, context, 2, ids)) != 0) {
+            goto cleanup;
+        }
+    }
+
+    /* Append records to a log object across several extents */
+    {
+        whNvmContext nvm[1] = {{.cb = (whNvmCb*)cb,
+                                .context = context,
+                                .mounted = 1}};
+        whNvmMetadata logMeta = {.id = 500, .label = "Log",
+                                 .flags = WOLFHSM_NVM_FLAGS_ANY};
+        whNvmMetadata plainMeta = {.id = 501, .label = "Plain",
+                                   .flags = WOLFHSM_NVM_FLAGS_ANY};
+        whNvmMetadata metaBuf = {0};
+        unsigned char expected[1024];
+        unsigned char dataBuf[1024];
+        unsigned char record[30];
+        uint32_t avail = 0;
+        uint32_t availAfter = 0;
+        uint32_t reserved = NF_LOG_EXTENT_LEN;
+        int extents = 0;
+        whNvmId listCount = 0;
+        whNvmId listId = 0;
+        int i = 0;
+
+        printf("--Append to a log object\n");
+
+        /* Flags never make a log out of a plain object */
+        if (    ((ret = cb->AddObject(context, &plainMeta, sizeof(data1),
+                    data1)) != 0) ||
+                (wh_Nvm_Append(nvm, plainMeta.id, sizeof(record), record)
+                    != WH_ERROR_BADARGS) ||
+                ((ret = cb->GetMetadata(context, plainMeta.id, &metaBuf))
+                    != 0) ||
+                (metaBuf.len != sizeof(data1)) ||
+                (metaBuf.flags != WOLFHSM_NVM_FLAGS_ANY) ) {
+            WH_ERROR_PRINT("Plain object with all flags set changed\n");
+            ret = (ret != 0) ? ret : -1;
+            goto cleanup;
+        }
+        if ((ret = destroyObjectWithReadBackCheck(cb, context, 1,
+                &plainMeta.id)) != 0) {
+            goto cleanup;
+        }
+
+        memcpy(expected, data1, sizeof(data1));
+        if ((ret = cb->CreateLog(context, &logMeta, sizeof(data1), data1))
+                != 0) {
+            WH_ERROR_PRINT("Log create returned %d\n", ret);
+            goto cleanup;
+        }
+        for (i = 0; (ret == 0) && (i < 32); i++) {
+            memset(record, 'a' + i, sizeof(record));
+            memcpy(expected + sizeof(data1) + i * sizeof(record), record,
+                    sizeof(record));
+            ret = wh_Nvm_GetAvailable(nvm, &avail, NULL, NULL, NULL);
+            if (ret == 0) {
+                ret = wh_Nvm_Append(nvm, logMeta.id, sizeof(record), record);
+            }
+            if (ret == 0) {
+                ret = wh_Nvm_GetAvailable(nvm, &availAfter, NULL, NULL, NULL);
+            }
+            /* Appends only consume space when a new extent is chained,
+             * which doubles the space of the log */
+            if ((ret == 0) && (availAfter != avail)) {
+                if (avail - availAfter != reserved) {
+                    WH_ERROR_PRINT("Append used %u bytes\n",
+                            (unsigned int)(avail - availAfter));
+                    ret = -1;
+                }
+                reserved += avail - availAfter;
+            }
+        }
+        if (ret != 0) {
+            WH_ERROR_PRINT("Append returned %d\n", ret);
+            goto cleanup;
+        }
+
+        /* One directory entry per doubling of the log */
+        for (i = 0; i < context->directory.next_free_object; i++) {
+            if (    (context->directory.objects[i].state.status ==
+                        NF_STATUS_USED) &&
+                    (context->directory.objects[i].metadata.id ==
+                        logMeta.id) ) {
+                extents++;
+            }
+        }
+        if (    (extents < 3) ||
+                (reserved != ((uint32_t)NF_LOG_EXTENT_LEN << (extents - 1))) ) {
+            WH_ERROR_PRINT("Log of %u bytes in %d extents\n",
+                    (unsigned int)reserved, extents);
+            ret = -1;
+            goto cleanup;
+        }
+
+        /* Extents are not listed as separate objects */
+        if (    ((ret = cb->List(context, WOLFHSM_NVM_ACCESS_ANY,
+                    WOLFHSM_NVM_FLAGS_ANY, 0, &listCount, &listId)) != 0) ||
+                (listCount != 1) || (listId != logMeta.id) ) {
+            WH_ERROR_PRINT("Log list mismatch %u\n", listCount);
+            ret = (ret != 0) ? ret : -1;
+            goto cleanup;
+        }
+
+        /* Check the log after a reclaim and after the tail is rescanned */
+        for (i = 0; i < 3; i++) {
+            if (i == 1) {
+                memset(context->logs, 0, sizeof(context->logs));
+            }
+            else if ((i == 2) &&
+                    ((ret = cb->DestroyObjects(context, 0, NULL)) != 0)) {
+                goto cleanup;
+            }
+            if (    ((ret = cb->GetMetadata(context, logMeta.id, &metaBuf))
+                        != 0) ||
+                    (metaBuf.len != sizeof(data1) + 32 * sizeof(record)) ) {
+                WH_ERROR_PRINT("Log length mismatch %u\n", metaBuf.len);
+                ret = (ret != 0) ? ret : -1;
+                goto cleanup;
+            }
+            /* Ranged read that spans an extent boundary */
+            if (    ((ret = cb->Read(context, logMeta.id, 100, 600,
+                        dataBuf)) != 0) ||
+                    (memcmp(dataBuf, expected + 100, 600) != 0) ) {
+                WH_ERROR_PRINT("Log readback mismatch\n");
+                ret = (ret != 0) ? ret : -1;
+                goto cleanup;
+            }
+        }
+
+        /* Reads past the committed length fail */
+        if (cb->Read(context, logMeta.id, metaBuf.len, 1, dataBuf) !=
+                WH_ERROR_BADARGS) {
+            ret = -1;
+            goto cleanup;
+        }
+        if ((ret = wh_Nvm_Append(nvm, logMeta.id, sizeof(record), record))
+                != 0) {
+            goto cleanup;
+        }
+        if ((ret = destroyObjectWithReadBackCheck(cb, context, 1,
+                &logMeta.id)) != 0) {
+            goto cleanup;
+        }
+    }
+
     printf("--Done\n");
 
 cleanup:
@@ -349,6 +533,712 @@ int whTest_NvmFlash_RamSim(void)
 }
 
 
+/* Keep the simulated flash contents across an NVM reinit, as over a reset */
+static int _keepInit(void* context, const void* config)
+{
+    if (((whFlashRamsimCtx*)context)->memory != NULL) {
+        return 0;
+    }
+    return whFlashRamsim_Init(context, config);
+}
+
+static int _keepCleanup(void* context)
+{
+    (void)context;
+    return 0;
+}
+
+int whTest_NvmTier_RamSim(void)
+{
+    /* Persistent tier: NVM flash on a RAM-based flash simulator */
+    whFlashCb        myFlashCb[1]     = {WH_FLASH_RAMSIM_CB};
+    whFlashRamsimCtx myHalFlashCtx[1] = {0};
+    whFlashRamsimCfg myHalFlashCfg[1] = {{
+        .size       = 1024 * 1024, /* 1MB  Flash */
+        .sectorSize = 4096,        /* 4KB  Sector Size */
+        .pageSize   = 8,           /* 8B   Page Size */
+        .erasedByte = (uint8_t)0,
+    }};
+    whNvmCb           myFlashNvmCb[1]  = {WH_NVM_FLASH_CB};
+    whNvmFlashContext myFlashNvmCtx[1] = {0};
+    whNvmFlashConfig  myFlashNvmCfg    = {
+        .cb      = myFlashCb,
+        .context = myHalFlashCtx,
+        .config  = myHalFlashCfg,
+    };
+    whNvmConfig myPersistentCfg = {
+        .cb      = myFlashNvmCb,
+        .context = myFlashNvmCtx,
+        .config  = &myFlashNvmCfg,
+    };
+
+    /* Volatile tier: RAM NVM */
+    uint8_t         myRamBuffer[1024];
+    whNvmCb         myRamNvmCb[1]  = {WH_NVM_RAM_CB};
+    whNvmRamContext myRamNvmCtx[1] = {0};
+    whNvmRamConfig  myRamNvmCfg    = {
+        .buffer = myRamBuffer,
+        .size   = sizeof(myRamBuffer),
+    };
+    whNvmConfig myVolatileCfg = {
+        .cb      = myRamNvmCb,
+        .context = myRamNvmCtx,
+        .config  = &myRamNvmCfg,
+    };
+
+    const whNvmCb    cb[1]      = {WH_NVM_TIER_CB};
+    whNvmTierContext context[1] = {0};
+    whNvmTierConfig  cfg        = {
+        .volatile_config   = &myVolatileCfg,
+        .persistent_config = &myPersistentCfg,
+    };
+
+    unsigned char persistData[] = "Persistent";
+    unsigned char sessionData[] = "Session";
+    unsigned char shadowData[]  = "Shadow";
+    whNvmMetadata persistMeta   = {.id = 10, .label = "Persist"};
+    whNvmMetadata sessionMeta   = {.id = 20, .label = "Session"};
+    whNvmMetadata shadowMeta    = {.id = 10, .label = "Shadow"};
+    whNvmMetadata allFlagsMeta  = {.id = 30, .label = "AllFlags",
+                                   .flags = 0xFFFF};
+    whNvmMetadata metaBuf       = {0};
+    uint8_t       buf[sizeof(persistData)] = {0};
+    whNvmId       count  = 0;
+    whNvmId       id     = 0;
+    int           active = 0;
+
+    /* Flash survives the tier reinit below, as over a reset */
+    myFlashCb->Init    = _keepInit;
+    myFlashCb->Cleanup = _keepCleanup;
+
+    WH_TEST_RETURN_ON_FAIL(cb->Init(context, &cfg));
+
+    printf("--Route objects by add call\n");
+    WH_TEST_RETURN_ON_FAIL(addObjectWithReadBackCheck(cb, (void*)context,
+            &persistMeta, sizeof(persistData), persistData));
+    WH_TEST_RETURN_ON_FAIL(wh_NvmTier_AddVolatileObject(context,
+            &sessionMeta, sizeof(sessionData), sessionData));
+    WH_TEST_ASSERT_RETURN(0 == wh_NvmFlash_GetMetadata(myFlashNvmCtx,
+            persistMeta.id, NULL));
+    WH_TEST_ASSERT_RETURN(WH_ERROR_NOTFOUND == wh_NvmFlash_GetMetadata(
+            myFlashNvmCtx, sessionMeta.id, NULL));
+    WH_TEST_ASSERT_RETURN(0 == wh_NvmRam_GetMetadata(myRamNvmCtx,
+            sessionMeta.id, NULL));
+
+    printf("--Volatile object shadows persistent id\n");
+    WH_TEST_RETURN_ON_FAIL(wh_NvmTier_AddVolatileObject(context,
+            &shadowMeta, sizeof(shadowData), shadowData));
+    WH_TEST_RETURN_ON_FAIL(cb->GetMetadata(context, persistMeta.id, &metaBuf));
+    WH_TEST_ASSERT_RETURN(metaBuf.len == sizeof(shadowData));
+
+    /* List spans both tiers without repeating the shadowed id */
+    WH_TEST_RETURN_ON_FAIL(cb->List(context, WOLFHSM_NVM_ACCESS_ANY,
+            WOLFHSM_NVM_FLAGS_ANY, 0, &count, &id));
+    WH_TEST_ASSERT_RETURN((count == 2) && (id == sessionMeta.id));
+    WH_TEST_RETURN_ON_FAIL(cb->List(context, WOLFHSM_NVM_ACCESS_ANY,
+            WOLFHSM_NVM_FLAGS_ANY, id, &count, &id));
+    WH_TEST_ASSERT_RETURN((count == 1) && (id == persistMeta.id));
+    WH_TEST_RETURN_ON_FAIL(cb->List(context, WOLFHSM_NVM_ACCESS_ANY,
+            WOLFHSM_NVM_FLAGS_ANY, id, &count, &id));
+    WH_TEST_ASSERT_RETURN((count == 0) && (id == 0));
+
+    printf("--Destroy volatile objects without touching flash\n");
+    active = myFlashNvmCtx->active;
+    WH_TEST_RETURN_ON_FAIL(destroyObjectWithReadBackCheck(cb, (void*)context,
+            1, &sessionMeta.id));
+    WH_TEST_ASSERT_RETURN(active == myFlashNvmCtx->active);
+
+    printf("--Persistent add replaces volatile copy\n");
+    WH_TEST_RETURN_ON_FAIL(addObjectWithReadBackCheck(cb, (void*)context,
+            &persistMeta, sizeof(persistData), persistData));
+    WH_TEST_ASSERT_RETURN(WH_ERROR_NOTFOUND == wh_NvmRam_GetMetadata(
+            myRamNvmCtx, persistMeta.id, NULL));
+    WH_TEST_RETURN_ON_FAIL(destroyObjectWithReadBackCheck(cb, (void*)context,
+            1, &persistMeta.id));
+    WH_TEST_ASSERT_RETURN(WH_ERROR_NOTFOUND == wh_NvmFlash_GetMetadata(
+            myFlashNvmCtx, persistMeta.id, NULL));
+
+    printf("--Metadata flags never select the volatile tier\n");
+    WH_TEST_RETURN_ON_FAIL(addObjectWithReadBackCheck(cb, (void*)context,
+            &allFlagsMeta, sizeof(persistData), persistData));
+    WH_TEST_RETURN_ON_FAIL(wh_NvmTier_AddVolatileObject(context,
+            &sessionMeta, sizeof(sessionData), sessionData));
+    WH_TEST_RETURN_ON_FAIL(cb->Cleanup(context));
+    WH_TEST_RETURN_ON_FAIL(cb->Init(context, &cfg));
+    WH_TEST_ASSERT_RETURN(WH_ERROR_NOTFOUND == cb->GetMetadata(context,
+            sessionMeta.id, NULL));
+    WH_TEST_RETURN_ON_FAIL(cb->GetMetadata(context, allFlagsMeta.id,
+            &metaBuf));
+    WH_TEST_ASSERT_RETURN(metaBuf.flags == allFlagsMeta.flags);
+    WH_TEST_RETURN_ON_FAIL(cb->Read(context, allFlagsMeta.id, 0,
+            sizeof(buf), buf));
+    WH_TEST_ASSERT_RETURN(0 == memcmp(buf, persistData, sizeof(buf)));
+    WH_TEST_RETURN_ON_FAIL(destroyObjectWithReadBackCheck(cb, (void*)context,
+            1, &allFlagsMeta.id));
+
+    printf("--Done\n");
+    WH_TEST_RETURN_ON_FAIL(cb->Cleanup(context));
+    return whFlashRamsim_Cleanup(myHalFlashCtx);
+}
+
+
+/* Lock that counts acquisitions and fails on any conflicting access */
+typedef struct {
+    int readers;
+    int writers;
+    int readCount;
+    int writeCount;
+} countingLockContext;
+
+static int _countingLockInit(void* c, const void* cf)
+{
+    (void)cf;
+    memset(c, 0, sizeof(countingLockContext));
+    return 0;
+}
+
+static int _countingLockCleanup(void* c)
+{
+    countingLockContext* ctx = (countingLockContext*)c;
+    return ((ctx->readers != 0) || (ctx->writers != 0)) ? WH_ERROR_ABORTED : 0;
+}
+
+static int _countingLockRead(void* c)
+{
+    countingLockContext* ctx = (countingLockContext*)c;
+    if (ctx->writers != 0) {
+        return WH_ERROR_ABORTED;
+    }
+    ctx->readers++;
+    ctx->readCount++;
+    return 0;
+}
+
+static int _countingUnlockRead(void* c)
+{
+    countingLockContext* ctx = (countingLockContext*)c;
+    if (ctx->readers <= 0) {
+        return WH_ERROR_ABORTED;
+    }
+    ctx->readers--;
+    return 0;
+}
+
+static int _countingLockWrite(void* c)
+{
+    countingLockContext* ctx = (countingLockContext*)c;
+    if ((ctx->readers != 0) || (ctx->writers != 0)) {
+        return WH_ERROR_ABORTED;
+    }
+    ctx->writers++;
+    ctx->writeCount++;
+    return 0;
+}
+
+static int _countingUnlockWrite(void* c)
+{
+    countingLockContext* ctx = (countingLockContext*)c;
+    if (ctx->writers != 1) {
+        return WH_ERROR_ABORTED;
+    }
+    ctx->writers--;
+    return 0;
+}
+
+static int whTest_NvmLockCfg(const whLockConfig* lockCfg,
+        countingLockContext* counts)
+{
+    /* NVM flash on a RAM-based flash simulator */
+    const whFlashCb  myFlashCb[1]     = {WH_FLASH_RAMSIM_CB};
+    whFlashRamsimCtx myHalFlashCtx[1] = {0};
+    whFlashRamsimCfg myHalFlashCfg[1] = {{
+        .size       = 1024 * 1024, /* 1MB  Flash */
+        .sectorSize = 4096,        /* 4KB  Sector Size */
+        .pageSize   = 8,           /* 8B   Page Size */
+        .erasedByte = (uint8_t)0,
+    }};
+    whNvmCb           myNvmCb[1]  = {WH_NVM_FLASH_CB};
+    whNvmFlashContext myNvmCtx[1] = {0};
+    whNvmFlashConfig  myNvmFlashCfg = {
+        .cb      = myFlashCb,
+        .context = myHalFlashCtx,
+        .config  = myHalFlashCfg,
+    };
+    whNvmConfig myNvmCfg = {
+        .cb          = myNvmCb,
+        .context     = myNvmCtx,
+        .config      = &myNvmFlashCfg,
+        .lock_config = lockCfg,
+    };
+    whNvmContext nvm[1] = {{0}};
+
+    unsigned char data[]  = "Locked";
+    unsigned char buf[sizeof(data)];
+    const uint8_t* dataList[1] = {data};
+    whNvmMetadata meta    = {.id = 30, .label = "Lock"};
+    whNvmMetadata metaBuf = {0};
+    whNvmId       count   = 0;
+    whNvmId       id      = 0;
+    uint32_t      avail   = 0;
+    whNvmId       availObjects = 0;
+    uint32_t      reclaim = 0;
+    whNvmId       reclaimObjects = 0;
+
+    WH_TEST_RETURN_ON_FAIL(wh_Nvm_Init(nvm, &myNvmCfg));
+
+    /* Modifying operations take the lock exclusively */
+    WH_TEST_RETURN_ON_FAIL(wh_Nvm_AddObject(nvm, &meta, sizeof(data), data));
+    meta.len = sizeof(data);
+    WH_TEST_RETURN_ON_FAIL(wh_Nvm_AddObjects(nvm, 1, &meta, dataList));
+    if (counts != NULL) {
+        WH_TEST_ASSERT_RETURN((counts->writeCount == 2) &&
+                              (counts->readCount == 0));
+    }
+
+    /* Lookups share it */
+    WH_TEST_RETURN_ON_FAIL(wh_Nvm_GetAvailable(nvm, &avail, &availObjects,
+            &reclaim, &reclaimObjects));
+    WH_TEST_RETURN_ON_FAIL(wh_Nvm_List(nvm, WOLFHSM_NVM_ACCESS_ANY,
+            WOLFHSM_NVM_FLAGS_ANY, 0, &count, &id));
+    WH_TEST_ASSERT_RETURN((count == 1) && (id == meta.id));
+    WH_TEST_RETURN_ON_FAIL(wh_Nvm_GetMetadata(nvm, meta.id, &metaBuf));
+    WH_TEST_RETURN_ON_FAIL(wh_Nvm_Read(nvm, meta.id, 0, sizeof(buf), buf));
+    WH_TEST_ASSERT_RETURN(0 == memcmp(buf, data, sizeof(data)));
+    if (counts != NULL) {
+        WH_TEST_ASSERT_RETURN((counts->writeCount == 2) &&
+                              (counts->readCount == 4));
+    }
+
+    WH_TEST_RETURN_ON_FAIL(wh_Nvm_DestroyObjects(nvm, 1, &meta.id));
+    if (counts != NULL) {
+        WH_TEST_ASSERT_RETURN((counts->writeCount == 3) &&
+                              (counts->readCount == 4) &&
+                              (counts->readers == 0) &&
+                              (counts->writers == 0));
+    }
+
+    return wh_Nvm_Cleanup(nvm);
+}
+
+int whTest_NvmLock(void)
+{
+    const whLockCb countingCb[1] = {{
+        .Init        = _countingLockInit,
+        .Cleanup     = _countingLockCleanup,
+        .ReadLock    = _countingLockRead,
+        .ReadUnlock  = _countingUnlockRead,
+        .WriteLock   = _countingLockWrite,
+        .WriteUnlock = _countingUnlockWrite,
+    }};
+    countingLockContext countingCtx[1] = {{0}};
+    whLockConfig countingCfg = {
+        .cb      = countingCb,
+        .context = countingCtx,
+    };
+#if defined(WH_CFG_TEST_POSIX)
+    const whLockCb   posixCb[1]  = {POSIX_LOCK_CB};
+    posixLockContext posixCtx[1] = {0};
+    whLockConfig posixCfg = {
+        .cb      = posixCb,
+        .context = posixCtx,
+    };
+#endif
+
+    /* No lock configured */
+    WH_TEST_RETURN_ON_FAIL(whTest_NvmLockCfg(NULL, NULL));
+
+    WH_TEST_RETURN_ON_FAIL(whTest_NvmLockCfg(&countingCfg, countingCtx));
+
+#if defined(WH_CFG_TEST_POSIX)
+    WH_TEST_RETURN_ON_FAIL(whTest_NvmLockCfg(&posixCfg, NULL));
+#endif
+    return 0;
+}
+
+
+int whTest_NvmLazyMount(void)
+{
+    /* NVM flash on a RAM-based flash simulator */
+    const whFlashCb  myFlashCb[1]     = {WH_FLASH_RAMSIM_CB};
+    whFlashRamsimCtx myHalFlashCtx[1] = {0};
+    whFlashRamsimCfg myHalFlashCfg[1] = {{
+        .size       = 1024 * 1024, /* 1MB  Flash */
+        .sectorSize = 4096,        /* 4KB  Sector Size */
+        .pageSize   = 8,           /* 8B   Page Size */
+        .erasedByte = (uint8_t)0,
+    }};
+    whNvmCb           myNvmCb[1]  = {WH_NVM_FLASH_CB};
+    whNvmFlashContext myNvmCtx[1] = {0};
+    whNvmFlashConfig  myNvmFlashCfg = {
+        .cb      = myFlashCb,
+        .context = myHalFlashCtx,
+        .config  = myHalFlashCfg,
+    };
+    whNvmConfig myNvmCfg = {
+        .cb         = myNvmCb,
+        .context    = myNvmCtx,
+        .config     = &myNvmFlashCfg,
+        .lazy_mount = 1,
+    };
+    whNvmContext nvm[1] = {{0}};
+
+    const uint8_t junk[8] = {1, 2, 3, 4, 5, 6, 7, 8};
+    uint32_t      inactive = 0;
+    whNvmId       count    = 0;
+    whNvmId       id       = 0;
+
+    /* Nothing touches the backend until it is needed */
+    WH_TEST_RETURN_ON_FAIL(wh_Nvm_Init(nvm, &myNvmCfg));
+    WH_TEST_ASSERT_RETURN(!wh_Nvm_IsMounted(nvm));
+    WH_TEST_ASSERT_RETURN(0 == myNvmCtx->initialized);
+    WH_TEST_RETURN_ON_FAIL(wh_Nvm_Maintain(nvm));
+    WH_TEST_ASSERT_RETURN(!wh_Nvm_IsMounted(nvm));
+    WH_TEST_RETURN_ON_FAIL(wh_Nvm_Cleanup(nvm));
+
+    /* First use mounts */
+    WH_TEST_RETURN_ON_FAIL(wh_Nvm_Init(nvm, &myNvmCfg));
+    WH_TEST_RETURN_ON_FAIL(wh_Nvm_List(nvm, WOLFHSM_NVM_ACCESS_ANY,
+            WOLFHSM_NVM_FLAGS_ANY, 0, &count, &id));
+    WH_TEST_ASSERT_RETURN(wh_Nvm_IsMounted(nvm));
+    WH_TEST_ASSERT_RETURN(0 == count);
+
+    /* Leave the inactive partition dirty, as an interrupted compaction
+     * would, and let maintenance erase it */
+    inactive = myFlashCb->PartitionSize(myHalFlashCtx) *
+               (myNvmCtx->active == 0);
+    WH_TEST_RETURN_ON_FAIL(myFlashCb->Program(myHalFlashCtx, inactive,
+                sizeof(junk), junk));
+    WH_TEST_ASSERT_RETURN(0 != myFlashCb->BlankCheck(myHalFlashCtx,
+                inactive, myFlashCb->PartitionSize(myHalFlashCtx)));
+    WH_TEST_RETURN_ON_FAIL(wh_Nvm_Maintain(nvm));
+    WH_TEST_RETURN_ON_FAIL(myFlashCb->BlankCheck(myHalFlashCtx, inactive,
+                myFlashCb->PartitionSize(myHalFlashCtx)));
+    WH_TEST_ASSERT_RETURN(0 != myNvmCtx->inactive_blank);
+
+    /* Compaction then skips straight to writing the inactive partition */
+    WH_TEST_RETURN_ON_FAIL(wh_Nvm_DestroyObjects(nvm, 0, NULL));
+    WH_TEST_ASSERT_RETURN(0 != myNvmCtx->inactive_blank);
+    WH_TEST_RETURN_ON_FAIL(wh_Nvm_Maintain(nvm));
+    WH_TEST_RETURN_ON_FAIL(wh_Nvm_Cleanup(nvm));
+
+    /* Without lazy_mount the backend is ready after init */
+    myNvmCfg.lazy_mount = 0;
+    WH_TEST_RETURN_ON_FAIL(wh_Nvm_Init(nvm, &myNvmCfg));
+    WH_TEST_ASSERT_RETURN(wh_Nvm_IsMounted(nvm));
+    WH_TEST_RETURN_ON_FAIL(wh_Nvm_Cleanup(nvm));
+
+    return 0;
+}
+
+/* Add six objects for each of two users, with alternating access values */
+static int _addFilterObjects(whNvmContext* nvm)
+{
+    const uint8_t data[8] = {1, 2, 3, 4, 5, 6, 7, 8};
+    whNvmMetadata meta    = {0};
+    int           user    = 0;
+    int           i       = 0;
+
+    for (user = 1; user <= 2; user++) {
+        for (i = 1; i <= 6; i++) {
+            meta.id     = MAKE_WOLFHSM_KEYID(WOLFHSM_KEYTYPE_CRYPTO, user, i);
+            meta.access = (whNvmAccess)(i & 1);
+            meta.len    = sizeof(data);
+            WH_TEST_RETURN_ON_FAIL(wh_Nvm_AddObject(nvm, &meta,
+                        sizeof(data), data));
+        }
+    }
+    return 0;
+}
+
+static int _testDestroyMatching(whNvmContext* nvm,
+        whNvmFlashContext* flashCtx, int single)
+{
+    whNvmFilter filter = {0};
+    whNvmId     count  = 0;
+    whNvmId     id     = 0;
+    uint32_t    epoch  = 0;
+    uint32_t    gen    = 0;
+
+    gen = wh_Nvm_GetGeneration(nvm);
+    WH_TEST_RETURN_ON_FAIL(_addFilterObjects(nvm));
+    WH_TEST_ASSERT_RETURN(gen != wh_Nvm_GetGeneration(nvm));
+
+    /* All objects of user 1, in one compaction */
+    filter.id_first = 1;
+    filter.id_last  = 0xFFFF;
+    filter.id_mask  = WOLFHSM_KEYTYPE_MASK | WOLFHSM_KEYUSER_MASK;
+    filter.id_match = MAKE_WOLFHSM_KEYID(WOLFHSM_KEYTYPE_CRYPTO, 1, 0);
+    epoch           = flashCtx->state.epoch;
+    gen             = wh_Nvm_GetGeneration(nvm);
+    WH_TEST_RETURN_ON_FAIL(wh_Nvm_DestroyMatching(nvm, &filter, &count));
+    WH_TEST_ASSERT_RETURN(6 == count);
+    WH_TEST_ASSERT_RETURN(gen != wh_Nvm_GetGeneration(nvm));
+    if (single) {
+        WH_TEST_ASSERT_RETURN(epoch + 1 == flashCtx->state.epoch);
+    }
+    WH_TEST_ASSERT_RETURN(WH_ERROR_NOTFOUND ==
+            wh_Nvm_GetMetadata(nvm,
+                MAKE_WOLFHSM_KEYID(WOLFHSM_KEYTYPE_CRYPTO, 1, 3), NULL));
+    /* Reads leave the generation alone */
+    gen = wh_Nvm_GetGeneration(nvm);
+    WH_TEST_RETURN_ON_FAIL(wh_Nvm_List(nvm, WOLFHSM_NVM_ACCESS_ANY,
+                WOLFHSM_NVM_FLAGS_ANY, 0, &count, &id));
+    WH_TEST_ASSERT_RETURN(6 == count);
+    WH_TEST_ASSERT_RETURN(gen == wh_Nvm_GetGeneration(nvm));
+
+    /* Nothing matches, so nothing is rewritten */
+    epoch = flashCtx->state.epoch;
+    WH_TEST_RETURN_ON_FAIL(wh_Nvm_DestroyMatching(nvm, &filter, &count));
+    WH_TEST_ASSERT_RETURN(0 == count);
+    WH_TEST_ASSERT_RETURN(epoch == flashCtx->state.epoch);
+
+    /* Odd access values within an id range of user 2 */
+    memset(&filter, 0, sizeof(filter));
+    filter.id_first     = MAKE_WOLFHSM_KEYID(WOLFHSM_KEYTYPE_CRYPTO, 2, 1);
+    filter.id_last      = MAKE_WOLFHSM_KEYID(WOLFHSM_KEYTYPE_CRYPTO, 2, 4);
+    filter.access_mask  = 1;
+    filter.access_match = 1;
+    WH_TEST_RETURN_ON_FAIL(wh_Nvm_DestroyMatching(nvm, &filter, &count));
+    WH_TEST_ASSERT_RETURN(2 == count);
+    WH_TEST_RETURN_ON_FAIL(wh_Nvm_GetMetadata(nvm,
+                MAKE_WOLFHSM_KEYID(WOLFHSM_KEYTYPE_CRYPTO, 2, 2), NULL));
+    WH_TEST_RETURN_ON_FAIL(wh_Nvm_GetMetadata(nvm,
+                MAKE_WOLFHSM_KEYID(WOLFHSM_KEYTYPE_CRYPTO, 2, 5), NULL));
+
+    /* Everything else */
+    memset(&filter, 0, sizeof(filter));
+    filter.id_first = 1;
+    filter.id_last  = 0xFFFF;
+    WH_TEST_RETURN_ON_FAIL(wh_Nvm_DestroyMatching(nvm, &filter, &count));
+    WH_TEST_ASSERT_RETURN(4 == count);
+    WH_TEST_RETURN_ON_FAIL(wh_Nvm_List(nvm, WOLFHSM_NVM_ACCESS_ANY,
+                WOLFHSM_NVM_FLAGS_ANY, 0, &count, &id));
+    WH_TEST_ASSERT_RETURN(0 == count);
+
+    WH_TEST_ASSERT_RETURN(WH_ERROR_BADARGS ==
+            wh_Nvm_DestroyMatching(nvm, NULL, &count));
+    return 0;
+}
+
+int whTest_NvmDestroyMatching(void)
+{
+    /* NVM flash on a RAM-based flash simulator */
+    const whFlashCb  myFlashCb[1]     = {WH_FLASH_RAMSIM_CB};
+    whFlashRamsimCtx myHalFlashCtx[1] = {0};
+    whFlashRamsimCfg myHalFlashCfg[1] = {{
+        .size       = 1024 * 1024, /* 1MB  Flash */
+        .sectorSize = 4096,        /* 4KB  Sector Size */
+        .pageSize   = 8,           /* 8B   Page Size */
+        .erasedByte = (uint8_t)0,
+    }};
+    whNvmCb           myNvmCb[1]  = {WH_NVM_FLASH_CB};
+    whNvmFlashContext myNvmCtx[1] = {0};
+    whNvmFlashConfig  myNvmFlashCfg = {
+        .cb      = myFlashCb,
+        .context = myHalFlashCtx,
+        .config  = myHalFlashCfg,
+    };
+    whNvmConfig myNvmCfg = {
+        .cb      = myNvmCb,
+        .context = myNvmCtx,
+        .config  = &myNvmFlashCfg,
+    };
+    whNvmContext nvm[1] = {{0}};
+
+    WH_TEST_RETURN_ON_FAIL(wh_Nvm_Init(nvm, &myNvmCfg));
+    WH_TEST_RETURN_ON_FAIL(_testDestroyMatching(nvm, myNvmCtx, 1));
+    WH_TEST_RETURN_ON_FAIL(wh_Nvm_Cleanup(nvm));
+
+    /* Backends without the callback get the batched fallback */
+    myNvmCb->DestroyMatching = NULL;
+    WH_TEST_RETURN_ON_FAIL(wh_Nvm_Init(nvm, &myNvmCfg));
+    WH_TEST_RETURN_ON_FAIL(_testDestroyMatching(nvm, myNvmCtx, 0));
+    WH_TEST_RETURN_ON_FAIL(wh_Nvm_Cleanup(nvm));
+
+    return 0;
+}
+
+/* Flash programs left before the simulated power loss, or -1 for none */
+static int _programsLeft = -1;
+
+static int _failingProgram(void* context, uint32_t offset, uint32_t size,
+        const uint8_t* data)
+{
+    if (_programsLeft == 0) {
+        return WH_ERROR_ABORTED;
+    }
+    if (_programsLeft > 0) {
+        _programsLeft--;
+    }
+    return whFlashRamsim_Program(context, offset, size, data);
+}
+
+/* Either both objects of the batch are present, with id 1 replaced, or the
+ * state from before it */
+static int _checkBatchState(whNvmContext* nvm, int* out_applied)
+{
+    uint8_t buf[4] = {0};
+    int     rc     = 0;
+
+    WH_TEST_RETURN_ON_FAIL(wh_Nvm_Read(nvm, 1, 0, sizeof(buf), buf));
+    rc = wh_Nvm_GetMetadata(nvm, 3, NULL);
+    if (memcmp(buf, "new", sizeof(buf)) == 0) {
+        WH_TEST_ASSERT_RETURN(rc == 0);
+        *out_applied = 1;
+    } else {
+        WH_TEST_ASSERT_RETURN(0 == memcmp(buf, "old", sizeof(buf)));
+        WH_TEST_ASSERT_RETURN(rc == WH_ERROR_NOTFOUND);
+        *out_applied = 0;
+    }
+    WH_TEST_RETURN_ON_FAIL(wh_Nvm_Read(nvm, 2, 0, sizeof(buf), buf));
+    WH_TEST_ASSERT_RETURN(0 == memcmp(buf, "two", sizeof(buf)));
+    return 0;
+}
+
+/* A batch interrupted at every possible flash program is seen after a reset
+ * either fully applied or not at all */
+int whTest_NvmAddObjectsAtomic(void)
+{
+    whFlashCb        myFlashCb[1]     = {WH_FLASH_RAMSIM_CB};
+    whFlashRamsimCtx myHalFlashCtx[1] = {0};
+    whFlashRamsimCfg myHalFlashCfg[1] = {{
+        .size       = 64 * 1024, /* 64KB Flash */
+        .sectorSize = 4096,      /* 4KB  Sector Size */
+        .pageSize   = 8,         /* 8B   Page Size */
+        .erasedByte = ~(uint8_t)0,
+    }};
+    whNvmCb           myNvmCb[1]  = {WH_NVM_FLASH_CB};
+    whNvmFlashContext myNvmCtx[1] = {0};
+    whNvmFlashConfig  myNvmFlashCfg = {
+        .cb      = myFlashCb,
+        .context = myHalFlashCtx,
+        .config  = myHalFlashCfg,
+    };
+    whNvmConfig myNvmCfg = {
+        .cb      = myNvmCb,
+        .context = myNvmCtx,
+        .config  = &myNvmFlashCfg,
+    };
+    whNvmContext   nvm[1]   = {{0}};
+    whNvmMetadata  meta     = {0};
+    whNvmMetadata  metas[2] = {{0}};
+    const uint8_t* datas[2] = {(const uint8_t*)"new",
+                               (const uint8_t*)"three"};
+    static uint8_t big[32 * 1024];
+    int            applied  = 0;
+    int            attempt  = 0;
+    int            rc       = 0;
+
+    myFlashCb->Init    = _keepInit;
+    myFlashCb->Cleanup = _keepCleanup;
+    myFlashCb->Program = _failingProgram;
+    WH_TEST_RETURN_ON_FAIL(wh_Nvm_Init(nvm, &myNvmCfg));
+    meta.id  = 1;
+    meta.len = 4;
+    WH_TEST_RETURN_ON_FAIL(wh_Nvm_AddObject(nvm, &meta, 4,
+            (const uint8_t*)"old"));
+    meta.id = 2;
+    WH_TEST_RETURN_ON_FAIL(wh_Nvm_AddObject(nvm, &meta, 4,
+            (const uint8_t*)"two"));
+
+    /* A batch that cannot fit is refused without changing anything */
+    metas[0].id  = 1;
+    metas[0].len = 4;
+    metas[1].id  = 3;
+    metas[1].len = sizeof(big);
+    datas[1]     = big;
+    WH_TEST_ASSERT_RETURN(WH_ERROR_NOSPACE ==
+            wh_Nvm_AddObjects(nvm, 2, metas, datas));
+    WH_TEST_RETURN_ON_FAIL(_checkBatchState(nvm, &applied));
+    WH_TEST_ASSERT_RETURN(applied == 0);
+
+    metas[1].len = 6;
+    datas[1]     = (const uint8_t*)"three";
+    for (attempt = 0; applied == 0; attempt++) {
+        WH_TEST_ASSERT_RETURN(attempt < 1000);
+        _programsLeft = attempt;
+        rc = wh_Nvm_AddObjects(nvm, 2, metas, datas);
+        _programsLeft = -1;
+        WH_TEST_RETURN_ON_FAIL(_checkBatchState(nvm, &applied));
+        WH_TEST_ASSERT_RETURN((rc == 0) ? (applied == 1) : 1);
+
+        /* Same state after recovering from flash */
+        WH_TEST_RETURN_ON_FAIL(wh_Nvm_Cleanup(nvm));
+        WH_TEST_RETURN_ON_FAIL(wh_Nvm_Init(nvm, &myNvmCfg));
+        rc = applied;
+        WH_TEST_RETURN_ON_FAIL(_checkBatchState(nvm, &applied));
+        WH_TEST_ASSERT_RETURN(rc == applied);
+    }
+    WH_TEST_ASSERT_RETURN(attempt > 1);
+
+    WH_TEST_RETURN_ON_FAIL(wh_Nvm_Cleanup(nvm));
+    return whFlashRamsim_Cleanup(myHalFlashCtx);
+}
+
+/* An append interrupted at every flash program, including a record header
+ * programmed without its commit, leaves the log as it was after a reset.  The
+ * interrupted record keeps its space and later records follow it */
+int whTest_NvmLogInterrupted(void)
+{
+    whFlashCb        myFlashCb[1]     = {WH_FLASH_RAMSIM_CB};
+    whFlashRamsimCtx myHalFlashCtx[1] = {0};
+    whFlashRamsimCfg myHalFlashCfg[1] = {{
+        .size       = 64 * 1024, /* 64KB Flash */
+        .sectorSize = 4096,      /* 4KB  Sector Size */
+        .pageSize   = 8,         /* 8B   Page Size */
+        .erasedByte = ~(uint8_t)0,
+    }};
+    whNvmCb           myNvmCb[1]  = {WH_NVM_FLASH_CB};
+    whNvmFlashContext myNvmCtx[1] = {0};
+    whNvmFlashConfig  myNvmFlashCfg = {
+        .cb      = myFlashCb,
+        .context = myHalFlashCtx,
+        .config  = myHalFlashCfg,
+    };
+    whNvmConfig myNvmCfg = {
+        .cb      = myNvmCb,
+        .context = myNvmCtx,
+        .config  = &myNvmFlashCfg,
+    };
+    whNvmContext  nvm[1] = {{0}};
+    whNvmMetadata meta   = {.id = 7};
+    uint8_t       buf[16] = {0};
+    int           attempt = 0;
+    int           rc      = 0;
+
+    myFlashCb->Init    = _keepInit;
+    myFlashCb->Cleanup = _keepCleanup;
+    myFlashCb->Program = _failingProgram;
+    WH_TEST_RETURN_ON_FAIL(wh_Nvm_Init(nvm, &myNvmCfg));
+    WH_TEST_RETURN_ON_FAIL(wh_Nvm_CreateLog(nvm, &meta, 4,
+            (const uint8_t*)"one"));
+
+    /* The first attempt fails before the header, later ones after it */
+    do {
+        WH_TEST_ASSERT_RETURN(attempt < 100);
+        _programsLeft = attempt++;
+        rc = wh_Nvm_Append(nvm, meta.id, 4, (const uint8_t*)"two");
+        _programsLeft = -1;
+
+        WH_TEST_RETURN_ON_FAIL(wh_Nvm_Cleanup(nvm));
+        WH_TEST_RETURN_ON_FAIL(wh_Nvm_Init(nvm, &myNvmCfg));
+        WH_TEST_RETURN_ON_FAIL(wh_Nvm_GetMetadata(nvm, meta.id, &meta));
+        WH_TEST_ASSERT_RETURN(meta.len == ((rc == 0) ? 8 : 4));
+    } while (rc != 0);
+    WH_TEST_ASSERT_RETURN(attempt > 2);
+
+    /* Records after the interrupted ones are appended and read back */
+    WH_TEST_RETURN_ON_FAIL(wh_Nvm_Append(nvm, meta.id, 6,
+            (const uint8_t*)"three"));
+    WH_TEST_RETURN_ON_FAIL(wh_Nvm_GetMetadata(nvm, meta.id, &meta));
+    WH_TEST_ASSERT_RETURN(meta.len == 14);
+    WH_TEST_RETURN_ON_FAIL(wh_Nvm_Read(nvm, meta.id, 0, meta.len, buf));
+    WH_TEST_ASSERT_RETURN(0 == memcmp(buf, "one\0two\0three", 14));
+
+    WH_TEST_RETURN_ON_FAIL(wh_Nvm_Cleanup(nvm));
+    return whFlashRamsim_Cleanup(myHalFlashCtx);
+}
+
 #if defined(WH_CFG_TEST_POSIX)
 
 int whTest_NvmFlash_PosixFileSim(void)
@@ -375,6 +1265,113 @@ int whTest_NvmFlash_PosixFileSim(void)
 
     /* Remove the configured file on success*/
     unlink(myHalFlashConfig[0].filename);
+
+    /* Repeat with per-sector erase tracking persisted in a sidecar */
+    myHalFlashConfig[0].sector_size  = 4096;
+    myHalFlashConfig[0].map_filename = "myNvm.map";
+    WH_TEST_ASSERT(0 == whTest_NvmFlashCfg(&myNvmCfg));
+
+    unlink(myHalFlashConfig[0].filename);
+    unlink(myHalFlashConfig[0].map_filename);
+    return 0;
+}
+
+int whTest_PosixFlashFile_ErasedMap(void)
+{
+    posixFlashFileContext ctx[1] = {0};
+    posixFlashFileConfig  cfg[1] = {{
+          .filename       = "myFlash.bin",
+          .map_filename   = "myFlash.map",
+          .partition_size = 16384,
+          .sector_size    = 4096,
+          .erased_byte    = (~(uint8_t)0),
+    }};
+    const uint32_t sector = 4096;
+    uint8_t data[8] = {1, 2, 3, 4, 5, 6, 7, 8};
+    uint8_t buf[sizeof(data)];
+    uint8_t erased[sizeof(data)];
+
+    memset(erased, cfg->erased_byte, sizeof(erased));
+    unlink(cfg->filename);
+    unlink(cfg->map_filename);
+
+    printf("--New file is erased without being written\n");
+    WH_TEST_RETURN_ON_FAIL(posixFlashFile_Init(ctx, cfg));
+    WH_TEST_ASSERT_RETURN(ctx->sector_count == 8);
+    WH_TEST_ASSERT_RETURN(ctx->erased_map[0] == 0xFF);
+    WH_TEST_RETURN_ON_FAIL(posixFlashFile_BlankCheck(ctx, 0,
+            2 * cfg->partition_size));
+    WH_TEST_RETURN_ON_FAIL(posixFlashFile_Read(ctx, sector, sizeof(buf), buf));
+    WH_TEST_ASSERT_RETURN(0 == memcmp(buf, erased, sizeof(buf)));
+
+    printf("--Program writes back the erased sector\n");
+    WH_TEST_RETURN_ON_FAIL(posixFlashFile_WriteUnlock(ctx, 0, 0));
+    WH_TEST_RETURN_ON_FAIL(posixFlashFile_Program(ctx, sector + 8,
+            sizeof(data), data));
+    WH_TEST_ASSERT_RETURN(ctx->erased_map[0] == 0xFD);
+    WH_TEST_RETURN_ON_FAIL(posixFlashFile_Verify(ctx, sector + 8,
+            sizeof(data), data));
+    WH_TEST_RETURN_ON_FAIL(posixFlashFile_BlankCheck(ctx, sector, 8));
+    WH_TEST_ASSERT_RETURN(WH_ERROR_NOTBLANK ==
+            posixFlashFile_BlankCheck(ctx, sector, sector));
+    WH_TEST_RETURN_ON_FAIL(posixFlashFile_BlankCheck(ctx, 0, sector));
+
+    printf("--Whole sector erase is deferred, partial erase is not\n");
+    WH_TEST_RETURN_ON_FAIL(posixFlashFile_Erase(ctx, sector + 8,
+            sizeof(data)));
+    WH_TEST_ASSERT_RETURN(ctx->erased_map[0] == 0xFD);
+    WH_TEST_RETURN_ON_FAIL(posixFlashFile_BlankCheck(ctx, sector, sector));
+    WH_TEST_RETURN_ON_FAIL(posixFlashFile_Program(ctx, sector + 8,
+            sizeof(data), data));
+    WH_TEST_RETURN_ON_FAIL(posixFlashFile_Erase(ctx, sector, sector));
+    WH_TEST_ASSERT_RETURN(ctx->erased_map[0] == 0xFF);
+    WH_TEST_RETURN_ON_FAIL(posixFlashFile_Read(ctx, sector + 8, sizeof(buf),
+            buf));
+    WH_TEST_ASSERT_RETURN(0 == memcmp(buf, erased, sizeof(buf)));
+
+    printf("--Erased state persists in the sidecar\n");
+    WH_TEST_RETURN_ON_FAIL(posixFlashFile_Program(ctx, sector + 8,
+            sizeof(data), data));
+    WH_TEST_RETURN_ON_FAIL(posixFlashFile_Cleanup(ctx));
+    WH_TEST_RETURN_ON_FAIL(posixFlashFile_Init(ctx, cfg));
+    WH_TEST_ASSERT_RETURN(ctx->erased_map[0] == 0xFD);
+    WH_TEST_RETURN_ON_FAIL(posixFlashFile_Verify(ctx, sector + 8,
+            sizeof(data), data));
+    WH_TEST_RETURN_ON_FAIL(posixFlashFile_Cleanup(ctx));
+    unlink(cfg->filename);
+    unlink(cfg->map_filename);
+
+    printf("--Without a sidecar, init and erase write through\n");
+    cfg->map_filename = NULL;
+    WH_TEST_RETURN_ON_FAIL(posixFlashFile_Init(ctx, cfg));
+    WH_TEST_ASSERT_RETURN(ctx->erased_map[0] == 0xFF);
+    WH_TEST_ASSERT_RETURN(sizeof(buf) == pread(ctx->fd_p1 - 1, buf,
+            sizeof(buf), 2 * cfg->partition_size - sizeof(buf)));
+    WH_TEST_ASSERT_RETURN(0 == memcmp(buf, erased, sizeof(buf)));
+    WH_TEST_RETURN_ON_FAIL(posixFlashFile_WriteUnlock(ctx, 0, 0));
+    WH_TEST_RETURN_ON_FAIL(posixFlashFile_Program(ctx, sector + 8,
+            sizeof(data), data));
+    WH_TEST_ASSERT_RETURN(ctx->erased_map[0] == 0xFD);
+    WH_TEST_RETURN_ON_FAIL(posixFlashFile_Erase(ctx, sector, sector));
+    WH_TEST_ASSERT_RETURN(ctx->erased_map[0] == 0xFF);
+    WH_TEST_ASSERT_RETURN(sizeof(buf) == pread(ctx->fd_p1 - 1, buf,
+            sizeof(buf), sector + 8));
+    WH_TEST_ASSERT_RETURN(0 == memcmp(buf, erased, sizeof(buf)));
+    WH_TEST_RETURN_ON_FAIL(posixFlashFile_Cleanup(ctx));
+    WH_TEST_RETURN_ON_FAIL(posixFlashFile_Init(ctx, cfg));
+    WH_TEST_ASSERT_RETURN(ctx->erased_map[0] == 0);
+    WH_TEST_RETURN_ON_FAIL(posixFlashFile_BlankCheck(ctx, 0,
+            2 * cfg->partition_size));
+    WH_TEST_RETURN_ON_FAIL(posixFlashFile_Cleanup(ctx));
+    unlink(cfg->filename);
+
+    printf("--Failing to open the sidecar closes the file\n");
+    cfg->map_filename = "missing/myFlash.map";
+    WH_TEST_ASSERT_RETURN(WH_ERROR_ABORTED == posixFlashFile_Init(ctx, cfg));
+    WH_TEST_ASSERT_RETURN(ctx->fd_p1 == 0);
+    unlink(cfg->filename);
+
+    printf("--Done\n");
     return 0;
 }
 
@@ -386,7 +1383,28 @@ int whTest_NvmFlash(void)
     printf("Testing NVM flash with RAM sim...\n");
     WH_TEST_ASSERT(0 == whTest_NvmFlash_RamSim());
 
+    printf("Testing NVM tier with RAM and RAM sim...\n");
+    WH_TEST_ASSERT(0 == whTest_NvmTier_RamSim());
+
+    printf("Testing NVM locking...\n");
+    WH_TEST_ASSERT(0 == whTest_NvmLock());
+
+    printf("Testing NVM lazy mount and maintenance...\n");
+    WH_TEST_ASSERT(0 == whTest_NvmLazyMount());
+
+    printf("Testing NVM destroy by filter...\n");
+    WH_TEST_ASSERT(0 == whTest_NvmDestroyMatching());
+
+    printf("Testing NVM batch add atomicity...\n");
+    WH_TEST_ASSERT(0 == whTest_NvmAddObjectsAtomic());
+
+    printf("Testing NVM append-log interrupted records...\n");
+    WH_TEST_ASSERT(0 == whTest_NvmLogInterrupted());
+
 #if defined(WH_CFG_TEST_POSIX)
+    printf("Testing POSIX file sim erased sector map...\n");
+    WH_TEST_ASSERT(0 == whTest_PosixFlashFile_ErasedMap());
+
     printf("Testing NVM flash with POSIX file sim...\n");
     WH_TEST_ASSERT(0 == whTest_NvmFlash_PosixFileSim());
 #endif
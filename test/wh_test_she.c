@@ -113,6 +113,14 @@ int whTest_SheClientConfig(whClientConfig* config)
     uint8_t messageThree[WOLFHSM_SHE_M3_SZ];
     uint8_t messageFour[WOLFHSM_SHE_M4_SZ];
     uint8_t messageFive[WOLFHSM_SHE_M5_SZ];
+    uint8_t batchOne[2 * WOLFHSM_SHE_M1_SZ];
+    uint8_t batchTwo[2 * WOLFHSM_SHE_M2_SZ];
+    uint8_t batchThree[2 * WOLFHSM_SHE_M3_SZ];
+    uint8_t batchFour[2 * WOLFHSM_SHE_M4_SZ];
+    uint8_t batchFive[2 * WOLFHSM_SHE_M5_SZ];
+    uint8_t outBatchFour[2 * WOLFHSM_SHE_M4_SZ];
+    uint8_t outBatchFive[2 * WOLFHSM_SHE_M5_SZ];
+    uint32_t i;
 
     if (config == NULL) {
         return WH_ERROR_BADARGS;
@@ -233,6 +241,42 @@ int whTest_SheClientConfig(whClientConfig* config)
         goto exit;
     }
     printf("SHE LOAD KEY SUCCESS\n");
+    /* load two keys under the master ecu key in one batch */
+    for (i = 0; i < 2; i++) {
+        if ((ret = wh_SheGenerateLoadableKey(5 + i, WOLFHSM_SHE_MASTER_ECU_KEY_ID, 1, 0, sheUid, vectorRawKey, vectorMasterEcuKey, batchOne + i * WOLFHSM_SHE_M1_SZ, batchTwo + i * WOLFHSM_SHE_M2_SZ, batchThree + i * WOLFHSM_SHE_M3_SZ, batchFour + i * WOLFHSM_SHE_M4_SZ, batchFive + i * WOLFHSM_SHE_M5_SZ)) != 0) {
+            WH_ERROR_PRINT("Failed to wh_SheGenerateLoadableKey %d\n", ret);
+            goto exit;
+        }
+    }
+    if ((ret = wh_Client_SheLoadKeyBatch(client, 2, batchOne, batchTwo, batchThree, outBatchFour, outBatchFive)) != 0) {
+        WH_ERROR_PRINT("Failed to wh_Client_SheLoadKeyBatch %d\n", ret);
+        goto exit;
+    }
+    if (memcmp(outBatchFour, batchFour, sizeof(batchFour)) != 0 ||
+        memcmp(outBatchFive, batchFive, sizeof(batchFive)) != 0) {
+        WH_ERROR_PRINT("wh_Client_SheLoadKeyBatch FAILED TO MATCH\n");
+        goto exit;
+    }
+    /* a replayed set rejects the whole batch, so key 7 is not loaded */
+    if ((ret = wh_SheGenerateLoadableKey(7, WOLFHSM_SHE_MASTER_ECU_KEY_ID, 1, 0, sheUid, vectorRawKey, vectorMasterEcuKey, batchOne, batchTwo, batchThree, batchFour, batchFive)) != 0) {
+        WH_ERROR_PRINT("Failed to wh_SheGenerateLoadableKey %d\n", ret);
+        goto exit;
+    }
+    if ((ret = wh_Client_SheLoadKeyBatch(client, 2, batchOne, batchTwo, batchThree, outBatchFour, outBatchFive)) != WH_SHE_ERC_KEY_UPDATE_ERROR) {
+        WH_ERROR_PRINT("wh_Client_SheLoadKeyBatch accepted a replay %d\n", ret);
+        ret = WH_ERROR_ABORTED;
+        goto exit;
+    }
+    if ((ret = wh_Client_SheLoadKey(client, batchOne, batchTwo, batchThree, outMessageFour, outMessageFive)) != 0) {
+        WH_ERROR_PRINT("Failed to wh_Client_SheLoadKey %d\n", ret);
+        goto exit;
+    }
+    if (memcmp(outMessageFour, batchFour, WOLFHSM_SHE_M4_SZ) != 0 ||
+        memcmp(outMessageFive, batchFive, WOLFHSM_SHE_M5_SZ) != 0) {
+        WH_ERROR_PRINT("wh_Client_SheLoadKey FAILED TO MATCH\n");
+        goto exit;
+    }
+    printf("SHE LOAD KEY BATCH SUCCESS\n");
     if ((ret = wh_Client_SheInitRnd(client)) != 0) {
         WH_ERROR_PRINT("Failed to wh_Client_SheInitRnd %d\n", ret);
         goto exit;
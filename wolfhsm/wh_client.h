@@ -45,6 +45,7 @@
 /* Component includes */
 #include "wolfhsm/wh_comm.h"
 #include "wolfhsm/wh_message_customcb.h"
+#include "wolfhsm/wh_client_latency.h"
 
 #ifndef WOLFHSM_NO_CRYPTO
 #include "wolfssl/wolfcrypt/settings.h"
@@ -59,6 +60,12 @@
 /* Client context */
 struct whClientContext_t {
     whCommClient comm[1];
+    whClientLatency*      latency;
+    whCommTimeCb          timeCb;
+    void*                 timeContext;
+    uint64_t              sendStart;
+    uint64_t              sendDone;
+    whClientLatencySample lastLatency;
     uint16_t     last_req_id;
     uint16_t     last_req_kind;
     uint8_t      pad[4];
@@ -67,6 +74,11 @@ typedef struct whClientContext_t whClientContext;
 
 struct whClientConfig_t {
     whCommClientConfig* comm;
+    /* Optional latency histograms, recorded only with a time source.  The
+     * server is asked to report its share of each request */
+    whClientLatency*    latency;
+    whCommTimeCb        timeCb;     /* Microseconds, same as the server */
+    void*               timeContext;
 };
 typedef struct whClientConfig_t whClientConfig;
 
@@ -129,6 +141,17 @@ int wh_Client_RecvResponse(whClientContext* c, uint16_t* out_group,
                            uint16_t* out_action, uint16_t* out_size,
                            void* data);
 
+/**
+ * Gets the latency breakdown of the last completed request.
+ *
+ * @param c The client context.
+ * @param out_sample Pointer to store the per-phase times in microseconds.
+ * @return 0 if successful, WH_ERROR_NOTFOUND if latency recording is not
+ * configured, or a negative value if an error occurred.
+ */
+int wh_Client_GetLatency(whClientContext* c,
+                         whClientLatencySample* out_sample);
+
 
 /** Comm component functions */
 
@@ -970,6 +993,61 @@ int wh_Client_NvmDestroyObjects(whClientContext* c, whNvmId list_count,
                                 const whNvmId* id_list, whNvmSize len,
                                 const uint8_t* data, int32_t* out_rc);
 
+/**
+ * @brief Sends a request to the server to destroy every non-volatile memory
+ * (NVM) object matching a filter.
+ *
+ * This function prepares and sends a request to the server to destroy all NVM
+ * objects selected by the id range, id mask, access and flags of the filter.
+ * The server removes them with a single partition compaction, so this is the
+ * preferred way to delete many objects, such as all keys of one client. This
+ * function does not block; it returns immediately after sending the request.
+ *
+ * @param[in] c Pointer to the client context.
+ * @param[in] filter Pointer to the filter selecting the objects to destroy.
+ * @return int Returns 0 on success, or a negative error code on failure.
+ */
+int wh_Client_NvmDestroyMatchingRequest(whClientContext*    c,
+                                        const whNvmFilter* filter);
+
+/**
+ * @brief Receives a response from the server after attempting to destroy the
+ * non-volatile memory (NVM) objects matching a filter.
+ *
+ * This function attempts to process a response message from the server after
+ * attempting to destroy matching NVM objects. It validates the response and
+ * extracts the return code and the number of objects destroyed. This function
+ * does not block; it returns WH_ERROR_NOTREADY if a response has not been
+ * received.
+ *
+ * @param[in] c Pointer to the client context.
+ * @param[out] out_rc Pointer to store the return code from the server.
+ * @param[out] out_count Pointer to store the number of objects destroyed.
+ * @return int Returns 0 on success, WH_ERROR_NOTREADY if no response is
+ * available, or a negative error code on failure.
+ */
+int wh_Client_NvmDestroyMatchingResponse(whClientContext* c, int32_t* out_rc,
+                                         whNvmId* out_count);
+
+/**
+ * @brief Sends a request to the server and receives a response to destroy the
+ * non-volatile memory (NVM) objects matching a filter.
+ *
+ * This function handles the complete process of sending a request to the server
+ * to destroy matching NVM objects and receiving the response. It sends the
+ * request and repeatedly attempts to receive a valid response. This function
+ * blocks until the entire operation is complete or an error occurs.
+ *
+ * @param[in] c Pointer to the client context.
+ * @param[in] filter Pointer to the filter selecting the objects to destroy.
+ * @param[out] out_rc Pointer to store the return code from the server.
+ * @param[out] out_count Pointer to store the number of objects destroyed.
+ * @return int Returns 0 on success, or a negative error code on failure.
+ */
+int wh_Client_NvmDestroyMatching(whClientContext*    c,
+                                 const whNvmFilter* filter, int32_t* out_rc,
+                                 whNvmId* out_count);
+
 /**
  * @brief Sends a request to the server to read data from a non-volatile memory
  * (NVM) object.
@@ -1386,6 +1464,98 @@ int wh_Client_NvmReadDmaResponse(whClientContext* c, int32_t* out_rc);
 int wh_Client_NvmReadDma(whClientContext* c, whNvmId id, whNvmSize offset,
                          whNvmSize data_len, uint8_t* data, int32_t* out_rc);
 
+/**
+ * @brief Sends a request to the server to add an object to non-volatile memory
+ * (NVM) from buffers in the transport's shared bulk data region.
+ *
+ * The metadata and data must have been placed in buffers allocated from the
+ * bulk region, such as with wh_TransportMem_BulkAlloc. The server reads them
+ * in place. This function does not block; it returns immediately after
+ * sending the request.
+ *
+ * @param[in] c Pointer to the client context.
+ * @param[in] metadata_offset Bulk region offset of the metadata.
+ * @param[in] data_len The length of the data to be added.
+ * @param[in] data_offset Bulk region offset of the data to be added.
+ * @return int Returns 0 on success, or a negative error code on failure.
+ */
+int wh_Client_NvmAddObjectBulkRequest(whClientContext* c,
+                                      uint32_t         metadata_offset,
+                                      whNvmSize        data_len,
+                                      uint32_t         data_offset);
+
+/**
+ * @brief Receives a response from the server after attempting to add an object
+ * to non-volatile memory (NVM) from the shared bulk data region.
+ *
+ * @param[in] c Pointer to the client context.
+ * @param[out] out_rc Pointer to store the return code from the server.
+ *             WH_ERROR_NOHANDLER indicates the transport has no bulk region.
+ * @return int Returns 0 on success, WH_ERROR_NOTREADY if no response is
+ * available, or a negative error code on failure.
+ */
+int wh_Client_NvmAddObjectBulkResponse(whClientContext* c, int32_t* out_rc);
+
+/**
+ * @brief Sends a request and blocks for the response to add an object to
+ * non-volatile memory (NVM) from the shared bulk data region.
+ *
+ * @param[in] c Pointer to the client context.
+ * @param[in] metadata_offset Bulk region offset of the metadata.
+ * @param[in] data_len The length of the data to be added.
+ * @param[in] data_offset Bulk region offset of the data to be added.
+ * @param[out] out_rc Pointer to store the return code from the server.
+ * @return int Returns 0 on success, or a negative error code on failure.
+ */
+int wh_Client_NvmAddObjectBulk(whClientContext* c, uint32_t metadata_offset,
+                               whNvmSize data_len, uint32_t data_offset,
+                               int32_t* out_rc);
+
+/**
+ * @brief Sends a request to the server to read data from non-volatile memory
+ * (NVM) into a buffer in the transport's shared bulk data region.
+ *
+ * The server writes the data in place. This function does not block; it
+ * returns immediately after sending the request.
+ *
+ * @param[in] c Pointer to the client context.
+ * @param[in] id The NVM ID of the object to read.
+ * @param[in] offset The offset within the object to start reading from.
+ * @param[in] data_len The length of the data to be read.
+ * @param[in] data_offset Bulk region offset the data will be read into.
+ * @return int Returns 0 on success, or a negative error code on failure.
+ */
+int wh_Client_NvmReadBulkRequest(whClientContext* c, whNvmId id,
+                                 whNvmSize offset, whNvmSize data_len,
+                                 uint32_t data_offset);
+
+/**
+ * @brief Receives a response from the server after attempting to read data from
+ * non-volatile memory (NVM) into the shared bulk data region.
+ *
+ * @param[in] c Pointer to the client context.
+ * @param[out] out_rc Pointer to store the return code from the server.
+ * @return int Returns 0 on success, WH_ERROR_NOTREADY if no response is
+ * available, or a negative error code on failure.
+ */
+int wh_Client_NvmReadBulkResponse(whClientContext* c, int32_t* out_rc);
+
+/**
+ * @brief Sends a request and blocks for the response to read data from
+ * non-volatile memory (NVM) into the shared bulk data region.
+ *
+ * @param[in] c Pointer to the client context.
+ * @param[in] id The NVM ID of the object to read.
+ * @param[in] offset The offset within the object to start reading from.
+ * @param[in] data_len The length of the data to be read.
+ * @param[in] data_offset Bulk region offset the data will be read into.
+ * @param[out] out_rc Pointer to store the return code from the server.
+ * @return int Returns 0 on success, or a negative error code on failure.
+ */
+int wh_Client_NvmReadBulk(whClientContext* c, whNvmId id, whNvmSize offset,
+                          whNvmSize data_len, uint32_t data_offset,
+                          int32_t* out_rc);
+
 /* Client custom-callback support */
 
 /**
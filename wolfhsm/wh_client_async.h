@@ -0,0 +1,133 @@
+/*
+ * Copyright (C) 2024 wolfSSL Inc.
+ *
+ * This file is part of wolfHSM.
+ *
+ * wolfHSM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfHSM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wolfHSM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * wolfhsm/wh_client_async.h
+ *
+ * Single-threaded driver for many concurrent client operations.
+ *
+ * Every client API is split into a *Request and a *Response half, and the
+ * blocking wrappers spin on WH_ERROR_NOTREADY.  A task instead yields back to
+ * the loop whenever a half is not ready, so one thread can keep many client
+ * contexts busy at once.  Tasks are written as ordinary sequential code using
+ * the stackless coroutine macros below:
+ *
+ *   static int echoTask(whClientAsyncTask* task)
+ *   {
+ *       myState* s = task->context;
+ *       int rc = 0;
+ *       WH_CLIENT_ASYNC_BEGIN(task);
+ *       WH_CLIENT_ASYNC_AWAIT(task, rc,
+ *           wh_Client_EchoRequest(task->client, s->len, s->buf));
+ *       if (rc == 0) {
+ *           WH_CLIENT_ASYNC_AWAIT(task, rc,
+ *               wh_Client_EchoResponse(task->client, &s->len, s->buf));
+ *       }
+ *       WH_CLIENT_ASYNC_END(task, rc);
+ *   }
+ *
+ * Local variables are not preserved across an await, so any state that must
+ * survive belongs in task->context.  An await may not be placed inside a
+ * switch statement within the task, and only one await may appear per line.
+ * Each task should own its client context, as a client carries at most one
+ * outstanding request.
+ */
+
+#ifndef WOLFHSM_WH_CLIENT_ASYNC_H_
+#define WOLFHSM_WH_CLIENT_ASYNC_H_
+
+#include <stdint.h>
+
+#include "wolfhsm/wh_common.h"
+#include "wolfhsm/wh_error.h"
+#include "wolfhsm/wh_client.h"
+
+/* Resume point of a task that has finished */
+#define WH_CLIENT_ASYNC_DONE 0xFFFFFFFFul
+
+typedef struct whClientAsyncTask whClientAsyncTask;
+
+/* Task body.  Returns WH_ERROR_NOTREADY to yield, anything else to finish */
+typedef int (*whClientAsyncTaskFn)(whClientAsyncTask* task);
+
+struct whClientAsyncTask {
+    whClientAsyncTaskFn fn;
+    whClientContext* client;
+    void* context;              /* Application state kept across awaits */
+    whClientAsyncTask* next;
+    int rc;                     /* Result once finished */
+    uint32_t resume;            /* Resume point, 0 before the first run */
+};
+
+/* Called when no task made progress, e.g. to poll() the transport file
+ * descriptors or to yield the CPU.  A non-zero return stops the loop */
+typedef int (*whClientAsyncWaitCb)(void* context);
+
+typedef struct {
+    whClientAsyncTask* head;
+    whClientAsyncWaitCb waitCb;
+    void* waitContext;
+    uint32_t active;            /* Tasks not yet finished */
+    uint8_t padding[4];
+} whClientAsync;
+
+#define WH_CLIENT_ASYNC_BEGIN(task) \
+    switch ((task)->resume) {       \
+        case 0:
+
+/* Evaluate call, yielding to the loop and re-evaluating it on the next pass
+ * while it returns WH_ERROR_NOTREADY.  The result is stored in rc */
+#define WH_CLIENT_ASYNC_AWAIT(task, rc, call)       \
+        (task)->resume = __LINE__;                  \
+        case __LINE__:                              \
+        if (((rc) = (call)) == WH_ERROR_NOTREADY) { \
+            return WH_ERROR_NOTREADY;               \
+        }
+
+/* Yield once without waiting on a call */
+#define WH_CLIENT_ASYNC_YIELD(task)                 \
+        (task)->resume = __LINE__;                  \
+        return WH_ERROR_NOTREADY;                   \
+        case __LINE__:
+
+#define WH_CLIENT_ASYNC_END(task, rc)   \
+        default:                        \
+            break;                      \
+    }                                   \
+    return (rc)
+
+#define WH_CLIENT_ASYNC_IS_DONE(task) \
+    ((task)->resume == WH_CLIENT_ASYNC_DONE)
+
+int wh_ClientAsync_Init(whClientAsync* loop, whClientAsyncWaitCb waitCb,
+        void* waitContext);
+
+/* Add a task to the loop.  It first runs on the next poll */
+int wh_ClientAsync_Start(whClientAsync* loop, whClientAsyncTask* task,
+        whClientAsyncTaskFn fn, whClientContext* client, void* context);
+
+/* Run every active task once.  Finished tasks are removed from the loop with
+ * their result in task->rc.  Returns WH_ERROR_NOTREADY while tasks remain,
+ * or WH_ERROR_OK once none are left.  out_progress, if provided, is set to
+ * the number of tasks that advanced */
+int wh_ClientAsync_Poll(whClientAsync* loop, uint32_t* out_progress);
+
+/* Poll until every task has finished, calling waitCb on idle passes */
+int wh_ClientAsync_Run(whClientAsync* loop);
+
+#endif /* WOLFHSM_WH_CLIENT_ASYNC_H_ */
@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2024 wolfSSL Inc.
+ *
+ * This file is part of wolfHSM.
+ *
+ * wolfHSM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfHSM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wolfHSM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * wolfhsm/wh_client_cert.h
+ *
+ * Client API for the certificate message group.  A chain is sent as the leaf
+ * certificate followed by its intermediates as concatenated DER and is
+ * verified by the server against a trust anchor stored as an NVM object.
+ */
+
+#ifndef WOLFHSM_WH_CLIENT_CERT_H_
+#define WOLFHSM_WH_CLIENT_CERT_H_
+
+/* System libraries */
+#include <stdint.h>
+
+/* Common WolfHSM types and defines shared with the server */
+#include "wolfhsm/wh_common.h"
+
+/* Component includes */
+#include "wolfhsm/wh_client.h"
+#include "wolfhsm/wh_message_cert.h"
+
+/**
+ * @brief Verifies a certificate chain carried inline in the request.
+ *
+ * The chain must fit in WH_MESSAGE_CERT_MAX_CHAIN_LEN bytes. Use the DMA
+ * variants for longer chains.
+ *
+ * @param[in] c Pointer to the client context.
+ * @param[in] chain Leaf certificate followed by intermediates, in DER.
+ * @param[in] chain_len Length of chain in bytes.
+ * @param[in] trusted_id NVM id of the DER trust anchor.
+ * @param[out] out_rc Pointer to store the return code from the server.
+ *             WH_ERROR_CERTVERIFY indicates the chain did not verify.
+ * @param[out] out_depth Pointer to store the number of verified certificates.
+ * @return int Returns 0 on success, or a negative error code on failure.
+ */
+int wh_Client_CertVerifyRequest(whClientContext* c, const uint8_t* chain,
+        uint16_t chain_len, whNvmId trusted_id);
+int wh_Client_CertVerifyResponse(whClientContext* c, int32_t* out_rc,
+        uint16_t* out_depth);
+int wh_Client_CertVerify(whClientContext* c, const uint8_t* chain,
+        uint16_t chain_len, whNvmId trusted_id, int32_t* out_rc,
+        uint16_t* out_depth);
+
+/**
+ * @brief Verifies a certificate chain the server reads from client memory
+ * using DMA with a 32-bit client address.
+ *
+ * @param[in] c Pointer to the client context.
+ * @param[in] chain_hostaddr Client address of the DER chain.
+ * @param[in] chain_len Length of the chain in bytes.
+ * @param[in] trusted_id NVM id of the DER trust anchor.
+ * @param[out] out_rc Pointer to store the return code from the server.
+ * @param[out] out_depth Pointer to store the number of verified certificates.
+ * @return int Returns 0 on success, or a negative error code on failure.
+ */
+int wh_Client_CertVerifyDma32Request(whClientContext* c,
+        uint32_t chain_hostaddr, uint32_t chain_len, whNvmId trusted_id);
+int wh_Client_CertVerifyDma32Response(whClientContext* c, int32_t* out_rc,
+        uint16_t* out_depth);
+int wh_Client_CertVerifyDma32(whClientContext* c, uint32_t chain_hostaddr,
+        uint32_t chain_len, whNvmId trusted_id, int32_t* out_rc,
+        uint16_t* out_depth);
+
+/**
+ * @brief Verifies a certificate chain the server reads from client memory
+ * using DMA with a 64-bit client address.
+ *
+ * @param[in] c Pointer to the client context.
+ * @param[in] chain_hostaddr Client address of the DER chain.
+ * @param[in] chain_len Length of the chain in bytes.
+ * @param[in] trusted_id NVM id of the DER trust anchor.
+ * @param[out] out_rc Pointer to store the return code from the server.
+ * @param[out] out_depth Pointer to store the number of verified certificates.
+ * @return int Returns 0 on success, or a negative error code on failure.
+ */
+int wh_Client_CertVerifyDma64Request(whClientContext* c,
+        uint64_t chain_hostaddr, uint32_t chain_len, whNvmId trusted_id);
+int wh_Client_CertVerifyDma64Response(whClientContext* c, int32_t* out_rc,
+        uint16_t* out_depth);
+int wh_Client_CertVerifyDma64(whClientContext* c, uint64_t chain_hostaddr,
+        uint32_t chain_len, whNvmId trusted_id, int32_t* out_rc,
+        uint16_t* out_depth);
+
+#endif /* WOLFHSM_WH_CLIENT_CERT_H_ */
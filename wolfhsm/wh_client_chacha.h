@@ -0,0 +1,203 @@
+/*
+ * Copyright (C) 2024 wolfSSL Inc.
+ *
+ * This file is part of wolfHSM.
+ *
+ * wolfHSM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfHSM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wolfHSM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * wolfhsm/wh_client_chacha.h
+ *
+ * Client API for the ChaCha20-Poly1305 message group.  Keys are referenced
+ * by keystore id, so 256-bit keys are cached or committed with the key API
+ * first.  For every operation the tag is an output when encrypting and the
+ * expected value when decrypting.
+ */
+
+#ifndef WOLFHSM_WH_CLIENT_CHACHA_H_
+#define WOLFHSM_WH_CLIENT_CHACHA_H_
+
+/* System libraries */
+#include <stdint.h>
+
+/* Common WolfHSM types and defines shared with the server */
+#include "wolfhsm/wh_common.h"
+
+/* Component includes */
+#include "wolfhsm/wh_client.h"
+#include "wolfhsm/wh_message_chacha.h"
+
+/**
+ * @brief Sends a one-shot ChaCha20-Poly1305 request with inline data.
+ *
+ * @param[in] c Pointer to the client context.
+ * @param[in] key_id Keystore id of the 256-bit key.
+ * @param[in] enc 1 to encrypt, 0 to decrypt.
+ * @param[in] iv WH_CHACHA_IV_LEN byte nonce.
+ * @param[in] aad Additional authenticated data, may be NULL if aad_len is 0.
+ * @param[in] aad_len Length of aad in bytes.
+ * @param[in] in Input data, may be NULL if in_len is 0.
+ * @param[in] in_len Length of in in bytes.  aad_len plus in_len must not
+ *            exceed WH_MESSAGE_CHACHA_MAX_INLINE_LEN.
+ * @param[in] tag Expected WH_CHACHA_TAG_LEN byte tag when decrypting, may be
+ *            NULL when encrypting.
+ * @return int Returns 0 on success, or a negative error code on failure.
+ */
+int wh_Client_ChaChaCryptRequest(whClientContext* c, whKeyId key_id,
+        uint8_t enc, const uint8_t* iv, const uint8_t* aad, uint16_t aad_len,
+        const uint8_t* in, uint16_t in_len, const uint8_t* tag);
+
+/**
+ * @brief Receives the response to a Crypt request.
+ *
+ * @param[in] c Pointer to the client context.
+ * @param[out] out_rc Pointer to store the return code from the server.
+ * @param[out] out Buffer to store the output data.
+ * @param[in,out] inout_out_len Size of out on input, output length on
+ *                output.
+ * @param[out] tag Buffer to store the computed tag when encrypting, may be
+ *             NULL.
+ * @return int Returns 0 on success, WH_ERROR_NOTREADY if no response has been
+ *         received, or a negative error code on failure.
+ */
+int wh_Client_ChaChaCryptResponse(whClientContext* c, int32_t* out_rc,
+        uint8_t* out, uint16_t* inout_out_len, uint8_t* tag);
+
+/**
+ * @brief Performs a one-shot ChaCha20-Poly1305 operation, blocking until the
+ * response is received.  out must hold in_len bytes.
+ *
+ * @return int Returns 0 on success, or a negative error code on failure.
+ */
+int wh_Client_ChaChaCrypt(whClientContext* c, whKeyId key_id, uint8_t enc,
+        const uint8_t* iv, const uint8_t* aad, uint16_t aad_len,
+        const uint8_t* in, uint16_t in_len, uint8_t* out, uint8_t* tag,
+        int32_t* out_rc);
+
+/**
+ * @brief Starts a streaming ChaCha20-Poly1305 session on the server.
+ *
+ * @param[in] c Pointer to the client context.
+ * @param[in] key_id Keystore id of the 256-bit key.
+ * @param[in] enc 1 to encrypt, 0 to decrypt.
+ * @param[in] iv WH_CHACHA_IV_LEN byte nonce.
+ * @return int Returns 0 on success, or a negative error code on failure.
+ */
+int wh_Client_ChaChaInitRequest(whClientContext* c, whKeyId key_id,
+        uint8_t enc, const uint8_t* iv);
+
+/**
+ * @brief Receives the response to an Init request.
+ *
+ * @param[in] c Pointer to the client context.
+ * @param[out] out_rc Pointer to store the return code from the server.
+ * @param[out] out_session Pointer to store the session handle.
+ * @return int Returns 0 on success, WH_ERROR_NOTREADY if no response has been
+ *         received, or a negative error code on failure.
+ */
+int wh_Client_ChaChaInitResponse(whClientContext* c, int32_t* out_rc,
+        uint16_t* out_session);
+int wh_Client_ChaChaInit(whClientContext* c, whKeyId key_id, uint8_t enc,
+        const uint8_t* iv, int32_t* out_rc, uint16_t* out_session);
+
+/**
+ * @brief Adds AAD and data to a streaming session.  All AAD must be sent
+ * before the first data.  A failed update ends the session.
+ *
+ * @param[in] c Pointer to the client context.
+ * @param[in] session Handle returned by Init.
+ * @param[in] aad Additional authenticated data, may be NULL if aad_len is 0.
+ * @param[in] aad_len Length of aad in bytes.
+ * @param[in] in Input data, may be NULL if in_len is 0.
+ * @param[in] in_len Length of in in bytes.  aad_len plus in_len must not
+ *            exceed WH_MESSAGE_CHACHA_MAX_INLINE_LEN.
+ * @return int Returns 0 on success, or a negative error code on failure.
+ */
+int wh_Client_ChaChaUpdateRequest(whClientContext* c, uint16_t session,
+        const uint8_t* aad, uint16_t aad_len, const uint8_t* in,
+        uint16_t in_len);
+
+/**
+ * @brief Receives the response to an Update request.
+ *
+ * @param[in] c Pointer to the client context.
+ * @param[out] out_rc Pointer to store the return code from the server.
+ * @param[out] out Buffer to store the output data.
+ * @param[in,out] inout_out_len Size of out on input, output length on
+ *                output.
+ * @return int Returns 0 on success, WH_ERROR_NOTREADY if no response has been
+ *         received, or a negative error code on failure.
+ */
+int wh_Client_ChaChaUpdateResponse(whClientContext* c, int32_t* out_rc,
+        uint8_t* out, uint16_t* inout_out_len);
+int wh_Client_ChaChaUpdate(whClientContext* c, uint16_t session,
+        const uint8_t* aad, uint16_t aad_len, const uint8_t* in,
+        uint16_t in_len, uint8_t* out, int32_t* out_rc);
+
+/**
+ * @brief Finishes a streaming session.  The session ends whatever the
+ * result.
+ *
+ * @param[in] c Pointer to the client context.
+ * @param[in] session Handle returned by Init.
+ * @param[in] tag Expected tag when decrypting, may be NULL when encrypting.
+ * @return int Returns 0 on success, or a negative error code on failure.
+ */
+int wh_Client_ChaChaFinalRequest(whClientContext* c, uint16_t session,
+        const uint8_t* tag);
+
+/**
+ * @brief Receives the response to a Final or CryptDma request.
+ *
+ * @param[in] c Pointer to the client context.
+ * @param[out] out_rc Pointer to store the return code from the server.
+ * @param[out] tag Buffer to store the computed tag when encrypting, may be
+ *             NULL.
+ * @return int Returns 0 on success, WH_ERROR_NOTREADY if no response has been
+ *         received, or a negative error code on failure.
+ */
+int wh_Client_ChaChaFinalResponse(whClientContext* c, int32_t* out_rc,
+        uint8_t* tag);
+int wh_Client_ChaChaFinal(whClientContext* c, uint16_t session, uint8_t enc,
+        uint8_t* tag, int32_t* out_rc);
+
+/**
+ * @brief Sends a one-shot ChaCha20-Poly1305 request over client memory.  The
+ * server reads the AAD and input and writes the output by DMA.
+ *
+ * @param[in] c Pointer to the client context.
+ * @param[in] key_id Keystore id of the 256-bit key.
+ * @param[in] enc 1 to encrypt, 0 to decrypt.
+ * @param[in] iv WH_CHACHA_IV_LEN byte nonce.
+ * @param[in] aad_hostaddr Client address of the AAD.
+ * @param[in] aad_len Length of the AAD in bytes.
+ * @param[in] in_hostaddr Client address of the input.
+ * @param[in] out_hostaddr Client address of the output, may equal
+ *            in_hostaddr.
+ * @param[in] len Length of the input and output in bytes.
+ * @param[in] tag Expected tag when decrypting, may be NULL when encrypting.
+ * @return int Returns 0 on success, or a negative error code on failure.
+ */
+int wh_Client_ChaChaCryptDmaRequest(whClientContext* c, whKeyId key_id,
+        uint8_t enc, const uint8_t* iv, uint64_t aad_hostaddr,
+        uint32_t aad_len, uint64_t in_hostaddr, uint64_t out_hostaddr,
+        uint32_t len, const uint8_t* tag);
+int wh_Client_ChaChaCryptDmaResponse(whClientContext* c, int32_t* out_rc,
+        uint8_t* tag);
+int wh_Client_ChaChaCryptDma(whClientContext* c, whKeyId key_id,
+        uint8_t enc, const uint8_t* iv, uint64_t aad_hostaddr,
+        uint32_t aad_len, uint64_t in_hostaddr, uint64_t out_hostaddr,
+        uint32_t len, uint8_t* tag, int32_t* out_rc);
+
+#endif /* WOLFHSM_WH_CLIENT_CHACHA_H_ */
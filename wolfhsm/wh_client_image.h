@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) 2024 wolfSSL Inc.
+ *
+ * This file is part of wolfHSM.
+ *
+ * wolfHSM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfHSM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wolfHSM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * wolfhsm/wh_client_image.h
+ *
+ * Client API for the image message group.  The server reads the image from
+ * client memory by DMA, so only the descriptor and signature are sent.  A
+ * non-zero slice_len bounds the bytes hashed per request; the remainder is
+ * processed by Continue requests until the response reports done.
+ */
+
+#ifndef WOLFHSM_WH_CLIENT_IMAGE_H_
+#define WOLFHSM_WH_CLIENT_IMAGE_H_
+
+/* System libraries */
+#include <stdint.h>
+
+/* Common WolfHSM types and defines shared with the server */
+#include "wolfhsm/wh_common.h"
+
+/* Component includes */
+#include "wolfhsm/wh_client.h"
+#include "wolfhsm/wh_message_image.h"
+
+/**
+ * @brief Starts verification of an image in client memory using DMA with a
+ * 32-bit client address.
+ *
+ * @param[in] c Pointer to the client context.
+ * @param[in] image_hostaddr Client address of the image.
+ * @param[in] image_len Length of the image in bytes.
+ * @param[in] slice_len Max bytes hashed by this request, 0 for the whole image.
+ * @param[in] key_id Keystore id of the ECC public key.
+ * @param[in] curve_id wolfCrypt curve id of the key.
+ * @param[in] hash_type WH_IMAGE_HASH_SHA256 or WH_IMAGE_HASH_SHA384.
+ * @param[in] sig DER encoded ECDSA signature over the image digest.
+ * @param[in] sig_len Length of sig in bytes.
+ * @return int Returns 0 on success, or a negative error code on failure.
+ */
+int wh_Client_ImageVerifyDma32Request(whClientContext* c,
+        uint32_t image_hostaddr, uint32_t image_len, uint32_t slice_len,
+        whKeyId key_id, uint16_t curve_id, uint8_t hash_type,
+        const uint8_t* sig, uint16_t sig_len);
+
+/**
+ * @brief Receives the response to a VerifyDma32 request.
+ *
+ * @param[in] c Pointer to the client context.
+ * @param[out] out_rc Pointer to store the return code from the server.
+ * @param[out] out_offset Pointer to store the bytes hashed so far.
+ * @param[out] out_done Pointer to store 1 once the image is fully hashed.
+ * @param[out] out_verified Pointer to store 1 if done and the signature
+ *             matched.
+ * @param[out] digest Buffer to store the image digest once done.
+ * @param[in,out] inout_digest_len Size of digest on input, digest length on
+ *                output.
+ * @return int Returns 0 on success, WH_ERROR_NOTREADY if no response has been
+ *         received, or a negative error code on failure.
+ */
+int wh_Client_ImageVerifyDma32Response(whClientContext* c, int32_t* out_rc,
+        uint32_t* out_offset, uint8_t* out_done, uint8_t* out_verified,
+        uint8_t* digest, uint16_t* inout_digest_len);
+
+/**
+ * @brief Verifies an image in client memory using DMA with a 32-bit client
+ * address, issuing Continue requests of slice_len bytes until done.
+ *
+ * @return int Returns 0 on success, or a negative error code on failure.
+ */
+int wh_Client_ImageVerifyDma32(whClientContext* c, uint32_t image_hostaddr,
+        uint32_t image_len, uint32_t slice_len, whKeyId key_id,
+        uint16_t curve_id, uint8_t hash_type, const uint8_t* sig,
+        uint16_t sig_len, int32_t* out_rc, uint8_t* out_verified,
+        uint8_t* digest, uint16_t* inout_digest_len);
+
+/**
+ * @brief 64-bit client address variants of the VerifyDma32 functions.
+ */
+int wh_Client_ImageVerifyDma64Request(whClientContext* c,
+        uint64_t image_hostaddr, uint32_t image_len, uint32_t slice_len,
+        whKeyId key_id, uint16_t curve_id, uint8_t hash_type,
+        const uint8_t* sig, uint16_t sig_len);
+int wh_Client_ImageVerifyDma64Response(whClientContext* c, int32_t* out_rc,
+        uint32_t* out_offset, uint8_t* out_done, uint8_t* out_verified,
+        uint8_t* digest, uint16_t* inout_digest_len);
+int wh_Client_ImageVerifyDma64(whClientContext* c, uint64_t image_hostaddr,
+        uint32_t image_len, uint32_t slice_len, whKeyId key_id,
+        uint16_t curve_id, uint8_t hash_type, const uint8_t* sig,
+        uint16_t sig_len, int32_t* out_rc, uint8_t* out_verified,
+        uint8_t* digest, uint16_t* inout_digest_len);
+
+/**
+ * @brief Hashes the next slice of the image being verified.
+ *
+ * The response has the same form as the VerifyDma32 response.
+ *
+ * @param[in] c Pointer to the client context.
+ * @param[in] slice_len Max bytes hashed by this request, 0 for the remainder.
+ * @return int Returns 0 on success, or a negative error code on failure.
+ */
+int wh_Client_ImageContinueRequest(whClientContext* c, uint32_t slice_len);
+int wh_Client_ImageContinueResponse(whClientContext* c, int32_t* out_rc,
+        uint32_t* out_offset, uint8_t* out_done, uint8_t* out_verified,
+        uint8_t* digest, uint16_t* inout_digest_len);
+
+#endif /* WOLFHSM_WH_CLIENT_IMAGE_H_ */
@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) 2024 wolfSSL Inc.
+ *
+ * This file is part of wolfHSM.
+ *
+ * wolfHSM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfHSM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wolfHSM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * wolfhsm/wh_client_keywrap.h
+ *
+ * Client API for the wrapped bulk key message group.  Keys committed to NVM
+ * by this client are exported as opaque blobs encrypted under a key
+ * encryption key (KEK) held by the server, and the blobs can be imported
+ * into any server that holds the same KEK.
+ */
+
+#ifndef WOLFHSM_WH_CLIENT_KEYWRAP_H_
+#define WOLFHSM_WH_CLIENT_KEYWRAP_H_
+
+/* System libraries */
+#include <stdint.h>
+
+/* Common WolfHSM types and defines shared with the server */
+#include "wolfhsm/wh_common.h"
+
+/* Component includes */
+#include "wolfhsm/wh_client.h"
+#include "wolfhsm/wh_message_keywrap.h"
+
+/**
+ * @brief Exports the next batch of committed keys as a wrapped blob.
+ *
+ * Start with a cursor of 0 and pass back out_next_cursor until out_done is
+ * set. A batch may carry no keys, in which case out_blob_len is 0. NVM should
+ * not be modified while an export is in progress.
+ *
+ * @param[in] c Pointer to the client context.
+ * @param[in] kek_id Keystore id of the AES key used to wrap the blob.
+ * @param[in] cursor 0 to start, else the cursor returned by the last batch.
+ * @param[out] out_rc Pointer to store the return code from the server.
+ * @param[out] blob Buffer to receive the wrapped blob.
+ * @param[in,out] inout_blob_len Size of blob on input, at most
+ *                WH_MESSAGE_KEYWRAP_MAX_BLOB_LEN is used. Bytes of blob
+ *                received on output.
+ * @param[out] out_count Pointer to store the number of keys in the blob.
+ * @param[out] out_next_cursor Pointer to store the cursor for the next batch.
+ * @param[out] out_done Pointer to store 1 once no keys remain.
+ * @return int Returns 0 on success, or a negative error code on failure.
+ */
+int wh_Client_KeyWrapExportRequest(whClientContext* c, whKeyId kek_id,
+        whNvmId cursor, uint16_t max_len);
+int wh_Client_KeyWrapExportResponse(whClientContext* c, int32_t* out_rc,
+        uint8_t* blob, uint16_t* inout_blob_len, uint16_t* out_count,
+        whNvmId* out_next_cursor, uint8_t* out_done);
+int wh_Client_KeyWrapExport(whClientContext* c, whKeyId kek_id,
+        whNvmId cursor, int32_t* out_rc, uint8_t* blob,
+        uint16_t* inout_blob_len, uint16_t* out_count,
+        whNvmId* out_next_cursor, uint8_t* out_done);
+
+/**
+ * @brief Imports a wrapped blob produced by an export.
+ *
+ * Every key in the blob is added to NVM under this client, replacing any key
+ * with the same id. No key is added unless the whole blob authenticates.
+ *
+ * @param[in] c Pointer to the client context.
+ * @param[in] kek_id Keystore id of the AES key the blob was wrapped with.
+ * @param[in] blob Wrapped blob.
+ * @param[in] blob_len Length of blob in bytes.
+ * @param[out] out_rc Pointer to store the return code from the server.
+ * @param[out] out_count Pointer to store the number of keys added.
+ * @return int Returns 0 on success, or a negative error code on failure.
+ */
+int wh_Client_KeyWrapImportRequest(whClientContext* c, whKeyId kek_id,
+        const uint8_t* blob, uint16_t blob_len);
+int wh_Client_KeyWrapImportResponse(whClientContext* c, int32_t* out_rc,
+        uint16_t* out_count);
+int wh_Client_KeyWrapImport(whClientContext* c, whKeyId kek_id,
+        const uint8_t* blob, uint16_t blob_len, int32_t* out_rc,
+        uint16_t* out_count);
+
+#endif /* WOLFHSM_WH_CLIENT_KEYWRAP_H_ */
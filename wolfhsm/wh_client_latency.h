@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2024 wolfSSL Inc.
+ *
+ * This file is part of wolfHSM.
+ *
+ * wolfHSM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfHSM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wolfHSM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * wolfhsm/wh_client_latency.h
+ *
+ * Client-side latency histograms, split by where the time was spent.
+ *
+ * Each completed request is broken into four phases:
+ *   SEND:      wh_Client_SendRequest until the transport accepted the packet
+ *   TRANSPORT: remaining wait not accounted for by the server
+ *   SERVER:    server receive-to-send time, as reported in the response
+ *   RECV:      the wh_Client_RecvResponse call that returned the response
+ * Request and response structs are translated outside these calls, so their
+ * cost is not part of any phase.  Each phase is recorded in a log2 histogram
+ * per message group.  Server time is only available when the server has a
+ * time source, otherwise it is counted as transport time.
+ */
+
+#ifndef WOLFHSM_WH_CLIENT_LATENCY_H_
+#define WOLFHSM_WH_CLIENT_LATENCY_H_
+
+#include <stdint.h>
+
+#include "wolfhsm/wh_message.h"
+
+/* Bucket b counts durations below 2^b microseconds that did not fit bucket
+ * b-1.  The last bucket is open-ended */
+#ifndef WH_CLIENT_LATENCY_BUCKETS
+#define WH_CLIENT_LATENCY_BUCKETS 20
+#endif
+
+/* One histogram set per message group, indexed by group >> 8 */
+#define WH_CLIENT_LATENCY_GROUPS ((WH_MESSAGE_GROUP_CUSTOM >> 8) + 1)
+
+typedef enum {
+    WH_CLIENT_LATENCY_SEND = 0,
+    WH_CLIENT_LATENCY_TRANSPORT = 1,
+    WH_CLIENT_LATENCY_SERVER = 2,
+    WH_CLIENT_LATENCY_RECV = 3,
+    WH_CLIENT_LATENCY_PHASES = 4,
+} whClientLatencyPhase;
+
+/* Breakdown of a single request, in microseconds */
+typedef struct {
+    uint32_t us[WH_CLIENT_LATENCY_PHASES];
+} whClientLatencySample;
+
+typedef struct {
+    uint32_t count[WH_CLIENT_LATENCY_GROUPS][WH_CLIENT_LATENCY_PHASES]
+                  [WH_CLIENT_LATENCY_BUCKETS];
+    uint64_t total[WH_CLIENT_LATENCY_GROUPS][WH_CLIENT_LATENCY_PHASES];
+} whClientLatency;
+
+/* Clear all histograms */
+int wh_ClientLatency_Reset(whClientLatency* latency);
+
+/* Add one request to the histograms for its group */
+int wh_ClientLatency_Record(whClientLatency* latency, uint16_t group,
+        const whClientLatencySample* sample);
+
+/* Number of requests recorded for a group, and their summed time for one
+ * phase, either output optional */
+int wh_ClientLatency_GetTotal(const whClientLatency* latency, uint16_t group,
+        whClientLatencyPhase phase, uint32_t* out_count, uint64_t* out_us);
+
+/* Upper bound of the bucket holding the given percentile (0-100) of one
+ * phase.  Returns WH_ERROR_NOTFOUND if nothing was recorded */
+int wh_ClientLatency_GetPercentile(const whClientLatency* latency,
+        uint16_t group, whClientLatencyPhase phase, uint32_t percent,
+        uint32_t* out_us);
+
+#endif /* WOLFHSM_WH_CLIENT_LATENCY_H_ */
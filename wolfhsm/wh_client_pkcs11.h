@@ -0,0 +1,235 @@
+/*
+ * Copyright (C) 2024 wolfSSL Inc.
+ *
+ * This file is part of wolfHSM.
+ *
+ * wolfHSM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfHSM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wolfHSM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * wolfhsm/wh_client_pkcs11.h
+ *
+ * Client API for the PKCS11 message group.  Session and object handles are
+ * opaque values owned by the server.  As with the rest of the client API, each
+ * operation has a non-blocking Request and Response half and a blocking
+ * wrapper that retries both while WH_ERROR_NOTREADY is returned.
+ */
+
+#ifndef WOLFHSM_WH_CLIENT_PKCS11_H_
+#define WOLFHSM_WH_CLIENT_PKCS11_H_
+
+/* System libraries */
+#include <stdint.h>
+
+/* Common WolfHSM types and defines shared with the server */
+#include "wolfhsm/wh_common.h"
+
+/* Component includes */
+#include "wolfhsm/wh_client.h"
+#include "wolfhsm/wh_message_pkcs11.h"
+
+/**
+ * @brief Opens a server-side PKCS11 session.
+ *
+ * @param[in] c Pointer to the client context.
+ * @param[in] flags Session flags, stored by the server.
+ * @param[out] out_rc Pointer to store the return code from the server.
+ * @param[out] out_session Pointer to store the new session handle.
+ * @return int Returns 0 on success, or a negative error code on failure.
+ */
+int wh_Client_Pkcs11OpenSessionRequest(whClientContext* c, uint32_t flags);
+int wh_Client_Pkcs11OpenSessionResponse(whClientContext* c, int32_t* out_rc,
+        uint32_t* out_session);
+int wh_Client_Pkcs11OpenSession(whClientContext* c, uint32_t flags,
+        int32_t* out_rc, uint32_t* out_session);
+
+/**
+ * @brief Closes a PKCS11 session, ending any active operation. Closing the
+ * last open session also releases all object handles.
+ *
+ * @param[in] c Pointer to the client context.
+ * @param[in] session Session handle.
+ * @param[out] out_rc Pointer to store the return code from the server.
+ * @return int Returns 0 on success, or a negative error code on failure.
+ */
+int wh_Client_Pkcs11CloseSessionRequest(whClientContext* c, uint32_t session);
+int wh_Client_Pkcs11CloseSessionResponse(whClientContext* c, int32_t* out_rc);
+int wh_Client_Pkcs11CloseSession(whClientContext* c, uint32_t session,
+        int32_t* out_rc);
+
+/**
+ * @brief Starts an object search on a session.
+ *
+ * Objects match when their id is within [id_min, id_max] (0 leaves that bound
+ * open), their access equals access, all bits of flags are set and their label
+ * starts with the label_len bytes of label.  Pass WOLFHSM_NVM_ACCESS_ANY,
+ * WOLFHSM_NVM_FLAGS_ANY and label_len 0 to match anything.
+ *
+ * @param[in] c Pointer to the client context.
+ * @param[in] session Session handle.
+ * @param[in] access Access value to match.
+ * @param[in] flags Flag bits that must be set.
+ * @param[in] id_min Lowest id to return, or 0.
+ * @param[in] id_max Highest id to return, or 0.
+ * @param[in] label_len Number of label bytes to compare.
+ * @param[in] label Label prefix, may be NULL if label_len is 0.
+ * @param[out] out_rc Pointer to store the return code from the server.
+ * @return int Returns 0 on success, or a negative error code on failure.
+ */
+int wh_Client_Pkcs11FindObjectsInitRequest(whClientContext* c,
+        uint32_t session, whNvmAccess access, whNvmFlags flags,
+        whNvmId id_min, whNvmId id_max, uint16_t label_len,
+        const uint8_t* label);
+int wh_Client_Pkcs11FindObjectsInitResponse(whClientContext* c,
+        int32_t* out_rc);
+int wh_Client_Pkcs11FindObjectsInit(whClientContext* c, uint32_t session,
+        whNvmAccess access, whNvmFlags flags, whNvmId id_min, whNvmId id_max,
+        uint16_t label_len, const uint8_t* label, int32_t* out_rc);
+
+/**
+ * @brief Returns up to max_count handles of objects matching the active
+ * search.  A count of 0 indicates the search is complete.
+ *
+ * @param[in] c Pointer to the client context.
+ * @param[in] session Session handle.
+ * @param[in] max_count Max handles to return, capped at
+ * WH_MESSAGE_PKCS11_MAX_FIND_HANDLES.
+ * @param[out] out_rc Pointer to store the return code from the server.
+ * @param[out] out_count Pointer to store the number of handles returned.
+ * @param[out] out_handles Array of at least max_count entries.
+ * @return int Returns 0 on success, or a negative error code on failure.
+ */
+int wh_Client_Pkcs11FindObjectsRequest(whClientContext* c, uint32_t session,
+        uint16_t max_count);
+int wh_Client_Pkcs11FindObjectsResponse(whClientContext* c, int32_t* out_rc,
+        uint16_t* out_count, uint32_t* out_handles);
+int wh_Client_Pkcs11FindObjects(whClientContext* c, uint32_t session,
+        uint16_t max_count, int32_t* out_rc, uint16_t* out_count,
+        uint32_t* out_handles);
+
+/**
+ * @brief Ends the active object search on a session.
+ *
+ * @param[in] c Pointer to the client context.
+ * @param[in] session Session handle.
+ * @param[out] out_rc Pointer to store the return code from the server.
+ * @return int Returns 0 on success, or a negative error code on failure.
+ */
+int wh_Client_Pkcs11FindObjectsFinalRequest(whClientContext* c,
+        uint32_t session);
+int wh_Client_Pkcs11FindObjectsFinalResponse(whClientContext* c,
+        int32_t* out_rc);
+int wh_Client_Pkcs11FindObjectsFinal(whClientContext* c, uint32_t session,
+        int32_t* out_rc);
+
+/**
+ * @brief Gets the id and metadata of the object referenced by a handle.
+ *
+ * @param[in] c Pointer to the client context.
+ * @param[in] session Session handle.
+ * @param[in] object Object handle.
+ * @param[out] out_rc Pointer to store the return code from the server.
+ * @param[out] out_id Pointer to store the NVM id of the object.
+ * @param[out] out_access Pointer to store the access of the object.
+ * @param[out] out_flags Pointer to store the flags of the object.
+ * @param[out] out_len Pointer to store the data length of the object.
+ * @param[in] label_len Size of the label buffer.
+ * @param[out] label Buffer to store the label of the object.
+ * @return int Returns 0 on success, or a negative error code on failure.
+ */
+int wh_Client_Pkcs11GetObjectInfoRequest(whClientContext* c, uint32_t session,
+        uint32_t object);
+int wh_Client_Pkcs11GetObjectInfoResponse(whClientContext* c, int32_t* out_rc,
+        whNvmId* out_id, whNvmAccess* out_access, whNvmFlags* out_flags,
+        whNvmSize* out_len, whNvmSize label_len, uint8_t* label);
+int wh_Client_Pkcs11GetObjectInfo(whClientContext* c, uint32_t session,
+        uint32_t object, int32_t* out_rc, whNvmId* out_id,
+        whNvmAccess* out_access, whNvmFlags* out_flags, whNvmSize* out_len,
+        whNvmSize label_len, uint8_t* label);
+
+/**
+ * @brief Destroys the object referenced by a handle and invalidates the
+ * handle.
+ *
+ * @param[in] c Pointer to the client context.
+ * @param[in] session Session handle.
+ * @param[in] object Object handle.
+ * @param[out] out_rc Pointer to store the return code from the server.
+ * @return int Returns 0 on success, or a negative error code on failure.
+ */
+int wh_Client_Pkcs11DestroyObjectRequest(whClientContext* c, uint32_t session,
+        uint32_t object);
+int wh_Client_Pkcs11DestroyObjectResponse(whClientContext* c, int32_t* out_rc);
+int wh_Client_Pkcs11DestroyObject(whClientContext* c, uint32_t session,
+        uint32_t object, int32_t* out_rc);
+
+/**
+ * @brief Starts a sign operation with the key referenced by object.
+ *
+ * @param[in] c Pointer to the client context.
+ * @param[in] session Session handle.
+ * @param[in] object Key object handle.
+ * @param[in] mechanism One of WH_PKCS11_MECH_*.
+ * @param[out] out_rc Pointer to store the return code from the server.
+ * @return int Returns 0 on success, or a negative error code on failure.
+ */
+int wh_Client_Pkcs11SignInitRequest(whClientContext* c, uint32_t session,
+        uint32_t object, uint32_t mechanism);
+int wh_Client_Pkcs11SignInitResponse(whClientContext* c, int32_t* out_rc);
+int wh_Client_Pkcs11SignInit(whClientContext* c, uint32_t session,
+        uint32_t object, uint32_t mechanism, int32_t* out_rc);
+
+/**
+ * @brief Adds data to a multi-part sign operation.
+ *
+ * @param[in] c Pointer to the client context.
+ * @param[in] session Session handle.
+ * @param[in] data Data to add.
+ * @param[in] len Length of data, up to WH_MESSAGE_PKCS11_MAX_SIGN_DATA_LEN.
+ * @param[out] out_rc Pointer to store the return code from the server.
+ * @return int Returns 0 on success, or a negative error code on failure.
+ */
+int wh_Client_Pkcs11SignUpdateRequest(whClientContext* c, uint32_t session,
+        const uint8_t* data, uint16_t len);
+int wh_Client_Pkcs11SignUpdateResponse(whClientContext* c, int32_t* out_rc);
+int wh_Client_Pkcs11SignUpdate(whClientContext* c, uint32_t session,
+        const uint8_t* data, uint16_t len, int32_t* out_rc);
+
+/**
+ * @brief Signs data in a single part (Sign) or finishes a multi-part
+ * operation (SignFinal).  ECDSA signatures are returned as raw r || s.
+ *
+ * @param[in] c Pointer to the client context.
+ * @param[in] session Session handle.
+ * @param[in] data Data or digest to sign, Sign only.
+ * @param[in] len Length of data, Sign only.
+ * @param[out] out_rc Pointer to store the return code from the server.
+ * @param[out] sig Buffer to store the signature.
+ * @param[in,out] inout_sig_len Size of sig on input, signature length on
+ * output.
+ * @return int Returns 0 on success, or a negative error code on failure.
+ */
+int wh_Client_Pkcs11SignRequest(whClientContext* c, uint32_t session,
+        const uint8_t* data, uint16_t len);
+int wh_Client_Pkcs11SignResponse(whClientContext* c, int32_t* out_rc,
+        uint8_t* sig, uint16_t* inout_sig_len);
+int wh_Client_Pkcs11Sign(whClientContext* c, uint32_t session,
+        const uint8_t* data, uint16_t len, int32_t* out_rc, uint8_t* sig,
+        uint16_t* inout_sig_len);
+int wh_Client_Pkcs11SignFinalRequest(whClientContext* c, uint32_t session);
+int wh_Client_Pkcs11SignFinalResponse(whClientContext* c, int32_t* out_rc,
+        uint8_t* sig, uint16_t* inout_sig_len);
+int wh_Client_Pkcs11SignFinal(whClientContext* c, uint32_t session,
+        int32_t* out_rc, uint8_t* sig, uint16_t* inout_sig_len);
+
+#endif /* WOLFHSM_WH_CLIENT_PKCS11_H_ */
@@ -0,0 +1,136 @@
+/*
+ * Copyright (C) 2024 wolfSSL Inc.
+ *
+ * This file is part of wolfHSM.
+ *
+ * wolfHSM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfHSM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wolfHSM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * wolfhsm/wh_client_pool.h
+ *
+ * Client-side pool that spreads stateless requests across several
+ * connections to replicated WolfHSM servers.
+ *
+ * Each member is an initialized whClientContext bound to its own server.
+ * A member carries at most one outstanding request, so selection picks an
+ * idle member: round-robin for WH_CLIENT_POOL_LEAST_OUTSTANDING, or the
+ * lowest smoothed round-trip time for WH_CLIENT_POOL_LATENCY.  A member
+ * whose requests keep failing at the transport is taken out of rotation
+ * until the application marks it available again.
+ *
+ * Only operations that do not depend on server state may be spread this
+ * way, e.g. RNG, or signing and verification with keys that are replicated
+ * on every server.  Key generation, and any use of a key known to one server
+ * only, stay on the first available member.
+ */
+
+#ifndef WOLFHSM_WH_CLIENT_POOL_H_
+#define WOLFHSM_WH_CLIENT_POOL_H_
+
+#include <stdint.h>
+
+#include "wolfhsm/wh_common.h"
+#include "wolfhsm/wh_client.h"
+#include "wolfhsm/wh_lock.h"
+
+#ifndef WH_CLIENT_POOL_MAX_MEMBERS
+#define WH_CLIENT_POOL_MAX_MEMBERS 4
+#endif
+
+typedef enum {
+    WH_CLIENT_POOL_LEAST_OUTSTANDING = 0,
+    WH_CLIENT_POOL_LATENCY = 1,
+} whClientPoolPolicy;
+
+/* Monotonic time source in any unit, used to measure round trips */
+typedef uint32_t (*whClientPoolTimeCb)(void* context);
+
+/* Called by wh_ClientPool_CryptoCb while every available member has a
+ * request in flight, e.g. to yield the CPU or wait on a condition signaled
+ * when another thread releases a member.  A non-zero return gives up with
+ * that code */
+typedef int (*whClientPoolWaitCb)(void* context);
+
+typedef struct {
+    whClientContext* client;
+    uint32_t latency;       /* Smoothed round trip, 0 until measured */
+    uint16_t failures;      /* Consecutive transport failures */
+    uint8_t  outstanding;   /* Request in flight on this member */
+    uint8_t  down;          /* Out of rotation */
+} whClientPoolMember;
+
+typedef struct {
+    whClientContext* const* clients;    /* Initialized client contexts */
+    whClientPoolTimeCb timeCb;          /* Required for the latency policy */
+    void* timeContext;
+    whClientPoolWaitCb waitCb;          /* Optional, see whClientPoolWaitCb */
+    void* waitContext;
+    const whLockConfig* lock_config;    /* Optional, for shared pools */
+    uint16_t count;
+    uint16_t maxFailures;   /* Failures before removal. 0 for 1 */
+    uint8_t  policy;        /* whClientPoolPolicy */
+    uint8_t  replicatedKeys; /* Every server holds the keys used by id */
+    uint8_t  padding[2];
+} whClientPoolConfig;
+
+typedef struct {
+    whClientPoolMember members[WH_CLIENT_POOL_MAX_MEMBERS];
+    whClientPoolTimeCb timeCb;
+    void* timeContext;
+    whClientPoolWaitCb waitCb;
+    void* waitContext;
+    whLock lock[1];
+    uint16_t count;
+    uint16_t maxFailures;
+    uint16_t next;          /* Round-robin start */
+    uint8_t  policy;
+    uint8_t  replicatedKeys;
+} whClientPool;
+
+int wh_ClientPool_Init(whClientPool* pool, const whClientPoolConfig* config);
+int wh_ClientPool_Cleanup(whClientPool* pool);
+
+/* Select an idle, available member and mark it busy.  The token must be
+ * passed back to wh_ClientPool_Release.  Returns WH_ERROR_NOTREADY if every
+ * available member has a request in flight, or WH_ERROR_ABORTED if every
+ * member is out of rotation */
+int wh_ClientPool_Acquire(whClientPool* pool, whClientContext** out_client,
+        uint32_t* out_token);
+
+/* Return a member once its response has been received.  rc is the result of
+ * the client call: WH_ERROR_ABORTED counts as a transport failure, anything
+ * else as a completed round trip */
+int wh_ClientPool_Release(whClientPool* pool, whClientContext* client,
+        uint32_t token, int rc);
+
+/* Put a member back into or out of rotation, e.g. after reconnecting */
+int wh_ClientPool_SetAvailable(whClientPool* pool, whClientContext* client,
+        int available);
+
+#ifndef WOLFHSM_NO_CRYPTO
+/* wolfCrypt callback that forwards each operation to a pool member, failing
+ * over to another member on transport errors.  RNG, seed, and ciphers given
+ * the key with each request are spread across the pool, as are operations
+ * using keys by id when replicatedKeys is set.  Key generation and anything
+ * else is kept on the first available member.  When every member is busy it
+ * calls the configured waitCb between attempts, or returns
+ * WH_ERROR_NOTREADY at once without one */
+int wh_ClientPool_CryptoCb(int devId, wc_CryptoInfo* info, void* ctx);
+
+/* Register wh_ClientPool_CryptoCb for devId, which must differ from
+ * WOLFHSM_DEV_ID used by the individual clients */
+int wh_ClientPool_RegisterCryptoCb(whClientPool* pool, int devId);
+#endif /* !WOLFHSM_NO_CRYPTO */
+
+#endif /* WOLFHSM_WH_CLIENT_POOL_H_ */
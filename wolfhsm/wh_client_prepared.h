@@ -0,0 +1,140 @@
+/*
+ * Copyright (C) 2024 wolfSSL Inc.
+ *
+ * This file is part of wolfHSM.
+ *
+ * wolfHSM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfHSM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wolfHSM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * wolfhsm/wh_client_prepared.h
+ *
+ * Client API for prepared crypto operations.  Prepare once per key and
+ * fixed parameters, then Exec with only the handle and per-call data.  A
+ * handle may be reclaimed by the server at any time, in which case Exec
+ * reports WH_ERROR_BADHANDLE and the operation must be prepared again.
+ */
+
+#ifndef WOLFHSM_WH_CLIENT_PREPARED_H_
+#define WOLFHSM_WH_CLIENT_PREPARED_H_
+
+/* System libraries */
+#include <stdint.h>
+
+/* Common WolfHSM types and defines shared with the server */
+#include "wolfhsm/wh_common.h"
+
+/* Component includes */
+#include "wolfhsm/wh_client.h"
+#include "wolfhsm/wh_message_prepared.h"
+
+/**
+ * @brief Prepares AES-GCM with a key from the keystore.
+ *
+ * @param[in] c Pointer to the client context.
+ * @param[in] key_id Keystore id of the 128, 192 or 256-bit key.
+ * @param[in] enc 1 to encrypt, 0 to decrypt.
+ * @param[in] iv_len Length of the IV passed to every Exec, at most
+ *            WH_PREPARED_MAX_IV_LEN.
+ * @param[in] tag_len Length of the tag, at most WH_PREPARED_MAX_TAG_LEN.
+ * @return int Returns 0 on success, or a negative error code on failure.
+ */
+int wh_Client_PrepareAesGcmRequest(whClientContext* c, whKeyId key_id,
+        uint8_t enc, uint8_t iv_len, uint8_t tag_len);
+int wh_Client_PrepareAesGcm(whClientContext* c, whKeyId key_id,
+        uint8_t enc, uint8_t iv_len, uint8_t tag_len, int32_t* out_rc,
+        uint16_t* out_handle);
+
+/**
+ * @brief Prepares ECDSA signing with a private key from the keystore.
+ *
+ * @param[in] c Pointer to the client context.
+ * @param[in] key_id Keystore id of the ECC key.
+ * @param[in] curve_id wolfCrypt curve id of the key.
+ * @return int Returns 0 on success, or a negative error code on failure.
+ */
+int wh_Client_PrepareEccSignRequest(whClientContext* c, whKeyId key_id,
+        int32_t curve_id);
+int wh_Client_PrepareEccSign(whClientContext* c, whKeyId key_id,
+        int32_t curve_id, int32_t* out_rc, uint16_t* out_handle);
+
+/**
+ * @brief Receives the response to either Prepare request.
+ *
+ * @param[in] c Pointer to the client context.
+ * @param[out] out_rc Pointer to store the return code from the server.
+ * @param[out] out_handle Pointer to store the operation handle.
+ * @return int Returns 0 on success, WH_ERROR_NOTREADY if no response has been
+ *         received, or a negative error code on failure.
+ */
+int wh_Client_PrepareResponse(whClientContext* c, int32_t* out_rc,
+        uint16_t* out_handle);
+
+/**
+ * @brief Runs a prepared operation on inline data.  For AES-GCM iv and aad
+ * are required as prepared, and tag is the expected tag when decrypting.
+ * For ECDSA signing in is the hash and the other inputs are unused.
+ *
+ * @param[in] c Pointer to the client context.
+ * @param[in] handle Handle returned by Prepare.
+ * @param[in] iv IV, may be NULL if iv_len is 0.
+ * @param[in] iv_len Length of iv, which must match the prepared length.
+ * @param[in] aad Additional authenticated data, may be NULL if aad_len is 0.
+ * @param[in] aad_len Length of aad in bytes.
+ * @param[in] in Input data, may be NULL if in_len is 0.
+ * @param[in] in_len Length of in in bytes.
+ * @param[in] tag Expected tag, may be NULL if tag_len is 0.
+ * @param[in] tag_len Length of tag, which must match the prepared length
+ *            when decrypting and be 0 otherwise.  The sum of all lengths
+ *            must not exceed WH_MESSAGE_PREPARED_MAX_INLINE_LEN.
+ * @return int Returns 0 on success, or a negative error code on failure.
+ */
+int wh_Client_PreparedExecRequest(whClientContext* c, uint16_t handle,
+        const uint8_t* iv, uint16_t iv_len, const uint8_t* aad,
+        uint16_t aad_len, const uint8_t* in, uint16_t in_len,
+        const uint8_t* tag, uint16_t tag_len);
+
+/**
+ * @brief Receives the response to an Exec request.  AES-GCM encryption
+ * returns the ciphertext followed by the tag, decryption the plaintext and
+ * ECDSA signing the DER encoded signature.
+ *
+ * @param[in] c Pointer to the client context.
+ * @param[out] out_rc Pointer to store the return code from the server.
+ * @param[out] out Buffer to store the output data.
+ * @param[in,out] inout_out_len Size of out on input, output length on
+ *                output.
+ * @return int Returns 0 on success, WH_ERROR_NOTREADY if no response has been
+ *         received, or a negative error code on failure.
+ */
+int wh_Client_PreparedExecResponse(whClientContext* c, int32_t* out_rc,
+        uint8_t* out, uint16_t* inout_out_len);
+int wh_Client_PreparedExec(whClientContext* c, uint16_t handle,
+        const uint8_t* iv, uint16_t iv_len, const uint8_t* aad,
+        uint16_t aad_len, const uint8_t* in, uint16_t in_len,
+        const uint8_t* tag, uint16_t tag_len, uint8_t* out,
+        uint16_t* inout_out_len, int32_t* out_rc);
+
+/**
+ * @brief Releases a prepared operation and its server-resident context.
+ *
+ * @param[in] c Pointer to the client context.
+ * @param[in] handle Handle returned by Prepare.
+ * @return int Returns 0 on success, or a negative error code on failure.
+ */
+int wh_Client_PreparedCloseRequest(whClientContext* c, uint16_t handle);
+int wh_Client_PreparedCloseResponse(whClientContext* c, int32_t* out_rc);
+int wh_Client_PreparedClose(whClientContext* c, uint16_t handle,
+        int32_t* out_rc);
+
+#endif /* WOLFHSM_WH_CLIENT_PREPARED_H_ */
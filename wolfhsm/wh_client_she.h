@@ -48,6 +48,17 @@ int wh_Client_SheLoadKeyResponse(whClientContext* c, uint8_t* messageFour,
 int wh_Client_SheLoadKey(whClientContext* c, uint8_t* messageOne,
     uint8_t* messageTwo, uint8_t* messageThree, uint8_t* messageFour,
     uint8_t* messageFive);
+/* Load count update sets in one request.  Each message argument holds count
+ * messages back to back, so messageTwo is count * WOLFHSM_SHE_M2_SZ bytes.
+ * The server checks every set before writing any key and commits all of the
+ * NVM keys together, so either all keys are updated or none are */
+int wh_Client_SheLoadKeyBatchRequest(whClientContext* c, uint32_t count,
+    uint8_t* messageOne, uint8_t* messageTwo, uint8_t* messageThree);
+int wh_Client_SheLoadKeyBatchResponse(whClientContext* c, uint32_t count,
+    uint8_t* messageFour, uint8_t* messageFive);
+int wh_Client_SheLoadKeyBatch(whClientContext* c, uint32_t count,
+    uint8_t* messageOne, uint8_t* messageTwo, uint8_t* messageThree,
+    uint8_t* messageFour, uint8_t* messageFive);
 int wh_Client_SheLoadPlainKeyRequest(whClientContext* c, uint8_t* key,
     uint32_t keySz);
 int wh_Client_SheLoadPlainKeyResponse(whClientContext* c);
@@ -83,15 +83,43 @@ typedef struct {
 
 enum {
     WH_COMM_AUX_REQ_NORMAL      = 0x0000, /* Normal request. No session */
-    /* Request Aux values 1-0xFFFE are session ids */
+    /* Request Aux values 1-0xFFFD are session ids */
+    WH_COMM_AUX_REQ_TIMING      = 0xFFFE, /* Normal request. Append server
+                                           * timing to the response */
     WH_COMM_AUX_REQ_NORESP      = 0xFFFF, /* Async request without response*/
 
     WH_COMM_AUX_RESP_OK         = 0x0000, /* Response is valid */
     WH_COMM_AUX_RESP_ERROR      = 0x0001, /* Request failed with error */
+    WH_COMM_AUX_RESP_TIMING     = 0x0002, /* Response is valid, and its data
+                                           * ends with a whCommTiming */
     WH_COMM_AUX_RESP_FATAL      = 0xFFFE, /* Server condition is fatal */
     WH_COMM_AUX_RESP_UNSUPP     = 0xFFFF, /* Request is not supported */
 };
 
+/* Server time spent on a request, in microseconds.  Appended to the response
+ * data when the request asks for it and the server has a time source.
+ * On-the-wire format */
+typedef struct {
+    uint32_t recv_to_dispatch;  /* Received until the handler started */
+    uint32_t dispatch_to_send;  /* Handler start until the response was sent */
+} whCommTiming;
+
+/* Monotonic time source in microseconds */
+typedef uint64_t (*whCommTimeCb)(void* context);
+
+/* Direction of a packet passed to a capture callback */
+typedef enum {
+    WH_COMM_CAPTURE_REQUEST = 0,
+    WH_COMM_CAPTURE_RESPONSE = 1,
+} whCommCaptureDir;
+
+/* Observe each request as it is received and each response as it is sent.
+ * data holds size bytes of message data, without the header or any timing
+ * trailer.  The return value is ignored so capture never affects service */
+typedef int (*whCommCaptureCb)(void* context, whCommCaptureDir dir,
+        uint16_t magic, uint16_t kind, uint16_t seq, uint16_t size,
+        const void* data);
+
 /** Data translations */
 uint8_t wh_Translate8(uint16_t magic, uint8_t val);
 uint16_t wh_Translate16(uint16_t magic, uint16_t val);
@@ -159,7 +187,8 @@ typedef struct {
     const void* transport_config;
     whCommSetConnectedCb connect_cb;
     uint8_t client_id;
-    uint8_t pad[7];
+    uint8_t request_timing;     /* Ask the server for whCommTiming */
+    uint8_t pad[6];
 } whCommClientConfig;
 
 /* Context structure for a client.  Note the client context will track the
@@ -172,13 +201,16 @@ typedef struct {
     whCommSetConnectedCb connect_cb;
     whCommHeader* hdr;
     uint8_t* data;
+    whCommTiming server_timing; /* From the last response, if valid */
     int initialized;
     uint16_t reqid;
     uint16_t seq;
     uint16_t size;
     uint8_t client_id;
     uint8_t server_id;
-    uint8_t pad[4];
+    uint8_t request_timing;
+    uint8_t server_timing_valid;
+    uint8_t pad[2];
 } whCommClient;
 
 
@@ -206,6 +238,17 @@ int wh_CommClient_RecvResponse(whCommClient* context,
  */
 uint8_t* wh_CommClient_GetDataPtr(whCommClient* context);
 
+/* Enable or disable asking the server for whCommTiming on later requests.
+ * The trailer is removed from the response data before it is returned.
+ */
+int wh_CommClient_SetTiming(whCommClient* context, int enable);
+
+/* Get the server timing carried by the last response.  Returns
+ * WH_ERROR_NOTFOUND if that response did not include it.
+ */
+int wh_CommClient_GetServerTiming(whCommClient* context,
+        whCommTiming* out_timing);
+
 /* Inform the server that no further communications are necessary and any
  * unfinished requests can be ignored.
  */
@@ -245,12 +288,26 @@ typedef struct {
      *          WH_ERROR_BADARGS if NULL context
      */
     int (*Cleanup)(void* context);
+
+    /* Optional. Resolve a client-supplied offset and size within a shared
+     * bulk data region to a server pointer.
+     * Returns: 0 on success,
+     *          WH_ERROR_BADARGS if NULL context or out_ptr
+     *          WH_ERROR_NOHANDLER if the transport has no bulk region
+     *          WH_ERROR_ACCESS if the range is outside the region
+     */
+    int (*GetBulk)(void* context, uint32_t offset, uint32_t size,
+            void** out_ptr);
 } whTransportServerCb;
 
 typedef struct {
     void* transport_context;
     const whTransportServerCb* transport_cb;
     const void* transport_config;
+    whCommTimeCb time_cb;       /* Optional, to answer timing requests */
+    void* time_context;
+    whCommCaptureCb capture_cb; /* Optional, to record traffic */
+    void* capture_context;
     uint8_t server_id;
     uint8_t pad[7];
 } whCommServerConfig;
@@ -264,10 +321,21 @@ typedef struct {
     const whTransportServerCb* transport_cb;
     whCommHeader* hdr;
     uint8_t* data;
+    whCommTimeCb time_cb;
+    void* time_context;
+    whCommCaptureCb capture_cb;
+    void* capture_context;
+    uint64_t recv_time;
+    uint64_t dispatch_time;
     int initialized;
     uint16_t reqid;
     uint8_t client_id;
     uint8_t server_id;
+    uint8_t timing;             /* Current request asked for timing */
+    uint8_t req_open;           /* Request received but not yet answered */
+    uint16_t req_kind;          /* Kind and seq of the open request */
+    uint16_t req_seq;
+    uint8_t pad[2];
 } whCommServer;
 
 /* Reset the state of the server context and begin the connection to a client
@@ -297,6 +365,19 @@ int wh_CommServer_SendResponse(whCommServer* context,
  */
 uint8_t* wh_CommServer_GetDataPtr(whCommServer* context);
 
+/* Note that the handler for the current request is starting.  Time between
+ * receipt and this point, and from here until the response is sent, is
+ * reported to clients that request timing.
+ */
+int wh_CommServer_MarkDispatch(whCommServer* context);
+
+
+/* Resolve an offset and size in the transport's shared bulk data region to a
+ * pointer the server can read and write in place. Returns WH_ERROR_NOHANDLER
+ * if the transport does not provide a bulk region.
+ */
+int wh_CommServer_GetBulk(whCommServer* context, uint32_t offset,
+        uint32_t size, void** out_ptr);
 
 int wh_CommServer_Cleanup(whCommServer* context);
 
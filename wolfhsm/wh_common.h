@@ -39,8 +39,28 @@ enum {
     WOLFHSM_NUM_NVMOBJECTS = 32,    /* Number of NVM objects in the directory */
     WOLFHSM_NUM_MANIFESTS = 8,      /* Number of compiletime manifests */
     WOLFHSM_KEYCACHE_BUFSIZE = 1200, /* Size in bytes of key cache buffer  */
+    WOLFHSM_NUM_PKCS11_SESSIONS = 4, /* Number of open PKCS11 sessions */
+    WOLFHSM_NUM_PKCS11_OBJECTS = 64, /* PKCS11 handles, MUST be a power of 2 */
+    WOLFHSM_NUM_CERT_CACHE = 4,     /* Number of parsed trust anchors kept */
+    WOLFHSM_CERT_PUBKEY_MAX = 600,  /* Max DER public key of a trust anchor */
+    WOLFHSM_CERT_MAX_SIZE = 2048,   /* Max DER size of a trust anchor */
+    WOLFHSM_CERT_MAX_CHAIN = 8,     /* Max certificates in a verified chain */
+    WOLFHSM_NUM_ECC_VERIFY_CACHE = 4, /* Imported ECC verifier keys kept */
+    WOLFHSM_NUM_CHACHA_SESSIONS = 2, /* Streaming ChaCha20-Poly1305 ops */
+    WOLFHSM_CHACHA_DMA_WINDOW = 65536, /* Max bytes mapped per ChaCha DMA op */
+    WOLFHSM_NUM_PREPARED_OPS = 4,   /* Keyed crypto contexts held by handle */
+    WOLFHSM_IMAGE_DMA_WINDOW = 65536, /* Max bytes mapped per image DMA op */
+    WOLFHSM_IMAGE_MAX_SIG_LEN = 256, /* Max image signature held by server */
+    WOLFHSM_KEYWRAP_MAX_KEYS = 16,  /* Max keys carried in one wrapped blob */
 };
 
+/* Size of each of the two server staging buffers a DMA copy engine copies
+ * through.  Larger stages mean fewer engine submissions per transfer.  Keep
+ * it a multiple of 8 */
+#ifndef WOLFHSM_DMA_STAGE_LEN
+#define WOLFHSM_DMA_STAGE_LEN 4096
+#endif
+
 
 /** Non-volatile counters */
 
@@ -115,6 +135,25 @@ typedef struct {
 } whNvmMetadata;
 /* static_assert(sizeof(whNvmMetadata) == WOLFHSM_NVM_METADATA_LEN) */
 
+/* Selects objects by metadata for wh_Nvm_DestroyMatching.  An object matches
+ * when all of the following hold:
+ *   id_first <= id <= id_last
+ *   (id & id_mask) == id_match
+ *   (access & access_mask) == access_match
+ *   (flags & flags_mask) == flags_match
+ * A zero mask matches any value, so an id range of [1, 0xFFFF] with all
+ * masks zero selects every object. */
+typedef struct {
+    whNvmId id_first;
+    whNvmId id_last;
+    whNvmId id_mask;
+    whNvmId id_match;
+    whNvmAccess access_mask;
+    whNvmAccess access_match;
+    whNvmFlags flags_mask;
+    whNvmFlags flags_match;
+} whNvmFilter;
+
 
 /* Custom request shared defs */
 #define WH_CUSTOM_CB_NUM_CALLBACKS 8
@@ -126,12 +165,19 @@ typedef struct {
 #define WOLFHSM_SHE_BOOT_MAC 3
 #define WOLFHSM_SHE_RAM_KEY_ID 14
 #define WOLFHSM_SHE_PRNG_SEED_ID 15
+/* Key ids are 4 bits, so every slot fits in a direct-indexed table */
+#define WOLFHSM_SHE_NUM_SLOTS 16
 
 #define WOLFHSM_SHE_KEY_SZ 16
 #define WOLFHSM_SHE_UID_SZ 15
 
 #define WOLFHSM_SHE_BOOT_MAC_PREFIX_LEN 12
 
+/* Most M1/M2/M3 update sets in one WH_SHE_LOAD_KEY_BATCH request */
+#ifndef WOLFHSM_SHE_LOAD_KEY_BATCH_MAX
+#define WOLFHSM_SHE_LOAD_KEY_BATCH_MAX 8
+#endif
+
 #define WOLFHSM_SHE_M1_SZ 16
 #define WOLFHSM_SHE_M2_SZ 32
 #define WOLFHSM_SHE_M3_SZ WOLFHSM_SHE_M1_SZ
@@ -47,6 +47,14 @@ enum {
     /* Custom-callback status returns */
     WH_ERROR_NOHANDLER     = -420, /* No handler registered for action */
 
+    /* PKCS11-specific status returns */
+    WH_ERROR_BADHANDLE      = -430, /* Session or object handle is not valid */
+    WH_ERROR_OPACTIVE       = -431, /* Another operation is active */
+    WH_ERROR_NOTINIT        = -432, /* Operation was not initialized */
+
+    /* Certificate-specific status returns */
+    WH_ERROR_CERTVERIFY     = -440, /* Certificate chain did not verify */
+
     WH_SHE_ERC_SEQUENCE_ERROR = -500,
     WH_SHE_ERC_KEY_NOT_AVAILABLE = -501,
     WH_SHE_ERC_KEY_INVALID = -502,
@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) 2024 wolfSSL Inc.
+ *
+ * This file is part of wolfHSM.
+ *
+ * wolfHSM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfHSM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wolfHSM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * wolfhsm/wh_lock.h
+ *
+ * Abstract library to provide platform reader-writer locking.  A whLock with
+ * no callbacks is a no-op, which is the default for single-threaded builds.
+ *
+ */
+
+#ifndef WOLFHSM_WH_LOCK_H_
+#define WOLFHSM_WH_LOCK_H_
+
+#include <stdint.h>
+
+typedef struct {
+    int (*Init)(void* context, const void* config);
+    int (*Cleanup)(void* context);
+
+    /* Shared access.  Any number of readers may hold the lock at once */
+    int (*ReadLock)(void* context);
+    int (*ReadUnlock)(void* context);
+
+    /* Exclusive access.  Excludes readers and other writers */
+    int (*WriteLock)(void* context);
+    int (*WriteUnlock)(void* context);
+} whLockCb;
+
+/* Lock instance.  cb == NULL means no locking */
+typedef struct whLock_t {
+    const whLockCb* cb;
+    void* context;
+} whLock;
+
+/* Lock configuration.  Pass a NULL config to wh_Lock_Init for no locking */
+typedef struct whLockConfig_t {
+    const whLockCb* cb;
+    void* context;
+    const void* config;     /* Passed to cb->Init */
+} whLockConfig;
+
+int wh_Lock_Init(whLock* lock, const whLockConfig* config);
+int wh_Lock_Cleanup(whLock* lock);
+
+int wh_Lock_AcquireRead(whLock* lock);
+int wh_Lock_ReleaseRead(whLock* lock);
+int wh_Lock_AcquireWrite(whLock* lock);
+int wh_Lock_ReleaseWrite(whLock* lock);
+
+#endif /* WOLFHSM_WH_LOCK_H_ */
@@ -39,6 +39,10 @@ enum {
     WH_MESSAGE_GROUP_IMAGE          = 0x0500, /* Image/boot management */
     WH_MESSAGE_GROUP_PKCS11         = 0x0600, /* PKCS11 protocol */
     WH_MESSAGE_GROUP_SHE            = 0x0700, /* SHE protocol */
+    WH_MESSAGE_GROUP_CERT           = 0x0800, /* Certificate chain verify */
+    WH_MESSAGE_GROUP_KEYWRAP        = 0x0900, /* Wrapped bulk key transfer */
+    WH_MESSAGE_GROUP_CHACHA         = 0x0A00, /* ChaCha20-Poly1305 AEAD */
+    WH_MESSAGE_GROUP_PREPARED       = 0x0B00, /* Prepared crypto operations */
     WH_MESSAGE_GROUP_CUSTOM         = 0x1000, /* User-specified features */
 
     WH_MESSAGE_ACTION_MASK         = 0x00FF,  /* 255 subtypes per group*/
@@ -73,6 +77,7 @@ enum {
     WH_SHE_DEC_CBC,
     WH_SHE_GEN_MAC,
     WH_SHE_VERIFY_MAC,
+    WH_SHE_LOAD_KEY_BATCH,
 };
 
 /* Construct the message kind based on group and action */
@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2024 wolfSSL Inc.
+ *
+ * This file is part of wolfHSM.
+ *
+ * wolfHSM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfHSM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wolfHSM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * wolfhsm/wh_message_cert.h
+ *
+ * Certificate message group.  A client sends a leaf certificate followed by
+ * its intermediates as concatenated DER, either inline or by DMA, and the
+ * server verifies the whole chain against a trust anchor stored as an NVM
+ * object in a single round trip.
+ */
+
+#ifndef WOLFHSM_WH_MESSAGE_CERT_H_
+#define WOLFHSM_WH_MESSAGE_CERT_H_
+
+#include <stdint.h>
+#include "wolfhsm/wh_common.h"
+#include "wolfhsm/wh_comm.h"
+#include "wolfhsm/wh_message.h"
+
+enum {
+    WH_MESSAGE_CERT_ACTION_VERIFY           = 0x1,
+    WH_MESSAGE_CERT_ACTION_VERIFYDMA32      = 0x2,
+    WH_MESSAGE_CERT_ACTION_VERIFYDMA64      = 0x3,
+};
+
+/** Cert Verify Request */
+typedef struct {
+    whNvmId  trusted_id;    /* NVM id of the DER trust anchor */
+    uint16_t chain_len;     /* Bytes of DER following this header */
+} whMessageCert_VerifyRequest;
+/* Followed by chain_len bytes of DER: leaf first, then intermediates */
+
+enum {
+    /* Max inline chain carried by a Verify request */
+    WH_MESSAGE_CERT_MAX_CHAIN_LEN =
+            WH_COMM_DATA_LEN - sizeof(whMessageCert_VerifyRequest),
+};
+
+int wh_MessageCert_TranslateVerifyRequest(uint16_t magic,
+        const whMessageCert_VerifyRequest* src,
+        whMessageCert_VerifyRequest* dest);
+
+/** Cert Verify Response */
+typedef struct {
+    int32_t  rc;
+    uint16_t depth;         /* Number of certificates that verified */
+    uint8_t  padding[2];
+} whMessageCert_VerifyResponse;
+
+int wh_MessageCert_TranslateVerifyResponse(uint16_t magic,
+        const whMessageCert_VerifyResponse* src,
+        whMessageCert_VerifyResponse* dest);
+
+/** Cert VerifyDma32 Request */
+typedef struct {
+    uint32_t chain_hostaddr;
+    uint32_t chain_len;
+    whNvmId  trusted_id;
+    uint8_t  padding[2];
+} whMessageCert_VerifyDma32Request;
+
+int wh_MessageCert_TranslateVerifyDma32Request(uint16_t magic,
+        const whMessageCert_VerifyDma32Request* src,
+        whMessageCert_VerifyDma32Request* dest);
+
+/** Cert VerifyDma32 Response */
+/* Use VerifyResponse */
+
+/** Cert VerifyDma64 Request */
+typedef struct {
+    uint64_t chain_hostaddr;
+    uint32_t chain_len;
+    whNvmId  trusted_id;
+    uint8_t  padding[2];
+} whMessageCert_VerifyDma64Request;
+
+int wh_MessageCert_TranslateVerifyDma64Request(uint16_t magic,
+        const whMessageCert_VerifyDma64Request* src,
+        whMessageCert_VerifyDma64Request* dest);
+
+/** Cert VerifyDma64 Response */
+/* Use VerifyResponse */
+
+#endif /* WOLFHSM_WH_MESSAGE_CERT_H_ */
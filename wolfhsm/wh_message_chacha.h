@@ -0,0 +1,184 @@
+/*
+ * Copyright (C) 2024 wolfSSL Inc.
+ *
+ * This file is part of wolfHSM.
+ *
+ * wolfHSM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfHSM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wolfHSM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * wolfhsm/wh_message_chacha.h
+ *
+ * ChaCha20-Poly1305 message group.  Messages carry no key material: every
+ * operation names a 256-bit key held in the keystore.  Crypt processes AAD
+ * and data carried inline in one request.  Init, Update and Final stream a
+ * longer message through a session held by the server.  CryptDma reads the
+ * AAD and input from client memory and writes the output back by DMA.
+ *
+ * When decrypting with Update or CryptDma, plaintext is released before the
+ * tag has been checked.  It must be discarded unless Final or CryptDma
+ * report success.
+ */
+
+#ifndef WOLFHSM_WH_MESSAGE_CHACHA_H_
+#define WOLFHSM_WH_MESSAGE_CHACHA_H_
+
+#include <stdint.h>
+#include "wolfhsm/wh_common.h"
+#include "wolfhsm/wh_comm.h"
+#include "wolfhsm/wh_message.h"
+
+enum {
+    WH_MESSAGE_CHACHA_ACTION_CRYPT          = 0x1,
+    WH_MESSAGE_CHACHA_ACTION_INIT           = 0x2,
+    WH_MESSAGE_CHACHA_ACTION_UPDATE         = 0x3,
+    WH_MESSAGE_CHACHA_ACTION_FINAL          = 0x4,
+    WH_MESSAGE_CHACHA_ACTION_CRYPTDMA       = 0x5,
+};
+
+enum {
+    WH_CHACHA_KEY_LEN   = 32,
+    WH_CHACHA_IV_LEN    = 12,
+    WH_CHACHA_TAG_LEN   = 16,
+};
+
+/** ChaCha Crypt Request */
+typedef struct {
+    whKeyId  key_id;        /* Keystore id of the 256-bit key */
+    uint16_t aad_len;       /* Bytes of AAD following this header */
+    uint16_t data_len;      /* Bytes of input following the AAD */
+    uint8_t  enc;           /* 1 to encrypt, 0 to decrypt */
+    uint8_t  padding[1];
+    uint8_t  iv[WH_CHACHA_IV_LEN];
+    uint8_t  tag[WH_CHACHA_TAG_LEN];    /* Expected tag when decrypting */
+} whMessageChaCha_CryptRequest;
+/* Followed by aad_len bytes of AAD and data_len bytes of input */
+
+enum {
+    /* Max AAD plus data carried by a Crypt or Update request */
+    WH_MESSAGE_CHACHA_MAX_INLINE_LEN =
+            WH_COMM_DATA_LEN - sizeof(whMessageChaCha_CryptRequest),
+};
+
+int wh_MessageChaCha_TranslateCryptRequest(uint16_t magic,
+        const whMessageChaCha_CryptRequest* src,
+        whMessageChaCha_CryptRequest* dest);
+
+/** ChaCha Crypt Response */
+typedef struct {
+    int32_t  rc;
+    uint16_t data_len;      /* Bytes of output following this header */
+    uint8_t  padding[2];
+    uint8_t  tag[WH_CHACHA_TAG_LEN];    /* Computed tag when encrypting */
+} whMessageChaCha_CryptResponse;
+/* Followed by data_len bytes of output */
+
+int wh_MessageChaCha_TranslateCryptResponse(uint16_t magic,
+        const whMessageChaCha_CryptResponse* src,
+        whMessageChaCha_CryptResponse* dest);
+
+/** ChaCha Init Request */
+typedef struct {
+    whKeyId  key_id;        /* Keystore id of the 256-bit key */
+    uint8_t  enc;           /* 1 to encrypt, 0 to decrypt */
+    uint8_t  padding[1];
+    uint8_t  iv[WH_CHACHA_IV_LEN];
+} whMessageChaCha_InitRequest;
+
+int wh_MessageChaCha_TranslateInitRequest(uint16_t magic,
+        const whMessageChaCha_InitRequest* src,
+        whMessageChaCha_InitRequest* dest);
+
+/** ChaCha Init Response */
+typedef struct {
+    int32_t  rc;
+    uint16_t session;       /* Handle passed to Update and Final */
+    uint8_t  padding[2];
+} whMessageChaCha_InitResponse;
+
+int wh_MessageChaCha_TranslateInitResponse(uint16_t magic,
+        const whMessageChaCha_InitResponse* src,
+        whMessageChaCha_InitResponse* dest);
+
+/** ChaCha Update Request */
+typedef struct {
+    uint16_t session;
+    uint16_t aad_len;       /* Bytes of AAD following this header */
+    uint16_t data_len;      /* Bytes of input following the AAD */
+    uint8_t  padding[2];
+} whMessageChaCha_UpdateRequest;
+/* Followed by aad_len bytes of AAD and data_len bytes of input.  All AAD
+ * must be sent before the first data */
+
+int wh_MessageChaCha_TranslateUpdateRequest(uint16_t magic,
+        const whMessageChaCha_UpdateRequest* src,
+        whMessageChaCha_UpdateRequest* dest);
+
+/** ChaCha Update Response */
+typedef struct {
+    int32_t  rc;
+    uint16_t data_len;      /* Bytes of output following this header */
+    uint8_t  padding[2];
+} whMessageChaCha_UpdateResponse;
+/* Followed by data_len bytes of output */
+
+int wh_MessageChaCha_TranslateUpdateResponse(uint16_t magic,
+        const whMessageChaCha_UpdateResponse* src,
+        whMessageChaCha_UpdateResponse* dest);
+
+/** ChaCha Final Request */
+typedef struct {
+    uint16_t session;
+    uint8_t  padding[2];
+    uint8_t  tag[WH_CHACHA_TAG_LEN];    /* Expected tag when decrypting */
+} whMessageChaCha_FinalRequest;
+
+int wh_MessageChaCha_TranslateFinalRequest(uint16_t magic,
+        const whMessageChaCha_FinalRequest* src,
+        whMessageChaCha_FinalRequest* dest);
+
+/** ChaCha Tag Response */
+typedef struct {
+    int32_t  rc;
+    uint8_t  tag[WH_CHACHA_TAG_LEN];    /* Computed tag when encrypting */
+} whMessageChaCha_TagResponse;
+
+int wh_MessageChaCha_TranslateTagResponse(uint16_t magic,
+        const whMessageChaCha_TagResponse* src,
+        whMessageChaCha_TagResponse* dest);
+
+/** ChaCha Final Response */
+/* Use TagResponse */
+
+/** ChaCha CryptDma Request */
+typedef struct {
+    uint64_t aad_hostaddr;
+    uint64_t in_hostaddr;
+    uint64_t out_hostaddr;  /* May equal in_hostaddr to process in place */
+    uint32_t aad_len;
+    uint32_t data_len;
+    whKeyId  key_id;        /* Keystore id of the 256-bit key */
+    uint8_t  enc;           /* 1 to encrypt, 0 to decrypt */
+    uint8_t  padding[1];
+    uint8_t  iv[WH_CHACHA_IV_LEN];
+    uint8_t  tag[WH_CHACHA_TAG_LEN];    /* Expected tag when decrypting */
+} whMessageChaCha_CryptDmaRequest;
+
+int wh_MessageChaCha_TranslateCryptDmaRequest(uint16_t magic,
+        const whMessageChaCha_CryptDmaRequest* src,
+        whMessageChaCha_CryptDmaRequest* dest);
+
+/** ChaCha CryptDma Response */
+/* Use TagResponse */
+
+#endif /* WOLFHSM_WH_MESSAGE_CHACHA_H_ */
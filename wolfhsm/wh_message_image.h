@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) 2024 wolfSSL Inc.
+ *
+ * This file is part of wolfHSM.
+ *
+ * wolfHSM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfHSM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wolfHSM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * wolfhsm/wh_message_image.h
+ *
+ * Image message group.  The server reads a firmware image directly from
+ * client memory by DMA, hashes it and checks a signature over the digest
+ * with a key held in the keystore.  Large images may be processed over
+ * several requests, each bounded by a slice length, so the server is never
+ * occupied for longer than one time slice.
+ */
+
+#ifndef WOLFHSM_WH_MESSAGE_IMAGE_H_
+#define WOLFHSM_WH_MESSAGE_IMAGE_H_
+
+#include <stdint.h>
+#include "wolfhsm/wh_common.h"
+#include "wolfhsm/wh_comm.h"
+#include "wolfhsm/wh_message.h"
+
+enum {
+    WH_MESSAGE_IMAGE_ACTION_VERIFYDMA32     = 0x1,
+    WH_MESSAGE_IMAGE_ACTION_VERIFYDMA64     = 0x2,
+    WH_MESSAGE_IMAGE_ACTION_CONTINUE        = 0x3,
+};
+
+/* Digest used over the image */
+enum {
+    WH_IMAGE_HASH_SHA256 = 1,
+    WH_IMAGE_HASH_SHA384 = 2,
+};
+
+enum {
+    /* Largest digest returned in a response */
+    WH_MESSAGE_IMAGE_MAX_DIGEST_LEN = 48,
+    /* Largest signature carried by a verify request */
+    WH_MESSAGE_IMAGE_MAX_SIG_LEN = WOLFHSM_IMAGE_MAX_SIG_LEN,
+};
+
+/** Image VerifyDma32 Request */
+typedef struct {
+    uint32_t image_hostaddr;
+    uint32_t image_len;
+    uint32_t slice_len;     /* Max bytes to hash per request, 0 for all */
+    whKeyId  key_id;        /* ECC public key in the keystore */
+    uint16_t curve_id;      /* wolfCrypt ecc_curve_id of key_id */
+    uint16_t sig_len;       /* Bytes of DER signature following header */
+    uint8_t  hash_type;     /* WH_IMAGE_HASH_* */
+    uint8_t  padding[1];
+} whMessageImage_VerifyDma32Request;
+
+int wh_MessageImage_TranslateVerifyDma32Request(uint16_t magic,
+        const whMessageImage_VerifyDma32Request* src,
+        whMessageImage_VerifyDma32Request* dest);
+
+/** Image VerifyDma32 Response */
+/* Use VerifyResponse */
+
+/** Image VerifyDma64 Request */
+typedef struct {
+    uint64_t image_hostaddr;
+    uint32_t image_len;
+    uint32_t slice_len;     /* Max bytes to hash per request, 0 for all */
+    whKeyId  key_id;        /* ECC public key in the keystore */
+    uint16_t curve_id;      /* wolfCrypt ecc_curve_id of key_id */
+    uint16_t sig_len;       /* Bytes of DER signature following header */
+    uint8_t  hash_type;     /* WH_IMAGE_HASH_* */
+    uint8_t  padding[1];
+} whMessageImage_VerifyDma64Request;
+
+int wh_MessageImage_TranslateVerifyDma64Request(uint16_t magic,
+        const whMessageImage_VerifyDma64Request* src,
+        whMessageImage_VerifyDma64Request* dest);
+
+/** Image VerifyDma64 Response */
+/* Use VerifyResponse */
+
+/** Image Continue Request */
+typedef struct {
+    uint32_t slice_len;     /* Max bytes to hash in this request, 0 for all */
+} whMessageImage_ContinueRequest;
+
+int wh_MessageImage_TranslateContinueRequest(uint16_t magic,
+        const whMessageImage_ContinueRequest* src,
+        whMessageImage_ContinueRequest* dest);
+
+/** Image Verify Response */
+typedef struct {
+    int32_t  rc;
+    uint32_t offset;        /* Bytes of the image hashed so far */
+    uint8_t  done;          /* 1 once the whole image has been hashed */
+    uint8_t  verified;      /* 1 if done and the signature matched */
+    uint16_t digest_len;    /* Valid bytes of digest once done */
+    uint8_t  digest[WH_MESSAGE_IMAGE_MAX_DIGEST_LEN];
+} whMessageImage_VerifyResponse;
+
+int wh_MessageImage_TranslateVerifyResponse(uint16_t magic,
+        const whMessageImage_VerifyResponse* src,
+        whMessageImage_VerifyResponse* dest);
+
+#endif /* WOLFHSM_WH_MESSAGE_IMAGE_H_ */
@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) 2024 wolfSSL Inc.
+ *
+ * This file is part of wolfHSM.
+ *
+ * wolfHSM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfHSM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wolfHSM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * wolfhsm/wh_message_keywrap.h
+ *
+ * Wrapped bulk key message group.  Export streams the client's committed
+ * keys out of NVM as blobs encrypted with AES-GCM under a key encryption key
+ * (KEK) held in the keystore, resuming from a cursor on each request.
+ * Import authenticates and decrypts a blob under the same KEK and adds every
+ * key it carries to NVM together.
+ *
+ * A blob is opaque to the client and is laid out as:
+ *   header (version, reserved, record count)  - authenticated, not encrypted
+ *   IV
+ *   authentication tag
+ *   records, encrypted: each is a record header followed by the key data
+ * Multi-byte fields within a blob are little endian so blobs can move
+ * between servers of different endianness.
+ */
+
+#ifndef WOLFHSM_WH_MESSAGE_KEYWRAP_H_
+#define WOLFHSM_WH_MESSAGE_KEYWRAP_H_
+
+#include <stdint.h>
+#include "wolfhsm/wh_common.h"
+#include "wolfhsm/wh_comm.h"
+#include "wolfhsm/wh_message.h"
+
+enum {
+    WH_MESSAGE_KEYWRAP_ACTION_EXPORT        = 0x1,
+    WH_MESSAGE_KEYWRAP_ACTION_IMPORT        = 0x2,
+};
+
+enum {
+    WH_KEYWRAP_BLOB_VERSION     = 1,
+    WH_KEYWRAP_BLOB_HDR_LEN     = 4,
+    WH_KEYWRAP_BLOB_IV_LEN      = 12,
+    WH_KEYWRAP_BLOB_TAG_LEN     = 16,
+    /* Total non-record bytes in a blob */
+    WH_KEYWRAP_BLOB_OVERHEAD    = WH_KEYWRAP_BLOB_HDR_LEN +
+            WH_KEYWRAP_BLOB_IV_LEN + WH_KEYWRAP_BLOB_TAG_LEN,
+    /* id, access, flags, len, label */
+    WH_KEYWRAP_RECORD_HDR_LEN   = 8 + WOLFHSM_NVM_LABEL_LEN,
+};
+
+/** KeyWrap Export Request */
+typedef struct {
+    whKeyId  kek_id;        /* Keystore id of the AES KEK */
+    whNvmId  cursor;        /* 0 to start, else next_cursor from last reply */
+    uint16_t max_len;       /* Largest blob the client will accept */
+    uint8_t  padding[2];
+} whMessageKeyWrap_ExportRequest;
+
+int wh_MessageKeyWrap_TranslateExportRequest(uint16_t magic,
+        const whMessageKeyWrap_ExportRequest* src,
+        whMessageKeyWrap_ExportRequest* dest);
+
+/** KeyWrap Export Response */
+typedef struct {
+    int32_t  rc;
+    whNvmId  next_cursor;   /* Pass back to continue the export */
+    uint16_t count;         /* Keys carried in this blob */
+    uint16_t blob_len;      /* Bytes of blob following this header */
+    uint8_t  done;          /* 1 when no keys remain after this blob */
+    uint8_t  padding[1];
+} whMessageKeyWrap_ExportResponse;
+/* Followed by blob_len bytes of wrapped blob */
+
+enum {
+    /* Max blob carried by an Export response or Import request */
+    WH_MESSAGE_KEYWRAP_MAX_BLOB_LEN =
+            WH_COMM_DATA_LEN - sizeof(whMessageKeyWrap_ExportResponse),
+};
+
+int wh_MessageKeyWrap_TranslateExportResponse(uint16_t magic,
+        const whMessageKeyWrap_ExportResponse* src,
+        whMessageKeyWrap_ExportResponse* dest);
+
+/** KeyWrap Import Request */
+typedef struct {
+    whKeyId  kek_id;        /* Keystore id of the AES KEK */
+    uint16_t blob_len;      /* Bytes of blob following this header */
+} whMessageKeyWrap_ImportRequest;
+/* Followed by blob_len bytes of wrapped blob */
+
+int wh_MessageKeyWrap_TranslateImportRequest(uint16_t magic,
+        const whMessageKeyWrap_ImportRequest* src,
+        whMessageKeyWrap_ImportRequest* dest);
+
+/** KeyWrap Import Response */
+typedef struct {
+    int32_t  rc;
+    uint16_t count;         /* Keys added to NVM */
+    uint8_t  padding[2];
+} whMessageKeyWrap_ImportResponse;
+
+int wh_MessageKeyWrap_TranslateImportResponse(uint16_t magic,
+        const whMessageKeyWrap_ImportResponse* src,
+        whMessageKeyWrap_ImportResponse* dest);
+
+#endif /* WOLFHSM_WH_MESSAGE_KEYWRAP_H_ */
@@ -39,10 +39,13 @@ enum {
     WH_MESSAGE_NVM_ACTION_GETMETADATA       = 0x6,
     WH_MESSAGE_NVM_ACTION_DESTROYOBJECTS    = 0x7,
     WH_MESSAGE_NVM_ACTION_READ              = 0x8,
+    WH_MESSAGE_NVM_ACTION_DESTROYMATCHING   = 0x9,
     WH_MESSAGE_NVM_ACTION_ADDOBJECTDMA32    = 0x14,
     WH_MESSAGE_NVM_ACTION_READDMA32         = 0x18,
     WH_MESSAGE_NVM_ACTION_ADDOBJECTDMA64    = 0x24,
     WH_MESSAGE_NVM_ACTION_READDMA64         = 0x28,
+    WH_MESSAGE_NVM_ACTION_ADDOBJECTBULK     = 0x34,
+    WH_MESSAGE_NVM_ACTION_READBULK          = 0x38,
 };
 
 enum {
@@ -179,6 +182,34 @@ int wh_MessageNvm_TranslateDestroyObjectsRequest(uint16_t magic,
 /** NVM DestroyObjects Response */
 /* Use SimpleResponse */
 
+/** NVM DestroyMatching Request */
+/* Fields mirror whNvmFilter */
+typedef struct {
+    uint16_t id_first;
+    uint16_t id_last;
+    uint16_t id_mask;
+    uint16_t id_match;
+    uint16_t access_mask;
+    uint16_t access_match;
+    uint16_t flags_mask;
+    uint16_t flags_match;
+} whMessageNvm_DestroyMatchingRequest;
+
+int wh_MessageNvm_TranslateDestroyMatchingRequest(uint16_t magic,
+        const whMessageNvm_DestroyMatchingRequest* src,
+        whMessageNvm_DestroyMatchingRequest* dest);
+
+/** NVM DestroyMatching Response */
+typedef struct {
+    int32_t rc;
+    uint16_t count;
+    uint8_t padding[2];
+} whMessageNvm_DestroyMatchingResponse;
+
+int wh_MessageNvm_TranslateDestroyMatchingResponse(uint16_t magic,
+        const whMessageNvm_DestroyMatchingResponse* src,
+        whMessageNvm_DestroyMatchingResponse* dest);
+
 /** NVM Read Request */
 typedef struct {
     uint16_t id;
@@ -262,4 +293,36 @@ int wh_MessageNvm_TranslateReadDma64Request(uint16_t magic,
 /** NVM ReadDma64 Response */
 /* Use SimpleResponse */
 
+/** NVM AddObjectBulk Request */
+/* Offsets are within the transport's shared bulk data region */
+typedef struct {
+    uint32_t metadata_offset;
+    uint32_t data_offset;
+    uint16_t data_len;
+    uint8_t padding[6];
+} whMessageNvm_AddObjectBulkRequest;
+
+int wh_MessageNvm_TranslateAddObjectBulkRequest(uint16_t magic,
+        const whMessageNvm_AddObjectBulkRequest* src,
+        whMessageNvm_AddObjectBulkRequest* dest);
+
+/** NVM AddObjectBulk Response */
+/* Use SimpleResponse */
+
+/** NVM ReadBulk Request */
+typedef struct {
+    uint32_t data_offset;
+    uint16_t id;
+    uint16_t offset;
+    uint16_t data_len;
+    uint8_t padding[6];
+} whMessageNvm_ReadBulkRequest;
+
+int wh_MessageNvm_TranslateReadBulkRequest(uint16_t magic,
+        const whMessageNvm_ReadBulkRequest* src,
+        whMessageNvm_ReadBulkRequest* dest);
+
+/** NVM ReadBulk Response */
+/* Use SimpleResponse */
+
 #endif /* WOLFHSM_WH_MESSAGE_NVM_H_ */
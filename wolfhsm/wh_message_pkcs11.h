@@ -0,0 +1,228 @@
+/*
+ * Copyright (C) 2024 wolfSSL Inc.
+ *
+ * This file is part of wolfHSM.
+ *
+ * wolfHSM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfHSM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wolfHSM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * wolfhsm/wh_message_pkcs11.h
+ *
+ * PKCS11 message group.  Sessions and object handles are held by the server so
+ * that a C_FindObjects loop or a C_SignInit/C_Sign pair costs one round trip
+ * per call with no repeated id resolution.
+ */
+
+#ifndef WOLFHSM_WH_MESSAGE_PKCS11_H_
+#define WOLFHSM_WH_MESSAGE_PKCS11_H_
+
+#include <stdint.h>
+#include "wolfhsm/wh_common.h"
+#include "wolfhsm/wh_comm.h"
+#include "wolfhsm/wh_message.h"
+
+enum {
+    WH_MESSAGE_PKCS11_ACTION_OPENSESSION        = 0x1,
+    WH_MESSAGE_PKCS11_ACTION_CLOSESESSION       = 0x2,
+    WH_MESSAGE_PKCS11_ACTION_FINDOBJECTSINIT    = 0x3,
+    WH_MESSAGE_PKCS11_ACTION_FINDOBJECTS        = 0x4,
+    WH_MESSAGE_PKCS11_ACTION_FINDOBJECTSFINAL   = 0x5,
+    WH_MESSAGE_PKCS11_ACTION_GETOBJECTINFO      = 0x6,
+    WH_MESSAGE_PKCS11_ACTION_DESTROYOBJECT      = 0x7,
+    WH_MESSAGE_PKCS11_ACTION_SIGNINIT           = 0x8,
+    WH_MESSAGE_PKCS11_ACTION_SIGN               = 0x9,
+    WH_MESSAGE_PKCS11_ACTION_SIGNUPDATE         = 0xA,
+    WH_MESSAGE_PKCS11_ACTION_SIGNFINAL          = 0xB,
+};
+
+/* Supported mechanisms.  Values match the PKCS11 CKM_ constants */
+enum {
+    WH_PKCS11_MECH_ECDSA        = 0x1041,   /* CKM_ECDSA, input is a digest */
+    WH_PKCS11_MECH_ECDSA_SHA256 = 0x1044,   /* CKM_ECDSA_SHA256 */
+};
+
+enum {
+    /* Handle value that never refers to a session or object */
+    WH_PKCS11_INVALID_HANDLE = 0,
+    /* Max handles returned in a single FindObjects response */
+    WH_MESSAGE_PKCS11_MAX_FIND_HANDLES = 64,
+    /* Max data carried by a Sign/SignUpdate request */
+    WH_MESSAGE_PKCS11_MAX_SIGN_DATA_LEN = WH_COMM_DATA_LEN - 8,
+    /* Max signature returned by Sign/SignFinal */
+    WH_MESSAGE_PKCS11_MAX_SIG_LEN = WH_COMM_DATA_LEN - 8,
+};
+
+/* Simple reusable response message */
+typedef struct {
+    int32_t rc;
+} whMessagePkcs11_SimpleResponse;
+
+int wh_MessagePkcs11_TranslateSimpleResponse(uint16_t magic,
+        const whMessagePkcs11_SimpleResponse* src,
+        whMessagePkcs11_SimpleResponse* dest);
+
+/* Reusable request for actions that only reference a session */
+typedef struct {
+    uint32_t session;
+} whMessagePkcs11_SessionRequest;
+
+int wh_MessagePkcs11_TranslateSessionRequest(uint16_t magic,
+        const whMessagePkcs11_SessionRequest* src,
+        whMessagePkcs11_SessionRequest* dest);
+
+/** PKCS11 OpenSession Request */
+typedef struct {
+    uint32_t flags;
+} whMessagePkcs11_OpenSessionRequest;
+
+int wh_MessagePkcs11_TranslateOpenSessionRequest(uint16_t magic,
+        const whMessagePkcs11_OpenSessionRequest* src,
+        whMessagePkcs11_OpenSessionRequest* dest);
+
+/** PKCS11 OpenSession Response */
+typedef struct {
+    int32_t rc;
+    uint32_t session;
+} whMessagePkcs11_OpenSessionResponse;
+
+int wh_MessagePkcs11_TranslateOpenSessionResponse(uint16_t magic,
+        const whMessagePkcs11_OpenSessionResponse* src,
+        whMessagePkcs11_OpenSessionResponse* dest);
+
+/** PKCS11 CloseSession Request */
+/* Use SessionRequest */
+
+/** PKCS11 CloseSession Response */
+/* Use SimpleResponse */
+
+/** PKCS11 FindObjectsInit Request */
+typedef struct {
+    uint32_t session;
+    uint16_t access;
+    uint16_t flags;
+    uint16_t id_min;
+    uint16_t id_max;
+    uint16_t label_len;     /* 0 to match any label */
+    uint8_t padding[2];
+    uint8_t label[WOLFHSM_NVM_LABEL_LEN];
+} whMessagePkcs11_FindObjectsInitRequest;
+
+int wh_MessagePkcs11_TranslateFindObjectsInitRequest(uint16_t magic,
+        const whMessagePkcs11_FindObjectsInitRequest* src,
+        whMessagePkcs11_FindObjectsInitRequest* dest);
+
+/** PKCS11 FindObjectsInit Response */
+/* Use SimpleResponse */
+
+/** PKCS11 FindObjects Request */
+typedef struct {
+    uint32_t session;
+    uint16_t max_count;
+    uint8_t padding[2];
+} whMessagePkcs11_FindObjectsRequest;
+
+int wh_MessagePkcs11_TranslateFindObjectsRequest(uint16_t magic,
+        const whMessagePkcs11_FindObjectsRequest* src,
+        whMessagePkcs11_FindObjectsRequest* dest);
+
+/** PKCS11 FindObjects Response */
+typedef struct {
+    int32_t rc;
+    uint16_t count;
+    uint8_t padding[2];
+    uint32_t handles[WH_MESSAGE_PKCS11_MAX_FIND_HANDLES];
+} whMessagePkcs11_FindObjectsResponse;
+
+int wh_MessagePkcs11_TranslateFindObjectsResponse(uint16_t magic,
+        const whMessagePkcs11_FindObjectsResponse* src,
+        whMessagePkcs11_FindObjectsResponse* dest);
+
+/** PKCS11 FindObjectsFinal Request */
+/* Use SessionRequest */
+
+/** PKCS11 FindObjectsFinal Response */
+/* Use SimpleResponse */
+
+/** PKCS11 GetObjectInfo and DestroyObject Request */
+typedef struct {
+    uint32_t session;
+    uint32_t object;
+} whMessagePkcs11_ObjectRequest;
+
+int wh_MessagePkcs11_TranslateObjectRequest(uint16_t magic,
+        const whMessagePkcs11_ObjectRequest* src,
+        whMessagePkcs11_ObjectRequest* dest);
+
+/** PKCS11 GetObjectInfo Response */
+typedef struct {
+    int32_t rc;
+    uint16_t id;
+    uint16_t access;
+    uint16_t flags;
+    uint16_t len;
+    uint8_t label[WOLFHSM_NVM_LABEL_LEN];
+} whMessagePkcs11_GetObjectInfoResponse;
+
+int wh_MessagePkcs11_TranslateGetObjectInfoResponse(uint16_t magic,
+        const whMessagePkcs11_GetObjectInfoResponse* src,
+        whMessagePkcs11_GetObjectInfoResponse* dest);
+
+/** PKCS11 DestroyObject Response */
+/* Use SimpleResponse */
+
+/** PKCS11 SignInit Request */
+typedef struct {
+    uint32_t session;
+    uint32_t object;
+    uint32_t mechanism;
+} whMessagePkcs11_SignInitRequest;
+
+int wh_MessagePkcs11_TranslateSignInitRequest(uint16_t magic,
+        const whMessagePkcs11_SignInitRequest* src,
+        whMessagePkcs11_SignInitRequest* dest);
+
+/** PKCS11 SignInit Response */
+/* Use SimpleResponse */
+
+/** PKCS11 Sign and SignUpdate Request */
+typedef struct {
+    uint32_t session;
+    uint16_t len;
+    uint8_t padding[2];
+    /* Data up to WH_MESSAGE_PKCS11_MAX_SIGN_DATA_LEN follows */
+} whMessagePkcs11_SignDataRequest;
+
+int wh_MessagePkcs11_TranslateSignDataRequest(uint16_t magic,
+        const whMessagePkcs11_SignDataRequest* src,
+        whMessagePkcs11_SignDataRequest* dest);
+
+/** PKCS11 SignUpdate Response */
+/* Use SimpleResponse */
+
+/** PKCS11 SignFinal Request */
+/* Use SessionRequest */
+
+/** PKCS11 Sign and SignFinal Response */
+typedef struct {
+    int32_t rc;
+    uint16_t len;
+    uint8_t padding[2];
+    /* Signature up to WH_MESSAGE_PKCS11_MAX_SIG_LEN follows */
+} whMessagePkcs11_SignatureResponse;
+
+int wh_MessagePkcs11_TranslateSignatureResponse(uint16_t magic,
+        const whMessagePkcs11_SignatureResponse* src,
+        whMessagePkcs11_SignatureResponse* dest);
+
+#endif /* WOLFHSM_WH_MESSAGE_PKCS11_H_ */
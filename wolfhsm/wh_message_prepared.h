@@ -0,0 +1,137 @@
+/*
+ * Copyright (C) 2024 wolfSSL Inc.
+ *
+ * This file is part of wolfHSM.
+ *
+ * wolfHSM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfHSM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wolfHSM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * wolfhsm/wh_message_prepared.h
+ *
+ * Prepared crypto operation message group.  Prepare binds an algorithm, a
+ * keystore key and the parameters that stay fixed between calls to a
+ * server-resident wolfCrypt context, and returns a handle.  Exec then carries
+ * only the handle and the per-call data, so the server neither resolves the
+ * key nor reinitializes the context again.  Close releases the handle.  When
+ * every entry is in use, Prepare reclaims the least recently used one, and
+ * Exec on a reclaimed handle fails with WH_ERROR_BADHANDLE so the client can
+ * prepare again.  Replacing, evicting or erasing the key also closes every
+ * operation prepared from it.
+ */
+
+#ifndef WOLFHSM_WH_MESSAGE_PREPARED_H_
+#define WOLFHSM_WH_MESSAGE_PREPARED_H_
+
+#include <stdint.h>
+#include "wolfhsm/wh_common.h"
+#include "wolfhsm/wh_comm.h"
+#include "wolfhsm/wh_message.h"
+
+enum {
+    WH_MESSAGE_PREPARED_ACTION_PREPARE      = 0x1,
+    WH_MESSAGE_PREPARED_ACTION_EXEC         = 0x2,
+    WH_MESSAGE_PREPARED_ACTION_CLOSE        = 0x3,
+};
+
+enum {
+    WH_PREPARED_ALG_AESGCM      = 0x1,  /* AES-GCM encrypt or decrypt */
+    WH_PREPARED_ALG_ECDSA_SIGN  = 0x2,  /* ECDSA sign of a message hash */
+};
+
+enum {
+    WH_PREPARED_MAX_IV_LEN  = 16,
+    WH_PREPARED_MAX_TAG_LEN = 16,
+};
+
+/** Prepared Prepare Request */
+typedef struct {
+    int32_t  curve_id;      /* ECDSA_SIGN: wolfCrypt curve id */
+    whKeyId  key_id;        /* Keystore id of the key */
+    uint8_t  alg;           /* WH_PREPARED_ALG_* */
+    uint8_t  enc;           /* AESGCM: 1 to encrypt, 0 to decrypt */
+    uint8_t  iv_len;        /* AESGCM: Bytes of IV sent with every Exec */
+    uint8_t  tag_len;       /* AESGCM: Bytes of authentication tag */
+    uint8_t  padding[2];
+} whMessagePrepared_PrepareRequest;
+
+int wh_MessagePrepared_TranslatePrepareRequest(uint16_t magic,
+        const whMessagePrepared_PrepareRequest* src,
+        whMessagePrepared_PrepareRequest* dest);
+
+/** Prepared Prepare Response */
+typedef struct {
+    int32_t  rc;
+    uint16_t handle;        /* Passed to Exec and Close */
+    uint8_t  padding[2];
+} whMessagePrepared_PrepareResponse;
+
+int wh_MessagePrepared_TranslatePrepareResponse(uint16_t magic,
+        const whMessagePrepared_PrepareResponse* src,
+        whMessagePrepared_PrepareResponse* dest);
+
+/** Prepared Exec Request */
+typedef struct {
+    uint16_t handle;
+    uint16_t aad_len;       /* AESGCM: Bytes of AAD */
+    uint16_t data_len;      /* Bytes of input, the hash for ECDSA_SIGN */
+    uint8_t  padding[2];
+} whMessagePrepared_ExecRequest;
+/* AESGCM is followed by iv_len bytes of IV, aad_len bytes of AAD, data_len
+ * bytes of input and, when decrypting, tag_len bytes of expected tag.
+ * ECDSA_SIGN is followed by data_len bytes of hash */
+
+enum {
+    /* Max payload carried by an Exec request or response */
+    WH_MESSAGE_PREPARED_MAX_INLINE_LEN =
+            WH_COMM_DATA_LEN - sizeof(whMessagePrepared_ExecRequest),
+};
+
+int wh_MessagePrepared_TranslateExecRequest(uint16_t magic,
+        const whMessagePrepared_ExecRequest* src,
+        whMessagePrepared_ExecRequest* dest);
+
+/** Prepared Exec Response */
+typedef struct {
+    int32_t  rc;
+    uint16_t data_len;      /* Bytes of output following this header */
+    uint8_t  padding[2];
+} whMessagePrepared_ExecResponse;
+/* Followed by data_len bytes of output.  AESGCM encrypt returns the
+ * ciphertext followed by the tag, decrypt returns the plaintext and
+ * ECDSA_SIGN returns the DER encoded signature */
+
+int wh_MessagePrepared_TranslateExecResponse(uint16_t magic,
+        const whMessagePrepared_ExecResponse* src,
+        whMessagePrepared_ExecResponse* dest);
+
+/** Prepared Close Request */
+typedef struct {
+    uint16_t handle;
+    uint8_t  padding[2];
+} whMessagePrepared_CloseRequest;
+
+int wh_MessagePrepared_TranslateCloseRequest(uint16_t magic,
+        const whMessagePrepared_CloseRequest* src,
+        whMessagePrepared_CloseRequest* dest);
+
+/** Prepared Close Response */
+typedef struct {
+    int32_t  rc;
+} whMessagePrepared_CloseResponse;
+
+int wh_MessagePrepared_TranslateCloseResponse(uint16_t magic,
+        const whMessagePrepared_CloseResponse* src,
+        whMessagePrepared_CloseResponse* dest);
+
+#endif /* WOLFHSM_WH_MESSAGE_PREPARED_H_ */
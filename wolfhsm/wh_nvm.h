@@ -40,6 +40,7 @@
 #include <stdint.h>
 
 #include "wolfhsm/wh_common.h"  /* For whNvm types */
+#include "wolfhsm/wh_lock.h"
 
 
 enum {
@@ -87,27 +88,86 @@ typedef struct {
     /* Read the data of the object starting at the byte offset */
     int (*Read)(void* context, whNvmId id, whNvmSize offset,
             whNvmSize data_len, uint8_t* data);
+
+    /* Optional: Append a record to an object created with CreateLog.  Only
+     * the record is written, not a new copy of the object.  A record is
+     * either fully visible after a reset or not at all. */
+    int (*Append)(void* context, whNvmId id, whNvmSize data_len,
+            const uint8_t* data);
+
+    /* Optional: Finish deferred housekeeping, such as erasing a partition
+     * left dirty by an interrupted DestroyObjects, so later operations do not
+     * pay for it.  Called when the caller has idle time. */
+    int (*Maintain)(void* context);
+
+    /* Optional: Destroy every object matching filter with a single
+     * replication of the partition, with the same atomicity as
+     * DestroyObjects.  Nothing is rewritten when no object matches.  Sets
+     * out_count, if not NULL, to the number of objects destroyed. */
+    int (*DestroyMatching)(void* context, const whNvmFilter* filter,
+            whNvmId* out_count);
+
+    /* Optional: Add a list of objects, each meta_list[i].len bytes of
+     * data_list[i], so that after an error or a reset either all of them or
+     * none are present.  Without it, wh_Nvm_AddObjects adds them one by one
+     * and an interrupted list may be partially written. */
+    int (*AddObjects)(void* context, whNvmId list_count,
+            whNvmMetadata* meta_list, const uint8_t* const* data_list);
+
+    /* Optional: Add an append-only log object, replacing any object with the
+     * same id, with data as its first record when data_len is not 0.  The
+     * log grows in place through Append and its metadata len is the
+     * committed log length.  Metadata flags are stored as given and do not
+     * select the kind of object. */
+    int (*CreateLog)(void* context, whNvmMetadata* meta,
+            whNvmSize data_len, const uint8_t* data);
 } whNvmCb;
 
 
 /** NVM Context helper structs and functions */
-/* Simple helper context structure associated with an NVM instance */
+/* Simple helper context structure associated with an NVM instance.  The lock
+ * is held shared for List, GetAvailable, GetMetadata and Read, and exclusive
+ * for AddObject(s), Append and DestroyObjects.  Backends may therefore see
+ * concurrent read-side calls and must not modify shared state in them. */
 typedef struct whNvmContext_t {
     whNvmCb *cb;
     void* context;
+    void* config;               /* Kept for a lazy mount */
+    whLock lock[1];
+    int mounted;                /* Backend Init has completed */
+    uint32_t generation;        /* Changes with every write, see below */
 } whNvmContext;
 
-/* Simple helper configuration structure associated with an NVM instance */
+/* Simple helper configuration structure associated with an NVM instance.
+ * With lazy_mount set, the backend Init (directory scan and recovery) is
+ * deferred to wh_Nvm_Mount or the first operation that needs it, and config
+ * must remain valid until then. */
 typedef struct whNvmConfig_t {
     whNvmCb *cb;
     void* context;
     void* config;
+    const whLockConfig* lock_config;    /* Optional, NULL for no locking */
+    uint8_t lazy_mount;
+    uint8_t padding[7];
 } whNvmConfig;
 
 
 int wh_Nvm_Init(whNvmContext* context, const whNvmConfig *config);
 int wh_Nvm_Cleanup(whNvmContext* context);
 
+/* Initialize the backend now if it was deferred by lazy_mount.  Returns 0 if
+ * already mounted */
+int wh_Nvm_Mount(whNvmContext* context);
+int wh_Nvm_IsMounted(whNvmContext* context);
+
+/* Run the backend Maintain callback, if any, once mounted */
+int wh_Nvm_Maintain(whNvmContext* context);
+
+/* Counter that changes whenever an object may have been added, appended or
+ * destroyed.  Lets callers keep resident copies of objects and reload them
+ * only when the counter moves on from the value they were loaded at */
+uint32_t wh_Nvm_GetGeneration(whNvmContext* context);
+
 int wh_Nvm_GetAvailable(whNvmContext* context,
         uint32_t *out_avail_size, whNvmId *out_avail_objects,
         uint32_t *out_reclaim_size, whNvmId *out_reclaim_objects);
@@ -115,6 +175,15 @@ int wh_Nvm_GetAvailable(whNvmContext* context,
 int wh_Nvm_AddObject(whNvmContext* context, whNvmMetadata *meta,
         whNvmSize data_len, const uint8_t* data);
 
+/* Add list_count objects in one pass. Each meta_list[i].len is the length of
+ * data_list[i]. With a backend AddObjects callback the list is committed all
+ * or nothing.  Otherwise free space and directory entries for the whole list
+ * are checked up front, compacting the partition once if reclaimable space
+ * would make the list fit, so a list that cannot fit fails before any object
+ * is written, but a later failure leaves the earlier objects written. */
+int wh_Nvm_AddObjects(whNvmContext* context, whNvmId list_count,
+        whNvmMetadata* meta_list, const uint8_t* const* data_list);
+
 int wh_Nvm_List(whNvmContext* context,
         whNvmAccess access, whNvmFlags flags, whNvmId start_id,
         whNvmId *out_count, whNvmId *out_id);
@@ -125,7 +194,23 @@ int wh_Nvm_GetMetadata(whNvmContext* context, whNvmId id,
 int wh_Nvm_DestroyObjects(whNvmContext* context, whNvmId list_count,
         const whNvmId* id_list);
 
+/* Destroy every object whose metadata matches filter.  Backends without a
+ * DestroyMatching callback fall back to DestroyObjects on batches of matching
+ * ids, all under one hold of the write lock. */
+int wh_Nvm_DestroyMatching(whNvmContext* context, const whNvmFilter* filter,
+        whNvmId* out_count);
+
+/* Returns 1 if meta is selected by filter */
+int wh_Nvm_FilterMatches(const whNvmFilter* filter,
+        const whNvmMetadata* meta);
+
 int wh_Nvm_Read(whNvmContext* context, whNvmId id, whNvmSize offset,
         whNvmSize data_len, uint8_t* data);
 
+int wh_Nvm_CreateLog(whNvmContext* context, whNvmMetadata* meta,
+        whNvmSize data_len, const uint8_t* data);
+
+int wh_Nvm_Append(whNvmContext* context, whNvmId id, whNvmSize data_len,
+        const uint8_t* data);
+
 #endif /* WOLFHSM_WH_NVM_H_ */
@@ -50,6 +50,7 @@ typedef struct {
     uint32_t epoch;
     uint32_t start;
     uint32_t count;
+    uint32_t log;       /* Object is an append-log extent */
 } nfMemState;
 
 /* In-memory version of an Object */
@@ -67,6 +68,24 @@ typedef struct {
     uint32_t reclaimable_data;
 } nfMemDirectory;
 
+/* Data bytes reserved for the first extent of an append-log object.  Each
+ * chained extent doubles the space of the log when that fits, and larger
+ * records get an extent of their own size */
+#ifndef NF_LOG_EXTENT_LEN
+#define NF_LOG_EXTENT_LEN 512
+#endif
+
+/* Number of append-log tails cached in memory */
+#define NF_LOG_CACHE_COUNT 4
+
+/* In-memory tail of an append-log object.  Rebuilt from flash on a miss */
+typedef struct {
+    whNvmId id;             /* Log id, or 0 if the slot is unused */
+    uint16_t extent;        /* Directory index of the last extent */
+    uint32_t tail;          /* Unit offset of the next record in extent */
+    uint32_t len;           /* Committed data bytes across all extents */
+} nfMemLog;
+
 /** whNvm config and context structure definitions */
 /* In memory configuration structure associated with an NVM instance */
 typedef struct whNvmFlashConfig_t {
@@ -80,10 +99,12 @@ typedef struct whNvmFlashContext_t {
     void* flash;                    /* Flash context to use */
     nfMemState state;               /* State of active partition */
     nfMemDirectory directory;       /* Cache of active objects */
+    nfMemLog logs[NF_LOG_CACHE_COUNT]; /* Cache of append-log tails */
     uint32_t partition_units;       /* Size of partition in units */
     int active;                     /* Which partition (0 or 1) is active */
     int initialized;
-    uint8_t padding[4];
+    int next_log;                   /* Next logs entry to replace */
+    int inactive_blank;             /* Inactive partition known erased */
 } whNvmFlashContext;
 
 /** whNvm Interface */
@@ -98,10 +119,19 @@ int wh_NvmFlash_GetAvailable(void* c,
 int wh_NvmFlash_GetMetadata(void* c, whNvmId id, whNvmMetadata* meta);
 int wh_NvmFlash_AddObject(void* c, whNvmMetadata* meta,
         whNvmSize data_len, const uint8_t* data);
+int wh_NvmFlash_AddObjects(void* c, whNvmId list_count,
+        whNvmMetadata* meta_list, const uint8_t* const* data_list);
 int wh_NvmFlash_DestroyObjects(void* c, whNvmId list_count,
         const whNvmId* id_list);
 int wh_NvmFlash_Read(void* c, whNvmId id, whNvmSize offset,
         whNvmSize data_len, uint8_t* data);
+int wh_NvmFlash_CreateLog(void* c, whNvmMetadata* meta,
+        whNvmSize data_len, const uint8_t* data);
+int wh_NvmFlash_Append(void* c, whNvmId id, whNvmSize data_len,
+        const uint8_t* data);
+int wh_NvmFlash_Maintain(void* c);
+int wh_NvmFlash_DestroyMatching(void* c, const whNvmFilter* filter,
+        whNvmId* out_count);
 
 #define WH_NVM_FLASH_CB                             \
 {                                                   \
@@ -111,8 +141,13 @@ int wh_NvmFlash_Read(void* c, whNvmId id, whNvmSize offset,
     .GetAvailable = wh_NvmFlash_GetAvailable,       \
     .GetMetadata = wh_NvmFlash_GetMetadata,         \
     .AddObject = wh_NvmFlash_AddObject,             \
+    .AddObjects = wh_NvmFlash_AddObjects,           \
     .DestroyObjects = wh_NvmFlash_DestroyObjects,   \
     .Read = wh_NvmFlash_Read,                       \
+    .CreateLog = wh_NvmFlash_CreateLog,             \
+    .Append = wh_NvmFlash_Append,                   \
+    .Maintain = wh_NvmFlash_Maintain,               \
+    .DestroyMatching = wh_NvmFlash_DestroyMatching, \
 }
 
 #endif /* WOLFHSM_WH_NVMFLASH_H_ */
@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) 2024 wolfSSL Inc.
+ *
+ * This file is part of wolfHSM.
+ *
+ * wolfHSM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfHSM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wolfHSM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * wolfhsm/wh_nvm_ram.h
+ *
+ * Concrete library to implement a volatile NVM data store in a caller-provided
+ * RAM buffer.  Contents are lost on Cleanup or reset, so this is suitable for
+ * session objects and as the volatile half of a whNvmTier.
+ *
+ */
+
+#ifndef WOLFHSM_WH_NVM_RAM_H_
+#define WOLFHSM_WH_NVM_RAM_H_
+
+#include <stdint.h>
+
+#include "wolfhsm/wh_common.h"
+
+/* Number of objects that can be held at once */
+#define NR_OBJECT_COUNT (WOLFHSM_NUM_NVMOBJECTS)
+
+/* In-memory version of an Object.  Object data is kept packed in the buffer in
+ * the same order as the objects array. */
+typedef struct {
+    whNvmMetadata metadata;
+    uint32_t offset;        /* Byte offset of the data within the buffer */
+} nrMemObject;
+
+/** whNvm config and context structure definitions */
+typedef struct whNvmRamConfig_t {
+    uint8_t* buffer;        /* Storage for object data */
+    uint32_t size;          /* Size of buffer in bytes */
+    uint8_t padding[4];
+} whNvmRamConfig;
+
+typedef struct whNvmRamContext_t {
+    uint8_t* buffer;
+    uint32_t size;
+    uint32_t used;          /* Bytes of buffer holding object data */
+    nrMemObject objects[NR_OBJECT_COUNT];
+    int count;              /* Number of valid entries in objects */
+    int initialized;
+} whNvmRamContext;
+
+/** whNvm Interface */
+int wh_NvmRam_Init(void* c, const void* cf);
+int wh_NvmRam_Cleanup(void* c);
+int wh_NvmRam_List(void* c,
+        whNvmAccess access, whNvmFlags flags, whNvmId start_id,
+        whNvmId *out_count, whNvmId *out_id);
+int wh_NvmRam_GetAvailable(void* c,
+        uint32_t *out_avail_size, whNvmId *out_avail_objects,
+        uint32_t *out_reclaim_size, whNvmId *out_reclaim_objects);
+int wh_NvmRam_GetMetadata(void* c, whNvmId id, whNvmMetadata* meta);
+int wh_NvmRam_AddObject(void* c, whNvmMetadata* meta,
+        whNvmSize data_len, const uint8_t* data);
+int wh_NvmRam_DestroyObjects(void* c, whNvmId list_count,
+        const whNvmId* id_list);
+int wh_NvmRam_Read(void* c, whNvmId id, whNvmSize offset,
+        whNvmSize data_len, uint8_t* data);
+
+#define WH_NVM_RAM_CB                               \
+{                                                   \
+    .Init = wh_NvmRam_Init,                         \
+    .Cleanup = wh_NvmRam_Cleanup,                   \
+    .List = wh_NvmRam_List,                         \
+    .GetAvailable = wh_NvmRam_GetAvailable,         \
+    .GetMetadata = wh_NvmRam_GetMetadata,           \
+    .AddObject = wh_NvmRam_AddObject,               \
+    .DestroyObjects = wh_NvmRam_DestroyObjects,     \
+    .Read = wh_NvmRam_Read,                         \
+}
+
+#endif /* WOLFHSM_WH_NVM_RAM_H_ */
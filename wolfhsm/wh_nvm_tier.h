@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) 2024 wolfSSL Inc.
+ *
+ * This file is part of wolfHSM.
+ *
+ * wolfHSM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfHSM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wolfHSM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * wolfhsm/wh_nvm_tier.h
+ *
+ * NVM front end that combines a volatile tier (e.g. whNvmRam) with a
+ * persistent tier (e.g. whNvmFlash) behind a single whNvmCb.
+ *
+ * Objects added with wh_NvmTier_AddVolatileObject() are stored only in the
+ * volatile tier and never touch persistent storage.  Objects added through
+ * the whNvmCb interface always go to the persistent tier, whatever their
+ * metadata flags, so clients cannot steer an object away from flash.
+ * Lookups check the volatile tier first, so a volatile object shadows a
+ * persistent object with the same id.  Adding a persistent object removes
+ * any volatile copy of that id, and destroying an id removes it from both
+ * tiers.  Only ids present in the persistent tier are forwarded to it for
+ * destruction, so destroying volatile objects never rewrites the persistent
+ * partition.
+ *
+ */
+
+#ifndef WOLFHSM_WH_NVM_TIER_H_
+#define WOLFHSM_WH_NVM_TIER_H_
+
+#include <stdint.h>
+
+#include "wolfhsm/wh_common.h"
+#include "wolfhsm/wh_nvm.h"
+
+/** whNvm config and context structure definitions */
+typedef struct whNvmTierConfig_t {
+    const whNvmConfig* volatile_config;     /* Volatile tier, e.g. whNvmRam */
+    const whNvmConfig* persistent_config;   /* Persistent tier */
+} whNvmTierConfig;
+
+typedef struct whNvmTierContext_t {
+    whNvmContext volatile_nvm[1];
+    whNvmContext persistent_nvm[1];
+    int initialized;
+    uint8_t padding[4];
+} whNvmTierContext;
+
+/** whNvm Interface */
+int wh_NvmTier_Init(void* c, const void* cf);
+int wh_NvmTier_Cleanup(void* c);
+int wh_NvmTier_List(void* c,
+        whNvmAccess access, whNvmFlags flags, whNvmId start_id,
+        whNvmId *out_count, whNvmId *out_id);
+int wh_NvmTier_GetAvailable(void* c,
+        uint32_t *out_avail_size, whNvmId *out_avail_objects,
+        uint32_t *out_reclaim_size, whNvmId *out_reclaim_objects);
+int wh_NvmTier_GetMetadata(void* c, whNvmId id, whNvmMetadata* meta);
+int wh_NvmTier_AddObject(void* c, whNvmMetadata* meta,
+        whNvmSize data_len, const uint8_t* data);
+int wh_NvmTier_DestroyObjects(void* c, whNvmId list_count,
+        const whNvmId* id_list);
+
+/* Add an object to the volatile tier only.  Not part of whNvmCb, so only
+ * server code holding the tier context can create volatile objects */
+int wh_NvmTier_AddVolatileObject(whNvmTierContext* context,
+        whNvmMetadata* meta, whNvmSize data_len, const uint8_t* data);
+int wh_NvmTier_Read(void* c, whNvmId id, whNvmSize offset,
+        whNvmSize data_len, uint8_t* data);
+int wh_NvmTier_CreateLog(void* c, whNvmMetadata* meta,
+        whNvmSize data_len, const uint8_t* data);
+int wh_NvmTier_Append(void* c, whNvmId id, whNvmSize data_len,
+        const uint8_t* data);
+int wh_NvmTier_DestroyMatching(void* c, const whNvmFilter* filter,
+        whNvmId* out_count);
+
+#define WH_NVM_TIER_CB                              \
+{                                                   \
+    .Init = wh_NvmTier_Init,                        \
+    .Cleanup = wh_NvmTier_Cleanup,                  \
+    .List = wh_NvmTier_List,                        \
+    .GetAvailable = wh_NvmTier_GetAvailable,        \
+    .GetMetadata = wh_NvmTier_GetMetadata,          \
+    .AddObject = wh_NvmTier_AddObject,              \
+    .DestroyObjects = wh_NvmTier_DestroyObjects,    \
+    .Read = wh_NvmTier_Read,                        \
+    .CreateLog = wh_NvmTier_CreateLog,              \
+    .Append = wh_NvmTier_Append,                    \
+    .DestroyMatching = wh_NvmTier_DestroyMatching,  \
+}
+
+#endif /* WOLFHSM_WH_NVM_TIER_H_ */
@@ -358,6 +358,18 @@ typedef struct WOLFHSM_PACK wh_Packet_she_load_key_res
     uint8_t messageFive[WOLFHSM_SHE_M5_SZ];
 } wh_Packet_she_load_key_res;
 
+/* count wh_Packet_she_load_key_req entries follow the fixed fields */
+typedef struct WOLFHSM_PACK wh_Packet_she_load_key_batch_req
+{
+    uint32_t count;
+} wh_Packet_she_load_key_batch_req;
+
+/* count wh_Packet_she_load_key_res entries follow the fixed fields */
+typedef struct WOLFHSM_PACK wh_Packet_she_load_key_batch_res
+{
+    uint32_t count;
+} wh_Packet_she_load_key_batch_res;
+
 typedef struct WOLFHSM_PACK wh_Packet_she_load_plain_key_req
 {
     uint8_t key[WOLFHSM_SHE_KEY_SZ];
@@ -563,6 +575,8 @@ typedef struct WOLFHSM_PACK whPacket
         wh_Packet_she_get_status_res sheGetStatusRes;
         wh_Packet_she_load_key_req sheLoadKeyReq;
         wh_Packet_she_load_key_res sheLoadKeyRes;
+        wh_Packet_she_load_key_batch_req sheLoadKeyBatchReq;
+        wh_Packet_she_load_key_batch_res sheLoadKeyBatchRes;
         wh_Packet_she_load_plain_key_req sheLoadPlainKeyReq;
         wh_Packet_she_export_ram_key_res sheExportRamKeyRes;
         wh_Packet_she_init_rng_res sheInitRngRes;
@@ -31,6 +31,7 @@
 #include "wolfhsm/wh_common.h"
 #include "wolfhsm/wh_comm.h"
 #include "wolfhsm/wh_nvm.h"
+#include "wolfhsm/wh_lock.h"
 #include "wolfhsm/wh_message_customcb.h"
 
 #ifndef WOLFHSM_NO_CRYPTO
@@ -39,7 +40,13 @@
 #include "wolfssl/wolfcrypt/rsa.h"
 #include "wolfssl/wolfcrypt/ecc.h"
 #include "wolfssl/wolfcrypt/curve25519.h"
+#include "wolfssl/wolfcrypt/sha256.h"
+#include "wolfssl/wolfcrypt/sha512.h"
+#include "wolfssl/wolfcrypt/asn.h"
 #include "wolfssl/wolfcrypt/cryptocb.h"
+#if defined(HAVE_CHACHA) && defined(HAVE_POLY1305)
+#include "wolfssl/wolfcrypt/chacha20_poly1305.h"
+#endif
 #endif /* WOLFHSM_NO_CRYPTO */
 
 /* Forward declaration of the server structure so its elements can reference
@@ -54,6 +61,19 @@ typedef struct CacheSlot {
     uint8_t       buffer[WOLFHSM_KEYCACHE_BUFSIZE];
 } CacheSlot;
 
+/* Key cache slots and the lock that guards them.  Every server owns one, and
+ * servers running on separate threads may instead point at a common keystore
+ * through whServerConfig.keystore.  Lookups take the lock shared, filling,
+ * evicting or replacing a slot takes it exclusive.  generation advances each
+ * time a cached key is replaced or removed so that servers sharing the
+ * keystore can drop state derived from keys another server changed */
+typedef struct whServerKeystore_t {
+    CacheSlot cache[WOLFHSM_NUM_RAMKEYS];
+    whLock    lock[1];
+    uint32_t  generation;
+    uint8_t   padding[4];
+} whServerKeystore;
+
 typedef struct {
     int    devId;
     Aes    aes[1];
@@ -68,6 +88,18 @@ typedef struct {
 } crypto_context;
 
 #ifdef WOLFHSM_SHE_EXTENSION
+/* Resident copy of one SHE key slot, so commands use the key in place.  The
+ * slot is reloaded from the keystore when the NVM generation moves on or the
+ * key is replaced in the key cache */
+typedef struct {
+    whNvmMetadata meta[1];      /* whSheMetadata flags and count in label */
+    uint8_t  key[WOLFHSM_SHE_KEY_SZ];
+    whKeyId  id;                /* Full key id, including the client id */
+    uint8_t  valid;
+    uint8_t  padding[1];
+    uint32_t nvmGeneration;     /* wh_Nvm_GetGeneration at load */
+} whServerSheSlot;
+
 typedef struct {
     uint8_t  sbState;
     uint8_t  cmacKeyFound;
@@ -79,10 +111,172 @@ typedef struct {
     uint8_t  prngState[WOLFHSM_SHE_KEY_SZ];
     uint8_t  prngKey[WOLFHSM_SHE_KEY_SZ];
     uint8_t  uid[WOLFHSM_SHE_UID_SZ];
+    uint8_t  padding[1];
+    whServerSheSlot slots[WOLFHSM_SHE_NUM_SLOTS];
 } she_context;
 #endif
+
+/** Server certificate trust anchor cache */
+
+/* Public key of a trust anchor parsed out of its NVM object so that chain
+ * verification does not re-read and re-parse the anchor on every request.
+ * The entry is parsed again once the NVM generation moves on, catching
+ * changes made without going through this server's handlers */
+typedef struct {
+    whNvmId  id;            /* NVM id of the anchor, 0 if unused */
+    uint16_t pubKeySz;
+    uint32_t keyOID;        /* wolfCrypt key OID of pubKey */
+    uint32_t lastUse;       /* Stamp for least recently used eviction */
+    uint32_t nvmGeneration; /* wh_Nvm_GetGeneration when parsed */
+    uint8_t  subjectHash[KEYID_SIZE];
+    uint8_t  pubKey[WOLFHSM_CERT_PUBKEY_MAX];
+} whServerCertCacheEntry;
+
+typedef struct {
+    whServerCertCacheEntry entries[WOLFHSM_NUM_CERT_CACHE];
+    uint32_t               useCounter;
+    /* Parsing scratch, kept here rather than on the server stack */
+    uint8_t                der[WOLFHSM_CERT_MAX_SIZE];
+    DecodedCert            decoded[1];
+} whServerCertContext;
+
+#ifdef HAVE_ECC
+/** Server ECC verifier key cache */
+
+/* Public key imported once for repeated signature verification, saving the
+ * import on every request.  With FP_ECC, wolfCrypt builds the fixed point
+ * table for the point on its second verify, so FP_ENTRIES should exceed
+ * WOLFHSM_NUM_ECC_VERIFY_CACHE by at least one for the generator.  pub holds
+ * the qx|qy the entry was imported from so that a key replaced under the
+ * same id is detected and imported again */
+typedef struct {
+    ecc_key  key[1];
+    whKeyId  keyId;         /* Cache key id, 0 if unused */
+    uint16_t pubSz;
+    int      curveId;
+    uint32_t lastUse;       /* Stamp for least recently used eviction */
+    uint8_t  pub[2 * MAX_ECC_BYTES];
+} whServerEccVerifyEntry;
+
+typedef struct {
+    whServerEccVerifyEntry entries[WOLFHSM_NUM_ECC_VERIFY_CACHE];
+    uint32_t               useCounter;
+} whServerEccVerifyContext;
+#endif /* HAVE_ECC */
+
+/** Server image verification state, kept between time slices */
+typedef struct {
+    uint64_t hostaddr;      /* Client address of the image */
+    uint32_t len;
+    uint32_t offset;        /* Bytes hashed so far */
+    whKeyId  keyId;
+    uint16_t curveId;
+    uint16_t sigLen;
+    uint8_t  hashType;      /* WH_IMAGE_HASH_* */
+    uint8_t  active;
+    uint8_t  is64;          /* hostaddr is a 64-bit client address */
+    uint8_t  padding[7];
+    uint8_t  sig[WOLFHSM_IMAGE_MAX_SIG_LEN];
+    union {
+        wc_Sha256 sha256[1];
+#ifdef WOLFSSL_SHA384
+        wc_Sha384 sha384[1];
+#endif
+    } hash;
+} whServerImageContext;
+
+#if defined(HAVE_CHACHA) && defined(HAVE_POLY1305)
+/** Server ChaCha20-Poly1305 streaming sessions, kept between requests */
+typedef struct {
+    ChaChaPoly_Aead aead[1];
+    uint8_t         active;
+    uint8_t         enc;        /* 1 if encrypting */
+    uint8_t         clientId;   /* Only this client may use the session */
+    uint8_t         padding[5];
+} whServerChaChaSession;
+
+typedef struct {
+    whServerChaChaSession sessions[WOLFHSM_NUM_CHACHA_SESSIONS];
+} whServerChaChaContext;
+#endif
+
+#if defined(HAVE_AESGCM) || defined(HAVE_ECC)
+/** Server prepared crypto operations.  Each entry keeps a keyed wolfCrypt
+ * context between requests and is looked up by handle */
+typedef struct {
+    union {
+#ifdef HAVE_AESGCM
+        Aes     aes[1];
+#endif
+#ifdef HAVE_ECC
+        ecc_key ecc[1];
+#endif
+    } ctx;
+    uint32_t lastUse;
+    whKeyId  keyId;         /* Keystore id the context was keyed from */
+    uint16_t handle;        /* 0 if the entry is free */
+    uint8_t  alg;           /* WH_PREPARED_ALG_* */
+    uint8_t  enc;           /* AESGCM: 1 if encrypting */
+    uint8_t  ivLen;
+    uint8_t  tagLen;
+    uint8_t  padding[4];
+} whServerPreparedOp;
+
+/* One entry more than may be open, so Prepare can key a free entry before
+ * reclaiming the least recently used one */
+#define WH_SERVER_PREPARED_ENTRIES (WOLFHSM_NUM_PREPARED_OPS + 1)
+
+typedef struct {
+    whServerPreparedOp ops[WH_SERVER_PREPARED_ENTRIES];
+    uint32_t           useCounter;
+    uint8_t            seq;     /* Upper byte of the next handle */
+    uint8_t            padding[3];
+} whServerPreparedContext;
+#endif
 #endif /* WOLFHSM_NO_CRYPTO */
 
+/** Server PKCS11 session and object handle tables */
+
+/* Object handle table entry. The table is open addressed by NVM id so that
+ * both handle->entry and id->entry resolve without scanning */
+typedef struct {
+    whNvmId  id;        /* NVM or key id the handle refers to */
+    uint16_t gen;       /* Bumped each time the entry is released */
+    uint8_t  state;     /* WH_PKCS11_OBJECT_STATE_* */
+    uint8_t  padding[1];
+    int16_t  cacheIdx;  /* Key cache slot hint, -1 if not known */
+} whServerPkcs11Object;
+
+typedef struct {
+    uint16_t    gen;        /* Bumped each time the session is closed */
+    uint8_t     used;
+    uint8_t     op;         /* Active operation, WH_PKCS11_OP_* */
+    uint32_t    flags;
+    /* FindObjects state */
+    whNvmId     findNext;   /* Last id returned from NVM, 0 to start */
+    whNvmId     findIdMin;
+    whNvmId     findIdMax;
+    whNvmAccess findAccess;
+    whNvmFlags  findFlags;
+    uint16_t    findLabelLen;
+    uint8_t     findLabel[WOLFHSM_NVM_LABEL_LEN];
+    uint8_t     findNvmDone;
+    uint8_t     findCacheIdx;
+    uint8_t     padding[2];
+    /* Sign state */
+    uint32_t    signObject;
+    uint32_t    signMech;
+#ifndef WOLFHSM_NO_CRYPTO
+    wc_Sha256   sha256[1];
+#endif
+} whServerPkcs11Session;
+
+typedef struct {
+    whServerPkcs11Session sessions[WOLFHSM_NUM_PKCS11_SESSIONS];
+    whServerPkcs11Object  objects[WOLFHSM_NUM_PKCS11_OBJECTS];
+} whServerPkcs11Context;
+
+
 /** Server custom callback */
 
 /* Type definition for a custom server callback  */
@@ -92,6 +286,23 @@ typedef int (*whServerCustomCb)(
     whMessageCustomCb_Response*      resp /* response from callback to client */
 );
 
+/* Custom callback left in progress by wh_Server_CustomCbDefer. The request
+ * and partial response are held here and the continuation is called on later
+ * server iterations until it returns without deferring again, at which point
+ * its return value is sent to the client as the response rc */
+typedef struct {
+    whServerCustomCb           resume; /* Continuation, NULL when idle */
+    whMessageCustomCb_Request  req;
+    whMessageCustomCb_Response resp;
+    uint16_t                   magic;
+    uint16_t                   kind;
+    uint16_t                   seq;
+    uint8_t                    waitEvent; /* Resume only once signaled */
+    volatile uint8_t           signaled;
+    volatile uint8_t           canceled;  /* Respond aborted, don't resume */
+    uint8_t                    padding[7];
+} whServerCustomPending;
+
 
 /** Server DMA address translation and validation */
 
@@ -146,20 +357,79 @@ typedef struct {
     whServerDmaAddrList writeList; /* Allowed client write addresses */
 } whServerDmaAddrAllowList;
 
+/* Optional copy engine that moves data between server and (transformed)
+ * client addresses without occupying the server core. Submit starts a copy
+ * and returns without waiting, or returns WH_ERROR_NOTREADY if a copy is
+ * still in flight. Poll returns WH_ERROR_NOTREADY until the submitted copy
+ * has completed, then 0. Only one copy is outstanding at a time */
+typedef struct {
+    int (*Init)(void* context, const void* config);
+    int (*Cleanup)(void* context);
+    int (*Submit)(void* context, void* dst, const void* src, size_t len);
+    int (*Poll)(void* context);
+} whServerDmaEngineCb;
+
+typedef struct {
+    const whServerDmaEngineCb* cb;
+    void*                      context;
+    const void*                config;  /* Passed to cb->Init */
+} whServerDmaEngineConfig;
+
 /* Server DMA configuration struct for initializing a server */
 typedef struct {
     whServerDmaClientMem32Cb        cb32; /* DMA callback for 32-bit system */
     whServerDmaClientMem64Cb        cb64; /* DMA callback for 64-bit system */
     const whServerDmaAddrAllowList* dmaAddrAllowList; /* allowed addresses */
+    const whServerDmaEngineConfig*  engine; /* Optional copy engine */
 } whServerDmaConfig;
 
 typedef struct {
     whServerDmaClientMem32Cb        cb32; /* DMA callback for 32-bit system */
     whServerDmaClientMem64Cb        cb64; /* DMA callback for 64-bit system */
     const whServerDmaAddrAllowList* dmaAddrAllowList; /* allowed addresses */
+    const whServerDmaEngineCb*      engineCb; /* NULL copies with memcpy */
+    void*                           engineContext;
+    /* Staging buffers for engine copies, filled alternately */
+    uint8_t stage[2][WOLFHSM_DMA_STAGE_LEN];
 } whServerDmaContext;
 
 
+/* Response that could not be sent because the transport was busy. It is
+ * held in the comm packet buffer and retried on the next call to
+ * wh_Server_HandleRequestMessage before any new request is received */
+typedef struct {
+    uint16_t magic;
+    uint16_t kind;
+    uint16_t seq;
+    uint16_t size;
+    int      active;
+} whServerPendingResponse;
+
+
+/** Server NVM compaction policy */
+/* Thresholds that trigger compaction of NVM (wh_Nvm_DestroyObjects with an
+ * empty list) while the server is idle.  A zero threshold disables that
+ * trigger.  Idle compaction only runs when the NVM reports reclaimable space
+ * or entries, and a low free space trigger only fires when compacting would
+ * bring the free space back up to its threshold.  The thresholds are checked
+ * again only after the NVM contents change.  When a policy is configured, a
+ * server-side add that fails with WH_ERROR_NOSPACE compacts inline and
+ * retries as a last resort. */
+typedef struct {
+    uint32_t reclaimSize;     /* Compact when this many bytes are reclaimable */
+    uint32_t availSize;       /* Compact when fewer free bytes remain */
+    whNvmId  reclaimObjects;  /* Compact when this many entries reclaimable */
+    whNvmId  availObjects;    /* Compact when fewer free entries remain */
+} whServerNvmGcConfig;
+
+typedef struct {
+    const whServerNvmGcConfig* config;  /* NULL disables compaction policy */
+    uint32_t idleCount;       /* Compactions run while idle */
+    uint32_t inlineCount;     /* Compactions run inline to satisfy an add */
+    uint32_t generation;      /* NVM generation at the last idle check */
+    int      checked;         /* generation is valid */
+} whServerNvmGcContext;
+
 /** Server config and context */
 
 typedef struct whServerConfig_t {
@@ -175,8 +445,10 @@ typedef struct whServerConfig_t {
                             */
     int devId;
 #endif
+    whServerKeystore* keystore;     /* Optional keystore shared by servers */
 #endif /* WOLFHSM_NO_CRYPTO */
     whServerDmaConfig* dmaConfig;
+    const whServerNvmGcConfig* nvmGcConfig; /* Optional compaction policy */
 } whServerConfig;
 
 
@@ -186,17 +458,33 @@ struct whServerContext_t {
     whNvmContext* nvm;
 #ifndef WOLFHSM_NO_CRYPTO
     crypto_context* crypto;
-    CacheSlot       cache[WOLFHSM_NUM_RAMKEYS];
+    whServerKeystore* keystore;     /* localKeystore unless configured */
+    whServerKeystore  localKeystore[1];
+    uint32_t          keystoreGeneration; /* Last keystore generation seen */
+    whServerCertContext cert[1];
+    whServerImageContext image[1];
+#ifdef HAVE_ECC
+    whServerEccVerifyContext eccVerify[1];
+#endif
+#if defined(HAVE_CHACHA) && defined(HAVE_POLY1305)
+    whServerChaChaContext chacha[1];
+#endif
+#if defined(HAVE_AESGCM) || defined(HAVE_ECC)
+    whServerPreparedContext prepared[1];
+#endif
 #ifdef WOLFHSM_SHE_EXTENSION
     she_context* she;
 #endif
 #endif /* WOLFHSM_NO_CRYPTO */
     whServerCustomCb   customHandlerTable[WH_CUSTOM_CB_NUM_CALLBACKS];
+    whServerCustomPending customPending[1];
     whServerDmaContext dma;
+    whServerPkcs11Context pkcs11[1];
+    whServerNvmGcContext nvmGc[1];
+    whServerPendingResponse pending[1];
     int                connected;
 #ifdef WOLFHSM_SHE_EXTENSION
 #endif
-    uint8_t padding[4];
 };
 
 
@@ -266,12 +554,15 @@ int wh_Server_GetConnected(whServerContext* server,
  * This function processes incoming request messages from the communication
  * server in a non-blocking fashion. It determines the message group and action,
  * and dispatches the request to the appropriate handler. The function also
- * sends a response back to the client.
+ * sends a response back to the client. If the transport cannot accept the
+ * response yet, it is held and retried on later calls instead of spinning, and
+ * no new request is received until it has been sent.
  *
  * @param[in] server Pointer to the server context.
  * @return int Returns 0 on success, WH_ERROR_BADARGS if the arguments are
- * invalid, WH_ERROR_NOTREADY if the server is not connected or no data is
- * available, or a negative error code on failure.
+ * invalid, WH_ERROR_NOTREADY if the server is not connected, no data is
+ * available or a held response still cannot be sent, or a negative error code
+ * on failure.
  */
 int wh_Server_HandleRequestMessage(whServerContext* server);
 
@@ -331,6 +622,71 @@ int wh_Server_HandleCustomCbRequest(whServerContext* server, uint16_t magic,
                                     uint16_t req_size, const void* req_packet,
                                     uint16_t* out_resp_size, void* resp_packet);
 
+/**
+ * @brief Leaves the current custom callback in progress.
+ *
+ * Called from within a custom callback (or its continuation) to finish the
+ * operation later instead of blocking the server loop. The return value of
+ * the calling callback is then ignored and no response is sent. While the
+ * operation is in progress, wh_Server_HandleRequestMessage calls resume
+ * when no new request has arrived, and sends the response once resume
+ * returns without deferring again. A new request from the client, or a
+ * disconnect, cancels the operation.
+ *
+ * @param[in] server Pointer to the server context.
+ * @param[in] resume Continuation to call on later server iterations.
+ * @param[in] waitEvent If nonzero, resume is not called until
+ * wh_Server_CustomCbSignal is called.
+ * @return int Returns WH_ERROR_OK on success, or WH_ERROR_BADARGS if the
+ * arguments are invalid.
+ */
+int wh_Server_CustomCbDefer(whServerContext* server, whServerCustomCb resume,
+                            int waitEvent);
+
+/**
+ * @brief Signals the external event a deferred custom callback waits for.
+ *
+ * May be called from an event handler. Only sets a flag; the continuation
+ * runs on the next call to wh_Server_HandleRequestMessage.
+ *
+ * @param[in] server Pointer to the server context.
+ * @return int Returns WH_ERROR_OK on success, or WH_ERROR_BADARGS if the
+ * arguments are invalid.
+ */
+int wh_Server_CustomCbSignal(whServerContext* server);
+
+/**
+ * @brief Abandons a custom callback left in progress.
+ *
+ * For an application that gives up on an event that never arrives. The
+ * continuation is not called again and the next call to
+ * wh_Server_HandleRequestMessage responds with err WH_ERROR_ABORTED. The
+ * server itself drops the operation without a response when the client
+ * disconnects or sends a new request.
+ *
+ * @param[in] server Pointer to the server context.
+ * @return int Returns WH_ERROR_OK on success, or WH_ERROR_BADARGS if the
+ * arguments are invalid.
+ */
+int wh_Server_CustomCbCancel(whServerContext* server);
+
+/**
+ * @brief Advances a custom callback left in progress.
+ *
+ * Calls the continuation if it is runnable. When it completes, translates the
+ * response into resp_packet.
+ *
+ * @param[in] server Pointer to the server context.
+ * @param[out] out_resp_size Pointer to store the size of the response packet.
+ * @param[out] resp_packet Pointer to store the response packet data.
+ * @return int Returns WH_ERROR_OK when the response is ready,
+ * WH_ERROR_NOTREADY while the operation is still in progress, or a negative
+ * error code on failure.
+ */
+int wh_Server_HandleCustomCbPending(whServerContext* server,
+                                    uint16_t* out_resp_size,
+                                    void* resp_packet);
+
 /** Server DMA functions */
 
 /**
@@ -531,4 +887,42 @@ int whServerDma_CopyToClient32(struct whServerContext_t* server,
 int whServerDma_CopyToClient64(struct whServerContext_t* server,
                                uint64_t clientAddr, void* serverPtr, size_t len,
                                whServerDmaFlags flags);
+
+/**
+ * @brief Starts a copy between server and transformed client addresses.
+ *
+ * Uses the registered DMA copy engine if there is one, in which case the
+ * copy may still be in progress on return. Without an engine the copy is
+ * performed with memcpy and is complete on return. Neither buffer may be
+ * touched until wh_Server_DmaCopyPoll reports completion.
+ *
+ * @param[in] server Pointer to the server context.
+ * @param[out] dst Destination address.
+ * @param[in] src Source address.
+ * @param[in] len Number of bytes to copy.
+ * @return int Returns WH_ERROR_OK if the copy was started,
+ * WH_ERROR_NOTREADY if the engine is busy, or a negative error code on
+ * failure.
+ */
+int wh_Server_DmaCopySubmit(struct whServerContext_t* server, void* dst,
+                            const void* src, size_t len);
+
+/**
+ * @brief Checks whether the last submitted copy has completed.
+ *
+ * @param[in] server Pointer to the server context.
+ * @return int Returns WH_ERROR_OK once complete, WH_ERROR_NOTREADY while the
+ * copy is in progress, or a negative error code on failure.
+ */
+int wh_Server_DmaCopyPoll(struct whServerContext_t* server);
+
+/**
+ * @brief Blocks until the last submitted copy has completed.
+ *
+ * @param[in] server Pointer to the server context.
+ * @return int Returns WH_ERROR_OK on success, or a negative error code on
+ * failure.
+ */
+int wh_Server_DmaCopyWait(struct whServerContext_t* server);
+
 #endif /* WOLFHSM_WH_SERVER_H_ */
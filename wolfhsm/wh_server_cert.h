@@ -0,0 +1,57 @@
+/*
+ * Copyright (C) 2024 wolfSSL Inc.
+ *
+ * This file is part of wolfHSM.
+ *
+ * wolfHSM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfHSM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wolfHSM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef WOLFHSM_WH_SERVER_CERT_H_
+#define WOLFHSM_WH_SERVER_CERT_H_
+
+/*
+ * WolfHSM Internal Server API
+ *
+ */
+
+#include <stdint.h>
+
+#include "wolfhsm/wh_common.h"
+#include "wolfhsm/wh_server.h"
+
+/* Handle a certificate request and generate a response
+ * Defined in wh_server_cert.c */
+int wh_Server_HandleCertRequest(whServerContext* server,
+        uint16_t magic, uint16_t action, uint16_t seq,
+        uint16_t req_size, const void* req_packet,
+        uint16_t *out_resp_size, void* resp_packet);
+
+/* Verify a chain of concatenated DER certificates, leaf first, against the
+ * trust anchor stored in NVM object trusted_id. The top of the chain may be
+ * the anchor itself. Validity dates are not checked as the server may not
+ * have a trusted time source. Returns 0 and the number of verified
+ * certificates in out_depth on success, WH_ERROR_CERTVERIFY if a signature or
+ * issuer does not match */
+int wh_Server_CertVerifyChain(whServerContext* server, const uint8_t* chain,
+        uint32_t chain_len, whNvmId trusted_id, uint16_t* out_depth);
+
+/* Drop any parsed copy of the trust anchor with the given NVM id. Must be
+ * called whenever the NVM object is replaced or destroyed */
+void wh_Server_CertCacheInvalidate(whServerContext* server, whNvmId id);
+
+/* Drop any parsed trust anchor whose NVM object matches filter.  Must be
+ * called before the matching objects are destroyed */
+void wh_Server_CertCacheInvalidateMatching(whServerContext* server,
+        const whNvmFilter* filter);
+
+#endif /* WOLFHSM_WH_SERVER_CERT_H_ */
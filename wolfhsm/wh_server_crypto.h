@@ -24,5 +24,16 @@
 int wh_Server_HandleCryptoRequest(whServerContext* server, uint16_t action,
     uint8_t* data, uint16_t* size);
 
+#if !defined(WOLFHSM_NO_CRYPTO) && defined(HAVE_ECC)
+/* Import the cached or NVM ECC key keyId (stored as qx|qy|d) into key */
+int hsmLoadKeyEcc(whServerContext* server, ecc_key* key, uint16_t keyId,
+    int curveId);
+#endif
+
+#ifndef WOLFHSM_NO_CRYPTO
+/* Free every imported key held by the ECC verifier cache */
+void wh_Server_EccVerifyCacheReset(whServerContext* server);
+#endif
+
 
 #endif
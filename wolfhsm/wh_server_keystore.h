@@ -21,10 +21,39 @@
 
 #include "wolfhsm/wh_server.h"
 
+#ifndef WOLFHSM_NO_CRYPTO
+int wh_Server_KeystoreInit(whServerKeystore* keystore,
+    const whLockConfig* lockConfig);
+int wh_Server_KeystoreCleanup(whServerKeystore* keystore);
+#endif
+
+/* Lock the server's keystore, shared for lookups or exclusive to modify */
+int hsmKeystoreLock(whServerContext* server, int exclusive);
+void hsmKeystoreUnlock(whServerContext* server, int exclusive);
+/* Drop prepared and resident key state if another server sharing the
+ * keystore replaced or removed a key */
+void hsmKeystoreSync(whServerContext* server);
+
+/* Callers of these hold the keystore exclusive */
 int hsmGetUniqueId(whServerContext* server, whNvmId* outId);
 int hsmCacheFindSlot(whServerContext* server);
+/* A cached or stored key was replaced or removed.  Drop the prepared and
+ * resident SHE state derived from it and advance the keystore generation so
+ * other servers sharing the keystore drop theirs.  WOLFHSM_KEYID_ERASED
+ * stands for any key */
+void hsmKeyChanged(whServerContext* server, whKeyId keyId);
+
+/* As hsmKeyChanged, for an NVM object written or destroyed outside the
+ * keystore.  Also drops a committed cached copy.  Takes the keystore */
+void hsmKeyInvalidate(whServerContext* server, whKeyId keyId);
+
 int hsmCacheKey(whServerContext* server, whNvmMetadata* meta, uint8_t* in);
-int hsmFreshenKey(whServerContext* server, whKeyId keyId);
+/* Return the cache slot of keyId, loading it from NVM on a miss, with the
+ * keystore locked.  *outExclusive says how; pass it to hsmReleaseKeySlot once
+ * done with the slot */
+int hsmAcquireKeySlot(whServerContext* server, whKeyId keyId,
+    int* outExclusive);
+void hsmReleaseKeySlot(whServerContext* server, int exclusive);
 int hsmReadKey(whServerContext* server, whKeyId keyId, whNvmMetadata* outMeta,
     uint8_t* out, uint32_t* outSz);
 int hsmEvictKey(whServerContext* server, uint16_t keyId);
@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2024 wolfSSL Inc.
+ *
+ * This file is part of wolfHSM.
+ *
+ * wolfHSM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfHSM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wolfHSM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef WOLFHSM_WH_SERVER_KEYWRAP_H_
+#define WOLFHSM_WH_SERVER_KEYWRAP_H_
+
+/*
+ * WolfHSM Internal Server API
+ *
+ */
+
+#include <stdint.h>
+
+#include "wolfhsm/wh_common.h"
+#include "wolfhsm/wh_server.h"
+
+/* Handle a wrapped bulk key request and generate a response
+ * Defined in wh_server_keywrap.c */
+int wh_Server_HandleKeyWrapRequest(whServerContext* server,
+        uint16_t magic, uint16_t action, uint16_t seq,
+        uint16_t req_size, const void* req_packet,
+        uint16_t *out_resp_size, void* resp_packet);
+
+/* Wrap the client's committed keys found in NVM after cursor into blob under
+ * the AES key kek_id, stopping at max_len bytes or WOLFHSM_KEYWRAP_MAX_KEYS.
+ * The KEK itself is never exported. Returns the cursor to resume from and
+ * sets out_done once no keys remain. NVM must not be modified while an
+ * export is in progress */
+int wh_Server_KeyWrapExport(whServerContext* server, whKeyId kek_id,
+        whNvmId cursor, uint8_t* blob, uint16_t max_len,
+        uint16_t* out_blob_len, uint16_t* out_count,
+        whNvmId* out_next_cursor, uint8_t* out_done);
+
+/* Authenticate and unwrap blob under the AES key kek_id, then add all the
+ * keys it carries to NVM as keys of the requesting client. Nothing is added
+ * unless the whole blob authenticates */
+int wh_Server_KeyWrapImport(whServerContext* server, whKeyId kek_id,
+        const uint8_t* blob, uint16_t blob_len, uint16_t* out_count);
+
+#endif /* WOLFHSM_WH_SERVER_KEYWRAP_H_ */
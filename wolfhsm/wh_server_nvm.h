@@ -35,4 +35,21 @@ int wh_Server_HandleNvmRequest(whServerContext* server,
         uint16_t req_size, const void* req_packet,
         uint16_t *out_resp_size, void* resp_packet);
 
+/* Add an NVM object on behalf of the server.  If the add fails with
+ * WH_ERROR_NOSPACE, a compaction policy is configured and compaction would
+ * free enough room, NVM is compacted once and the add is retried. */
+int wh_Server_NvmAddObject(whServerContext* server, whNvmMetadata* meta,
+        whNvmSize data_len, const uint8_t* data);
+
+/* Run idle-time compaction if the configured policy thresholds are crossed.
+ * Called by wh_Server_HandleRequestMessage when no request is pending.
+ * Returns 0 whether or not compaction was needed. */
+int wh_Server_NvmGcIdle(whServerContext* server);
+
+/* Idle-time NVM housekeeping.  Mounts a lazily mounted NVM, otherwise lets
+ * the backend finish deferred work such as erasing the inactive partition
+ * and then runs idle compaction.  Called by wh_Server_HandleRequestMessage
+ * when no request is pending.  Returns 0 if NVM is not configured. */
+int wh_Server_NvmIdle(whServerContext* server);
+
 #endif /* WOLFHSM_WH_SERVER_NVM_H_ */
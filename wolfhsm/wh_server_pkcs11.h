@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2024 wolfSSL Inc.
+ *
+ * This file is part of wolfHSM.
+ *
+ * wolfHSM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfHSM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wolfHSM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef WOLFHSM_WH_SERVER_PKCS11_H_
+#define WOLFHSM_WH_SERVER_PKCS11_H_
+
+/*
+ * WolfHSM Internal Server API
+ *
+ */
+
+#include <stdint.h>
+
+#include "wolfhsm/wh_server.h"
+
+/* States of an entry in the object handle table */
+enum {
+    WH_PKCS11_OBJECT_STATE_EMPTY = 0,
+    WH_PKCS11_OBJECT_STATE_USED = 1,
+    WH_PKCS11_OBJECT_STATE_DELETED = 2, /* Keeps probe chains intact */
+};
+
+/* Multi-part operation active on a session */
+enum {
+    WH_PKCS11_OP_NONE = 0,
+    WH_PKCS11_OP_FIND = 1,
+    WH_PKCS11_OP_SIGN = 2,
+};
+
+/* Handle a PKCS11 request and generate a response
+ * Defined in wh_server_pkcs11.c */
+int wh_Server_HandlePkcs11Request(whServerContext* server,
+        uint16_t magic, uint16_t action, uint16_t seq,
+        uint16_t req_size, const void* req_packet,
+        uint16_t *out_resp_size, void* resp_packet);
+
+/* Release all sessions and object handles */
+void wh_Server_Pkcs11Reset(whServerContext* server);
+
+#endif /* WOLFHSM_WH_SERVER_PKCS11_H_ */
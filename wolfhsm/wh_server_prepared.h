@@ -0,0 +1,45 @@
+/*
+ * Copyright (C) 2024 wolfSSL Inc.
+ *
+ * This file is part of wolfHSM.
+ *
+ * wolfHSM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfHSM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wolfHSM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef WOLFHSM_WH_SERVER_PREPARED_H_
+#define WOLFHSM_WH_SERVER_PREPARED_H_
+
+/*
+ * WolfHSM Internal Server API
+ *
+ */
+
+#include <stdint.h>
+
+#include "wolfhsm/wh_server.h"
+
+/* Handle a prepared operation request and generate a response
+ * Defined in wh_server_prepared.c */
+int wh_Server_HandlePreparedRequest(whServerContext* server,
+        uint16_t magic, uint16_t action, uint16_t seq,
+        uint16_t req_size, const void* req_packet,
+        uint16_t *out_resp_size, void* resp_packet);
+
+/* Close every prepared operation, wiping its key state */
+void wh_Server_PreparedReset(whServerContext* server);
+
+/* Close the prepared operations keyed from keyId, which has client_id and
+ * type applied.  Called by the keystore when the key changes or goes away */
+void wh_Server_PreparedInvalidate(whServerContext* server, whKeyId keyId);
+
+#endif /* WOLFHSM_WH_SERVER_PREPARED_H_ */
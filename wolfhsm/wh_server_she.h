@@ -27,4 +27,10 @@ typedef struct {
 
 int wh_Server_HandleSheRequest(whServerContext* server,
     uint16_t action, uint8_t* data, uint16_t* size);
+
+/* Drop the resident copy of a SHE key.  Called when the key is replaced or
+ * evicted in the key cache, which does not move the NVM generation */
+void wh_Server_SheSlotInvalidate(whServerContext* server, whKeyId keyId);
+/* Drop every resident SHE key */
+void wh_Server_SheSlotReset(whServerContext* server);
 #endif
@@ -0,0 +1,130 @@
+/*
+ * Copyright (C) 2024 wolfSSL Inc.
+ *
+ * This file is part of wolfHSM.
+ *
+ * wolfHSM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfHSM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with wolfHSM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+ * wolfhsm/wh_transport_direct.h
+ *
+ * wolfHSM Transport binding using direct calls within one image
+ */
+
+#ifndef WH_TRANSPORT_DIRECT_H_
+#define WH_TRANSPORT_DIRECT_H_
+
+/* Direct-call comms
+ * For a client and server built into the same image and run from the same
+ * thread of execution.  Both ends share a single context.  Instead of writing
+ * a request into shared memory and polling for the response, the client's
+ * Send posts a pointer to its packet buffer and immediately calls the
+ * dispatch callback, which is expected to let the server handle one request.
+ * The server reads the request from, and writes the response to, the client's
+ * packet buffer directly, so each direction costs a single copy between the
+ * client and server comm buffers and the client's Recv normally finds the
+ * response already waiting.
+ *
+ * If the dispatch does not produce a response, such as when the server is
+ * not yet connected or deferred the response, Recv calls the dispatch again
+ * before reporting WH_ERROR_NOTREADY.
+ *
+ * Example usage:
+ *
+ * static int directDispatch(void* arg)
+ * {
+ *      return wh_Server_HandleRequestMessage((whServerContext*)arg);
+ * }
+ *
+ * whServerContext server[1];
+ *
+ * whTransportDirectConfig tdcfg[1] = {{
+ *      .dispatch = directDispatch,
+ *      .dispatch_arg = server,
+ * }};
+ * whTransportDirectContext tdc[1] = {0};
+ *
+ * whTransportServerCb tdscb[1] = {WH_TRANSPORT_DIRECT_SERVER_CB};
+ * whCommServerConfig csc[1] = {{
+ *      .transport_cb = tdscb,
+ *      .transport_context = tdc,
+ *      .transport_config = tdcfg,
+ *      .server_id = 5678,
+ * }};
+ *
+ * whTransportClientCb tdccb[1] = {WH_TRANSPORT_DIRECT_CLIENT_CB};
+ * whCommClientConfig ccc[1] = {{
+ *      .transport_cb = tdccb,
+ *      .transport_context = tdc,
+ *      .transport_config = tdcfg,
+ *      .client_id = 1234,
+ * }};
+ */
+
+#include <stdint.h>
+
+#include "wolfhsm/wh_comm.h"
+
+/* Handle one request on the server.  Return value is not interpreted */
+typedef int (*whTransportDirectDispatchCb)(void* arg);
+
+/** Common configuration structure */
+typedef struct {
+    whTransportDirectDispatchCb dispatch;   /* Used by the client only */
+    void* dispatch_arg;
+} whTransportDirectConfig;
+
+/** Common context, shared by the client and server */
+typedef struct {
+    whTransportDirectDispatchCb dispatch;
+    void* dispatch_arg;
+    const void* req;        /* Client packet holding the posted request */
+    void* resp;             /* Client packet that receives the response */
+    uint16_t req_len;
+    uint16_t resp_len;
+    uint8_t req_ready;      /* Posted and not yet received by the server */
+    uint8_t resp_ready;     /* Written and not yet received by the client */
+    uint8_t client_initialized;
+    uint8_t server_initialized;
+} whTransportDirectContext;
+
+/** Callback function declarations */
+int wh_TransportDirect_InitClient(void* c, const void* cf,
+        whCommSetConnectedCb connectcb, void* connectcb_arg);
+int wh_TransportDirect_InitServer(void* c, const void* cf,
+        whCommSetConnectedCb connectcb, void* connectcb_arg);
+int wh_TransportDirect_CleanupClient(void* c);
+int wh_TransportDirect_CleanupServer(void* c);
+int wh_TransportDirect_SendRequest(void* c, uint16_t len, const void* data);
+int wh_TransportDirect_RecvRequest(void* c, uint16_t *out_len, void* data);
+int wh_TransportDirect_SendResponse(void* c, uint16_t len, const void* data);
+int wh_TransportDirect_RecvResponse(void* c, uint16_t *out_len, void* data);
+
+#define WH_TRANSPORT_DIRECT_CLIENT_CB               \
+{                                                   \
+    .Init =     wh_TransportDirect_InitClient,      \
+    .Send =     wh_TransportDirect_SendRequest,     \
+    .Recv =     wh_TransportDirect_RecvResponse,    \
+    .Cleanup =  wh_TransportDirect_CleanupClient,   \
+}
+
+#define WH_TRANSPORT_DIRECT_SERVER_CB               \
+{                                                   \
+    .Init =     wh_TransportDirect_InitServer,      \
+    .Recv =     wh_TransportDirect_RecvRequest,     \
+    .Send =     wh_TransportDirect_SendResponse,    \
+    .Cleanup =  wh_TransportDirect_CleanupServer,   \
+}
+
+#endif /* WH_TRANSPORT_DIRECT_H_ */
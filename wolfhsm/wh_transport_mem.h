@@ -89,19 +89,35 @@
  * whCommServer cs[1] = {0};
  * wh_CommServer_Init(cs, csc);
  *
+ * Optional bulk data region
+ * A third shared block can be provided as bulk and bulk_size to carry large
+ * payloads out of band.  The client manages the region as a slab of
+ * WH_TRANSPORT_MEM_BULK_SLOT_SIZE slots using wh_TransportMem_BulkAlloc and
+ * wh_TransportMem_BulkFree, fills a buffer, and sends its offset and length in
+ * an ordinary request.  The server resolves the offset to its own mapping of
+ * the same region and reads or writes the buffer in place, so the payload is
+ * neither copied through the req/resp buffers nor passed to DMA callbacks.
+ * Only the client allocates, so the slab state is private to its context.
  */
 
 #include <stdint.h>
 
 #include "wolfhsm/wh_comm.h"
 
+enum {
+    WH_TRANSPORT_MEM_BULK_SLOT_SIZE = 256,  /* Bulk allocation granularity */
+    WH_TRANSPORT_MEM_BULK_MAX_SLOTS = 256,  /* Slots tracked per region */
+    WH_TRANSPORT_MEM_BULK_MAP_WORDS = WH_TRANSPORT_MEM_BULK_MAX_SLOTS / 32,
+};
+
 /** Common configuration structure */
 typedef struct {
     void* req;
     void* resp;
+    void* bulk;             /* Opt: Shared bulk data region */
     uint16_t req_size;
     uint16_t resp_size;
-    uint8_t padding[4];
+    uint32_t bulk_size;
 } whTransportMemConfig;
 
 
@@ -126,6 +142,10 @@ typedef struct {
     int initialized;
     uint16_t req_size;
     uint16_t resp_size;
+    uint8_t* bulk;
+    uint32_t bulk_size;
+    uint32_t bulk_slots;    /* Slots managed by the slab allocator */
+    uint32_t bulk_map[WH_TRANSPORT_MEM_BULK_MAP_WORDS]; /* 1 bit per slot */
 } whTransportMemContext;
 
 /* Naming conveniences. Reuses the same types. */
@@ -143,6 +163,17 @@ int wh_TransportMem_RecvRequest(void* c, uint16_t *out_len, void* data);
 int wh_TransportMem_SendResponse(void* c, uint16_t len, const void* data);
 int wh_TransportMem_RecvResponse(void* c, uint16_t *out_len, void* data);
 
+/** Bulk data region functions */
+/* Client: Reserve size bytes of the bulk region. Returns the offset to send to
+ * the server and the client's pointer to the buffer */
+int wh_TransportMem_BulkAlloc(void* c, uint32_t size, uint32_t* out_offset,
+        void** out_ptr);
+/* Client: Release a buffer returned by BulkAlloc with the same size */
+int wh_TransportMem_BulkFree(void* c, uint32_t offset, uint32_t size);
+/* Either side: Resolve offset and size to a local pointer, checking bounds */
+int wh_TransportMem_BulkGet(void* c, uint32_t offset, uint32_t size,
+        void** out_ptr);
+
 #define WH_TRANSPORT_MEM_CLIENT_CB              \
 {                                               \
     .Init =     wh_TransportMem_InitClear,      \
@@ -157,6 +188,7 @@ int wh_TransportMem_RecvResponse(void* c, uint16_t *out_len, void* data);
     .Recv =     wh_TransportMem_RecvRequest,    \
     .Send =     wh_TransportMem_SendResponse,   \
     .Cleanup =  wh_TransportMem_Cleanup,        \
+    .GetBulk =  wh_TransportMem_BulkGet,        \
 }
 
 